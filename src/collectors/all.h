@@ -512,6 +512,7 @@
 #define NETDATA_ML_CHART_PRIO_QUEUE_STATS             890007
 #define NETDATA_ML_CHART_PRIO_TRAINING_TIME_STATS     890008
 #define NETDATA_ML_CHART_PRIO_TRAINING_RESULTS        890009
+#define NETDATA_ML_CHART_PRIO_TRAINING_KMEANS         890010
 
 #define NETDATA_ML_CHART_FAMILY "machine learning"
 #define NETDATA_ML_PLUGIN "ml.plugin"
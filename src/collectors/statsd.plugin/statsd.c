@@ -20,10 +20,8 @@
 
 // --------------------------------------------------------------------------------------
 
-// DO NOT ENABLE MULTITHREADING - IT IS NOT WELL TESTED
-// #define STATSD_MULTITHREADED 1
-
 #define STATSD_DICTIONARY_OPTIONS (DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_ADD_IN_FRONT)
+#define STATSD_LOCAL_DICTIONARY_OPTIONS (DICT_OPTION_SINGLE_THREADED | DICT_OPTION_DONT_OVERWRITE_VALUE)
 #define STATSD_DECIMAL_DETAIL 1000 // floating point values get multiplied by this, with the same divisor
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -232,14 +230,54 @@ typedef struct statsd_app {
 // --------------------------------------------------------------------------------------------------------------------
 // global statsd data
 
+#define STATSD_METRIC_TYPES (STATSD_METRIC_TYPE_DICTIONARY + 1)
+
+// the values a collector thread has received for a metric, since the last flush
+typedef struct statsd_local_metric {
+    STATSD_METRIC_TYPE type;
+    uint32_t events;                // the number of lines received for this metric
+    uint32_t count;                 // the number of values received for this metric
+
+    union {
+        struct {
+            bool absolute;          // a value without a sign has been received
+            NETDATA_DOUBLE value;   // the last absolute value plus the deltas received after it
+        } gauge;
+
+        collected_number counter;   // counters and meters
+
+        struct {
+            uint32_t size;
+            uint32_t used;
+            NETDATA_DOUBLE *values;
+        } histogram;                // histograms and timers
+
+        DICTIONARY *values;         // sets and dictionaries - the times each value has been received
+    };
+
+    char *tags;                     // the last tags received
+} STATSD_LOCAL_METRIC;
+
+typedef struct statsd_local {
+    DICTIONARY *metrics[STATSD_METRIC_TYPES];
+} STATSD_LOCAL;
+
 struct collection_thread_status {
     SPINLOCK spinlock;
     bool initializing;
     uint32_t max_sockets;
 
+    LISTEN_SOCKETS sockets;         // the SO_REUSEPORT clones of the UDP sockets, for all threads but the first
+
+    SPINLOCK local_spinlock;
+    STATSD_LOCAL *local;            // the accumulators the thread is filling (NULL when single threaded)
+    STATSD_LOCAL *spare;            // the accumulators the flushing thread has merged - only the flushing thread touches it
+
     ND_THREAD *thread;
 };
 
+static __thread struct collection_thread_status *statsd_thread_status = NULL;
+
 static struct statsd {
     STATSD_INDEX gauges;
     STATSD_INDEX counters;
@@ -406,22 +444,46 @@ static void dictionary_metric_delete_callback(const DICTIONARY_ITEM *item, void
 static inline STATSD_METRIC *statsd_find_or_add_metric(STATSD_INDEX *index, const char *name) {
     netdata_log_debug(D_STATSD, "searching for metric '%s' under '%s'", name, index->name);
 
-#ifdef STATSD_MULTITHREADED
-    // avoid the write lock of dictionary_set() for existing metrics
-    STATSD_METRIC *m = dictionary_get(index->dict, name);
-    if(!m) m = dictionary_set(index->dict, name, NULL, sizeof(STATSD_METRIC));
-#else
-    // no locks here, go faster
     // this will call the dictionary_metric_insert_callback() if an item
     // is inserted, otherwise it will return the existing one.
     // We used the flag DICT_OPTION_DONT_OVERWRITE_VALUE to support this.
+    // When there are multiple collector threads, only the flushing thread
+    // calls this (while merging the thread-local accumulators).
     STATSD_METRIC *m = dictionary_set(index->dict, name, NULL, sizeof(STATSD_METRIC));
-#endif
 
     index->events++;
     return m;
 }
 
+// creates the shared indexes, once
+static void statsd_indexes_create(void) {
+    if(statsd.gauges.dict)
+        return;
+
+    statsd.gauges.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.meters.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.counters.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.histograms.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.dictionaries.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.sets.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+    statsd.timers.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
+
+    dictionary_register_insert_callback(statsd.gauges.dict, dictionary_metric_insert_callback, &statsd.gauges);
+    dictionary_register_insert_callback(statsd.meters.dict, dictionary_metric_insert_callback, &statsd.meters);
+    dictionary_register_insert_callback(statsd.counters.dict, dictionary_metric_insert_callback, &statsd.counters);
+    dictionary_register_insert_callback(statsd.histograms.dict, dictionary_metric_insert_callback, &statsd.histograms);
+    dictionary_register_insert_callback(statsd.dictionaries.dict, dictionary_metric_insert_callback, &statsd.dictionaries);
+    dictionary_register_insert_callback(statsd.sets.dict, dictionary_metric_insert_callback, &statsd.sets);
+    dictionary_register_insert_callback(statsd.timers.dict, dictionary_metric_insert_callback, &statsd.timers);
+
+    dictionary_register_delete_callback(statsd.gauges.dict, dictionary_metric_delete_callback, &statsd.gauges);
+    dictionary_register_delete_callback(statsd.meters.dict, dictionary_metric_delete_callback, &statsd.meters);
+    dictionary_register_delete_callback(statsd.counters.dict, dictionary_metric_delete_callback, &statsd.counters);
+    dictionary_register_delete_callback(statsd.histograms.dict, dictionary_metric_delete_callback, &statsd.histograms);
+    dictionary_register_delete_callback(statsd.dictionaries.dict, dictionary_metric_delete_callback, &statsd.dictionaries);
+    dictionary_register_delete_callback(statsd.sets.dict, dictionary_metric_delete_callback, &statsd.sets);
+    dictionary_register_delete_callback(statsd.timers.dict, dictionary_metric_delete_callback, &statsd.timers);
+}
 
 // --------------------------------------------------------------------------------------------------------------------
 // statsd parsing numbers
@@ -597,13 +659,7 @@ static inline void statsd_process_set(STATSD_METRIC *m, const char *value) {
         // magic loading of metric, without affecting anything
     }
     else {
-#ifdef STATSD_MULTITHREADED
-        // avoid the write lock to check if something is already there
-        if(!dictionary_get(m->set.dict, value))
-            dictionary_set(m->set.dict, value, NULL, 0);
-#else
         dictionary_set(m->set.dict, value, NULL, 0);
-#endif
         metric_update_counters_and_obsoletion(m);
     }
 }
@@ -677,101 +733,462 @@ static inline const char *statsd_parse_field_trim(const char *start, char *end)
     return start;
 }
 
-static void statsd_process_metric(const char *name, const char *value, const char *type, const char *sampling, const char *tags) {
-    netdata_log_debug(D_STATSD, "STATSD: raw metric '%s', value '%s', type '%s', sampling '%s', tags '%s'", name?name:"(null)", value?value:"(null)", type?type:"(null)", sampling?sampling:"(null)", tags?tags:"(null)");
+static void statsd_process_metric_tags(STATSD_METRIC *m, const char *tags) {
+    const char *s = tags;
+    while(*s) {
+        const char *tagkey = NULL, *tagvalue = NULL;
+        char *tagkey_end = NULL, *tagvalue_end = NULL;
 
-    if(unlikely(!name || !*name)) return;
-    if(unlikely(!type || !*type)) type = "m";
+        s = tagkey_end = (char *)statsd_parse_skip_up_to(tagkey = s, ':', '=', ',');
+        if(tagkey == tagkey_end) {
+            if (*s) {
+                s++;
+                s = statsd_parse_skip_spaces(s);
+            }
+            continue;
+        }
 
-    STATSD_METRIC *m = NULL;
+        if(likely(*s == ':' || *s == '='))
+            s = tagvalue_end = (char *) statsd_parse_skip_up_to(tagvalue = ++s, ',', '\0', '\0');
 
-    char t0 = type[0], t1 = type[1];
-    if(unlikely(t0 == 'g' && t1 == '\0')) {
-        statsd_process_gauge(
-            m = statsd_find_or_add_metric(&statsd.gauges, name),
-            value, sampling);
+        if(*s == ',') s++;
+
+        statsd_parse_field_trim(tagkey, tagkey_end);
+        statsd_parse_field_trim(tagvalue, tagvalue_end);
+
+        if(tagkey && *tagkey && tagvalue && *tagvalue) {
+            if (strcmp(tagkey, "units") == 0 && (!m->units || strcmp(m->units, tagvalue) != 0)) {
+                m->units = strdupz(tagvalue);
+                m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+            }
+
+            if (strcmp(tagkey, "name") == 0 && (!m->dimname || strcmp(m->dimname, tagvalue) != 0)) {
+                m->dimname = strdupz(tagvalue);
+                m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+            }
+
+            if (strcmp(tagkey, "family") == 0 && (!m->family || strcmp(m->family, tagvalue) != 0)) {
+                m->family = strdupz(tagvalue);
+                m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+            }
+        }
     }
-    else if(unlikely((t0 == 'c' || t0 == 'C') && t1 == '\0')) {
+}
+
+static inline bool statsd_parse_metric_type(const char *type, STATSD_METRIC_TYPE *t) {
+    char t0 = type[0], t1 = type[1];
+    if(unlikely(t0 == 'g' && t1 == '\0'))
+        *t = STATSD_METRIC_TYPE_GAUGE;
+
+    else if(unlikely((t0 == 'c' || t0 == 'C') && t1 == '\0'))
         // etsy/statsd uses 'c'
         // brubeck     uses 'C'
-        statsd_process_counter(
-            m = statsd_find_or_add_metric(&statsd.counters, name),
-            value, sampling);
-    }
-    else if(unlikely(t0 == 'm' && t1 == '\0')) {
-        statsd_process_meter(
-            m = statsd_find_or_add_metric(&statsd.meters, name),
-            value, sampling);
-    }
-    else if(unlikely(t0 == 'h' && t1 == '\0')) {
-        statsd_process_histogram(
-            m = statsd_find_or_add_metric(&statsd.histograms, name),
-            value, sampling);
-    }
-    else if(unlikely(t0 == 's' && t1 == '\0')) {
-        statsd_process_set(
-            m = statsd_find_or_add_metric(&statsd.sets, name),
-            value);
-    }
-    else if(unlikely(t0 == 'd' && t1 == '\0')) {
-        statsd_process_dictionary(
-            m = statsd_find_or_add_metric(&statsd.dictionaries, name),
-            value);
-    }
-    else if(unlikely(t0 == 'm' && t1 == 's' && type[2] == '\0')) {
-        statsd_process_timer(
-            m = statsd_find_or_add_metric(&statsd.timers, name),
-            value, sampling);
+        *t = STATSD_METRIC_TYPE_COUNTER;
+
+    else if(unlikely(t0 == 'm' && t1 == '\0'))
+        *t = STATSD_METRIC_TYPE_METER;
+
+    else if(unlikely(t0 == 'h' && t1 == '\0'))
+        *t = STATSD_METRIC_TYPE_HISTOGRAM;
+
+    else if(unlikely(t0 == 's' && t1 == '\0'))
+        *t = STATSD_METRIC_TYPE_SET;
+
+    else if(unlikely(t0 == 'd' && t1 == '\0'))
+        *t = STATSD_METRIC_TYPE_DICTIONARY;
+
+    else if(unlikely(t0 == 'm' && t1 == 's' && type[2] == '\0'))
+        *t = STATSD_METRIC_TYPE_TIMER;
+
+    else
+        return false;
+
+    return true;
+}
+
+static inline STATSD_INDEX *statsd_index_of_type(STATSD_METRIC_TYPE type) {
+    switch(type) {
+        case STATSD_METRIC_TYPE_GAUGE:
+            return &statsd.gauges;
+
+        case STATSD_METRIC_TYPE_COUNTER:
+            return &statsd.counters;
+
+        case STATSD_METRIC_TYPE_METER:
+            return &statsd.meters;
+
+        case STATSD_METRIC_TYPE_TIMER:
+            return &statsd.timers;
+
+        case STATSD_METRIC_TYPE_HISTOGRAM:
+            return &statsd.histograms;
+
+        case STATSD_METRIC_TYPE_SET:
+            return &statsd.sets;
+
+        default:
+        case STATSD_METRIC_TYPE_DICTIONARY:
+            return &statsd.dictionaries;
     }
-    else {
-        statsd.unknown_types++;
-        netdata_log_error("STATSD: metric '%s' with value '%s' is sent with unknown metric type '%s'", name, value?value:"", type);
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// thread-local accumulators
+//
+// When there are multiple collector threads, they do not touch the shared indexes.
+// Each thread accumulates the values it receives in its own tables, and the flushing
+// thread merges them into the shared indexes, right before flushing them.
+
+static void statsd_local_metric_insert_callback(const DICTIONARY_ITEM *item __maybe_unused, void *value, void *data) {
+    STATSD_INDEX *index = (STATSD_INDEX *)data;
+    STATSD_LOCAL_METRIC *lm = (STATSD_LOCAL_METRIC *)value;
+    lm->type = index->type;
+}
+
+static void statsd_local_metric_delete_callback(const DICTIONARY_ITEM *item __maybe_unused, void *value, void *data __maybe_unused) {
+    STATSD_LOCAL_METRIC *lm = (STATSD_LOCAL_METRIC *)value;
+
+    if(lm->type == STATSD_METRIC_TYPE_HISTOGRAM || lm->type == STATSD_METRIC_TYPE_TIMER)
+        freez(lm->histogram.values);
+
+    else if(lm->type == STATSD_METRIC_TYPE_SET || lm->type == STATSD_METRIC_TYPE_DICTIONARY)
+        dictionary_destroy(lm->values);
+
+    freez(lm->tags);
+}
+
+static STATSD_LOCAL *statsd_local_create(void) {
+    STATSD_LOCAL *local = callocz(1, sizeof(STATSD_LOCAL));
+
+    for(size_t t = 0; t < STATSD_METRIC_TYPES ;t++) {
+        local->metrics[t] = dictionary_create_advanced(STATSD_LOCAL_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_LOCAL_METRIC));
+        dictionary_register_insert_callback(local->metrics[t], statsd_local_metric_insert_callback, statsd_index_of_type((STATSD_METRIC_TYPE)t));
+        dictionary_register_delete_callback(local->metrics[t], statsd_local_metric_delete_callback, NULL);
+    }
+
+    return local;
+}
+
+static void statsd_local_destroy(STATSD_LOCAL *local) {
+    if(!local) return;
+
+    for(size_t t = 0; t < STATSD_METRIC_TYPES ;t++)
+        dictionary_destroy(local->metrics[t]);
+
+    freez(local);
+}
+
+static void statsd_local_process_metric(STATSD_LOCAL *local, STATSD_METRIC_TYPE type, const char *name, const char *value, const char *sampling, const char *tags) {
+    if(type != STATSD_METRIC_TYPE_COUNTER && type != STATSD_METRIC_TYPE_METER && unlikely(!value || !*value)) {
+        // we accept empty values only for counters and meters
+        collector_error("STATSD: metric '%s' of type %s, with empty value is ignored.", name, statsd_index_of_type(type)->name);
+        return;
+    }
+
+    // this will call the statsd_local_metric_insert_callback() if an item
+    // is inserted, otherwise it will return the existing one.
+    STATSD_LOCAL_METRIC *lm = dictionary_set(local->metrics[type], name, NULL, sizeof(STATSD_LOCAL_METRIC));
+    lm->events++;
+
+    if(unlikely(tags && *tags && (!lm->tags || strcmp(lm->tags, tags) != 0))) {
+        freez(lm->tags);
+        lm->tags = strdupz(tags);
+    }
+
+    if(unlikely(value_is_zinit(value))) {
+        // magic loading of metric, without affecting anything
+        return;
     }
 
-    if(m && tags && *tags) {
-        const char *s = tags;
-        while(*s) {
-            const char *tagkey = NULL, *tagvalue = NULL;
-            char *tagkey_end = NULL, *tagvalue_end = NULL;
+    switch(type) {
+        case STATSD_METRIC_TYPE_GAUGE:
+            if (unlikely(*value == '+' || *value == '-'))
+                lm->gauge.value += statsd_parse_float(value, 1.0) / statsd_parse_sampling_rate(sampling);
+            else {
+                lm->gauge.absolute = true;
+                lm->gauge.value = statsd_parse_float(value, 1.0);
+            }
+            break;
+
+        case STATSD_METRIC_TYPE_COUNTER:
+        case STATSD_METRIC_TYPE_METER:
+            lm->counter += llrintndd((NETDATA_DOUBLE) statsd_parse_int(value, 1) / statsd_parse_sampling_rate(sampling));
+            break;
 
-            s = tagkey_end = (char *)statsd_parse_skip_up_to(tagkey = s, ':', '=', ',');
-            if(tagkey == tagkey_end) {
-                if (*s) {
-                    s++;
-                    s = statsd_parse_skip_spaces(s);
+        case STATSD_METRIC_TYPE_HISTOGRAM:
+        case STATSD_METRIC_TYPE_TIMER: {
+            NETDATA_DOUBLE v = statsd_parse_float(value, 1.0);
+            NETDATA_DOUBLE sampling_rate = statsd_parse_sampling_rate(sampling);
+            if(unlikely(isless(sampling_rate, 0.01))) sampling_rate = 0.01;
+
+            long long samples = llrintndd(1.0 / sampling_rate);
+            while(samples-- > 0) {
+                if(unlikely(lm->histogram.used == lm->histogram.size)) {
+                    lm->histogram.size += statsd.histogram_increase_step;
+                    lm->histogram.values = reallocz(lm->histogram.values, sizeof(NETDATA_DOUBLE) * lm->histogram.size);
                 }
-                continue;
+
+                lm->histogram.values[lm->histogram.used++] = v;
             }
+            break;
+        }
 
-            if(likely(*s == ':' || *s == '='))
-                s = tagvalue_end = (char *) statsd_parse_skip_up_to(tagvalue = ++s, ',', '\0', '\0');
+        case STATSD_METRIC_TYPE_SET:
+        case STATSD_METRIC_TYPE_DICTIONARY: {
+            if(unlikely(!lm->values))
+                lm->values = dictionary_create_advanced(STATSD_LOCAL_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(uint32_t));
 
-            if(*s == ',') s++;
+            uint32_t *times = dictionary_set(lm->values, value, NULL, sizeof(uint32_t));
+            (*times)++;
+            break;
+        }
+    }
 
-            statsd_parse_field_trim(tagkey, tagkey_end);
-            statsd_parse_field_trim(tagvalue, tagvalue_end);
+    lm->count++;
+}
 
-            if(tagkey && *tagkey && tagvalue && *tagvalue) {
-                if (strcmp(tagkey, "units") == 0 && (!m->units || strcmp(m->units, tagvalue) != 0)) {
-                    m->units = strdupz(tagvalue);
-                    m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+static void statsd_local_merge_metric(STATSD_INDEX *index, const char *name, STATSD_LOCAL_METRIC *lm) {
+    STATSD_METRIC *m = dictionary_set(index->dict, name, NULL, sizeof(STATSD_METRIC));
+    index->events += lm->events;
+
+    if(is_metric_useful_for_collection(m)) {
+        switch(m->type) {
+            case STATSD_METRIC_TYPE_GAUGE:
+                if(unlikely(m->reset))
+                    statsd_reset_metric(m);
+
+                if(lm->count) {
+                    if(lm->gauge.absolute)
+                        m->gauge.value = lm->gauge.value;
+                    else
+                        m->gauge.value += lm->gauge.value;
                 }
+                break;
+
+            case STATSD_METRIC_TYPE_COUNTER:
+            case STATSD_METRIC_TYPE_METER:
+                if(unlikely(m->reset))
+                    statsd_reset_metric(m);
 
-                if (strcmp(tagkey, "name") == 0 && (!m->dimname || strcmp(m->dimname, tagvalue) != 0)) {
-                    m->dimname = strdupz(tagvalue);
-                    m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+                m->counter.value += lm->counter;
+                break;
+
+            case STATSD_METRIC_TYPE_HISTOGRAM:
+            case STATSD_METRIC_TYPE_TIMER: {
+                STATSD_METRIC_HISTOGRAM_EXTENSIONS *ext = m->histogram.ext;
+
+                // the whole merge is done under the mutex, so that the samples
+                // and their count are always consistent for anyone reading them
+                netdata_mutex_lock(&ext->mutex);
+
+                if(unlikely(m->reset)) {
+                    ext->used = 0;
+                    statsd_reset_metric(m);
                 }
 
-                if (strcmp(tagkey, "family") == 0 && (!m->family || strcmp(m->family, tagvalue) != 0)) {
-                    m->family = strdupz(tagvalue);
-                    m->options |= STATSD_METRIC_OPTION_UPDATED_CHART_METADATA;
+                if(lm->histogram.used) {
+                    if(unlikely(ext->used + lm->histogram.used > ext->size)) {
+                        ext->size = ext->used + lm->histogram.used + statsd.histogram_increase_step;
+                        ext->values = reallocz(ext->values, sizeof(NETDATA_DOUBLE) * ext->size);
+                    }
+
+                    memcpy(&ext->values[ext->used], lm->histogram.values, sizeof(NETDATA_DOUBLE) * lm->histogram.used);
+                    ext->used += lm->histogram.used;
                 }
+
+                netdata_mutex_unlock(&ext->mutex);
+                break;
+            }
+
+            case STATSD_METRIC_TYPE_SET: {
+                if(unlikely(m->reset)) {
+                    if(likely(m->set.dict)) {
+                        dictionary_destroy(m->set.dict);
+                        m->set.dict = NULL;
+                    }
+                    statsd_reset_metric(m);
+                }
+
+                if (unlikely(!m->set.dict))
+                    m->set.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS, &dictionary_stats_category_collectors, 0);
+
+                if(lm->values) {
+                    uint32_t *times;
+                    dfe_start_read(lm->values, times) {
+                        dictionary_set(m->set.dict, times_dfe.name, NULL, 0);
+                    }
+                    dfe_done(times);
+                }
+                break;
+            }
+
+            case STATSD_METRIC_TYPE_DICTIONARY: {
+                if(unlikely(m->reset))
+                    statsd_reset_metric(m);
+
+                if (unlikely(!m->dictionary.dict))
+                    m->dictionary.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC_DICTIONARY_ITEM));
+
+                if(lm->values) {
+                    uint32_t *times;
+                    dfe_start_read(lm->values, times) {
+                        const char *value = times_dfe.name;
+                        STATSD_METRIC_DICTIONARY_ITEM *t = (STATSD_METRIC_DICTIONARY_ITEM *)dictionary_get(m->dictionary.dict, value);
+
+                        if (unlikely(!t)) {
+                            if(dictionary_entries(m->dictionary.dict) >= statsd.dictionary_max_unique)
+                                value = "other";
+
+                            t = (STATSD_METRIC_DICTIONARY_ITEM *)dictionary_set(m->dictionary.dict, value, NULL, sizeof(STATSD_METRIC_DICTIONARY_ITEM));
+                        }
+
+                        t->count += *times;
+                    }
+                    dfe_done(times);
+                }
+                break;
             }
         }
+
+        if(lm->count) {
+            m->events += lm->count;
+            m->count += lm->count;
+            m->last_collected = now_realtime_sec();
+            m->options &= ~STATSD_METRIC_OPTION_OBSOLETE;
+        }
+    }
+
+    if(unlikely(lm->tags)) {
+        statsd_process_metric_tags(m, lm->tags);
+        freez(lm->tags);
+        lm->tags = NULL;
     }
 }
 
-static inline size_t statsd_process(char *buffer, size_t size, int require_newlines) {
+static void statsd_local_merge(STATSD_LOCAL *local) {
+    for(size_t t = 0; t < STATSD_METRIC_TYPES ;t++) {
+        STATSD_INDEX *index = statsd_index_of_type((STATSD_METRIC_TYPE)t);
+
+        STATSD_LOCAL_METRIC *lm;
+        dfe_start_write(local->metrics[t], lm) {
+            if(!lm->events) {
+                // nothing received during the last flush interval
+                dictionary_del(local->metrics[t], lm_dfe.name);
+                continue;
+            }
+
+            statsd_local_merge_metric(index, lm_dfe.name, lm);
+
+            // keep the allocations, for the next flush interval
+            lm->events = 0;
+            lm->count = 0;
+
+            switch(lm->type) {
+                case STATSD_METRIC_TYPE_GAUGE:
+                    lm->gauge.absolute = false;
+                    lm->gauge.value = 0;
+                    break;
+
+                case STATSD_METRIC_TYPE_COUNTER:
+                case STATSD_METRIC_TYPE_METER:
+                    lm->counter = 0;
+                    break;
+
+                case STATSD_METRIC_TYPE_HISTOGRAM:
+                case STATSD_METRIC_TYPE_TIMER:
+                    lm->histogram.used = 0;
+                    break;
+
+                case STATSD_METRIC_TYPE_SET:
+                case STATSD_METRIC_TYPE_DICTIONARY:
+                    if(lm->values)
+                        dictionary_flush(lm->values);
+                    break;
+            }
+        }
+        dfe_done(lm);
+    }
+}
+
+// called by the flushing thread, to merge the values collected by all collector threads
+static void statsd_collection_threads_merge(void) {
+    for(int i = 0; i < statsd.threads ;i++) {
+        struct collection_thread_status *status = &statsd.collection_threads_status[i];
+        if(!status->local)
+            continue;
+
+        // swap the tables, so that the collector thread continues
+        // on a clean one, while we merge the one it filled
+        spinlock_lock(&status->local_spinlock);
+        STATSD_LOCAL *local = status->local;
+        status->local = status->spare;
+        spinlock_unlock(&status->local_spinlock);
+
+        statsd_local_merge(local);
+        status->spare = local;
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// statsd parsing - dispatching
+
+static void statsd_process_metric(STATSD_LOCAL *local, const char *name, const char *value, const char *type, const char *sampling, const char *tags) {
+    netdata_log_debug(D_STATSD, "STATSD: raw metric '%s', value '%s', type '%s', sampling '%s', tags '%s'", name?name:"(null)", value?value:"(null)", type?type:"(null)", sampling?sampling:"(null)", tags?tags:"(null)");
+
+    if(unlikely(!name || !*name)) return;
+    if(unlikely(!type || !*type)) type = "m";
+
+    STATSD_METRIC_TYPE t;
+    if(unlikely(!statsd_parse_metric_type(type, &t))) {
+        __atomic_add_fetch(&statsd.unknown_types, 1, __ATOMIC_RELAXED);
+        netdata_log_error("STATSD: metric '%s' with value '%s' is sent with unknown metric type '%s'", name, value?value:"", type);
+        return;
+    }
+
+    if(local) {
+        statsd_local_process_metric(local, t, name, value, sampling, tags);
+        return;
+    }
+
+    STATSD_METRIC *m = statsd_find_or_add_metric(statsd_index_of_type(t), name);
+
+    switch(t) {
+        case STATSD_METRIC_TYPE_GAUGE:
+            statsd_process_gauge(m, value, sampling);
+            break;
+
+        case STATSD_METRIC_TYPE_COUNTER:
+            statsd_process_counter(m, value, sampling);
+            break;
+
+        case STATSD_METRIC_TYPE_METER:
+            statsd_process_meter(m, value, sampling);
+            break;
+
+        case STATSD_METRIC_TYPE_HISTOGRAM:
+            statsd_process_histogram(m, value, sampling);
+            break;
+
+        case STATSD_METRIC_TYPE_TIMER:
+            statsd_process_timer(m, value, sampling);
+            break;
+
+        case STATSD_METRIC_TYPE_SET:
+            statsd_process_set(m, value);
+            break;
+
+        case STATSD_METRIC_TYPE_DICTIONARY:
+            statsd_process_dictionary(m, value);
+            break;
+    }
+
+    if(tags && *tags)
+        statsd_process_metric_tags(m, tags);
+}
+
+static inline size_t statsd_process_buffer(STATSD_LOCAL *local, char *buffer, size_t size, int require_newlines) {
     buffer[size] = '\0';
     netdata_log_debug(D_STATSD, "RECEIVED: %zu bytes: '%s'", size, buffer);
 
@@ -825,7 +1242,8 @@ static inline size_t statsd_process(char *buffer, size_t size, int require_newli
             s = statsd_parse_skip_spaces(s);
 
         statsd_process_metric(
-                  statsd_parse_field_trim(name, name_end)
+                  local
+                , statsd_parse_field_trim(name, name_end)
                 , statsd_parse_field_trim(value, value_end)
                 , statsd_parse_field_trim(type, type_end)
                 , statsd_parse_field_trim(sampling, sampling_end)
@@ -836,6 +1254,19 @@ static inline size_t statsd_process(char *buffer, size_t size, int require_newli
     return 0;
 }
 
+static inline size_t statsd_process(char *buffer, size_t size, int require_newlines) {
+    struct collection_thread_status *status = statsd_thread_status;
+    if(likely(!status || !status->local))
+        return statsd_process_buffer(NULL, buffer, size, require_newlines);
+
+    // the flushing thread swaps the tables while holding this lock
+    spinlock_lock(&status->local_spinlock);
+    size = statsd_process_buffer(status->local, buffer, size, require_newlines);
+    spinlock_unlock(&status->local_spinlock);
+
+    return size;
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // statsd pollfd interface
@@ -1012,17 +1443,18 @@ static int statsd_rcv_callback(POLLINFO *pi, nd_poll_event_t *events) {
                     }
                 } else if (rc) {
                     // data received
-                    statsd.udp_socket_reads++;
-                    statsd.udp_packets_received += rc;
+                    // the UDP sockets may be served by multiple threads
+                    __atomic_add_fetch(&statsd.udp_socket_reads, 1, __ATOMIC_RELAXED);
+                    __atomic_add_fetch(&statsd.udp_packets_received, (size_t)rc, __ATOMIC_RELAXED);
 
                     size_t i, total_size = 0;
                     for (i = 0; i < (size_t)rc; ++i) {
                         size_t len = (size_t)d->msgs[i].msg_len;
-                        statsd.udp_bytes_read += len;
                         total_size += len;
                         statsd_process(d->msgs[i].msg_hdr.msg_iov->iov_base, len, 0);
                     }
 
+                    __atomic_add_fetch(&statsd.udp_bytes_read, total_size, __ATOMIC_RELAXED);
                     pulse_statsd_received_bytes(total_size);
                 }
             } while (rc != -1);
@@ -1041,9 +1473,9 @@ static int statsd_rcv_callback(POLLINFO *pi, nd_poll_event_t *events) {
                     }
                 } else if (rc) {
                     // data received
-                    statsd.udp_socket_reads++;
-                    statsd.udp_packets_received++;
-                    statsd.udp_bytes_read += rc;
+                    __atomic_add_fetch(&statsd.udp_socket_reads, 1, __ATOMIC_RELAXED);
+                    __atomic_add_fetch(&statsd.udp_packets_received, 1, __ATOMIC_RELAXED);
+                    __atomic_add_fetch(&statsd.udp_bytes_read, (size_t)rc, __ATOMIC_RELAXED);
                     statsd_process(d->buffer, (size_t) rc, 0);
 
                     pulse_statsd_received_bytes(rc);
@@ -1114,6 +1546,13 @@ void statsd_collector_thread(void *ptr) {
 
     collector_info("STATSD collector thread started with taskid %d", gettid_cached());
 
+    // when set, statsd_process() accumulates to the thread-local tables
+    statsd_thread_status = status;
+
+    // the first thread listens on all the sockets (TCP and UDP),
+    // the rest listen on their own SO_REUSEPORT clones of the UDP sockets
+    LISTEN_SOCKETS *sockets = status->sockets.opened ? &status->sockets : &statsd.sockets;
+
     struct statsd_udp *d = callocz(sizeof(struct statsd_udp), 1);
     d->status = status;
 
@@ -1134,7 +1573,7 @@ void statsd_collector_thread(void *ptr) {
     }
 #endif
 
-    poll_events(&statsd.sockets
+    poll_events(sockets
             , statsd_add_callback
             , statsd_del_callback
             , statsd_rcv_callback
@@ -2407,6 +2846,13 @@ static void statsd_main_cleanup(void *pptr) {
 
             (void) nd_thread_join(statsd.collection_threads_status[i].thread);
         }
+
+        for (i = 0; i < statsd.threads; i++) {
+            listen_sockets_close(&statsd.collection_threads_status[i].sockets);
+            statsd_local_destroy(statsd.collection_threads_status[i].local);
+            statsd_local_destroy(statsd.collection_threads_status[i].spare);
+        }
+
         freez(statsd.collection_threads_status);
     }
 
@@ -2446,9 +2892,10 @@ static void statsd_main_cleanup(void *pptr) {
 #define WORKER_STATSD_FLUSH_SETS 5
 #define WORKER_STATSD_FLUSH_DICTIONARIES 6
 #define WORKER_STATSD_FLUSH_STATS 7
+#define WORKER_STATSD_FLUSH_MERGE 8
 
-#if WORKER_UTILIZATION_MAX_JOB_TYPES < 8
-#error WORKER_UTILIZATION_MAX_JOB_TYPES has to be at least 8
+#if WORKER_UTILIZATION_MAX_JOB_TYPES < 9
+#error WORKER_UTILIZATION_MAX_JOB_TYPES has to be at least 9
 #endif
 
 void *statsd_main(void *ptr) {
@@ -2463,30 +2910,9 @@ void *statsd_main(void *ptr) {
     worker_register_job_name(WORKER_STATSD_FLUSH_SETS, "sets");
     worker_register_job_name(WORKER_STATSD_FLUSH_DICTIONARIES, "dictionaries");
     worker_register_job_name(WORKER_STATSD_FLUSH_STATS, "statistics");
+    worker_register_job_name(WORKER_STATSD_FLUSH_MERGE, "merge");
 
-    statsd.gauges.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.meters.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.counters.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.histograms.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.dictionaries.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.sets.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-    statsd.timers.dict = dictionary_create_advanced(STATSD_DICTIONARY_OPTIONS | DICT_OPTION_FIXED_SIZE, &dictionary_stats_category_collectors, sizeof(STATSD_METRIC));
-
-    dictionary_register_insert_callback(statsd.gauges.dict, dictionary_metric_insert_callback, &statsd.gauges);
-    dictionary_register_insert_callback(statsd.meters.dict, dictionary_metric_insert_callback, &statsd.meters);
-    dictionary_register_insert_callback(statsd.counters.dict, dictionary_metric_insert_callback, &statsd.counters);
-    dictionary_register_insert_callback(statsd.histograms.dict, dictionary_metric_insert_callback, &statsd.histograms);
-    dictionary_register_insert_callback(statsd.dictionaries.dict, dictionary_metric_insert_callback, &statsd.dictionaries);
-    dictionary_register_insert_callback(statsd.sets.dict, dictionary_metric_insert_callback, &statsd.sets);
-    dictionary_register_insert_callback(statsd.timers.dict, dictionary_metric_insert_callback, &statsd.timers);
-
-    dictionary_register_delete_callback(statsd.gauges.dict, dictionary_metric_delete_callback, &statsd.gauges);
-    dictionary_register_delete_callback(statsd.meters.dict, dictionary_metric_delete_callback, &statsd.meters);
-    dictionary_register_delete_callback(statsd.counters.dict, dictionary_metric_delete_callback, &statsd.counters);
-    dictionary_register_delete_callback(statsd.histograms.dict, dictionary_metric_delete_callback, &statsd.histograms);
-    dictionary_register_delete_callback(statsd.dictionaries.dict, dictionary_metric_delete_callback, &statsd.dictionaries);
-    dictionary_register_delete_callback(statsd.sets.dict, dictionary_metric_delete_callback, &statsd.sets);
-    dictionary_register_delete_callback(statsd.timers.dict, dictionary_metric_delete_callback, &statsd.timers);
+    statsd_indexes_create();
 
     // ----------------------------------------------------------------------------------------------------------------
     // statsd configuration
@@ -2575,16 +3001,16 @@ void *statsd_main(void *ptr) {
 
     size_t max_sockets = (size_t)inicfg_get_number(&netdata_config, CONFIG_SECTION_STATSD, "statsd server max TCP sockets", (long long int)(rlimit_nofile.rlim_cur / 4));
 
-#ifdef STATSD_MULTITHREADED
-    statsd.threads = (int)inicfg_get_number(&netdata_config, CONFIG_SECTION_STATSD, "threads", processors);
-    if(statsd.threads < 1) {
-        collector_error("STATSD: Invalid number of threads %d, using %d", statsd.threads, processors);
-        statsd.threads = processors;
-        inicfg_set_number(&netdata_config, CONFIG_SECTION_STATSD, "collector threads", statsd.threads);
+    statsd.threads = (int)inicfg_get_number(&netdata_config, CONFIG_SECTION_STATSD, "threads", 1);
+    if(statsd.threads < 1 || statsd.threads > (int)netdata_conf_cpus()) {
+        int threads = statsd.threads < 1 ? 1 : (int)netdata_conf_cpus();
+        collector_error("STATSD: Invalid number of threads %d, using %d", statsd.threads, threads);
+        statsd.threads = threads;
+        inicfg_set_number(&netdata_config, CONFIG_SECTION_STATSD, "threads", statsd.threads);
     }
-#else
-    statsd.threads = 1;
-#endif
+
+    // all threads need SO_REUSEPORT on the UDP sockets, so that the kernel shards the datagrams among them
+    statsd.sockets.reuse_port_udp = (statsd.threads > 1);
 
     // read custom application definitions
     statsd_readdir(netdata_configured_user_config_dir, netdata_configured_stock_config_dir, "statsd.d");
@@ -2604,13 +3030,29 @@ void *statsd_main(void *ptr) {
 
     int i;
     for(i = 0; i < statsd.threads ;i++) {
-        statsd.collection_threads_status[i].max_sockets = max_sockets / statsd.threads;
+        struct collection_thread_status *status = &statsd.collection_threads_status[i];
+
+        // TCP clients are served only by the first thread
+        status->max_sockets = max_sockets;
+        spinlock_init(&status->spinlock);
+        spinlock_init(&status->local_spinlock);
+
+        if(statsd.threads > 1) {
+            if(i > 0 && listen_sockets_clone_udp(&status->sockets, &statsd.sockets) <= 0) {
+                collector_error("STATSD: cannot open SO_REUSEPORT UDP sockets for collector thread %d. "
+                                "It will not be started.", i + 1);
+                continue;
+            }
+
+            status->local = statsd_local_create();
+            status->spare = statsd_local_create();
+        }
+
         char tag[NETDATA_THREAD_TAG_MAX + 1];
         snprintfz(tag, NETDATA_THREAD_TAG_MAX, "STATSD_IN[%d]", i + 1);
-        spinlock_init(&statsd.collection_threads_status[i].spinlock);
-        statsd.collection_threads_status[i].initializing = true;
-        statsd.collection_threads_status[i].thread = nd_thread_create(tag, NETDATA_THREAD_OPTION_DEFAULT,
-                                                                      statsd_collector_thread, &statsd.collection_threads_status[i]);
+        status->initializing = true;
+        status->thread = nd_thread_create(tag, NETDATA_THREAD_OPTION_DEFAULT,
+                                          statsd_collector_thread, status);
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -2829,6 +3271,11 @@ void *statsd_main(void *ptr) {
         worker_is_idle();
         heartbeat_next(&hb);
 
+        if(statsd.threads > 1) {
+            worker_is_busy(WORKER_STATSD_FLUSH_MERGE);
+            statsd_collection_threads_merge();
+        }
+
         worker_is_busy(WORKER_STATSD_FLUSH_GAUGES);
         statsd_flush_index_metrics(&statsd.gauges,     statsd_flush_gauge);
 
@@ -2913,3 +3360,344 @@ void *statsd_main(void *ptr) {
 cleanup: ; // added semi-colon to prevent older gcc error: label at end of compound statement
     return NULL;
 }
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// statsd unittest - netdata -W statsdtest
+//
+// Feeds the same lines to the direct (single threaded) path and to two thread-local
+// accumulators, merges the accumulators like the flushing thread does, and checks
+// that both paths end up with the same (and the expected) values.
+
+static const char *statsd_unittest_batches[][20] = {
+    {
+        "g1:10|g", "g1:+5|g", "g1:-2|g", "g2:+7|g",
+        "c1:3|c", "c1|c", "c1:2|c|@0.5", "m1:4|m",
+        "h1:1|h", "h1:2|h|@0.25", "t1:100|ms", "t1:zinit|ms",
+        "s1:a|s", "s1:b|s", "s1:a|s",
+        "d1:x|d", "d1:y|d", "d1:x|d",
+        NULL
+    },
+    {
+        "g1:+1|g", "g2:3|g", "g3:zinit|g",
+        "c1:1|c", "h1:3|h", "t1:200|ms",
+        "s1:c|s", "d1:x|d",
+        NULL
+    },
+};
+
+static void statsd_unittest_feed(STATSD_LOCAL *local, const char *prefix, size_t batch) {
+    char buffer[4096];
+    size_t len = 0;
+
+    for(size_t i = 0; statsd_unittest_batches[batch][i] ;i++)
+        len += snprintfz(&buffer[len], sizeof(buffer) - 1 - len, "%s.%s\n", prefix, statsd_unittest_batches[batch][i]);
+
+    statsd_process_buffer(local, buffer, len, 0);
+}
+
+static STATSD_METRIC *statsd_unittest_metric(STATSD_METRIC_TYPE type, const char *prefix, const char *name) {
+    char key[100];
+    snprintfz(key, sizeof(key), "%s.%s", prefix, name);
+    return (STATSD_METRIC *)dictionary_get(statsd_index_of_type(type)->dict, key);
+}
+
+static size_t statsd_unittest_check(STATSD_METRIC_TYPE type, const char *name, NETDATA_DOUBLE expected) {
+    STATSD_METRIC *d = statsd_unittest_metric(type, "direct", name);
+    STATSD_METRIC *l = statsd_unittest_metric(type, "local", name);
+
+    if(!d || !l) {
+        fprintf(stderr, "STATSD UNITTEST: metric '%s' of type %s is missing (direct %s, local %s)\n",
+                name, statsd_index_of_type(type)->name, d ? "found" : "missing", l ? "found" : "missing");
+        return 1;
+    }
+
+    NETDATA_DOUBLE dv = 0, lv = 0;
+    switch(type) {
+        case STATSD_METRIC_TYPE_GAUGE:
+            dv = d->gauge.value;
+            lv = l->gauge.value;
+            break;
+
+        case STATSD_METRIC_TYPE_COUNTER:
+        case STATSD_METRIC_TYPE_METER:
+            dv = (NETDATA_DOUBLE)d->counter.value;
+            lv = (NETDATA_DOUBLE)l->counter.value;
+            break;
+
+        case STATSD_METRIC_TYPE_HISTOGRAM:
+        case STATSD_METRIC_TYPE_TIMER: {
+            dv = (NETDATA_DOUBLE)d->histogram.ext->used;
+            lv = (NETDATA_DOUBLE)l->histogram.ext->used;
+
+            if(d->histogram.ext->used == l->histogram.ext->used &&
+                memcmp(d->histogram.ext->values, l->histogram.ext->values, sizeof(NETDATA_DOUBLE) * d->histogram.ext->used) != 0) {
+                fprintf(stderr, "STATSD UNITTEST: metric '%s' of type %s has different samples\n",
+                        name, statsd_index_of_type(type)->name);
+                return 1;
+            }
+            break;
+        }
+
+        case STATSD_METRIC_TYPE_SET:
+            dv = (NETDATA_DOUBLE)dictionary_entries(d->set.dict);
+            lv = (NETDATA_DOUBLE)dictionary_entries(l->set.dict);
+            break;
+
+        case STATSD_METRIC_TYPE_DICTIONARY: {
+            STATSD_METRIC_DICTIONARY_ITEM *t;
+            dfe_start_read(d->dictionary.dict, t) {
+                dv += (NETDATA_DOUBLE)t->count;
+
+                STATSD_METRIC_DICTIONARY_ITEM *lt = dictionary_get(l->dictionary.dict, t_dfe.name);
+                if(!lt || lt->count != t->count) {
+                    fprintf(stderr, "STATSD UNITTEST: metric '%s' of type %s has a different count for '%s'\n",
+                            name, statsd_index_of_type(type)->name, t_dfe.name);
+                    dv = NAN;
+                    break;
+                }
+            }
+            dfe_done(t);
+
+            dfe_start_read(l->dictionary.dict, t) {
+                lv += (NETDATA_DOUBLE)t->count;
+            }
+            dfe_done(t);
+            break;
+        }
+    }
+
+    size_t errors = 0;
+    if(!isfinite(dv) || !isfinite(lv) || dv != expected || lv != expected) {
+        fprintf(stderr, "STATSD UNITTEST: metric '%s' of type %s: expected " NETDATA_DOUBLE_FORMAT ", direct " NETDATA_DOUBLE_FORMAT ", local " NETDATA_DOUBLE_FORMAT "\n",
+                name, statsd_index_of_type(type)->name, expected, dv, lv);
+        errors++;
+    }
+
+    if(d->count != l->count || d->events != l->events) {
+        fprintf(stderr, "STATSD UNITTEST: metric '%s' of type %s: direct count %u events %lld, local count %u events %lld\n",
+                name, statsd_index_of_type(type)->name, d->count, (long long)d->events, l->count, (long long)l->events);
+        errors++;
+    }
+
+    return errors;
+}
+
+int statsd_unittest(void) {
+    statsd_indexes_create();
+
+    // the direct path, as a single collector thread does it
+    for(size_t b = 0; b < _countof(statsd_unittest_batches) ;b++)
+        statsd_unittest_feed(NULL, "direct", b);
+
+    // every batch is received by another collector thread, and the flushing
+    // thread merges them in order - the second merge adds to the first one
+    STATSD_LOCAL *locals[_countof(statsd_unittest_batches)];
+    for(size_t b = 0; b < _countof(statsd_unittest_batches) ;b++) {
+        locals[b] = statsd_local_create();
+        statsd_unittest_feed(locals[b], "local", b);
+    }
+
+    for(size_t b = 0; b < _countof(statsd_unittest_batches) ;b++)
+        statsd_local_merge(locals[b]);
+
+    size_t errors = 0;
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_GAUGE, "g1", 14);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_GAUGE, "g2", 3);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_GAUGE, "g3", 0);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_COUNTER, "c1", 9);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_METER, "m1", 4);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_HISTOGRAM, "h1", 6);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_TIMER, "t1", 2);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_SET, "s1", 3);
+    errors += statsd_unittest_check(STATSD_METRIC_TYPE_DICTIONARY, "d1", 4);
+
+    // a merged accumulator is empty and reusable for the next flush interval
+    for(size_t b = 0; b < _countof(statsd_unittest_batches) ;b++) {
+        STATSD_LOCAL_METRIC *lm;
+        for(size_t t = 0; t < STATSD_METRIC_TYPES ;t++) {
+            dfe_start_read(locals[b]->metrics[t], lm) {
+                if(lm->events || lm->count || (lm->type == STATSD_METRIC_TYPE_HISTOGRAM && lm->histogram.used)) {
+                    fprintf(stderr, "STATSD UNITTEST: local metric '%s' is not empty after merging\n", lm_dfe.name);
+                    errors++;
+                }
+            }
+            dfe_done(lm);
+        }
+
+        statsd_local_destroy(locals[b]);
+    }
+
+    fprintf(stderr, "STATSD UNITTEST: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// statsd load generator - netdata -W statsdbench
+
+struct statsd_benchmark_sender {
+    ND_THREAD *thread;
+    const char *destination;
+    size_t id;
+    size_t metrics;
+    usec_t stop_ut;
+
+    bool connected;
+    size_t packets;
+    size_t messages;
+    size_t errors;
+};
+
+static void statsd_benchmark_sender_thread(void *ptr) {
+    struct statsd_benchmark_sender *s = ptr;
+
+    struct timeval tv = { .tv_sec = 5, .tv_usec = 0 };
+    int fd = connect_to_this(s->destination, STATSD_LISTEN_PORT, &tv);
+    if(fd == -1) {
+        fprintf(stderr, "STATSD BENCHMARK: sender %zu cannot connect to '%s'\n", s->id, s->destination);
+        return;
+    }
+    s->connected = true;
+
+    char packet[1400 + 1];
+    size_t metric = 0, value = 0;
+
+    while(now_monotonic_usec() < s->stop_ut) {
+        // fill a packet up to a typical MTU, with counters, gauges and timers
+        size_t len = 0, messages = 0;
+        for(;;) {
+            char line[128];
+            size_t m = (s->id * 7919 + metric++) % s->metrics;
+            int n;
+
+            switch(m % 3) {
+                default:
+                case 0:
+                    n = snprintfz(line, sizeof(line), "statsd_bench.counter%zu:1|c\n", m);
+                    break;
+
+                case 1:
+                    n = snprintfz(line, sizeof(line), "statsd_bench.gauge%zu:%zu|g\n", m, value++ % 1000);
+                    break;
+
+                case 2:
+                    n = snprintfz(line, sizeof(line), "statsd_bench.timer%zu:%zu|ms\n", m, value++ % 500);
+                    break;
+            }
+
+            if(len + (size_t)n > sizeof(packet) - 1)
+                break;
+
+            memcpy(&packet[len], line, n);
+            len += n;
+            messages++;
+        }
+
+        if(send(fd, packet, len, 0) == (ssize_t)len) {
+            s->packets++;
+            s->messages += messages;
+        }
+        else
+            s->errors++;
+    }
+
+    close(fd);
+}
+
+#if defined(OS_LINUX)
+// the number of datagrams the kernel dropped because a UDP receive buffer was full
+static bool statsd_benchmark_udp_rcvbuf_errors(uint64_t *errors) {
+    FILE *fp = fopen("/proc/net/snmp", "r");
+    if(!fp) return false;
+
+    char header[1024], values[1024];
+    bool found = false;
+    while(!found && fgets(header, sizeof(header), fp) && fgets(values, sizeof(values), fp)) {
+        if(strncmp(header, "Udp: ", 5) != 0)
+            continue;
+
+        char *h_save = NULL, *v_save = NULL;
+        char *h = strtok_r(header, " \n", &h_save), *v = strtok_r(values, " \n", &v_save);
+        while(h && v) {
+            if(strcmp(h, "RcvbufErrors") == 0) {
+                *errors = strtoull(v, NULL, 10);
+                found = true;
+                break;
+            }
+            h = strtok_r(NULL, " \n", &h_save);
+            v = strtok_r(NULL, " \n", &v_save);
+        }
+    }
+
+    fclose(fp);
+    return found;
+}
+#endif
+
+int statsd_benchmark(const char *destination, size_t seconds, size_t threads, size_t metrics) {
+    if(!destination || !*destination) destination = "udp:localhost";
+    if(!seconds) seconds = 10;
+    if(!threads) threads = 1;
+    if(!metrics) metrics = 1000;
+
+    fprintf(stderr, "STATSD BENCHMARK: sending to '%s' for %zu seconds, from %zu threads, %zu unique metrics\n",
+            destination, seconds, threads, metrics);
+
+#if defined(OS_LINUX)
+    uint64_t rcvbuf_errors_before = 0, rcvbuf_errors_after = 0;
+    bool have_rcvbuf_errors = statsd_benchmark_udp_rcvbuf_errors(&rcvbuf_errors_before);
+#endif
+
+    struct statsd_benchmark_sender *senders = callocz(threads, sizeof(*senders));
+    usec_t started_ut = now_monotonic_usec();
+
+    for(size_t i = 0; i < threads ;i++) {
+        senders[i].destination = destination;
+        senders[i].id = i;
+        senders[i].metrics = metrics;
+        senders[i].stop_ut = started_ut + seconds * USEC_PER_SEC;
+
+        char tag[NETDATA_THREAD_TAG_MAX + 1];
+        snprintfz(tag, NETDATA_THREAD_TAG_MAX, "STATSDBENCH[%zu]", i);
+        senders[i].thread = nd_thread_create(tag, NETDATA_THREAD_OPTION_DONT_LOG, statsd_benchmark_sender_thread, &senders[i]);
+    }
+
+    size_t packets = 0, messages = 0, errors = 0, connected = 0;
+    for(size_t i = 0; i < threads ;i++) {
+        nd_thread_join(senders[i].thread);
+        connected += senders[i].connected ? 1 : 0;
+        packets += senders[i].packets;
+        messages += senders[i].messages;
+        errors += senders[i].errors;
+    }
+
+    double secs = (double)(now_monotonic_usec() - started_ut) / (double)USEC_PER_SEC;
+    freez(senders);
+
+    fprintf(stderr, "STATSD BENCHMARK: sent %zu messages in %zu packets (%zu send errors) in %0.2f seconds\n",
+            messages, packets, errors, secs);
+    fprintf(stderr, "STATSD BENCHMARK: %0.0f messages/s, %0.0f packets/s\n",
+            (double)messages / secs, (double)packets / secs);
+
+#if defined(OS_LINUX)
+    if(have_rcvbuf_errors && statsd_benchmark_udp_rcvbuf_errors(&rcvbuf_errors_after))
+        fprintf(stderr, "STATSD BENCHMARK: UDP datagrams dropped by the kernel on this host (all sockets): %"PRIu64" (%0.2f%% of the packets sent)\n",
+                rcvbuf_errors_after - rcvbuf_errors_before,
+                packets ? (double)(rcvbuf_errors_after - rcvbuf_errors_before) * 100.0 / (double)packets : 0.0);
+#endif
+
+    fprintf(stderr, "STATSD BENCHMARK: compare with the netdata.statsd_packets and netdata.statsd_events charts of the receiving agent\n");
+
+    if(connected != threads) {
+        fprintf(stderr, "STATSD BENCHMARK: FAILED - %zu of %zu senders could not connect to '%s'\n",
+                threads - connected, threads, destination);
+        return 1;
+    }
+
+    if(!packets) {
+        fprintf(stderr, "STATSD BENCHMARK: FAILED - no packets could be sent (%zu send errors)\n", errors);
+        return 1;
+    }
+
+    return 0;
+}
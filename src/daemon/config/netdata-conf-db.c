@@ -178,6 +178,8 @@ void netdata_conf_dbengine_init(const char *hostname) {
     // ----------------------------------------------------------------------------------------------------------------
 
     dbengine_use_direct_io = inicfg_get_boolean(&netdata_config, CONFIG_SECTION_DB, "dbengine use direct io", dbengine_use_direct_io);
+    dbengine_use_io_uring = inicfg_get_boolean(&netdata_config, CONFIG_SECTION_DB, "dbengine use io_uring", dbengine_use_io_uring);
+    dbengine_extent_lookahead = inicfg_get_boolean(&netdata_config, CONFIG_SECTION_DB, "dbengine extent look-ahead", dbengine_extent_lookahead);
     dbengine_journal_v2_unmount_time = inicfg_get_duration_seconds(&netdata_config, CONFIG_SECTION_DB, "dbengine journal v2 unmount time", nd_profile.dbengine_journal_v2_unmount_time);
 
     unsigned read_num = (unsigned)inicfg_get_number(&netdata_config, CONFIG_SECTION_DB, "dbengine pages per extent", DEFAULT_PAGES_PER_EXTENT);
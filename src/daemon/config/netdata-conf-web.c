@@ -2,6 +2,7 @@
 
 #include "netdata-conf-web.h"
 #include "daemon/static_threads.h"
+#include "web/api/queries/query-cache.h"
 
 size_t netdata_conf_web_query_threads(void) {
     // See https://github.com/netdata/netdata/issues/11081#issuecomment-831998240 for more details
@@ -112,6 +113,11 @@ void netdata_conf_section_web(void) {
     web_allow_mgmt_dns         =
         make_dns_decision(CONFIG_SECTION_WEB, "allow management by dns","heuristic",web_allow_mgmt_from);
 
+    query_cache_enabled = inicfg_get_boolean(&netdata_config, CONFIG_SECTION_WEB, "data query cache", query_cache_enabled);
+    query_cache_max_size = inicfg_get_size_mb(&netdata_config, CONFIG_SECTION_WEB, "data query cache size", query_cache_max_size / 1024 / 1024) * 1024 * 1024;
+    query_cache_max_age_s = inicfg_get_duration_seconds(&netdata_config, CONFIG_SECTION_WEB, "data query cache max age", query_cache_max_age_s);
+    if(query_cache_max_age_s < 1) query_cache_max_age_s = 1;
+
     web_enable_gzip = inicfg_get_boolean(&netdata_config, CONFIG_SECTION_WEB, "enable gzip compression", web_enable_gzip);
 
     const char *s = inicfg_get(&netdata_config, CONFIG_SECTION_WEB, "gzip compression strategy", "default");
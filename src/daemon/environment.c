@@ -71,6 +71,7 @@ void set_environment_for_plugins_and_scripts(void) {
     nd_setenv("NETDATA_VERSION", NETDATA_VERSION, 1);
     nd_setenv("NETDATA_HOSTNAME", netdata_configured_hostname, 1);
     nd_setenv("NETDATA_HOST_PREFIX", netdata_configured_host_prefix, 1);
+    nd_setenv("NETDATA_PLUGINSD_EXTENSIONS", PLUGINSD_KEYWORD_SET_BLOCK, 1);
 
     verify_required_directory("NETDATA_CONFIG_DIR", netdata_configured_user_config_dir, false, 0);
     verify_required_directory("NETDATA_USER_CONFIG_DIR", netdata_configured_user_config_dir, false, 0);
@@ -154,6 +154,10 @@ int help(int exitcode) {
             "                           size of E MiB, an optional disk space limit\n"
             "                           of F MiB, G libuv workers (default 16) and exit.\n\n"
 #endif
+            "  -W statsdbench=A,B,C,D   Send statsd metrics for A seconds (default 10),\n"
+            "                           from B threads (default 1), with C unique\n"
+            "                           metrics (default 1000), to destination D\n"
+            "                           (default udp:localhost:8125) and exit.\n\n"
             "  -W set section option value\n"
             "                           set netdata.conf option from the command line.\n\n"
             "  -W buildinfo             Print the version, the configure options,\n"
@@ -219,6 +223,19 @@ int progress_unittest(void);
 int dyncfg_unittest(void);
 int eval_unittest(void);
 int duration_unittest(void);
+int query_parallel_unittest(void);
+int statsd_unittest(void);
+int web_client_static_files_unittest(void);
+int rrdcol_unittest(void);
+int query_cache_unittest(void);
+int stream_zstd_dictionary_unittest(void);
+int stream_receiver_parallel_unittest(void);
+int replication_unittest(void);
+int contexts_v2_unittest(void);
+int health_unittest(void);
+int exporting_stored_data_unittest(void);
+int prometheus_unittest(void);
+int statsd_benchmark(const char *destination, size_t seconds, size_t threads, size_t metrics);
 bool netdata_random_session_id_generate(void);
 
 #ifdef OS_WINDOWS
@@ -342,6 +359,7 @@ int netdata_main(int argc, char **argv) {
                     {
                         char* stacksize_string = "stacksize=";
                         char* debug_flags_string = "debug_flags=";
+                        char* statsdbench_string = "statsdbench=";
 #ifdef ENABLE_DBENGINE
                         char* createdataset_string = "createdataset=";
                         char* stresstest_string = "stresstest=";
@@ -389,6 +407,7 @@ int netdata_main(int argc, char **argv) {
                             if (unit_test_buffer()) return 1;
                             if (unit_test_str2ld()) return 1;
                             if (buffer_unittest()) return 1;
+                            if (query_parallel_unittest()) return 1;
 
                             // No call to load the config file on this code-path
                             if (unittest_prepare_rrd(&user)) return 1;
@@ -527,6 +546,68 @@ int netdata_main(int argc, char **argv) {
                             unittest_running = true;
                             return duration_unittest();
                         }
+                        else if(strcmp(optarg, "queryparalleltest") == 0) {
+                            unittest_running = true;
+                            return query_parallel_unittest();
+                        }
+                        else if(strcmp(optarg, "statsdtest") == 0) {
+                            unittest_running = true;
+                            return statsd_unittest();
+                        }
+                        else if(strcmp(optarg, "webstaticfilestest") == 0) {
+                            unittest_running = true;
+                            return web_client_static_files_unittest();
+                        }
+                        else if(strcmp(optarg, "columnartest") == 0) {
+                            unittest_running = true;
+                            return rrdcol_unittest();
+                        }
+                        else if(strcmp(optarg, "querycachetest") == 0) {
+                            unittest_running = true;
+                            return query_cache_unittest();
+                        }
+                        else if(strcmp(optarg, "zstddicttest") == 0) {
+                            unittest_running = true;
+                            return stream_zstd_dictionary_unittest();
+                        }
+                        else if(strcmp(optarg, "mltest") == 0) {
+                            unittest_running = true;
+                            return ml_unittest();
+                        }
+                        else if(strcmp(optarg, "streamparalleltest") == 0) {
+                            unittest_running = true;
+                            if(unittest_prepare_rrd(&user))
+                                return 1;
+                            return stream_receiver_parallel_unittest();
+                        }
+                        else if(strcmp(optarg, "replicationtest") == 0) {
+                            unittest_running = true;
+                            return replication_unittest();
+                        }
+                        else if(strcmp(optarg, "contextsv2test") == 0) {
+                            unittest_running = true;
+                            if(unittest_prepare_rrd(&user))
+                                return 1;
+                            return contexts_v2_unittest();
+                        }
+                        else if(strcmp(optarg, "healthtest") == 0) {
+                            unittest_running = true;
+                            if(unittest_prepare_rrd(&user))
+                                return 1;
+                            return health_unittest();
+                        }
+                        else if(strcmp(optarg, "exportingtest") == 0) {
+                            unittest_running = true;
+                            if(unittest_prepare_rrd(&user))
+                                return 1;
+                            return exporting_stored_data_unittest();
+                        }
+                        else if(strcmp(optarg, "prometheustest") == 0) {
+                            unittest_running = true;
+                            if(unittest_prepare_rrd(&user))
+                                return 1;
+                            return prometheus_unittest();
+                        }
                         else if(strcmp(optarg, "dyncfgtest") == 0) {
                             unittest_running = true;
                             if(unittest_prepare_rrd(&user))
@@ -578,6 +659,21 @@ int netdata_main(int argc, char **argv) {
                             return 0;
                         }
 #endif
+                        else if(strncmp(optarg, statsdbench_string, strlen(statsdbench_string)) == 0) {
+                            char *endptr = optarg + strlen(statsdbench_string);
+                            size_t seconds = 0, threads = 0, metrics = 0;
+                            const char *destination = NULL;
+
+                            seconds = (size_t)strtoul(endptr, &endptr, 0);
+                            if (',' == *endptr)
+                                threads = (size_t)strtoul(endptr + 1, &endptr, 0);
+                            if (',' == *endptr)
+                                metrics = (size_t)strtoul(endptr + 1, &endptr, 0);
+                            if (',' == *endptr)
+                                destination = endptr + 1;
+
+                            return statsd_benchmark(destination, seconds, threads, metrics);
+                        }
                         else if(strcmp(optarg, "simple-pattern") == 0) {
                             if(optind + 2 > argc) {
                                 fprintf(stderr, "%s", "\nUSAGE: -W simple-pattern 'pattern' 'string'\n\n"
@@ -1212,6 +1212,7 @@ void pulse_dbengine_do(bool extended) {
         static RRDDIM *rd_cancelled = NULL;
         static RRDDIM *rd_invalid_extent = NULL;
         static RRDDIM *rd_extent_merged = NULL;
+        static RRDDIM *rd_lookahead = NULL;
 
         if (unlikely(!st_query_pages_from_disk)) {
             st_query_pages_from_disk = rrdset_create_localhost(
@@ -1238,6 +1239,7 @@ void pulse_dbengine_do(bool extended) {
             rd_invalid_extent = rrddim_add(st_query_pages_from_disk, "fail invalid extent", NULL, -1, 1, RRD_ALGORITHM_INCREMENTAL);
             rd_extent_merged = rrddim_add(st_query_pages_from_disk, "extent merged", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
             rd_cancelled = rrddim_add(st_query_pages_from_disk, "cancelled", NULL, -1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_lookahead = rrddim_add(st_query_pages_from_disk, "look-ahead", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
         }
         priority++;
 
@@ -1251,6 +1253,7 @@ void pulse_dbengine_do(bool extended) {
         rrddim_set_by_pointer(st_query_pages_from_disk, rd_cancelled, (collected_number)cache_efficiency_stats.pages_load_fail_cancelled);
         rrddim_set_by_pointer(st_query_pages_from_disk, rd_invalid_extent, (collected_number)cache_efficiency_stats.pages_load_fail_invalid_extent);
         rrddim_set_by_pointer(st_query_pages_from_disk, rd_extent_merged, (collected_number)cache_efficiency_stats.pages_load_extent_merged);
+        rrddim_set_by_pointer(st_query_pages_from_disk, rd_lookahead, (collected_number)cache_efficiency_stats.pages_load_ok_lookahead);
 
         rrdset_done(st_query_pages_from_disk);
     }
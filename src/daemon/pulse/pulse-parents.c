@@ -2,6 +2,7 @@
 
 #define PULSE_INTERNALS
 #include "pulse.h"
+#include "streaming/stream-compression/compression.h"
 
 DEFINE_JUDYL_TYPED(PHOST, PULSE_HOST_STATUS);
 
@@ -330,7 +331,103 @@ static void chart_by_reason(struct by_reason *b, const char *id, const char *con
     rrdset_done(b->st);
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// stream compression, per algorithm
+
+struct compression_dims {
+    STREAM_COMPRESSION_STATISTICS last;
+    RRDDIM *rd_savings;
+    RRDDIM *rd_cpu;
+};
+
+static void compression_dims_set(RRDSET *st_savings, RRDSET *st_cpu, struct compression_dims *d, STREAM_COMPRESSION_STATISTICS *now, const char *name) {
+    uint64_t uncompressed = now->bytes_uncompressed - d->last.bytes_uncompressed;
+    uint64_t compressed = now->bytes_compressed - d->last.bytes_compressed;
+    uint64_t usec = now->usec - d->last.usec;
+    d->last = *now;
+
+    if(!uncompressed)
+        return;
+
+    if(!d->rd_savings) {
+        d->rd_savings = rrddim_add(st_savings, name, NULL, 1, 100, RRD_ALGORITHM_ABSOLUTE);
+        d->rd_cpu = rrddim_add(st_cpu, name, NULL, 1, 100, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    // the percentage of bytes saved, and the CPU time spent per MiB of uncompressed traffic
+    collected_number savings = compressed >= uncompressed ? 0 : (collected_number)(10000 - compressed * 10000 / uncompressed);
+    collected_number cpu = (collected_number)(usec * 100 * 1024 * 1024 / uncompressed);
+
+    rrddim_set_by_pointer(st_savings, d->rd_savings, savings);
+    rrddim_set_by_pointer(st_cpu, d->rd_cpu, cpu);
+}
+
+static void pulse_stream_compression_do(bool extended __maybe_unused) {
+    static RRDSET *st_savings = NULL, *st_cpu = NULL;
+    static struct {
+        struct compression_dims compress;
+        struct compression_dims decompress;
+    } dims[COMPRESSION_ALGORITHM_MAX] = { 0 };
+
+    STREAM_COMPRESSION_STATISTICS compress[COMPRESSION_ALGORITHM_MAX], decompress[COMPRESSION_ALGORITHM_MAX];
+    uint64_t operations = 0;
+    for(compression_algorithm_t a = COMPRESSION_ALGORITHM_NONE + 1; a < COMPRESSION_ALGORITHM_MAX ;a++) {
+        stream_compression_statistics(a, &compress[a], &decompress[a]);
+        operations += compress[a].operations + decompress[a].operations;
+    }
+
+    // nothing to show until this agent streams compressed
+    if(!operations)
+        return;
+
+    if(unlikely(!st_savings)) {
+        st_savings = rrdset_create_localhost(
+            "netdata"
+            , "streaming_compression_savings"
+            , NULL
+            , "Streaming"
+            , "netdata.streaming_compression_savings"
+            , "Streaming Compression Savings"
+            , "percentage"
+            , "netdata"
+            , "pulse"
+            , 130155
+            , localhost->rrd_update_every
+            , RRDSET_TYPE_LINE
+        );
+
+        st_cpu = rrdset_create_localhost(
+            "netdata"
+            , "streaming_compression_cpu"
+            , NULL
+            , "Streaming"
+            , "netdata.streaming_compression_cpu"
+            , "Streaming Compression CPU Time per MiB"
+            , "microseconds/MiB"
+            , "netdata"
+            , "pulse"
+            , 130156
+            , localhost->rrd_update_every
+            , RRDSET_TYPE_LINE
+        );
+    }
+
+    for(compression_algorithm_t a = COMPRESSION_ALGORITHM_NONE + 1; a < COMPRESSION_ALGORITHM_MAX ;a++) {
+        char name[64];
+        snprintfz(name, sizeof(name), "%s compress", stream_compression_algorithm_name(a));
+        compression_dims_set(st_savings, st_cpu, &dims[a].compress, &compress[a], name);
+
+        snprintfz(name, sizeof(name), "%s decompress", stream_compression_algorithm_name(a));
+        compression_dims_set(st_savings, st_cpu, &dims[a].decompress, &decompress[a], name);
+    }
+
+    rrdset_done(st_savings);
+    rrdset_done(st_cpu);
+}
+
 void pulse_parents_do(bool extended) {
+    pulse_stream_compression_do(extended);
+
     if(netdata_conf_is_parent()) {
         for(size_t idx = 0; idx < _countof(p.parent.type) ; idx++) {
             if (unlikely(!p.parent.type[idx].st_nodes)) {
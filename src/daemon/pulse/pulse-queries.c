@@ -8,6 +8,8 @@ static struct query_statistics {
     PAD64(uint64_t) api_data_queries_made;
     PAD64(uint64_t) api_data_db_points_read;
     PAD64(uint64_t) api_data_result_points_generated;
+    PAD64(uint64_t) api_data_cache_hits;
+    PAD64(uint64_t) api_data_cache_misses;
 
     PAD64(uint64_t) api_weights_queries_made;
     PAD64(uint64_t) api_weights_db_points_read;
@@ -47,6 +49,14 @@ ALWAYS_INLINE void pulse_queries_backfill_query_completed(size_t points_read) {
     __atomic_fetch_add(&query_statistics.backfill_db_points_read, points_read, __ATOMIC_RELAXED);
 }
 
+ALWAYS_INLINE void pulse_queries_api_data_cache_hit(void) {
+    __atomic_fetch_add(&query_statistics.api_data_cache_hits, 1, __ATOMIC_RELAXED);
+}
+
+ALWAYS_INLINE void pulse_queries_api_data_cache_miss(void) {
+    __atomic_fetch_add(&query_statistics.api_data_cache_misses, 1, __ATOMIC_RELAXED);
+}
+
 ALWAYS_INLINE void pulse_queries_rrdr_query_completed(size_t queries, uint64_t db_points_read, uint64_t result_points_generated, QUERY_SOURCE query_source) {
     switch(query_source) {
         case QUERY_SOURCE_API_DATA:
@@ -90,6 +100,8 @@ static inline void pulse_queries_copy(struct query_statistics *gs) {
     gs->api_data_queries_made            = __atomic_load_n(&query_statistics.api_data_queries_made, __ATOMIC_RELAXED);
     gs->api_data_db_points_read          = __atomic_load_n(&query_statistics.api_data_db_points_read, __ATOMIC_RELAXED);
     gs->api_data_result_points_generated = __atomic_load_n(&query_statistics.api_data_result_points_generated, __ATOMIC_RELAXED);
+    gs->api_data_cache_hits              = __atomic_load_n(&query_statistics.api_data_cache_hits, __ATOMIC_RELAXED);
+    gs->api_data_cache_misses            = __atomic_load_n(&query_statistics.api_data_cache_misses, __ATOMIC_RELAXED);
 
     gs->api_weights_queries_made            = __atomic_load_n(&query_statistics.api_weights_queries_made, __ATOMIC_RELAXED);
     gs->api_weights_db_points_read          = __atomic_load_n(&query_statistics.api_weights_db_points_read, __ATOMIC_RELAXED);
@@ -259,4 +271,35 @@ void pulse_queries_do(bool extended __maybe_unused) {
 
         rrdset_done(st_points_generated);
     }
+
+    if(gs.api_data_cache_hits || gs.api_data_cache_misses) {
+        static RRDSET *st_cache = NULL;
+        static RRDDIM *rd_hits = NULL;
+        static RRDDIM *rd_misses = NULL;
+
+        if (unlikely(!st_cache)) {
+            st_cache = rrdset_create_localhost(
+                "netdata"
+                , "api_data_cache"
+                , NULL
+                , "Time-Series Queries"
+                , NULL
+                , "Netdata /api/vX/data Query Cache"
+                , "queries/s"
+                , "netdata"
+                , "pulse"
+                , 131006
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_STACKED
+            );
+
+            rd_hits = rrddim_add(st_cache, "hits", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_misses = rrddim_add(st_cache, "misses", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+
+        rrddim_set_by_pointer(st_cache, rd_hits, (collected_number)gs.api_data_cache_hits);
+        rrddim_set_by_pointer(st_cache, rd_misses, (collected_number)gs.api_data_cache_misses);
+
+        rrdset_done(st_cache);
+    }
 }
@@ -8,6 +8,8 @@
 void pulse_queries_ml_query_completed(size_t points_read);
 void pulse_queries_exporters_query_completed(size_t points_read);
 void pulse_queries_backfill_query_completed(size_t points_read);
+void pulse_queries_api_data_cache_hit(void);
+void pulse_queries_api_data_cache_miss(void);
 void pulse_queries_rrdr_query_completed(size_t queries, uint64_t db_points_read, uint64_t result_points_generated, QUERY_SOURCE query_source);
 
 #if defined(PULSE_INTERNALS)
@@ -2,6 +2,8 @@
 
 #include "common.h"
 #include "web/api/queries/backfill.h"
+#include "web/api/queries/query-parallel.h"
+#include "streaming/stream-receiver-parallel.h"
 
 #ifdef ENABLE_SYSTEMD_DBUS
 #include "daemon-systemd-watcher.h"
@@ -182,6 +184,26 @@ const struct netdata_static_thread static_threads_common[] = {
         .init_routine = NULL,
         .start_routine = backfill_thread
     },
+    {
+        .name = "QUERYPAR",
+        .config_section = CONFIG_SECTION_DB,
+        .config_name = "parallel queries",
+        .enable_routine = netdata_conf_is_parent,
+        .enabled = 0,
+        .thread = NULL,
+        .init_routine = NULL,
+        .start_routine = query_parallel_thread
+    },
+    {
+        .name = "STREAMPAR",
+        .config_section = CONFIG_SECTION_DB,
+        .config_name = "parallel stream parsing",
+        .enable_routine = netdata_conf_is_parent,
+        .enabled = 0,
+        .thread = NULL,
+        .init_routine = NULL,
+        .start_routine = stream_receiver_parallel_thread
+    },
 
 #ifdef ENABLE_SYSTEMD_DBUS
     {
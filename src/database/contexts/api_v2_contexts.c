@@ -179,6 +179,31 @@ struct fts_search_results {
     RRDLABELS_AGGREGATED *matched_labels;
 };
 
+// without a window all the metrics of the context match, so the metrics index of the
+// context can be used instead of walking them - with a window, metrics without retention
+// in it have to be filtered out, even when the window covers the retention of the context
+static inline bool rrdcontext_to_json_v2_can_use_metrics_index(struct rrdcontext_to_json_v2_data *ctl) {
+    return !ctl->window.enabled;
+}
+
+struct fts_metrics_index_data {
+    struct rrdcontext_to_json_v2_data *ctl;
+    SIMPLE_PATTERN *q;
+    struct fts_search_results *results;
+};
+
+static void rrdcontext_to_json_v2_full_text_search_metric(STRING *id, STRING *name, void *data) {
+    struct fts_metrics_index_data *d = data;
+
+    if(unlikely(full_text_search_string(&d->ctl->q.fts, d->q, id)) ||
+       (name != id && full_text_search_string(&d->ctl->q.fts, d->q, name))) {
+        if(!d->results->matched_dimensions)
+            d->results->matched_dimensions = dictionary_create_advanced(DICT_OPTION_SINGLE_THREADED | DICT_OPTION_DONT_OVERWRITE_VALUE, NULL, 0);
+        dictionary_set(d->results->matched_dimensions, string2str(name), NULL, 0);
+        d->results->matched_types |= SEARCH_MATCH_DIMENSION;
+    }
+}
+
 static void rrdcontext_to_json_v2_full_text_search(struct rrdcontext_to_json_v2_data *ctl, RRDCONTEXT *rc, SIMPLE_PATTERN *q, struct fts_search_results *results) {
     // Initialize results
     results->matched_types = SEARCH_MATCH_NONE;
@@ -207,7 +232,20 @@ static void rrdcontext_to_json_v2_full_text_search(struct rrdcontext_to_json_v2_
         results->matched_types |= SEARCH_MATCH_CONTEXT_UNITS;
     }
 
-    
+    bool search_dimensions = (ctl->options & CONTEXTS_OPTION_DIMENSIONS);
+    if(search_dimensions && rrdcontext_to_json_v2_can_use_metrics_index(ctl)) {
+        struct fts_metrics_index_data d = {
+            .ctl = ctl,
+            .q = q,
+            .results = results,
+        };
+        rrdcontext_metrics_index_foreach(rc, rrdcontext_to_json_v2_full_text_search_metric, &d);
+        search_dimensions = false;
+    }
+
+    if(!search_dimensions && !(ctl->options & (CONTEXTS_OPTION_INSTANCES | CONTEXTS_OPTION_LABELS)))
+        return;
+
     RRDINSTANCE *ri;
     dfe_start_read(rc->rrdinstances, ri) {
         if(ctl->window.enabled && !query_matches_retention(ctl->window.after, ctl->window.before, ri->first_time_s, (ri->flags & RRD_FLAG_COLLECTED) ? ctl->now : ri->last_time_s, 0))
@@ -223,8 +261,8 @@ static void rrdcontext_to_json_v2_full_text_search(struct rrdcontext_to_json_v2_
             results->matched_types |= SEARCH_MATCH_INSTANCE;
         }
 
-        // Check dimensions only if dimensions option is enabled
-        if(ctl->options & CONTEXTS_OPTION_DIMENSIONS) {
+        // Check dimensions only if dimensions option is enabled, and the metrics index could not be used
+        if(search_dimensions) {
             RRDMETRIC *rm;
             dfe_start_read(ri->rrdmetrics, rm) {
                 if(ctl->window.enabled && !query_matches_retention(ctl->window.after, ctl->window.before, rm->first_time_s, (rm->flags & RRD_FLAG_COLLECTED) ? ctl->now : rm->last_time_s, 0))
@@ -884,6 +922,11 @@ static bool contexts_conflict_callback(const DICTIONARY_ITEM *item __maybe_unuse
     return true;
 }
 
+static void contexts_dimensions_from_metrics_index(STRING *id __maybe_unused, STRING *name, void *data) {
+    DICTIONARY *dimensions_dict = data;
+    dictionary_set(dimensions_dict, string2str(name), NULL, 0);
+}
+
 static void contexts_react_callback(const DICTIONARY_ITEM *item __maybe_unused, void *value, void *data) {
     struct context_v2_entry *t = value;
     struct rrdcontext_to_json_v2_data *ctl = data;
@@ -907,6 +950,15 @@ static void contexts_react_callback(const DICTIONARY_ITEM *item __maybe_unused,
 
     RRDCONTEXT *rc = t->rc;
 
+    DICTIONARY *dimensions_dict = t->dimensions_dict;
+    if(dimensions_dict && rrdcontext_to_json_v2_can_use_metrics_index(ctl)) {
+        rrdcontext_metrics_index_foreach(rc, contexts_dimensions_from_metrics_index, dimensions_dict);
+        dimensions_dict = NULL;
+    }
+
+    if(!dimensions_dict && !t->instances_dict && !t->labels_aggregated)
+        return;
+
     // Collect instances, dimensions, and labels if requested
     RRDINSTANCE *ri;
     dfe_start_read(rc->rrdinstances, ri) {
@@ -919,13 +971,13 @@ static void contexts_react_callback(const DICTIONARY_ITEM *item __maybe_unused,
         }
 
         // Collect dimensions from this instance
-        if(t->dimensions_dict) {
+        if(dimensions_dict) {
             RRDMETRIC *rm;
             dfe_start_read(ri->rrdmetrics, rm) {
                 if(ctl->window.enabled && !query_matches_retention(ctl->window.after, ctl->window.before, rm->first_time_s, (rm->flags & RRD_FLAG_COLLECTED) ? ctl->now : rm->last_time_s, (time_t)ri->update_every_s))
                     continue;
 
-                dictionary_set(t->dimensions_dict, string2str(rm->name), NULL, 0);
+                dictionary_set(dimensions_dict, string2str(rm->name), NULL, 0);
             }
             dfe_done(rm);
         }
@@ -1484,3 +1536,241 @@ cleanup:
     json_keys_reset();
     return resp;
 }
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#define CONTEXTS_V2_UNITTEST_CONTEXT "unittest.metrics_index"
+#define CONTEXTS_V2_UNITTEST_CHARTS 5
+
+#define CONTEXTS_V2_UNITTEST_ORDER_CONTEXT "unittest.metrics_index_order"
+#define CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS 20
+#define CONTEXTS_V2_UNITTEST_ORDER_LIMIT 10
+
+// the unique dimension names of the unittest context, found by walking the charts of the host
+static DICTIONARY *contexts_v2_unittest_expected_dimensions(RRDHOST *host) {
+    DICTIONARY *names = dictionary_create(DICT_OPTION_SINGLE_THREADED | DICT_OPTION_DONT_OVERWRITE_VALUE);
+    bool exists = true;
+
+    RRDSET *st;
+    rrdset_foreach_read(st, host) {
+        if(strcmp(rrdset_context(st), CONTEXTS_V2_UNITTEST_CONTEXT) != 0)
+            continue;
+
+        RRDDIM *rd;
+        rrddim_foreach_read(rd, st) {
+            dictionary_set(names, rrddim_name(rd), &exists, sizeof(exists));
+        }
+        rrddim_foreach_done(rd);
+    }
+    rrdset_foreach_done(st);
+
+    return names;
+}
+
+static struct json_object *contexts_v2_unittest_request(RRDHOST *host, CONTEXTS_V2_MODE mode, const char *context, const char *q, size_t cardinality_limit) {
+    struct api_v2_contexts_request req = {
+        .scope_nodes = rrdhost_hostname(host),
+        .scope_contexts = context,
+        .q = q,
+        .options = CONTEXTS_OPTION_DIMENSIONS | CONTEXTS_OPTION_MINIFY,
+        .cardinality_limit = cardinality_limit,
+    };
+
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+    if(rrdcontext_to_json_v2(wb, &req, mode) != HTTP_RESP_OK)
+        return NULL;
+
+    return json_tokener_parse(buffer_tostring(wb));
+}
+
+// the object of a unittest context in the response, or NULL when it is not there
+static struct json_object *contexts_v2_unittest_context(struct json_object *jobj, const char *id) {
+    struct json_object *contexts, *context;
+
+    if(!jobj ||
+        !json_object_object_get_ex(jobj, "contexts", &contexts) ||
+        !json_object_is_type(contexts, json_type_object) ||
+        !json_object_object_get_ex(contexts, id, &context))
+        return NULL;
+
+    return context;
+}
+
+static size_t contexts_v2_unittest_check_dimensions(RRDHOST *host, const char *step) {
+    size_t errors = 0;
+    DICTIONARY *expected = contexts_v2_unittest_expected_dimensions(host);
+
+    CLEAN_JSON_OBJECT *jobj = contexts_v2_unittest_request(host, CONTEXTS_V2_CONTEXTS, CONTEXTS_V2_UNITTEST_CONTEXT, NULL, 0);
+    struct json_object *context = contexts_v2_unittest_context(jobj, CONTEXTS_V2_UNITTEST_CONTEXT);
+    struct json_object *dimensions = NULL;
+
+    if(!context ||
+        !json_object_object_get_ex(context, "dimensions", &dimensions) ||
+        !json_object_is_type(dimensions, json_type_array)) {
+        fprintf(stderr, " >>> CONTEXTS V2: %s: the response has no dimensions for context '%s'\n",
+                step, CONTEXTS_V2_UNITTEST_CONTEXT);
+        dictionary_destroy(expected);
+        return 1;
+    }
+
+    size_t len = json_object_array_length(dimensions);
+    if(len != dictionary_entries(expected)) {
+        fprintf(stderr, " >>> CONTEXTS V2: %s: the response has %zu dimensions, expected %zu\n",
+                step, len, dictionary_entries(expected));
+        errors++;
+    }
+
+    for(size_t i = 0; i < len; i++) {
+        const char *name = json_object_get_string(json_object_array_get_idx(dimensions, i));
+        if(!name || !dictionary_get(expected, name)) {
+            fprintf(stderr, " >>> CONTEXTS V2: %s: the response has dimension '%s', which is not collected\n",
+                    step, name ? name : "(null)");
+            errors++;
+        }
+    }
+
+    dictionary_destroy(expected);
+    return errors;
+}
+
+static size_t contexts_v2_unittest_check_search(RRDHOST *host, const char *step, const char *q, bool expected) {
+    CLEAN_JSON_OBJECT *jobj = contexts_v2_unittest_request(host, CONTEXTS_V2_SEARCH, CONTEXTS_V2_UNITTEST_CONTEXT, q, 0);
+    bool found = (contexts_v2_unittest_context(jobj, CONTEXTS_V2_UNITTEST_CONTEXT) != NULL);
+
+    if(found != expected) {
+        fprintf(stderr, " >>> CONTEXTS V2: %s: searching for '%s' %s context '%s'\n",
+                step, q, found ? "found" : "did not find", CONTEXTS_V2_UNITTEST_CONTEXT);
+        return 1;
+    }
+
+    return 0;
+}
+
+// the dimensions truncated by the cardinality limit are the ones added last, not the ones with
+// the highest addresses - the names are interned in the opposite order they are added to the charts
+static size_t contexts_v2_unittest_check_order(RRDHOST *host) {
+    size_t errors = 0;
+    char name[50];
+
+    STRING *interned[CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS];
+    for(size_t d = 0; d < CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS; d++) {
+        snprintfz(name, sizeof(name), "ordered_%02zu", d);
+        interned[d] = string_strdupz(name);
+    }
+
+    // the first chart adds them in reverse, the second one in order, which does not change their order
+    for(size_t c = 0; c < 2; c++) {
+        char id[50];
+        snprintfz(id, sizeof(id), "metrics_index_order_%zu", c);
+
+        RRDSET *st = rrdset_create(host, "unittest", id, NULL, "unittest", CONTEXTS_V2_UNITTEST_ORDER_CONTEXT,
+                                   "Unittest", "units", "unittest", "unittest", 2000 + c, 1, RRDSET_TYPE_LINE);
+
+        for(size_t i = 0; i < CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS; i++) {
+            size_t d = c ? i : CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS - 1 - i;
+            rrddim_add(st, string2str(interned[d]), NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+    }
+
+    for(size_t d = 0; d < CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS; d++)
+        string_freez(interned[d]);
+
+    CLEAN_JSON_OBJECT *jobj = contexts_v2_unittest_request(
+        host, CONTEXTS_V2_CONTEXTS, CONTEXTS_V2_UNITTEST_ORDER_CONTEXT, NULL, CONTEXTS_V2_UNITTEST_ORDER_LIMIT);
+    struct json_object *context = contexts_v2_unittest_context(jobj, CONTEXTS_V2_UNITTEST_ORDER_CONTEXT);
+    struct json_object *dimensions = NULL;
+
+    if(!context ||
+        !json_object_object_get_ex(context, "dimensions", &dimensions) ||
+        !json_object_is_type(dimensions, json_type_array)) {
+        fprintf(stderr, " >>> CONTEXTS V2: order: the response has no dimensions for context '%s'\n",
+                CONTEXTS_V2_UNITTEST_ORDER_CONTEXT);
+        return 1;
+    }
+
+    size_t len = json_object_array_length(dimensions);
+    if(len != CONTEXTS_V2_UNITTEST_ORDER_LIMIT) {
+        fprintf(stderr, " >>> CONTEXTS V2: order: the response has %zu dimensions, expected %d\n",
+                len, CONTEXTS_V2_UNITTEST_ORDER_LIMIT);
+        return 1;
+    }
+
+    for(size_t i = 0; i < len; i++) {
+        if(i < len - 1)
+            snprintfz(name, sizeof(name), "ordered_%02zu", (size_t)(CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS - 1 - i));
+        else
+            snprintfz(name, sizeof(name), "... %zu dimensions more",
+                      (size_t)(CONTEXTS_V2_UNITTEST_ORDER_DIMENSIONS - (CONTEXTS_V2_UNITTEST_ORDER_LIMIT - 1)));
+
+        const char *got = json_object_get_string(json_object_array_get_idx(dimensions, i));
+        if(!got || strcmp(got, name) != 0) {
+            fprintf(stderr, " >>> CONTEXTS V2: order: dimension %zu is '%s', expected '%s'\n",
+                    i, got ? got : "(null)", name);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int contexts_v2_unittest(void) {
+    size_t errors = 0;
+
+    nd_uuid_t uuid;
+    char guid[UUID_STR_LEN];
+    uuid_generate(uuid);
+    uuid_unparse_lower(uuid, guid);
+
+    RRDHOST *host = rrdhost_find_or_create(
+        "unittest-contexts-v2", "unittest-contexts-v2", guid, os_type,
+        netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+        program_name, NETDATA_VERSION,
+        1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+        false, false, NULL, NULL, NULL,
+        false, 0, 0, NULL, false);
+
+    if(!host) {
+        fprintf(stderr, "CONTEXTS V2: FAILED (cannot create host)\n");
+        return 1;
+    }
+
+    // the instances of the context share most of their dimensions
+    RRDSET *st[CONTEXTS_V2_UNITTEST_CHARTS];
+    RRDDIM *rd_renamed = NULL;
+    for(size_t c = 0; c < CONTEXTS_V2_UNITTEST_CHARTS; c++) {
+        char id[50];
+        snprintfz(id, sizeof(id), "metrics_index_%zu", c);
+
+        st[c] = rrdset_create(host, "unittest", id, NULL, "unittest", CONTEXTS_V2_UNITTEST_CONTEXT,
+                              "Unittest", "units", "unittest", "unittest", 1000 + c, 1, RRDSET_TYPE_LINE);
+
+        rrddim_add(st[c], "shared_a", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rrddim_add(st[c], "shared_b", "shared_b_name", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+        if(c == 1)
+            rrddim_add(st[c], "only_here", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+        if(c == 2)
+            rd_renamed = rrddim_add(st[c], "renamed", "before_rename", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    errors += contexts_v2_unittest_check_dimensions(host, "initial");
+    errors += contexts_v2_unittest_check_search(host, "initial", "only_here", true);
+    errors += contexts_v2_unittest_check_search(host, "initial", "shared_b_name", true);
+    errors += contexts_v2_unittest_check_search(host, "initial", "before_rename", true);
+    errors += contexts_v2_unittest_check_search(host, "initial", "after_rename", false);
+    errors += contexts_v2_unittest_check_search(host, "initial", "not_a_dimension", false);
+
+    // renaming a dimension replaces its name in the metrics index of the context
+    rrddim_reset_name(st[2], rd_renamed, "after_rename");
+
+    errors += contexts_v2_unittest_check_dimensions(host, "renamed");
+    errors += contexts_v2_unittest_check_search(host, "renamed", "before_rename", false);
+    errors += contexts_v2_unittest_check_search(host, "renamed", "after_rename", true);
+
+    errors += contexts_v2_unittest_check_order(host);
+
+    fprintf(stderr, "CONTEXTS V2: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
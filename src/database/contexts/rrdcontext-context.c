@@ -12,6 +12,120 @@ inline bool rrdcontext_acquired_belongs_to_host(RRDCONTEXT_ACQUIRED *rca, RRDHOS
     return rc->rrdhost == host;
 }
 
+// ----------------------------------------------------------------------------
+// RRDCONTEXT metrics index
+
+struct rrdcontext_metrics_index_name {
+    Word_t sequence;                    // when the name was added, so that it is walked in insertion order
+    Pvoid_t ids;                        // metric id -> the number of metrics having both the name and the id
+};
+
+void rrdcontext_metrics_index_add(RRDCONTEXT *rc, STRING *id, STRING *name) {
+    spinlock_lock(&rc->metrics_index.spinlock);
+
+    Pvoid_t *PValue = JudyLIns(&rc->metrics_index.JudyL, (Word_t)name, PJE0);
+    if(unlikely(!PValue || PValue == PJERR))
+        fatal("RRDCONTEXT: corrupted metrics index JudyL");
+
+    struct rrdcontext_metrics_index_name *n = *PValue;
+    if(!n) {
+        n = callocz(1, sizeof(*n));
+        n->sequence = ++rc->metrics_index.sequence;
+        *PValue = n;
+        string_dup(name);
+
+        Pvoid_t *PValueOrder = JudyLIns(&rc->metrics_index.order, n->sequence, PJE0);
+        if(unlikely(!PValueOrder || PValueOrder == PJERR))
+            fatal("RRDCONTEXT: corrupted metrics index order JudyL");
+
+        *PValueOrder = name;
+    }
+
+    Pvoid_t *PValue2 = JudyLIns(&n->ids, (Word_t)id, PJE0);
+    if(unlikely(!PValue2 || PValue2 == PJERR))
+        fatal("RRDCONTEXT: corrupted metrics index JudyL");
+
+    if(!*PValue2)
+        string_dup(id);
+
+    *PValue2 = (void *)((Word_t)*PValue2 + 1);
+
+    spinlock_unlock(&rc->metrics_index.spinlock);
+}
+
+void rrdcontext_metrics_index_del(RRDCONTEXT *rc, STRING *id, STRING *name) {
+    spinlock_lock(&rc->metrics_index.spinlock);
+
+    Pvoid_t *PValue = JudyLGet(rc->metrics_index.JudyL, (Word_t)name, PJE0);
+    struct rrdcontext_metrics_index_name *n = PValue ? *PValue : NULL;
+    Pvoid_t *PValue2 = n ? JudyLGet(n->ids, (Word_t)id, PJE0) : NULL;
+
+    internal_fatal(!PValue2, "RRDCONTEXT: metric '%s' ('%s') is not in the metrics index of context '%s'",
+                   string2str(id), string2str(name), string2str(rc->id));
+
+    if(likely(PValue2)) {
+        *PValue2 = (void *)((Word_t)*PValue2 - 1);
+
+        if(!*PValue2) {
+            JudyLDel(&n->ids, (Word_t)id, PJE0);
+            string_freez(id);
+
+            if(!n->ids) {
+                JudyLDel(&rc->metrics_index.order, n->sequence, PJE0);
+                JudyLDel(&rc->metrics_index.JudyL, (Word_t)name, PJE0);
+                freez(n);
+                string_freez(name);
+            }
+        }
+    }
+
+    spinlock_unlock(&rc->metrics_index.spinlock);
+}
+
+void rrdcontext_metrics_index_foreach(RRDCONTEXT *rc, rrdcontext_metrics_index_cb_t cb, void *data) {
+    spinlock_lock(&rc->metrics_index.spinlock);
+
+    Word_t sequence = 0;
+    bool first_then_next = true;
+    Pvoid_t *PValue;
+    while((PValue = JudyLFirstThenNext(rc->metrics_index.order, &sequence, &first_then_next))) {
+        STRING *name = *PValue;
+
+        Pvoid_t *PValueName = JudyLGet(rc->metrics_index.JudyL, (Word_t)name, PJE0);
+        struct rrdcontext_metrics_index_name *n = PValueName ? *PValueName : NULL;
+        if(unlikely(!n))
+            continue;
+
+        Word_t id = 0;
+        bool first_then_next2 = true;
+        while(JudyLFirstThenNext(n->ids, &id, &first_then_next2))
+            cb((STRING *)id, name, data);
+    }
+
+    spinlock_unlock(&rc->metrics_index.spinlock);
+}
+
+static void rrdcontext_metrics_index_destroy(RRDCONTEXT *rc) {
+    Word_t name = 0;
+    bool first_then_next = true;
+    Pvoid_t *PValue;
+    while((PValue = JudyLFirstThenNext(rc->metrics_index.JudyL, &name, &first_then_next))) {
+        struct rrdcontext_metrics_index_name *n = *PValue;
+
+        Word_t id = 0;
+        bool first_then_next2 = true;
+        while(JudyLFirstThenNext(n->ids, &id, &first_then_next2))
+            string_freez((STRING *)id);
+
+        JudyLFreeArray(&n->ids, PJE0);
+        freez(n);
+        string_freez((STRING *)name);
+    }
+
+    JudyLFreeArray(&rc->metrics_index.JudyL, PJE0);
+    JudyLFreeArray(&rc->metrics_index.order, PJE0);
+}
+
 // ----------------------------------------------------------------------------
 // RRDCONTEXT
 
@@ -82,6 +196,11 @@ static void rrdcontext_insert_callback(const DICTIONARY_ITEM *item __maybe_unuse
         rc->version = now_realtime_sec();
     }
 
+    spinlock_init(&rc->metrics_index.spinlock);
+    rc->metrics_index.JudyL = NULL;
+    rc->metrics_index.order = NULL;
+    rc->metrics_index.sequence = 0;
+
     rrdinstances_create_in_rrdcontext(rc);
     spinlock_init(&rc->spinlock);
 
@@ -106,6 +225,7 @@ static void rrdcontext_delete_callback(const DICTIONARY_ITEM *item __maybe_unuse
     rrdcontext_del_from_pp_queue(rc, false);
 
     rrdinstances_destroy_from_rrdcontext(rc);
+    rrdcontext_metrics_index_destroy(rc);
     rrdcontext_freez(rc);
 }
 
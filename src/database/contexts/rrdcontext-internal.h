@@ -279,6 +279,13 @@ typedef struct rrdcontext {
     DICTIONARY *rrdinstances;
     RRDHOST *rrdhost;
 
+    struct {
+        SPINLOCK spinlock;
+        Pvoid_t JudyL;                  // metric name -> struct rrdcontext_metrics_index_name
+        Pvoid_t order;                  // insertion sequence number -> metric name
+        Word_t sequence;                // the last insertion sequence number given
+    } metrics_index;
+
     struct {
         Word_t idx;
         RRD_FLAGS queued_flags;         // the last flags that triggered the post-processing
@@ -298,6 +305,17 @@ typedef struct rrdcontext {
     } queue;
 } RRDCONTEXT;
 
+// the metrics index of a context, maintained by the rrdmetrics dictionary callbacks,
+// so that the unique metric ids and names of a context can be found without walking
+// all its instances and metrics
+void rrdcontext_metrics_index_add(RRDCONTEXT *rc, STRING *id, STRING *name);
+void rrdcontext_metrics_index_del(RRDCONTEXT *rc, STRING *id, STRING *name);
+
+// calls the callback once per unique metric id and name,
+// in the order the names were first added to the index
+typedef void (*rrdcontext_metrics_index_cb_t)(STRING *id, STRING *name, void *data);
+void rrdcontext_metrics_index_foreach(RRDCONTEXT *rc, rrdcontext_metrics_index_cb_t cb, void *data);
+
 void rrdcontext_add_to_pp_queue(RRDCONTEXT *rc);
 void rrdcontext_add_to_hub_queue(RRDCONTEXT *rc);
 void rrdcontext_del_from_hub_queue(RRDCONTEXT *rc, bool having_lock);
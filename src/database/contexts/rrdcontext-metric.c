@@ -87,6 +87,7 @@ static void rrdmetric_insert_callback(const DICTIONARY_ITEM *item __maybe_unused
 
     // update the count of metrics
     __atomic_add_fetch(&rm->ri->rc->rrdhost->rrdctx.metrics_count, 1, __ATOMIC_RELAXED);
+    rrdcontext_metrics_index_add(rm->ri->rc, rm->id, rm->name);
 
     // signal the react callback to do the job
     rrd_flag_set_updated(rm, RRD_FLAG_UPDATE_REASON_NEW_OBJECT);
@@ -101,6 +102,7 @@ static void rrdmetric_delete_callback(const DICTIONARY_ITEM *item __maybe_unused
 
     // update the count of metrics
     __atomic_sub_fetch(&rm->ri->rc->rrdhost->rrdctx.metrics_count, 1, __ATOMIC_RELAXED);
+    rrdcontext_metrics_index_del(rm->ri->rc, rm->id, rm->name);
 
     // free the resources
     rrdmetric_free(rm);
@@ -160,6 +162,8 @@ static bool rrdmetric_conflict_callback(const DICTIONARY_ITEM *item __maybe_unus
         rm->rrddim = rm_new->rrddim;
 
     if(rm->name != rm_new->name) {
+        rrdcontext_metrics_index_del(rm->ri->rc, rm->id, rm->name);
+        rrdcontext_metrics_index_add(rm->ri->rc, rm->id, rm_new->name);
         SWAP(rm->name, rm_new->name);
         rrd_flag_set_updated(rm, RRD_FLAG_UPDATE_REASON_CHANGED_METADATA);
     }
@@ -2320,6 +2320,10 @@ bool pgc_evict_pages(PGC *cache, size_t max_skip, size_t max_evict) {
                        true, false);
 }
 
+bool pgc_is_below_healthy_size(PGC *cache) {
+    return !cache_above_healthy_limit(cache);
+}
+
 bool pgc_flush_pages(PGC *cache) {
     return flush_pages(cache, 0, PGC_SECTION_ALL, true, false);
 }
@@ -2648,6 +2652,14 @@ void pgc_open_evict_clean_pages_of_datafile(PGC *cache, struct rrdengine_datafil
     evict_pages_with_filter(cache, 0, 0, true, true, match_page_data, datafile);
 }
 
+static bool match_page_section(PGC_PAGE *page, void *data) {
+    return (page->section == (Word_t)data);
+}
+
+void pgc_evict_clean_pages_of_section(PGC *cache, Word_t section) {
+    evict_pages_with_filter(cache, 0, 0, true, true, match_page_section, (void *)section);
+}
+
 size_t pgc_count_clean_pages_having_data_ptr(PGC *cache, Word_t section, void *ptr) {
     size_t found = 0;
 
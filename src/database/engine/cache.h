@@ -237,6 +237,7 @@ void pgc_open_cache_to_journal_v2(
     void *data,
     bool startup);
 void pgc_open_evict_clean_pages_of_datafile(PGC *cache, struct rrdengine_datafile *datafile);
+void pgc_evict_clean_pages_of_section(PGC *cache, Word_t section);
 size_t pgc_count_clean_pages_having_data_ptr(PGC *cache, Word_t section, void *ptr);
 size_t pgc_count_hot_pages_having_data_ptr(PGC *cache, Word_t section, void *ptr);
 
@@ -248,6 +249,9 @@ void pgc_set_nominal_page_size_callback(PGC *cache, nominal_page_size_callback c
 
 // return true when there is more work to do
 bool pgc_evict_pages(PGC *cache, size_t max_skip, size_t max_evict);
+
+// true when the cache is below the size evictions start at
+bool pgc_is_below_healthy_size(PGC *cache);
 bool pgc_flush_pages(PGC *cache);
 
 struct pgc_statistics pgc_get_statistics(PGC *cache);
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "database/rrd.h"
+#include "web/api/queries/query-parallel.h"
 
 #ifdef ENABLE_DBENGINE
 
@@ -353,6 +354,190 @@ static size_t dbengine_test_rrdr_single_region(
     return errors + value_errors + time_errors + update_every_errors;
 }
 
+static RRDR *dbengine_test_rrdr_context_query(ONEWAYALLOC *owa, RRDHOST *host, time_t time_start, time_t time_end) {
+    QUERY_TARGET_REQUEST qtr = {
+        .version = 2,
+        .host = host,
+        .contexts = "unittest",
+        .after = time_start,
+        .before = time_end,
+        .points = 1000,
+        .options = RRDR_OPTION_NATURAL_POINTS,
+        .time_group_method = RRDR_GROUPING_AVERAGE,
+        .tier = 0,
+        .query_source = QUERY_SOURCE_UNITTEST,
+        .priority = STORAGE_PRIORITY_NORMAL,
+    };
+
+    // group all the charts by dimension, so that all the metrics are aggregated
+    qtr.group_by[0].group_by = RRDR_GROUP_BY_DIMENSION;
+    qtr.group_by[0].aggregation = RRDR_GROUP_BY_FUNCTION_SUM;
+
+    QUERY_TARGET *qt = query_target_create(&qtr);
+    if(!qt)
+        return NULL;
+
+    RRDR *r = rrd2rrdr(owa, qt);
+    if(!r) {
+        query_target_release(qt);
+        return NULL;
+    }
+
+    r->internal.release_with_rrdr_qt = qt;
+    return r;
+}
+
+static size_t dbengine_test_rrdr_parallel(RRDHOST *host, time_t time_start, time_t time_end) {
+    fprintf(stderr, "RRDR Parallel Query Test from %ld to %ld, on %d dimensions...\n",
+            time_start, time_end, CHARTS * DIMS);
+
+    size_t errors = 0;
+
+    // the same query, serially and on the query parallel pool
+    ONEWAYALLOC *owa_serial = onewayalloc_create(0);
+    RRDR *r_serial = dbengine_test_rrdr_context_query(owa_serial, host, time_start, time_end);
+
+    if(!query_parallel_unittest_pool_start()) {
+        fprintf(stderr, " >>> RRDR PARALLEL: the query parallel pool did not start\n");
+        errors++;
+    }
+
+    ONEWAYALLOC *owa_parallel = onewayalloc_create(0);
+    RRDR *r_parallel = dbengine_test_rrdr_context_query(owa_parallel, host, time_start, time_end);
+
+    query_parallel_unittest_pool_stop();
+
+    if(!r_serial || !r_parallel) {
+        fprintf(stderr, " >>> RRDR PARALLEL: empty RRDR (serial %p, parallel %p)\n", r_serial, r_parallel);
+        errors++;
+    }
+    else if(r_serial->internal.qt->query.used != CHARTS * DIMS) {
+        fprintf(stderr, " >>> RRDR PARALLEL: queried %zu metrics, expected %d\n",
+                (size_t)r_serial->internal.qt->query.used, CHARTS * DIMS);
+        errors++;
+    }
+    else if(r_serial->d != r_parallel->d || rrdr_rows(r_serial) != rrdr_rows(r_parallel) || !rrdr_rows(r_serial)) {
+        fprintf(stderr, " >>> RRDR PARALLEL: shape mismatch: serial %zu x %zu, parallel %zu x %zu\n",
+                rrdr_rows(r_serial), r_serial->d, rrdr_rows(r_parallel), r_parallel->d);
+        errors++;
+    }
+    else {
+        for(size_t i = 0; i < rrdr_rows(r_serial) * r_serial->d ; i++) {
+            if((r_serial->o[i] & RRDR_VALUE_EMPTY) != (r_parallel->o[i] & RRDR_VALUE_EMPTY) ||
+                (!(r_serial->o[i] & RRDR_VALUE_EMPTY) && r_serial->v[i] != r_parallel->v[i])) {
+                if(errors < DIMS * 2)
+                    fprintf(stderr, " >>> RRDR PARALLEL: point %zu differs: serial %f, parallel %f\n",
+                            i, r_serial->v[i], r_parallel->v[i]);
+                errors++;
+            }
+        }
+
+        if(r_serial->view.min != r_parallel->view.min || r_serial->view.max != r_parallel->view.max) {
+            fprintf(stderr, " >>> RRDR PARALLEL: min/max differ: serial %f/%f, parallel %f/%f\n",
+                    r_serial->view.min, r_serial->view.max, r_parallel->view.min, r_parallel->view.max);
+            errors++;
+        }
+    }
+
+    if(r_serial) rrdr_free(owa_serial, r_serial);
+    if(r_parallel) rrdr_free(owa_parallel, r_parallel);
+    onewayalloc_destroy(owa_serial);
+    onewayalloc_destroy(owa_parallel);
+
+    return errors;
+}
+
+// queries the metrics one after the other, so that each query reads its own extents,
+// returns the number of pages the queries loaded from extents and the pages loaded ahead
+static size_t dbengine_test_extent_lookahead_pass(
+    RRDHOST *host,
+    RRDDIM *rd[CHARTS][DIMS],
+    time_t time_start,
+    time_t time_end,
+    bool lookahead,
+    size_t *pages_loaded,
+    size_t *pages_loaded_ahead) {
+
+    struct rrdengine_instance *ctx = (struct rrdengine_instance *)host->db[0].si;
+    time_t update_every = REGION_UPDATE_EVERY[0];
+    size_t value_errors = 0, time_errors = 0, update_every_errors = 0;
+
+    bool saved_lookahead = dbengine_extent_lookahead;
+    dbengine_extent_lookahead = lookahead;
+
+    // make the queries read the extents from disk
+    pgc_flush_dirty_pages(main_cache, (Word_t)ctx);
+    sleep(2);
+    pgc_evict_clean_pages_of_section(main_cache, (Word_t)ctx);
+
+    size_t loaded_before =
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_compressed, __ATOMIC_RELAXED) +
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_uncompressed, __ATOMIC_RELAXED);
+    size_t loaded_ahead_before =
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_lookahead, __ATOMIC_RELAXED);
+
+    for (size_t c = 0 ; c < CHARTS ; ++c) {
+        for (size_t d = 0; d < DIMS; ++d) {
+            struct storage_engine_query_handle handle = { 0 };
+            storage_engine_query_init(rd[c][d]->tiers[0].seb, rd[c][d]->tiers[0].smh, &handle,
+                                      time_start, time_end, STORAGE_PRIORITY_NORMAL);
+
+            time_t time_now = time_start;
+            for(size_t p = 0; p < POINTS_PER_REGION ;p++) {
+                STORAGE_POINT sp = storage_engine_query_next_metric(&handle);
+                storage_point_check(0, c, d, p, time_now, update_every, sp,
+                                    &value_errors, &time_errors, &update_every_errors);
+                time_now += update_every;
+            }
+
+            storage_engine_query_finalize(&handle);
+        }
+    }
+
+    *pages_loaded =
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_compressed, __ATOMIC_RELAXED) +
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_uncompressed, __ATOMIC_RELAXED) -
+        loaded_before;
+    *pages_loaded_ahead =
+        __atomic_load_n(&rrdeng_cache_efficiency_stats.pages_load_ok_lookahead, __ATOMIC_RELAXED) -
+        loaded_ahead_before;
+
+    dbengine_extent_lookahead = saved_lookahead;
+
+    return value_errors + time_errors + update_every_errors;
+}
+
+static size_t dbengine_test_extent_lookahead(RRDHOST *host, RRDDIM *rd[CHARTS][DIMS], time_t time_start, time_t time_end) {
+    fprintf(stderr, "DBENGINE extent look-ahead, querying %d dimensions one by one, from %ld to %ld...\n",
+            CHARTS * DIMS, time_start, time_end);
+
+    size_t errors = 0;
+    size_t loaded_off = 0, ahead_off = 0, loaded_on = 0, ahead_on = 0;
+
+    errors += dbengine_test_extent_lookahead_pass(host, rd, time_start, time_end, false, &loaded_off, &ahead_off);
+    errors += dbengine_test_extent_lookahead_pass(host, rd, time_start, time_end, true, &loaded_on, &ahead_on);
+
+    fprintf(stderr, "DBENGINE extent look-ahead: disabled: %zu pages loaded by the queries, "
+                    "enabled: %zu pages loaded by the queries and %zu pages loaded ahead\n",
+            loaded_off, loaded_on, ahead_on);
+
+    if(ahead_off) {
+        fprintf(stderr, " >>> DBENGINE: %zu pages were loaded ahead while look-ahead was disabled\n", ahead_off);
+        errors++;
+    }
+
+    if(!ahead_on) {
+        fprintf(stderr, " >>> DBENGINE: no pages were loaded ahead while look-ahead was enabled\n");
+        errors++;
+    }
+    else if(loaded_on >= loaded_off) {
+        fprintf(stderr, " >>> DBENGINE: look-ahead did not reduce the pages the queries loaded from extents\n");
+        errors++;
+    }
+
+    return errors;
+}
+
 int test_dbengine(void) {
     // provide enough threads to dbengine
     setenv("UV_THREADPOOL_SIZE", "48", 1);
@@ -407,6 +592,12 @@ int test_dbengine(void) {
         errors += dbengine_test_rrdr_single_region(st, rd, current_region, time_start[current_region], time_end[current_region]);
     }
 
+    // check that parallel queries return the same results with serial ones
+    errors += dbengine_test_rrdr_parallel(host, time_start[0], time_end[0]);
+
+    // check that extent look-ahead returns the same data, loading fewer pages on request
+    errors += dbengine_test_extent_lookahead(host, rd, time_start[0], time_end[0]);
+
     // prevent closing the database before the test is finished
     sleep(5);
 
@@ -0,0 +1,597 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rrdengine.h"
+#include "dbengine-uring.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <sys/eventfd.h>
+
+#define DBENGINE_URING_ENTRIES 256
+
+// registered buffers for extent reads, larger extents use an unregistered buffer
+#define DBENGINE_URING_BUFFERS 16
+#define DBENGINE_URING_BUFFER_SIZE (256 * 1024)
+
+// when io_uring_submit() keeps failing, the ring is abandoned and
+// all requests that have not reached the kernel use the synchronous path
+#define DBENGINE_URING_SUBMIT_RETRY_MS 10
+#define DBENGINE_URING_SUBMIT_RETRIES 100
+
+typedef enum __attribute__((packed)) {
+    DBENGINE_URING_OP_READ = 0,
+    DBENGINE_URING_OP_READ_FIXED,
+    DBENGINE_URING_OP_WRITE,
+} DBENGINE_URING_OP;
+
+struct dbengine_uring_request {
+    DBENGINE_URING_OP op;
+    bool async;
+    int buffer_index;
+
+    uv_file file;
+    void *buffer;
+    size_t size;
+    uint64_t offset;
+
+    // synchronous requests live on the stack of their caller
+    int result;
+    struct completion completion;
+
+    // asynchronous reads are allocated and freed by us
+    void *dst;
+    size_t dst_size;
+    dbengine_uring_read_cb cb;
+    void *data;
+
+    struct dbengine_uring_request *prev, *next;
+};
+
+static struct {
+    struct io_uring ring;
+    int eventfd;
+    pid_t tid;
+    bool initialized;                               // accessed only by the event loop
+    bool abandoned;                                 // accessed only by the event loop
+
+    uv_poll_t poll;
+    uv_async_t async;
+    uv_timer_t retry;
+
+    size_t in_flight;                               // atomic, updated only by the event loop
+
+    struct {
+        size_t entries;                             // accessed only by the event loop
+        size_t failures;                            // accessed only by the event loop
+        struct dbengine_uring_request *requests;    // accessed only by the event loop
+    } unsubmitted;
+
+    struct {
+        size_t registered;
+        size_t available;                           // protected by the spinlock
+        int free[DBENGINE_URING_BUFFERS];           // protected by the spinlock
+        struct iovec iov[DBENGINE_URING_BUFFERS];
+    } buffers;
+
+    SPINLOCK spinlock;
+    bool running;                                   // protected by the spinlock
+    struct dbengine_uring_request *queue;           // protected by the spinlock
+} dbengine_uring = {
+    .eventfd = -1,
+    .spinlock = SPINLOCK_INITIALIZER,
+    .running = false,
+    .queue = NULL,
+};
+
+static void dbengine_uring_buffer_release(int index);
+static void dbengine_uring_retry_cb(uv_timer_t *handle);
+
+// ----------------------------------------------------------------------------
+// the event loop side
+
+static void dbengine_uring_complete(struct dbengine_uring_request *req, int result) {
+    if(!req->async) {
+        // the request lives on the stack of its caller,
+        // so we should not touch it after marking it complete
+        req->result = result;
+        completion_mark_complete(&req->completion);
+        return;
+    }
+
+    ssize_t ret = result;
+    if(ret >= 0) {
+        if((size_t)ret < req->dst_size)
+            ret = -EIO;
+        else
+            memcpy(req->dst, req->buffer, req->dst_size);
+    }
+
+    if(req->buffer_index >= 0)
+        dbengine_uring_buffer_release(req->buffer_index);
+    else
+        posix_memalign_freez(req->buffer);
+
+    dbengine_uring_read_cb cb = req->cb;
+    void *data = req->data;
+    freez(req);
+
+    cb(data, ret);
+}
+
+static void dbengine_uring_abandon(void) {
+    spinlock_lock(&dbengine_uring.spinlock);
+    dbengine_uring.running = false;
+    struct dbengine_uring_request *queue = dbengine_uring.queue;
+    dbengine_uring.queue = NULL;
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    dbengine_uring.abandoned = true;
+
+    nd_log(NDLS_DAEMON, NDLP_ERR,
+           "DBENGINE: io_uring_submit() failed %zu times in a row, using synchronous I/O from now on",
+           dbengine_uring.unsubmitted.failures);
+
+    // the kernel consumes submission entries only when we enter the ring to submit,
+    // which we never do again, so the requests that did not reach it can be given back
+    // to their callers, to be executed with synchronous I/O
+    while(dbengine_uring.unsubmitted.requests) {
+        struct dbengine_uring_request *req = dbengine_uring.unsubmitted.requests;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(dbengine_uring.unsubmitted.requests, req, prev, next);
+        dbengine_uring.unsubmitted.entries--;
+        dbengine_uring_complete(req, -ENOSYS);
+    }
+
+    while(queue) {
+        struct dbengine_uring_request *req = queue;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(queue, req, prev, next);
+        dbengine_uring_complete(req, -ENOSYS);
+    }
+
+    // the requests already in flight are reaped as usual
+}
+
+static void dbengine_uring_submit(void) {
+    if(dbengine_uring.abandoned)
+        return;
+
+    spinlock_lock(&dbengine_uring.spinlock);
+
+    // never have more requests in flight than the completion queue can hold
+    while(dbengine_uring.queue &&
+           __atomic_load_n(&dbengine_uring.in_flight, __ATOMIC_RELAXED) + dbengine_uring.unsubmitted.entries < DBENGINE_URING_ENTRIES) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&dbengine_uring.ring);
+        if(!sqe)
+            break;
+
+        struct dbengine_uring_request *req = dbengine_uring.queue;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(dbengine_uring.queue, req, prev, next);
+
+        switch(req->op) {
+            case DBENGINE_URING_OP_READ_FIXED:
+                io_uring_prep_read_fixed(sqe, req->file, req->buffer, req->size, req->offset, req->buffer_index);
+                break;
+
+            case DBENGINE_URING_OP_READ:
+                io_uring_prep_read(sqe, req->file, req->buffer, req->size, req->offset);
+                break;
+
+            case DBENGINE_URING_OP_WRITE:
+                io_uring_prep_write(sqe, req->file, req->buffer, req->size, req->offset);
+                break;
+        }
+
+        io_uring_sqe_set_data(sqe, req);
+
+        // the kernel consumes the submission queue in order,
+        // so this list is in the same order as the ring
+        DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(dbengine_uring.unsubmitted.requests, req, prev, next);
+        dbengine_uring.unsubmitted.entries++;
+    }
+
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    if(!dbengine_uring.unsubmitted.entries)
+        return;
+
+    // all the requests queued since the last submission go in one system call
+    int ret = io_uring_submit(&dbengine_uring.ring);
+    if(ret < 0) {
+        // the prepared entries remain in the ring, retry them a bit later
+        dbengine_uring.unsubmitted.failures++;
+
+        nd_log_limit_static_global_var(erl, 10, 0);
+        nd_log_limit(&erl, NDLS_DAEMON, NDLP_ERR, "DBENGINE: io_uring_submit() failed: %s", strerror(-ret));
+
+        if(dbengine_uring.unsubmitted.failures >= DBENGINE_URING_SUBMIT_RETRIES)
+            dbengine_uring_abandon();
+        else
+            uv_timer_start(&dbengine_uring.retry, dbengine_uring_retry_cb, DBENGINE_URING_SUBMIT_RETRY_MS, 0);
+
+        return;
+    }
+
+    dbengine_uring.unsubmitted.failures = 0;
+
+    for(int i = 0; i < ret && dbengine_uring.unsubmitted.requests ; i++) {
+        struct dbengine_uring_request *req = dbengine_uring.unsubmitted.requests;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(dbengine_uring.unsubmitted.requests, req, prev, next);
+        dbengine_uring.unsubmitted.entries--;
+        __atomic_add_fetch(&dbengine_uring.in_flight, 1, __ATOMIC_RELAXED);
+    }
+
+    // a partial submission, the rest will be submitted a bit later
+    if(dbengine_uring.unsubmitted.entries)
+        uv_timer_start(&dbengine_uring.retry, dbengine_uring_retry_cb, DBENGINE_URING_SUBMIT_RETRY_MS, 0);
+}
+
+static void dbengine_uring_reap(void) {
+    struct io_uring_cqe *cqe;
+
+    while(io_uring_peek_cqe(&dbengine_uring.ring, &cqe) == 0) {
+        struct dbengine_uring_request *req = io_uring_cqe_get_data(cqe);
+        int result = cqe->res;
+        io_uring_cqe_seen(&dbengine_uring.ring, cqe);
+
+        __atomic_sub_fetch(&dbengine_uring.in_flight, 1, __ATOMIC_RELAXED);
+
+        dbengine_uring_complete(req, result);
+    }
+}
+
+static void dbengine_uring_poll_cb(uv_poll_t *handle __maybe_unused, int status __maybe_unused, int events __maybe_unused) {
+    worker_is_busy(RRDENG_URING_CB);
+
+    eventfd_t value;
+    (void)eventfd_read(dbengine_uring.eventfd, &value);
+
+    dbengine_uring_reap();
+
+    // completions may have made room for more requests
+    dbengine_uring_submit();
+
+    worker_is_idle();
+}
+
+static void dbengine_uring_async_cb(uv_async_t *handle __maybe_unused) {
+    worker_is_busy(RRDENG_URING_CB);
+    dbengine_uring_submit();
+    worker_is_idle();
+}
+
+static void dbengine_uring_retry_cb(uv_timer_t *handle __maybe_unused) {
+    worker_is_busy(RRDENG_URING_CB);
+    dbengine_uring_submit();
+    worker_is_idle();
+}
+
+static void dbengine_uring_buffers_free(void) {
+    for(size_t i = 0; i < DBENGINE_URING_BUFFERS ; i++) {
+        posix_memalign_freez(dbengine_uring.buffers.iov[i].iov_base);
+        dbengine_uring.buffers.iov[i].iov_base = NULL;
+    }
+
+    dbengine_uring.buffers.registered = 0;
+    dbengine_uring.buffers.available = 0;
+}
+
+static void dbengine_uring_buffers_register(void) {
+    for(size_t i = 0; i < DBENGINE_URING_BUFFERS ; i++) {
+        (void)posix_memalignz(&dbengine_uring.buffers.iov[i].iov_base, RRDFILE_ALIGNMENT, DBENGINE_URING_BUFFER_SIZE);
+        dbengine_uring.buffers.iov[i].iov_len = DBENGINE_URING_BUFFER_SIZE;
+        dbengine_uring.buffers.free[i] = (int)i;
+    }
+
+    int ret = io_uring_register_buffers(&dbengine_uring.ring, dbengine_uring.buffers.iov, DBENGINE_URING_BUFFERS);
+    if(ret < 0) {
+        // most probably RLIMIT_MEMLOCK is too low, reads will use unregistered buffers
+        nd_log(NDLS_DAEMON, NDLP_NOTICE,
+               "DBENGINE: cannot register io_uring buffers (%s), extent reads will not use registered buffers",
+               strerror(-ret));
+
+        dbengine_uring_buffers_free();
+        return;
+    }
+
+    dbengine_uring.buffers.registered = DBENGINE_URING_BUFFERS;
+    dbengine_uring.buffers.available = DBENGINE_URING_BUFFERS;
+}
+
+bool dbengine_uring_init(uv_loop_t *loop) {
+    if(!dbengine_use_io_uring)
+        return false;
+
+    int ret = io_uring_queue_init(DBENGINE_URING_ENTRIES, &dbengine_uring.ring, 0);
+    if(ret < 0) {
+        nd_log(NDLS_DAEMON, NDLP_NOTICE,
+               "DBENGINE: io_uring is not available (%s), using synchronous I/O", strerror(-ret));
+        return false;
+    }
+
+    dbengine_uring.eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(dbengine_uring.eventfd == -1 || io_uring_register_eventfd(&dbengine_uring.ring, dbengine_uring.eventfd) < 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "DBENGINE: cannot attach an eventfd to io_uring, using synchronous I/O");
+        goto cleanup;
+    }
+
+    if(uv_async_init(loop, &dbengine_uring.async, dbengine_uring_async_cb)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "DBENGINE: cannot initialize io_uring async handle, using synchronous I/O");
+        goto cleanup;
+    }
+
+    if(uv_timer_init(loop, &dbengine_uring.retry)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "DBENGINE: cannot initialize io_uring retry timer, using synchronous I/O");
+        uv_close((uv_handle_t *)&dbengine_uring.async, NULL);
+        goto cleanup;
+    }
+
+    if(uv_poll_init(loop, &dbengine_uring.poll, dbengine_uring.eventfd) ||
+       uv_poll_start(&dbengine_uring.poll, UV_READABLE, dbengine_uring_poll_cb)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "DBENGINE: cannot poll the io_uring eventfd, using synchronous I/O");
+        uv_close((uv_handle_t *)&dbengine_uring.async, NULL);
+        uv_close((uv_handle_t *)&dbengine_uring.retry, NULL);
+        goto cleanup;
+    }
+
+    dbengine_uring_buffers_register();
+
+    dbengine_uring.tid = gettid_cached();
+    dbengine_uring.initialized = true;
+
+    spinlock_lock(&dbengine_uring.spinlock);
+    dbengine_uring.running = true;
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    nd_log(NDLS_DAEMON, NDLP_INFO,
+           "DBENGINE: using io_uring for extent I/O, with %zu registered buffers",
+           dbengine_uring.buffers.registered);
+
+    return true;
+
+cleanup:
+    if(dbengine_uring.eventfd != -1) {
+        close(dbengine_uring.eventfd);
+        dbengine_uring.eventfd = -1;
+    }
+    io_uring_queue_exit(&dbengine_uring.ring);
+    return false;
+}
+
+void dbengine_uring_shutdown(void) {
+    if(!dbengine_uring.initialized)
+        return;
+
+    dbengine_uring.initialized = false;
+
+    spinlock_lock(&dbengine_uring.spinlock);
+    dbengine_uring.running = false;
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    // from now on, callers use the synchronous path,
+    // but the requests already queued have to be completed
+    while(dbengine_uring.queue || dbengine_uring.unsubmitted.entries || __atomic_load_n(&dbengine_uring.in_flight, __ATOMIC_RELAXED)) {
+        dbengine_uring_submit();
+
+        struct io_uring_cqe *cqe;
+        if(__atomic_load_n(&dbengine_uring.in_flight, __ATOMIC_RELAXED)) {
+            if(io_uring_wait_cqe(&dbengine_uring.ring, &cqe) == 0)
+                dbengine_uring_reap();
+        }
+        else if(dbengine_uring.unsubmitted.entries) {
+            // nothing to wait for, but submission failed; retry a bit later,
+            // dbengine_uring_submit() gives them back after a number of failures
+            sleep_usec(DBENGINE_URING_SUBMIT_RETRY_MS * USEC_PER_MS);
+        }
+    }
+
+    (void)uv_timer_stop(&dbengine_uring.retry);
+    uv_close((uv_handle_t *)&dbengine_uring.retry, NULL);
+    uv_poll_stop(&dbengine_uring.poll);
+    uv_close((uv_handle_t *)&dbengine_uring.poll, NULL);
+    uv_close((uv_handle_t *)&dbengine_uring.async, NULL);
+
+    if(dbengine_uring.buffers.registered) {
+        // wait for the callers of completed reads to return their buffers
+        for(size_t i = 0; i < 1000 ; i++) {
+            spinlock_lock(&dbengine_uring.spinlock);
+            bool all_returned = dbengine_uring.buffers.available == dbengine_uring.buffers.registered;
+            spinlock_unlock(&dbengine_uring.spinlock);
+
+            if(all_returned)
+                break;
+
+            sleep_usec(1 * USEC_PER_MS);
+        }
+
+        io_uring_unregister_buffers(&dbengine_uring.ring);
+    }
+
+    io_uring_queue_exit(&dbengine_uring.ring);
+    close(dbengine_uring.eventfd);
+    dbengine_uring.eventfd = -1;
+
+    // buffers still held by a caller are leaked, we are exiting anyway
+    spinlock_lock(&dbengine_uring.spinlock);
+    if(dbengine_uring.buffers.available == dbengine_uring.buffers.registered)
+        dbengine_uring_buffers_free();
+    spinlock_unlock(&dbengine_uring.spinlock);
+}
+
+size_t dbengine_uring_in_flight(void) {
+    return __atomic_load_n(&dbengine_uring.in_flight, __ATOMIC_RELAXED);
+}
+
+// ----------------------------------------------------------------------------
+// the caller side
+
+static int dbengine_uring_buffer_acquire(size_t size) {
+    int index = -1;
+
+    if(size > DBENGINE_URING_BUFFER_SIZE)
+        return index;
+
+    spinlock_lock(&dbengine_uring.spinlock);
+    if(dbengine_uring.buffers.available)
+        index = dbengine_uring.buffers.free[--dbengine_uring.buffers.available];
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    return index;
+}
+
+static void dbengine_uring_buffer_release(int index) {
+    spinlock_lock(&dbengine_uring.spinlock);
+    dbengine_uring.buffers.free[dbengine_uring.buffers.available++] = index;
+    spinlock_unlock(&dbengine_uring.spinlock);
+}
+
+static bool dbengine_uring_usable(void) {
+    // the event loop cannot wait for its own completions
+    return __atomic_load_n(&dbengine_uring.running, __ATOMIC_RELAXED) && gettid_cached() != dbengine_uring.tid;
+}
+
+static int dbengine_uring_execute(struct dbengine_uring_request *req) {
+    completion_init(&req->completion);
+
+    spinlock_lock(&dbengine_uring.spinlock);
+    bool running = dbengine_uring.running;
+    if(running) {
+        DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(dbengine_uring.queue, req, prev, next);
+
+        // wake up the event loop while holding the lock,
+        // so that the async handle cannot be closed in the meantime
+        uv_async_send(&dbengine_uring.async);
+    }
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    if(running)
+        completion_wait_for(&req->completion);
+
+    completion_destroy(&req->completion);
+
+    return running ? req->result : -ENOSYS;
+}
+
+ssize_t dbengine_uring_read_extent(uv_file file, void *dst, size_t dst_size, size_t io_size, uint64_t offset) {
+    if(!dbengine_uring_usable())
+        return -ENOSYS;
+
+    struct dbengine_uring_request req = {
+        .op = DBENGINE_URING_OP_READ,
+        .buffer_index = dbengine_uring_buffer_acquire(io_size),
+        .file = file,
+        .size = io_size,
+        .offset = offset,
+    };
+
+    if(req.buffer_index >= 0) {
+        req.op = DBENGINE_URING_OP_READ_FIXED;
+        req.buffer = dbengine_uring.buffers.iov[req.buffer_index].iov_base;
+    }
+    else
+        (void)posix_memalignz(&req.buffer, RRDFILE_ALIGNMENT, io_size);
+
+    ssize_t ret = dbengine_uring_execute(&req);
+    if(ret >= 0) {
+        if((size_t)ret < dst_size)
+            ret = -EIO;
+        else
+            memcpy(dst, req.buffer, dst_size);
+    }
+
+    if(req.buffer_index >= 0)
+        dbengine_uring_buffer_release(req.buffer_index);
+    else
+        posix_memalign_freez(req.buffer);
+
+    return ret;
+}
+
+bool dbengine_uring_read_extent_async(uv_file file, void *dst, size_t dst_size, size_t io_size, uint64_t offset, dbengine_uring_read_cb cb, void *data) {
+    if(!dbengine_uring_usable())
+        return false;
+
+    struct dbengine_uring_request *req = callocz(1, sizeof(*req));
+    req->op = DBENGINE_URING_OP_READ;
+    req->async = true;
+    req->buffer_index = dbengine_uring_buffer_acquire(io_size);
+    req->file = file;
+    req->size = io_size;
+    req->offset = offset;
+    req->dst = dst;
+    req->dst_size = dst_size;
+    req->cb = cb;
+    req->data = data;
+
+    if(req->buffer_index >= 0) {
+        req->op = DBENGINE_URING_OP_READ_FIXED;
+        req->buffer = dbengine_uring.buffers.iov[req->buffer_index].iov_base;
+    }
+    else
+        (void)posix_memalignz(&req->buffer, RRDFILE_ALIGNMENT, io_size);
+
+    spinlock_lock(&dbengine_uring.spinlock);
+    bool running = dbengine_uring.running;
+    if(running) {
+        DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(dbengine_uring.queue, req, prev, next);
+        uv_async_send(&dbengine_uring.async);
+    }
+    spinlock_unlock(&dbengine_uring.spinlock);
+
+    if(!running) {
+        if(req->buffer_index >= 0)
+            dbengine_uring_buffer_release(req->buffer_index);
+        else
+            posix_memalign_freez(req->buffer);
+
+        freez(req);
+    }
+
+    return running;
+}
+
+ssize_t dbengine_uring_write(uv_file file, void *buffer, size_t size, uint64_t offset) {
+    if(!dbengine_uring_usable())
+        return -ENOSYS;
+
+    struct dbengine_uring_request req = {
+        .op = DBENGINE_URING_OP_WRITE,
+        .buffer_index = -1,
+        .file = file,
+        .buffer = buffer,
+        .size = size,
+        .offset = offset,
+    };
+
+    ssize_t ret = dbengine_uring_execute(&req);
+    if(ret >= 0 && (size_t)ret != size)
+        ret = -EIO;
+
+    return ret;
+}
+
+#else // HAVE_LIBURING
+
+bool dbengine_uring_init(uv_loop_t *loop __maybe_unused) {
+    return false;
+}
+
+void dbengine_uring_shutdown(void) {
+    ;
+}
+
+size_t dbengine_uring_in_flight(void) {
+    return 0;
+}
+
+ssize_t dbengine_uring_read_extent(uv_file file __maybe_unused, void *dst __maybe_unused, size_t dst_size __maybe_unused, size_t io_size __maybe_unused, uint64_t offset __maybe_unused) {
+    return -ENOSYS;
+}
+
+bool dbengine_uring_read_extent_async(uv_file file __maybe_unused, void *dst __maybe_unused, size_t dst_size __maybe_unused, size_t io_size __maybe_unused, uint64_t offset __maybe_unused, dbengine_uring_read_cb cb __maybe_unused, void *data __maybe_unused) {
+    return false;
+}
+
+ssize_t dbengine_uring_write(uv_file file __maybe_unused, void *buffer __maybe_unused, size_t size __maybe_unused, uint64_t offset __maybe_unused) {
+    return -ENOSYS;
+}
+
+#endif // HAVE_LIBURING
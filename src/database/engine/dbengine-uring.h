@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_DBENGINE_URING_H
+#define NETDATA_DBENGINE_URING_H
+
+// io_uring submissions and completions are handled by the dbengine event loop.
+// When io_uring is not available (not compiled in, not supported by the kernel,
+// disabled in netdata.conf, or called from the event loop itself), the I/O
+// functions return -ENOSYS and the callers use their synchronous libuv path.
+
+// to be called by the event loop thread
+bool dbengine_uring_init(uv_loop_t *loop);
+void dbengine_uring_shutdown(void);
+
+size_t dbengine_uring_in_flight(void);
+
+// read io_size bytes at offset and copy the first dst_size of them to dst
+// returns the number of bytes read, or a negative errno
+ssize_t dbengine_uring_read_extent(uv_file file, void *dst, size_t dst_size, size_t io_size, uint64_t offset);
+
+// queue the same read and return immediately; when the read completes, cb is called
+// by the event loop thread with the number of bytes read or a negative errno
+// (-ENOSYS when io_uring was abandoned and the read should be done synchronously).
+// cb should only hand the rest of the work to another thread.
+// returns false, without calling cb, when io_uring is not available
+typedef void (*dbengine_uring_read_cb)(void *data, ssize_t ret);
+bool dbengine_uring_read_extent_async(uv_file file, void *dst, size_t dst_size, size_t io_size, uint64_t offset, dbengine_uring_read_cb cb, void *data);
+
+// returns the number of bytes written, or a negative errno
+ssize_t dbengine_uring_write(uv_file file, void *buffer, size_t size, uint64_t offset);
+
+#endif //NETDATA_DBENGINE_URING_H
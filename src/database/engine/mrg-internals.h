@@ -60,8 +60,20 @@ struct mrg {
 
         struct mrg_statistics stats;
     } index[UUIDMAP_PARTITIONS];
+
+    struct mrg_snapshot *snapshot;  // the snapshot loaded at startup, or NULL
 };
 
+// metrics found in the snapshot are added to the registry on their first lookup
+METRIC *mrg_snapshot_promote(MRG *mrg, nd_uuid_t *uuid, Word_t section);
+void mrg_snapshot_merge(MRG *mrg, METRIC *metric);
+void mrg_snapshot_destroy(MRG *mrg);
+
+// ctxs are the sections of the tiers, indexed by tier
+struct rrdengine_instance;
+bool mrg_snapshot_save_to_file(MRG *mrg, const char *path, struct rrdengine_instance **ctxs);
+bool mrg_snapshot_load_from_file(MRG *mrg, const char *path, struct rrdengine_instance **ctxs);
+
 static inline void MRG_STATS_DUPLICATE_ADD(MRG *mrg, size_t partition) {
     mrg->index[partition].stats.additions_duplicate++;
 }
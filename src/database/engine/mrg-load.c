@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "mrg-internals.h"
+#include "rrdengine.h"
 
 DEFINE_JUDYL_TYPED(METRIC, METRIC *);
 METRIC_JudyLSet acquired_metrics = { 0 };
@@ -42,8 +43,625 @@ void mrg_metric_prepopulate_cleanup(MRG *mrg) {
     acquired_metrics_counter = 0;
 }
 
+
+// ----------------------------------------------------------------------------
+// MRG snapshot
+//
+// At shutdown, the retention of all metrics is saved to a file, sorted by UUID
+// and tier. At startup the file is mmapped and used as-is as a read-only first
+// level index: a metric is added to the registry when it is first looked up,
+// and the journal files covered by the snapshot are not scanned at all.
+
+#define MRG_SNAPSHOT_FILENAME   "dbengine-mrg.snapshot"
+#define MRG_SNAPSHOT_MAGIC      0x4D524753 // "MRGS"
+#define MRG_SNAPSHOT_VERSION    2
+#define MRG_SNAPSHOT_BUCKETS    4096       // indexed by the first 12 bits of the UUID
+
+struct mrg_snapshot_tier_header {
+    uint32_t datafiles;                     // the number of datafiles covered by the snapshot
+    uint32_t first_fileno;
+    uint32_t last_fileno;
+    uint32_t path_checksum;                 // crc32 of the directory of the tier
+    int64_t first_time_s;
+    uint64_t samples;
+    uint64_t entries;
+    uint32_t datafiles_checksum;            // crc32 of the number and size of the datafiles covered
+    uint32_t reserved;
+};
+
+struct mrg_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t entry_size;
+    uint64_t entries;
+    int64_t created_s;
+    struct mrg_snapshot_tier_header tiers[RRD_STORAGE_TIERS];
+    uint64_t buckets[MRG_SNAPSHOT_BUCKETS + 1];   // the first entry of each bucket
+    uint32_t checksum;                            // crc32 of the header up to this field
+    uint32_t reserved;
+};
+
+struct mrg_snapshot_entry {
+    nd_uuid_t uuid;
+    int64_t first_time_s;
+    int64_t last_time_s;
+    uint32_t update_every_s;
+    uint32_t tier;
+};
+
+typedef enum {
+    MRG_SNAPSHOT_TIER_PENDING = 0,          // the datafiles of the tier have not been checked yet
+    MRG_SNAPSHOT_TIER_VALID,
+    MRG_SNAPSHOT_TIER_INVALID,
+} MRG_SNAPSHOT_TIER_STATE;
+
+struct mrg_snapshot {
+    const struct mrg_snapshot_header *header;
+    const struct mrg_snapshot_entry *entries;
+    size_t size;
+
+    uint64_t *promoted;                     // one bit per entry, set when it is added to the registry
+    size_t promotions;
+
+    MRG_SNAPSHOT_TIER_STATE state[RRD_STORAGE_TIERS];
+    struct rrdengine_instance *ctx[RRD_STORAGE_TIERS];
+};
+
+static void mrg_snapshot_filename(char *dst, size_t dst_size) {
+    snprintfz(dst, dst_size, "%s/%s", netdata_configured_cache_dir, MRG_SNAPSHOT_FILENAME);
+}
+
+static inline size_t mrg_snapshot_bucket(const nd_uuid_t *uuid) {
+    const uint8_t *u = (const uint8_t *)uuid;
+    return ((size_t)u[0] << 4) | (u[1] >> 4);
+}
+
+static int mrg_snapshot_entry_compare(const void *a, const void *b) {
+    const struct mrg_snapshot_entry *e1 = a, *e2 = b;
+
+    int rc = memcmp(&e1->uuid, &e2->uuid, sizeof(nd_uuid_t));
+    if(rc)
+        return rc;
+
+    return (e1->tier > e2->tier) - (e1->tier < e2->tier);
+}
+
+static int mrg_snapshot_section_tier(struct rrdengine_instance **ctxs, Word_t section) {
+    for(size_t tier = 0; tier < RRD_STORAGE_TIERS ; tier++) {
+        if(ctxs[tier] && section == (Word_t)ctxs[tier])
+            return (int)tier;
+    }
+
+    return -1;
+}
+
+// a fingerprint of the datafiles of a tier, to detect snapshots that are stale,
+// i.e. the datafiles they were saved with have been replaced or written since
+// the caller should hold the datafiles lock
+static void mrg_snapshot_tier_fingerprint(struct rrdengine_instance *ctx, uint32_t first_fileno, uint32_t last_fileno, uint32_t *path_checksum, uint32_t *datafiles_checksum) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const void *)ctx->config.dbfiles_path, strlen(ctx->config.dbfiles_path));
+    *path_checksum = (uint32_t)crc;
+
+    crc = crc32(0L, Z_NULL, 0);
+    bool first_then_next = true;
+    Word_t fileno = 0;
+    Pvoid_t *pvalue;
+    while((pvalue = JudyLFirstThenNext(ctx->datafiles.JudyL, &fileno, &first_then_next))) {
+        struct rrdengine_datafile *datafile = *pvalue;
+        if(datafile->fileno < first_fileno || datafile->fileno > last_fileno)
+            continue;
+
+        uint64_t fp[2] = { datafile->fileno, datafile->pos };
+        crc = crc32(crc, (const void *)fp, sizeof(fp));
+    }
+    *datafiles_checksum = (uint32_t)crc;
+}
+
+static inline bool mrg_snapshot_tier_is_valid(struct mrg_snapshot *s, int tier) {
+    return tier >= 0 && __atomic_load_n(&s->state[tier], __ATOMIC_ACQUIRE) == MRG_SNAPSHOT_TIER_VALID;
+}
+
+static inline bool mrg_snapshot_is_promoted(struct mrg_snapshot *s, size_t idx) {
+    return __atomic_load_n(&s->promoted[idx >> 6], __ATOMIC_RELAXED) & (1ULL << (idx & 63));
+}
+
+// returns true when the entry was already promoted
+static inline bool mrg_snapshot_set_promoted(struct mrg_snapshot *s, size_t idx) {
+    uint64_t mask = 1ULL << (idx & 63);
+    bool was_set = __atomic_fetch_or(&s->promoted[idx >> 6], mask, __ATOMIC_RELAXED) & mask;
+
+    if(!was_set)
+        __atomic_add_fetch(&s->promotions, 1, __ATOMIC_RELAXED);
+
+    return was_set;
+}
+
+static ssize_t mrg_snapshot_find(struct mrg_snapshot *s, const nd_uuid_t *uuid, int tier) {
+    struct mrg_snapshot_entry key = { .tier = (uint32_t)tier };
+    memcpy(&key.uuid, uuid, sizeof(nd_uuid_t));
+
+    size_t bucket = mrg_snapshot_bucket(uuid);
+    size_t lo = s->header->buckets[bucket];
+    size_t hi = s->header->buckets[bucket + 1];
+
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int rc = mrg_snapshot_entry_compare(&s->entries[mid], &key);
+
+        if(rc == 0)
+            return (ssize_t)mid;
+
+        if(rc < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return -1;
+}
+
+METRIC *mrg_snapshot_promote(MRG *mrg, nd_uuid_t *uuid, Word_t section) {
+    struct mrg_snapshot *s = mrg->snapshot;
+
+    int tier = mrg_snapshot_section_tier(s->ctx, section);
+    if(!mrg_snapshot_tier_is_valid(s, tier))
+        return NULL;
+
+    ssize_t idx = mrg_snapshot_find(s, uuid, tier);
+    if(idx < 0 || mrg_snapshot_is_promoted(s, idx))
+        return NULL;
+
+    const struct mrg_snapshot_entry *e = &s->entries[idx];
+    MRG_ENTRY entry = {
+        .uuid = uuid,
+        .section = section,
+        .first_time_s = e->first_time_s,
+        .last_time_s = e->last_time_s,
+        .latest_update_every_s = e->update_every_s,
+    };
+
+    // two threads may promote the same entry concurrently - the second one
+    // finds the metric already added, and expanding it again is harmless
+    bool added = false;
+    METRIC *metric = metric_add_and_acquire(mrg, &entry, &added);
+    if(!added)
+        mrg_metric_expand_retention(mrg, metric, e->first_time_s, e->last_time_s, e->update_every_s);
+
+    mrg_snapshot_set_promoted(s, idx);
+    return metric;
+}
+
+static void mrg_snapshot_merge_entry(MRG *mrg, METRIC *metric, int tier) {
+    struct mrg_snapshot *s = mrg->snapshot;
+
+    ssize_t idx = mrg_snapshot_find(s, uuidmap_uuid_ptr(metric->uuid), tier);
+    if(idx < 0 || mrg_snapshot_set_promoted(s, idx))
+        return;
+
+    const struct mrg_snapshot_entry *e = &s->entries[idx];
+    mrg_metric_expand_retention(mrg, metric, e->first_time_s, e->last_time_s, e->update_every_s);
+}
+
+// a metric has just been added to the registry - give it the retention of the snapshot
+void mrg_snapshot_merge(MRG *mrg, METRIC *metric) {
+    int tier = mrg_snapshot_section_tier(mrg->snapshot->ctx, metric->section);
+    if(!mrg_snapshot_tier_is_valid(mrg->snapshot, tier))
+        return;
+
+    mrg_snapshot_merge_entry(mrg, metric, tier);
+}
+
+// metrics added to the registry before the tier was activated (e.g. by the
+// journal v1 replay) get the retention of the snapshot
+static size_t mrg_snapshot_merge_section(MRG *mrg, Word_t section, int tier) {
+    size_t merged = 0;
+
+    for(size_t partition = 0; partition < _countof(mrg->index) ; partition++) {
+        mrg_index_read_lock(mrg, partition);
+
+        bool first_then_next = true;
+        Word_t uuid_index = 0;
+        Pvoid_t *uuid_pvalue;
+        while((uuid_pvalue = JudyLFirstThenNext(mrg->index[partition].uuid_judy, &uuid_index, &first_then_next))) {
+            if(!*uuid_pvalue)
+                continue;
+
+            Pvoid_t *section_pvalue = JudyLGet(*uuid_pvalue, section, PJE0);
+            if(!section_pvalue || section_pvalue == PJERR || !*section_pvalue)
+                continue;
+
+            mrg_snapshot_merge_entry(mrg, *section_pvalue, tier);
+            merged++;
+        }
+
+        mrg_index_read_unlock(mrg, partition);
+    }
+
+    return merged;
+}
+
+bool mrg_snapshot_tier_activate(MRG *mrg, struct rrdengine_instance *ctx) {
+    struct mrg_snapshot *s = mrg->snapshot;
+    if(!s)
+        return false;
+
+    int tier = mrg_snapshot_section_tier(s->ctx, (Word_t)ctx);
+    if(tier < 0)
+        return false;
+
+    const struct mrg_snapshot_tier_header *th = &s->header->tiers[tier];
+    bool valid = th->datafiles > 0;
+
+    // the snapshot is valid only when the datafiles it was saved with are
+    // still there - datafiles added after it are scanned as usual
+    netdata_rwlock_rdlock(&ctx->datafiles.rwlock);
+
+    size_t covered = 0;
+    bool first_then_next = true;
+    Word_t fileno = 0;
+    Pvoid_t *pvalue;
+    while(valid && (pvalue = JudyLFirstThenNext(ctx->datafiles.JudyL, &fileno, &first_then_next))) {
+        struct rrdengine_datafile *datafile = *pvalue;
+
+        if(!covered && datafile->fileno != th->first_fileno)
+            valid = false;
+        else if(datafile->fileno >= th->first_fileno && datafile->fileno <= th->last_fileno)
+            covered++;
+    }
+
+    if(covered != th->datafiles)
+        valid = false;
+
+    bool stale = false;
+    if(valid) {
+        uint32_t path_checksum, datafiles_checksum;
+        mrg_snapshot_tier_fingerprint(ctx, th->first_fileno, th->last_fileno, &path_checksum, &datafiles_checksum);
+        if(path_checksum != th->path_checksum || datafiles_checksum != th->datafiles_checksum)
+            valid = false, stale = true;
+    }
+
+    if(valid) {
+        first_then_next = true;
+        fileno = 0;
+        while((pvalue = JudyLFirstThenNext(ctx->datafiles.JudyL, &fileno, &first_then_next))) {
+            struct rrdengine_datafile *datafile = *pvalue;
+            if(datafile->fileno < th->first_fileno || datafile->fileno > th->last_fileno)
+                continue;
+
+            spinlock_lock(&datafile->populate_mrg.spinlock);
+            datafile->populate_mrg.populated = true;
+            spinlock_unlock(&datafile->populate_mrg.spinlock);
+        }
+    }
+
+    netdata_rwlock_rdunlock(&ctx->datafiles.rwlock);
+
+    if(!valid) {
+        __atomic_store_n(&s->state[tier], MRG_SNAPSHOT_TIER_INVALID, __ATOMIC_RELEASE);
+        nd_log(NDLS_DAEMON, NDLP_NOTICE,
+               "MRG SNAPSHOT: tier %d datafiles %s, journal files will be scanned",
+               tier, stale ? "have been modified since the snapshot was saved" : "do not match the snapshot");
+        return false;
+    }
+
+    __atomic_store_n(&s->state[tier], MRG_SNAPSHOT_TIER_VALID, __ATOMIC_RELEASE);
+
+    size_t merged = mrg_snapshot_merge_section(mrg, (Word_t)ctx, tier);
+
+    time_t first_time_s = (time_t)th->first_time_s;
+    time_t old = __atomic_load_n(&ctx->atomic.first_time_s, __ATOMIC_RELAXED);
+    do {
+        if(!first_time_s || old <= first_time_s)
+            break;
+    } while(!__atomic_compare_exchange_n(&ctx->atomic.first_time_s, &old, first_time_s, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    __atomic_add_fetch(&ctx->atomic.samples, th->samples, __ATOMIC_RELAXED);
+
+    nd_log(NDLS_DAEMON, NDLP_INFO,
+           "MRG SNAPSHOT: tier %d uses the snapshot for %"PRIu64" metrics of %u datafiles (%u to %u), %zu metrics merged",
+           tier, th->entries, th->datafiles, th->first_fileno, th->last_fileno, merged);
+
+    return true;
+}
+
+static bool mrg_snapshot_header_is_valid(const struct mrg_snapshot_header *h, size_t size) {
+    if(h->magic != MRG_SNAPSHOT_MAGIC || h->version != MRG_SNAPSHOT_VERSION ||
+        h->header_size != sizeof(struct mrg_snapshot_header) || h->entry_size != sizeof(struct mrg_snapshot_entry))
+        return false;
+
+    if(size != sizeof(struct mrg_snapshot_header) + h->entries * sizeof(struct mrg_snapshot_entry))
+        return false;
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const void *)h, offsetof(struct mrg_snapshot_header, checksum));
+    if(crc32cmp((void *)&h->checksum, crc))
+        return false;
+
+    if(h->buckets[0] != 0 || h->buckets[MRG_SNAPSHOT_BUCKETS] != h->entries)
+        return false;
+
+    for(size_t b = 0; b < MRG_SNAPSHOT_BUCKETS ; b++) {
+        if(h->buckets[b] > h->buckets[b + 1])
+            return false;
+    }
+
+    return true;
+}
+
+bool mrg_snapshot_load_from_file(MRG *mrg, const char *path, struct rrdengine_instance **ctxs) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct mrg_snapshot_header)) {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *data = nd_mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    // the snapshot is used only once - if we crash, the next startup scans the journal files
+    unlink(path);
+
+    if(data == MAP_FAILED) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "MRG SNAPSHOT: cannot mmap '%s'", path);
+        return false;
+    }
+
+    const struct mrg_snapshot_header *h = data;
+    if(!mrg_snapshot_header_is_valid(h, size)) {
+        nd_log(NDLS_DAEMON, NDLP_WARNING, "MRG SNAPSHOT: '%s' is invalid, ignoring it", path);
+        nd_munmap(data, size);
+        return false;
+    }
+
+    madvise_random(data, size);
+
+    struct mrg_snapshot *s = callocz(1, sizeof(*s));
+    s->header = h;
+    s->entries = (const struct mrg_snapshot_entry *)((const uint8_t *)data + sizeof(*h));
+    s->size = size;
+    s->promoted = callocz((h->entries + 63) / 64 + 1, sizeof(uint64_t));
+    memcpy(s->ctx, ctxs, sizeof(s->ctx));
+    mrg->snapshot = s;
+
+    nd_log(NDLS_DAEMON, NDLP_INFO,
+           "MRG SNAPSHOT: mapped %"PRIu64" metrics (%0.2f MiB) from '%s', saved %"PRId64" seconds ago",
+           h->entries, (double)size / 1024.0 / 1024.0, path, (int64_t)now_realtime_sec() - h->created_s);
+
+    return true;
+}
+
+static bool mrg_snapshot_load(MRG *mrg) {
+    if(unittest_running || !netdata_configured_cache_dir)
+        return false;
+
+    char path[FILENAME_MAX + 1];
+    mrg_snapshot_filename(path, sizeof(path));
+
+    return mrg_snapshot_load_from_file(mrg, path, multidb_ctx);
+}
+
+void mrg_snapshot_destroy(MRG *mrg) {
+    struct mrg_snapshot *s = mrg->snapshot;
+    if(!s)
+        return;
+
+    mrg->snapshot = NULL;
+    nd_munmap((void *)s->header, s->size);
+    freez(s->promoted);
+    freez(s);
+}
+
+static void mrg_snapshot_entry_merge_duplicate(struct mrg_snapshot_entry *dst, const struct mrg_snapshot_entry *src) {
+    if(src->first_time_s > 0 && (dst->first_time_s <= 0 || src->first_time_s < dst->first_time_s))
+        dst->first_time_s = src->first_time_s;
+
+    if(src->last_time_s > dst->last_time_s) {
+        dst->last_time_s = src->last_time_s;
+        if(src->update_every_s)
+            dst->update_every_s = src->update_every_s;
+    }
+    else if(!dst->update_every_s)
+        dst->update_every_s = src->update_every_s;
+}
+
+bool mrg_snapshot_save_to_file(MRG *mrg, const char *path, struct rrdengine_instance **ctxs) {
+    usec_t started_ut = now_monotonic_usec();
+
+    struct mrg_snapshot_header *header = callocz(1, sizeof(*header));
+    header->magic = MRG_SNAPSHOT_MAGIC;
+    header->version = MRG_SNAPSHOT_VERSION;
+    header->header_size = sizeof(struct mrg_snapshot_header);
+    header->entry_size = sizeof(struct mrg_snapshot_entry);
+    header->created_s = now_realtime_sec();
+
+    // only the tiers that have completed loading their retention can be saved
+    bool save_tier[RRD_STORAGE_TIERS] = { 0 };
+    bool save_any = false;
+    for(size_t tier = 0; tier < RRD_STORAGE_TIERS ; tier++) {
+        struct rrdengine_instance *ctx = ctxs[tier];
+        if(!ctx || !__atomic_load_n(&ctx->loading.mrg_populated, __ATOMIC_ACQUIRE))
+            continue;
+
+        struct mrg_snapshot_tier_header *th = &header->tiers[tier];
+
+        netdata_rwlock_rdlock(&ctx->datafiles.rwlock);
+        bool first_then_next = true;
+        Word_t fileno = 0;
+        Pvoid_t *pvalue;
+        while((pvalue = JudyLFirstThenNext(ctx->datafiles.JudyL, &fileno, &first_then_next))) {
+            struct rrdengine_datafile *datafile = *pvalue;
+            if(!th->datafiles)
+                th->first_fileno = datafile->fileno;
+            th->last_fileno = datafile->fileno;
+            th->datafiles++;
+        }
+        mrg_snapshot_tier_fingerprint(ctx, th->first_fileno, th->last_fileno, &th->path_checksum, &th->datafiles_checksum);
+        netdata_rwlock_rdunlock(&ctx->datafiles.rwlock);
+
+        if(!th->datafiles)
+            continue;
+
+        time_t first_time_s = __atomic_load_n(&ctx->atomic.first_time_s, __ATOMIC_RELAXED);
+        th->first_time_s = (first_time_s == LONG_MAX) ? 0 : first_time_s;
+        th->samples = __atomic_load_n(&ctx->atomic.samples, __ATOMIC_RELAXED);
+        save_tier[tier] = true;
+        save_any = true;
+    }
+
+    struct mrg_snapshot *s = mrg->snapshot;
+
+    size_t max_entries = 0;
+    for(size_t partition = 0; partition < _countof(mrg->index) ; partition++)
+        max_entries += __atomic_load_n(&mrg->index[partition].stats.entries, __ATOMIC_RELAXED);
+
+    if(s)
+        max_entries += s->header->entries;
+
+    if(!save_any || !max_entries) {
+        freez(header);
+        return false;
+    }
+
+    char path_tmp[FILENAME_MAX + 1];
+    snprintfz(path_tmp, sizeof(path_tmp), "%s.tmp", path);
+
+    size_t max_size = sizeof(*header) + max_entries * sizeof(struct mrg_snapshot_entry);
+
+    int fd = -1;
+    uint8_t *data = nd_mmap_advanced(path_tmp, max_size, MAP_SHARED, 0, false, true, &fd);
+    if(!data) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "MRG SNAPSHOT: cannot create '%s' of %zu bytes", path_tmp, max_size);
+        if(fd != -1) close(fd);
+        unlink(path_tmp);
+        freez(header);
+        return false;
+    }
+
+    struct mrg_snapshot_entry *entries = (struct mrg_snapshot_entry *)(data + sizeof(*header));
+    size_t used = 0, from_snapshot = 0;
+
+    // the metrics of the registry
+    for(size_t partition = 0; partition < _countof(mrg->index) && used < max_entries ; partition++) {
+        mrg_index_read_lock(mrg, partition);
+
+        bool uuid_first_then_next = true;
+        Word_t uuid_index = 0;
+        Pvoid_t *uuid_pvalue;
+        while(used < max_entries && (uuid_pvalue = JudyLFirstThenNext(mrg->index[partition].uuid_judy, &uuid_index, &uuid_first_then_next))) {
+            bool section_first_then_next = true;
+            Word_t section = 0;
+            Pvoid_t *section_pvalue;
+            while(used < max_entries && (section_pvalue = JudyLFirstThenNext(*uuid_pvalue, &section, &section_first_then_next))) {
+                METRIC *metric = *section_pvalue;
+                if(!metric)
+                    continue;
+
+                int tier = mrg_snapshot_section_tier(ctxs, metric->section);
+                if(tier < 0 || !save_tier[tier])
+                    continue;
+
+                time_t last_time_s = __atomic_load_n(&metric->latest_time_s_clean, __ATOMIC_RELAXED);
+                if(last_time_s <= 0)
+                    continue;
+
+                struct mrg_snapshot_entry *e = &entries[used++];
+                uuidmap_uuid(metric->uuid, e->uuid);
+                e->first_time_s = mrg_metric_get_first_time_s_smart(mrg, metric);
+                e->last_time_s = last_time_s;
+                e->update_every_s = __atomic_load_n(&metric->latest_update_every_s, __ATOMIC_RELAXED);
+                e->tier = (uint32_t)tier;
+            }
+        }
+
+        mrg_index_read_unlock(mrg, partition);
+    }
+
+    // the metrics of the previous snapshot that have not been looked up since startup
+    if(s) {
+        for(size_t i = 0; i < s->header->entries && used < max_entries ; i++) {
+            const struct mrg_snapshot_entry *e = &s->entries[i];
+            if(e->tier >= RRD_STORAGE_TIERS || !save_tier[e->tier] ||
+                !mrg_snapshot_tier_is_valid(s, (int)e->tier) || mrg_snapshot_is_promoted(s, i))
+                continue;
+
+            entries[used++] = *e;
+            from_snapshot++;
+        }
+    }
+
+    qsort(entries, used, sizeof(*entries), mrg_snapshot_entry_compare);
+
+    size_t n = 0;
+    for(size_t i = 0; i < used ; i++) {
+        if(n && mrg_snapshot_entry_compare(&entries[n - 1], &entries[i]) == 0)
+            mrg_snapshot_entry_merge_duplicate(&entries[n - 1], &entries[i]);
+        else
+            entries[n++] = entries[i];
+    }
+
+    size_t bucket = 0;
+    for(size_t i = 0; i < n ; i++) {
+        size_t b = mrg_snapshot_bucket(&entries[i].uuid);
+        while(bucket <= b)
+            header->buckets[bucket++] = i;
+
+        header->tiers[entries[i].tier].entries++;
+    }
+    while(bucket <= MRG_SNAPSHOT_BUCKETS)
+        header->buckets[bucket++] = n;
+
+    header->entries = n;
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (void *)header, offsetof(struct mrg_snapshot_header, checksum));
+    crc32set(&header->checksum, crc);
+    memcpy(data, header, sizeof(*header));
+
+    size_t size = sizeof(*header) + n * sizeof(struct mrg_snapshot_entry);
+    nd_munmap(data, max_size);
+    freez(header);
+
+    bool ok = ftruncate(fd, (off_t)size) == 0 && fsync(fd) == 0;
+    close(fd);
+
+    if(!ok || rename(path_tmp, path) != 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "MRG SNAPSHOT: cannot save '%s'", path);
+        unlink(path_tmp);
+        return false;
+    }
+
+    usec_t ended_ut = now_monotonic_usec();
+    nd_log(NDLS_DAEMON, NDLP_INFO,
+           "MRG SNAPSHOT: saved %zu metrics (%zu carried over from the previous snapshot) to '%s', %0.2f MiB, %0.2f ms",
+           n, from_snapshot, path, (double)size / 1024.0 / 1024.0, (double)(ended_ut - started_ut) / USEC_PER_MS);
+
+    return true;
+}
+
+bool mrg_save(MRG *mrg) {
+    if(!mrg || unittest_running || !netdata_configured_cache_dir)
+        return false;
+
+    char path[FILENAME_MAX + 1];
+    mrg_snapshot_filename(path, sizeof(path));
+
+    return mrg_snapshot_save_to_file(mrg, path, multidb_ctx);
+}
+
 // Main function to load metrics from the database
 bool mrg_load(MRG *mrg) {
+    // the snapshot saved at shutdown replaces prepopulating the registry from the database
+    if(mrg_snapshot_load(mrg))
+        return true;
+
     size_t processed_metrics = populate_metrics_from_database(mrg, (void (*)(void *, Word_t, nd_uuid_t *))mrg_metric_prepopulate);
     return processed_metrics > 0;
 }
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "mrg-internals.h"
+#include "rrdengine.h"
 
 struct mrg_stress_entry {
     nd_uuid_t uuid;
@@ -45,7 +46,200 @@ static void mrg_stress(void *ptr) {
     }
 }
 
+// ----------------------------------------------------------------------------
+// MRG snapshot
+
+static void mrg_snapshot_unittest_datafile_add(struct rrdengine_instance *ctx, unsigned fileno, uint64_t pos) {
+    struct rrdengine_datafile *datafile = callocz(1, sizeof(*datafile));
+    datafile->fileno = fileno;
+    datafile->pos = pos;
+    spinlock_init(&datafile->populate_mrg.spinlock);
+
+    Pvoid_t *PValue = JudyLIns(&ctx->datafiles.JudyL, fileno, PJE0);
+    *PValue = datafile;
+}
+
+static struct rrdengine_datafile *mrg_snapshot_unittest_datafile_get(struct rrdengine_instance *ctx, unsigned fileno) {
+    Pvoid_t *PValue = JudyLGet(ctx->datafiles.JudyL, fileno, PJE0);
+    return PValue ? *PValue : NULL;
+}
+
+static void mrg_snapshot_unittest_datafiles_free(struct rrdengine_instance *ctx) {
+    bool first_then_next = true;
+    Word_t fileno = 0;
+    Pvoid_t *PValue;
+    while((PValue = JudyLFirstThenNext(ctx->datafiles.JudyL, &fileno, &first_then_next)))
+        freez(*PValue);
+
+    JudyLFreeArray(&ctx->datafiles.JudyL, PJE0);
+}
+
+static size_t mrg_snapshot_unittest_lookups(MRG *mrg, struct rrdengine_instance *ctx, nd_uuid_t *uuids, size_t entries, bool expected) {
+    size_t errors = 0;
+
+    for(size_t i = 0; i < entries ; i++) {
+        METRIC *metric = mrg_metric_get_and_acquire_by_uuid(mrg, &uuids[i], (Word_t)ctx);
+        if(!metric) {
+            if(expected) {
+                netdata_log_error("MRG SNAPSHOT: metric %zu is not found in the snapshot", i);
+                errors++;
+            }
+            continue;
+        }
+
+        if(!expected) {
+            netdata_log_error("MRG SNAPSHOT: metric %zu is found, but the snapshot should not be used", i);
+            errors++;
+        }
+
+        time_t first_time_s, last_time_s;
+        uint32_t update_every_s;
+        mrg_metric_get_retention(mrg, metric, &first_time_s, &last_time_s, &update_every_s);
+        if(first_time_s != (time_t)(1000 + i) || last_time_s != (time_t)(2000 + i) || update_every_s != 1 + i % 10) {
+            netdata_log_error("MRG SNAPSHOT: metric %zu has retention %ld - %ld every %u, expected %zu - %zu every %zu",
+                              i, (long)first_time_s, (long)last_time_s, update_every_s, 1000 + i, 2000 + i, 1 + i % 10);
+            errors++;
+        }
+
+        mrg_metric_release(mrg, metric);
+    }
+
+    return errors;
+}
+
+static size_t mrg_snapshot_unittest(void) {
+    size_t errors = 0;
+    size_t entries = 1000;
+
+    struct rrdengine_instance *ctxs[RRD_STORAGE_TIERS] = { 0 };
+    struct rrdengine_instance *ctx = ctxs[0] = callocz(1, sizeof(*ctx));
+    netdata_rwlock_init(&ctx->datafiles.rwlock);
+    strncpyz(ctx->config.dbfiles_path, "/unittest/dbengine", sizeof(ctx->config.dbfiles_path) - 1);
+    ctx->loading.mrg_populated = true;
+    mrg_snapshot_unittest_datafile_add(ctx, 1, 4096);
+    mrg_snapshot_unittest_datafile_add(ctx, 2, 8192);
+
+    char path[FILENAME_MAX + 1];
+    snprintfz(path, sizeof(path), "/tmp/netdata-mrg-snapshot-unittest-%d", (int)getpid());
+
+    nd_uuid_t *uuids = callocz(entries, sizeof(nd_uuid_t));
+
+    MRG *mrg = mrg_create();
+    for(size_t i = 0; i < entries ; i++) {
+        uuid_generate_random(uuids[i]);
+        MRG_ENTRY entry = {
+            .uuid = &uuids[i],
+            .section = (Word_t)ctx,
+            .first_time_s = (time_t)(1000 + i),
+            .last_time_s = (time_t)(2000 + i),
+            .latest_update_every_s = (uint32_t)(1 + i % 10),
+        };
+        bool added;
+        METRIC *metric = mrg_metric_add_and_acquire(mrg, entry, &added);
+        mrg_metric_release(mrg, metric);
+    }
+
+    if(!mrg_snapshot_save_to_file(mrg, path, ctxs)) {
+        netdata_log_error("MRG SNAPSHOT: cannot save the snapshot to '%s'", path);
+        errors++;
+    }
+    mrg_destroy(mrg);
+
+    // a new registry gets the metrics from the snapshot, on lookup
+    mrg = mrg_create();
+    if(!mrg_snapshot_load_from_file(mrg, path, ctxs)) {
+        netdata_log_error("MRG SNAPSHOT: cannot load the snapshot from '%s'", path);
+        errors++;
+    }
+
+    if(access(path, F_OK) == 0) {
+        netdata_log_error("MRG SNAPSHOT: the snapshot has not been unlinked after loading it");
+        errors++;
+    }
+
+    // before the datafiles of the tier are checked, the snapshot is not used
+    errors += mrg_snapshot_unittest_lookups(mrg, ctx, uuids, 1, false);
+
+    if(!mrg_snapshot_tier_activate(mrg, ctx)) {
+        netdata_log_error("MRG SNAPSHOT: the snapshot is not accepted for unmodified datafiles");
+        errors++;
+    }
+
+    if(!mrg_snapshot_unittest_datafile_get(ctx, 1)->populate_mrg.populated ||
+        !mrg_snapshot_unittest_datafile_get(ctx, 2)->populate_mrg.populated) {
+        netdata_log_error("MRG SNAPSHOT: the datafiles covered by the snapshot are not marked populated");
+        errors++;
+    }
+
+    // half of them are looked up, the rest are carried over to the next snapshot
+    errors += mrg_snapshot_unittest_lookups(mrg, ctx, uuids, entries / 2, true);
+
+    nd_uuid_t missing;
+    uuid_generate_random(missing);
+    METRIC *metric = mrg_metric_get_and_acquire_by_uuid(mrg, &missing, (Word_t)ctx);
+    if(metric) {
+        netdata_log_error("MRG SNAPSHOT: a metric not in the snapshot is found");
+        mrg_metric_release(mrg, metric);
+        errors++;
+    }
+
+    if(!mrg_snapshot_save_to_file(mrg, path, ctxs)) {
+        netdata_log_error("MRG SNAPSHOT: cannot save the snapshot again to '%s'", path);
+        errors++;
+    }
+    mrg_destroy(mrg);
+
+    mrg = mrg_create();
+    if(!mrg_snapshot_load_from_file(mrg, path, ctxs) || !mrg_snapshot_tier_activate(mrg, ctx)) {
+        netdata_log_error("MRG SNAPSHOT: cannot use the snapshot saved from a snapshot");
+        errors++;
+    }
+    errors += mrg_snapshot_unittest_lookups(mrg, ctx, uuids, entries, true);
+
+    if(!mrg_snapshot_save_to_file(mrg, path, ctxs)) {
+        netdata_log_error("MRG SNAPSHOT: cannot save the snapshot for the staleness test to '%s'", path);
+        errors++;
+    }
+    mrg_destroy(mrg);
+
+    // a datafile written after the snapshot was saved makes it stale
+    mrg_snapshot_unittest_datafile_get(ctx, 1)->populate_mrg.populated = false;
+    mrg_snapshot_unittest_datafile_get(ctx, 2)->populate_mrg.populated = false;
+    mrg_snapshot_unittest_datafile_get(ctx, 2)->pos += 4096;
+
+    mrg = mrg_create();
+    if(!mrg_snapshot_load_from_file(mrg, path, ctxs)) {
+        netdata_log_error("MRG SNAPSHOT: cannot load the stale snapshot from '%s'", path);
+        errors++;
+    }
+
+    if(mrg_snapshot_tier_activate(mrg, ctx)) {
+        netdata_log_error("MRG SNAPSHOT: a stale snapshot is accepted");
+        errors++;
+    }
+
+    if(mrg_snapshot_unittest_datafile_get(ctx, 2)->populate_mrg.populated) {
+        netdata_log_error("MRG SNAPSHOT: the datafiles of a stale snapshot are marked populated");
+        errors++;
+    }
+
+    errors += mrg_snapshot_unittest_lookups(mrg, ctx, uuids, 1, false);
+    mrg_destroy(mrg);
+
+    unlink(path);
+    freez(uuids);
+    mrg_snapshot_unittest_datafiles_free(ctx);
+    netdata_rwlock_destroy(&ctx->datafiles.rwlock);
+    freez(ctx);
+
+    netdata_log_info("MRG SNAPSHOT: %zu errors", errors);
+    return errors;
+}
+
 int mrg_unittest(void) {
+    if(mrg_snapshot_unittest())
+        fatal("DBENGINE METRIC: the snapshot tests failed");
+
     MRG *mrg = mrg_create();
     METRIC *m1_t0, *m2_t0, *m3_t0, *m4_t0;
     METRIC *m1_t1, *m2_t1, *m3_t1, *m4_t1;
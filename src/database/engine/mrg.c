@@ -87,6 +87,8 @@ size_t mrg_destroy(MRG *mrg) {
         aral_destroy(mrg->index[partition].aral);
     }
 
+    mrg_snapshot_destroy(mrg);
+
     // Unregister the aral statistics
     pulse_aral_unregister_statistics(&mrg_aral_statistics);
 
@@ -101,7 +103,16 @@ METRIC *mrg_metric_add_and_acquire(MRG *mrg, MRG_ENTRY entry, bool *ret) {
 //    internal_fatal(entry.latest_time_s > max_acceptable_collected_time(),
 //        "DBENGINE METRIC: metric latest time is in the future");
 
-    return metric_add_and_acquire(mrg, &entry, ret);
+    bool added = false;
+    METRIC *metric = metric_add_and_acquire(mrg, &entry, &added);
+
+    if(unlikely(added && mrg->snapshot))
+        mrg_snapshot_merge(mrg, metric);
+
+    if(ret)
+        *ret = added;
+
+    return metric;
 }
 
 ALWAYS_INLINE
@@ -109,12 +120,21 @@ METRIC *mrg_metric_get_and_acquire_by_uuid(MRG *mrg, nd_uuid_t *uuid, Word_t sec
     UUIDMAP_ID id = uuidmap_create(*uuid);
     METRIC *metric = metric_get_and_acquire_by_id(mrg, id, section);
     uuidmap_free(id);
+
+    if(unlikely(!metric && mrg->snapshot))
+        metric = mrg_snapshot_promote(mrg, uuid, section);
+
     return metric;
 }
 
 ALWAYS_INLINE
 METRIC *mrg_metric_get_and_acquire_by_id(MRG *mrg, UUIDMAP_ID id, Word_t section) {
-    return metric_get_and_acquire_by_id(mrg, id, section);
+    METRIC *metric = metric_get_and_acquire_by_id(mrg, id, section);
+
+    if(unlikely(!metric && mrg->snapshot))
+        metric = mrg_snapshot_promote(mrg, uuidmap_uuid_ptr(id), section);
+
+    return metric;
 }
 
 ALWAYS_INLINE
@@ -94,8 +94,13 @@ void mrg_update_metric_retention_and_granularity_by_uuid(
     time_t now_s,
     uint64_t *journal_samples);
 
+// the snapshot of the registry is saved at shutdown and used lazily at the next startup
 bool mrg_save(MRG *mrg);
 bool mrg_load(MRG *mrg);
 void mrg_metric_prepopulate_cleanup(MRG *mrg);
 
+struct rrdengine_instance;
+// returns true when the journal files of the tier are covered by the snapshot
+bool mrg_snapshot_tier_activate(MRG *mrg, struct rrdengine_instance *ctx);
+
 #endif // DBENGINE_METRIC_H
@@ -1004,14 +1004,19 @@ static void pgdc_seek(PGDC *pgdc, uint32_t position)
             if (position > pgdc->slots)
                 position = pgdc->slots;
 
-            for (uint32_t i = 0; i != position; i++) {
-                uint32_t value;
-
-                bool ok = gorilla_reader_read(&pgdc->gr, &value);
-                if (!ok) {
+            pgdc->batch.used = 0;
+            pgdc->batch.next = 0;
+
+            uint32_t skipped = 0;
+            while (skipped != position) {
+                uint32_t n = MIN(position - skipped, PGDC_GORILLA_BATCH);
+                size_t decoded = gorilla_reader_read_batch(&pgdc->gr, pgdc->batch.numbers, n);
+                if (!decoded) {
                     // this is fine, the reader will return empty points
                     break;
                 }
+
+                skipped += decoded;
             }
 
             break;
@@ -1061,21 +1066,30 @@ bool pgdc_get_next_point(PGDC *pgdc, uint32_t expected_position __maybe_unused,
     switch (pgdc->pgd->type)
     {
         case RRDENG_PAGE_TYPE_GORILLA_32BIT: {
-            pgdc->position++;
+            if (pgdc->batch.next == pgdc->batch.used) {
+                // decode the next batch of points, up to the slots of the cursor
+                uint32_t n = MIN(pgdc->slots - pgdc->position, PGDC_GORILLA_BATCH);
+                pgdc->batch.used = gorilla_reader_read_batch(&pgdc->gr, pgdc->batch.numbers, n);
+                pgdc->batch.next = 0;
+                unpack_storage_numbers(pgdc->batch.numbers, pgdc->batch.values, pgdc->batch.used);
+            }
 
-            uint32_t n = 666666666;
-            bool ok = gorilla_reader_read(&pgdc->gr, &n);
+            pgdc->position++;
 
-            if (ok) {
-                sp->min = sp->max = sp->sum = unpack_storage_number(n);
-                sp->flags = (SN_FLAGS)(n & SN_USER_FLAGS);
-                sp->count = 1;
-                sp->anomaly_count = is_storage_number_anomalous(n) ? 1 : 0;
-            } else {
+            if (unlikely(pgdc->batch.next == pgdc->batch.used)) {
                 storage_point_empty(*sp, sp->start_time_s, sp->end_time_s);
+                return false;
             }
 
-            return ok;
+            uint32_t next = pgdc->batch.next++;
+            storage_number n = pgdc->batch.numbers[next];
+
+            sp->min = sp->max = sp->sum = pgdc->batch.values[next];
+            sp->flags = (SN_FLAGS)(n & SN_USER_FLAGS);
+            sp->count = 1;
+            sp->anomaly_count = is_storage_number_anomalous(n) ? 1 : 0;
+
+            return true;
         }
         case RRDENG_PAGE_TYPE_ARRAY_TIER1: {
             storage_number_tier1_t *array = (storage_number_tier1_t *) pgdc->pgd->raw.data;
@@ -9,12 +9,22 @@ extern "C" {
 
 #include "libnetdata/libnetdata.h"
 
+// gorilla pages are decoded in batches of this many points
+#define PGDC_GORILLA_BATCH 64
+
 typedef struct pgd_cursor {
     struct pgd *pgd;
     uint32_t position;
     uint32_t slots;
 
     gorilla_reader_t gr;
+
+    struct {
+        uint32_t used;
+        uint32_t next;
+        storage_number numbers[PGDC_GORILLA_BATCH];
+        NETDATA_DOUBLE values[PGDC_GORILLA_BATCH];
+    } batch;
 } PGDC;
 
 #include "rrdengine.h"
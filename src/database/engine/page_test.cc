@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 #include <limits>
 #include <random>
+#include <vector>
 
 bool operator==(const STORAGE_POINT lhs, const STORAGE_POINT rhs) {
     if (lhs.min != rhs.min)
@@ -194,6 +195,43 @@ TEST(PGD, CursorHalfPage) {
     pgd_free(pg);
 }
 
+TEST(PGD, CursorRandomValues) {
+    size_t slots = slots_for_page(64 * 1024);
+    PGD *pg = pgd_create(page_type, slots);
+
+    std::mt19937 mt(slots);
+    std::uniform_real_distribution<NETDATA_DOUBLE> dist(-1000000.0, 1000000.0);
+
+    std::vector<NETDATA_DOUBLE> expected;
+    for (size_t slot = 0; slot != slots; slot++) {
+        // repeat some values, to exercise the same-number path of the decoder
+        NETDATA_DOUBLE n = (slot % 5 == 0 && slot) ? expected.back() : dist(mt);
+
+        pgd_append_point(pg, slot, n, 0, 0, 1, 0, SN_DEFAULT_FLAGS, slot);
+        expected.push_back(unpack_storage_number(pack_storage_number(n, SN_DEFAULT_FLAGS)));
+    }
+
+    // seek to positions that are not aligned to the decoding batches
+    for (size_t position : { (size_t) 0, (size_t) 1, (size_t) 63, (size_t) 65, slots / 3, slots - 1 }) {
+        PGDC cursor;
+        pgdc_reset(&cursor, pg, position);
+
+        STORAGE_POINT sp;
+        for (size_t slot = position; slot != slots; slot++) {
+            EXPECT_TRUE(pgdc_get_next_point(&cursor, slot, &sp));
+
+            EXPECT_EQ(expected[slot], sp.min);
+            EXPECT_EQ(sp.min, sp.max);
+            EXPECT_EQ(sp.min, sp.sum);
+            EXPECT_EQ(sp.count, 1);
+        }
+
+        EXPECT_FALSE(pgdc_get_next_point(&cursor, slots, &sp));
+    }
+
+    pgd_free(pg);
+}
+
 TEST(PGD, MemoryFootprint) {
     size_t slots = slots_for_page(1024 * 1024);
     PGD *pg = pgd_create(page_type, slots);
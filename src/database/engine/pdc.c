@@ -13,6 +13,12 @@ struct extent_page_details_list {
     struct rrdeng_cmd *cmd;
     bool head_to_datafile_extent_queries_pending_for_extent;
 
+    struct {
+        struct rrdengine_instance *ctx;
+        void *extent_data;
+        ssize_t ret;
+    } async_read;
+
     struct {
         struct extent_page_details_list *prev;
         struct extent_page_details_list *next;
@@ -535,10 +541,12 @@ static ALWAYS_INLINE bool epdl_pending_add(EPDL *epdl) {
 
         __atomic_add_fetch(&rrdeng_cache_efficiency_stats.pages_load_extent_merged, 1, __ATOMIC_RELAXED);
 
-//        if(e->base->pdc->priority > epdl->pdc->priority) {
-//            e->base->pdc->priority = epdl->pdc->priority;
-//            rrdeng_req_cmd(epdl_get_cmd, e->base, epdl->pdc->priority);
-//        }
+        // when the read is still queued at a lower priority, move it to ours,
+        // so that we don't wait behind the queries we would not wait for.
+        // e->base cannot be destroyed while we hold e->spinlock, and the
+        // command queue lock is always taken after it.
+        if(e->base->pdc->priority > epdl->pdc->priority)
+            rrdeng_req_cmd(epdl_get_cmd, e->base, epdl->pdc->priority);
     }
     else {
         added_new = true;
@@ -554,7 +562,12 @@ static ALWAYS_INLINE bool epdl_pending_add(EPDL *epdl) {
 static ALWAYS_INLINE void epdl_pending_del(EPDL *epdl) {
     EPDL_EXTENT *e = epdl_find_extent_base(epdl);
     spinlock_lock(&e->spinlock);
-    e->base = NULL;
+
+    // another query may have started a new read of the same extent
+    // after we stopped accepting more queries - don't detach it
+    if(e->base == epdl)
+        e->base = NULL;
+
     spinlock_unlock(&e->spinlock);
 }
 
@@ -956,6 +969,20 @@ static ALWAYS_INLINE struct page_details *epdl_get_pd_load_link_list_from_metric
     return pd_list;
 }
 
+// the time-window covered by all the queries waiting for this extent
+static void epdl_queries_time_window(EPDL *epdl, time_t *after_s, time_t *before_s) {
+    *after_s = epdl->pdc->start_time_s;
+    *before_s = epdl->pdc->end_time_s;
+
+    for(EPDL *ep = epdl->query.next; ep ;ep = ep->query.next) {
+        if(ep->pdc->start_time_s < *after_s)
+            *after_s = ep->pdc->start_time_s;
+
+        if(ep->pdc->end_time_s > *before_s)
+            *before_s = ep->pdc->end_time_s;
+    }
+}
+
 static void epdl_extent_loading_error_log(struct rrdengine_instance *ctx, EPDL *epdl, struct rrdeng_extent_page_descr *descr, const char *msg, ND_LOG_FIELD_PRIORITY priority) {
     char uuid[UUID_STR_LEN] = "";
     time_t start_time_s = 0;
@@ -1132,6 +1159,14 @@ static bool epdl_populate_pages_from_extent_data(
     size_t stats_load_uncompressed = 0;
     size_t stats_load_invalid_page = 0;
     size_t stats_cache_hit_while_inserting = 0;
+    size_t stats_load_lookahead = 0;
+
+    // look-ahead: the extent has already been read and decompressed, so we also load the pages
+    // of the other metrics it has for the time-window of the queries waiting for it.
+    // Extents are written per collection cycle, so they hold the sibling metrics of the ones
+    // queried, which the same queries (or the next dashboard refreshes) are about to ask for.
+    time_t lookahead_after_s = 0, lookahead_before_s = 0;
+    bool lookahead_checked = false, lookahead = false;
 
     uint32_t page_offset = 0, page_length;
     time_t now_s = max_acceptable_collected_time();
@@ -1157,14 +1192,41 @@ static bool epdl_populate_pages_from_extent_data(
         mrg_metric_release(main_mrg, metric);
 
         struct page_details *pd_list = epdl_get_pd_load_link_list_from_metric_start_time(epdl, metric_id, start_time_s);
-        if(likely(!pd_list))
-            continue;
+        if(likely(!pd_list)) {
+            if(unlikely(!lookahead_checked)) {
+                // decided once per extent, and only while the main cache is below the size
+                // it starts evicting at, so that these pages never push out pages in use.
+                // The list of queries is frozen after the first lookup above.
+                lookahead = dbengine_extent_lookahead && !have_read_error && pgc_is_below_healthy_size(main_cache);
+                if(lookahead)
+                    epdl_queries_time_window(epdl, &lookahead_after_s, &lookahead_before_s);
+
+                lookahead_checked = true;
+            }
+
+            if(!lookahead)
+                continue;
+
+            time_t end_time_s = (time_t) (header->descr[i].end_time_ut / USEC_PER_SEC);
+            if(end_time_s < lookahead_after_s || start_time_s > lookahead_before_s)
+                continue;
+
+            PGC_PAGE *cached = pgc_page_get_and_acquire(main_cache, (Word_t)ctx, metric_id, start_time_s, PGC_SEARCH_EXACT);
+            if(cached) {
+                pgc_page_release(main_cache, cached);
+                continue;
+            }
+        }
 
         VALIDATED_PAGE_DESCRIPTOR vd = validate_extent_page_descr(
                 &header->descr[i], now_s,
                 (pd_list) ? pd_list->update_every_s : 0,
                 have_read_error);
 
+        if(unlikely(!pd_list && !vd.is_valid))
+            // don't cache invalid pages nobody asked for
+            continue;
+
         if(worker)
             worker_is_busy(UV_EVENT_DBENGINE_EXTENT_PAGE_ALLOCATION);
 
@@ -1179,7 +1241,8 @@ static bool epdl_populate_pages_from_extent_data(
                 pgd = pgd_create_from_disk_data(header->descr[i].type,
                                                       data + payload_offset + page_offset,
                                                 vd.page_length);
-                stats_load_uncompressed++;
+                if(pd_list)
+                    stats_load_uncompressed++;
             }
             else {
                 if (unlikely(page_offset + vd.page_length > uncompressed_payload_length)) {
@@ -1189,6 +1252,9 @@ static bool epdl_populate_pages_from_extent_data(
                                         i, count, page_offset, vd.page_length, uncompressed_payload_length);
                     epdl_extent_loading_error_log(ctx, epdl, &header->descr[i], log, NDLP_ERR);
 
+                    if(!pd_list)
+                        continue;
+
                     pgd = PGD_EMPTY;
                     stats_load_invalid_page++;
                 }
@@ -1196,7 +1262,8 @@ static bool epdl_populate_pages_from_extent_data(
                     pgd = pgd_create_from_disk_data(header->descr[i].type,
                                                     uncompressed_buf + page_offset,
                                                     vd.page_length);
-                    stats_load_compressed++;
+                    if(pd_list)
+                        stats_load_compressed++;
                 }
             }
         }
@@ -1217,6 +1284,21 @@ static bool epdl_populate_pages_from_extent_data(
 
         bool added = true;
         PGC_PAGE *page = pgc_page_add_and_acquire(main_cache, page_entry, &added);
+
+        if(!pd_list) {
+            if(false == added)
+                pgd_free(pgd);
+            else
+                stats_load_lookahead++;
+
+            pgc_page_release(main_cache, page);
+
+            if(worker)
+                worker_is_busy(UV_EVENT_DBENGINE_EXTENT_PAGE_LOOKUP);
+
+            continue;
+        }
+
         if (false == added) {
             pgd_free(pgd);
             pgd = pgc_page_data(page);
@@ -1263,6 +1345,9 @@ static bool epdl_populate_pages_from_extent_data(
     if(stats_load_invalid_page)
         __atomic_add_fetch(&rrdeng_cache_efficiency_stats.pages_load_fail_invalid_page_in_extent, stats_load_invalid_page, __ATOMIC_RELAXED);
 
+    if(stats_load_lookahead)
+        __atomic_add_fetch(&rrdeng_cache_efficiency_stats.pages_load_ok_lookahead, stats_load_lookahead, __ATOMIC_RELAXED);
+
     if(worker)
         worker_is_idle();
 
@@ -1271,120 +1356,73 @@ static bool epdl_populate_pages_from_extent_data(
     return true;
 }
 
+// returns the extent in a buffer allocated with dbengine_extent_alloc()
 static inline void *datafile_extent_read(struct rrdengine_instance *ctx, uv_file file, uint32_t block, unsigned size_bytes)
 {
-    void *buffer = NULL;
-    uv_fs_t request;
-
     unsigned real_io_size = ALIGN_BYTES_CEILING(size_bytes);
-    (void)posix_memalignz(&buffer, RRDFILE_ALIGNMENT, real_io_size);
-
-    uv_buf_t iov = uv_buf_init(buffer, real_io_size);
-    int ret = uv_fs_read(NULL, &request, file, &iov, 1, (int64_t) BLOCK_TO_OFFSET(block), NULL);
-    if (unlikely(-1 == ret)) {
-        ctx_io_error(ctx);
-        posix_memalign_freez(buffer);
-        buffer = NULL;
-    }
-    else
-        ctx_io_read_op_bytes(ctx, real_io_size);
-
-    uv_fs_req_cleanup(&request);
+    void *extent_data = dbengine_extent_alloc(size_bytes);
 
-    return buffer;
-}
+    ssize_t ret = dbengine_uring_read_extent(file, extent_data, size_bytes, real_io_size, BLOCK_TO_OFFSET(block));
+    if (ret == -ENOSYS) {
+        // io_uring is not available, read it synchronously
+        void *buffer = NULL;
+        uv_fs_t request;
 
-static inline void datafile_extent_read_free(void *buffer) {
-    posix_memalign_freez(buffer);
-}
+        (void)posix_memalignz(&buffer, RRDFILE_ALIGNMENT, real_io_size);
 
-NOT_INLINE_HOT void epdl_find_extent_and_populate_pages(struct rrdengine_instance *ctx, EPDL *epdl, bool worker) {
-    if(worker)
-        worker_is_busy(UV_EVENT_DBENGINE_EXTENT_CACHE_LOOKUP);
+        uv_buf_t iov = uv_buf_init(buffer, real_io_size);
+        ret = uv_fs_read(NULL, &request, file, &iov, 1, (int64_t) BLOCK_TO_OFFSET(block), NULL);
+        if (ret >= 0)
+            memcpy(extent_data, buffer, size_bytes);
 
-    size_t *statistics_counter = NULL;
-    PDC_PAGE_STATUS not_loaded_pages_tag = 0, loaded_pages_tag = 0;
-
-    bool should_stop = __atomic_load_n(&epdl->pdc->workers_should_stop, __ATOMIC_RELAXED);
-    for(EPDL *ep = epdl->query.next; ep ;ep = ep->query.next) {
-        internal_fatal(ep->datafile != epdl->datafile, "DBENGINE: datafiles do not match");
-        internal_fatal(ep->extent_block != epdl->extent_block, "DBENGINE: extent blocks do not match");
-        internal_fatal(ep->extent_size != epdl->extent_size, "DBENGINE: extent sizes do not match");
-
-        if(!__atomic_load_n(&ep->pdc->workers_should_stop, __ATOMIC_RELAXED)) {
-            should_stop = false;
-            break;
-        }
+        uv_fs_req_cleanup(&request);
+        posix_memalign_freez(buffer);
     }
 
-    if(unlikely(should_stop)) {
-        statistics_counter = &rrdeng_cache_efficiency_stats.pages_load_fail_cancelled;
-        not_loaded_pages_tag = PDC_PAGE_CANCELLED;
-        goto cleanup;
+    if (unlikely(ret < 0)) {
+        ctx_io_error(ctx);
+        dbengine_extent_free(extent_data, size_bytes);
+        return NULL;
     }
 
-    bool extent_found_in_cache = false;
-
-    void *extent_compressed_data = NULL;
-    PGC_PAGE *extent_cache_page = pgc_page_get_and_acquire(
-            extent_cache, (Word_t)ctx,
-            (Word_t)epdl->datafile->fileno, (time_t)epdl->extent_block,
-            PGC_SEARCH_EXACT);
+    ctx_io_read_op_bytes(ctx, real_io_size);
+    return extent_data;
+}
 
-    if(extent_cache_page) {
-        extent_compressed_data = pgc_page_data(extent_cache_page);
-        internal_fatal(epdl->extent_size != pgc_page_data_size(extent_cache, extent_cache_page),
-                       "DBENGINE: cache size does not match the expected size");
+static void epdl_complete(EPDL *epdl, PDC_PAGE_STATUS not_loaded_pages_tag, size_t *statistics_counter, bool worker) {
+    // remove it from the datafile extent_queries
+    // this can be called multiple times safely
+    epdl_pending_del(epdl);
 
-        loaded_pages_tag |= PDC_PAGE_EXTENT_FROM_CACHE;
-        not_loaded_pages_tag |= PDC_PAGE_EXTENT_FROM_CACHE;
-        extent_found_in_cache = true;
+    // mark all pending pages as failed
+    for(EPDL *ep = epdl; ep ;ep = ep->query.next) {
+        epdl_mark_all_not_loaded_pages_as_failed(
+                ep, not_loaded_pages_tag, statistics_counter);
     }
-    else {
-        if(worker)
-            worker_is_busy(UV_EVENT_DBENGINE_EXTENT_MMAP);
 
-        void *extent_data = datafile_extent_read(ctx, epdl->datafile->file, epdl->extent_block, epdl->extent_size);
-        if(extent_data != NULL) {
+    for(EPDL *ep = epdl, *next = NULL; ep ; ep = next) {
+        next = ep->query.next;
 
-            void *tmp = dbengine_extent_alloc(epdl->extent_size);
-            memcpy(tmp, extent_data, epdl->extent_size);
-            datafile_extent_read_free(extent_data);
-            extent_data = tmp;
+        completion_mark_complete_a_job(&ep->pdc->page_completion);
+        pdc_release_and_destroy_if_unreferenced(ep->pdc, true, false);
 
-            if(worker)
-                worker_is_busy(UV_EVENT_DBENGINE_EXTENT_CACHE_LOOKUP);
-
-            bool added = false;
-            extent_cache_page = pgc_page_add_and_acquire(extent_cache, (PGC_ENTRY) {
-                    .hot = false,
-                    .section = (Word_t) ctx,
-                    .metric_id = (Word_t) epdl->datafile->fileno,
-                    .start_time_s = (time_t) epdl->extent_block,
-                    .size = epdl->extent_size,
-                    .end_time_s = 0,
-                    .update_every_s = 0,
-                    .data = extent_data,
-            }, &added);
-
-            if (!added) {
-                dbengine_extent_free(extent_data, epdl->extent_size);
-                internal_fatal(epdl->extent_size != pgc_page_data_size(extent_cache, extent_cache_page),
-                               "DBENGINE: cache size does not match the expected size");
-            }
+        // Free the Judy that holds the requested pagelist and the extents
+        epdl_destroy(ep);
+    }
 
-            extent_compressed_data = pgc_page_data(extent_cache_page);
+    if(worker)
+        worker_is_idle();
+}
 
-            loaded_pages_tag |= PDC_PAGE_EXTENT_FROM_DISK;
-            not_loaded_pages_tag |= PDC_PAGE_EXTENT_FROM_DISK;
-        }
-    }
+static void epdl_populate_pages_from_extent_cache_page(struct rrdengine_instance *ctx, EPDL *epdl, PGC_PAGE *extent_cache_page, PDC_PAGE_STATUS tags, bool extent_found_in_cache, bool worker) {
+    size_t *statistics_counter = NULL;
+    PDC_PAGE_STATUS not_loaded_pages_tag = tags;
 
-    if(extent_compressed_data) {
+    if(extent_cache_page) {
         // Need to decompress and then process the pagelist
         bool extent_used = epdl_populate_pages_from_extent_data(
-                ctx, extent_compressed_data, epdl->extent_size,
-                epdl, worker, loaded_pages_tag, extent_found_in_cache);
+                ctx, pgc_page_data(extent_cache_page), epdl->extent_size,
+                epdl, worker, tags, extent_found_in_cache);
 
         if(extent_used) {
             // since the extent was used, all the pages that are not
@@ -1396,36 +1434,133 @@ NOT_INLINE_HOT void epdl_find_extent_and_populate_pages(struct rrdengine_instanc
             not_loaded_pages_tag |= PDC_PAGE_FAILED_INVALID_EXTENT;
             statistics_counter = &rrdeng_cache_efficiency_stats.pages_load_fail_invalid_extent;
         }
+
+        pgc_page_release(extent_cache, extent_cache_page);
     }
     else {
         not_loaded_pages_tag |= PDC_PAGE_FAILED_TO_MAP_EXTENT;
         statistics_counter = &rrdeng_cache_efficiency_stats.pages_load_fail_cant_mmap_extent;
     }
 
-    if(extent_cache_page)
-        pgc_page_release(extent_cache, extent_cache_page);
+    epdl_complete(epdl, not_loaded_pages_tag, statistics_counter, worker);
+}
 
-cleanup:
-    // remove it from the datafile extent_queries
-    // this can be called multiple times safely
-    epdl_pending_del(epdl);
+static void epdl_populate_pages_from_extent_read(struct rrdengine_instance *ctx, EPDL *epdl, void *extent_data, bool worker) {
+    PGC_PAGE *extent_cache_page = NULL;
+    PDC_PAGE_STATUS tags = 0;
 
-    // mark all pending pages as failed
-    for(EPDL *ep = epdl; ep ;ep = ep->query.next) {
-        epdl_mark_all_not_loaded_pages_as_failed(
-                ep, not_loaded_pages_tag, statistics_counter);
+    if(extent_data != NULL) {
+        if(worker)
+            worker_is_busy(UV_EVENT_DBENGINE_EXTENT_CACHE_LOOKUP);
+
+        bool added = false;
+        extent_cache_page = pgc_page_add_and_acquire(extent_cache, (PGC_ENTRY) {
+                .hot = false,
+                .section = (Word_t) ctx,
+                .metric_id = (Word_t) epdl->datafile->fileno,
+                .start_time_s = (time_t) epdl->extent_block,
+                .size = epdl->extent_size,
+                .end_time_s = 0,
+                .update_every_s = 0,
+                .data = extent_data,
+        }, &added);
+
+        if (!added) {
+            dbengine_extent_free(extent_data, epdl->extent_size);
+            internal_fatal(epdl->extent_size != pgc_page_data_size(extent_cache, extent_cache_page),
+                           "DBENGINE: cache size does not match the expected size");
+        }
+
+        tags |= PDC_PAGE_EXTENT_FROM_DISK;
     }
 
-    for(EPDL *ep = epdl, *next = NULL; ep ; ep = next) {
-        next = ep->query.next;
+    epdl_populate_pages_from_extent_cache_page(ctx, epdl, extent_cache_page, tags, false, worker);
+}
 
-        completion_mark_complete_a_job(&ep->pdc->page_completion);
-        pdc_release_and_destroy_if_unreferenced(ep->pdc, true, false);
+static void epdl_extent_read_async_cb(void *data, ssize_t ret) {
+    EPDL *epdl = data;
+    epdl->async_read.ret = ret;
+    rrdeng_extent_read_completed(epdl->async_read.ctx, epdl);
+}
 
-        // Free the Judy that holds the requested pagelist and the extents
-        epdl_destroy(ep);
+NOT_INLINE_HOT void epdl_populate_pages_after_async_read(struct rrdengine_instance *ctx, EPDL *epdl, bool worker) {
+    if(worker)
+        worker_is_busy(UV_EVENT_DBENGINE_EXTENT_MMAP);
+
+    void *extent_data = epdl->async_read.extent_data;
+    ssize_t ret = epdl->async_read.ret;
+    epdl->async_read.extent_data = NULL;
+
+    if(ret == -ENOSYS) {
+        // io_uring gave up on it, read it synchronously
+        dbengine_extent_free(extent_data, epdl->extent_size);
+        extent_data = datafile_extent_read(ctx, epdl->datafile->file, epdl->extent_block, epdl->extent_size);
+    }
+    else if(unlikely(ret < 0)) {
+        ctx_io_error(ctx);
+        dbengine_extent_free(extent_data, epdl->extent_size);
+        extent_data = NULL;
     }
+    else
+        ctx_io_read_op_bytes(ctx, ALIGN_BYTES_CEILING(epdl->extent_size));
+
+    epdl_populate_pages_from_extent_read(ctx, epdl, extent_data, worker);
+}
 
+NOT_INLINE_HOT void epdl_find_extent_and_populate_pages(struct rrdengine_instance *ctx, EPDL *epdl, bool worker) {
     if(worker)
-        worker_is_idle();
+        worker_is_busy(UV_EVENT_DBENGINE_EXTENT_CACHE_LOOKUP);
+
+    bool should_stop = __atomic_load_n(&epdl->pdc->workers_should_stop, __ATOMIC_RELAXED);
+    for(EPDL *ep = epdl->query.next; ep ;ep = ep->query.next) {
+        internal_fatal(ep->datafile != epdl->datafile, "DBENGINE: datafiles do not match");
+        internal_fatal(ep->extent_block != epdl->extent_block, "DBENGINE: extent blocks do not match");
+        internal_fatal(ep->extent_size != epdl->extent_size, "DBENGINE: extent sizes do not match");
+
+        if(!__atomic_load_n(&ep->pdc->workers_should_stop, __ATOMIC_RELAXED)) {
+            should_stop = false;
+            break;
+        }
+    }
+
+    if(unlikely(should_stop)) {
+        epdl_complete(epdl, PDC_PAGE_CANCELLED, &rrdeng_cache_efficiency_stats.pages_load_fail_cancelled, worker);
+        return;
+    }
+
+    PGC_PAGE *extent_cache_page = pgc_page_get_and_acquire(
+            extent_cache, (Word_t)ctx,
+            (Word_t)epdl->datafile->fileno, (time_t)epdl->extent_block,
+            PGC_SEARCH_EXACT);
+
+    if(extent_cache_page) {
+        internal_fatal(epdl->extent_size != pgc_page_data_size(extent_cache, extent_cache_page),
+                       "DBENGINE: cache size does not match the expected size");
+
+        epdl_populate_pages_from_extent_cache_page(ctx, epdl, extent_cache_page, PDC_PAGE_EXTENT_FROM_CACHE, true, worker);
+        return;
+    }
+
+    if(worker) {
+        // do not keep the worker waiting for the disk,
+        // the event loop will dispatch the rest of the work when the read completes
+        void *extent_data = dbengine_extent_alloc(epdl->extent_size);
+        epdl->async_read.ctx = ctx;
+        epdl->async_read.extent_data = extent_data;
+
+        if(dbengine_uring_read_extent_async(
+                epdl->datafile->file, extent_data, epdl->extent_size, ALIGN_BYTES_CEILING(epdl->extent_size),
+                BLOCK_TO_OFFSET(epdl->extent_block), epdl_extent_read_async_cb, epdl)) {
+            worker_is_idle();
+            return;
+        }
+
+        epdl->async_read.extent_data = NULL;
+        dbengine_extent_free(extent_data, epdl->extent_size);
+
+        worker_is_busy(UV_EVENT_DBENGINE_EXTENT_MMAP);
+    }
+
+    void *extent_data = datafile_extent_read(ctx, epdl->datafile->file, epdl->extent_block, epdl->extent_size);
+    epdl_populate_pages_from_extent_read(ctx, epdl, extent_data, worker);
 }
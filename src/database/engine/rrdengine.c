@@ -1075,8 +1075,11 @@ static void *extent_write_tp_worker(
     int retries = 10;
     int ret = -1;
     while (ret < 0 && --retries) {
-        ret = uv_fs_write(NULL, &request, datafile->file, &iov, 1, (int64_t)xt_io_descr->pos, NULL);
-        uv_fs_req_cleanup(&request);
+        ret = (int)dbengine_uring_write(datafile->file, iov.base, iov.len, xt_io_descr->pos);
+        if (ret == -ENOSYS) {
+            ret = uv_fs_write(NULL, &request, datafile->file, &iov, 1, (int64_t)xt_io_descr->pos, NULL);
+            uv_fs_req_cleanup(&request);
+        }
         if (ret < 0) {
             if (ret == -ENOSPC || ret == -EBADF || ret == -EACCES || ret == -EROFS || ret == -EINVAL)
                 break;
@@ -1657,6 +1660,9 @@ static void *populate_mrg_tp_worker(
     struct mrg_load_thread *mlt = data;
     int tier = ctx->config.tier;
 
+    // the datafiles covered by the MRG snapshot are marked as populated
+    mrg_snapshot_tier_activate(main_mrg, ctx);
+
     netdata_rwlock_rdlock(&ctx->datafiles.rwlock);
 
     size_t total_datafiles = 0;
@@ -1671,6 +1677,7 @@ static void *populate_mrg_tp_worker(
 
     if (total_datafiles == 0) {
         nd_log_daemon(NDLP_WARNING, "DBENGINE: No datafiles to populate MRG");
+        __atomic_store_n(&ctx->loading.mrg_populated, true, __ATOMIC_RELEASE);
         worker_is_idle();
         return data;
     }
@@ -1727,6 +1734,7 @@ static void *populate_mrg_tp_worker(
         }
     } while (pending > 0);
 
+    __atomic_store_n(&ctx->loading.mrg_populated, true, __ATOMIC_RELEASE);
     worker_is_idle();
     return data;
 }
@@ -1861,6 +1869,20 @@ static void *extent_read_tp_worker(struct rrdengine_instance *ctx __maybe_unused
     return data;
 }
 
+static void *extent_read_completed_tp_worker(struct rrdengine_instance *ctx __maybe_unused, void *data __maybe_unused, struct completion *completion __maybe_unused, uv_work_t *uv_work_req __maybe_unused) {
+    EPDL *epdl = data;
+    epdl_populate_pages_after_async_read(ctx, epdl, true);
+    return data;
+}
+
+// called by the event loop when an asynchronous extent read completes
+void rrdeng_extent_read_completed(struct rrdengine_instance *ctx, EPDL *epdl) {
+    // while shutting down, the event loop does not run the work callbacks anymore
+    if(rrdeng_main.shutdown ||
+       !work_dispatch(ctx, epdl, NULL, RRDENG_OPCODE_EXTENT_READ, extent_read_completed_tp_worker, NULL))
+        epdl_populate_pages_after_async_read(ctx, epdl, false);
+}
+
 static NOT_INLINE_HOT void epdl_populate_pages_asynchronously(struct rrdengine_instance *ctx, EPDL *epdl, STORAGE_PRIORITY priority) {
     rrdeng_enq_cmd(ctx, RRDENG_OPCODE_EXTENT_READ, epdl, NULL, priority,
                    rrdeng_enqueue_epdl_cmd, rrdeng_dequeue_epdl_cmd);
@@ -2148,6 +2170,7 @@ static void timer_per_sec_cb(uv_timer_t *handle __maybe_unused)
     worker_set_metric(RRDENG_OPCODES_WAITING, (NETDATA_DOUBLE)rrdeng_main.cmd_queue.unsafe.waiting);
     worker_set_metric(RRDENG_WORKS_DISPATCHED, (NETDATA_DOUBLE)__atomic_load_n(&rrdeng_main.work_cmd.atomics.dispatched, __ATOMIC_RELAXED));
     worker_set_metric(RRDENG_WORKS_EXECUTING, (NETDATA_DOUBLE)__atomic_load_n(&rrdeng_main.work_cmd.atomics.executing, __ATOMIC_RELAXED));
+    worker_set_metric(RRDENG_URING_IN_FLIGHT, (NETDATA_DOUBLE)dbengine_uring_in_flight());
 
     rrdeng_enq_cmd(NULL, RRDENG_OPCODE_FLUSH_MAIN, NULL, NULL, STORAGE_PRIORITY_INTERNAL_DBENGINE, NULL, NULL);
     rrdeng_enq_cmd(NULL, RRDENG_OPCODE_CLEANUP, NULL, NULL, STORAGE_PRIORITY_INTERNAL_DBENGINE, NULL, NULL);
@@ -2341,10 +2364,12 @@ void dbengine_event_loop(void* arg) {
     // special jobs
     worker_register_job_name(RRDENG_RETENTION_TIMER_CB,                              "retention timer");
     worker_register_job_name(RRDENG_TIMER_CB,                                        "timer");
+    worker_register_job_name(RRDENG_URING_CB,                                        "io_uring");
 
     worker_register_job_custom_metric(RRDENG_OPCODES_WAITING,  "opcodes waiting",  "opcodes", WORKER_METRIC_ABSOLUTE);
     worker_register_job_custom_metric(RRDENG_WORKS_DISPATCHED, "works dispatched", "works",   WORKER_METRIC_ABSOLUTE);
     worker_register_job_custom_metric(RRDENG_WORKS_EXECUTING,  "works executing",  "works",   WORKER_METRIC_ABSOLUTE);
+    worker_register_job_custom_metric(RRDENG_URING_IN_FLIGHT,  "io_uring in flight", "requests", WORKER_METRIC_ABSOLUTE);
 
     struct rrdeng_main *main = arg;
     enum rrdeng_opcode opcode;
@@ -2354,6 +2379,9 @@ void dbengine_event_loop(void* arg) {
     fatal_assert(0 == uv_timer_start(&main->timer, timer_per_sec_cb, TIMER_PERIOD_MS, TIMER_PERIOD_MS));
     fatal_assert(0 == uv_timer_start(&main->retention_timer, retention_timer_cb, TIMER_PERIOD_MS * 60, TIMER_PERIOD_MS * 60));
 
+    // extent I/O falls back to synchronous libuv calls when this fails
+    dbengine_uring_init(&main->loop);
+
     bool shutdown = false;
     size_t cpus = netdata_conf_cpus();
     uv_sem_t sem;
@@ -2520,6 +2548,9 @@ void dbengine_event_loop(void* arg) {
                 }
 
                 case RRDENG_OPCODE_SHUTDOWN_EVLOOP: {
+                    main->shutdown = true;
+                    dbengine_uring_shutdown();
+
                     uv_close((uv_handle_t *)&main->async, NULL);
 
                     (void) uv_timer_stop(&main->timer);
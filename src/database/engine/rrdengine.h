@@ -19,6 +19,7 @@
 #include "cache.h"
 #include "pdc.h"
 #include "page.h"
+#include "dbengine-uring.h"
 
 #include "daemon/protected-access.h"
 
@@ -299,6 +300,8 @@ enum rrdeng_opcode {
 #define RRDENG_WORKS_DISPATCHED            (RRDENG_TIMER_CB + 2)
 #define RRDENG_WORKS_EXECUTING             (RRDENG_TIMER_CB + 3)
 #define RRDENG_RETENTION_TIMER_CB          (RRDENG_TIMER_CB + 4)
+#define RRDENG_URING_CB                    (RRDENG_TIMER_CB + 5)
+#define RRDENG_URING_IN_FLIGHT             (RRDENG_TIMER_CB + 6)
 
 struct extent_io_data {
     unsigned fileno;
@@ -437,6 +440,7 @@ struct rrdengine_instance {
     struct {
         struct completion load_mrg;
         bool create_new_datafile_pair;
+        bool mrg_populated;                         // the retention of all journal files is in MRG
     } loading;
 
     struct rrdengine_statistics stats;
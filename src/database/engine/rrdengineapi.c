@@ -61,6 +61,8 @@ __attribute__((constructor)) void initialize_multidb_ctx(void) {
 
 uint64_t dbengine_out_of_memory_protection = 0;
 bool dbengine_use_all_ram_for_caches = false;
+bool dbengine_use_io_uring = false;
+bool dbengine_extent_lookahead = false;
 int db_engine_journal_check = 0;
 bool new_dbengine_defaults = false;
 bool legacy_multihost_db_space = false;
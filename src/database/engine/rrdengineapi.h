@@ -15,6 +15,8 @@
 
 extern uint64_t dbengine_out_of_memory_protection;
 extern bool dbengine_use_all_ram_for_caches;
+extern bool dbengine_use_io_uring;
+extern bool dbengine_extent_lookahead;
 
 extern int default_rrdeng_page_cache_mb;
 extern int default_rrdeng_extent_cache_mb;
@@ -180,6 +182,7 @@ struct rrdeng_cache_efficiency_stats {
     PAD64(size_t) pages_load_extent_merged;
     PAD64(size_t) pages_load_ok_uncompressed;
     PAD64(size_t) pages_load_ok_compressed;
+    PAD64(size_t) pages_load_ok_lookahead;                     // pages of other metrics loaded from extents read for queries
     PAD64(size_t) pages_load_fail_invalid_page_in_extent;
     PAD64(size_t) pages_load_fail_cant_mmap_extent;
     PAD64(size_t) pages_load_fail_datafile_not_available;
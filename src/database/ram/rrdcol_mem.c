@@ -0,0 +1,768 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rrdcol_mem.h"
+#include "Judy.h"
+
+// both arrays are protected by the same lock, so that a chart block
+// cannot be deleted while a new column is being assigned to it
+static Pvoid_t rrdcol_metrics_Judy = NULL;
+static Pvoid_t rrdcol_charts_Judy = NULL;
+static netdata_rwlock_t rrdcol_Judy_rwlock;
+
+static void __attribute__((constructor)) init_lock(void) {
+    netdata_rwlock_init(&rrdcol_Judy_rwlock);
+}
+
+static void __attribute__((destructor)) destroy_lock(void) {
+    netdata_rwlock_destroy(&rrdcol_Judy_rwlock);
+}
+
+// ----------------------------------------------------------------------------
+// chart blocks
+
+struct rrdcol_metric_handle;
+
+struct rrdcol_chart {
+    UUIDMAP_ID id;                  // the chart uuid
+
+    // readers are all the collectors and queries touching the rows,
+    // the writer is the one growing the columns or resetting the rows
+    RW_SPINLOCK rw_spinlock;
+
+    uint32_t entries;               // the number of rows
+    uint32_t columns;               // the row stride
+    uint32_t used;                  // the number of columns assigned to metrics
+
+    time_t update_every_s;
+    time_t last_time_s;             // the latest row stored
+
+    time_t *row_time_s;             // the timestamp of each row, 0 when the row is empty
+    struct rrdcol_metric_handle **column_metric; // the metric of each column, NULL when free
+    storage_number *data;           // entries * columns, time-major
+};
+
+struct rrdcol_metric_handle {
+    UUIDMAP_ID id;
+    struct rrdcol_chart *chart;
+    uint32_t column;                // changes when the columns are compacted, read it under the chart lock
+
+    time_t first_time_s;
+    time_t last_time_s;
+
+    REFCOUNT refcount;
+};
+
+static inline size_t rrdcol_chart_memory(struct rrdcol_chart *ch) {
+    return sizeof(*ch) +
+           ch->entries * sizeof(time_t) +
+           ch->columns * sizeof(struct rrdcol_metric_handle *) +
+           (size_t)ch->entries * ch->columns * sizeof(storage_number);
+}
+
+// the row stride for this number of columns
+static inline uint32_t rrdcol_columns_for(uint32_t columns) {
+    if(!columns)
+        return 1;
+
+    if(columns < RRDCOL_COLUMNS_ALIGN_MIN)
+        return columns;
+
+    return (columns + RRDCOL_COLUMNS_ALIGN - 1) / RRDCOL_COLUMNS_ALIGN * RRDCOL_COLUMNS_ALIGN;
+}
+
+static inline size_t rrdcol_time2row(struct rrdcol_chart *ch, time_t t) {
+    return (size_t)(t / ch->update_every_s) % ch->entries;
+}
+
+static inline bool rrdcol_same_slot(struct rrdcol_chart *ch, time_t a, time_t b) {
+    return a && b && (a / ch->update_every_s) == (b / ch->update_every_s);
+}
+
+static void rrdcol_chart_reset_rows(struct rrdcol_chart *ch) {
+    for(size_t i = 0; i < ch->entries; i++)
+        ch->row_time_s[i] = 0;
+
+    ch->last_time_s = 0;
+}
+
+static storage_number *rrdcol_chart_data_alloc(uint32_t entries, uint32_t columns) {
+    size_t cells = (size_t)entries * columns;
+    storage_number *data = mallocz(cells * sizeof(storage_number));
+    for(size_t i = 0; i < cells; i++)
+        data[i] = SN_EMPTY_SLOT;
+
+    return data;
+}
+
+// must be called with rrdcol_Judy_rwlock write locked
+static struct rrdcol_chart *rrdcol_chart_get_or_create_unsafe(RRDSET *st) {
+    UUIDMAP_ID id = uuidmap_create(st->chart_uuid);
+
+    JudyAllocThreadPulseReset();
+    Pvoid_t *PValue = JudyLIns(&rrdcol_charts_Judy, id, PJE0);
+    int64_t judy_mem = JudyAllocThreadPulseGetAndReset();
+
+    struct rrdcol_chart *ch = *PValue;
+    if(ch) {
+        uuidmap_free(id);
+        return ch;
+    }
+
+    ch = callocz(1, sizeof(*ch));
+    ch->id = id;
+    rw_spinlock_init(&ch->rw_spinlock);
+    ch->entries = (uint32_t)(st->db.entries < 5 ? 5 : st->db.entries);
+    ch->update_every_s = st->update_every ? st->update_every : 1;
+    ch->columns = rrdcol_columns_for(1);
+    ch->row_time_s = callocz(ch->entries, sizeof(time_t));
+    ch->column_metric = callocz(ch->columns, sizeof(struct rrdcol_metric_handle *));
+    ch->data = rrdcol_chart_data_alloc(ch->entries, ch->columns);
+    *PValue = ch;
+
+    pulse_db_rrd_memory_change(judy_mem + (int64_t)rrdcol_chart_memory(ch));
+    return ch;
+}
+
+// must be called with rrdcol_Judy_rwlock write locked
+// changes the row stride, moving the columns in use to the first ones, in their order
+static void rrdcol_chart_resize_unsafe(struct rrdcol_chart *ch, uint32_t new_columns) {
+    size_t old_memory = rrdcol_chart_memory(ch);
+
+    storage_number *data = rrdcol_chart_data_alloc(ch->entries, new_columns);
+    struct rrdcol_metric_handle **column_metric = callocz(new_columns, sizeof(struct rrdcol_metric_handle *));
+
+    rw_spinlock_write_lock(&ch->rw_spinlock);
+
+    uint32_t used = 0;
+    for(uint32_t c = 0; c < ch->columns; c++) {
+        struct rrdcol_metric_handle *mh = ch->column_metric[c];
+        if(!mh)
+            continue;
+
+        for(size_t row = 0; row < ch->entries; row++)
+            data[row * new_columns + used] = ch->data[row * ch->columns + c];
+
+        mh->column = used;
+        column_metric[used++] = mh;
+    }
+
+    storage_number *old_data = ch->data;
+    struct rrdcol_metric_handle **old_column_metric = ch->column_metric;
+    ch->data = data;
+    ch->column_metric = column_metric;
+    ch->columns = new_columns;
+
+    rw_spinlock_write_unlock(&ch->rw_spinlock);
+
+    freez(old_data);
+    freez(old_column_metric);
+    pulse_db_rrd_memory_change((int64_t)rrdcol_chart_memory(ch) - (int64_t)old_memory);
+}
+
+// must be called with rrdcol_Judy_rwlock write locked
+static void rrdcol_chart_column_acquire_unsafe(struct rrdcol_chart *ch, struct rrdcol_metric_handle *mh) {
+    if(ch->used == ch->columns) {
+        // all columns are taken, grow the row stride by about 1/4
+        uint32_t new_columns = ch->columns + ch->columns / 4;
+        if(new_columns <= ch->columns)
+            new_columns = ch->columns + 1;
+
+        rrdcol_chart_resize_unsafe(ch, rrdcol_columns_for(new_columns));
+    }
+
+    for(uint32_t c = 0; c < ch->columns; c++) {
+        if(!ch->column_metric[c]) {
+            ch->column_metric[c] = mh;
+            mh->column = c;
+            ch->used++;
+            return;
+        }
+    }
+
+    fatal("DB_COLUMNAR: no free column in a chart block with %u of %u columns used", ch->used, ch->columns);
+}
+
+// must be called with rrdcol_Judy_rwlock write locked
+static void rrdcol_chart_column_release_unsafe(struct rrdcol_chart *ch, struct rrdcol_metric_handle *mh) {
+    ch->column_metric[mh->column] = NULL;
+
+    if(--ch->used) {
+        // compact the columns, when more than 1/4 of the row stride is not needed
+        uint32_t needed = rrdcol_columns_for(ch->used);
+        if(ch->columns - needed > ch->columns / 4)
+            rrdcol_chart_resize_unsafe(ch, needed);
+
+        return;
+    }
+
+    JudyAllocThreadPulseReset();
+    JudyLDel(&rrdcol_charts_Judy, ch->id, PJE0);
+    int64_t judy_mem = JudyAllocThreadPulseGetAndReset();
+
+    pulse_db_rrd_memory_change(judy_mem - (int64_t)rrdcol_chart_memory(ch));
+
+    uuidmap_free(ch->id);
+    freez(ch->data);
+    freez(ch->column_metric);
+    freez(ch->row_time_s);
+    freez(ch);
+}
+
+// ----------------------------------------------------------------------------
+// metric handles
+
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_or_create(RRDDIM *rd, STORAGE_INSTANCE *si) {
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)rrdcol_metric_get_by_id(si, rd->uuid);
+    while(!mh) {
+        netdata_rwlock_wrlock(&rrdcol_Judy_rwlock);
+        JudyAllocThreadPulseReset();
+        Pvoid_t *PValue = JudyLIns(&rrdcol_metrics_Judy, rd->uuid, PJE0);
+        int64_t judy_mem = JudyAllocThreadPulseGetAndReset();
+        mh = *PValue;
+        if(!mh) {
+            mh = callocz(1, sizeof(struct rrdcol_metric_handle));
+            mh->id = rd->uuid;
+            mh->chart = rrdcol_chart_get_or_create_unsafe(rd->rrdset);
+            rrdcol_chart_column_acquire_unsafe(mh->chart, mh);
+            mh->refcount = 1;
+            *PValue = mh;
+            pulse_db_rrd_memory_change(judy_mem + (int64_t)sizeof(struct rrdcol_metric_handle));
+        }
+        else {
+            if(!refcount_acquire(&mh->refcount))
+                mh = NULL;
+        }
+        netdata_rwlock_wrunlock(&rrdcol_Judy_rwlock);
+    }
+
+    return (STORAGE_METRIC_HANDLE *)mh;
+}
+
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_by_id(STORAGE_INSTANCE *si __maybe_unused, UUIDMAP_ID id) {
+    struct rrdcol_metric_handle *mh = NULL;
+
+    netdata_rwlock_rdlock(&rrdcol_Judy_rwlock);
+    {
+        Pvoid_t *PValue = JudyLGet(rrdcol_metrics_Judy, id, PJE0);
+        if (unlikely(PValue == PJERR))
+            fatal("DB_COLUMNAR: corrupted judy array!");
+
+        if (likely(NULL != PValue)) {
+            mh = *PValue;
+            if (!refcount_acquire(&mh->refcount))
+                mh = NULL;
+        }
+    }
+    netdata_rwlock_rdunlock(&rrdcol_Judy_rwlock);
+
+    return (STORAGE_METRIC_HANDLE *)mh;
+}
+
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_by_uuid(STORAGE_INSTANCE *si, nd_uuid_t *uuid) {
+    UUIDMAP_ID id = uuidmap_create(*uuid);
+    STORAGE_METRIC_HANDLE *mh = rrdcol_metric_get_by_id(si, id);
+    uuidmap_free(id);
+    return mh;
+}
+
+STORAGE_METRIC_HANDLE *rrdcol_metric_dup(STORAGE_METRIC_HANDLE *smh) {
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)smh;
+
+    if(!refcount_acquire(&mh->refcount))
+        fatal("DB_COLUMNAR: cannot acquire an already acquired refcount");
+
+    return smh;
+}
+
+void rrdcol_metric_release(STORAGE_METRIC_HANDLE *smh) {
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)smh;
+
+    if(refcount_release_and_acquire_for_deletion(&mh->refcount)) {
+        // we can delete it
+
+        int64_t judy_mem = 0;
+        netdata_rwlock_wrlock(&rrdcol_Judy_rwlock);
+        {
+            JudyAllocThreadPulseReset();
+            JudyLDel(&rrdcol_metrics_Judy, mh->id, PJE0);
+            judy_mem = JudyAllocThreadPulseGetAndReset();
+
+            rrdcol_chart_column_release_unsafe(mh->chart, mh);
+        }
+        netdata_rwlock_wrunlock(&rrdcol_Judy_rwlock);
+
+        freez(mh);
+        pulse_db_rrd_memory_change(judy_mem - (int64_t)sizeof(struct rrdcol_metric_handle));
+    }
+}
+
+// the retention of a metric is limited by both its own collection
+// and the rows of the chart that have not been recycled yet
+static void rrdcol_metric_retention(struct rrdcol_metric_handle *mh, time_t *first_entry_s, time_t *last_entry_s) {
+    struct rrdcol_chart *ch = mh->chart;
+
+    time_t first_s = __atomic_load_n(&mh->first_time_s, __ATOMIC_RELAXED);
+    time_t last_s = __atomic_load_n(&mh->last_time_s, __ATOMIC_RELAXED);
+    time_t chart_last_s = __atomic_load_n(&ch->last_time_s, __ATOMIC_RELAXED);
+    time_t window_first_s = chart_last_s - (time_t)(ch->entries - 1) * ch->update_every_s;
+
+    if(first_s < window_first_s)
+        first_s = window_first_s;
+
+    if(!last_s || first_s > last_s)
+        first_s = last_s = 0;
+
+    *first_entry_s = first_s;
+    *last_entry_s = last_s;
+}
+
+bool rrdcol_metric_retention_by_uuid(STORAGE_INSTANCE *si __maybe_unused, nd_uuid_t *uuid, time_t *first_entry_s, time_t *last_entry_s) {
+    STORAGE_METRIC_HANDLE *smh = rrdcol_metric_get_by_uuid(si, uuid);
+    if(!smh)
+        return false;
+
+    rrdcol_metric_retention((struct rrdcol_metric_handle *)smh, first_entry_s, last_entry_s);
+    rrdcol_metric_release(smh);
+
+    return true;
+}
+
+bool rrdcol_metric_retention_by_id(STORAGE_INSTANCE *si __maybe_unused, UUIDMAP_ID id, time_t *first_entry_s, time_t *last_entry_s) {
+    STORAGE_METRIC_HANDLE *smh = rrdcol_metric_get_by_id(si, id);
+    if(!smh)
+        return false;
+
+    rrdcol_metric_retention((struct rrdcol_metric_handle *)smh, first_entry_s, last_entry_s);
+    rrdcol_metric_release(smh);
+
+    return true;
+}
+
+void rrdcol_retention_delete_by_id(STORAGE_INSTANCE *si __maybe_unused, UUIDMAP_ID id __maybe_unused) {
+    ;
+}
+
+// ----------------------------------------------------------------------------
+// data collection
+
+// resets all the rows, when the chart changes collection frequency
+static void rrdcol_chart_set_update_every(struct rrdcol_chart *ch, time_t update_every_s) {
+    if(update_every_s < 1)
+        update_every_s = 1;
+
+    if(ch->update_every_s == update_every_s)
+        return;
+
+    rw_spinlock_write_lock(&ch->rw_spinlock);
+    if(ch->update_every_s != update_every_s) {
+        ch->update_every_s = update_every_s;
+        rrdcol_chart_reset_rows(ch);
+    }
+    rw_spinlock_write_unlock(&ch->rw_spinlock);
+}
+
+void rrdcol_store_metric_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every) {
+    struct rrdcol_collect_handle *ch = (struct rrdcol_collect_handle *)sch;
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)ch->smh;
+
+    rrdcol_store_metric_flush(sch);
+    rrdcol_chart_set_update_every(mh->chart, update_every);
+}
+
+STORAGE_COLLECT_HANDLE *rrdcol_collect_init(STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg __maybe_unused) {
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)smh;
+
+    rrdcol_chart_set_update_every(mh->chart, (time_t)update_every);
+
+    struct rrdcol_collect_handle *ch = callocz(1, sizeof(struct rrdcol_collect_handle));
+    ch->common.seb = STORAGE_ENGINE_BACKEND_COLUMNAR;
+    ch->smh = smh;
+
+    pulse_db_rrd_memory_add(sizeof(struct rrdcol_collect_handle));
+
+    return (STORAGE_COLLECT_HANDLE *)ch;
+}
+
+void rrdcol_store_metric_flush(STORAGE_COLLECT_HANDLE *sch) {
+    struct rrdcol_collect_handle *ch = (struct rrdcol_collect_handle *)sch;
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)ch->smh;
+    struct rrdcol_chart *chart = mh->chart;
+
+    rw_spinlock_read_lock(&chart->rw_spinlock);
+    for(size_t row = 0; row < chart->entries; row++)
+        chart->data[row * chart->columns + mh->column] = SN_EMPTY_SLOT;
+    rw_spinlock_read_unlock(&chart->rw_spinlock);
+
+    __atomic_store_n(&mh->first_time_s, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&mh->last_time_s, 0, __ATOMIC_RELAXED);
+}
+
+void rrdcol_collect_store_metric(STORAGE_COLLECT_HANDLE *sch,
+                                 usec_t point_in_time_ut,
+                                 NETDATA_DOUBLE n,
+                                 NETDATA_DOUBLE min_value __maybe_unused,
+                                 NETDATA_DOUBLE max_value __maybe_unused,
+                                 uint16_t count __maybe_unused,
+                                 uint16_t anomaly_count __maybe_unused,
+                                 SN_FLAGS flags)
+{
+    struct rrdcol_collect_handle *ch = (struct rrdcol_collect_handle *)sch;
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)ch->smh;
+    struct rrdcol_chart *chart = mh->chart;
+
+    time_t point_in_time_s = (time_t)(point_in_time_ut / USEC_PER_SEC);
+
+    if(unlikely(point_in_time_s <= mh->last_time_s))
+        return;
+
+    rw_spinlock_read_lock(&chart->rw_spinlock);
+
+    size_t row = rrdcol_time2row(chart, point_in_time_s);
+    storage_number *cells = &chart->data[row * chart->columns];
+
+    if(__atomic_load_n(&chart->row_time_s[row], __ATOMIC_ACQUIRE) != point_in_time_s) {
+        // the first dimension of the chart stored at this time,
+        // recycle the row for all the dimensions of the chart
+        __atomic_store_n(&chart->row_time_s[row], 0, __ATOMIC_RELEASE);
+
+        for(size_t c = 0; c < chart->columns; c++)
+            cells[c] = SN_EMPTY_SLOT;
+
+        __atomic_store_n(&chart->row_time_s[row], point_in_time_s, __ATOMIC_RELEASE);
+
+        if(point_in_time_s > chart->last_time_s)
+            __atomic_store_n(&chart->last_time_s, point_in_time_s, __ATOMIC_RELAXED);
+    }
+
+    cells[mh->column] = pack_storage_number(n, flags);
+
+    rw_spinlock_read_unlock(&chart->rw_spinlock);
+
+    if(unlikely(!mh->first_time_s))
+        __atomic_store_n(&mh->first_time_s, point_in_time_s, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&mh->last_time_s, point_in_time_s, __ATOMIC_RELAXED);
+}
+
+int rrdcol_collect_finalize(STORAGE_COLLECT_HANDLE *sch) {
+    freez(sch);
+    pulse_db_rrd_memory_sub(sizeof(struct rrdcol_collect_handle));
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// database query functions
+
+void rrdcol_query_init(STORAGE_METRIC_HANDLE *smh, struct storage_engine_query_handle *seqh, time_t start_time_s, time_t end_time_s, STORAGE_PRIORITY priority) {
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)smh;
+
+    seqh->start_time_s = start_time_s;
+    seqh->end_time_s = end_time_s;
+    seqh->priority = priority;
+    seqh->seb = STORAGE_ENGINE_BACKEND_COLUMNAR;
+
+    struct rrdcol_query_handle *h = mallocz(sizeof(struct rrdcol_query_handle));
+    h->smh = smh;
+    h->dt = mh->chart->update_every_s;
+    h->next_timestamp = start_time_s;
+    rrdcol_metric_retention(mh, &h->first_timestamp, &h->last_timestamp);
+
+    pulse_db_rrd_memory_add(sizeof(struct rrdcol_query_handle));
+    seqh->handle = (STORAGE_QUERY_HANDLE *)h;
+}
+
+// Returns the metric and sets its timestamp into current_time
+// IT IS REQUIRED TO **ALWAYS** SET ALL RETURN VALUES (current_time, end_time, flags)
+// IT IS REQUIRED TO **ALWAYS** KEEP TRACK OF TIME, EVEN OUTSIDE THE DATABASE BOUNDARIES
+ALWAYS_INLINE STORAGE_POINT rrdcol_query_next_metric(struct storage_engine_query_handle *seqh) {
+    struct rrdcol_query_handle *h = (struct rrdcol_query_handle *)seqh->handle;
+    struct rrdcol_metric_handle *mh = (struct rrdcol_metric_handle *)h->smh;
+    struct rrdcol_chart *chart = mh->chart;
+
+    STORAGE_POINT sp;
+    sp.count = 1;
+
+    time_t this_timestamp = h->next_timestamp;
+    h->next_timestamp += h->dt;
+
+    // set this timestamp for our caller
+    sp.start_time_s = this_timestamp - h->dt;
+    sp.end_time_s = this_timestamp;
+
+    if(unlikely(this_timestamp < h->first_timestamp || this_timestamp > h->last_timestamp)) {
+        storage_point_empty(sp, sp.start_time_s, sp.end_time_s);
+        return sp;
+    }
+
+    storage_number n = SN_EMPTY_SLOT;
+
+    rw_spinlock_read_lock(&chart->rw_spinlock);
+    {
+        size_t row = rrdcol_time2row(chart, this_timestamp);
+        time_t row_time_s = __atomic_load_n(&chart->row_time_s[row], __ATOMIC_ACQUIRE);
+
+        if(likely(rrdcol_same_slot(chart, row_time_s, this_timestamp))) {
+            n = chart->data[row * chart->columns + mh->column];
+
+            // the collector may have recycled the row while we were reading it
+            if(unlikely(__atomic_load_n(&chart->row_time_s[row], __ATOMIC_ACQUIRE) != row_time_s))
+                n = SN_EMPTY_SLOT;
+        }
+    }
+    rw_spinlock_read_unlock(&chart->rw_spinlock);
+
+    if(unlikely(!does_storage_number_exist(n))) {
+        storage_point_empty(sp, sp.start_time_s, sp.end_time_s);
+        return sp;
+    }
+
+    sp.anomaly_count = is_storage_number_anomalous(n) ? 1 : 0;
+    sp.flags = (n & SN_USER_FLAGS);
+    sp.min = sp.max = sp.sum = unpack_storage_number(n);
+
+    return sp;
+}
+
+int rrdcol_query_is_finished(struct storage_engine_query_handle *seqh) {
+    struct rrdcol_query_handle *h = (struct rrdcol_query_handle *)seqh->handle;
+    return (h->next_timestamp > seqh->end_time_s);
+}
+
+void rrdcol_query_finalize(struct storage_engine_query_handle *seqh) {
+    internal_error(!rrdcol_query_is_finished(seqh),
+                   "QUERY: columnar query has been stopped unfinished");
+
+    freez(seqh->handle);
+    pulse_db_rrd_memory_sub(sizeof(struct rrdcol_query_handle));
+}
+
+time_t rrdcol_query_align_to_optimal_before(struct storage_engine_query_handle *seqh) {
+    return seqh->end_time_s;
+}
+
+time_t rrdcol_query_latest_time_s(STORAGE_METRIC_HANDLE *smh) {
+    time_t first_entry_s, last_entry_s;
+    rrdcol_metric_retention((struct rrdcol_metric_handle *)smh, &first_entry_s, &last_entry_s);
+    return last_entry_s;
+}
+
+time_t rrdcol_query_oldest_time_s(STORAGE_METRIC_HANDLE *smh) {
+    time_t first_entry_s, last_entry_s;
+    rrdcol_metric_retention((struct rrdcol_metric_handle *)smh, &first_entry_s, &last_entry_s);
+    return first_entry_s;
+}
+
+// ----------------------------------------------------------------------------
+// unittest - netdata -W columnartest
+
+#define RRDCOL_UNITTEST_DIMS 6
+#define RRDCOL_UNITTEST_ENTRIES 10
+#define RRDCOL_UNITTEST_START_S 1000
+#define RRDCOL_UNITTEST_POINTS 15
+#define RRDCOL_UNITTEST_GAP_DIM 2
+#define RRDCOL_UNITTEST_GAP_S (RRDCOL_UNITTEST_START_S + 11)
+#define RRDCOL_UNITTEST_WIDE_DIMS 17
+
+static NETDATA_DOUBLE rrdcol_unittest_value(size_t d, time_t t) {
+    return (NETDATA_DOUBLE)(d * 100 + (size_t)(t - RRDCOL_UNITTEST_START_S));
+}
+
+static size_t rrdcol_unittest_query(STORAGE_METRIC_HANDLE *smh, size_t d, time_t after_s, time_t before_s, time_t expected_first_s, time_t expected_last_s) {
+    size_t errors = 0;
+
+    struct storage_engine_query_handle seqh = { 0 };
+    rrdcol_query_init(smh, &seqh, after_s, before_s, STORAGE_PRIORITY_NORMAL);
+
+    for(time_t t = after_s; !rrdcol_query_is_finished(&seqh) ; t++) {
+        STORAGE_POINT sp = rrdcol_query_next_metric(&seqh);
+
+        bool expected_gap = t < expected_first_s || t > expected_last_s ||
+                            (d == RRDCOL_UNITTEST_GAP_DIM && t == RRDCOL_UNITTEST_GAP_S);
+
+        if(sp.end_time_s != t) {
+            fprintf(stderr, "DB_COLUMNAR: dimension %zu, expected a point at %ld, got one at %ld\n",
+                    d, (long)t, (long)sp.end_time_s);
+            errors++;
+        }
+        else if(expected_gap != storage_point_is_gap(sp)) {
+            fprintf(stderr, "DB_COLUMNAR: dimension %zu, at %ld, expected %s, got %s\n",
+                    d, (long)t, expected_gap ? "a gap" : "a value", storage_point_is_gap(sp) ? "a gap" : "a value");
+            errors++;
+        }
+        else if(!expected_gap && sp.sum != rrdcol_unittest_value(d, t)) {
+            fprintf(stderr, "DB_COLUMNAR: dimension %zu, at %ld, expected " NETDATA_DOUBLE_FORMAT ", got " NETDATA_DOUBLE_FORMAT "\n",
+                    d, (long)t, rrdcol_unittest_value(d, t), sp.sum);
+            errors++;
+        }
+    }
+
+    rrdcol_query_finalize(&seqh);
+    return errors;
+}
+
+// the row stride follows the dimensions of a chart, as they are added one by one
+static size_t rrdcol_unittest_stride(void) {
+    size_t errors = 0;
+
+    RRDSET *st = callocz(1, sizeof(RRDSET));
+    uuid_generate(st->chart_uuid);
+    st->db.entries = RRDCOL_UNITTEST_ENTRIES;
+    st->update_every = 1;
+
+    RRDDIM *rds[RRDCOL_UNITTEST_WIDE_DIMS];
+    STORAGE_METRIC_HANDLE *smhs[RRDCOL_UNITTEST_WIDE_DIMS];
+
+    for(size_t d = 0; d < RRDCOL_UNITTEST_WIDE_DIMS ; d++) {
+        nd_uuid_t uuid;
+        uuid_generate(uuid);
+
+        rds[d] = callocz(1, sizeof(RRDDIM));
+        rds[d]->uuid = uuidmap_create(uuid);
+        rds[d]->rrdset = st;
+        smhs[d] = rrdcol_metric_get_or_create(rds[d], NULL);
+
+        struct rrdcol_chart *chart = ((struct rrdcol_metric_handle *)smhs[d])->chart;
+        size_t dims = d + 1;
+
+        // small charts are not padded, larger ones are padded and grow by about 1/4
+        bool ok = (dims < RRDCOL_COLUMNS_ALIGN_MIN) ?
+                  chart->columns == dims :
+                  (chart->columns >= dims && chart->columns % RRDCOL_COLUMNS_ALIGN == 0 &&
+                   chart->columns <= dims + dims / 4 + RRDCOL_COLUMNS_ALIGN);
+
+        if(!ok) {
+            fprintf(stderr, "DB_COLUMNAR: the chart has %u columns for %zu dimensions\n", chart->columns, dims);
+            errors++;
+        }
+    }
+
+    for(size_t d = 0; d < RRDCOL_UNITTEST_WIDE_DIMS ; d++) {
+        rrdcol_metric_release(smhs[d]);
+        uuidmap_free(rds[d]->uuid);
+        freez(rds[d]);
+    }
+    freez(st);
+
+    return errors;
+}
+
+int rrdcol_unittest(void) {
+    size_t errors = rrdcol_unittest_stride();
+
+    RRDSET *st = callocz(1, sizeof(RRDSET));
+    uuid_generate(st->chart_uuid);
+    st->db.entries = RRDCOL_UNITTEST_ENTRIES;
+    st->update_every = 1;
+
+    RRDDIM *rds[RRDCOL_UNITTEST_DIMS];
+    STORAGE_METRIC_HANDLE *smhs[RRDCOL_UNITTEST_DIMS];
+    STORAGE_COLLECT_HANDLE *schs[RRDCOL_UNITTEST_DIMS];
+
+    // more dimensions than the initial row stride, so that the columns are grown
+    for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        nd_uuid_t uuid;
+        uuid_generate(uuid);
+
+        rds[d] = callocz(1, sizeof(RRDDIM));
+        rds[d]->uuid = uuidmap_create(uuid);
+        rds[d]->rrdset = st;
+
+        smhs[d] = rrdcol_metric_get_or_create(rds[d], NULL);
+        schs[d] = rrdcol_collect_init(smhs[d], 1, NULL);
+    }
+
+    struct rrdcol_chart *chart = ((struct rrdcol_metric_handle *)smhs[0])->chart;
+    for(size_t d = 1; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        if(((struct rrdcol_metric_handle *)smhs[d])->chart != chart) {
+            fprintf(stderr, "DB_COLUMNAR: dimension %zu does not share the block of the chart\n", d);
+            errors++;
+        }
+    }
+
+    if(chart->columns != rrdcol_columns_for(RRDCOL_UNITTEST_DIMS)) {
+        fprintf(stderr, "DB_COLUMNAR: the chart has %u columns for %d dimensions\n", chart->columns, RRDCOL_UNITTEST_DIMS);
+        errors++;
+    }
+
+    // store more points than the rows, so that the oldest rows are recycled
+    for(time_t t = RRDCOL_UNITTEST_START_S; t < RRDCOL_UNITTEST_START_S + RRDCOL_UNITTEST_POINTS ; t++) {
+        for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+            if(d == RRDCOL_UNITTEST_GAP_DIM && t == RRDCOL_UNITTEST_GAP_S)
+                continue;
+
+            rrdcol_collect_store_metric(schs[d], (usec_t)t * USEC_PER_SEC, rrdcol_unittest_value(d, t),
+                                        NAN, NAN, 1, 0, SN_DEFAULT_FLAGS);
+        }
+    }
+
+    time_t last_s = RRDCOL_UNITTEST_START_S + RRDCOL_UNITTEST_POINTS - 1;
+    time_t first_s = last_s - (RRDCOL_UNITTEST_ENTRIES - 1);
+
+    for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        time_t f = rrdcol_query_oldest_time_s(smhs[d]), l = rrdcol_query_latest_time_s(smhs[d]);
+        if(f != first_s || l != last_s) {
+            fprintf(stderr, "DB_COLUMNAR: dimension %zu has retention %ld - %ld, expected %ld - %ld\n",
+                    d, (long)f, (long)l, (long)first_s, (long)last_s);
+            errors++;
+        }
+
+        // the query covers the recycled rows and goes beyond the last point
+        errors += rrdcol_unittest_query(smhs[d], d, RRDCOL_UNITTEST_START_S, last_s + 2, first_s, last_s);
+    }
+
+    // old points are ignored
+    rrdcol_collect_store_metric(schs[0], (usec_t)first_s * USEC_PER_SEC, -1, NAN, NAN, 1, 0, SN_DEFAULT_FLAGS);
+    errors += rrdcol_unittest_query(smhs[0], 0, first_s, last_s, first_s, last_s);
+
+    // releasing the dimensions in the middle compacts the columns, keeping the values of the others
+    bool released[RRDCOL_UNITTEST_DIMS] = { 0 };
+    for(size_t d = 1; d < RRDCOL_UNITTEST_DIMS - 2 ; d++) {
+        rrdcol_collect_finalize(schs[d]);
+        rrdcol_metric_release(smhs[d]);
+        released[d] = true;
+    }
+
+    if(chart->used != 3 || chart->columns >= RRDCOL_UNITTEST_DIMS) {
+        fprintf(stderr, "DB_COLUMNAR: the chart has %u columns for %u dimensions, after releasing some\n",
+                chart->columns, chart->used);
+        errors++;
+    }
+
+    for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        if(!released[d])
+            errors += rrdcol_unittest_query(smhs[d], d, first_s, last_s, first_s, last_s);
+    }
+
+    // a new collection frequency resets the rows
+    rrdcol_store_metric_change_collection_frequency(schs[0], 2);
+    if(rrdcol_query_latest_time_s(smhs[0]) != 0 || chart->last_time_s != 0) {
+        fprintf(stderr, "DB_COLUMNAR: the rows have not been reset on a new collection frequency\n");
+        errors++;
+    }
+
+    // releasing all the dimensions frees the chart block
+    UUIDMAP_ID id = rds[0]->uuid;
+    for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        if(released[d])
+            continue;
+
+        rrdcol_collect_finalize(schs[d]);
+        rrdcol_metric_release(smhs[d]);
+    }
+
+    STORAGE_METRIC_HANDLE *smh = rrdcol_metric_get_by_id(NULL, id);
+    if(smh) {
+        fprintf(stderr, "DB_COLUMNAR: a released metric is still found\n");
+        rrdcol_metric_release(smh);
+        errors++;
+    }
+
+    for(size_t d = 0; d < RRDCOL_UNITTEST_DIMS ; d++) {
+        uuidmap_free(rds[d]->uuid);
+        freez(rds[d]);
+    }
+    freez(st);
+
+    fprintf(stderr, "DB_COLUMNAR: unittest %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
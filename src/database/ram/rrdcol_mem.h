@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_RRDCOLMEM_H
+#define NETDATA_RRDCOLMEM_H
+
+#include "database/rrd.h"
+
+// Columnar in-memory storage
+//
+// All the dimensions of a chart share one block of memory, organized
+// time-major: every row holds the values of all the dimensions of the chart
+// for one timestamp, and every dimension owns a column. Rows are addressed
+// by time (timestamp / update_every modulo the number of rows), so gaps do
+// not need to be filled and there is one timestamp per row instead of one
+// ring buffer per dimension.
+//
+// It is a db mode of its own, next to ram and alloc, which are not changed.
+// It is only an alternative row layout: queries read it one dimension at a
+// time, through the storage engine API, like all the other engines.
+//
+// The row stride follows the number of dimensions of the chart: it grows by
+// about 1/4 when a dimension is added to a full row, and the columns are
+// compacted when enough dimensions are removed.
+
+// charts with at least this number of columns have rows padded
+// to multiples of RRDCOL_COLUMNS_ALIGN columns (16 bytes)
+#define RRDCOL_COLUMNS_ALIGN_MIN 8
+#define RRDCOL_COLUMNS_ALIGN 4
+
+struct rrdcol_collect_handle {
+    struct storage_collect_handle common; // has to be first item
+
+    STORAGE_METRIC_HANDLE *smh;
+};
+
+struct rrdcol_query_handle {
+    STORAGE_METRIC_HANDLE *smh;
+    time_t dt;
+    time_t next_timestamp;
+    time_t first_timestamp;
+    time_t last_timestamp;
+};
+
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_or_create(RRDDIM *rd, STORAGE_INSTANCE *si);
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_by_id(STORAGE_INSTANCE *si, UUIDMAP_ID id);
+STORAGE_METRIC_HANDLE *rrdcol_metric_get_by_uuid(STORAGE_INSTANCE *si, nd_uuid_t *uuid);
+STORAGE_METRIC_HANDLE *rrdcol_metric_dup(STORAGE_METRIC_HANDLE *smh);
+void rrdcol_metric_release(STORAGE_METRIC_HANDLE *smh);
+
+bool rrdcol_metric_retention_by_id(STORAGE_INSTANCE *si, UUIDMAP_ID id, time_t *first_entry_s, time_t *last_entry_s);
+bool rrdcol_metric_retention_by_uuid(STORAGE_INSTANCE *si, nd_uuid_t *uuid, time_t *first_entry_s, time_t *last_entry_s);
+void rrdcol_retention_delete_by_id(STORAGE_INSTANCE *si, UUIDMAP_ID id);
+
+STORAGE_COLLECT_HANDLE *rrdcol_collect_init(STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg);
+void rrdcol_store_metric_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every);
+void rrdcol_collect_store_metric(STORAGE_COLLECT_HANDLE *sch, usec_t point_in_time_ut, NETDATA_DOUBLE n,
+                                 NETDATA_DOUBLE min_value,
+                                 NETDATA_DOUBLE max_value,
+                                 uint16_t count,
+                                 uint16_t anomaly_count,
+                                 SN_FLAGS flags);
+void rrdcol_store_metric_flush(STORAGE_COLLECT_HANDLE *sch);
+int rrdcol_collect_finalize(STORAGE_COLLECT_HANDLE *sch);
+
+void rrdcol_query_init(STORAGE_METRIC_HANDLE *smh, struct storage_engine_query_handle *seqh, time_t start_time_s, time_t end_time_s, STORAGE_PRIORITY priority);
+STORAGE_POINT rrdcol_query_next_metric(struct storage_engine_query_handle *seqh);
+int rrdcol_query_is_finished(struct storage_engine_query_handle *seqh);
+void rrdcol_query_finalize(struct storage_engine_query_handle *seqh);
+time_t rrdcol_query_latest_time_s(STORAGE_METRIC_HANDLE *smh);
+time_t rrdcol_query_oldest_time_s(STORAGE_METRIC_HANDLE *smh);
+time_t rrdcol_query_align_to_optimal_before(struct storage_engine_query_handle *seqh);
+
+int rrdcol_unittest(void);
+
+#endif
@@ -14,6 +14,9 @@ inline const char *rrd_memory_mode_name(RRD_DB_MODE id) {
 
         case RRD_DB_MODE_DBENGINE:
             return RRD_DB_MODE_DBENGINE_NAME;
+
+        case RRD_DB_MODE_COLUMNAR:
+            return RRD_DB_MODE_COLUMNAR_NAME;
     }
 
     STORAGE_ENGINE* eng = storage_engine_get(id);
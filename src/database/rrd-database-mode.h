@@ -8,6 +8,7 @@ typedef enum __attribute__ ((__packed__)) rrd_memory_mode {
     RRD_DB_MODE_RAM = 1,
     RRD_DB_MODE_ALLOC = 4,
     RRD_DB_MODE_DBENGINE = 5,
+    RRD_DB_MODE_COLUMNAR = 6,
 
     // this is 8-bit
 } RRD_DB_MODE;
@@ -16,6 +17,7 @@ typedef enum __attribute__ ((__packed__)) rrd_memory_mode {
 #define RRD_DB_MODE_RAM_NAME "ram"
 #define RRD_DB_MODE_ALLOC_NAME "alloc"
 #define RRD_DB_MODE_DBENGINE_NAME "dbengine"
+#define RRD_DB_MODE_COLUMNAR_NAME "columnar"
 
 extern RRD_DB_MODE default_rrd_memory_mode;
 
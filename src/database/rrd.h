@@ -96,6 +96,7 @@ static inline uint32_t get_uint32_id() {
 #include "rrdset.h"
 #include "rrddim.h"
 #include "rrddim-backfill.h"
+#include "rrddim-window.h"
 
 #include "streaming/stream-sender-commit.h"
 #include "streaming/stream-replication-tracking.h"
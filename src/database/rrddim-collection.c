@@ -155,6 +155,9 @@ void rrddim_store_metric(RRDDIM *rd, usec_t point_end_time_ut, NETDATA_DOUBLE n,
 
     time_t now_s = (time_t)(point_end_time_ut / USEC_PER_SEC);
 
+    if(unlikely(__atomic_load_n(&rd->windows.list, __ATOMIC_RELAXED)))
+        rrddim_windows_store_metric(rd, now_s, n, flags);
+
     STORAGE_POINT sp = {
         .start_time_s = now_s - rd->rrdset->update_every,
         .end_time_s = now_s,
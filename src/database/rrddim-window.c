@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rrd.h"
+
+struct rrddim_window {
+    uint32_t duration_s;
+    uint32_t update_every_s;
+    bool absolute;                  // the points are made positive before aggregated
+
+    // the running aggregates
+    // when dirty, they have to be recalculated from the points
+    // like the query engine, min and max are the values with the min and max magnitude
+    bool dirty;
+    size_t count;
+    NETDATA_DOUBLE sum;
+    NETDATA_DOUBLE min;
+    NETDATA_DOUBLE max;
+
+    time_t last_used_s;             // the last time the window was looked up
+    time_t last_point_s;            // the timestamp of the latest point in the window
+
+    uint32_t size;                  // the number of points the window has
+    uint32_t filled;                // the number of points added, up to size
+    uint32_t next;                  // the slot the next point will be added
+
+    struct rrddim_window *prev, *next_window;
+
+    storage_number points[];
+};
+
+static inline NETDATA_DOUBLE rrddim_window_point_value(struct rrddim_window *w, storage_number sn) {
+    NETDATA_DOUBLE v = unpack_storage_number(sn);
+    return w->absolute ? fabsndd(v) : v;
+}
+
+static inline void rrddim_window_min_max(struct rrddim_window *w, NETDATA_DOUBLE v) {
+    if(!w->count)
+        w->min = w->max = v;
+    else {
+        if(fabsndd(v) < fabsndd(w->min)) w->min = v;
+        if(fabsndd(v) > fabsndd(w->max)) w->max = v;
+    }
+}
+
+static void rrddim_window_recalculate(struct rrddim_window *w) {
+    w->count = 0;
+    w->sum = 0.0;
+    w->min = NAN;
+    w->max = NAN;
+
+    // from the oldest to the newest point, like the query engine
+    uint32_t first = (w->filled == w->size) ? w->next : 0;
+    for(uint32_t i = 0; i < w->filled ;i++) {
+        storage_number sn = w->points[(first + i) % w->size];
+        if(!does_storage_number_exist(sn))
+            continue;
+
+        NETDATA_DOUBLE v = rrddim_window_point_value(w, sn);
+        rrddim_window_min_max(w, v);
+        w->sum += v;
+        w->count++;
+    }
+
+    w->dirty = false;
+}
+
+static void rrddim_window_reset(struct rrddim_window *w) {
+    w->filled = 0;
+    w->next = 0;
+    w->last_point_s = 0;
+    w->count = 0;
+    w->sum = 0.0;
+    w->min = NAN;
+    w->max = NAN;
+    w->dirty = false;
+}
+
+ALWAYS_INLINE_HOT
+static void rrddim_window_push(struct rrddim_window *w, storage_number sn) {
+    if(w->filled == w->size) {
+        // the oldest point leaves the window
+        storage_number old = w->points[w->next];
+        if(does_storage_number_exist(old)) {
+            NETDATA_DOUBLE v = rrddim_window_point_value(w, old);
+            w->sum -= v;
+            w->count--;
+
+            if(fabsndd(v) <= fabsndd(w->min) || fabsndd(v) >= fabsndd(w->max))
+                // it may have been the min or the max
+                w->dirty = true;
+        }
+    }
+    else
+        w->filled++;
+
+    w->points[w->next] = sn;
+
+    if(does_storage_number_exist(sn)) {
+        NETDATA_DOUBLE v = rrddim_window_point_value(w, sn);
+        w->sum += v;
+
+        if(!w->dirty)
+            rrddim_window_min_max(w, v);
+
+        w->count++;
+    }
+
+    if(++w->next == w->size) {
+        // recalculate the running sum once per rotation,
+        // so that floating point errors do not accumulate
+        w->next = 0;
+        w->dirty = true;
+    }
+}
+
+static void rrddim_window_add_point(struct rrddim_window *w, time_t point_end_time_s, storage_number sn) {
+    if(w->last_point_s) {
+        if(unlikely(point_end_time_s <= w->last_point_s)) {
+            // a point in the past (e.g. replication)
+            // we don't know what the database has now
+            rrddim_window_reset(w);
+        }
+        else {
+            // fill any gap with empty points
+            time_t missing = (point_end_time_s - w->last_point_s) / w->update_every_s - 1;
+            if(unlikely(missing >= (time_t)w->size))
+                rrddim_window_reset(w);
+            else {
+                while(missing-- > 0)
+                    rrddim_window_push(w, SN_EMPTY_SLOT);
+            }
+        }
+    }
+
+    rrddim_window_push(w, sn);
+    w->last_point_s = point_end_time_s;
+}
+
+static void rrddim_window_free(struct rrddim_window *w) {
+    freez(w);
+}
+
+void rrddim_windows_store_metric(RRDDIM *rd, time_t point_end_time_s, NETDATA_DOUBLE n, SN_FLAGS flags) {
+    // the points are kept as stored in the database,
+    // so that the aggregates match the ones of database queries
+    storage_number sn = pack_storage_number(n, flags);
+    uint32_t update_every_s = rd->rrdset->update_every;
+
+    spinlock_lock(&rd->windows.spinlock);
+
+    struct rrddim_window *w, *next;
+    for(w = rd->windows.list; w ; w = next) {
+        next = w->next_window;
+
+        if(unlikely(w->update_every_s != update_every_s ||
+                     point_end_time_s - w->last_used_s > RRDDIM_WINDOW_EXPIRE_S)) {
+            DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(rd->windows.list, w, prev, next_window);
+            rrddim_window_free(w);
+            continue;
+        }
+
+        rrddim_window_add_point(w, point_end_time_s, sn);
+    }
+
+    spinlock_unlock(&rd->windows.spinlock);
+}
+
+void rrddim_windows_free(RRDDIM *rd) {
+    spinlock_lock(&rd->windows.spinlock);
+
+    while(rd->windows.list) {
+        struct rrddim_window *w = rd->windows.list;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(rd->windows.list, w, prev, next_window);
+        rrddim_window_free(w);
+    }
+
+    spinlock_unlock(&rd->windows.spinlock);
+}
+
+bool rrddim_window_get(RRDDIM *rd, uint32_t duration_s, bool absolute, time_t now_s, RRDDIM_WINDOW_VALUE *v) {
+    uint32_t update_every_s = rd->rrdset->update_every;
+    uint32_t size = rrddim_window_points(duration_s, update_every_s);
+    if(!size || size > RRDDIM_WINDOW_MAX_POINTS)
+        return false;
+
+    bool ret = false;
+
+    spinlock_lock(&rd->windows.spinlock);
+
+    struct rrddim_window *w;
+    for(w = rd->windows.list; w ; w = w->next_window) {
+        if(w->duration_s == duration_s && w->absolute == absolute && w->update_every_s == update_every_s)
+            break;
+    }
+
+    if(!w) {
+        // start collecting points for the next lookups
+        w = callocz(1, sizeof(*w) + size * sizeof(storage_number));
+        w->duration_s = duration_s;
+        w->update_every_s = update_every_s;
+        w->absolute = absolute;
+        w->size = size;
+        w->last_used_s = now_s;
+        rrddim_window_reset(w);
+        DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(rd->windows.list, w, prev, next_window);
+    }
+    else {
+        w->last_used_s = now_s;
+
+        if(w->filled == w->size) {
+            if(w->dirty)
+                rrddim_window_recalculate(w);
+
+            v->sum = w->sum;
+            v->min = w->min;
+            v->max = w->max;
+            v->count = w->count;
+            v->before = w->last_point_s;
+            v->after = w->last_point_s - (time_t)(w->size - 1) * w->update_every_s;
+            ret = true;
+        }
+    }
+
+    spinlock_unlock(&rd->windows.spinlock);
+
+    return ret;
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_RRDDIM_WINDOW_H
+#define NETDATA_RRDDIM_WINDOW_H
+
+#include "rrddim.h"
+
+// In-memory sliding windows of the latest points of a dimension
+//
+// Health lookups (like "average -10m unaligned") ask for the same aggregation
+// of the latest points of the same dimensions on every evaluation.
+//
+// A window keeps the latest tier 0 points of a dimension in a ring buffer,
+// together with their running sum, count, min and max, which are updated as
+// points are stored. So, the aggregation of the whole window is available
+// without querying the storage engine.
+//
+// Windows are created on the first lookup that needs them and are freed by
+// the collector when they are not looked up for a while.
+
+// the max number of points a window can have
+#define RRDDIM_WINDOW_MAX_POINTS 3600
+
+// windows not looked up for this long are freed
+#define RRDDIM_WINDOW_EXPIRE_S 3600
+
+typedef struct rrddim_window_value {
+    NETDATA_DOUBLE sum;
+    NETDATA_DOUBLE min;
+    NETDATA_DOUBLE max;
+    size_t count;           // the number of points that are not gaps
+
+    time_t after;           // the timestamp of the first point of the window
+    time_t before;          // the timestamp of the last point of the window
+} RRDDIM_WINDOW_VALUE;
+
+// the number of points a window of this duration has
+// the same the query engine uses for an unaligned query of 1 point
+static inline uint32_t rrddim_window_points(uint32_t duration_s, uint32_t update_every_s) {
+    if(!update_every_s) return 0;
+    return (duration_s + 1) / update_every_s;
+}
+
+// collector side - called for every point stored at tier 0
+void rrddim_windows_store_metric(RRDDIM *rd, time_t point_end_time_s, NETDATA_DOUBLE n, SN_FLAGS flags);
+void rrddim_windows_free(RRDDIM *rd);
+
+// lookup side - returns false when the window is not available (yet),
+// in which case the caller should query the storage engine
+bool rrddim_window_get(RRDDIM *rd, uint32_t duration_s, bool absolute, time_t now_s, RRDDIM_WINDOW_VALUE *v);
+
+#endif //NETDATA_RRDDIM_WINDOW_H
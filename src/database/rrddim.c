@@ -52,6 +52,8 @@ static void rrddim_insert_callback(const DICTIONARY_ITEM *item __maybe_unused, v
     RRDHOST *host = st->rrdhost;
 
     spinlock_init(&rd->destroy_lock);
+    spinlock_init(&rd->windows.spinlock);
+    rd->windows.list = NULL;
 
     rd->flags = RRDDIM_FLAG_NONE;
 
@@ -227,6 +229,8 @@ static void rrddim_delete_callback(const DICTIONARY_ITEM *item __maybe_unused, v
 
     ml_dimension_delete(rd);
 
+    rrddim_windows_free(rd);
+
     netdata_log_debug(D_RRD_CALLS, "rrddim_free() %s.%s", rrdset_name(st), rrddim_name(rd));
 
     if (!rrddim_finalize_collection_and_check_retention(rd) && rd->rrd_memory_mode == RRD_DB_MODE_DBENGINE) {
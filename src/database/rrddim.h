@@ -85,6 +85,11 @@ struct rrddim {
         bool collected;
     } rrdcontexts;
 
+    struct {
+        SPINLOCK spinlock;
+        struct rrddim_window *list;                 // in-memory sliding windows of the latest points
+    } windows;
+
 #ifdef NETDATA_LOG_COLLECTION_ERRORS
     usec_t rrddim_store_metric_last_ut;             // the timestamp we last called rrddim_store_metric()
     size_t rrddim_store_metric_count;               // the rrddim_store_metric() counter
@@ -108,6 +113,13 @@ struct rrddim {
         struct {
             uint32_t sent_version;
             uint32_t dim_slot;
+
+            struct {
+                uint32_t connection;                    // the sender connection the baseline was sent on
+                uint32_t version;                       // the chart metadata version the baseline was sent with
+                collected_number collected;             // the last collected value sent
+                uint64_t value;                         // the bits of the last stored value sent
+            } delta;                                    // the baseline of STREAM_CAP_DELTAS
         } snd;
     } stream;
 
@@ -157,6 +169,12 @@ struct pluginsd_rrddim {
     RRDDIM_ACQUIRED *rda;
     RRDDIM *rd;
     const char *id;
+
+    struct {
+        uint32_t connection;                            // the receiver connection the baseline was received on
+        collected_number collected;                     // the last collected value received
+        uint64_t value;                                 // the bits of the last stored value received
+    } delta;                                            // the baseline of SET2B
 };
 
 static inline uint32_t rrddim_metadata_version(RRDDIM *rd) {
@@ -252,6 +252,7 @@ static void rrdhost_set_replication_parameters(RRDHOST *host, RRD_DB_MODE memory
         default:
         case RRD_DB_MODE_ALLOC:
         case RRD_DB_MODE_RAM:
+        case RRD_DB_MODE_COLUMNAR:
             if(host->stream.replication.period > (time_t) host->rrd_history_entries * (time_t) host->rrd_update_every)
                 host->stream.replication.period = (time_t) host->rrd_history_entries * (time_t) host->rrd_update_every;
             break;
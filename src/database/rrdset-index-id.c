@@ -64,6 +64,7 @@ static void rrdset_insert_callback(const DICTIONARY_ITEM *item __maybe_unused, v
     RRDSET *st = rrdset;
 
     spinlock_init(&st->destroy_lock);
+    spinlock_init(&st->prometheus.spinlock);
 
     const char *chart_full_id = dictionary_acquired_item_name(item);
 
@@ -184,6 +185,7 @@ static void rrdset_delete_callback(const DICTIONARY_ITEM *item __maybe_unused, v
     string_freez(st->module_name);
 
     freez(st->exporting_flags);
+    prometheus_rrdset_cleanup(st);
 
     if(st->destroy_lock.locked)
         spinlock_unlock(&st->destroy_lock);
@@ -47,6 +47,7 @@ void rrdset_pluginsd_receive_unslot(RRDSET *st) {
         st->pluginsd.prd_array[i].rda = NULL;
         st->pluginsd.prd_array[i].rd = NULL;
         st->pluginsd.prd_array[i].id = NULL;
+        st->pluginsd.prd_array[i].delta.connection = 0;
     }
 
     RRDHOST *host = st->rrdhost;
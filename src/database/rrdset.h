@@ -193,6 +193,11 @@ struct rrdset {
 
     RRDSET_FLAGS *exporting_flags;                  // array of flags for exporting connector instances
 
+    struct {
+        SPINLOCK spinlock;                          // protects the list of fragments and their references
+        struct prometheus_fragment *fragments;      // the cached prometheus expositions of the chart, one per key
+    } prometheus;
+
     // ------------------------------------------------------------------------
     // health monitoring members
     // TODO - they should be managed by health
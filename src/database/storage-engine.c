@@ -2,6 +2,7 @@
 
 #include "storage-engine.h"
 #include "ram/rrddim_mem.h"
+#include "ram/rrdcol_mem.h"
 #ifdef ENABLE_DBENGINE
 #include "engine/rrdengineapi.h"
 #endif
@@ -52,6 +53,21 @@ static STORAGE_ENGINE engines[] = {
             .metric_retention_delete_by_id = rrddim_retention_delete_by_id,
         }
     },
+    {
+        .id = RRD_DB_MODE_COLUMNAR,
+        .name = RRD_DB_MODE_COLUMNAR_NAME,
+        .seb = STORAGE_ENGINE_BACKEND_COLUMNAR,
+        .api = {
+            .metric_get_by_id = rrdcol_metric_get_by_id,
+            .metric_get_by_uuid = rrdcol_metric_get_by_uuid,
+            .metric_get_or_create = rrdcol_metric_get_or_create,
+            .metric_dup = rrdcol_metric_dup,
+            .metric_release = rrdcol_metric_release,
+            .metric_retention_by_id = rrdcol_metric_retention_by_id,
+            .metric_retention_by_uuid = rrdcol_metric_retention_by_uuid,
+            .metric_retention_delete_by_id = rrdcol_retention_delete_by_id,
+        }
+    },
 #ifdef ENABLE_DBENGINE
     {
         .id = RRD_DB_MODE_DBENGINE,
@@ -30,9 +30,10 @@ typedef enum __attribute__ ((__packed__)) storage_priority {
 typedef enum __attribute__ ((__packed__)) {
     STORAGE_ENGINE_BACKEND_RRDDIM = 1,
     STORAGE_ENGINE_BACKEND_DBENGINE = 2,
+    STORAGE_ENGINE_BACKEND_COLUMNAR = 3,
 } STORAGE_ENGINE_BACKEND;
 
-#define is_valid_backend(backend) ((backend) >= STORAGE_ENGINE_BACKEND_RRDDIM && (backend) <= STORAGE_ENGINE_BACKEND_DBENGINE)
+#define is_valid_backend(backend) ((backend) >= STORAGE_ENGINE_BACKEND_RRDDIM && (backend) <= STORAGE_ENGINE_BACKEND_COLUMNAR)
 
 // iterator state for RRD dimension data queries
 struct storage_engine_query_handle {
@@ -140,6 +141,7 @@ static inline void storage_engine_metrics_group_release(STORAGE_ENGINE_BACKEND s
 
 STORAGE_COLLECT_HANDLE *rrdeng_store_metric_init(STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg);
 STORAGE_COLLECT_HANDLE *rrddim_collect_init(STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg);
+STORAGE_COLLECT_HANDLE *rrdcol_collect_init(STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg);
 
 static inline STORAGE_COLLECT_HANDLE *storage_metric_store_init(STORAGE_ENGINE_BACKEND seb __maybe_unused, STORAGE_METRIC_HANDLE *smh, uint32_t update_every, STORAGE_METRICS_GROUP *smg) {
     internal_fatal(!is_valid_backend(seb), "STORAGE: invalid backend");
@@ -148,6 +150,9 @@ static inline STORAGE_COLLECT_HANDLE *storage_metric_store_init(STORAGE_ENGINE_B
     if(likely(seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_store_metric_init(smh, update_every, smg);
 #endif
+    if(seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_collect_init(smh, update_every, smg);
+
     return rrddim_collect_init(smh, update_every, smg);
 }
 
@@ -163,6 +168,11 @@ void rrddim_collect_store_metric(
     NETDATA_DOUBLE n, NETDATA_DOUBLE min_value, NETDATA_DOUBLE max_value,
     uint16_t count, uint16_t anomaly_count, SN_FLAGS flags);
 
+void rrdcol_collect_store_metric(
+    STORAGE_COLLECT_HANDLE *sch, usec_t point_in_time_ut,
+    NETDATA_DOUBLE n, NETDATA_DOUBLE min_value, NETDATA_DOUBLE max_value,
+    uint16_t count, uint16_t anomaly_count, SN_FLAGS flags);
+
 ALWAYS_INLINE_HOT_FLATTEN
 static void storage_engine_store_metric(
     STORAGE_COLLECT_HANDLE *sch, usec_t point_in_time_ut,
@@ -176,6 +186,11 @@ static void storage_engine_store_metric(
                                         n, min_value, max_value,
                                         count, anomaly_count, flags);
 #endif
+    if(sch->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_collect_store_metric(sch, point_in_time_ut,
+                                           n, min_value, max_value,
+                                           count, anomaly_count, flags);
+
     return rrddim_collect_store_metric(sch, point_in_time_ut,
                                        n, min_value, max_value,
                                        count, anomaly_count, flags);
@@ -265,6 +280,7 @@ static inline size_t storage_engine_collected_metrics(STORAGE_ENGINE_BACKEND seb
 
 void rrdeng_store_metric_flush_current_page(STORAGE_COLLECT_HANDLE *sch);
 void rrddim_store_metric_flush(STORAGE_COLLECT_HANDLE *sch);
+void rrdcol_store_metric_flush(STORAGE_COLLECT_HANDLE *sch);
 
 static inline void storage_engine_store_flush(STORAGE_COLLECT_HANDLE *sch) {
     if(unlikely(!sch))
@@ -277,6 +293,9 @@ static inline void storage_engine_store_flush(STORAGE_COLLECT_HANDLE *sch) {
         rrdeng_store_metric_flush_current_page(sch);
     else
 #endif
+    if(sch->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        rrdcol_store_metric_flush(sch);
+    else
         rrddim_store_metric_flush(sch);
 }
 
@@ -284,6 +303,7 @@ static inline void storage_engine_store_flush(STORAGE_COLLECT_HANDLE *sch) {
 
 int rrdeng_store_metric_finalize(STORAGE_COLLECT_HANDLE *sch);
 int rrddim_collect_finalize(STORAGE_COLLECT_HANDLE *sch);
+int rrdcol_collect_finalize(STORAGE_COLLECT_HANDLE *sch);
 // a finalization function to run after collection is over
 // returns 1 if it's safe to delete the dimension
 
@@ -294,6 +314,8 @@ static inline int storage_engine_store_finalize(STORAGE_COLLECT_HANDLE *sch) {
     if(likely(sch->seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_store_metric_finalize(sch);
 #endif
+    if(sch->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_collect_finalize(sch);
 
     return rrddim_collect_finalize(sch);
 }
@@ -302,6 +324,7 @@ static inline int storage_engine_store_finalize(STORAGE_COLLECT_HANDLE *sch) {
 
 void rrdeng_store_metric_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every);
 void rrddim_store_metric_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every);
+void rrdcol_store_metric_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every);
 
 static inline void storage_engine_store_change_collection_frequency(STORAGE_COLLECT_HANDLE *sch, int update_every) {
     internal_fatal(!is_valid_backend(sch->seb), "STORAGE: invalid backend");
@@ -311,6 +334,9 @@ static inline void storage_engine_store_change_collection_frequency(STORAGE_COLL
         rrdeng_store_metric_change_collection_frequency(sch, update_every);
     else
 #endif
+    if(sch->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        rrdcol_store_metric_change_collection_frequency(sch, update_every);
+    else
         rrddim_store_metric_change_collection_frequency(sch, update_every);
 }
 
@@ -319,6 +345,7 @@ static inline void storage_engine_store_change_collection_frequency(STORAGE_COLL
 
 time_t rrdeng_metric_oldest_time(STORAGE_METRIC_HANDLE *smh);
 time_t rrddim_query_oldest_time_s(STORAGE_METRIC_HANDLE *smh);
+time_t rrdcol_query_oldest_time_s(STORAGE_METRIC_HANDLE *smh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static time_t storage_engine_oldest_time_s(STORAGE_ENGINE_BACKEND seb  __maybe_unused, STORAGE_METRIC_HANDLE *smh) {
@@ -328,6 +355,9 @@ static time_t storage_engine_oldest_time_s(STORAGE_ENGINE_BACKEND seb  __maybe_u
     if(likely(seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_metric_oldest_time(smh);
 #endif
+    if(seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_query_oldest_time_s(smh);
+
     return rrddim_query_oldest_time_s(smh);
 }
 
@@ -335,6 +365,7 @@ static time_t storage_engine_oldest_time_s(STORAGE_ENGINE_BACKEND seb  __maybe_u
 
 time_t rrdeng_metric_latest_time(STORAGE_METRIC_HANDLE *smh);
 time_t rrddim_query_latest_time_s(STORAGE_METRIC_HANDLE *smh);
+time_t rrdcol_query_latest_time_s(STORAGE_METRIC_HANDLE *smh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static time_t storage_engine_latest_time_s(STORAGE_ENGINE_BACKEND seb __maybe_unused, STORAGE_METRIC_HANDLE *smh) {
@@ -344,6 +375,9 @@ static time_t storage_engine_latest_time_s(STORAGE_ENGINE_BACKEND seb __maybe_un
     if(likely(seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_metric_latest_time(smh);
 #endif
+    if(seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_query_latest_time_s(smh);
+
     return rrddim_query_latest_time_s(smh);
 }
 
@@ -357,6 +391,10 @@ void rrddim_query_init(
     STORAGE_METRIC_HANDLE *smh, struct storage_engine_query_handle *seqh,
     time_t start_time_s, time_t end_time_s, STORAGE_PRIORITY priority);
 
+void rrdcol_query_init(
+    STORAGE_METRIC_HANDLE *smh, struct storage_engine_query_handle *seqh,
+    time_t start_time_s, time_t end_time_s, STORAGE_PRIORITY priority);
+
 ALWAYS_INLINE_HOT_FLATTEN
 static void storage_engine_query_init(
     STORAGE_ENGINE_BACKEND seb __maybe_unused,
@@ -369,6 +407,9 @@ static void storage_engine_query_init(
         rrdeng_load_metric_init(smh, seqh, start_time_s, end_time_s, priority);
     else
 #endif
+    if(seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        rrdcol_query_init(smh, seqh, start_time_s, end_time_s, priority);
+    else
         rrddim_query_init(smh, seqh, start_time_s, end_time_s, priority);
 }
 
@@ -376,6 +417,7 @@ static void storage_engine_query_init(
 
 STORAGE_POINT rrdeng_load_metric_next(struct storage_engine_query_handle *seqh);
 STORAGE_POINT rrddim_query_next_metric(struct storage_engine_query_handle *seqh);
+STORAGE_POINT rrdcol_query_next_metric(struct storage_engine_query_handle *seqh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static STORAGE_POINT storage_engine_query_next_metric(struct storage_engine_query_handle *seqh) {
@@ -385,6 +427,9 @@ static STORAGE_POINT storage_engine_query_next_metric(struct storage_engine_quer
     if(likely(seqh->seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_load_metric_next(seqh);
 #endif
+    if(seqh->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_query_next_metric(seqh);
+
     return rrddim_query_next_metric(seqh);
 }
 
@@ -392,6 +437,7 @@ static STORAGE_POINT storage_engine_query_next_metric(struct storage_engine_quer
 
 int rrdeng_load_metric_is_finished(struct storage_engine_query_handle *seqh);
 int rrddim_query_is_finished(struct storage_engine_query_handle *seqh);
+int rrdcol_query_is_finished(struct storage_engine_query_handle *seqh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static int storage_engine_query_is_finished(struct storage_engine_query_handle *seqh) {
@@ -401,6 +447,9 @@ static int storage_engine_query_is_finished(struct storage_engine_query_handle *
     if(likely(seqh->seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_load_metric_is_finished(seqh);
 #endif
+    if(seqh->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_query_is_finished(seqh);
+
     return rrddim_query_is_finished(seqh);
 }
 
@@ -408,6 +457,7 @@ static int storage_engine_query_is_finished(struct storage_engine_query_handle *
 
 void rrdeng_load_metric_finalize(struct storage_engine_query_handle *seqh);
 void rrddim_query_finalize(struct storage_engine_query_handle *seqh);
+void rrdcol_query_finalize(struct storage_engine_query_handle *seqh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static void storage_engine_query_finalize(struct storage_engine_query_handle *seqh) {
@@ -418,6 +468,9 @@ static void storage_engine_query_finalize(struct storage_engine_query_handle *se
         rrdeng_load_metric_finalize(seqh);
     else
 #endif
+    if(seqh->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        rrdcol_query_finalize(seqh);
+    else
         rrddim_query_finalize(seqh);
 }
 
@@ -425,6 +478,7 @@ static void storage_engine_query_finalize(struct storage_engine_query_handle *se
 
 time_t rrdeng_load_align_to_optimal_before(struct storage_engine_query_handle *seqh);
 time_t rrddim_query_align_to_optimal_before(struct storage_engine_query_handle *seqh);
+time_t rrdcol_query_align_to_optimal_before(struct storage_engine_query_handle *seqh);
 
 ALWAYS_INLINE_HOT_FLATTEN
 static time_t storage_engine_align_to_optimal_before(struct storage_engine_query_handle *seqh) {
@@ -434,6 +488,9 @@ static time_t storage_engine_align_to_optimal_before(struct storage_engine_query
     if(likely(seqh->seb == STORAGE_ENGINE_BACKEND_DBENGINE))
         return rrdeng_load_align_to_optimal_before(seqh);
 #endif
+    if(seqh->seb == STORAGE_ENGINE_BACKEND_COLUMNAR)
+        return rrdcol_query_align_to_optimal_before(seqh);
+
     return rrddim_query_align_to_optimal_before(seqh);
 }
 
@@ -98,6 +98,8 @@ static void exporting_clean_engine()
         protocol_buffers_shutdown();
 #endif
 
+    exporting_stored_data_cleanup(engine);
+
     //Cleanup web api
     prometheus_clean_server_root();
 
@@ -199,6 +201,8 @@ void exporting_main(void *ptr)
         return;
     }
 
+    exporting_stored_data_init(engine);
+
     RRDSET *st_main_rusage = NULL;
     RRDDIM *rd_main_user = NULL;
     RRDDIM *rd_main_system = NULL;
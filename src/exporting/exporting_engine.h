@@ -15,6 +15,13 @@ extern struct config exporting_config;
 #define EXPORTING_UPDATE_EVERY_OPTION_NAME "update every"
 #define EXPORTING_UPDATE_EVERY_DEFAULT 10
 
+#define EXPORTING_QUERY_THREADS_OPTION_NAME "query threads"
+#define EXPORTING_QUERY_THREADS_DEFAULT_MAX 4
+#define EXPORTING_QUERY_THREADS_MAX 64
+
+// the max number of distinct time-frames the values are shared for
+#define EXPORTING_STORED_DATA_MAX_TIMEFRAMES 16
+
 typedef enum exporting_options {
     EXPORTING_OPTION_NON                    = 0,
 
@@ -152,6 +159,7 @@ struct mongodb_specific_config {
 struct engine_config {
     const char *hostname;
     int update_every;
+    size_t query_threads;
 };
 
 struct stats {
@@ -247,6 +255,8 @@ struct engine {
 
     struct instance *instance_root;
 
+    struct exporting_stored_data *stored_data;
+
     volatile sig_atomic_t exit;
 };
 
@@ -276,6 +286,22 @@ exporting_calculate_value_from_stored_data(
     RRDDIM *rd,
     time_t *last_timestamp);
 
+struct exporting_stored_value {
+    bool calculated;
+    time_t last_timestamp;          // zero when the time-frame is outside the database range
+    NETDATA_DOUBLE sum;
+    size_t count;
+};
+
+void exporting_query_stored_data(RRDDIM *rd, time_t after, time_t before, struct exporting_stored_value *sv);
+
+void exporting_stored_data_init(struct engine *engine);
+void exporting_stored_data_cleanup(struct engine *engine);
+void exporting_stored_data_calculate(struct engine *engine);
+void exporting_stored_data_select_host(struct engine *engine, RRDHOST *host);
+struct exporting_stored_value *exporting_stored_data_get(struct instance *instance, RRDDIM *rd);
+int exporting_stored_data_unittest(void);
+
 void start_batch_formatting(struct engine *engine);
 void start_host_formatting(struct engine *engine, RRDHOST *host);
 void start_chart_formatting(struct engine *engine, RRDSET *st);
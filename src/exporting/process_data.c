@@ -55,26 +55,26 @@ int mark_scheduled_instances(struct engine *engine)
 }
 
 /**
- * Calculate the SUM or AVERAGE of a dimension, for any timeframe
- *
- * May return NAN if the database does not have any value in the give timeframe.
+ * Query the database for the SUM and the COUNT of the points of a dimension, for any timeframe
  *
- * @param instance an instance data structure.
  * @param rd a dimension(metric) in the Netdata database.
- * @param last_timestamp the timestamp that should be reported to the exporting connector instance.
- * @return Returns the value, calculated over the given period.
+ * @param after the start of the timeframe of the instance.
+ * @param before the end of the timeframe of the instance.
+ * @param sv where to store the SUM, the COUNT and the timestamp that should be reported.
  */
-NETDATA_DOUBLE exporting_calculate_value_from_stored_data(
-    struct instance *instance,
-    RRDDIM *rd,
-    time_t *last_timestamp)
+void exporting_query_stored_data(RRDDIM *rd, time_t after, time_t before, struct exporting_stored_value *sv)
 {
     RRDSET *st = rd->rrdset;
 #ifdef NETDATA_INTERNAL_CHECKS
     RRDHOST *host = st->rrdhost;
 #endif
-    time_t after = instance->after;
-    time_t before = instance->before;
+
+    *sv = (struct exporting_stored_value) {
+        .calculated = true,
+        .last_timestamp = 0,
+        .sum = 0,
+        .count = 0,
+    };
 
     // find the edges of the rrd database for this chart
     time_t first_t = storage_engine_oldest_time_s(rd->tiers[0].seb, rd->tiers[0].smh);
@@ -117,10 +117,10 @@ NETDATA_DOUBLE exporting_calculate_value_from_stored_data(
             (unsigned long)before,
             (unsigned long)first_t,
             (unsigned long)last_t);
-        return NAN;
+        return;
     }
 
-    *last_timestamp = before;
+    sv->last_timestamp = before;
 
     size_t points_read = 0;
     size_t counter = 0;
@@ -150,13 +150,48 @@ NETDATA_DOUBLE exporting_calculate_value_from_stored_data(
             rrddim_id(rd),
             (unsigned long)after,
             (unsigned long)before);
-        return NAN;
+        return;
     }
 
+    sv->sum = sum;
+    sv->count = counter;
+}
+
+/**
+ * Calculate the SUM or AVERAGE of a dimension, for any timeframe
+ *
+ * May return NAN if the database does not have any value in the give timeframe.
+ * The values calculated before formatting, for all the instances sharing the same timeframe, are used when available.
+ *
+ * @param instance an instance data structure.
+ * @param rd a dimension(metric) in the Netdata database.
+ * @param last_timestamp the timestamp that should be reported to the exporting connector instance.
+ * @return Returns the value, calculated over the given period.
+ */
+NETDATA_DOUBLE exporting_calculate_value_from_stored_data(
+    struct instance *instance,
+    RRDDIM *rd,
+    time_t *last_timestamp)
+{
+    struct exporting_stored_value tmp;
+    struct exporting_stored_value *sv = exporting_stored_data_get(instance, rd);
+    if (!sv) {
+        exporting_query_stored_data(rd, instance->after, instance->before, &tmp);
+        sv = &tmp;
+    }
+
+    if (unlikely(!sv->last_timestamp))
+        return NAN;
+
+    *last_timestamp = sv->last_timestamp;
+
+    if (unlikely(!sv->count))
+        return NAN;
+
     if (unlikely(EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) == EXPORTING_SOURCE_DATA_SUM))
-        return sum;
+        return sv->sum;
 
-    return sum / (NETDATA_DOUBLE)counter;
+    return sv->sum / (NETDATA_DOUBLE)sv->count;
 }
 
 /**
@@ -339,8 +374,13 @@ void prepare_buffers(struct engine *engine)
     start_batch_formatting(engine);
 
     rrd_rdlock();
+
+    // calculate the values from the database once, for all instances
+    exporting_stored_data_calculate(engine);
+
     RRDHOST *host;
     rrdhost_foreach_read(host) {
+        exporting_stored_data_select_host(engine, host);
         start_host_formatting(engine, host);
         RRDSET *st;
         rrdset_foreach_read(st, host) {
@@ -357,6 +397,7 @@ void prepare_buffers(struct engine *engine)
         variables_formatting(engine, host);
         end_host_formatting(engine, host);
     }
+    exporting_stored_data_select_host(engine, NULL);
     rrd_rdunlock();
 
     end_batch_formatting(engine);
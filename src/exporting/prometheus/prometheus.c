@@ -85,6 +85,7 @@ static struct prometheus_server {
     uint32_t hash;
     RRDHOST *host;
     time_t last_access;
+    size_t response_size;
     struct prometheus_server *next;
 } *prometheus_server_root = NULL;
 
@@ -124,10 +125,12 @@ void prometheus_clean_server_root()
  * @param server the name of the Prometheus server.
  * @param host a data collecting host.
  * @param now actual time.
+ * @param response_size returns the size of the last response to the server, or 0 if it is the first occurrence.
  * @return Returns the last time when the server accessed Netdata, or 0 if it is the first occurrence.
  */
-static inline time_t prometheus_server_last_access(const char *server, RRDHOST *host, time_t now)
+static inline time_t prometheus_server_last_access(const char *server, RRDHOST *host, time_t now, size_t *response_size)
 {
+    *response_size = 0;
 #ifdef UNIT_TESTING
     return 0;
 #endif
@@ -140,6 +143,7 @@ static inline time_t prometheus_server_last_access(const char *server, RRDHOST *
         if (host == ps->host && hash == ps->hash && !strcmp(server, ps->server)) {
             time_t last = ps->last_access;
             ps->last_access = now;
+            *response_size = ps->response_size;
             netdata_mutex_unlock(&prometheus_server_root_mutex);
             return last;
         }
@@ -157,6 +161,36 @@ static inline time_t prometheus_server_last_access(const char *server, RRDHOST *
     return 0;
 }
 
+/**
+ * Save the size of the response to a Prometheus server, so that the next response can be allocated at once.
+ *
+ * @param server the name of the Prometheus server.
+ * @param host a data collecting host.
+ * @param response_size the size of the response.
+ */
+static inline void prometheus_server_set_response_size(const char *server, RRDHOST *host, size_t response_size)
+{
+#ifdef UNIT_TESTING
+    return;
+#endif
+    if (!server || !*server)
+        server = "default";
+
+    uint32_t hash = simple_hash(server);
+
+    netdata_mutex_lock(&prometheus_server_root_mutex);
+
+    struct prometheus_server *ps;
+    for (ps = prometheus_server_root; ps; ps = ps->next) {
+        if (host == ps->host && hash == ps->hash && !strcmp(server, ps->server)) {
+            ps->response_size = response_size;
+            break;
+        }
+    }
+
+    netdata_mutex_unlock(&prometheus_server_root_mutex);
+}
+
 /**
  * Copy and sanitize name.
  *
@@ -338,7 +372,6 @@ static int format_prometheus_chart_label_callback(const char *name, const char *
 struct host_variables_callback_options {
     RRDHOST *host;
     BUFFER *wb;
-    BUFFER *plabels_buffer;
     EXPORTING_OPTIONS exporting_options;
     PROMETHEUS_OUTPUT_OPTIONS output_options;
     const char *prefix;
@@ -349,6 +382,8 @@ struct host_variables_callback_options {
     SIMPLE_PATTERN *pattern;
     struct instance *instance;
     STRING *prometheus;
+    STRING *prefix_string;
+    STRING *label_prefix_string;
     PROM_CONTEXT_OPTIONS_JudyLSet *context_options;
 };
 
@@ -407,25 +442,6 @@ static int print_host_variables_callback(const DICTIONARY_ITEM *item __maybe_unu
     return 1;
 }
 
-struct gen_parameters {
-    const char *prefix;
-    const char *labels_prefix;
-    char *context;
-    char *suffix;
-
-    char *chart;
-    char *dimension;
-    char *family;
-    char *labels;
-
-    PROMETHEUS_OUTPUT_OPTIONS output_options;
-    RRDSET *st;
-    RRDDIM *rd;
-
-    const char *relation;
-    const char *type;
-};
-
 /**
  * Write an as-collected help comment to a buffer.
  *
@@ -434,9 +450,9 @@ struct gen_parameters {
  */
 static inline void generate_as_collected_prom_help(BUFFER *wb,
                                                    const char *prefix,
-                                                   char *context,
-                                                   char *units,
-                                                   char *suffix,
+                                                   const char *context,
+                                                   const char *units,
+                                                   const char *suffix,
                                                    RRDSET *st)
 {
     buffer_sprintf(wb, "# HELP %s_%s%s%s %s\n", prefix, context, units, suffix, rrdset_title(st));
@@ -450,66 +466,14 @@ static inline void generate_as_collected_prom_help(BUFFER *wb,
  */
 static inline void generate_as_collected_prom_type(BUFFER *wb,
                                                    const char *prefix,
-                                                   char *context,
-                                                   char *units,
-                                                   char *suffix,
+                                                   const char *context,
+                                                   const char *units,
+                                                   const char *suffix,
                                                    const char *type)
 {
     buffer_sprintf(wb, "# TYPE %s_%s%s%s %s\n", prefix, context, units, suffix, type);
 }
 
-/**
- * Write an as-collected metric to a buffer.
- *
- * @param wb the buffer to write the metric to.
- * @param p parameters for generating the metric string.
- * @param homogeneous a flag for homogeneous charts.
- * @param prometheus_collector a flag for metrics from prometheus collector.
- * @param chart_labels the dictionary with chart labels
- */
-static void generate_as_collected_from_metric(BUFFER *wb,
-                                              struct gen_parameters *p,
-                                              int homogeneous,
-                                              int prometheus_collector,
-                                              RRDLABELS *chart_labels)
-{
-    buffer_strcat(wb, p->prefix);
-    buffer_putc(wb, '_');
-    buffer_strcat(wb, p->context);
-
-    if (!homogeneous) {
-        buffer_putc(wb, '_');
-        buffer_strcat(wb, p->dimension);
-    }
-
-    buffer_sprintf(wb, "%s{%schart=\"%s\"", p->suffix, p->labels_prefix, p->chart);
-
-    if (homogeneous)
-        buffer_sprintf(wb, ",%sdimension=\"%s\"", p->labels_prefix, p->dimension);
-
-    buffer_sprintf(wb, ",%sfamily=\"%s\"", p->labels_prefix, p->family);
-
-    rrdlabels_walkthrough_read(chart_labels, format_prometheus_chart_label_callback, wb);
-
-    buffer_strcat(wb, p->labels);
-    buffer_putc(wb, '}');
-    buffer_putc(wb, ' ');
-
-    if (prometheus_collector)
-        buffer_print_netdata_double(wb,
-            (NETDATA_DOUBLE)p->rd->collector.last_collected_value * (NETDATA_DOUBLE)p->rd->multiplier /
-            (NETDATA_DOUBLE)p->rd->divisor);
-    else
-        buffer_print_int64(wb, p->rd->collector.last_collected_value);
-
-    if (p->output_options & PROMETHEUS_OUTPUT_TIMESTAMPS) {
-        buffer_putc(wb, ' ');
-        buffer_print_uint64(wb, timeval_msec(&p->rd->collector.last_collected_time));
-    }
-
-    buffer_putc(wb, '\n');
-}
-
 static void prometheus_print_os_info(
     BUFFER *wb,
     RRDHOST *host,
@@ -591,6 +555,405 @@ static void prometheus_print_os_info(
     fclose(fp);
 }
 
+// ----------------------------------------------------------------------------
+// cached exposition fragments of charts
+//
+// The names, the HELP and TYPE lines and the labels of the metrics of a chart change only when the chart,
+// its dimensions or its labels change. So, they are generated once into a fragment that is kept with the
+// chart, and every scrape appends only the values to them.
+//
+// Fragments are immutable. A chart keeps one fragment per key (prefix, label prefix and options), so that
+// Prometheus servers scraping with different options do not regenerate each other's fragments. The list is
+// kept in most recently used order and up to PROMETHEUS_FRAGMENTS_MAX fragments are kept per chart.
+//
+// When a fragment is generated, the fragments of the chart that are outdated (or are beyond the max) are
+// removed from the list, and they are freed when the last scrape using them releases them.
+
+// the max number of fragments kept per chart
+#define PROMETHEUS_FRAGMENTS_MAX 4
+
+// the output options that change the fragments
+#define PROMETHEUS_FRAGMENT_OUTPUT_OPTIONS \
+    (PROMETHEUS_OUTPUT_NAMES | PROMETHEUS_OUTPUT_OLDUNITS | PROMETHEUS_OUTPUT_HIDEUNITS)
+
+typedef enum __attribute__((packed)) {
+    PROMETHEUS_FRAGMENT_GAUGE = 0,
+    PROMETHEUS_FRAGMENT_COUNTER,
+
+    // terminator
+    PROMETHEUS_FRAGMENT_TYPES,
+} PROMETHEUS_FRAGMENT_TYPE;
+
+struct prometheus_fragment_dimension {
+    RRDDIM *rd;                         // used only to find the dimension, it is never dereferenced
+    uint32_t offset;                    // the metric name and labels, in the text of the fragment
+    uint32_t length;
+    PROMETHEUS_FRAGMENT_TYPE type;
+};
+
+struct prometheus_fragment {
+    int32_t refcount;                   // protected by the spinlock of the chart, the list holds one reference
+
+    // the fragment is valid while the versions of the chart remain the same
+    uint32_t metadata_version;
+    uint32_t labels_version;
+    size_t dimensions_version;
+
+    // the key of the fragment
+    PROMETHEUS_OUTPUT_OPTIONS output_options;
+    EXPORTING_OPTIONS data_source;
+    bool homogeneous;
+    bool prometheus_collector;
+    STRING *prefix;
+    STRING *label_prefix;
+
+    STRING *context;                    // the sanitized context of the chart
+
+    // the HELP and TYPE lines of each type, in the text of the fragment (length is 0 when not used)
+    struct {
+        uint32_t offset;
+        uint32_t length;
+    } help_type[PROMETHEUS_FRAGMENT_TYPES];
+
+    struct {
+        struct prometheus_fragment_dimension *array;
+        size_t used;
+        size_t size;
+    } dimensions;                       // sorted by rd
+
+    BUFFER *text;
+
+    struct prometheus_fragment *prev, *next;
+};
+
+static int prometheus_fragment_dimension_compar(const void *a, const void *b)
+{
+    const struct prometheus_fragment_dimension *d1 = a, *d2 = b;
+
+    if ((uintptr_t)d1->rd < (uintptr_t)d2->rd)
+        return -1;
+
+    if ((uintptr_t)d1->rd > (uintptr_t)d2->rd)
+        return 1;
+
+    return 0;
+}
+
+static void prometheus_fragment_free(struct prometheus_fragment *f)
+{
+    if (!f)
+        return;
+
+    string_freez(f->prefix);
+    string_freez(f->label_prefix);
+    string_freez(f->context);
+    freez(f->dimensions.array);
+    buffer_free(f->text);
+    freez(f);
+}
+
+/**
+ * Check if a fragment has been generated with the current versions of the chart
+ *
+ * @param f a fragment.
+ * @param key the versions and the options the fragment should have.
+ * @return Returns true if the fragment is up to date.
+ */
+static inline bool prometheus_fragment_is_current(struct prometheus_fragment *f, struct prometheus_fragment *key)
+{
+    return f->metadata_version == key->metadata_version &&
+           f->labels_version == key->labels_version &&
+           f->dimensions_version == key->dimensions_version;
+}
+
+/**
+ * Check if a fragment has been generated for the same key
+ *
+ * @param f a fragment.
+ * @param key the versions and the options the fragment should have.
+ * @return Returns true if the fragment has the same prefixes and options.
+ */
+static inline bool prometheus_fragment_has_key(struct prometheus_fragment *f, struct prometheus_fragment *key)
+{
+    return f->output_options == key->output_options &&
+           f->data_source == key->data_source &&
+           f->homogeneous == key->homogeneous &&
+           f->prometheus_collector == key->prometheus_collector &&
+           f->prefix == key->prefix &&
+           f->label_prefix == key->label_prefix;
+}
+
+/**
+ * Generate the fragment of a chart
+ *
+ * @param st a chart.
+ * @param opts the options of the scrape.
+ * @param key the versions and the options of the fragment.
+ * @return Returns a new fragment, with one reference for the caller.
+ */
+static struct prometheus_fragment *prometheus_fragment_create(
+    RRDSET *st,
+    struct host_variables_callback_options *opts,
+    struct prometheus_fragment *key)
+{
+    PROMETHEUS_OUTPUT_OPTIONS output_options = key->output_options;
+    const char *prefix = string2str(key->prefix);
+    const char *plabels_prefix = string2str(key->label_prefix);
+    bool as_collected = (key->data_source == EXPORTING_SOURCE_DATA_AS_COLLECTED);
+
+    struct prometheus_fragment *f = callocz(1, sizeof(*f));
+    f->refcount = 1;
+    f->metadata_version = key->metadata_version;
+    f->labels_version = key->labels_version;
+    f->dimensions_version = key->dimensions_version;
+    f->output_options = key->output_options;
+    f->data_source = key->data_source;
+    f->homogeneous = key->homogeneous;
+    f->prometheus_collector = key->prometheus_collector;
+    f->prefix = string_dup(key->prefix);
+    f->label_prefix = string_dup(key->label_prefix);
+    f->text = buffer_create(1024, &netdata_buffers_statistics.buffers_exporters);
+
+    char chart[PROMETHEUS_ELEMENT_MAX + 1];
+    char context[PROMETHEUS_ELEMENT_MAX + 1];
+    char family[PROMETHEUS_ELEMENT_MAX + 1];
+    char units[PROMETHEUS_ELEMENT_MAX + 1] = "";
+
+    prometheus_label_copy(chart,
+                          (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ?
+                           rrdset_name(st) : rrdset_id(st), sizeof(chart));
+    prometheus_label_copy(family, rrdset_family(st), sizeof(family));
+    prometheus_name_copy(context, rrdset_context(st), sizeof(context));
+
+    f->context = string_strdupz(context);
+
+    const char *suffixes[PROMETHEUS_FRAGMENT_TYPES] = { "", "" };
+    if (as_collected) {
+        if (!f->prometheus_collector)
+            suffixes[PROMETHEUS_FRAGMENT_COUNTER] = "_total";
+    }
+    else {
+        if (key->data_source == EXPORTING_SOURCE_DATA_AVERAGE) {
+            suffixes[PROMETHEUS_FRAGMENT_GAUGE] = "_average";
+
+            if (!(output_options & PROMETHEUS_OUTPUT_HIDEUNITS))
+                prometheus_units_copy(units,
+                                      rrdset_units(st),
+                                      PROMETHEUS_ELEMENT_MAX,
+                                      output_options & PROMETHEUS_OUTPUT_OLDUNITS);
+        }
+        else if (key->data_source == EXPORTING_SOURCE_DATA_SUM)
+            suffixes[PROMETHEUS_FRAGMENT_GAUGE] = "_sum";
+    }
+
+    // the chart labels are the same for all dimensions
+    BUFFER *chart_labels = buffer_create(0, NULL);
+    rrdlabels_walkthrough_read(st->rrdlabels, format_prometheus_chart_label_callback, chart_labels);
+
+    BUFFER *wb = f->text;
+
+    RRDDIM *rd;
+    rrddim_foreach_read(rd, st) {
+        char dimension[PROMETHEUS_ELEMENT_MAX + 1];
+        const char *name = (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rrddim_name(rd) : rrddim_id(rd);
+
+        PROMETHEUS_FRAGMENT_TYPE type = PROMETHEUS_FRAGMENT_GAUGE;
+        if (as_collected &&
+            (rd->algorithm == RRD_ALGORITHM_INCREMENTAL || rd->algorithm == RRD_ALGORITHM_PCENT_OVER_DIFF_TOTAL))
+            type = PROMETHEUS_FRAGMENT_COUNTER;
+
+        if (!f->help_type[type].length) {
+            f->help_type[type].offset = buffer_strlen(wb);
+            generate_as_collected_prom_help(wb, prefix, context, units, suffixes[type], st);
+            generate_as_collected_prom_type(
+                wb, prefix, context, units, suffixes[type], type == PROMETHEUS_FRAGMENT_COUNTER ? "counter" : "gauge");
+            f->help_type[type].length = buffer_strlen(wb) - f->help_type[type].offset;
+        }
+
+        if (f->homogeneous) {
+            // all the dimensions of the chart, has the same algorithm, multiplier and divisor
+            // we add all dimensions as labels
+            prometheus_label_copy(dimension, name, sizeof(dimension));
+        }
+        else {
+            // the dimensions of the chart, do not have the same algorithm, multiplier or divisor
+            // we create a metric per dimension
+            prometheus_name_copy(dimension, name, sizeof(dimension));
+        }
+
+        size_t offset = buffer_strlen(wb);
+
+        buffer_strcat(wb, prefix);
+        buffer_putc(wb, '_');
+        buffer_strcat(wb, context);
+        buffer_strcat(wb, units);
+
+        if (!f->homogeneous) {
+            buffer_putc(wb, '_');
+            buffer_strcat(wb, dimension);
+        }
+
+        buffer_sprintf(wb, "%s{%schart=\"%s\"", suffixes[type], plabels_prefix, chart);
+
+        if (f->homogeneous)
+            buffer_sprintf(wb, ",%sdimension=\"%s\"", plabels_prefix, dimension);
+
+        buffer_sprintf(wb, ",%sfamily=\"%s\"", plabels_prefix, family);
+        buffer_fast_strcat(wb, buffer_tostring(chart_labels), buffer_strlen(chart_labels));
+
+        if (f->dimensions.used == f->dimensions.size) {
+            f->dimensions.size = f->dimensions.size ? f->dimensions.size * 2 : 16;
+            f->dimensions.array = reallocz(f->dimensions.array, f->dimensions.size * sizeof(*f->dimensions.array));
+        }
+
+        f->dimensions.array[f->dimensions.used++] = (struct prometheus_fragment_dimension) {
+            .rd = rd,
+            .offset = (uint32_t)offset,
+            .length = (uint32_t)(buffer_strlen(wb) - offset),
+            .type = type,
+        };
+    }
+    rrddim_foreach_done(rd);
+
+    buffer_free(chart_labels);
+
+    if (f->dimensions.used > 1)
+        qsort(f->dimensions.array, f->dimensions.used, sizeof(*f->dimensions.array),
+              prometheus_fragment_dimension_compar);
+
+    return f;
+}
+
+/**
+ * Get the fragment of a chart for the key of a scrape, generating it when it is missing or outdated
+ *
+ * @param st a chart.
+ * @param opts the options of the scrape.
+ * @param homogeneous a flag for homogeneous charts.
+ * @param prometheus_collector a flag for metrics from prometheus collector.
+ * @return Returns the fragment, which should be released with prometheus_fragment_release().
+ */
+static struct prometheus_fragment *prometheus_fragment_acquire(
+    RRDSET *st,
+    struct host_variables_callback_options *opts,
+    bool homogeneous,
+    bool prometheus_collector)
+{
+    // the versions are read before the fragment is generated,
+    // so that changes made while generating it, make it outdated
+    struct prometheus_fragment key = {
+        .metadata_version = rrdset_metadata_version(st),
+        .labels_version = rrdlabels_version(st->rrdlabels),
+        .dimensions_version = dictionary_version(st->rrddim_root_index),
+        .output_options = opts->output_options & PROMETHEUS_FRAGMENT_OUTPUT_OPTIONS,
+        .data_source = EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options),
+        .homogeneous = homogeneous,
+        .prometheus_collector = prometheus_collector,
+        .prefix = opts->prefix_string,
+        .label_prefix = opts->label_prefix_string,
+    };
+
+    spinlock_lock(&st->prometheus.spinlock);
+    struct prometheus_fragment *f;
+    for (f = st->prometheus.fragments; f; f = f->next) {
+        if (prometheus_fragment_has_key(f, &key) && prometheus_fragment_is_current(f, &key)) {
+            // keep the list in most recently used order
+            if (f != st->prometheus.fragments) {
+                DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(st->prometheus.fragments, f, prev, next);
+                DOUBLE_LINKED_LIST_PREPEND_ITEM_UNSAFE(st->prometheus.fragments, f, prev, next);
+            }
+
+            f->refcount++;
+            spinlock_unlock(&st->prometheus.spinlock);
+            return f;
+        }
+    }
+    spinlock_unlock(&st->prometheus.spinlock);
+
+    f = prometheus_fragment_create(st, opts, &key);
+
+    // the fragments removed from the list, that nobody uses
+    struct prometheus_fragment *to_free = NULL;
+
+    spinlock_lock(&st->prometheus.spinlock);
+    DOUBLE_LINKED_LIST_PREPEND_ITEM_UNSAFE(st->prometheus.fragments, f, prev, next);
+    f->refcount++;
+
+    // remove the outdated fragments, the ones with the same key
+    // (generated concurrently) and the least recently used beyond the max
+    size_t kept = 1;
+    struct prometheus_fragment *t = f->next;
+    while (t) {
+        struct prometheus_fragment *next = t->next;
+
+        if (!prometheus_fragment_is_current(t, &key) || prometheus_fragment_has_key(t, &key) ||
+            kept >= PROMETHEUS_FRAGMENTS_MAX) {
+            DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(st->prometheus.fragments, t, prev, next);
+            if (--t->refcount == 0) {
+                t->next = to_free;
+                to_free = t;
+            }
+        }
+        else
+            kept++;
+
+        t = next;
+    }
+    spinlock_unlock(&st->prometheus.spinlock);
+
+    while (to_free) {
+        t = to_free;
+        to_free = to_free->next;
+        prometheus_fragment_free(t);
+    }
+
+    return f;
+}
+
+static void prometheus_fragment_release(RRDSET *st, struct prometheus_fragment *f)
+{
+    spinlock_lock(&st->prometheus.spinlock);
+    bool last = (--f->refcount == 0);
+    spinlock_unlock(&st->prometheus.spinlock);
+
+    if (last)
+        prometheus_fragment_free(f);
+}
+
+/**
+ * Free the fragment of a chart that is deleted
+ *
+ * @param st a chart.
+ */
+void prometheus_rrdset_cleanup(RRDSET *st)
+{
+    struct prometheus_fragment *to_free = NULL;
+
+    spinlock_lock(&st->prometheus.spinlock);
+    while (st->prometheus.fragments) {
+        struct prometheus_fragment *f = st->prometheus.fragments;
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(st->prometheus.fragments, f, prev, next);
+        if (--f->refcount == 0) {
+            f->next = to_free;
+            to_free = f;
+        }
+    }
+    spinlock_unlock(&st->prometheus.spinlock);
+
+    while (to_free) {
+        struct prometheus_fragment *f = to_free;
+        to_free = to_free->next;
+        prometheus_fragment_free(f);
+    }
+}
+
+static inline struct prometheus_fragment_dimension *prometheus_fragment_dimension(struct prometheus_fragment *f, RRDDIM *rd)
+{
+    struct prometheus_fragment_dimension key = { .rd = rd };
+    return bsearch(&key, f->dimensions.array, f->dimensions.used, sizeof(*f->dimensions.array),
+                   prometheus_fragment_dimension_compar);
+}
+
 /**
  * RRDSET to JSON
  *
@@ -608,27 +971,29 @@ static int prometheus_rrdset_to_json(RRDSET *st, void *data)
     if (likely(can_send_rrdset(opts->instance, st, opts->pattern))) {
         PROMETHEUS_OUTPUT_OPTIONS output_options = opts->output_options;
         BUFFER *wb = opts->wb;
-        const char *prefix = opts->prefix;
 
-        BUFFER *plabels_buffer = opts->plabels_buffer;
-        const char *plabels_prefix = opts->instance->config.label_prefix;
+        int as_collected = (EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options)
+                            == EXPORTING_SOURCE_DATA_AS_COLLECTED);
+        bool homogeneous = true;
+        bool prometheus_collector = false;
+        if (as_collected) {
+            RRDSET_FLAGS flags = rrdset_flag_get(st);
+            if (flags & RRDSET_FLAG_HOMOGENEOUS_CHECK)
+                rrdset_update_heterogeneous_flag(st);
 
-        STRING *prometheus = opts->prometheus;
+            if (flags & RRDSET_FLAG_HETEROGENEOUS)
+                homogeneous = false;
 
-        char chart[PROMETHEUS_ELEMENT_MAX + 1];
-        char context[PROMETHEUS_ELEMENT_MAX + 1];
-        char family[PROMETHEUS_ELEMENT_MAX + 1];
-        char units[PROMETHEUS_ELEMENT_MAX + 1] = "";
+            if (st->module_name == opts->prometheus)
+                prometheus_collector = true;
+        }
 
-        prometheus_label_copy(chart,
-                              (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ?
-                               rrdset_name(st) : rrdset_id(st), sizeof(chart));
-        prometheus_label_copy(family, rrdset_family(st), sizeof(family));
-        prometheus_name_copy(context, rrdset_context(st), sizeof(context));
+        struct prometheus_fragment *f = prometheus_fragment_acquire(st, opts, homogeneous, prometheus_collector);
+        const char *text = buffer_tostring(f->text);
 
         if(opts->output_options & PROMETHEUS_OUTPUT_HELP_TYPE) {
             // we do not want to print HELP and TYPE for the same context twice
-            STRING *context_id = string_strdupz(context);
+            STRING *context_id = string_dup(f->context);
             PROMETHEUS_OUTPUT_OPTIONS ctx_opts = PROM_CONTEXT_OPTIONS_GET(opts->context_options, (Word_t)context_id);
             if (!(ctx_opts & PROMETHEUS_OUTPUT_HELP_TYPE)) {
                 // it is not printed for this context yet
@@ -642,154 +1007,73 @@ static int prometheus_rrdset_to_json(RRDSET *st, void *data)
             }
         }
 
-        int as_collected = (EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options)
-                            == EXPORTING_SOURCE_DATA_AS_COLLECTED);
-        int homogeneous = 1;
-        int prometheus_collector = 0;
-        RRDSET_FLAGS flags = rrdset_flag_get(st);
-        if (as_collected) {
-            if (flags & RRDSET_FLAG_HOMOGENEOUS_CHECK)
-                rrdset_update_heterogeneous_flag(st);
-
-            if (flags & RRDSET_FLAG_HETEROGENEOUS)
-                homogeneous = 0;
-
-            if (st->module_name == prometheus)
-                prometheus_collector = 1;
-        }
-        else {
-            if (EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE &&
-                !(output_options & PROMETHEUS_OUTPUT_HIDEUNITS))
-                prometheus_units_copy(units,
-                                      rrdset_units(st),
-                                      PROMETHEUS_ELEMENT_MAX,
-                                      output_options & PROMETHEUS_OUTPUT_OLDUNITS);
-        }
-
         // for each dimension
         RRDDIM *rd;
         rrddim_foreach_read(rd, st) {
 
             if (rd->collector.counter && !rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE)) {
-                char dimension[PROMETHEUS_ELEMENT_MAX + 1];
-                char *suffix = "";
-
-                struct gen_parameters p;
-                p.prefix = prefix;
-                p.labels_prefix = plabels_prefix;
-                p.context = context;
-                p.suffix = suffix;
-                p.chart = chart;
-                p.dimension = dimension;
-                p.family = family;
-                p.labels = (char *)opts->labels;
-                p.output_options = output_options;
-                p.st = st;
-                p.rd = rd;
+                struct prometheus_fragment_dimension *d = prometheus_fragment_dimension(f, rd);
+                if (unlikely(!d)) {
+                    // the dimension has been added after the fragment was generated,
+                    // it will be exposed on the next scrape
+                    continue;
+                }
+
+                NETDATA_DOUBLE value = NAN;
+                time_t last_time = opts->instance->before;
 
                 if (as_collected) {
                     // we need as-collected / raw data
 
                     if (unlikely(rd->collector.last_collected_time.tv_sec < opts->instance->after))
                         continue;
+                }
+                else {
+                    // we need average or sum of the data
 
-                    p.type = "gauge";
-                    p.relation = "gives";
-                    if (rd->algorithm == RRD_ALGORITHM_INCREMENTAL ||
-                        rd->algorithm == RRD_ALGORITHM_PCENT_OVER_DIFF_TOTAL) {
-                        p.type = "counter";
-                        p.relation = "delta gives";
-                        if (!prometheus_collector)
-                            p.suffix = "_total";
-                    }
+                    value = exporting_calculate_value_from_stored_data(opts->instance, rd, &last_time);
 
-                    if (opts->output_options & PROMETHEUS_OUTPUT_HELP_TYPE) {
-                        generate_as_collected_prom_help(wb, prefix, context, units, p.suffix, st);
-                        generate_as_collected_prom_type(wb, prefix, context, units, p.suffix, p.type);
-                        opts->output_options &= ~PROMETHEUS_OUTPUT_HELP_TYPE;
-                    }
+                    if (isnan(value) || isinf(value))
+                        continue;
+                }
 
-                    if (homogeneous) {
-                        // all the dimensions of the chart, has the same algorithm, multiplier and divisor
-                        // we add all dimensions as labels
+                if (opts->output_options & PROMETHEUS_OUTPUT_HELP_TYPE) {
+                    buffer_fast_strcat(wb, &text[f->help_type[d->type].offset], f->help_type[d->type].length);
+                    opts->output_options &= ~PROMETHEUS_OUTPUT_HELP_TYPE;
+                }
 
-                        prometheus_label_copy(
-                            dimension,
-                            (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rrddim_name(rd) : rrddim_id(rd),
-                            sizeof(dimension));
-                    }
-                    else {
-                        // the dimensions of the chart, do not have the same algorithm, multiplier or divisor
-                        // we create a metric per dimension
-
-                        prometheus_name_copy(
-                            dimension,
-                            (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rrddim_name(rd) : rrddim_id(rd),
-                            sizeof(dimension));
+                buffer_fast_strcat(wb, &text[d->offset], d->length);
+                buffer_strcat(wb, opts->labels);
+                buffer_putc(wb, '}');
+                buffer_putc(wb, ' ');
+
+                if (as_collected) {
+                    if (prometheus_collector)
+                        buffer_print_netdata_double(wb,
+                            (NETDATA_DOUBLE)rd->collector.last_collected_value * (NETDATA_DOUBLE)rd->multiplier /
+                            (NETDATA_DOUBLE)rd->divisor);
+                    else
+                        buffer_print_int64(wb, rd->collector.last_collected_value);
+
+                    if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS) {
+                        buffer_putc(wb, ' ');
+                        buffer_print_uint64(wb, timeval_msec(&rd->collector.last_collected_time));
                     }
-                    generate_as_collected_from_metric(wb, &p, homogeneous, prometheus_collector, st->rrdlabels);
+
+                    buffer_putc(wb, '\n');
                 }
                 else {
-                    // we need average or sum of the data
-
-                    time_t last_time = opts->instance->before;
-                    NETDATA_DOUBLE value = exporting_calculate_value_from_stored_data(opts->instance, rd, &last_time);
-
-                    if (!isnan(value) && !isinf(value)) {
-                        if (EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE)
-                            suffix = "_average";
-                        else if (EXPORTING_OPTIONS_DATA_SOURCE(opts->exporting_options)
-                                 == EXPORTING_SOURCE_DATA_SUM)
-                            suffix = "_sum";
-
-                        prometheus_label_copy(
-                            dimension,
-                            (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rrddim_name(rd) : rrddim_id(rd),
-                            sizeof(dimension));
-
-                        if (opts->output_options & PROMETHEUS_OUTPUT_HELP_TYPE) {
-                            generate_as_collected_prom_help(wb, prefix, context, units, suffix, st);
-                            generate_as_collected_prom_type(wb, prefix, context, units, suffix, "gauge");
-                            opts->output_options &= ~PROMETHEUS_OUTPUT_HELP_TYPE;
-                        }
-
-                        buffer_flush(plabels_buffer);
-                        buffer_sprintf(plabels_buffer,
-                                       "%1$schart=\"%2$s\",%1$sdimension=\"%3$s\",%1$sfamily=\"%4$s\"",
-                                       plabels_prefix,
-                                       chart,
-                                       dimension,
-                                       family);
-                        rrdlabels_walkthrough_read(st->rrdlabels,
-                                                   format_prometheus_chart_label_callback,
-                                                   plabels_buffer);
-
-                        if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
-                            buffer_sprintf(wb,
-                                           "%s_%s%s%s{%s%s} " NETDATA_DOUBLE_FORMAT " %llu\n",
-                                           prefix,
-                                           context,
-                                           units,
-                                           suffix,
-                                           buffer_tostring(plabels_buffer),
-                                           opts->labels,
-                                           value,
-                                           last_time * MSEC_PER_SEC);
-                        else
-                            buffer_sprintf(wb, "%s_%s%s%s{%s%s} " NETDATA_DOUBLE_FORMAT "\n",
-                                           prefix,
-                                           context,
-                                           units,
-                                           suffix,
-                                           buffer_tostring(plabels_buffer),
-                                           opts->labels,
-                                           value);
-                    }
+                    if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
+                        buffer_sprintf(wb, NETDATA_DOUBLE_FORMAT " %llu\n", value, last_time * MSEC_PER_SEC);
+                    else
+                        buffer_sprintf(wb, NETDATA_DOUBLE_FORMAT "\n", value);
                 }
             }
         }
         rrddim_foreach_done(rd);
 
+        prometheus_fragment_release(st, f);
+
         return 1;
     }
 
@@ -878,13 +1162,9 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
     if (instance->config.options & EXPORTING_OPTION_SEND_AUTOMATIC_LABELS)
         prometheus_print_os_info(wb, host, output_options);
 
-
-    BUFFER *plabels_buffer = buffer_create(0, NULL);
-
     struct host_variables_callback_options opts = {
         .host = host,
         .wb = wb,
-        .plabels_buffer = plabels_buffer,
         .labels = labels, // FIX: very misleading name and poor implementation of adding the "instance" label
         .exporting_options = exporting_options,
         .output_options = output_options,
@@ -894,6 +1174,8 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
         .pattern = filter,
         .instance = instance,
         .prometheus = string_strdupz("prometheus"),
+        .prefix_string = string_strdupz(prefix),
+        .label_prefix_string = string_strdupz(instance->config.label_prefix),
         .context_options = context_options,
     };
 
@@ -912,8 +1194,9 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
 
 allmetrics_cleanup:
     simple_pattern_free(filter);
-    buffer_free(plabels_buffer);
     string_freez(opts.prometheus);
+    string_freez(opts.prefix_string);
+    string_freez(opts.label_prefix_string);
 }
 
 /**
@@ -925,14 +1208,15 @@ allmetrics_cleanup:
  * @param exporting_options options to configure what data is exported.
  * @param server the name of a Prometheus server..
  * @param now actual time.
- * @param output_options options to configure the format of the output.
+ * @param response_size returns the size of the last response to the server.
  * @return Returns the last time when the server accessed Netdata.
  */
 static inline time_t prometheus_preparation(
     struct instance *instance,
     RRDHOST *host,
     const char *server,
-    time_t now)
+    time_t now,
+    size_t *response_size)
 {
 #ifndef UNIT_TESTING
     analytics_log_prometheus();
@@ -940,7 +1224,7 @@ static inline time_t prometheus_preparation(
     if (!server || !*server)
         server = "default";
 
-    time_t after = prometheus_server_last_access(server, host, now);
+    time_t after = prometheus_server_last_access(server, host, now, response_size);
 
     if (!after) {
         after = now - instance->config.update_every;
@@ -980,11 +1264,17 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
     prometheus_exporter_instance->before = now_realtime_sec();
 
     // we start at the point we had stopped before
+    size_t response_size;
     prometheus_exporter_instance->after = prometheus_preparation(
         prometheus_exporter_instance,
         host,
         server,
-        prometheus_exporter_instance->before);
+        prometheus_exporter_instance->before,
+        &response_size);
+
+    // the response is usually as big as the previous one, allocate it at once
+    size_t len = buffer_strlen(wb);
+    buffer_need_bytes(wb, response_size);
 
     PROM_CONTEXT_OPTIONS_JudyLSet context_options;
     PROM_CONTEXT_OPTIONS_INIT(&context_options);
@@ -993,6 +1283,8 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
         prometheus_exporter_instance, host, filter_string, wb, prefix, exporting_options, 0, output_options, &context_options);
 
     PROM_CONTEXT_OPTIONS_FREE(&context_options, PROM_CONTEXT_OPTIONS_free_cb, NULL);
+
+    prometheus_server_set_response_size(server, host, buffer_strlen(wb) - len);
 }
 
 /**
@@ -1021,21 +1313,291 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_all_hosts(
     prometheus_exporter_instance->before = now_realtime_sec();
 
     // we start at the point we had stopped before
+    size_t response_size;
     prometheus_exporter_instance->after = prometheus_preparation(
         prometheus_exporter_instance,
         host,
         server,
-        prometheus_exporter_instance->before);
+        prometheus_exporter_instance->before,
+        &response_size);
+
+    // the response is usually as big as the previous one, allocate it at once
+    size_t len = buffer_strlen(wb);
+    buffer_need_bytes(wb, response_size);
 
     PROM_CONTEXT_OPTIONS_JudyLSet context_options;
     PROM_CONTEXT_OPTIONS_INIT(&context_options);
 
-    dfe_start_reentrant(rrdhost_root_index, host)
+    RRDHOST *h;
+    dfe_start_reentrant(rrdhost_root_index, h)
     {
         rrd_stats_api_v1_charts_allmetrics_prometheus(
-            prometheus_exporter_instance, host, filter_string, wb, prefix, exporting_options, 1, output_options, &context_options);
+            prometheus_exporter_instance, h, filter_string, wb, prefix, exporting_options, 1, output_options, &context_options);
     }
-    dfe_done(host);
+    dfe_done(h);
 
     PROM_CONTEXT_OPTIONS_FREE(&context_options, PROM_CONTEXT_OPTIONS_free_cb, NULL);
+
+    prometheus_server_set_response_size(server, host, buffer_strlen(wb) - len);
+}
+
+// ----------------------------------------------------------------------------
+// unittest - the output with cached fragments, byte for byte
+
+#define PROMETHEUS_UNITTEST_POINTS 30
+
+static void prometheus_unittest_collect(RRDSET *st, RRDDIM **rds, collected_number *values, size_t dims, time_t start_s)
+{
+    // set the last collection time just before the first point, so that
+    // the values are stored as-is, without interpolation
+    for (size_t d = 0; d < dims; d++) {
+        rds[d]->collector.last_collected_time.tv_sec =
+            st->last_collected_time.tv_sec = st->last_updated.tv_sec = start_s - 1;
+        rds[d]->collector.last_collected_time.tv_usec =
+            st->last_collected_time.tv_usec = st->last_updated.tv_usec = 0;
+    }
+
+    for (time_t p = 0; p < PROMETHEUS_UNITTEST_POINTS; p++) {
+        time_t now_s = start_s + p;
+        st->usec_since_last_update = USEC_PER_SEC;
+
+        for (size_t d = 0; d < dims; d++) {
+            RRDDIM *rd = rds[d];
+            rd->collector.last_collected_time.tv_sec = now_s;
+            rd->collector.last_collected_time.tv_usec = 0;
+            rd->collector.collected_value = values[d];
+            rrddim_set_updated(rd);
+            rd->collector.counter++;
+        }
+
+        rrdset_timed_done(st, (struct timeval){ .tv_sec = now_s, .tv_usec = 0 }, false);
+    }
+}
+
+static size_t prometheus_unittest_fragments(RRDSET *st, struct prometheus_fragment **first)
+{
+    size_t count = 0;
+
+    spinlock_lock(&st->prometheus.spinlock);
+    *first = st->prometheus.fragments;
+    for (struct prometheus_fragment *f = st->prometheus.fragments; f; f = f->next)
+        count++;
+    spinlock_unlock(&st->prometheus.spinlock);
+
+    return count;
+}
+
+static size_t prometheus_unittest_scrape(
+    struct instance *instance,
+    RRDHOST *host,
+    RRDSET *st,
+    const char *prefix,
+    EXPORTING_OPTIONS exporting_options,
+    int allhosts,
+    PROMETHEUS_OUTPUT_OPTIONS output_options,
+    BUFFER *expected,
+    const char *test)
+{
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+
+    PROM_CONTEXT_OPTIONS_JudyLSet context_options;
+    PROM_CONTEXT_OPTIONS_INIT(&context_options);
+
+    rrd_stats_api_v1_charts_allmetrics_prometheus(
+        instance, host, rrdset_id(st), wb, prefix, exporting_options, allhosts, output_options, &context_options);
+
+    PROM_CONTEXT_OPTIONS_FREE(&context_options, PROM_CONTEXT_OPTIONS_free_cb, NULL);
+
+    // the host info line is not cached, it is added to the expected output here
+    CLEAN_BUFFER *exp = buffer_create(0, NULL);
+    buffer_sprintf(exp, "netdata_info{instance=\"%s\",application=\"%s\",version=\"%s\"} 1\n",
+                   rrdhost_hostname(host), rrdhost_program_name(host), rrdhost_program_version(host));
+    buffer_fast_strcat(exp, buffer_tostring(expected), buffer_strlen(expected));
+
+    if (strcmp(buffer_tostring(wb), buffer_tostring(exp)) != 0) {
+        fprintf(stderr, " >>> PROMETHEUS: %s: the output is:\n%s >>> PROMETHEUS: %s: expected:\n%s",
+                test, buffer_tostring(wb), test, buffer_tostring(exp));
+        return 1;
+    }
+
+    return 0;
+}
+
+int prometheus_unittest(void)
+{
+    size_t errors = 0;
+
+    nd_uuid_t uuid;
+    char guid[UUID_STR_LEN];
+    uuid_generate(uuid);
+    uuid_unparse_lower(uuid, guid);
+
+    const char *hostname = "unittest-prometheus";
+    RRDHOST *host = rrdhost_find_or_create(
+        hostname, hostname, guid, os_type,
+        netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+        program_name, NETDATA_VERSION,
+        1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+        false, false, NULL, NULL, NULL,
+        false, 0, 0, NULL, false);
+
+    if (!host) {
+        fprintf(stderr, "PROMETHEUS: FAILED (cannot create host)\n");
+        return 1;
+    }
+
+    // a homogeneous chart, with a label
+    RRDSET *st1 = rrdset_create(host, "unittest", "prom_homogeneous", "prom_homogeneous_name", "family",
+                                "unittest.prom_homogeneous", "Homogeneous", "units/s", "unittest", "prometheus",
+                                1, 1, RRDSET_TYPE_LINE);
+    rrdlabels_add(st1->rrdlabels, "lbl", "value", RRDLABEL_SRC_CONFIG);
+    RRDDIM *rds1[2] = {
+        rrddim_add(st1, "d1", "one", 1, 1, RRD_ALGORITHM_ABSOLUTE),
+        rrddim_add(st1, "d2", "two", 1, 1, RRD_ALGORITHM_ABSOLUTE),
+    };
+    collected_number values1[2] = { 11, 22 };
+
+    // a heterogeneous chart
+    RRDSET *st2 = rrdset_create(host, "unittest", "prom_heterogeneous", NULL, "family",
+                                "unittest.prom_heterogeneous", "Heterogeneous", "units", "unittest", "prometheus",
+                                1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rds2[2] = {
+        rrddim_add(st2, "a", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE),
+        rrddim_add(st2, "c", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL),
+    };
+    collected_number values2[2] = { 5, 1000 };
+
+    time_t now_s = now_realtime_sec();
+    prometheus_unittest_collect(st1, rds1, values1, 2, now_s - PROMETHEUS_UNITTEST_POINTS + 1);
+    prometheus_unittest_collect(st2, rds2, values2, 2, now_s - PROMETHEUS_UNITTEST_POINTS + 1);
+
+    struct instance instance = {
+        .config = {
+            .name = "unittest",
+            .options = EXPORTING_SOURCE_DATA_AVERAGE,
+            .label_prefix = "",
+        },
+        .before = now_s,
+        .after = now_s - 10,
+    };
+
+    CLEAN_BUFFER *expected = buffer_create(0, NULL);
+    struct prometheus_fragment *first, *netdata_fragment;
+    size_t fragments;
+
+#define PROMETHEUS_UNITTEST_HOMOGENEOUS(prefix, lp, chart, d1, d2, instance_label)                                      \
+    buffer_flush(expected);                                                                                             \
+    buffer_sprintf(expected,                                                                                            \
+        "# HELP " prefix "_unittest_prom_homogeneous Homogeneous\n"                                                     \
+        "# TYPE " prefix "_unittest_prom_homogeneous gauge\n"                                                           \
+        prefix "_unittest_prom_homogeneous{" lp "chart=\"" chart "\"," lp "dimension=\"" d1 "\"," lp "family=\"family\"," \
+        "lbl=\"value\"%s} 11\n"                                                                                          \
+        prefix "_unittest_prom_homogeneous{" lp "chart=\"" chart "\"," lp "dimension=\"" d2 "\"," lp "family=\"family\"," \
+        "lbl=\"value\"%s} 22\n",                                                                                         \
+        instance_label, instance_label)
+
+    // as collected, scraped twice
+    PROMETHEUS_UNITTEST_HOMOGENEOUS("netdata", "", "unittest.prom_homogeneous", "d1", "d2", "");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "as collected");
+    prometheus_unittest_fragments(st1, &netdata_fragment);
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "as collected, cached");
+
+    // another prefix gets its own fragment
+    PROMETHEUS_UNITTEST_HOMOGENEOUS("other", "", "unittest.prom_homogeneous", "d1", "d2", "");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "other", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "another prefix");
+
+    fragments = prometheus_unittest_fragments(st1, &first);
+    if (fragments != 2) {
+        fprintf(stderr, " >>> PROMETHEUS: the chart has %zu fragments, expected 2\n", fragments);
+        errors++;
+    }
+
+    // the first fragment is still used, it is not generated again
+    PROMETHEUS_UNITTEST_HOMOGENEOUS("netdata", "", "unittest.prom_homogeneous", "d1", "d2", "");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "the first prefix again");
+
+    prometheus_unittest_fragments(st1, &first);
+    if (first != netdata_fragment) {
+        fprintf(stderr, " >>> PROMETHEUS: the fragment of the first prefix has been generated again\n");
+        errors++;
+    }
+
+    // the label prefix is part of the key
+    instance.config.label_prefix = "nd_";
+    PROMETHEUS_UNITTEST_HOMOGENEOUS("netdata", "nd_", "unittest.prom_homogeneous", "d1", "d2",
+                                    ",nd_instance=\"unittest-prometheus\"");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 1,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "label prefix, all hosts");
+    instance.config.label_prefix = "";
+
+    // names
+    PROMETHEUS_UNITTEST_HOMOGENEOUS("netdata", "", "unittest.prom_homogeneous_name", "one", "two", "");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NAMES, expected, "names");
+
+    // average, with units
+    buffer_flush(expected);
+    buffer_sprintf(expected,
+        "# HELP netdata_unittest_prom_homogeneous_units_persec_average Homogeneous\n"
+        "# TYPE netdata_unittest_prom_homogeneous_units_persec_average gauge\n"
+        "netdata_unittest_prom_homogeneous_units_persec_average{chart=\"unittest.prom_homogeneous\",dimension=\"d1\",family=\"family\",lbl=\"value\"} " NETDATA_DOUBLE_FORMAT "\n"
+        "netdata_unittest_prom_homogeneous_units_persec_average{chart=\"unittest.prom_homogeneous\",dimension=\"d2\",family=\"family\",lbl=\"value\"} " NETDATA_DOUBLE_FORMAT "\n",
+        (NETDATA_DOUBLE)11, (NETDATA_DOUBLE)22);
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AVERAGE, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "average");
+
+    // average, without units
+    buffer_flush(expected);
+    buffer_sprintf(expected,
+        "# HELP netdata_unittest_prom_homogeneous_average Homogeneous\n"
+        "# TYPE netdata_unittest_prom_homogeneous_average gauge\n"
+        "netdata_unittest_prom_homogeneous_average{chart=\"unittest.prom_homogeneous\",dimension=\"d1\",family=\"family\",lbl=\"value\"} " NETDATA_DOUBLE_FORMAT "\n"
+        "netdata_unittest_prom_homogeneous_average{chart=\"unittest.prom_homogeneous\",dimension=\"d2\",family=\"family\",lbl=\"value\"} " NETDATA_DOUBLE_FORMAT "\n",
+        (NETDATA_DOUBLE)11, (NETDATA_DOUBLE)22);
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AVERAGE, 0,
+                                         PROMETHEUS_OUTPUT_HIDEUNITS, expected, "average, hidden units");
+
+    fragments = prometheus_unittest_fragments(st1, &first);
+    if (fragments != PROMETHEUS_FRAGMENTS_MAX) {
+        fprintf(stderr, " >>> PROMETHEUS: the chart has %zu fragments, expected %d\n", fragments, PROMETHEUS_FRAGMENTS_MAX);
+        errors++;
+    }
+
+    // a label change makes all the fragments outdated
+    rrdlabels_add(st1->rrdlabels, "lbl", "changed", RRDLABEL_SRC_CONFIG);
+    buffer_flush(expected);
+    buffer_strcat(expected,
+        "# HELP netdata_unittest_prom_homogeneous Homogeneous\n"
+        "# TYPE netdata_unittest_prom_homogeneous gauge\n"
+        "netdata_unittest_prom_homogeneous{chart=\"unittest.prom_homogeneous\",dimension=\"d1\",family=\"family\",lbl=\"changed\"} 11\n"
+        "netdata_unittest_prom_homogeneous{chart=\"unittest.prom_homogeneous\",dimension=\"d2\",family=\"family\",lbl=\"changed\"} 22\n");
+    errors += prometheus_unittest_scrape(&instance, host, st1, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "changed label");
+
+    fragments = prometheus_unittest_fragments(st1, &first);
+    if (fragments != 1) {
+        fprintf(stderr, " >>> PROMETHEUS: the chart has %zu fragments after a label change, expected 1\n", fragments);
+        errors++;
+    }
+
+    // heterogeneous, with a counter
+    buffer_flush(expected);
+    buffer_strcat(expected,
+        "# HELP netdata_unittest_prom_heterogeneous Heterogeneous\n"
+        "# TYPE netdata_unittest_prom_heterogeneous gauge\n"
+        "netdata_unittest_prom_heterogeneous_a{chart=\"unittest.prom_heterogeneous\",family=\"family\"} 5\n"
+        "netdata_unittest_prom_heterogeneous_c_total{chart=\"unittest.prom_heterogeneous\",family=\"family\"} 1000\n");
+    errors += prometheus_unittest_scrape(&instance, host, st2, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "heterogeneous");
+    errors += prometheus_unittest_scrape(&instance, host, st2, "netdata", EXPORTING_SOURCE_DATA_AS_COLLECTED, 0,
+                                         PROMETHEUS_OUTPUT_NONE, expected, "heterogeneous, cached");
+
+#undef PROMETHEUS_UNITTEST_HOMOGENEOUS
+
+    fprintf(stderr, "PROMETHEUS: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
 }
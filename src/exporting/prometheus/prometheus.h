@@ -34,5 +34,6 @@ char *prometheus_units_copy(char *d, const char *s, size_t usable, int showoldun
 void format_host_labels_prometheus(struct instance *instance, RRDHOST *host);
 
 void prometheus_clean_server_root();
+void prometheus_rrdset_cleanup(RRDSET *st);
 
 #endif //NETDATA_EXPORTING_PROMETHEUS_H
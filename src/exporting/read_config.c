@@ -309,11 +309,26 @@ struct engine *read_exporting_config()
     engine = (struct engine *)callocz(1, sizeof(struct engine));
     // TODO: Check and fill engine fields if actually needed
 
+    size_t query_threads = netdata_conf_cpus() / 4;
+    if (query_threads < 1)
+        query_threads = 1;
+    if (query_threads > EXPORTING_QUERY_THREADS_DEFAULT_MAX)
+        query_threads = EXPORTING_QUERY_THREADS_DEFAULT_MAX;
+    engine->config.query_threads = query_threads;
+
     if (exporting_config_exists) {
         engine->config.hostname =
             strdupz(exporter_get(CONFIG_SECTION_EXPORTING, "hostname", netdata_configured_hostname));
         engine->config.update_every = exporter_get_number(
             CONFIG_SECTION_EXPORTING, EXPORTING_UPDATE_EVERY_OPTION_NAME, EXPORTING_UPDATE_EVERY_DEFAULT);
+
+        long long threads = exporter_get_number(
+            CONFIG_SECTION_EXPORTING, EXPORTING_QUERY_THREADS_OPTION_NAME, (long long)query_threads);
+        if (threads < 1)
+            threads = 1;
+        if (threads > EXPORTING_QUERY_THREADS_MAX)
+            threads = EXPORTING_QUERY_THREADS_MAX;
+        engine->config.query_threads = (size_t)threads;
     }
 
     while (tmp_ci_list) {
@@ -0,0 +1,637 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "exporting_engine.h"
+
+// The values of the instances using "average" or "sum" as data source are calculated from the database.
+//
+// All the instances scheduled at the same time share the same time-frame, so before formatting,
+// the values of all the dimensions are calculated once per time-frame and are shared by all instances.
+// The hosts are spread to a pool of threads, and the main exporting thread calculates hosts too.
+//
+// Then, while formatting, exporting_calculate_value_from_stored_data() returns the shared values.
+
+struct exporting_timeframe {
+    time_t after;
+    time_t before;
+};
+
+struct exporting_dimension_values {
+    RRDDIM *rd;
+    UUIDMAP_ID uuid;                // to detect dimensions freed and reallocated at the same address
+    size_t first_value;             // the index of the value of the first time-frame in host values
+};
+
+struct exporting_host_values {
+    RRDHOST *host;
+
+    struct {
+        struct exporting_dimension_values *array;
+        size_t used;
+        size_t size;
+    } dimensions;
+
+    struct {
+        struct exporting_stored_value *array;
+        size_t used;
+        size_t size;
+    } values;
+};
+
+struct exporting_stored_data {
+    struct completion completion;   // wakes up the workers when an iteration is published
+
+    SPINLOCK spinlock;
+    size_t claimed;                 // protected by the spinlock
+    size_t completed;               // atomic
+    bool published;                 // protected by the spinlock
+    struct completion *iteration_completion;
+
+    struct engine *engine;
+
+    // the time-frames of the current iteration
+    struct {
+        struct exporting_timeframe array[EXPORTING_STORED_DATA_MAX_TIMEFRAMES];
+        size_t used;
+    } timeframes;
+
+    // the values of the hosts of the current iteration
+    struct {
+        struct exporting_host_values *array;
+        size_t used;
+        size_t size;
+    } hosts;
+
+    size_t workers;
+    ND_THREAD **threads;
+};
+
+// the values of the host being formatted by the main exporting thread
+static __thread struct exporting_host_values *exporting_current_host_values = NULL;
+
+/**
+ * Find a time-frame
+ *
+ * @param sd the stored data of the engine.
+ * @param after the start of the time-frame.
+ * @param before the end of the time-frame.
+ * @return Returns the index of the time-frame, or -1 if it is not there.
+ */
+static ssize_t exporting_timeframe_find(struct exporting_stored_data *sd, time_t after, time_t before)
+{
+    for (size_t i = 0; i < sd->timeframes.used; i++) {
+        if (sd->timeframes.array[i].after == after && sd->timeframes.array[i].before == before)
+            return (ssize_t)i;
+    }
+
+    return -1;
+}
+
+/**
+ * Check if an instance needs values calculated from the database
+ *
+ * @param instance an instance data structure.
+ * @return Returns true if the instance is scheduled and uses "average" or "sum" as data source.
+ */
+static inline bool exporting_instance_needs_stored_data(struct instance *instance)
+{
+    return instance->scheduled && !instance->disabled &&
+           EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) != EXPORTING_SOURCE_DATA_AS_COLLECTED;
+}
+
+/**
+ * Calculate the values of all the dimensions of a host
+ *
+ * Only the time-frames of the instances that export each chart are calculated.
+ *
+ * @param sd the stored data of the engine.
+ * @param hv the values of the host.
+ */
+static void exporting_host_values_calculate(struct exporting_stored_data *sd, struct exporting_host_values *hv)
+{
+    struct engine *engine = sd->engine;
+    RRDHOST *host = hv->host;
+    size_t timeframes = sd->timeframes.used;
+
+    hv->dimensions.used = 0;
+    hv->values.used = 0;
+
+    bool exported = false;
+    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
+        if (exporting_instance_needs_stored_data(instance) && rrdhost_is_exportable(instance, host)) {
+            exported = true;
+            break;
+        }
+    }
+
+    if (!exported)
+        return;
+
+    RRDSET *st;
+    rrdset_foreach_read(st, host) {
+        if (engine->exit)
+            break;
+
+        bool needed[EXPORTING_STORED_DATA_MAX_TIMEFRAMES] = { false };
+        bool any = false;
+
+        for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
+            if (!exporting_instance_needs_stored_data(instance) || !rrdhost_is_exportable(instance, host) ||
+                !rrdset_is_exportable(instance, st))
+                continue;
+
+            ssize_t tf = exporting_timeframe_find(sd, instance->after, instance->before);
+            if (tf >= 0)
+                needed[tf] = any = true;
+        }
+
+        if (!any)
+            continue;
+
+        RRDDIM *rd;
+        rrddim_foreach_read(rd, st) {
+            if (hv->dimensions.used == hv->dimensions.size) {
+                hv->dimensions.size = hv->dimensions.size ? hv->dimensions.size * 2 : 1024;
+                hv->dimensions.array =
+                    reallocz(hv->dimensions.array, hv->dimensions.size * sizeof(*hv->dimensions.array));
+            }
+
+            if (hv->values.used + timeframes > hv->values.size) {
+                hv->values.size = hv->values.size ? hv->values.size * 2 : 1024 * timeframes;
+                hv->values.array = reallocz(hv->values.array, hv->values.size * sizeof(*hv->values.array));
+            }
+
+            hv->dimensions.array[hv->dimensions.used++] = (struct exporting_dimension_values) {
+                .rd = rd,
+                .uuid = rd->uuid,
+                .first_value = hv->values.used,
+            };
+
+            for (size_t tf = 0; tf < timeframes; tf++) {
+                struct exporting_stored_value *sv = &hv->values.array[hv->values.used++];
+
+                if (needed[tf])
+                    exporting_query_stored_data(rd, sd->timeframes.array[tf].after, sd->timeframes.array[tf].before, sv);
+                else
+                    *sv = (struct exporting_stored_value) { .calculated = false };
+            }
+        }
+        rrddim_foreach_done(rd);
+    }
+    rrdset_foreach_done(st);
+}
+
+static int exporting_dimension_values_compar(const void *a, const void *b)
+{
+    const struct exporting_dimension_values *d1 = a, *d2 = b;
+
+    if ((uintptr_t)d1->rd < (uintptr_t)d2->rd)
+        return -1;
+
+    if ((uintptr_t)d1->rd > (uintptr_t)d2->rd)
+        return 1;
+
+    return 0;
+}
+
+/**
+ * Claim the next host of the current iteration
+ *
+ * @param sd the stored data of the engine.
+ * @param slot where to store the index of the host claimed.
+ * @return Returns true if a host was claimed.
+ */
+static bool exporting_stored_data_claim_host(struct exporting_stored_data *sd, size_t *slot)
+{
+    bool claimed = false;
+
+    spinlock_lock(&sd->spinlock);
+    if (sd->published && sd->claimed < sd->hosts.used) {
+        *slot = sd->claimed++;
+        claimed = true;
+
+        if (sd->claimed == sd->hosts.used)
+            // all hosts have been claimed, nobody else needs to find it
+            sd->published = false;
+    }
+    spinlock_unlock(&sd->spinlock);
+
+    return claimed;
+}
+
+static void exporting_stored_data_execute_host(struct exporting_stored_data *sd, size_t slot)
+{
+    struct exporting_host_values *hv = &sd->hosts.array[slot];
+
+    exporting_host_values_calculate(sd, hv);
+
+    // so that the formatting can find the values of the dimensions
+    if (hv->dimensions.used > 1)
+        qsort(hv->dimensions.array, hv->dimensions.used, sizeof(*hv->dimensions.array),
+              exporting_dimension_values_compar);
+
+    struct completion *completion = sd->iteration_completion;
+    if (__atomic_add_fetch(&sd->completed, 1, __ATOMIC_ACQ_REL) == sd->hosts.used)
+        completion_mark_complete(completion);
+}
+
+static void exporting_stored_data_worker_thread(void *ptr)
+{
+    struct exporting_stored_data *sd = ptr;
+
+    size_t job_id = 0;
+    while (!nd_thread_signaled_to_cancel() && service_running(SERVICE_EXPORTERS)) {
+        size_t slot;
+        if (exporting_stored_data_claim_host(sd, &slot)) {
+            exporting_stored_data_execute_host(sd, slot);
+            continue;
+        }
+
+        job_id = completion_wait_for_a_job_with_timeout(&sd->completion, job_id, 1000);
+    }
+}
+
+/**
+ * Initialize the calculation of stored data
+ *
+ * Starts the threads that calculate the values of hosts in parallel with the main exporting thread.
+ *
+ * @param engine an engine data structure.
+ */
+void exporting_stored_data_init(struct engine *engine)
+{
+    struct exporting_stored_data *sd = callocz(1, sizeof(*sd));
+    spinlock_init(&sd->spinlock);
+    completion_init(&sd->completion);
+    sd->engine = engine;
+    engine->stored_data = sd;
+
+    size_t threads = engine->config.query_threads;
+    if (threads <= 1)
+        return;
+
+    // the main exporting thread calculates hosts too
+    sd->workers = threads - 1;
+    sd->threads = callocz(sd->workers, sizeof(*sd->threads));
+
+    for (size_t t = 0; t < sd->workers; t++) {
+        char threadname[ND_THREAD_TAG_MAX + 1];
+        snprintfz(threadname, ND_THREAD_TAG_MAX, "EXPQRY[%zu]", t + 1);
+        sd->threads[t] = nd_thread_create(threadname, NETDATA_THREAD_OPTION_DEFAULT, exporting_stored_data_worker_thread, sd);
+    }
+
+    netdata_log_info("EXPORTING: calculating the values of hosts with %zu threads", threads);
+}
+
+/**
+ * Clean up the calculation of stored data
+ *
+ * Stops the threads and frees all memory.
+ *
+ * @param engine an engine data structure.
+ */
+void exporting_stored_data_cleanup(struct engine *engine)
+{
+    struct exporting_stored_data *sd = engine->stored_data;
+    if (!sd)
+        return;
+
+    for (size_t t = 0; t < sd->workers; t++) {
+        if (!sd->threads[t])
+            continue;
+
+        nd_thread_signal_cancel(sd->threads[t]);
+        nd_thread_join(sd->threads[t]);
+    }
+    freez(sd->threads);
+
+    for (size_t i = 0; i < sd->hosts.size; i++) {
+        freez(sd->hosts.array[i].dimensions.array);
+        freez(sd->hosts.array[i].values.array);
+    }
+    freez(sd->hosts.array);
+
+    completion_destroy(&sd->completion);
+    freez(sd);
+    engine->stored_data = NULL;
+}
+
+/**
+ * Calculate the values of all dimensions from the database
+ *
+ * Called before formatting, with the rrd lock held, once all instances have been scheduled.
+ *
+ * @param engine an engine data structure.
+ */
+void exporting_stored_data_calculate(struct engine *engine)
+{
+    struct exporting_stored_data *sd = engine->stored_data;
+    if (!sd)
+        return;
+
+    sd->timeframes.used = 0;
+    sd->hosts.used = 0;
+
+    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
+        if (!exporting_instance_needs_stored_data(instance) ||
+            exporting_timeframe_find(sd, instance->after, instance->before) >= 0)
+            continue;
+
+        if (sd->timeframes.used == EXPORTING_STORED_DATA_MAX_TIMEFRAMES)
+            // the rest of the time-frames are calculated while formatting
+            break;
+
+        sd->timeframes.array[sd->timeframes.used++] = (struct exporting_timeframe) {
+            .after = instance->after,
+            .before = instance->before,
+        };
+    }
+
+    if (!sd->timeframes.used)
+        return;
+
+    RRDHOST *host;
+    rrdhost_foreach_read(host) {
+        if (sd->hosts.used == sd->hosts.size) {
+            size_t old_size = sd->hosts.size;
+            sd->hosts.size = sd->hosts.size ? sd->hosts.size * 2 : 16;
+            sd->hosts.array = reallocz(sd->hosts.array, sd->hosts.size * sizeof(*sd->hosts.array));
+            memset(&sd->hosts.array[old_size], 0, (sd->hosts.size - old_size) * sizeof(*sd->hosts.array));
+        }
+
+        sd->hosts.array[sd->hosts.used++].host = host;
+    }
+
+    if (!sd->hosts.used)
+        return;
+
+    struct completion completion;
+    completion_init(&completion);
+
+    sd->claimed = 0;
+    sd->completed = 0;
+    sd->iteration_completion = &completion;
+
+    spinlock_lock(&sd->spinlock);
+    sd->published = true;
+    spinlock_unlock(&sd->spinlock);
+
+    if (sd->workers && sd->hosts.used > 1)
+        completion_mark_complete_a_job(&sd->completion);
+
+    // the main thread calculates hosts too, so that the iteration
+    // progresses even when the workers are busy or have exited
+    size_t slot;
+    while (exporting_stored_data_claim_host(sd, &slot))
+        exporting_stored_data_execute_host(sd, slot);
+
+    completion_wait_for(&completion);
+    completion_destroy(&completion);
+}
+
+/**
+ * Select the host being formatted
+ *
+ * @param engine an engine data structure.
+ * @param host the host being formatted, or NULL when formatting is done.
+ */
+void exporting_stored_data_select_host(struct engine *engine, RRDHOST *host)
+{
+    exporting_current_host_values = NULL;
+
+    struct exporting_stored_data *sd = engine->stored_data;
+    if (!sd || !host || !sd->timeframes.used)
+        return;
+
+    for (size_t i = 0; i < sd->hosts.used; i++) {
+        if (sd->hosts.array[i].host == host) {
+            exporting_current_host_values = &sd->hosts.array[i];
+            break;
+        }
+    }
+}
+
+/**
+ * Get the shared value of a dimension
+ *
+ * @param instance an instance data structure.
+ * @param rd a dimension(metric) in the Netdata database.
+ * @return Returns the value calculated for the time-frame of the instance, or NULL if it is not available.
+ */
+struct exporting_stored_value *exporting_stored_data_get(struct instance *instance, RRDDIM *rd)
+{
+    struct exporting_host_values *hv = exporting_current_host_values;
+    if (!hv || !instance->engine || hv->host != rd->rrdset->rrdhost)
+        return NULL;
+
+    struct exporting_stored_data *sd = instance->engine->stored_data;
+    ssize_t tf = exporting_timeframe_find(sd, instance->after, instance->before);
+    if (tf < 0)
+        return NULL;
+
+    struct exporting_dimension_values key = { .rd = rd };
+    struct exporting_dimension_values *dv = bsearch(
+        &key, hv->dimensions.array, hv->dimensions.used, sizeof(*hv->dimensions.array),
+        exporting_dimension_values_compar);
+
+    if (!dv || dv->uuid != rd->uuid)
+        return NULL;
+
+    struct exporting_stored_value *sv = &hv->values.array[dv->first_value + tf];
+    return sv->calculated ? sv : NULL;
+}
+
+// ----------------------------------------------------------------------------
+// unittest - the shared values are the ones each instance would query
+
+#define EXPORTING_STORED_DATA_UNITTEST_POINTS 120
+#define EXPORTING_STORED_DATA_UNITTEST_DIMS 3
+#define EXPORTING_STORED_DATA_UNITTEST_INSTANCES (EXPORTING_STORED_DATA_MAX_TIMEFRAMES + 4)
+
+static void exporting_stored_data_unittest_collect(RRDSET *st, RRDDIM **rds, time_t start_s)
+{
+    // set the last collection time just before the first point, so that
+    // the values are stored as-is, without interpolation
+    for (size_t d = 0; d < EXPORTING_STORED_DATA_UNITTEST_DIMS; d++) {
+        rds[d]->collector.last_collected_time.tv_sec =
+            st->last_collected_time.tv_sec = st->last_updated.tv_sec = start_s - 1;
+        rds[d]->collector.last_collected_time.tv_usec =
+            st->last_collected_time.tv_usec = st->last_updated.tv_usec = 0;
+    }
+
+    for (time_t p = 0; p < EXPORTING_STORED_DATA_UNITTEST_POINTS; p++) {
+        time_t now_s = start_s + p;
+        st->usec_since_last_update = USEC_PER_SEC;
+
+        for (size_t d = 0; d < EXPORTING_STORED_DATA_UNITTEST_DIMS; d++) {
+            RRDDIM *rd = rds[d];
+            rd->collector.last_collected_time.tv_sec = now_s;
+            rd->collector.last_collected_time.tv_usec = 0;
+            rd->collector.collected_value = (collected_number)((p * (time_t)(d + 3)) % 50) + (collected_number)d * 100;
+            rrddim_set_updated(rd);
+            rd->collector.counter++;
+        }
+
+        rrdset_timed_done(st, (struct timeval){ .tv_sec = now_s, .tv_usec = 0 }, false);
+    }
+}
+
+static NETDATA_DOUBLE exporting_stored_data_unittest_expected(struct instance *instance, RRDDIM *rd, time_t *last_timestamp)
+{
+    struct exporting_stored_value sv;
+    exporting_query_stored_data(rd, instance->after, instance->before, &sv);
+
+    if (!sv.last_timestamp)
+        return NAN;
+
+    *last_timestamp = sv.last_timestamp;
+
+    if (!sv.count)
+        return NAN;
+
+    if (EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) == EXPORTING_SOURCE_DATA_SUM)
+        return sv.sum;
+
+    return sv.sum / (NETDATA_DOUBLE)sv.count;
+}
+
+static size_t exporting_stored_data_unittest_compare(struct instance *instance, RRDDIM *rd, const char *test)
+{
+    time_t ts = 0, expected_ts = 0;
+    NETDATA_DOUBLE v = exporting_calculate_value_from_stored_data(instance, rd, &ts);
+    NETDATA_DOUBLE expected = exporting_stored_data_unittest_expected(instance, rd, &expected_ts);
+
+    if ((isnan(v) != isnan(expected)) || (!isnan(v) && v != expected) || ts != expected_ts) {
+        fprintf(stderr, " >>> EXPORTING STORED DATA: %s: instance %zu, dimension '%s': got " NETDATA_DOUBLE_FORMAT
+                        " at %ld, expected " NETDATA_DOUBLE_FORMAT " at %ld\n",
+                test, instance->index, rrddim_id(rd), v, (long)ts, expected, (long)expected_ts);
+        return 1;
+    }
+
+    return 0;
+}
+
+int exporting_stored_data_unittest(void)
+{
+    size_t errors = 0;
+
+    nd_uuid_t uuid;
+    char guid[UUID_STR_LEN];
+    uuid_generate(uuid);
+    uuid_unparse_lower(uuid, guid);
+
+    const char *hostname = "unittest-exporting-stored-data";
+    RRDHOST *host = rrdhost_find_or_create(
+        hostname, hostname, guid, os_type,
+        netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+        program_name, NETDATA_VERSION,
+        1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+        false, false, NULL, NULL, NULL,
+        false, 0, 0, NULL, false);
+
+    if (!host) {
+        fprintf(stderr, "EXPORTING STORED DATA: FAILED (cannot create host)\n");
+        return 1;
+    }
+
+    RRDSET *st = rrdset_create(host, "unittest", "exporting", NULL, "unittest", "unittest.exporting",
+                               "unittest", "units", "unittest", "exporting", 1, 1, RRDSET_TYPE_LINE);
+
+    RRDDIM *rds[EXPORTING_STORED_DATA_UNITTEST_DIMS];
+    for (size_t d = 0; d < EXPORTING_STORED_DATA_UNITTEST_DIMS; d++) {
+        char id[20];
+        snprintfz(id, sizeof(id), "dim%zu", d);
+        rds[d] = rrddim_add(st, id, NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+
+    time_t now_s = now_realtime_sec();
+    exporting_stored_data_unittest_collect(st, rds, now_s - EXPORTING_STORED_DATA_UNITTEST_POINTS + 1);
+
+    // the instances:
+    // - the first ones have distinct time-frames, more than the time-frames that can be shared
+    // - one shares the time-frame of the first, with a different data source
+    // - the last one is outside the database range
+    struct engine engine = {
+        .config = { .query_threads = 4 },
+        .instance_num = EXPORTING_STORED_DATA_UNITTEST_INSTANCES,
+    };
+
+    struct instance instances[EXPORTING_STORED_DATA_UNITTEST_INSTANCES];
+    memset(instances, 0, sizeof(instances));
+
+    size_t distinct = EXPORTING_STORED_DATA_UNITTEST_INSTANCES - 2;
+    for (size_t i = 0; i < EXPORTING_STORED_DATA_UNITTEST_INSTANCES; i++) {
+        struct instance *instance = &instances[i];
+        instance->index = i;
+        instance->engine = &engine;
+        instance->next = (i + 1 < EXPORTING_STORED_DATA_UNITTEST_INSTANCES) ? &instances[i + 1] : NULL;
+        instance->scheduled = 1;
+        instance->config.name = "unittest";
+        instance->config.options = (i % 2) ? EXPORTING_SOURCE_DATA_SUM : EXPORTING_SOURCE_DATA_AVERAGE;
+        instance->config.hosts_pattern = simple_pattern_create(hostname, NULL, SIMPLE_PATTERN_EXACT, true);
+        instance->config.charts_pattern = simple_pattern_create("*", NULL, SIMPLE_PATTERN_EXACT, true);
+
+        if (i < distinct) {
+            instance->before = now_s - (time_t)(5 * i);
+            instance->after = instance->before - 60;
+        }
+        else if (i == distinct) {
+            instance->config.options = (instances[0].config.options == EXPORTING_SOURCE_DATA_SUM) ?
+                                       EXPORTING_SOURCE_DATA_AVERAGE : EXPORTING_SOURCE_DATA_SUM;
+            instance->before = instances[0].before;
+            instance->after = instances[0].after;
+        }
+        else {
+            instance->before = now_s - 100000;
+            instance->after = instance->before - 60;
+        }
+    }
+    engine.instance_root = &instances[0];
+
+    exporting_stored_data_init(&engine);
+
+    rrd_rdlock();
+    exporting_stored_data_calculate(&engine);
+    exporting_stored_data_select_host(&engine, host);
+
+    for (size_t i = 0; i < EXPORTING_STORED_DATA_UNITTEST_INSTANCES; i++) {
+        struct instance *instance = &instances[i];
+
+        // the first time-frames are shared, the rest fall back to querying the database
+        bool shared = (i < EXPORTING_STORED_DATA_MAX_TIMEFRAMES || i == distinct);
+
+        for (size_t d = 0; d < EXPORTING_STORED_DATA_UNITTEST_DIMS; d++) {
+            struct exporting_stored_value *sv = exporting_stored_data_get(instance, rds[d]);
+            if (!sv != !shared) {
+                fprintf(stderr, " >>> EXPORTING STORED DATA: instance %zu, dimension '%s': the value is %sshared\n",
+                        i, rrddim_id(rds[d]), sv ? "" : "not ");
+                errors++;
+            }
+
+            errors += exporting_stored_data_unittest_compare(instance, rds[d], shared ? "shared" : "fallback");
+        }
+    }
+
+    // a dimension freed and reallocated at the same address has another UUID
+    RRDDIM *rd = rds[1];
+    UUIDMAP_ID rd_uuid = rd->uuid;
+    rd->uuid = rd_uuid + 1;
+    if (exporting_stored_data_get(&instances[0], rd)) {
+        fprintf(stderr, " >>> EXPORTING STORED DATA: the value of a dimension with another UUID is shared\n");
+        errors++;
+    }
+    errors += exporting_stored_data_unittest_compare(&instances[0], rd, "uuid");
+    rd->uuid = rd_uuid;
+
+    exporting_stored_data_select_host(&engine, NULL);
+    rrd_rdunlock();
+
+    exporting_stored_data_cleanup(&engine);
+
+    for (size_t i = 0; i < EXPORTING_STORED_DATA_UNITTEST_INSTANCES; i++) {
+        simple_pattern_free(instances[i].config.hosts_pattern);
+        simple_pattern_free(instances[i].config.charts_pattern);
+    }
+
+    fprintf(stderr, "EXPORTING STORED DATA: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
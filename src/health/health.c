@@ -21,6 +21,8 @@ struct health_plugin_globals health_globals = {
 
         .run_at_least_every_seconds = 10,
         .postpone_alarms_during_hibernation_for_seconds = 60,
+
+        .lookup_windows = false,
     },
     .prototypes = {
         .dict = NULL,
@@ -88,6 +90,18 @@ void health_load_config_defaults(void) {
                                     "postpone alarms during hibernation for",
                                     health_globals.config.postpone_alarms_during_hibernation_for_seconds);
 
+    size_t evaluation_threads = netdata_conf_cpus() / 4;
+    if(evaluation_threads < 1) evaluation_threads = 1;
+    if(evaluation_threads > HEALTH_EVALUATION_THREADS_DEFAULT_MAX) evaluation_threads = HEALTH_EVALUATION_THREADS_DEFAULT_MAX;
+    health_globals.config.evaluation_threads =
+        inicfg_get_number_range(&netdata_config, CONFIG_SECTION_HEALTH, "evaluation threads",
+                                (long long)evaluation_threads, 1, HEALTH_EVALUATION_THREADS_MAX);
+
+    health_globals.config.lookup_windows =
+        inicfg_get_boolean(&netdata_config, CONFIG_SECTION_HEALTH,
+                           "in memory lookup windows",
+                           health_globals.config.lookup_windows);
+
     health_globals.config.default_recipient =
         string_strdupz("root");
 
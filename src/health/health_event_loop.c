@@ -237,6 +237,162 @@ static void do_eval_expression(
         *result = expression_result(expression);
 }
 
+// ----------------------------------------------------------------------------
+// db lookups from the in-memory windows of the dimensions
+
+// the options that do not change the result of a lookup from windows
+#define HEALTH_LOOKUP_WINDOWS_OPTIONS (RRDR_OPTION_NOT_ALIGNED | RRDR_OPTION_ABSOLUTE | RRDR_OPTION_NULL2ZERO |  \
+                                       RRDR_OPTION_DIMS_MIN2MAX | RRDR_OPTION_DIMS_AVERAGE |                    \
+                                       RRDR_OPTION_DIMS_MIN | RRDR_OPTION_DIMS_MAX |                            \
+                                       RRDR_OPTION_MATCH_IDS | RRDR_OPTION_MATCH_NAMES | RRDR_OPTION_SELECTED_TIER)
+
+// returns true when the lookup has been answered from the windows of the dimensions,
+// with the same result a tier 0 unaligned query of 1 point would give
+static bool health_lookup_from_windows(RRDCALC *rc, time_t now, int *value_is_null) {
+    if(!health_globals.config.lookup_windows)
+        return false;
+
+    switch(rc->config.time_group) {
+        case RRDR_GROUPING_AVERAGE:
+        case RRDR_GROUPING_SUM:
+        case RRDR_GROUPING_MIN:
+        case RRDR_GROUPING_MAX:
+            break;
+
+        default:
+            return false;
+    }
+
+    RRDR_OPTIONS options = rc->config.options;
+    if(rc->config.data_source != ALERT_LOOKUP_DATA_SOURCE_SAMPLES ||
+        rc->config.before != 0 || rc->config.after >= 0 ||
+        !(options & RRDR_OPTION_NOT_ALIGNED) || (options & ~HEALTH_LOOKUP_WINDOWS_OPTIONS))
+        return false;
+
+    RRDSET *st = rc->rrdset;
+    if(!st || st->rrd_memory_mode == RRD_DB_MODE_NONE)
+        return false;
+
+    uint32_t duration_s = (uint32_t)(-rc->config.after);
+    bool absolute = (options & RRDR_OPTION_ABSOLUTE);
+
+    bool match_ids = (options & RRDR_OPTION_MATCH_IDS);
+    bool match_names = (options & RRDR_OPTION_MATCH_NAMES);
+    if(!match_ids && !match_names)
+        match_ids = match_names = true;
+
+    NETDATA_DOUBLE sum = 0, min = NAN, max = NAN;
+    size_t dims = 0;
+    time_t after = 0, before = 0;
+    bool available = true;
+
+    // all the dimensions are visited, so that all of them get windows
+    RRDDIM *rd;
+    rrddim_foreach_read(rd, st) {
+        if(rc->dimensions_pattern) {
+            SIMPLE_PATTERN_RESULT ret = SP_NOT_MATCHED;
+
+            if(match_ids)
+                ret = simple_pattern_matches_string_extract(rc->dimensions_pattern, rd->id, NULL, 0);
+
+            if(ret == SP_NOT_MATCHED && match_names && (rd->name != rd->id || !match_ids))
+                ret = simple_pattern_matches_string_extract(rc->dimensions_pattern, rd->name, NULL, 0);
+
+            if(ret != SP_MATCHED_POSITIVE)
+                continue;
+        }
+        else if(rrddim_option_check(rd, RRDDIM_OPTION_HIDDEN))
+            continue;
+
+        if(rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE)) {
+            available = false;
+            continue;
+        }
+
+        RRDDIM_WINDOW_VALUE wv;
+        if(!rrddim_window_get(rd, duration_s, absolute, now, &wv)) {
+            available = false;
+            continue;
+        }
+
+        if(!before) {
+            after = wv.after;
+            before = wv.before;
+        }
+        else if(wv.before != before) {
+            // the dimensions are not collected together
+            available = false;
+            continue;
+        }
+
+        if(!wv.count)
+            // all the points of this dimension are gaps
+            continue;
+
+        NETDATA_DOUBLE n;
+        switch(rc->config.time_group) {
+            default:
+            case RRDR_GROUPING_AVERAGE:
+                n = wv.sum / (NETDATA_DOUBLE)wv.count;
+                break;
+
+            case RRDR_GROUPING_SUM:
+                n = wv.sum;
+                break;
+
+            case RRDR_GROUPING_MIN:
+                n = wv.min;
+                break;
+
+            case RRDR_GROUPING_MAX:
+                n = wv.max;
+                break;
+        }
+
+        if(!dims)
+            min = max = n;
+
+        sum += n;
+        if(n < min) min = n;
+        if(n > max) max = n;
+        dims++;
+    }
+    rrddim_foreach_done(rd);
+
+    if(!available || !before)
+        return false;
+
+    // aggregate the dimensions, like rrdr2value() does
+
+    NETDATA_DOUBLE v;
+    if(!dims) {
+        *value_is_null = 1;
+        v = (options & RRDR_OPTION_NULL2ZERO) ? 0 : NAN;
+    }
+    else {
+        *value_is_null = 0;
+
+        if(options & RRDR_OPTION_DIMS_MIN2MAX)
+            v = max - min;
+        else if(options & RRDR_OPTION_DIMS_AVERAGE)
+            v = sum / (NETDATA_DOUBLE)dims;
+        else if(options & RRDR_OPTION_DIMS_MIN)
+            v = min;
+        else if(options & RRDR_OPTION_DIMS_MAX)
+            v = max;
+        else
+            v = sum;
+
+        if((options & RRDR_OPTION_NULL2ZERO) && (isnan(v) || isinf(v)))
+            v = 0;
+    }
+
+    rc->value = v;
+    rc->db_after = after;
+    rc->db_before = before;
+    return true;
+}
+
 // returns the number of runnable alerts
 static void health_event_loop_for_host(RRDHOST *host, bool apply_hibernation_delay, time_t now, time_t *next_run) {
     size_t runnable = 0;
@@ -377,7 +533,9 @@ static void health_event_loop_for_host(RRDHOST *host, bool apply_hibernation_del
                     break;
             }
 
-            int ret = rrdset2value_api_v1(rc->rrdset, NULL, &rc->value, rrdcalc_dimensions(rc), 1,
+            int ret = 200;
+            if(!health_lookup_from_windows(rc, now, &value_is_null))
+                ret = rrdset2value_api_v1(rc->rrdset, NULL, &rc->value, rrdcalc_dimensions(rc), 1,
                                           rc->config.after, rc->config.before, rc->config.time_group, group_options,
                                           0, rc->config.options | RRDR_OPTION_SELECTED_TIER,
                                           &rc->db_after,&rc->db_before,
@@ -647,10 +805,267 @@ static void health_event_loop_for_host(RRDHOST *host, bool apply_hibernation_del
     worker_is_idle();
 }
 
+static void health_worker_register(void) {
+    worker_register("HEALTH");
+    worker_register_job_name(WORKER_HEALTH_JOB_RRD_LOCK, "rrd lock");
+    worker_register_job_name(WORKER_HEALTH_JOB_HOST_LOCK, "host lock");
+    worker_register_job_name(WORKER_HEALTH_JOB_DB_QUERY, "db lookup");
+    worker_register_job_name(WORKER_HEALTH_JOB_CALC_EVAL, "calc eval");
+    worker_register_job_name(WORKER_HEALTH_JOB_WARNING_EVAL, "warning eval");
+    worker_register_job_name(WORKER_HEALTH_JOB_CRITICAL_EVAL, "critical eval");
+    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_ENTRY, "alert log entry");
+    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_PROCESS, "alert log process");
+    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_QUEUE, "alert log queue");
+    worker_register_job_name(WORKER_HEALTH_JOB_WAIT_EXEC, "alert wait exec");
+    worker_register_job_name(WORKER_HEALTH_JOB_DELAYED_INIT_RRDSET, "rrdset init");
+    worker_register_job_name(WORKER_HEALTH_JOB_DELAYED_INIT_RRDDIM, "rrddim init");
+}
+
 __thread bool is_health_thread = false;
+
+// ----------------------------------------------------------------------------
+// parallel evaluation of hosts
+//
+// On every iteration, the health main thread acquires all hosts and publishes
+// them to the health workers. The workers (and the main thread itself) claim
+// the next unclaimed host, until all are claimed. So, busy threads get less
+// hosts and idle threads get more. Each host is evaluated by one thread per
+// iteration and the main thread waits for all hosts to be evaluated before
+// starting the next iteration, so the alerts of each host are always
+// evaluated in order.
+
+typedef void (*health_host_evaluate_t)(RRDHOST *host, bool apply_hibernation_delay, time_t now, time_t *next_run);
+
+struct health_parallel_iteration {
+    health_host_evaluate_t evaluate;
+    bool apply_hibernation_delay;
+    time_t now;
+
+    RRDHOST_ACQUIRED **hosts;
+    size_t used;
+    size_t claimed;                 // protected by the spinlock
+    size_t completed;               // atomic
+
+    time_t next_run;                // protected by the spinlock
+
+    struct completion completion;
+};
+
+static struct {
+    struct completion completion;   // wakes up the workers when an iteration is published
+
+    SPINLOCK spinlock;
+    struct health_parallel_iteration *current;
+
+    bool started;
+    size_t workers;
+    ND_THREAD **threads;
+
+    struct {
+        RRDHOST_ACQUIRED **array;
+        size_t size;
+    } hosts;
+} health_parallel = {
+    .spinlock = SPINLOCK_INITIALIZER,
+    .current = NULL,
+};
+
+// claim the next host of the current iteration
+// returns the iteration, or NULL when there is nothing left to claim
+static struct health_parallel_iteration *health_parallel_claim_host(size_t *slot) {
+    struct health_parallel_iteration *hpi;
+
+    spinlock_lock(&health_parallel.spinlock);
+
+    hpi = health_parallel.current;
+    if(hpi && hpi->claimed < hpi->used) {
+        *slot = hpi->claimed++;
+
+        if(hpi->claimed == hpi->used)
+            // all hosts have been claimed, nobody else needs to find it
+            health_parallel.current = NULL;
+    }
+    else
+        hpi = NULL;
+
+    spinlock_unlock(&health_parallel.spinlock);
+
+    return hpi;
+}
+
+static void health_parallel_execute_host(struct health_parallel_iteration *hpi, size_t slot) {
+    RRDHOST *host = rrdhost_acquired_to_rrdhost(hpi->hosts[slot]);
+
+    spinlock_lock(&health_parallel.spinlock);
+    time_t next_run = hpi->next_run;
+    spinlock_unlock(&health_parallel.spinlock);
+
+    if(likely(service_running(SERVICE_HEALTH)))
+        hpi->evaluate(host, hpi->apply_hibernation_delay, hpi->now, &next_run);
+
+    spinlock_lock(&health_parallel.spinlock);
+    if(next_run < hpi->next_run)
+        hpi->next_run = next_run;
+    spinlock_unlock(&health_parallel.spinlock);
+
+    // the iteration lives in the stack of the main thread,
+    // so we should not touch it after marking it complete
+    if(__atomic_add_fetch(&hpi->completed, 1, __ATOMIC_ACQ_REL) == hpi->used)
+        completion_mark_complete(&hpi->completion);
+}
+
+static void health_parallel_worker_thread(void *ptr __maybe_unused) {
+    is_health_thread = true;
+
+    // all health threads are registered as HEALTH,
+    // so that the utilization of each is reported together
+    health_worker_register();
+
+    size_t job_id = 0;
+    while(!nd_thread_signaled_to_cancel() && service_running(SERVICE_HEALTH)) {
+        size_t slot;
+        struct health_parallel_iteration *hpi = health_parallel_claim_host(&slot);
+        if(hpi) {
+            health_parallel_execute_host(hpi, slot);
+            continue;
+        }
+
+        worker_is_idle();
+        job_id = completion_wait_for_a_job_with_timeout(&health_parallel.completion, job_id, 1000);
+    }
+
+    worker_unregister();
+    finalize_self_prepared_sql_statements();
+}
+
+static void health_parallel_start_threads(size_t threads) {
+    completion_init(&health_parallel.completion);
+    health_parallel.started = true;
+
+    if(threads <= 1)
+        return;
+
+    // the main thread evaluates hosts too
+    health_parallel.workers = threads - 1;
+    health_parallel.threads = callocz(health_parallel.workers, sizeof(*health_parallel.threads));
+
+    for(size_t t = 0; t < health_parallel.workers ;t++) {
+        char tag[15];
+        snprintfz(tag, sizeof(tag), "HEALTH[%zu]", t + 1);
+        health_parallel.threads[t] = nd_thread_create(tag, NETDATA_THREAD_OPTION_DEFAULT, health_parallel_worker_thread, NULL);
+    }
+
+    nd_log(NDLS_DAEMON, NDLP_DEBUG, "Health: evaluating hosts with %zu threads", threads);
+}
+
+static void health_parallel_start(void) {
+    health_plugin_init();
+    health_parallel_start_threads(health_globals.config.evaluation_threads);
+}
+
+static void health_parallel_stop(void) {
+    for(size_t t = 0; t < health_parallel.workers ;t++) {
+        nd_thread_signal_cancel(health_parallel.threads[t]);
+        nd_thread_join(health_parallel.threads[t]);
+    }
+
+    freez(health_parallel.threads);
+    health_parallel.threads = NULL;
+    health_parallel.workers = 0;
+
+    if(health_parallel.started) {
+        completion_destroy(&health_parallel.completion);
+        health_parallel.started = false;
+    }
+
+    freez(health_parallel.hosts.array);
+    health_parallel.hosts.array = NULL;
+    health_parallel.hosts.size = 0;
+}
+
+static void health_parallel_for_all_hosts(health_host_evaluate_t evaluate, bool apply_hibernation_delay, time_t now, time_t *next_run) {
+    if(!health_parallel.workers) {
+        RRDHOST *host;
+        dfe_start_reentrant(rrdhost_root_index, host) {
+            if(unlikely(!service_running(SERVICE_HEALTH)))
+                break;
+
+            evaluate(host, apply_hibernation_delay, now, next_run);
+        }
+        dfe_done(host);
+        return;
+    }
+
+    // acquire all hosts, so that they can be evaluated
+    // without holding the dictionary locked
+
+    size_t used = 0;
+    RRDHOST *host;
+    dfe_start_read(rrdhost_root_index, host) {
+        if(used == health_parallel.hosts.size) {
+            health_parallel.hosts.size = health_parallel.hosts.size ? health_parallel.hosts.size * 2 : 16;
+            health_parallel.hosts.array = reallocz(health_parallel.hosts.array,
+                                                   health_parallel.hosts.size * sizeof(*health_parallel.hosts.array));
+        }
+
+        health_parallel.hosts.array[used++] =
+            (RRDHOST_ACQUIRED *)dictionary_acquired_item_dup(rrdhost_root_index, host_dfe.item);
+    }
+    dfe_done(host);
+
+    if(!used)
+        return;
+
+    struct health_parallel_iteration hpi = {
+        .evaluate = evaluate,
+        .apply_hibernation_delay = apply_hibernation_delay,
+        .now = now,
+        .hosts = health_parallel.hosts.array,
+        .used = used,
+        .claimed = 0,
+        .completed = 0,
+        .next_run = *next_run,
+    };
+    completion_init(&hpi.completion);
+
+    size_t slot;
+    if(used > 1) {
+        spinlock_lock(&health_parallel.spinlock);
+        health_parallel.current = &hpi;
+        spinlock_unlock(&health_parallel.spinlock);
+
+        completion_mark_complete_a_job(&health_parallel.completion);
+
+        // the main thread evaluates hosts too, so that the iteration
+        // progresses even when the workers are busy or have exited
+        while(health_parallel_claim_host(&slot))
+            health_parallel_execute_host(&hpi, slot);
+    }
+    else {
+        hpi.claimed = 1;
+        health_parallel_execute_host(&hpi, 0);
+    }
+
+    completion_wait_for(&hpi.completion);
+    completion_destroy(&hpi.completion);
+
+    *next_run = hpi.next_run;
+
+    for(size_t i = 0; i < used ;i++) {
+        rrdhost_acquired_release(health_parallel.hosts.array[i]);
+        health_parallel.hosts.array[i] = NULL;
+    }
+}
+
+static void health_event_loop_for_all_hosts(bool apply_hibernation_delay, time_t now, time_t *next_run) {
+    health_parallel_for_all_hosts(health_event_loop_for_host, apply_hibernation_delay, now, next_run);
+}
+
 static void health_event_loop(void) {
 
     is_health_thread = true;
+    health_parallel_start();
+
     while(service_running(SERVICE_HEALTH)) {
         if(!stream_control_health_should_be_running()) {
             worker_is_idle();
@@ -684,14 +1099,7 @@ static void health_event_loop(void) {
         worker_is_busy(WORKER_HEALTH_JOB_RRD_LOCK);
         uint64_t loop = __atomic_add_fetch(&health_evloop_iteration, 1, __ATOMIC_RELAXED);
 
-        RRDHOST *host;
-        dfe_start_reentrant(rrdhost_root_index, host) {
-            if(unlikely(!service_running(SERVICE_HEALTH)))
-                break;
-
-            health_event_loop_for_host(host, apply_hibernation_delay, now, &next_run);
-        }
-        dfe_done(host);
+        health_event_loop_for_all_hosts(apply_hibernation_delay, now, &next_run);
 
         if(unlikely(!service_running(SERVICE_HEALTH)))
             break;
@@ -712,27 +1120,329 @@ static void health_main_cleanup(void *pptr) {
 
     worker_unregister();
     static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
+    health_parallel_stop();
     finalize_self_prepared_sql_statements();
     static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
     nd_log(NDLS_DAEMON, NDLP_DEBUG, "Health thread ended.");
 }
 
 void *health_main(void *ptr) {
-    worker_register("HEALTH");
-    worker_register_job_name(WORKER_HEALTH_JOB_RRD_LOCK, "rrd lock");
-    worker_register_job_name(WORKER_HEALTH_JOB_HOST_LOCK, "host lock");
-    worker_register_job_name(WORKER_HEALTH_JOB_DB_QUERY, "db lookup");
-    worker_register_job_name(WORKER_HEALTH_JOB_CALC_EVAL, "calc eval");
-    worker_register_job_name(WORKER_HEALTH_JOB_WARNING_EVAL, "warning eval");
-    worker_register_job_name(WORKER_HEALTH_JOB_CRITICAL_EVAL, "critical eval");
-    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_ENTRY, "alert log entry");
-    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_PROCESS, "alert log process");
-    worker_register_job_name(WORKER_HEALTH_JOB_ALARM_LOG_QUEUE, "alert log queue");
-    worker_register_job_name(WORKER_HEALTH_JOB_WAIT_EXEC, "alert wait exec");
-    worker_register_job_name(WORKER_HEALTH_JOB_DELAYED_INIT_RRDSET, "rrdset init");
-    worker_register_job_name(WORKER_HEALTH_JOB_DELAYED_INIT_RRDDIM, "rrddim init");
+    health_worker_register();
 
     CLEANUP_FUNCTION_REGISTER(health_main_cleanup) cleanup_ptr = ptr;
     health_event_loop();
     return NULL;
 }
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#define HEALTH_PARALLEL_UNITTEST_HOSTS 16
+#define HEALTH_PARALLEL_UNITTEST_ITERATIONS 20
+#define HEALTH_PARALLEL_UNITTEST_THREADS 4
+
+static struct {
+    RRDHOST *hosts[HEALTH_PARALLEL_UNITTEST_HOSTS];
+    size_t evaluations[HEALTH_PARALLEL_UNITTEST_HOSTS];     // atomic
+    bool running[HEALTH_PARALLEL_UNITTEST_HOSTS];           // atomic
+    size_t iteration;                                       // set by the main thread, between iterations
+    size_t errors;                                          // atomic
+
+    SPINLOCK spinlock;
+    pid_t tids[HEALTH_PARALLEL_UNITTEST_THREADS + 1];       // the threads that evaluated hosts, protected by the spinlock
+    size_t tids_used;
+} health_parallel_unittest = {
+    .spinlock = SPINLOCK_INITIALIZER,
+};
+
+static void health_parallel_unittest_evaluate(RRDHOST *host, bool apply_hibernation_delay __maybe_unused, time_t now, time_t *next_run) {
+    size_t h;
+    for(h = 0; h < HEALTH_PARALLEL_UNITTEST_HOSTS && health_parallel_unittest.hosts[h] != host; h++) ;
+    if(h == HEALTH_PARALLEL_UNITTEST_HOSTS)
+        // not one of our hosts
+        return;
+
+    if(__atomic_exchange_n(&health_parallel_unittest.running[h], true, __ATOMIC_ACQ_REL)) {
+        fprintf(stderr, " >>> HEALTH PARALLEL: host %zu is evaluated by two threads at the same time\n", h);
+        __atomic_add_fetch(&health_parallel_unittest.errors, 1, __ATOMIC_RELAXED);
+    }
+
+    size_t evaluations = __atomic_load_n(&health_parallel_unittest.evaluations[h], __ATOMIC_ACQUIRE);
+    if(evaluations != health_parallel_unittest.iteration) {
+        fprintf(stderr, " >>> HEALTH PARALLEL: host %zu is evaluated for the %zu time in iteration %zu\n",
+                h, evaluations + 1, health_parallel_unittest.iteration);
+        __atomic_add_fetch(&health_parallel_unittest.errors, 1, __ATOMIC_RELAXED);
+    }
+
+    pid_t tid = gettid_cached();
+    spinlock_lock(&health_parallel_unittest.spinlock);
+    size_t t;
+    for(t = 0; t < health_parallel_unittest.tids_used && health_parallel_unittest.tids[t] != tid; t++) ;
+    if(t == health_parallel_unittest.tids_used && t < HEALTH_PARALLEL_UNITTEST_THREADS + 1)
+        health_parallel_unittest.tids[health_parallel_unittest.tids_used++] = tid;
+    spinlock_unlock(&health_parallel_unittest.spinlock);
+
+    // give the other threads the time to claim hosts
+    sleep_usec(1 * USEC_PER_MS);
+
+    // every host wants to run at a different time, the earliest should win
+    time_t wanted = now + 1 + (time_t)((h + health_parallel_unittest.iteration) % HEALTH_PARALLEL_UNITTEST_HOSTS);
+    if(wanted < *next_run)
+        *next_run = wanted;
+
+    __atomic_add_fetch(&health_parallel_unittest.evaluations[h], 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&health_parallel_unittest.running[h], false, __ATOMIC_RELEASE);
+}
+
+static size_t health_parallel_unittest_run(size_t threads) {
+    size_t errors = 0;
+
+    memset(health_parallel_unittest.evaluations, 0, sizeof(health_parallel_unittest.evaluations));
+    health_parallel_unittest.tids_used = 0;
+    health_parallel_unittest.errors = 0;
+
+    health_parallel_start_threads(threads);
+
+    for(size_t i = 0; i < HEALTH_PARALLEL_UNITTEST_ITERATIONS; i++) {
+        health_parallel_unittest.iteration = i;
+
+        time_t now = now_realtime_sec();
+        time_t next_run = now + 3600;
+        health_parallel_for_all_hosts(health_parallel_unittest_evaluate, false, now, &next_run);
+
+        // all hosts have been evaluated when the iteration returns
+        for(size_t h = 0; h < HEALTH_PARALLEL_UNITTEST_HOSTS; h++) {
+            size_t evaluations = __atomic_load_n(&health_parallel_unittest.evaluations[h], __ATOMIC_ACQUIRE);
+            if(evaluations != i + 1) {
+                fprintf(stderr, " >>> HEALTH PARALLEL: %zu threads, iteration %zu: host %zu has been evaluated %zu times\n",
+                        threads, i, h, evaluations);
+                errors++;
+            }
+        }
+
+        if(next_run != now + 1) {
+            fprintf(stderr, " >>> HEALTH PARALLEL: %zu threads, iteration %zu: the next run is in %ld seconds, expected 1\n",
+                    threads, i, (long)(next_run - now));
+            errors++;
+        }
+    }
+
+    health_parallel_stop();
+
+    errors += __atomic_load_n(&health_parallel_unittest.errors, __ATOMIC_RELAXED);
+
+    fprintf(stderr, "HEALTH PARALLEL: %zu threads: %zu hosts evaluated %d times by %zu threads\n",
+            threads, (size_t)HEALTH_PARALLEL_UNITTEST_HOSTS, HEALTH_PARALLEL_UNITTEST_ITERATIONS,
+            health_parallel_unittest.tids_used);
+
+    if(threads == 1 && health_parallel_unittest.tids_used != 1) {
+        fprintf(stderr, " >>> HEALTH PARALLEL: with 1 thread, the hosts were evaluated by %zu threads\n",
+                health_parallel_unittest.tids_used);
+        errors++;
+    }
+    else if(threads > 1 && health_parallel_unittest.tids_used < 2) {
+        fprintf(stderr, " >>> HEALTH PARALLEL: with %zu threads, the hosts were evaluated by one thread\n", threads);
+        errors++;
+    }
+
+    return errors;
+}
+
+// ----------------------------------------------------------------------------
+// unittest - lookups from windows give the same values with the query engine
+
+#define HEALTH_WINDOWS_UNITTEST_POINTS 120
+#define HEALTH_WINDOWS_UNITTEST_DURATION 60
+
+static void health_windows_unittest_collect(RRDSET *st, RRDDIM *d1, RRDDIM *d2, time_t start_s) {
+    // set the last collection time just before the first point, so that
+    // the values are stored as-is, without interpolation
+    RRDDIM *rds[] = { d1, d2 };
+    for(size_t d = 0; d < 2; d++) {
+        rds[d]->collector.last_collected_time.tv_sec =
+            st->last_collected_time.tv_sec = st->last_updated.tv_sec = start_s - 1;
+        rds[d]->collector.last_collected_time.tv_usec =
+            st->last_collected_time.tv_usec = st->last_updated.tv_usec = 0;
+    }
+
+    for(time_t p = 0; p < HEALTH_WINDOWS_UNITTEST_POINTS; p++) {
+        time_t now_s = start_s + p;
+        st->usec_since_last_update = USEC_PER_SEC;
+
+        collected_number v1 = (collected_number)((p * 7) % 23) - 11;
+        collected_number v2 = 1000 + (collected_number)((p * p) % 101);
+
+        for(size_t d = 0; d < 2; d++) {
+            RRDDIM *rd = rds[d];
+            rd->collector.last_collected_time.tv_sec = now_s;
+            rd->collector.last_collected_time.tv_usec = 0;
+            rd->collector.collected_value = d ? v2 : v1;
+            rrddim_set_updated(rd);
+            rd->collector.counter++;
+        }
+
+        rrdset_timed_done(st, (struct timeval){ .tv_sec = now_s, .tv_usec = 0 }, false);
+    }
+}
+
+static size_t health_windows_unittest(void) {
+    size_t errors = 0;
+
+    nd_uuid_t uuid;
+    char guid[UUID_STR_LEN];
+    uuid_generate(uuid);
+    uuid_unparse_lower(uuid, guid);
+
+    RRDHOST *host = rrdhost_find_or_create(
+        "unittest-health-windows", "unittest-health-windows", guid, os_type,
+        netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+        program_name, NETDATA_VERSION,
+        1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+        false, false, NULL, NULL, NULL,
+        false, 0, 0, NULL, false);
+
+    if(!host) {
+        fprintf(stderr, " >>> HEALTH WINDOWS: cannot create host\n");
+        return 1;
+    }
+
+    RRDSET *st = rrdset_create(host, "unittest", "windows", NULL, "unittest", "unittest.windows",
+                               "unittest", "units", "unittest", "health", 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *d1 = rrddim_add(st, "d1", "one", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *d2 = rrddim_add(st, "d2", "two", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    struct {
+        RRDR_TIME_GROUPING time_group;
+        RRDR_OPTIONS options;
+        const char *dimensions;
+    } tests[] = {
+        { RRDR_GROUPING_AVERAGE, 0,                                     NULL },
+        { RRDR_GROUPING_SUM,     0,                                     NULL },
+        { RRDR_GROUPING_MIN,     0,                                     NULL },
+        { RRDR_GROUPING_MAX,     0,                                     NULL },
+        { RRDR_GROUPING_AVERAGE, RRDR_OPTION_ABSOLUTE,                  NULL },
+        { RRDR_GROUPING_MIN,     RRDR_OPTION_ABSOLUTE,                  "d1" },
+        { RRDR_GROUPING_AVERAGE, RRDR_OPTION_DIMS_AVERAGE,              NULL },
+        { RRDR_GROUPING_MAX,     RRDR_OPTION_DIMS_MIN2MAX,              NULL },
+        { RRDR_GROUPING_SUM,     RRDR_OPTION_DIMS_MIN,                  NULL },
+        { RRDR_GROUPING_AVERAGE, RRDR_OPTION_DIMS_MAX,                  NULL },
+        { RRDR_GROUPING_AVERAGE, 0,                                     "two" },
+        { RRDR_GROUPING_SUM,     RRDR_OPTION_MATCH_IDS,                 "d2" },
+        { RRDR_GROUPING_MAX,     RRDR_OPTION_MATCH_NAMES,               "one" },
+    };
+
+    size_t tests_count = sizeof(tests) / sizeof(tests[0]);
+    RRDCALC rcs[sizeof(tests) / sizeof(tests[0])];
+    memset(rcs, 0, sizeof(rcs));
+
+    bool lookup_windows = health_globals.config.lookup_windows;
+    health_globals.config.lookup_windows = true;
+
+    time_t now_s = now_realtime_sec();
+
+    for(size_t t = 0; t < tests_count; t++) {
+        RRDCALC *rc = &rcs[t];
+        rc->rrdset = st;
+        rc->config.data_source = ALERT_LOOKUP_DATA_SOURCE_SAMPLES;
+        rc->config.time_group = tests[t].time_group;
+        rc->config.options = tests[t].options | RRDR_OPTION_NOT_ALIGNED;
+        rc->config.after = -HEALTH_WINDOWS_UNITTEST_DURATION;
+        rc->config.before = 0;
+        rc->config.dimensions = string_strdupz(tests[t].dimensions);
+        rc->dimensions_pattern = string_to_simple_pattern(rrdcalc_dimensions(rc));
+
+        // the first lookup creates the windows, it cannot be answered by them
+        int value_is_null = 0;
+        if(health_lookup_from_windows(rc, now_s, &value_is_null)) {
+            fprintf(stderr, " >>> HEALTH WINDOWS: test %zu: the first lookup has been answered from windows\n", t);
+            errors++;
+        }
+    }
+
+    // the points end now, so that the query engine finds them at the same position
+    health_windows_unittest_collect(st, d1, d2, now_s - HEALTH_WINDOWS_UNITTEST_POINTS + 1);
+
+    for(size_t t = 0; t < tests_count; t++) {
+        RRDCALC *rc = &rcs[t];
+
+        int windows_value_is_null = 0;
+        if(!health_lookup_from_windows(rc, now_s, &windows_value_is_null)) {
+            fprintf(stderr, " >>> HEALTH WINDOWS: test %zu: the lookup has not been answered from windows\n", t);
+            errors++;
+            continue;
+        }
+        NETDATA_DOUBLE windows_value = rc->value;
+        time_t windows_after = rc->db_after, windows_before = rc->db_before;
+
+        NETDATA_DOUBLE query_value = NAN;
+        time_t query_after = 0, query_before = 0;
+        int query_value_is_null = 0;
+        int ret = rrdset2value_api_v1(st, NULL, &query_value, rrdcalc_dimensions(rc), 1,
+                                      rc->config.after, rc->config.before, rc->config.time_group, NULL,
+                                      0, rc->config.options | RRDR_OPTION_SELECTED_TIER,
+                                      &query_after, &query_before,
+                                      NULL, NULL, NULL,
+                                      &query_value_is_null, NULL, 0, 0,
+                                      QUERY_SOURCE_UNITTEST, STORAGE_PRIORITY_SYNCHRONOUS);
+
+        if(ret != 200) {
+            fprintf(stderr, " >>> HEALTH WINDOWS: test %zu: the query returned %d\n", t, ret);
+            errors++;
+            continue;
+        }
+
+        if(windows_value_is_null != query_value_is_null ||
+            fabsndd(windows_value - query_value) > 0.0001 * (1.0 + fabsndd(query_value)) ||
+            windows_after != query_after || windows_before != query_before) {
+            fprintf(stderr, " >>> HEALTH WINDOWS: test %zu: windows gave " NETDATA_DOUBLE_FORMAT " (null %d) for %ld - %ld, "
+                            "the query gave " NETDATA_DOUBLE_FORMAT " (null %d) for %ld - %ld\n",
+                    t,
+                    windows_value, windows_value_is_null, (long)windows_after, (long)windows_before,
+                    query_value, query_value_is_null, (long)query_after, (long)query_before);
+            errors++;
+        }
+    }
+
+    for(size_t t = 0; t < tests_count; t++) {
+        string_freez(rcs[t].config.dimensions);
+        simple_pattern_free(rcs[t].dimensions_pattern);
+    }
+
+    health_globals.config.lookup_windows = lookup_windows;
+
+    fprintf(stderr, "HEALTH WINDOWS: %zu lookups compared with the query engine, %zu errors\n", tests_count, errors);
+    return errors;
+}
+
+int health_unittest(void) {
+    size_t errors = 0;
+
+    for(size_t h = 0; h < HEALTH_PARALLEL_UNITTEST_HOSTS; h++) {
+        nd_uuid_t uuid;
+        char guid[UUID_STR_LEN], hostname[50];
+        uuid_generate(uuid);
+        uuid_unparse_lower(uuid, guid);
+        snprintfz(hostname, sizeof(hostname), "unittest-health-%zu", h);
+
+        health_parallel_unittest.hosts[h] = rrdhost_find_or_create(
+            hostname, hostname, guid, os_type,
+            netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+            program_name, NETDATA_VERSION,
+            1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+            false, false, NULL, NULL, NULL,
+            false, 0, 0, NULL, false);
+
+        if(!health_parallel_unittest.hosts[h]) {
+            fprintf(stderr, "HEALTH: FAILED (cannot create host)\n");
+            return 1;
+        }
+    }
+
+    errors += health_parallel_unittest_run(1);
+    errors += health_parallel_unittest_run(HEALTH_PARALLEL_UNITTEST_THREADS);
+    errors += health_notifications_queue_unittest();
+    errors += health_windows_unittest();
+
+    fprintf(stderr, "HEALTH: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
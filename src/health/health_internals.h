@@ -11,6 +11,9 @@
 
 #define HEALTH_LOG_RETENTION_DEFAULT (5 * 86400)
 
+#define HEALTH_EVALUATION_THREADS_DEFAULT_MAX 8
+#define HEALTH_EVALUATION_THREADS_MAX 64
+
 #define HEALTH_CONF_MAX_LINE 4096
 
 #define HEALTH_ALARM_KEY "alarm"
@@ -88,6 +91,9 @@ struct health_plugin_globals {
 
         int32_t run_at_least_every_seconds;
         int32_t postpone_alarms_during_hibernation_for_seconds;
+
+        size_t evaluation_threads;              // the number of threads evaluating hosts in parallel
+        bool lookup_windows;                    // answer db lookups from in-memory windows, when possible
     } config;
 
     struct {
@@ -100,6 +106,7 @@ extern struct health_plugin_globals health_globals;
 int health_readfile(const char *filename, void *data, bool stock_config);
 void unlink_alarm_notify_in_progress(ALARM_ENTRY *ae);
 void wait_for_all_notifications_to_finish_before_allowing_health_to_be_cleaned_up(void);
+size_t health_notifications_queue_unittest(void);
 
 void health_alarm_wait_for_execution(ALARM_ENTRY *ae);
 
@@ -114,6 +121,8 @@ void health_dyncfg_register_all_prototypes(void);
 void health_prototype_to_json(BUFFER *wb, RRD_ALERT_PROTOTYPE *ap, bool for_hashing);
 
 bool alert_variable_lookup(STRING *variable, void *data, NETDATA_DOUBLE *result);
+bool alert_variable_lookup_bound(STRING *variable, void **binding, void *data, NETDATA_DOUBLE *result);
+void alert_variable_binding_free(void *binding, void *data);
 
 struct health_raised_summary;
 struct health_raised_summary *alerts_raised_summary_create(RRDHOST *host);
@@ -4,6 +4,8 @@
 #include "health-alert-entry.h"
 
 // the queue of executed alarm notifications that haven't been waited for yet
+// hosts are evaluated in parallel, so the queue is protected by a spinlock
+static SPINLOCK alarm_notifications_in_progress_spinlock = SPINLOCK_INITIALIZER;
 static ALARM_ENTRY *alarm_notifications_in_progress = NULL;
 
 struct health_raised_summary {
@@ -52,8 +54,12 @@ cleanup:
 
 void wait_for_all_notifications_to_finish_before_allowing_health_to_be_cleaned_up(void) {
     ALARM_ENTRY *ae;
-    while (NULL != (ae = alarm_notifications_in_progress)) {
-        if(unlikely(!service_running(SERVICE_HEALTH)))
+    while (true) {
+        spinlock_lock(&alarm_notifications_in_progress_spinlock);
+        ae = alarm_notifications_in_progress;
+        spinlock_unlock(&alarm_notifications_in_progress_spinlock);
+
+        if(!ae || unlikely(!service_running(SERVICE_HEALTH)))
             break;
 
         health_alarm_wait_for_execution(ae);
@@ -62,14 +68,18 @@ void wait_for_all_notifications_to_finish_before_allowing_health_to_be_cleaned_u
 
 void unlink_alarm_notify_in_progress(ALARM_ENTRY *ae)
 {
+    spinlock_lock(&alarm_notifications_in_progress_spinlock);
     fatal_assert(ae->prev_in_progress || ae->next_in_progress);
     DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(alarm_notifications_in_progress, ae, prev_in_progress, next_in_progress);
+    spinlock_unlock(&alarm_notifications_in_progress_spinlock);
 }
 
 static inline void enqueue_alarm_notify_in_progress(ALARM_ENTRY *ae)
 {
+    spinlock_lock(&alarm_notifications_in_progress_spinlock);
     fatal_assert(!ae->prev_in_progress && !ae->next_in_progress);
     DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(alarm_notifications_in_progress, ae, prev_in_progress, next_in_progress);
+    spinlock_unlock(&alarm_notifications_in_progress_spinlock);
 }
 
 static bool prepare_command(BUFFER *wb,
@@ -555,3 +565,93 @@ void health_alarm_log_process_to_send_notifications(RRDHOST *host, struct health
 
     rw_spinlock_write_unlock(&host->health_log.spinlock);
 }
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#define HEALTH_NOTIFICATIONS_UNITTEST_THREADS 4
+#define HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES 8
+#define HEALTH_NOTIFICATIONS_UNITTEST_ROUNDS 100000
+
+struct health_notifications_unittest_thread {
+    ND_THREAD *thread;
+    uint64_t seed;
+    ALARM_ENTRY entries[HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES];
+    bool queued[HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES];
+};
+
+// all threads queue and unlink their own entries to the same queue,
+// like the health threads do while evaluating different hosts
+static void health_notifications_unittest_thread(void *ptr) {
+    struct health_notifications_unittest_thread *t = ptr;
+
+    for(size_t r = 0; r < HEALTH_NOTIFICATIONS_UNITTEST_ROUNDS; r++) {
+        t->seed = t->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t e = (t->seed >> 33) % HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES;
+
+        if(t->queued[e])
+            unlink_alarm_notify_in_progress(&t->entries[e]);
+        else
+            enqueue_alarm_notify_in_progress(&t->entries[e]);
+
+        t->queued[e] = !t->queued[e];
+    }
+
+    for(size_t e = 0; e < HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES; e++) {
+        if(t->queued[e]) {
+            unlink_alarm_notify_in_progress(&t->entries[e]);
+            t->queued[e] = false;
+        }
+    }
+}
+
+size_t health_notifications_queue_unittest(void) {
+    size_t errors = 0;
+
+    spinlock_lock(&alarm_notifications_in_progress_spinlock);
+    bool empty = (alarm_notifications_in_progress == NULL);
+    spinlock_unlock(&alarm_notifications_in_progress_spinlock);
+
+    if(!empty) {
+        fprintf(stderr, " >>> HEALTH NOTIFICATIONS: the queue of notifications in progress is not empty\n");
+        return 1;
+    }
+
+    struct health_notifications_unittest_thread *threads = callocz(HEALTH_NOTIFICATIONS_UNITTEST_THREADS, sizeof(*threads));
+    for(size_t i = 0; i < HEALTH_NOTIFICATIONS_UNITTEST_THREADS; i++) {
+        char tag[ND_THREAD_TAG_MAX + 1];
+        snprintfz(tag, sizeof(tag), "UTHNOTIF[%zu]", i);
+        threads[i].seed = i + 1;
+        threads[i].thread = nd_thread_create(tag, NETDATA_THREAD_OPTION_DONT_LOG, health_notifications_unittest_thread, &threads[i]);
+    }
+
+    for(size_t i = 0; i < HEALTH_NOTIFICATIONS_UNITTEST_THREADS; i++)
+        nd_thread_join(threads[i].thread);
+
+    spinlock_lock(&alarm_notifications_in_progress_spinlock);
+    size_t left = 0;
+    for(ALARM_ENTRY *ae = alarm_notifications_in_progress; ae ; ae = ae->next_in_progress)
+        left++;
+    spinlock_unlock(&alarm_notifications_in_progress_spinlock);
+
+    if(left) {
+        fprintf(stderr, " >>> HEALTH NOTIFICATIONS: %zu entries are left in the queue of notifications in progress\n", left);
+        errors++;
+    }
+
+    for(size_t i = 0; i < HEALTH_NOTIFICATIONS_UNITTEST_THREADS; i++) {
+        for(size_t e = 0; e < HEALTH_NOTIFICATIONS_UNITTEST_ENTRIES; e++) {
+            if(threads[i].entries[e].prev_in_progress || threads[i].entries[e].next_in_progress) {
+                fprintf(stderr, " >>> HEALTH NOTIFICATIONS: entry %zu of thread %zu is still linked\n", e, i);
+                errors++;
+            }
+        }
+    }
+
+    freez(threads);
+
+    fprintf(stderr, "HEALTH NOTIFICATIONS: %d threads queued and unlinked notifications %d times\n",
+            HEALTH_NOTIFICATIONS_UNITTEST_THREADS, HEALTH_NOTIFICATIONS_UNITTEST_ROUNDS);
+
+    return errors;
+}
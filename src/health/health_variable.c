@@ -3,11 +3,85 @@
 #include "health.h"
 #include "health_internals.h"
 
+typedef enum {
+    DIM_SELECT_NORMAL,
+    DIM_SELECT_RAW,
+    DIM_SELECT_LAST_COLLECTED,
+} DIM_SELECT;
+
+// ----------------------------------------------------------------------------
+// variable bindings
+//
+// The variables of the expressions of alerts are resolved once, and the way
+// they were resolved is kept as the binding of the variable in the expression.
+// Following evaluations read the value directly from the binding.
+//
+// Bindings are resolved again when the charts, dimensions, variables, contexts
+// or alerts of the host change. Bindings to other charts and unresolved
+// variables are also resolved again periodically, since the dimensions and
+// the labels of other charts may change without changing these indexes.
+
+// bindings to other charts are resolved again at least this often
+#define ALERT_VARIABLE_BINDING_REFRESH_S 60
+
+typedef enum {
+    ALERT_VARIABLE_UNRESOLVED = 0,          // the variable could not be resolved
+    ALERT_VARIABLE_LOOKUP,                  // the variable is looked up on every evaluation
+    ALERT_VARIABLE_THIS,
+    ALERT_VARIABLE_AFTER,
+    ALERT_VARIABLE_BEFORE,
+    ALERT_VARIABLE_NOW,
+    ALERT_VARIABLE_STATUS,
+    ALERT_VARIABLE_CONSTANT,
+    ALERT_VARIABLE_LAST_COLLECTED_T,
+    ALERT_VARIABLE_UPDATE_EVERY,
+    ALERT_VARIABLE_DIMENSION,               // a dimension of the chart of the alert
+    ALERT_VARIABLE_CHART_VARIABLE,          // a custom variable of the chart of the alert
+    ALERT_VARIABLE_HOST_VARIABLE,           // a custom variable of the host
+    ALERT_VARIABLE_OTHER_CHART_DIMENSION,   // a dimension of another chart
+    ALERT_VARIABLE_OTHER_CHART_VARIABLE,    // a custom variable of another chart
+} ALERT_VARIABLE_TYPE;
+
+// the versions of the host indexes a binding depends on
+typedef struct alert_variable_bindings_version {
+    size_t chart_dimensions;
+    size_t chart_variables;
+    size_t host_variables;
+    size_t host_charts;
+    size_t host_alerts;
+    size_t host_contexts;
+} ALERT_VARIABLE_BINDINGS_VERSION;
+
+struct alert_variable_binding {
+    ALERT_VARIABLE_TYPE type;
+    DIM_SELECT dimension_selection;
+    NETDATA_DOUBLE constant;
+
+    ALERT_VARIABLE_BINDINGS_VERSION version; // the versions of the host indexes it was resolved with
+    time_t expires_s;                       // when it has to be resolved again, zero for never
+
+    // ALERT_VARIABLE_DIMENSION
+    DICTIONARY *rrddim_root_index;
+    const DICTIONARY_ITEM *rd_item;
+    RRDDIM *rd;
+
+    // ALERT_VARIABLE_OTHER_CHART_*
+    STRING *chart;
+    STRING *dim;
+};
+
 struct variable_lookup_score {
     RRDSET *st;
     const char *source;
     NETDATA_DOUBLE value;
     size_t score;
+
+    // when binding
+    ALERT_VARIABLE_TYPE type;
+    STRING *chart;
+    STRING *dim;
+    const DICTIONARY_ITEM *rd_item;         // dimensions of the chart of the alert are kept acquired
+    RRDDIM *rd;
 };
 
 struct variable_lookup_job {
@@ -17,11 +91,8 @@ struct variable_lookup_job {
     STRING *dim;
     const char *dimension;
     size_t dimension_length;
-    enum {
-        DIM_SELECT_NORMAL,
-        DIM_SELECT_RAW,
-        DIM_SELECT_LAST_COLLECTED,
-    } dimension_selection;
+    DIM_SELECT dimension_selection;
+    bool bind;
 
     struct {
         size_t size;
@@ -35,7 +106,7 @@ struct variable_lookup_job {
     } score;
 };
 
-static void variable_lookup_add_result_with_score(struct variable_lookup_job *vbd, NETDATA_DOUBLE n, RRDSET *st, const char *source __maybe_unused) {
+static void variable_lookup_add_result_with_score(struct variable_lookup_job *vbd, NETDATA_DOUBLE n, RRDSET *st, const char *source __maybe_unused, ALERT_VARIABLE_TYPE type, RRDDIM *rd, const DICTIONARY_ITEM *rd_item) {
     if(vbd->score.last_rrdset != st && vbd->rc->rrdset) {
         vbd->score.last_rrdset = st;
         vbd->score.last_score = rrdlabels_common_count(vbd->rc->rrdset->rrdlabels, st->rrdlabels);
@@ -49,12 +120,46 @@ static void variable_lookup_add_result_with_score(struct variable_lookup_job *vb
         vbd->result.array = reallocz(vbd->result.array, sizeof(struct variable_lookup_score) * vbd->result.size);
     }
 
-    vbd->result.array[vbd->result.used++] = (struct variable_lookup_score) {
+    struct variable_lookup_score *r = &vbd->result.array[vbd->result.used++];
+    *r = (struct variable_lookup_score) {
         .value = n,
         .score = vbd->score.last_score,
         .st = st,
         .source = source,
+        .type = type,
     };
+
+    if(vbd->bind) {
+        if(type == ALERT_VARIABLE_DIMENSION && st == vbd->rc->rrdset) {
+            r->rd_item = dictionary_acquired_item_dup(st->rrddim_root_index, rd_item);
+            r->rd = rd;
+        }
+        else if(type == ALERT_VARIABLE_DIMENSION) {
+            r->type = ALERT_VARIABLE_OTHER_CHART_DIMENSION;
+            r->chart = string_dup(st->id);
+            r->dim = string_dup(rd->id);
+        }
+        else if(type == ALERT_VARIABLE_CHART_VARIABLE && st != vbd->rc->rrdset) {
+            r->type = ALERT_VARIABLE_OTHER_CHART_VARIABLE;
+            r->chart = string_dup(st->id);
+        }
+    }
+}
+
+static void variable_lookup_results_cleanup(struct variable_lookup_job *vbd) {
+    for(size_t i = 0; i < vbd->result.used ;i++) {
+        struct variable_lookup_score *r = &vbd->result.array[i];
+
+        if(r->rd_item)
+            dictionary_acquired_item_release(r->st->rrddim_root_index, r->rd_item);
+
+        string_freez(r->chart);
+        string_freez(r->dim);
+    }
+
+    freez(vbd->result.array);
+    vbd->result.array = NULL;
+    vbd->result.used = vbd->result.size = 0;
 }
 
 static bool variable_lookup_in_chart(struct variable_lookup_job *vbd, RRDSET *st, bool stop_on_match) {
@@ -72,13 +177,13 @@ static bool variable_lookup_in_chart(struct variable_lookup_job *vbd, RRDSET *st
     if (item) {
         switch (vbd->dimension_selection) {
             case DIM_SELECT_NORMAL:
-                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_stored_value, st, "last stored value of dimension");
+                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_stored_value, st, "last stored value of dimension", ALERT_VARIABLE_DIMENSION, rd, item);
                 break;
             case DIM_SELECT_RAW:
-                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_collected_value, st, "last collected value of dimension");
+                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_collected_value, st, "last collected value of dimension", ALERT_VARIABLE_DIMENSION, rd, item);
                 break;
             case DIM_SELECT_LAST_COLLECTED:
-                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_collected_time.tv_sec, st, "last collected time of dimension");
+                variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rd->collector.last_collected_time.tv_sec, st, "last collected time of dimension", ALERT_VARIABLE_DIMENSION, rd, item);
                 break;
         }
 
@@ -91,7 +196,7 @@ static bool variable_lookup_in_chart(struct variable_lookup_job *vbd, RRDSET *st
     {
         NETDATA_DOUBLE n;
         if(rrdvar_get_custom_chart_variable_value(st, vbd->variable, &n)) {
-            variable_lookup_add_result_with_score(vbd, n, st, "chart variable");
+            variable_lookup_add_result_with_score(vbd, n, st, "chart variable", ALERT_VARIABLE_CHART_VARIABLE, NULL, NULL);
             found = true;
         }
     }
@@ -145,7 +250,7 @@ bool alert_variable_from_running_alerts(struct variable_lookup_job *vbd) {
     RRDCALC *rc;
     foreach_rrdcalc_in_rrdhost_read(vbd->host, rc) {
         if(rc->config.name == vbd->variable && rc->rrdset) {
-            variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rc->value, rc->rrdset, "alarm value");
+            variable_lookup_add_result_with_score(vbd, (NETDATA_DOUBLE)rc->value, rc->rrdset, "alarm value", ALERT_VARIABLE_LOOKUP, NULL, NULL);
             found = true;
         }
     }
@@ -167,7 +272,38 @@ static STRING *this_string = NULL,
               *last_collected_t_string = NULL,
               *update_every_string = NULL;
 
+// the variables are compared by pointer, so their names are created once, before the first lookup.
+// Lookups run in parallel (on all health threads and on web threads), so this is done under a lock.
+static SPINLOCK alert_variable_strings_spinlock = SPINLOCK_INITIALIZER;
+static bool alert_variable_strings_initialized = false;
+
+static void alert_variable_lookup_strings_init(void) {
+    if(likely(__atomic_load_n(&alert_variable_strings_initialized, __ATOMIC_ACQUIRE)))
+        return;
+
+    spinlock_lock(&alert_variable_strings_spinlock);
+    if(!alert_variable_strings_initialized) {
+        this_string = string_strdupz("this");
+        now_string = string_strdupz("now");
+        after_string = string_strdupz("after");
+        before_string = string_strdupz("before");
+        status_string = string_strdupz("status");
+        removed_string = string_strdupz("REMOVED");
+        undefined_string = string_strdupz("UNDEFINED");
+        uninitialized_string = string_strdupz("UNINITIALIZED");
+        clear_string = string_strdupz("CLEAR");
+        warning_string = string_strdupz("WARNING");
+        critical_string = string_strdupz("CRITICAL");
+        last_collected_t_string = string_strdupz("last_collected_t");
+        update_every_string = string_strdupz("update_every");
+        __atomic_store_n(&alert_variable_strings_initialized, true, __ATOMIC_RELEASE);
+    }
+    spinlock_unlock(&alert_variable_strings_spinlock);
+}
+
 void alert_variable_lookup_cleanup(void) {
+    spinlock_lock(&alert_variable_strings_spinlock);
+    __atomic_store_n(&alert_variable_strings_initialized, false, __ATOMIC_RELEASE);
     string_freez(this_string);
     string_freez(now_string);
     string_freez(after_string);
@@ -194,10 +330,12 @@ void alert_variable_lookup_cleanup(void) {
     critical_string = NULL;
     last_collected_t_string = NULL;
     update_every_string = NULL;
+    spinlock_unlock(&alert_variable_strings_spinlock);
 }
 
-bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE *result, BUFFER *wb) {
+static bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE *result, BUFFER *wb, struct alert_variable_binding *b) {
     struct variable_lookup_job vbd = { 0 };
+    ALERT_VARIABLE_TYPE type = ALERT_VARIABLE_UNRESOLVED;
 
 //    const char *v_name = string2str(variable);
 //    bool trace_this = false;
@@ -215,26 +353,13 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
     if(!st)
         return false;
 
-    if(unlikely(!last_collected_t_string)) {
-        this_string = string_strdupz("this");
-        now_string = string_strdupz("now");
-        after_string = string_strdupz("after");
-        before_string = string_strdupz("before");
-        status_string = string_strdupz("status");
-        removed_string = string_strdupz("REMOVED");
-        undefined_string = string_strdupz("UNDEFINED");
-        uninitialized_string = string_strdupz("UNINITIALIZED");
-        clear_string = string_strdupz("CLEAR");
-        warning_string = string_strdupz("WARNING");
-        critical_string = string_strdupz("CRITICAL");
-        last_collected_t_string = string_strdupz("last_collected_t");
-        update_every_string = string_strdupz("update_every");
-    }
+    alert_variable_lookup_strings_init();
 
     if(unlikely(variable == this_string)) {
         *result = (NETDATA_DOUBLE)rc->value;
         source = "current alert value";
         source_st = st;
+        type = ALERT_VARIABLE_THIS;
         found = true;
         goto log;
     }
@@ -243,6 +368,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)rc->db_after;
         source = "current alert query start time";
         source_st = st;
+        type = ALERT_VARIABLE_AFTER;
         found = true;
         goto log;
     }
@@ -251,6 +377,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)rc->db_before;
         source = "current alert query end time";
         source_st = st;
+        type = ALERT_VARIABLE_BEFORE;
         found = true;
         goto log;
     }
@@ -259,6 +386,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)now_realtime_sec();
         source = "current wall-time clock timestamp";
         source_st = st;
+        type = ALERT_VARIABLE_NOW;
         found = true;
         goto log;
     }
@@ -267,6 +395,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)rc->status;
         source = "current alert status";
         source_st = st;
+        type = ALERT_VARIABLE_STATUS;
         found = true;
         goto log;
     }
@@ -275,6 +404,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_REMOVED;
         source = "removed status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -283,6 +413,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_UNINITIALIZED;
         source = "uninitialized status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -291,6 +422,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_UNDEFINED;
         source = "undefined status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -299,6 +431,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_CLEAR;
         source = "clear status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -307,6 +440,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_WARNING;
         source = "warning status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -315,6 +449,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)RRDCALC_STATUS_CRITICAL;
         source = "critical status constant";
         source_st = st;
+        type = ALERT_VARIABLE_CONSTANT;
         found = true;
         goto log;
     }
@@ -323,6 +458,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)st->last_collected_time.tv_sec;
         source = "current instance last_collected_t";
         source_st = st;
+        type = ALERT_VARIABLE_LAST_COLLECTED_T;
         found = true;
         goto log;
     }
@@ -331,6 +467,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         *result = (NETDATA_DOUBLE)st->update_every;
         source = "current instance update_every";
         source_st = st;
+        type = ALERT_VARIABLE_UPDATE_EVERY;
         found = true;
         goto log;
     }
@@ -345,15 +482,18 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         .dimension_length = string_strlen(variable),
         .dimension_selection = DIM_SELECT_NORMAL,
         .dim = string_dup(variable),
+        .bind = b != NULL,
         .result = { 0 },
     };
     if (strendswith_lengths(vbd.dimension, vbd.dimension_length, "_raw", 4)) {
         vbd.dimension_length -= 4;
         vbd.dimension_selection = DIM_SELECT_RAW;
+        string_freez(vbd.dim);
         vbd.dim = string_strndupz(vbd.dimension, vbd.dimension_length);
     } else if (strendswith_lengths(vbd.dimension, vbd.dimension_length, "_last_collected_t", 17)) {
         vbd.dimension_length -= 17;
         vbd.dimension_selection = DIM_SELECT_LAST_COLLECTED;
+        string_freez(vbd.dim);
         vbd.dim = string_strndupz(vbd.dimension, vbd.dimension_length);
     }
 
@@ -367,7 +507,7 @@ bool alert_variable_lookup_internal(STRING *variable, void *data, NETDATA_DOUBLE
         NETDATA_DOUBLE n;
         found = rrdvar_get_custom_host_variable_value(vbd.host,  vbd.variable, &n);
         if(found) {
-            variable_lookup_add_result_with_score(&vbd, n, st, "host variable");
+            variable_lookup_add_result_with_score(&vbd, n, st, "host variable", ALERT_VARIABLE_HOST_VARIABLE, NULL, NULL);
             goto find_best_scored;
         }
     }
@@ -409,7 +549,23 @@ find_best_scored:
         source = best->source;
         source_st = best->st;
         *result = best->value;
-        freez(vbd.result.array);
+
+        if(b) {
+            // move the references of the best candidate to the binding
+            type = best->type;
+            b->dimension_selection = vbd.dimension_selection;
+            b->chart = best->chart;
+            b->dim = best->dim;
+            b->rd = best->rd;
+            b->rd_item = best->rd_item;
+            b->rrddim_root_index = best->rd_item ? best->st->rrddim_root_index : NULL;
+            best->chart = best->dim = NULL;
+            best->rd_item = NULL;
+
+            if(best->st != st || vbd.result.used > 1)
+                // it was scored against other charts
+                b->expires_s = now_monotonic_sec() + ALERT_VARIABLE_BINDING_REFRESH_S;
+        }
     }
     else {
         found = false;
@@ -417,6 +573,17 @@ find_best_scored:
     }
 
 log:
+    if(b) {
+        b->type = type;
+
+        if(type == ALERT_VARIABLE_CONSTANT)
+            b->constant = *result;
+
+        else if(type == ALERT_VARIABLE_UNRESOLVED)
+            // it may be found in charts that are still being created
+            b->expires_s = now_monotonic_sec() + ALERT_VARIABLE_BINDING_REFRESH_S;
+    }
+
 #ifdef NETDATA_LOG_HEALTH_VARIABLES_LOOKUP
     if(found) {
         nd_log(NDLS_DAEMON, NDLP_INFO,
@@ -464,13 +631,226 @@ log:
         }
     }
 
+    variable_lookup_results_cleanup(&vbd);
     string_freez(vbd.dim);
 
     return found;
 }
 
 bool alert_variable_lookup(STRING *variable, void *data, NETDATA_DOUBLE *result) {
-    return alert_variable_lookup_internal(variable, data, result, NULL);
+    return alert_variable_lookup_internal(variable, data, result, NULL, NULL);
+}
+
+// ----------------------------------------------------------------------------
+// bound variables lookup
+
+static inline ALERT_VARIABLE_BINDINGS_VERSION alert_variable_bindings_version(RRDSET *st) {
+    RRDHOST *host = st->rrdhost;
+
+    return (ALERT_VARIABLE_BINDINGS_VERSION) {
+        .chart_dimensions = dictionary_version(st->rrddim_root_index),
+        .chart_variables = dictionary_version(st->rrdvars),
+        .host_variables = dictionary_version(host->rrdvars),
+        .host_charts = dictionary_version(host->rrdset_root_index),
+        .host_alerts = dictionary_version(host->rrdcalc_root_index),
+        .host_contexts = dictionary_version(host->rrdctx.contexts),
+    };
+}
+
+static inline bool alert_variable_bindings_version_equal(const ALERT_VARIABLE_BINDINGS_VERSION *a, const ALERT_VARIABLE_BINDINGS_VERSION *b) {
+    return a->chart_dimensions == b->chart_dimensions &&
+           a->chart_variables == b->chart_variables &&
+           a->host_variables == b->host_variables &&
+           a->host_charts == b->host_charts &&
+           a->host_alerts == b->host_alerts &&
+           a->host_contexts == b->host_contexts;
+}
+
+static void alert_variable_binding_release(struct alert_variable_binding *b) {
+    if(b->rd_item)
+        dictionary_acquired_item_release(b->rrddim_root_index, b->rd_item);
+
+    string_freez(b->chart);
+    string_freez(b->dim);
+
+    memset(b, 0, sizeof(*b));
+}
+
+void alert_variable_binding_free(void *binding, void *data __maybe_unused) {
+    struct alert_variable_binding *b = binding;
+    alert_variable_binding_release(b);
+    freez(b);
+}
+
+static inline NETDATA_DOUBLE alert_variable_dimension_value(RRDDIM *rd, DIM_SELECT dimension_selection) {
+    switch(dimension_selection) {
+        default:
+        case DIM_SELECT_NORMAL:
+            return (NETDATA_DOUBLE)rd->collector.last_stored_value;
+
+        case DIM_SELECT_RAW:
+            return (NETDATA_DOUBLE)rd->collector.last_collected_value;
+
+        case DIM_SELECT_LAST_COLLECTED:
+            return (NETDATA_DOUBLE)rd->collector.last_collected_time.tv_sec;
+    }
+}
+
+static bool alert_variable_other_chart_value(RRDHOST *host, STRING *chart, STRING *dim, DIM_SELECT dimension_selection, STRING *variable, NETDATA_DOUBLE *result) {
+    bool found = false;
+
+    RRDSET_ACQUIRED *rsa = rrdset_find_and_acquire(host, string2str(chart), true);
+    if(!rsa)
+        return false;
+
+    RRDSET *st = rrdset_acquired_to_rrdset(rsa);
+    if(dim) {
+        RRDDIM_ACQUIRED *rda = rrddim_find_and_acquire(st, string2str(dim), true);
+        if(rda) {
+            *result = alert_variable_dimension_value(rrddim_acquired_to_rrddim(rda), dimension_selection);
+            rrddim_acquired_release(rda);
+            found = true;
+        }
+    }
+    else
+        found = rrdvar_get_custom_chart_variable_value(st, variable, result);
+
+    rrdset_acquired_release(rsa);
+    return found;
+}
+
+// the value of a variable, using a copy of its binding (dimensions are read by the caller)
+// returns false when the binding cannot provide the value and the variable has to be resolved again
+static bool alert_variable_binding_value(RRDCALC *rc, RRDSET *st, struct alert_variable_binding *b, STRING *variable, NETDATA_DOUBLE *result) {
+    switch(b->type) {
+        case ALERT_VARIABLE_THIS:
+            *result = (NETDATA_DOUBLE)rc->value;
+            return true;
+
+        case ALERT_VARIABLE_AFTER:
+            *result = (NETDATA_DOUBLE)rc->db_after;
+            return true;
+
+        case ALERT_VARIABLE_BEFORE:
+            *result = (NETDATA_DOUBLE)rc->db_before;
+            return true;
+
+        case ALERT_VARIABLE_NOW:
+            *result = (NETDATA_DOUBLE)now_realtime_sec();
+            return true;
+
+        case ALERT_VARIABLE_STATUS:
+            *result = (NETDATA_DOUBLE)rc->status;
+            return true;
+
+        case ALERT_VARIABLE_CONSTANT:
+            *result = b->constant;
+            return true;
+
+        case ALERT_VARIABLE_LAST_COLLECTED_T:
+            *result = (NETDATA_DOUBLE)st->last_collected_time.tv_sec;
+            return true;
+
+        case ALERT_VARIABLE_UPDATE_EVERY:
+            *result = (NETDATA_DOUBLE)st->update_every;
+            return true;
+
+        case ALERT_VARIABLE_CHART_VARIABLE:
+            return rrdvar_get_custom_chart_variable_value(st, variable, result);
+
+        case ALERT_VARIABLE_HOST_VARIABLE:
+            return rrdvar_get_custom_host_variable_value(st->rrdhost, variable, result);
+
+        case ALERT_VARIABLE_OTHER_CHART_DIMENSION:
+        case ALERT_VARIABLE_OTHER_CHART_VARIABLE:
+            return alert_variable_other_chart_value(st->rrdhost, b->chart, b->dim, b->dimension_selection, variable, result);
+
+        default:
+        case ALERT_VARIABLE_UNRESOLVED:
+        case ALERT_VARIABLE_LOOKUP:
+        case ALERT_VARIABLE_DIMENSION:
+            return false;
+    }
+}
+
+bool alert_variable_lookup_bound(STRING *variable, void **binding, void *data, NETDATA_DOUBLE *result) {
+    RRDCALC *rc = data;
+    RRDSET *st = rc->rrdset;
+
+    if(!st)
+        return false;
+
+    ALERT_VARIABLE_BINDINGS_VERSION version = alert_variable_bindings_version(st);
+
+    spinlock_lock(&rc->variables.spinlock);
+
+    if(unlikely(rc->variables.released)) {
+        // the alert has been unlinked from its chart and it is being deleted
+        // (an unlinked RRDCALC is never linked again, so there is no point in binding anything)
+        spinlock_unlock(&rc->variables.spinlock);
+        return alert_variable_lookup(variable, rc, result);
+    }
+
+    struct alert_variable_binding *b = *binding;
+    struct alert_variable_binding bb = { 0 };
+
+    bool bound = b && alert_variable_bindings_version_equal(&b->version, &version) &&
+                 (!b->expires_s || now_monotonic_sec() < b->expires_s);
+
+    if(likely(bound)) {
+        if(b->type == ALERT_VARIABLE_DIMENSION) {
+            // the binding keeps the dimension acquired, so it can only be read while holding the lock
+            *result = alert_variable_dimension_value(b->rd, b->dimension_selection);
+            spinlock_unlock(&rc->variables.spinlock);
+            return true;
+        }
+
+        // everything else is read without holding the lock
+        bb = (struct alert_variable_binding) {
+            .type = b->type,
+            .dimension_selection = b->dimension_selection,
+            .constant = b->constant,
+            .chart = string_dup(b->chart),
+            .dim = string_dup(b->dim),
+        };
+    }
+    spinlock_unlock(&rc->variables.spinlock);
+
+    if(likely(bound)) {
+        if(bb.type == ALERT_VARIABLE_UNRESOLVED) {
+            *result = NAN;
+            return false;
+        }
+
+        bool found = alert_variable_binding_value(rc, st, &bb, variable, result);
+        string_freez(bb.chart);
+        string_freez(bb.dim);
+
+        if(found)
+            return true;
+    }
+
+    // resolve the variable again, without holding the lock,
+    // since this needs the locks of the host indexes
+    struct alert_variable_binding *nb = callocz(1, sizeof(*nb));
+    nb->version = version;
+    bool found = alert_variable_lookup_internal(variable, rc, result, NULL, nb);
+
+    // swap the bindings under the lock, and free the one not used outside it
+    spinlock_lock(&rc->variables.spinlock);
+    if(unlikely(rc->variables.released))
+        // the alert has been unlinked from its chart meanwhile
+        b = nb;
+    else {
+        b = *binding;
+        *binding = nb;
+    }
+    spinlock_unlock(&rc->variables.spinlock);
+
+    if(b)
+        alert_variable_binding_free(b, rc);
+
+    return found;
 }
 
 int alert_variable_lookup_trace(RRDHOST *host __maybe_unused, RRDSET *st, const char *variable, BUFFER *wb) {
@@ -485,7 +865,7 @@ int alert_variable_lookup_trace(RRDHOST *host __maybe_unused, RRDSET *st, const
     };
 
     NETDATA_DOUBLE n;
-    alert_variable_lookup_internal(v, &rc, &n, wb);
+    alert_variable_lookup_internal(v, &rc, &n, wb, NULL);
 
     string_freez(v);
 
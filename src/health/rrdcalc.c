@@ -273,6 +273,15 @@ static void rrdcalc_unlink_from_rrdset(RRDCALC *rc, bool having_ll_wrlock) {
         }
     }
 
+    // the bindings may have acquired dimensions of the chart
+    // unlinked alerts are deleted and never linked again, so this flag is never cleared
+    spinlock_lock(&rc->variables.spinlock);
+    rc->variables.released = true;
+    expression_free_variable_bindings(rc->config.calculation);
+    expression_free_variable_bindings(rc->config.warning);
+    expression_free_variable_bindings(rc->config.critical);
+    spinlock_unlock(&rc->variables.spinlock);
+
     if(!having_ll_wrlock)
         rw_spinlock_write_lock(&st->alerts.spinlock);
 
@@ -322,6 +331,8 @@ static void rrdcalc_rrdhost_insert_callback(const DICTIONARY_ITEM *item __maybe_
     if(!rc->config.units)
         rc->config.units = string_dup(st->units);
 
+    rc->dimensions_pattern = string_to_simple_pattern(rrdcalc_dimensions(rc));
+
     // the following interferes with replication, changing the alert frequency to unexpected values
     // let's respect user configuration, so we disable it
     
@@ -337,9 +348,10 @@ static void rrdcalc_rrdhost_insert_callback(const DICTIONARY_ITEM *item __maybe_
 
     rc->id = rrdcalc_get_unique_id(host, rc->chart, rc->config.name, &rc->next_event_id, &rc->config.hash_id);
 
-    expression_set_variable_lookup_callback(rc->config.calculation, alert_variable_lookup, rc);
-    expression_set_variable_lookup_callback(rc->config.warning, alert_variable_lookup, rc);
-    expression_set_variable_lookup_callback(rc->config.critical, alert_variable_lookup, rc);
+    spinlock_init(&rc->variables.spinlock);
+    expression_set_variable_bound_lookup_callback(rc->config.calculation, alert_variable_lookup_bound, alert_variable_binding_free, rc);
+    expression_set_variable_bound_lookup_callback(rc->config.warning, alert_variable_lookup_bound, alert_variable_binding_free, rc);
+    expression_set_variable_bound_lookup_callback(rc->config.critical, alert_variable_lookup_bound, alert_variable_binding_free, rc);
 
     rrdcalc_update_info_using_rrdset_labels(rc);
 
@@ -376,6 +388,8 @@ static void rrdcalc_rrdhost_delete_callback(const DICTIONARY_ITEM *item __maybe_
 
     rrd_alert_config_cleanup(&rc->config);
 
+    simple_pattern_free(rc->dimensions_pattern);
+
     string_freez(rc->key);
     string_freez(rc->chart);
 
@@ -75,6 +75,13 @@ struct rrdcalc {
     time_t db_after;                // the first timestamp evaluated by the db lookup
     time_t db_before;               // the last timestamp evaluated by the db lookup
 
+    SIMPLE_PATTERN *dimensions_pattern; // the dimensions of the db lookup, for lookups from in-memory windows
+
+    struct {
+        SPINLOCK spinlock;          // protects the bindings of the variables of the expressions
+        bool released;              // the bindings have been released, the alert is unlinked (and it is never linked again)
+    } variables;
+
     time_t delay_up_to_timestamp;   // the timestamp up to which we should delay notifications
     int delay_up_current;           // the current up notification delay duration
     int delay_down_current;         // the current down notification delay duration
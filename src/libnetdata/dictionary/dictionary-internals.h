@@ -143,7 +143,10 @@ struct dictionary {
     ARAL *value_aral;
 
     struct {                            // support for multiple indexing engines
-        Pvoid_t JudyHSArray;        // the hash table
+        union {
+            Pvoid_t JudyHSArray;        // the hash table, with DICT_OPTION_INDEX_JUDY
+            void *hashtable;            // the hash table, with DICT_OPTION_INDEX_HASHTABLE
+        };
         RW_SPINLOCK rw_spinlock;        // protect the index
     } index;
 
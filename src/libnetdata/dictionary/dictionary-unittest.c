@@ -359,6 +359,88 @@ static void dictionary_unittest_null_dfe(DICTIONARY *dict, char **names, char **
 }
 
 
+// ----------------------------------------------------------------------------
+// lookups of missing keys in full hashtables
+
+#define SIMPLE_HASHTABLE_NAME _UNITTEST
+#define SIMPLE_HASHTABLE_WITHOUT_STATISTICS 1
+#include "../simple_hashtable/simple_hashtable.h"
+
+static size_t dictionary_unittest_hashtable_full(char **names, char **values, size_t entries) {
+    size_t errors = 0;
+
+    fprintf(stderr, "\nTesting lookups of missing keys in a full hashtable\n");
+
+    // fill it completely, without resizing it
+    SIMPLE_HASHTABLE_UNITTEST ht;
+    simple_hashtable_init_UNITTEST(&ht, 16);
+    for(uint64_t hash = 1; hash <= 16 ; hash++) {
+        SIMPLE_HASHTABLE_SLOT_UNITTEST *sl = simple_hashtable_get_slot_UNITTEST(&ht, hash, NULL, false);
+        simple_hashtable_set_slot_UNITTEST(&ht, sl, hash, (void *)(uintptr_t)hash);
+    }
+
+    if(ht.used != ht.size) {
+        fprintf(stderr, ">>> %s() the hashtable is not full, used %zu of %zu slots\n", __FUNCTION__, ht.used, ht.size);
+        errors++;
+    }
+
+    for(uint64_t hash = 1; hash <= 16 ; hash++) {
+        SIMPLE_HASHTABLE_SLOT_UNITTEST *sl = simple_hashtable_get_slot_UNITTEST(&ht, hash, NULL, false);
+        if(!sl || SIMPLE_HASHTABLE_SLOT_DATA(sl) != (void *)(uintptr_t)hash) {
+            fprintf(stderr, ">>> %s() cannot find hash %"PRIu64" in the full hashtable\n", __FUNCTION__, hash);
+            errors++;
+        }
+    }
+
+    // these must not loop forever, and must not return a slot that could be written
+    for(uint64_t hash = 17; hash <= 1000 ; hash++) {
+        SIMPLE_HASHTABLE_SLOT_UNITTEST *sl = simple_hashtable_get_slot_UNITTEST(&ht, hash, NULL, false);
+        if(sl) {
+            fprintf(stderr, ">>> %s() returned a slot for missing hash %"PRIu64" in the full hashtable\n", __FUNCTION__, hash);
+            errors++;
+        }
+    }
+
+    if(ht.size != 16 || ht.needs_cleanup) {
+        fprintf(stderr, ">>> %s() lookups without resize modified the hashtable\n", __FUNCTION__);
+        errors++;
+    }
+
+    // inserting with resize keeps a quarter of the slots unset
+    for(uint64_t hash = 17; hash <= 10000 ; hash++) {
+        SIMPLE_HASHTABLE_SLOT_UNITTEST *sl = simple_hashtable_get_slot_UNITTEST(&ht, hash, NULL, true);
+        simple_hashtable_set_slot_UNITTEST(&ht, sl, hash, (void *)(uintptr_t)hash);
+
+        if(ht.used * 4 > ht.size * 3) {
+            fprintf(stderr, ">>> %s() the hashtable is %zu of %zu slots full, after inserting hash %"PRIu64"\n",
+                    __FUNCTION__, ht.used, ht.size, hash);
+            errors++;
+            break;
+        }
+    }
+
+    simple_hashtable_destroy_UNITTEST(&ht);
+
+    fprintf(stderr, "Testing lookups of missing keys in a dictionary with hashtable index, after deletions\n");
+
+    DICTIONARY *dict = dictionary_create(DICT_OPTION_SINGLE_THREADED | DICT_OPTION_INDEX_HASHTABLE);
+
+    // deleted items leave tombstones in the hashtable,
+    // adding and deleting repeatedly should not fill it
+    for(size_t round = 0; round < 10 ; round++) {
+        errors += dictionary_unittest_set_clone(dict, names, values, entries);
+        errors += dictionary_unittest_get_nonexisting(dict, names, values, entries);
+        errors += dictionary_unittest_del_existing(dict, names, values, entries);
+        errors += dictionary_unittest_get_nonexisting(dict, names, values, entries);
+        errors += dictionary_unittest_del_nonexisting(dict, names, values, entries);
+    }
+
+    dictionary_destroy(dict);
+
+    fprintf(stderr, "%zu errors\n", errors);
+    return errors;
+}
+
 static int unittest_check_dictionary_callback(const DICTIONARY_ITEM *item __maybe_unused, void *value __maybe_unused, void *data __maybe_unused) {
     return 1;
 }
@@ -1062,6 +1144,20 @@ int dictionary_unittest(size_t entries) {
         DICT_OPTION_NAME_LINK_DONT_CLONE | DICT_OPTION_VALUE_LINK_DONT_CLONE | DICT_OPTION_ADD_IN_FRONT);
     dictionary_unittest_nonclone(dict, names, values, entries, &errors);
 
+    fprintf(stderr, "\nCreating dictionary single threaded, hashtable index, clone, %zu items\n", entries);
+    dict = dictionary_create(DICT_OPTION_SINGLE_THREADED | DICT_OPTION_INDEX_HASHTABLE);
+    dictionary_unittest_clone(dict, names, values, entries, &errors);
+
+    fprintf(stderr, "\nCreating dictionary multi threaded, hashtable index, clone, %zu items\n", entries);
+    dict = dictionary_create(DICT_OPTION_INDEX_HASHTABLE);
+    dictionary_unittest_clone(dict, names, values, entries, &errors);
+
+    fprintf(stderr, "\nCreating dictionary multi threaded, hashtable index, non-clone, add-in-front options, %zu items\n", entries);
+    dict = dictionary_create(
+        DICT_OPTION_INDEX_HASHTABLE | DICT_OPTION_NAME_LINK_DONT_CLONE | DICT_OPTION_VALUE_LINK_DONT_CLONE |
+        DICT_OPTION_ADD_IN_FRONT);
+    dictionary_unittest_nonclone(dict, names, values, entries, &errors);
+
     fprintf(stderr, "\nCreating dictionary single-threaded, non-clone, don't overwrite options, %zu items\n", entries);
     dict = dictionary_create(
         DICT_OPTION_SINGLE_THREADED | DICT_OPTION_NAME_LINK_DONT_CLONE | DICT_OPTION_VALUE_LINK_DONT_CLONE |
@@ -1094,6 +1190,13 @@ int dictionary_unittest(size_t entries) {
     dictionary_unittest_sorting(dict, names, values, entries, &errors);
     dictionary_unittest_run_and_measure_time(dict, "destroying full dictionary", names, values, entries, &errors, dictionary_unittest_destroy);
 
+    fprintf(stderr, "\nCreating dictionary single threaded, hashtable index, clone, %zu items\n", entries);
+    dict = dictionary_create(DICT_OPTION_SINGLE_THREADED | DICT_OPTION_INDEX_HASHTABLE);
+    dictionary_unittest_sorting(dict, names, values, entries, &errors);
+    dictionary_unittest_run_and_measure_time(dict, "destroying full dictionary", names, values, entries, &errors, dictionary_unittest_destroy);
+
+    errors += dictionary_unittest_hashtable_full(names, values, entries);
+
     fprintf(stderr, "\nCreating dictionary single threaded, clone, %zu items\n", entries);
     dict = dictionary_create(DICT_OPTION_SINGLE_THREADED);
     dictionary_unittest_null_dfe(dict, names, values, entries, &errors);
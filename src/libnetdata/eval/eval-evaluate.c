@@ -17,7 +17,13 @@ static NETDATA_DOUBLE eval_variable(EVAL_EXPRESSION *exp, EVAL_VARIABLE *v, int
         return NAN;
     }
 
-    if(exp->variable_lookup_cb && exp->variable_lookup_cb(v->name, exp->variable_lookup_cb_data, &n)) {
+    bool found;
+    if(exp->variable_bound_lookup_cb && v->slot < exp->variables.used)
+        found = exp->variable_bound_lookup_cb(v->name, &exp->variables.array[v->slot].binding, exp->variable_lookup_cb_data, &n);
+    else
+        found = exp->variable_lookup_cb && exp->variable_lookup_cb(v->name, exp->variable_lookup_cb_data, &n);
+
+    if(found) {
         buffer_sprintf(exp->error_msg, "[ ${%s} = ", string2str(v->name));
         print_parsed_as_constant(exp->error_msg, n);
         buffer_strcat(exp->error_msg, " ] ");
@@ -334,6 +340,11 @@ int expression_evaluate(EVAL_EXPRESSION *expression) {
 void expression_free(EVAL_EXPRESSION *expression) {
     if(!expression) return;
 
+    expression_free_variable_bindings(expression);
+    for(size_t i = 0; i < expression->variables.used ;i++)
+        string_freez(expression->variables.array[i].name);
+    freez(expression->variables.array);
+
     if(expression->nodes) eval_node_free(expression->nodes);
     string_freez((void *)expression->source);
     string_freez((void *)expression->parsed_as);
@@ -17,9 +17,17 @@ typedef enum __attribute__((packed)) {
 
 typedef struct eval_variable {
     STRING *name;
+    size_t slot;                        // the index of the variable in eval_expression.variables
     struct eval_variable *next;
 } EVAL_VARIABLE;
 
+// the distinct variables of an expression
+// all the references to the same variable share the same slot
+typedef struct eval_variable_slot {
+    STRING *name;
+    void *binding;                      // owned by the bound lookup callback
+} EVAL_VARIABLE_SLOT;
+
 typedef struct eval_value {
     EVAL_VALUE_TYPE type;
 
@@ -62,8 +70,15 @@ struct eval_expression {
 
     EVAL_NODE *nodes;
 
+    struct {
+        size_t used;
+        EVAL_VARIABLE_SLOT *array;
+    } variables;
+
     void *variable_lookup_cb_data;
     eval_expression_variable_lookup_t variable_lookup_cb;
+    eval_expression_variable_bound_lookup_t variable_bound_lookup_cb;
+    eval_expression_variable_binding_free_t variable_binding_free_cb;
 };
 
 // these are used for EVAL_NODE.operator
@@ -112,6 +127,7 @@ extern void print_parsed_as_variable(BUFFER *out, EVAL_VARIABLE *v, int *error);
 extern void print_parsed_as_constant(BUFFER *out, NETDATA_DOUBLE n);
 extern void print_parsed_as_value(BUFFER *out, EVAL_VALUE *v, int *error);
 extern void print_parsed_as_node(BUFFER *out, EVAL_NODE *op, int *error);
+extern void eval_expression_assign_variable_slots(EVAL_EXPRESSION *exp);
 
 // From eval-execute.c
 extern NETDATA_DOUBLE eval_node(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error);
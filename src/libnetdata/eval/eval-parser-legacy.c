@@ -881,6 +881,7 @@ EVAL_EXPRESSION *expression_parse(const char *string, const char **failed_at, in
 
     exp->error_msg = buffer_create(100, NULL);
     exp->nodes = op;
+    eval_expression_assign_variable_slots(exp);
 
     return exp;
 }
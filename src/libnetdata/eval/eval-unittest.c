@@ -1110,6 +1110,148 @@ static TestGroup test_groups[] = {
     {"Crash Tests", crash_tests, ARRAY_SIZE(crash_tests)},
 };
 
+// ----------------------------------------------------------------------------
+// Variable bindings tests
+
+// A mock of a caller that keeps the resolution of each variable in its binding,
+// and resolves the variables again when they change version (like health does).
+typedef struct {
+    size_t version;             // incremented when the variables change
+    bool late_var_defined;      // "late_var" is not defined at first
+    size_t resolutions;         // the lookups not answered by the bindings
+    size_t bindings_allocated;
+    size_t bindings_freed;
+} BindingsTestData;
+
+typedef struct {
+    size_t version;
+    bool found;
+    NETDATA_DOUBLE value;
+} BindingsTestBinding;
+
+static bool bindings_test_bound_lookup(STRING *variable, void **binding, void *data, NETDATA_DOUBLE *result) {
+    BindingsTestData *d = data;
+    BindingsTestBinding *b = *binding;
+
+    if (b && b->version == d->version) {
+        *result = b->value;
+        return b->found;
+    }
+
+    if (!b) {
+        b = *binding = callocz(1, sizeof(*b));
+        d->bindings_allocated++;
+    }
+
+    d->resolutions++;
+    b->version = d->version;
+    b->value = NAN;
+
+    if (strcmp(string2str(variable), "late_var") == 0) {
+        b->found = d->late_var_defined;
+        if (b->found)
+            b->value = 7.0;
+    }
+    else
+        b->found = test_variable_lookup(variable, NULL, &b->value);
+
+    *result = b->value;
+    return b->found;
+}
+
+static void bindings_test_binding_free(void *binding, void *data) {
+    BindingsTestData *d = data;
+    d->bindings_freed++;
+    freez(binding);
+}
+
+static int bindings_test_check(const char *name, bool ok) {
+    printf("  %s: %s\n", name, ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int eval_bindings_unittest(void) {
+    printf("\n=== Running Tests for variable bindings ===\n");
+
+    int failed = 0;
+    BindingsTestData d = { 0 };
+    const char *failed_at = NULL;
+    int error = 0;
+
+    // all the references to the same variable share a slot
+    EVAL_EXPRESSION *exp = expression_parse("$var1 + $var2 * ${var1} - $var1", &failed_at, &error);
+    if (!exp) {
+        printf("  cannot parse the expression: FAILED\n");
+        return 1;
+    }
+    expression_set_variable_bound_lookup_callback(exp, bindings_test_bound_lookup, bindings_test_binding_free, &d);
+
+    failed += bindings_test_check("distinct variables get a slot each", exp->variables.used == 2);
+
+    int ret = expression_evaluate(exp);
+    failed += bindings_test_check("first evaluation",
+                                  ret && fabs(exp->result - 1008.0) < 0.000001);
+    failed += bindings_test_check("first evaluation resolves each variable once",
+                                  d.resolutions == 2 && d.bindings_allocated == 2);
+
+    // following evaluations are answered by the bindings
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("second evaluation",
+                                  ret && fabs(exp->result - 1008.0) < 0.000001);
+    failed += bindings_test_check("second evaluation uses the bindings", d.resolutions == 2);
+
+    // freeing the bindings makes them resolve again
+    expression_free_variable_bindings(exp);
+    failed += bindings_test_check("expression_free_variable_bindings() frees all bindings",
+                                  d.bindings_freed == 2);
+
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("evaluation after freeing the bindings resolves again",
+                                  ret && fabs(exp->result - 1008.0) < 0.000001 &&
+                                  d.resolutions == 4 && d.bindings_allocated == 4);
+
+    // a version change makes them resolve again, keeping the same bindings
+    d.version++;
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("evaluation after a version change rebinds",
+                                  ret && fabs(exp->result - 1008.0) < 0.000001 &&
+                                  d.resolutions == 6 && d.bindings_allocated == 4);
+
+    expression_free(exp);
+    failed += bindings_test_check("expression_free() frees all bindings",
+                                  d.bindings_freed == d.bindings_allocated);
+
+    // a variable not found at first, is found when it is defined later
+    exp = expression_parse("$late_var + $var1", &failed_at, &error);
+    if (!exp) {
+        printf("  cannot parse the expression: FAILED\n");
+        return failed + 1;
+    }
+    expression_set_variable_bound_lookup_callback(exp, bindings_test_bound_lookup, bindings_test_binding_free, &d);
+
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("unresolved variable fails",
+                                  !ret && exp->error == EVAL_ERROR_UNKNOWN_VARIABLE);
+
+    size_t resolutions = d.resolutions;
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("unresolved variable stays unresolved while its version is the same",
+                                  !ret && exp->error == EVAL_ERROR_UNKNOWN_VARIABLE && d.resolutions == resolutions);
+
+    d.late_var_defined = true;
+    d.version++;
+    ret = expression_evaluate(exp);
+    failed += bindings_test_check("unresolved variable is picked up when it is defined",
+                                  ret && exp->error == EVAL_ERROR_OK && fabs(exp->result - 49.0) < 0.000001);
+
+    expression_free(exp);
+    failed += bindings_test_check("all bindings are freed",
+                                  d.bindings_freed == d.bindings_allocated);
+
+    printf("Variable bindings tests: %s\n", failed ? "FAILED" : "PASSED");
+    return failed;
+}
+
 int eval_hardcode_unittest(void);
 
 int eval_unittest(void) {
@@ -1206,6 +1348,9 @@ int eval_unittest(void) {
     printf("Passed: %d (%.1f%%)\n", total_passed, (float)total_passed / total_tests * 100);
     printf("Failed: %d (%.1f%%)\n", total_failed, (float)total_failed / total_tests * 100);
 
+    if(!total_failed && eval_bindings_unittest())
+        return 1;
+
     if(!total_failed)
         return eval_hardcode_unittest();
 
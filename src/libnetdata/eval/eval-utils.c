@@ -264,6 +264,75 @@ void expression_set_variable_lookup_callback(EVAL_EXPRESSION *expression, eval_e
     expression->variable_lookup_cb_data = data;
 }
 
+void expression_set_variable_bound_lookup_callback(EVAL_EXPRESSION *expression, eval_expression_variable_bound_lookup_t cb, eval_expression_variable_binding_free_t free_cb, void *data) {
+    if(!expression)
+        return;
+
+    expression_free_variable_bindings(expression);
+
+    expression->variable_bound_lookup_cb = cb;
+    expression->variable_binding_free_cb = free_cb;
+    expression->variable_lookup_cb_data = data;
+}
+
+void expression_free_variable_bindings(EVAL_EXPRESSION *expression) {
+    if(!expression)
+        return;
+
+    for(size_t i = 0; i < expression->variables.used ;i++) {
+        EVAL_VARIABLE_SLOT *vs = &expression->variables.array[i];
+        if(!vs->binding) continue;
+
+        if(expression->variable_binding_free_cb)
+            expression->variable_binding_free_cb(vs->binding, expression->variable_lookup_cb_data);
+
+        vs->binding = NULL;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// variable slots
+
+static void eval_node_assign_variable_slots(EVAL_EXPRESSION *exp, EVAL_NODE *node) {
+    if(!node) return;
+
+    for(int i = 0; i < node->count; i++) {
+        switch(node->ops[i].type) {
+            case EVAL_VALUE_VARIABLE: {
+                EVAL_VARIABLE *v = node->ops[i].variable;
+
+                size_t slot;
+                for(slot = 0; slot < exp->variables.used ;slot++)
+                    if(exp->variables.array[slot].name == v->name)
+                        break;
+
+                if(slot == exp->variables.used) {
+                    exp->variables.array = reallocz(exp->variables.array, sizeof(EVAL_VARIABLE_SLOT) * (exp->variables.used + 1));
+                    exp->variables.array[slot] = (EVAL_VARIABLE_SLOT) {
+                        .name = string_dup(v->name),
+                        .binding = NULL,
+                    };
+                    exp->variables.used++;
+                }
+
+                v->slot = slot;
+                break;
+            }
+
+            case EVAL_VALUE_EXPRESSION:
+                eval_node_assign_variable_slots(exp, node->ops[i].expression);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void eval_expression_assign_variable_slots(EVAL_EXPRESSION *exp) {
+    eval_node_assign_variable_slots(exp, exp->nodes);
+}
+
 static size_t expression_hardcode_node_variable(EVAL_NODE *node, STRING *variable, NETDATA_DOUBLE value) {
     size_t matches = 0;
 
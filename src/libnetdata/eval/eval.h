@@ -11,6 +11,12 @@ struct eval_expression;
 typedef struct eval_expression EVAL_EXPRESSION;
 typedef bool (*eval_expression_variable_lookup_t)(STRING *variable, void *data, NETDATA_DOUBLE *result);
 
+// like eval_expression_variable_lookup_t, but it also gets the binding of the variable in this expression,
+// so that the callback can keep the resolution of the variable between evaluations
+// (*binding is NULL the first time - the callback owns it and frees it with the binding free callback)
+typedef bool (*eval_expression_variable_bound_lookup_t)(STRING *variable, void **binding, void *data, NETDATA_DOUBLE *result);
+typedef void (*eval_expression_variable_binding_free_t)(void *binding, void *data);
+
 // parsing and evaluation
 #define EVAL_ERROR_OK                             0
 
@@ -50,6 +56,10 @@ const char *expression_parsed_as(EVAL_EXPRESSION *expression);
 const char *expression_error_msg(EVAL_EXPRESSION *expression);
 NETDATA_DOUBLE expression_result(EVAL_EXPRESSION *expression);
 void expression_set_variable_lookup_callback(EVAL_EXPRESSION *expression, eval_expression_variable_lookup_t cb, void *data);
+void expression_set_variable_bound_lookup_callback(EVAL_EXPRESSION *expression, eval_expression_variable_bound_lookup_t cb, eval_expression_variable_binding_free_t free_cb, void *data);
+
+// free the bindings of all the variables of the expression, so that they will be resolved again
+void expression_free_variable_bindings(EVAL_EXPRESSION *expression);
 
 void expression_hardcode_variable(EVAL_EXPRESSION *expression, STRING *variable, NETDATA_DOUBLE value);
 
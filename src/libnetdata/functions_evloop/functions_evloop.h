@@ -29,6 +29,15 @@
 #define PLUGINSD_KEYWORD_SET_V2                 "SET2"
 #define PLUGINSD_KEYWORD_END_V2                 "END2"
 
+// all the SET2 of a BEGIN2, delta-encoded against the previous ones, in one line
+// enabled with the streaming capability STREAM_CAP_DELTAS
+#define PLUGINSD_KEYWORD_SET_V2_BLOCK           "SET2B"
+
+// BEGIN, SET for all the dimension slots and END of a chart, in one line
+// external plugins find it in the NETDATA_PLUGINSD_EXTENSIONS environment variable
+#define PLUGINSD_KEYWORD_SET_BLOCK              "SETB"
+#define PLUGINSD_SET_BLOCK_EMPTY_VALUE          '.'
+
 // super high-speed versions of BEGIN, SET, END have this as first parameter
 // enabled with the streaming capability STREAM_CAP_SLOTS
 #define PLUGINSD_KEYWORD_SLOT                   "SLOT" // to change the length of this, update pluginsd_extract_chart_slot() too
@@ -81,6 +90,8 @@
 #define PLUGINSD_KEYWORD_JSON_END               "JSON_PAYLOAD_END"
 #define PLUGINSD_KEYWORD_JSON_CMD_STREAM_PATH   "STREAM_PATH"
 #define PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL      "ML_MODEL"
+#define PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL_PACKED "ML_MODEL_PACKED" // the payload is base64, not json
+#define PLUGINSD_KEYWORD_JSON_CMD_ZSTD_DICTIONARY "ZSTD_DICTIONARY"
 
 // trust BEGIN timestamps from the plugin
 #define PLUGINSD_KEYWORD_TRUST_DURATIONS        "TRUST_DURATIONS"
@@ -428,6 +428,109 @@ extern "C" {
     }
 }
 
+/*
+ * Batch decoding
+ *
+ * The values of a buffer are decoded in a tight loop, keeping the reader
+ * state in local variables and extracting bits from a 64-bit window of two
+ * consecutive words, instead of going through bit_buffer_read() once for
+ * every control bit and value.
+*/
+
+static inline uint64_t bit_buffer_peek(const uint32_t *buf, size_t nwords, size_t pos)
+{
+    const size_t index = pos / bit_size<uint32_t>();
+    const size_t offset = pos % bit_size<uint32_t>();
+
+    // the second word is loaded only when it exists, the writer
+    // does not always allocate a slot beyond the last one it used.
+    uint64_t window = buf[index];
+    if (index + 1 < nwords)
+        window |= static_cast<uint64_t>(buf[index + 1]) << bit_size<uint32_t>();
+
+    // at least 33 valid bits
+    return window >> offset;
+}
+
+static size_t gorilla_reader_read_buffer_batch(gorilla_reader_t *gr, uint32_t *numbers, size_t n)
+{
+    const uint32_t *data = gr->buffer->data;
+    const size_t nwords = (gr->capacity + bit_size<uint32_t>() - 1) / bit_size<uint32_t>();
+
+    size_t available = gr->entries - gr->index;
+    if (n > available)
+        n = available;
+
+    size_t i = 0;
+    size_t position = gr->position;
+    uint32_t prev_number = gr->prev_number;
+    uint32_t prev_xor_lzc = gr->prev_xor_lzc;
+    uint32_t prev_xor = gr->prev_xor;
+
+    if (n && gr->index == 0) {
+        prev_number = static_cast<uint32_t>(bit_buffer_peek(data, nwords, position));
+        position += bit_size<uint32_t>();
+        numbers[i++] = prev_number;
+    }
+
+    for ( ; i < n; i++) {
+        uint64_t window = bit_buffer_peek(data, nwords, position);
+
+        // same-number bit
+        if (window & 1) {
+            position++;
+            numbers[i] = prev_number;
+            continue;
+        }
+
+        // same-xor-lzc bit, followed by the new xor lzc when it is not the same
+        if (window & 2) {
+            position += 2;
+        } else {
+            prev_xor_lzc = static_cast<uint32_t>((window >> 2) & 0x1F);
+            position += 7;
+        }
+
+        // the non-lzc suffix of the xor value, 1 to 32 bits
+        const size_t nbits = bit_size<uint32_t>() - prev_xor_lzc;
+        window = bit_buffer_peek(data, nwords, position);
+        prev_xor = static_cast<uint32_t>(window & ((static_cast<uint64_t>(1) << nbits) - 1));
+        position += nbits;
+
+        prev_number ^= prev_xor;
+        numbers[i] = prev_number;
+    }
+
+    gr->index += n;
+    gr->position = position;
+    gr->prev_number = prev_number;
+    gr->prev_xor_lzc = prev_xor_lzc;
+    gr->prev_xor = prev_xor;
+
+    return n;
+}
+
+size_t gorilla_reader_read_batch(gorilla_reader_t *gr, uint32_t *numbers, size_t n)
+{
+    size_t decoded = 0;
+
+    while (decoded < n) {
+        if (gr->index >= gr->entries) {
+            // let the single value reader pick up new entries
+            // from the writer, or switch to the next buffer
+            if (!gorilla_reader_read(gr, &numbers[decoded]))
+                break;
+
+            decoded++;
+            continue;
+        }
+
+        decoded += gorilla_reader_read_buffer_batch(gr, &numbers[decoded], n - decoded);
+    }
+
+    return decoded;
+}
+
 extern "C" {
 struct aral;
 void aral_unmark_allocation(struct aral *ar, void *ptr);
@@ -452,6 +555,7 @@ void gorilla_writer_aral_unmark(const gorilla_writer_t *gw, struct aral *ar)
 
 #ifdef ENABLE_FUZZER
 
+#include <algorithm>
 #include <vector>
 
 template<typename Word>
@@ -533,6 +637,24 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
                 && "Read wrong number from gorilla buffer");
     }
 
+    /*
+     * read data in batches
+    */
+    gr = gorilla_writer_get_reader(&gw);
+
+    std::vector<uint32_t> DecodedData(RandomData.size(), 0);
+    for (size_t i = 0; i != RandomData.size(); ) {
+        size_t n = std::min<size_t>(RandomData.size() - i, 1 + (i % 67));
+        size_t decoded = gorilla_reader_read_batch(&gr, &DecodedData[i], n);
+        assert(decoded == n && "Failed to read a batch of numbers from gorilla buffer");
+        i += decoded;
+    }
+
+    for (size_t i = 0; i != RandomData.size(); i++) {
+        assert((DecodedData[i] == RandomData[i])
+                && "Read wrong number from gorilla buffer in batch");
+    }
+
     S.free_buffers();
     return 0;
 }
@@ -608,4 +730,36 @@ static void BM_DecodeU32Numbers(benchmark::State& state) {
 }
 BENCHMARK(BM_DecodeU32Numbers)->ThreadRange(1, 16)->UseRealTime();
 
+static void BM_DecodeU32NumbersBatch(benchmark::State& state) {
+    std::random_device rd;
+    std::mt19937 mt(rd());
+    std::uniform_int_distribution<uint32_t> dist(0x0, 0xFFFFFFFF);
+
+    std::vector<uint32_t> RandomData;
+    for (size_t idx = 0; idx != NumItems; idx++) {
+        RandomData.push_back(dist(mt));
+    }
+    std::vector<uint32_t> EncodedData(10 * RandomData.capacity(), 0);
+    std::vector<uint32_t> DecodedData(10 * RandomData.capacity(), 0);
+
+    gorilla_writer_t gw = gorilla_writer_init(
+        reinterpret_cast<gorilla_buffer_t *>(EncodedData.data()),
+        EncodedData.size());
+
+    for (size_t i = 0; i != RandomData.size(); i++)
+        gorilla_writer_write(&gw, RandomData[i]);
+
+    for (auto _ : state) {
+        gorilla_reader_t gr = gorilla_reader_init(reinterpret_cast<gorilla_buffer_t *>(EncodedData.data()));
+
+        benchmark::DoNotOptimize(gorilla_reader_read_batch(&gr, DecodedData.data(), RandomData.size()));
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(NumItems * state.iterations());
+    state.SetBytesProcessed(NumItems * state.iterations() * sizeof(uint32_t));
+}
+BENCHMARK(BM_DecodeU32NumbersBatch)->ThreadRange(1, 16)->UseRealTime();
+
 #endif /* ENABLE_BENCHMARK */
@@ -73,6 +73,9 @@ size_t gorilla_buffer_unpatched_nbytes(const gorilla_buffer_t *gbuf);
 gorilla_reader_t gorilla_reader_init(gorilla_buffer_t *buf);
 bool gorilla_reader_read(gorilla_reader_t *gr, uint32_t *number);
 
+// decode up to n numbers, returns the number of numbers decoded
+size_t gorilla_reader_read_batch(gorilla_reader_t *gr, uint32_t *numbers, size_t n);
+
 #define RRDENG_GORILLA_32BIT_SLOT_BYTES sizeof(uint32_t)
 #define RRDENG_GORILLA_32BIT_SLOT_BITS (RRDENG_GORILLA_32BIT_SLOT_BYTES * CHAR_BIT)
 #define RRDENG_GORILLA_32BIT_BUFFER_SLOTS 128
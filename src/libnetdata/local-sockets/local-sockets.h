@@ -751,7 +751,7 @@ static inline bool local_sockets_add_socket(LS_STATE *ls, LOCAL_SOCKET *tmp) {
     // --- look up a pid for it -----------------------------------------------------------------------------------
 
     SIMPLE_HASHTABLE_SLOT_PID_SOCKET *sl_pid = simple_hashtable_get_slot_PID_SOCKET(&ls->pid_sockets_hashtable, inode_hash, &n->inode, false);
-    struct pid_socket *ps = SIMPLE_HASHTABLE_SLOT_DATA(sl_pid);
+    struct pid_socket *ps = sl_pid ? SIMPLE_HASHTABLE_SLOT_DATA(sl_pid) : NULL;
     if(ps) {
         n->net_ns_inode = ps->net_ns_inode;
         n->pid = ps->pid;
@@ -1130,7 +1130,7 @@ static inline void local_sockets_detect_directions(LS_STATE *ls) {
             SIMPLE_HASHTABLE_SLOT_LISTENING_PORT *sl_port =
                 simple_hashtable_get_slot_LISTENING_PORT(&ls->listening_ports_hashtable, n->local_port_hash, &n->local_port_key, false);
 
-            struct local_port *port = SIMPLE_HASHTABLE_SLOT_DATA(sl_port); // do not reference this pointer - is invalid
+            struct local_port *port = sl_port ? SIMPLE_HASHTABLE_SLOT_DATA(sl_port) : NULL; // do not reference this pointer - is invalid
             if(port) {
                 // the local port of this socket is a port we listen to
                 n->direction &= ~SOCKET_DIRECTION_OUTBOUND;
@@ -1144,7 +1144,7 @@ static inline void local_sockets_detect_directions(LS_STATE *ls) {
             SIMPLE_HASHTABLE_SLOT_LOCAL_IP *sl_ip =
                 simple_hashtable_get_slot_LOCAL_IP(&ls->local_ips_hashtable, n->remote_ip_hash, &n->remote.ip, false);
 
-            union ipv46 *d = SIMPLE_HASHTABLE_SLOT_DATA(sl_ip);
+            union ipv46 *d = sl_ip ? SIMPLE_HASHTABLE_SLOT_DATA(sl_ip) : NULL;
             if (d) {
                 // the remote IP of this socket is one of our local IPs
                 if(n->direction & SOCKET_DIRECTION_INBOUND) {
@@ -69,7 +69,7 @@ DWORD RegistryFindIDByName(const char *name) {
     spinlock_lock(&names_globals.spinlock);
     XXH64_hash_t hash = XXH3_64bits((void *)name, strlen(name));
     SIMPLE_HASHTABLE_SLOT_PERFLIB *sl = simple_hashtable_get_slot_PERFLIB(&names_globals.hashtable, hash, name, false);
-    perfLibRegistryEntry *e = SIMPLE_HASHTABLE_SLOT_DATA(sl);
+    perfLibRegistryEntry *e = sl ? SIMPLE_HASHTABLE_SLOT_DATA(sl) : NULL;
     if(e) rc = e->id;
     spinlock_unlock(&names_globals.spinlock);
 
@@ -31,7 +31,7 @@ typedef uint64_t SIMPLE_HASHTABLE_HASH;
  *      The name of a function accepting SIMPLE_HASHTABLE_VALUE_TYPE pointer.
  *      It should return a pointer to SIMPLE_HASHTABLE_KEY_TYPE.
  *      This function is called prior to SIMPLE_HASHTABLE_COMPARE_KEYS_FUNCTION to extract the key from a value.
- *      It is also called during hashtable resize, to rehash all values in the hashtable.
+ *      The keys are not needed during hashtable resize, since all values in the hashtable are unique.
  *
  *    - SIMPLE_HASHTABLE_COMPARE_KEYS_FUNCTION
  *      The name of a function accepting 2x SIMPLE_HASHTABLE_KEY_TYPE pointers.
@@ -41,6 +41,10 @@ typedef uint64_t SIMPLE_HASHTABLE_HASH;
  * SIMPLE_HASHTABLE_SAMPLE_IMPLEMENTATION
  * If defined, 3x functions will be injected for easily working with the hashtable.
  *
+ * SIMPLE_HASHTABLE_WITHOUT_STATISTICS
+ * If defined, searches and collisions are not counted, so that lookups do not write to the hashtable
+ * and can run concurrently under a read lock.
+ *
  */
 
 
@@ -92,6 +96,7 @@ static inline bool SIMPLE_HASHTABLE_COMPARE_KEYS_FUNCTION(SIMPLE_HASHTABLE_KEY_T
 #define simple_hashtable_resize_named CONCAT(simple_hashtable_resize, SIMPLE_HASHTABLE_NAME)
 #define simple_hashtable_can_use_slot_named CONCAT(simple_hashtable_keys_match, SIMPLE_HASHTABLE_NAME)
 #define simple_hashtable_get_slot_named CONCAT(simple_hashtable_get_slot, SIMPLE_HASHTABLE_NAME)
+#define simple_hashtable_get_empty_slot_named CONCAT(simple_hashtable_get_empty_slot, SIMPLE_HASHTABLE_NAME)
 #define simple_hashtable_del_slot_named CONCAT(simple_hashtable_del_slot, SIMPLE_HASHTABLE_NAME)
 #define simple_hashtable_set_slot_named CONCAT(simple_hashtable_set_slot, SIMPLE_HASHTABLE_NAME)
 #define simple_hashtable_first_read_only_named CONCAT(simple_hashtable_first_read_only, SIMPLE_HASHTABLE_NAME)
@@ -307,15 +312,29 @@ static inline bool simple_hashtable_can_use_slot_named(
 
 #define SIMPLE_HASHTABLE_NEEDS_RESIZE(ht) ((ht)->size <= ((ht)->used - (ht)->deleted) << 1 || (ht)->used >= (ht)->size)
 
+// slots used or deleted, above which an insertion resizes (or cleans up) the hashtable first
+// this keeps unset slots in the hashtable, so that lookups for missing keys terminate early
+#define SIMPLE_HASHTABLE_NEEDS_RESIZE_BEFORE_INSERT(ht) (((ht)->used + 1) * 4 > (ht)->size * 3)
+
+#ifdef SIMPLE_HASHTABLE_WITHOUT_STATISTICS
+#define SIMPLE_HASHTABLE_STATS_PLUS(ht, member, n) do { ; } while(0)
+#else
+#define SIMPLE_HASHTABLE_STATS_PLUS(ht, member, n) (ht)->member += (n)
+#endif
+
 // IMPORTANT: the pointer returned by this call is valid up to the next call of this function (or the resize one).
 // If you need to cache something, cache the hash, not the slot pointer.
+// When resize is false, it returns NULL if the key is not found in a full hashtable.
 static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
         SIMPLE_HASHTABLE_NAMED *ht, SIMPLE_HASHTABLE_HASH hash,
         SIMPLE_HASHTABLE_KEY_TYPE *key, bool resize) {
 
     // This function finds the requested hash and key in the hashtable.
     // It uses a second version of the hash in case of collisions, and then linear probing.
-    // It may resize the hashtable if it is more than 50% full.
+    // When resize is true, it may resize the hashtable if it is more than 50% full,
+    // and it always keeps a quarter of the slots unset.
+    // When resize is false, it does not write to the hashtable, and when the key is
+    // not found in a full hashtable, it returns NULL.
 
     // Deleted items remain in the hashtable, but they are marked as DELETED.
     // Reuse of DELETED slots happens only if the slot to be returned is UNSET.
@@ -323,7 +342,10 @@ static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
     // slots are occupied. If the item to be returned is UNSET, and it has
     // encountered a DELETED slot, it returns the DELETED one instead of the UNSET.
 
-    ht->searches++;
+    SIMPLE_HASHTABLE_STATS_PLUS(ht, searches, 1);
+
+    if(unlikely(resize && SIMPLE_HASHTABLE_NEEDS_RESIZE_BEFORE_INSERT(ht)))
+        simple_hashtable_resize_named(ht);
 
     size_t slot;
     SIMPLE_HASHTABLE_SLOT_NAMED *sl;
@@ -335,7 +357,7 @@ static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
     if(likely(simple_hashtable_can_use_slot_named(sl, hash, key)))
         return (simple_hashtable_is_slot_unset(sl) && deleted) ? deleted : sl;
 
-    ht->collisions++;
+    SIMPLE_HASHTABLE_STATS_PLUS(ht, collisions, 1);
 
     if(unlikely(resize && (ht->needs_cleanup || SIMPLE_HASHTABLE_NEEDS_RESIZE(ht)))) {
         simple_hashtable_resize_named(ht);
@@ -346,7 +368,7 @@ static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
         if(likely(simple_hashtable_can_use_slot_named(sl, hash, key)))
             return sl;
 
-        ht->collisions++;
+        SIMPLE_HASHTABLE_STATS_PLUS(ht, collisions, 1);
     }
 
     slot = ((hash >> SIMPLE_HASHTABLE_HASH_SECOND_HASH_SHIFTS) + 1) % ht->size;
@@ -355,12 +377,12 @@ static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
 
     // Linear probing until we find it
     SIMPLE_HASHTABLE_SLOT_NAMED *sl_started = sl;
-    size_t collisions_started = ht->collisions;
+    size_t probes = 0;
     while (!simple_hashtable_can_use_slot_named(sl, hash, key)) {
         slot = (slot + 1) % ht->size;  // Wrap around if necessary
         sl = &ht->hashtable[slot];
         deleted = (!deleted && simple_hashtable_is_slot_deleted(sl)) ? sl : deleted;
-        ht->collisions++;
+        probes++;
 
         if(sl == sl_started) {
             if(deleted) {
@@ -376,13 +398,16 @@ static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_slot_named(
             }
             else {
                 // the hashtable is full, but resize is false.
-                // this should never happen.
-                assert(sl != sl_started);
+                // the key is not in it, and there is no slot to return.
+                return NULL;
             }
         }
     }
 
-    if((ht->collisions - collisions_started) > (ht->size / 2) && ht->deleted >= (ht->size / 3)) {
+    SIMPLE_HASHTABLE_STATS_PLUS(ht, collisions, probes);
+
+    // lookups without resize may run concurrently, so only the writers mark it
+    if(resize && probes > (ht->size / 2) && ht->deleted >= (ht->size / 3)) {
         // we traversed through half of the hashtable to find a slot,
         // but we have more than 1/3 deleted items
         ht->needs_cleanup = true;
@@ -453,6 +478,25 @@ static inline void simple_hashtable_set_slot_named(
     ht->additions++;
 }
 
+// find the slot a rehashed value should be placed at
+// it follows the same probing sequence as simple_hashtable_get_slot_named(),
+// but since all the values in the hashtable are unique, it does not need to compare any keys
+static inline SIMPLE_HASHTABLE_SLOT_NAMED *simple_hashtable_get_empty_slot_named(SIMPLE_HASHTABLE_NAMED *ht, SIMPLE_HASHTABLE_HASH hash) {
+    size_t slot = hash % ht->size;
+    SIMPLE_HASHTABLE_SLOT_NAMED *sl = &ht->hashtable[slot];
+    if(likely(simple_hashtable_is_slot_unset(sl)))
+        return sl;
+
+    slot = ((hash >> SIMPLE_HASHTABLE_HASH_SECOND_HASH_SHIFTS) + 1) % ht->size;
+    sl = &ht->hashtable[slot];
+    while(!simple_hashtable_is_slot_unset(sl)) {
+        slot = (slot + 1) % ht->size;
+        sl = &ht->hashtable[slot];
+    }
+
+    return sl;
+}
+
 // IMPORTANT
 // this call invalidates all SIMPLE_HASHTABLE_SLOT_NAMED pointers
 static inline void simple_hashtable_resize_named(SIMPLE_HASHTABLE_NAMED *ht) {
@@ -473,14 +517,7 @@ static inline void simple_hashtable_resize_named(SIMPLE_HASHTABLE_NAMED *ht) {
         if(simple_hashtable_is_slot_unset(slot) || simple_hashtable_is_slot_deleted(slot))
             continue;
 
-        SIMPLE_HASHTABLE_KEY_TYPE *key = NULL;
-
-#if defined(SIMPLE_HASHTABLE_COMPARE_KEYS_FUNCTION) && defined(SIMPLE_HASHTABLE_VALUE2KEY_FUNCTION)
-        SIMPLE_HASHTABLE_VALUE_TYPE value = SIMPLE_HASHTABLE_SLOT_DATA(slot);
-        key = SIMPLE_HASHTABLE_VALUE2KEY_FUNCTION(value);
-#endif
-
-        SIMPLE_HASHTABLE_SLOT_NAMED *slot2 = simple_hashtable_get_slot_named(ht, slot->hash, key, false);
+        SIMPLE_HASHTABLE_SLOT_NAMED *slot2 = simple_hashtable_get_empty_slot_named(ht, slot->hash);
         *slot2 = *slot;
         used++;
     }
@@ -14,6 +14,7 @@
 #undef simple_hashtable_resize_named
 #undef simple_hashtable_can_use_slot_named
 #undef simple_hashtable_get_slot_named
+#undef simple_hashtable_get_empty_slot_named
 #undef simple_hashtable_del_slot_named
 #undef simple_hashtable_set_slot_named
 #undef simple_hashtable_first_read_only_named
@@ -25,7 +26,10 @@
 #undef simple_hashtable_sorted_array_first_read_only_named
 #undef simple_hashtable_sorted_array_next_read_only_named
 
+#undef SIMPLE_HASHTABLE_STATS_PLUS
+
 #undef SIMPLE_HASHTABLE_SAMPLE_IMPLEMENTATION
+#undef SIMPLE_HASHTABLE_WITHOUT_STATISTICS
 #undef SIMPLE_HASHTABLE_SORT_FUNCTION
 #undef SIMPLE_HASHTABLE_VALUE_TYPE
 #undef SIMPLE_HASHTABLE_VALUE_TYPE_IS_NOT_POINTER
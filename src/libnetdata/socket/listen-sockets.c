@@ -117,7 +117,7 @@ static int create_listen_socket_unix(const char *path, int listen_backlog) {
     return sock;
 }
 
-static int create_listen_socket4(int socktype, const char *ip, uint16_t port, int listen_backlog) {
+static int create_listen_socket4(int socktype, const char *ip, uint16_t port, int listen_backlog, bool reuse_port) {
     int sock;
 
     sock = socket(AF_INET, socktype | DEFAULT_SOCKET_FLAGS, 0);
@@ -134,7 +134,13 @@ static int create_listen_socket4(int socktype, const char *ip, uint16_t port, in
                "LISTENER: IPv4 socket on ip '%s' port %d, socktype %d failed to enable reuse address.",
                ip, port, socktype);
 
-    if(sock_setreuse_port(sock, false) == 1) // -1 means not supported
+    if(reuse_port) {
+        if(sock_setreuse_port(sock, true) != 1)
+            nd_log(NDLS_DAEMON, NDLP_ERR,
+                   "LISTENER: IPv4 socket on ip '%s' port %d, socktype %d failed to enable reuse port.",
+                   ip, port, socktype);
+    }
+    else if(sock_setreuse_port(sock, false) == 1) // -1 means not supported
         nd_log(NDLS_DAEMON, NDLP_ERR,
                "LISTENER: IPv4 socket on ip '%s' port %d, socktype %d failed to disable reuse port.",
                ip, port, socktype);
@@ -191,7 +197,7 @@ static int create_listen_socket4(int socktype, const char *ip, uint16_t port, in
     return sock;
 }
 
-static int create_listen_socket6(int socktype, uint32_t scope_id, const char *ip, int port, int listen_backlog) {
+static int create_listen_socket6(int socktype, uint32_t scope_id, const char *ip, int port, int listen_backlog, bool reuse_port) {
     int sock;
     int ipv6only = 1;
 
@@ -209,7 +215,13 @@ static int create_listen_socket6(int socktype, uint32_t scope_id, const char *ip
                "LISTENER: IPv6 socket on ip '%s' port %d, socktype %d failed to set reuse address.",
                ip, port, socktype);
 
-    if(sock_setreuse_port(sock, false) == 1) // -1 means not supported
+    if(reuse_port) {
+        if(sock_setreuse_port(sock, true) != 1)
+            nd_log(NDLS_DAEMON, NDLP_ERR,
+                   "LISTENER: IPv6 socket on ip '%s' port %d, socktype %d failed to enable reuse port.",
+                   ip, port, socktype);
+    }
+    else if(sock_setreuse_port(sock, false) == 1) // -1 means not supported
         nd_log(NDLS_DAEMON, NDLP_ERR,
                "LISTENER: IPv6 socket on ip '%s' port %d, socktype %d failed to disable reuse port.",
                ip, port, socktype);
@@ -448,6 +460,8 @@ static inline int bind_to_this(LISTEN_SOCKETS *sockets, const char *definition,
     if(!*ip || *ip == '*' || !strcmp(ip, "any") || !strcmp(ip, "all"))
         ip = NULL;
 
+    bool reuse_port = (socktype == SOCK_DGRAM && sockets->reuse_port_udp);
+
     if(!*port)
         port = buffer2;
 
@@ -482,7 +496,7 @@ static inline int bind_to_this(LISTEN_SOCKETS *sockets, const char *definition,
                 struct sockaddr_in *sin = (struct sockaddr_in *) rp->ai_addr;
                 inet_ntop(AF_INET, &sin->sin_addr, rip, INET_ADDRSTRLEN);
                 rport = ntohs(sin->sin_port);
-                fd = create_listen_socket4(socktype, rip, rport, listen_backlog);
+                fd = create_listen_socket4(socktype, rip, rport, listen_backlog, reuse_port);
                 break;
             }
 
@@ -490,7 +504,7 @@ static inline int bind_to_this(LISTEN_SOCKETS *sockets, const char *definition,
                 struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) rp->ai_addr;
                 inet_ntop(AF_INET6, &sin6->sin6_addr, rip, INET6_ADDRSTRLEN);
                 rport = ntohs(sin6->sin6_port);
-                fd = create_listen_socket6(socktype, scope_id, rip, rport, listen_backlog);
+                fd = create_listen_socket6(socktype, scope_id, rip, rport, listen_backlog, reuse_port);
                 break;
             }
 
@@ -566,3 +580,99 @@ int listen_sockets_setup(LISTEN_SOCKETS *sockets) {
 
     return (int)sockets->opened;
 }
+
+static int clone_listen_socket_udp(int src_fd, int family, const char *name) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+
+    if(getsockname(src_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: getsockname() on socket %s failed.",
+               name);
+
+        return -1;
+    }
+
+    int sock = socket(family, SOCK_DGRAM | DEFAULT_SOCKET_FLAGS, 0);
+    if(sock < 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: socket() for a clone of %s failed.",
+               name);
+
+        return -1;
+    }
+
+    if(sock_setreuse_addr(sock, true) != 1)
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: clone of %s failed to enable reuse address.",
+               name);
+
+    // without reuse port, the bind() below fails
+    if(sock_setreuse_port(sock, true) != 1) {
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: clone of %s failed to enable reuse port.",
+               name);
+
+        close(sock);
+        return -1;
+    }
+
+    if(sock_setnonblock(sock, true) != 1)
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: clone of %s failed to set non-blocking mode.",
+               name);
+
+    sock_setcloexec(sock, true);
+    sock_enlarge_rcv_buf(sock);
+
+    if(family == AF_INET6) {
+        int ipv6only = 1;
+        if(setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (void*)&ipv6only, sizeof(ipv6only)) != 0)
+            nd_log(NDLS_DAEMON, NDLP_ERR,
+                   "LISTENER: Cannot set IPV6_V6ONLY on clone of %s.",
+                   name);
+    }
+
+    if(bind(sock, (struct sockaddr *)&addr, addr_len) < 0) {
+        close(sock);
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "LISTENER: bind() of clone of %s failed.",
+               name);
+
+        return -1;
+    }
+
+    return sock;
+}
+
+int listen_sockets_clone_udp(LISTEN_SOCKETS *dst, LISTEN_SOCKETS *src) {
+    listen_sockets_init(dst);
+
+    dst->config = src->config;
+    dst->config_section = src->config_section;
+    dst->default_bind_to = src->default_bind_to;
+    dst->default_port = src->default_port;
+    dst->backlog = src->backlog;
+    dst->reuse_port_udp = true;
+
+    for(size_t i = 0; i < src->opened && dst->opened < MAX_LISTEN_FDS ;i++) {
+        if(src->fds_types[i] != SOCK_DGRAM)
+            continue;
+
+        const char *name = src->fds_names[i] ? src->fds_names[i] : "UNKNOWN";
+        int fd = clone_listen_socket_udp(src->fds[i], src->fds_families[i], name);
+        if(fd == -1) {
+            dst->failed++;
+            continue;
+        }
+
+        dst->fds[dst->opened] = fd;
+        dst->fds_types[dst->opened] = SOCK_DGRAM;
+        dst->fds_families[dst->opened] = src->fds_families[i];
+        dst->fds_names[dst->opened] = strdupz(name);
+        dst->fds_acl_flags[dst->opened] = src->fds_acl_flags[i];
+        dst->opened++;
+    }
+
+    return (int)dst->opened;
+}
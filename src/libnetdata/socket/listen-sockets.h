@@ -15,6 +15,7 @@ typedef struct listen_sockets {
     const char *default_bind_to;        // the default bind to configuration string
     uint16_t default_port;              // the default port to use
     int backlog;                        // the default listen backlog to use
+    bool reuse_port_udp;                // set SO_REUSEPORT on UDP sockets, so that they can be cloned
 
     size_t opened;                      // the number of sockets opened
     size_t failed;                      // the number of sockets attempted to open, but failed
@@ -28,4 +29,9 @@ typedef struct listen_sockets {
 int listen_sockets_setup(LISTEN_SOCKETS *sockets);
 void listen_sockets_close(LISTEN_SOCKETS *sockets);
 
+// open another socket bound with SO_REUSEPORT to the same address of each UDP socket of src,
+// so that the kernel distributes the incoming datagrams among them
+// src must have been set up with reuse_port_udp - returns the number of sockets opened in dst
+int listen_sockets_clone_udp(LISTEN_SOCKETS *dst, LISTEN_SOCKETS *src);
+
 #endif //NETDATA_LISTEN_SOCKETS_H
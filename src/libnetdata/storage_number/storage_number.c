@@ -169,3 +169,60 @@ __attribute__((constructor)) void initialize_lut(void) {
         unpack_storage_number_lut10x[3 * 8 + i] = pow(100, i);       // exp = 1
     }
 }
+
+// ----------------------------------------------------------------------------
+// batch unpacking
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(NETDATA_WITH_LONG_DOUBLE)
+#define UNPACK_STORAGE_NUMBERS_AVX2 1
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void unpack_storage_numbers_avx2(const storage_number *src, NETDATA_DOUBLE *dst, size_t n) {
+    const __m128i empty_slot = _mm_set1_epi32((int)SN_EMPTY_SLOT);
+    const __m128i value_mask = _mm_set1_epi32(0x00ffffff);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i seven = _mm_set1_epi32(7);
+    const __m256d nan = _mm256_set1_pd(NAN);
+
+    size_t i = 0;
+    for(; i + 4 <= n ; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+
+        // the lookup table index is (factor * 16) + (exp * 8) + mul
+        __m128i factor = _mm_and_si128(_mm_srli_epi32(v, 26), one);
+        __m128i exp = _mm_and_si128(_mm_srli_epi32(v, 30), one);
+        __m128i mul = _mm_and_si128(_mm_srli_epi32(v, 27), seven);
+        __m128i idx = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(factor, 4), _mm_slli_epi32(exp, 3)), mul);
+        __m256d lut = _mm256_i32gather_pd(unpack_storage_number_lut10x, idx, sizeof(NETDATA_DOUBLE));
+
+        // negating the multiplier is identical to multiplying it by -1
+        __m256i sign = _mm256_slli_epi64(_mm256_srli_epi64(_mm256_cvtepu32_epi64(v), 31), 63);
+        lut = _mm256_xor_pd(lut, _mm256_castsi256_pd(sign));
+
+        __m256d value = _mm256_mul_pd(lut, _mm256_cvtepi32_pd(_mm_and_si128(v, value_mask)));
+
+        __m256d is_empty = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(v, empty_slot)));
+        _mm256_storeu_pd(&dst[i], _mm256_blendv_pd(value, nan, is_empty));
+    }
+
+    for(; i < n ; i++)
+        dst[i] = unpack_storage_number(src[i]);
+}
+#endif
+
+void unpack_storage_numbers(const storage_number *src, NETDATA_DOUBLE *dst, size_t n) {
+#ifdef UNPACK_STORAGE_NUMBERS_AVX2
+    static int avx2 = -1;
+    if(unlikely(avx2 == -1))
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    if(avx2) {
+        unpack_storage_numbers_avx2(src, dst, n);
+        return;
+    }
+#endif
+
+    for(size_t i = 0; i < n ; i++)
+        dst[i] = unpack_storage_number(src[i]);
+}
@@ -168,6 +168,9 @@ static NETDATA_DOUBLE unpack_storage_number(storage_number value) {
     return sign * unpack_storage_number_lut10x[(factor * 16) + (exp * 8) + mul] * n;
 }
 
+// unpack an array of storage numbers, identical to calling unpack_storage_number() on each of them
+void unpack_storage_numbers(const storage_number *src, NETDATA_DOUBLE *dst, size_t n);
+
 // all these prefixes should use characters that are not allowed in the numbers they represent
 #define HEX_PREFIX "0x"               // we check 2 characters when parsing
 #define IEEE754_UINT64_B64_PREFIX "#" // we check the 1st character during parsing
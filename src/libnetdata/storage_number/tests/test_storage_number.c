@@ -42,10 +42,36 @@ static void test_number_printing(void **state)
     assert_string_equal(value, "16.77722");
 }
 
+static void test_unpack_storage_numbers(void **state)
+{
+    (void)state;
+
+    storage_number src[1027];
+    NETDATA_DOUBLE dst[1027];
+
+    uint32_t seed = 1;
+    for(size_t i = 0; i < sizeof(src) / sizeof(src[0]) ; i++) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (i % 17 == 0) ? SN_EMPTY_SLOT : seed ^ (seed << 7);
+    }
+
+    unpack_storage_numbers(src, dst, sizeof(src) / sizeof(src[0]));
+
+    for(size_t i = 0; i < sizeof(src) / sizeof(src[0]) ; i++) {
+        NETDATA_DOUBLE n = unpack_storage_number(src[i]);
+
+        if(isnan(n))
+            assert_true(isnan(dst[i]));
+        else
+            assert_memory_equal(&n, &dst[i], sizeof(n));
+    }
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
-        cmocka_unit_test(test_number_printing)
+        cmocka_unit_test(test_number_printing),
+        cmocka_unit_test(test_unpack_storage_numbers)
     };
 
     return cmocka_run_group_tests_name("storage_number", tests, NULL, NULL);
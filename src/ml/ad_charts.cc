@@ -618,6 +618,52 @@ void ml_update_training_statistics_chart(ml_worker_t *worker, const ml_queue_sta
 
         rrdset_done(worker->training_results_rs);
     }
+
+    /*
+     * k-means training stats
+    */
+    {
+        if (!worker->training_kmeans_rs) {
+            char id_buf[1024];
+            char name_buf[1024];
+
+            snprintfz(id_buf, 1024, "training_queue_%zu_kmeans", worker->id);
+            snprintfz(name_buf, 1024, "training_queue_%zu_kmeans", worker->id);
+
+            worker->training_kmeans_rs = rrdset_create(
+                    localhost,
+                    "netdata", // type
+                    id_buf, // id
+                    name_buf, // name
+                    NETDATA_ML_CHART_FAMILY, // family
+                    "netdata.ml_training_kmeans", // ctx
+                    "K-means training", // title
+                    "models", // units
+                    NETDATA_ML_PLUGIN, // plugin
+                    NETDATA_ML_MODULE_TRAINING, // module
+                    NETDATA_ML_CHART_PRIO_TRAINING_KMEANS, // priority
+                    localhost->rrd_update_every, // update_every
+                    RRDSET_TYPE_LINE// chart_type
+            );
+            rrdset_flag_set(worker->training_kmeans_rs, RRDSET_FLAG_ANOMALY_DETECTION);
+
+            worker->training_kmeans_full_rd =
+                rrddim_add(worker->training_kmeans_rs, "full", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            worker->training_kmeans_warm_start_rd =
+                rrddim_add(worker->training_kmeans_rs, "warm-start", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            worker->training_kmeans_drift_detected_rd =
+                rrddim_add(worker->training_kmeans_rs, "drift-detected", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+
+        rrddim_set_by_pointer(worker->training_kmeans_rs,
+                              worker->training_kmeans_full_rd, stats.item_kmeans_full);
+        rrddim_set_by_pointer(worker->training_kmeans_rs,
+                              worker->training_kmeans_warm_start_rd, stats.item_kmeans_warm_start);
+        rrddim_set_by_pointer(worker->training_kmeans_rs,
+                              worker->training_kmeans_drift_detected_rd, stats.item_kmeans_drift_detected);
+
+        rrdset_done(worker->training_kmeans_rs);
+    }
 }
 
 void ml_update_global_statistics_charts(uint64_t models_consulted,
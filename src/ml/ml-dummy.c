@@ -131,8 +131,18 @@ bool ml_model_received_from_child(RRDHOST *host, const char *json) {
     return false;
 }
 
+bool ml_model_packed_received_from_child(RRDHOST *host, const char *encoded) {
+    UNUSED(host);
+    UNUSED(encoded);
+    return false;
+}
+
  void ml_host_disconnected(RRDHOST *rh) {
      UNUSED(rh);
 }
 
+int ml_unittest(void) {
+    return 0;
+}
+
 #endif
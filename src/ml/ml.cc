@@ -6,6 +6,7 @@
 
 #include "ad_charts.h"
 #include "database/sqlite/vendored/sqlite3.h"
+#include "database/sqlite/sqlite_db_migration.h"
 #include "streaming/stream-control.h"
 
 #define WORKER_TRAIN_QUEUE_POP         0
@@ -48,8 +49,10 @@ typedef struct {
     size_t total_values;
 } ml_training_response_t;
 
+// when since is set, query only the values after it (and the few before it
+// needed to extract the features of the first one)
 static std::pair<enum ml_worker_result, ml_training_response_t>
-ml_dimension_calculated_numbers(ml_worker_t *worker, ml_dimension_t *dim)
+ml_dimension_calculated_numbers(ml_worker_t *worker, ml_dimension_t *dim, time_t since)
 {
     ml_training_response_t training_response = {};
 
@@ -81,6 +84,12 @@ ml_dimension_calculated_numbers(ml_worker_t *worker, ml_dimension_t *dim)
         training_response.first_entry_on_response
     );
 
+    if (since) {
+        time_t context_t = (time_t) (min_required_samples * chart_update_every);
+        if (since - context_t > training_response.query_after_t)
+            training_response.query_after_t = since - context_t;
+    }
+
     if (training_response.query_after_t >= training_response.query_before_t) {
         return { ML_WORKER_RESULT_INVALID_QUERY_TIME_RANGE, training_response };
     }
@@ -146,45 +155,44 @@ ml_dimension_calculated_numbers(ml_worker_t *worker, ml_dimension_t *dim)
     return { ML_WORKER_RESULT_OK, training_response };
 }
 
+// the model is packed with ml_kmeans_pack()
 const char *db_models_create_table =
-    "CREATE TABLE IF NOT EXISTS models("
-    "    dim_id BLOB, after INT, before INT,"
-    "    min_dist REAL, max_dist REAL,"
-    "    c00 REAL, c01 REAL, c02 REAL, c03 REAL, c04 REAL, c05 REAL,"
-    "    c10 REAL, c11 REAL, c12 REAL, c13 REAL, c14 REAL, c15 REAL,"
+    "CREATE TABLE IF NOT EXISTS models_v2("
+    "    dim_id BLOB, after INT, before INT, model BLOB,"
     "    PRIMARY KEY(dim_id, after)"
     ");";
 
 const char *db_models_add_model =
-    "INSERT OR REPLACE INTO models("
-    "    dim_id, after, before,"
-    "    min_dist, max_dist,"
-    "    c00, c01, c02, c03, c04, c05,"
-    "    c10, c11, c12, c13, c14, c15)"
-    "VALUES("
-    "    @dim_id, @after, @before,"
-    "    @min_dist, @max_dist,"
-    "    @c00, @c01, @c02, @c03, @c04, @c05,"
-    "    @c10, @c11, @c12, @c13, @c14, @c15);";
+    "INSERT OR REPLACE INTO models_v2(dim_id, after, before, model) "
+    "VALUES(@dim_id, @after, @before, @model);";
 
 const char *db_models_load =
-    "SELECT * FROM models "
+    "SELECT model FROM models_v2 "
     "WHERE dim_id = @dim_id AND after >= @after ORDER BY before ASC;";
 
 const char *db_models_delete =
-    "DELETE FROM models "
+    "DELETE FROM models_v2 "
     "WHERE dim_id = @dim_id AND before < @before;";
 
 const char *db_models_prune =
-    "DELETE FROM models "
+    "DELETE FROM models_v2 "
     "WHERE after < @after LIMIT @n;";
 
+// the models table before the packed format, one column per value
+const char *db_models_legacy_load =
+    "SELECT dim_id, after, before, min_dist, max_dist,"
+    "       c00, c01, c02, c03, c04, c05,"
+    "       c10, c11, c12, c13, c14, c15 "
+    "FROM models;";
+
 static int
 ml_dimension_add_model(const nd_uuid_t *metric_uuid, const ml_kmeans_inlined_t *inlined_km)
 {
     static __thread sqlite3_stmt *res = NULL;
     int param = 0;
     int rc = 0;
+    uint8_t packed[ML_KMEANS_PACKED_MAX_SIZE];
+    size_t packed_size;
 
     if (unlikely(!ml_db)) {
         nd_log_limit_static_global_var(erl, 1, 0);
@@ -212,26 +220,11 @@ ml_dimension_add_model(const nd_uuid_t *metric_uuid, const ml_kmeans_inlined_t *
     if (unlikely(rc != SQLITE_OK))
         goto bind_fail;
 
-    rc = sqlite3_bind_double(res, ++param, inlined_km->min_dist);
-    if (unlikely(rc != SQLITE_OK))
-        goto bind_fail;
-
-    rc = sqlite3_bind_double(res, ++param, inlined_km->max_dist);
+    packed_size = ml_kmeans_pack(inlined_km, packed);
+    rc = sqlite3_bind_blob(res, ++param, packed, (int) packed_size, SQLITE_TRANSIENT);
     if (unlikely(rc != SQLITE_OK))
         goto bind_fail;
 
-    for (const DSample &ds : inlined_km->cluster_centers) {
-        if (ds.size() != 6)
-            fatal("Expected dsample with 6 dimensions, got %ld", ds.size());
-
-        for (long idx = 0; idx != ds.size(); idx++) {
-            calculated_number_t cn = ds(idx);
-            int rc = sqlite3_bind_double(res, ++param, cn);
-            if (unlikely(rc != SQLITE_OK))
-                goto bind_fail;
-        }
-    }
-
     rc = execute_insert(res);
     if (unlikely(rc != SQLITE_DONE)) {
         error_report("Failed to store model, rc = %d", rc);
@@ -358,6 +351,79 @@ bind_fail:
     return rc;
 }
 
+void ml_models_migrate_legacy_table(void)
+{
+    if (!ml_db || !table_exists_in_database(ml_db, "models"))
+        return;
+
+    sqlite3_stmt *load = NULL;
+    sqlite3_stmt *add = NULL;
+    size_t migrated = 0;
+
+    int rc = sqlite3_prepare_v2(ml_db, db_models_legacy_load, -1, &load, NULL);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(ml_db, db_models_add_model, -1, &add, NULL);
+    if (rc == SQLITE_OK)
+        rc = db_execute(ml_db, "BEGIN TRANSACTION;", NULL);
+
+    int step_rc = SQLITE_DONE;
+    while (rc == SQLITE_OK && (step_rc = sqlite3_step_monitored(load)) == SQLITE_ROW) {
+        const void *dim_id = sqlite3_column_blob(load, 0);
+        if (!dim_id || sqlite3_column_bytes(load, 0) != sizeof(nd_uuid_t))
+            continue;
+
+        ml_kmeans_inlined_t inlined_km;
+        inlined_km.after = sqlite3_column_int(load, 1);
+        inlined_km.before = sqlite3_column_int(load, 2);
+        inlined_km.min_dist = sqlite3_column_double(load, 3);
+        inlined_km.max_dist = sqlite3_column_double(load, 4);
+
+        int column = 5;
+        for (auto &cc : inlined_km.cluster_centers) {
+            cc.set_size(ML_KMEANS_PACKED_MAX_FEATURES);
+            for (size_t i = 0; i != ML_KMEANS_PACKED_MAX_FEATURES; i++)
+                cc(i) = sqlite3_column_double(load, column++);
+        }
+
+        uint8_t packed[ML_KMEANS_PACKED_MAX_SIZE];
+        size_t packed_size = ml_kmeans_pack(&inlined_km, packed);
+
+        int param = 0;
+        rc = sqlite3_bind_blob(add, ++param, dim_id, sizeof(nd_uuid_t), SQLITE_TRANSIENT);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(add, ++param, (int) inlined_km.after);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_int(add, ++param, (int) inlined_km.before);
+        if (rc == SQLITE_OK)
+            rc = sqlite3_bind_blob(add, ++param, packed, (int) packed_size, SQLITE_TRANSIENT);
+        if (rc == SQLITE_OK)
+            rc = (sqlite3_step_monitored(add) == SQLITE_DONE) ? SQLITE_OK : SQLITE_ERROR;
+
+        sqlite3_reset(add);
+        migrated++;
+    }
+
+    // drop the old table only when all of its rows have been read
+    if (rc == SQLITE_OK && step_rc != SQLITE_DONE)
+        rc = step_rc;
+
+    if (rc == SQLITE_OK)
+        rc = db_execute(ml_db, "DROP TABLE models;", NULL);
+
+    if (rc == SQLITE_OK)
+        rc = db_execute(ml_db, "COMMIT TRANSACTION;", NULL);
+    else
+        db_execute(ml_db, "ROLLBACK;", NULL);
+
+    sqlite3_finalize(load);
+    sqlite3_finalize(add);
+
+    if (rc == SQLITE_OK)
+        nd_log(NDLS_DAEMON, NDLP_INFO, "ML: converted %zu models to the packed format", migrated);
+    else
+        error_report("Failed to convert the ML models to the packed format, rc = %d", rc);
+}
+
 int ml_dimension_load_models(RRDDIM *rd, sqlite3_stmt **active_stmt) {
     ml_dimension_t *dim = (ml_dimension_t *) rd->ml_dimension;
     if (!dim)
@@ -405,36 +471,18 @@ int ml_dimension_load_models(RRDDIM *rd, sqlite3_stmt **active_stmt) {
 
     dim->km_contexts.reserve(Cfg.num_models_to_use);
     while ((rc = sqlite3_step_monitored(res)) == SQLITE_ROW) {
-        ml_kmeans_t km;
-
-        km.after = sqlite3_column_int(res, 2);
-        km.before = sqlite3_column_int(res, 3);
-
-        km.min_dist = sqlite3_column_int(res, 4);
-        km.max_dist = sqlite3_column_int(res, 5);
-
-        km.cluster_centers.resize(2);
-
-        km.cluster_centers[0].set_size(Cfg.lag_n + 1);
-        km.cluster_centers[0](0) = sqlite3_column_double(res, 6);
-        km.cluster_centers[0](1) = sqlite3_column_double(res, 7);
-        km.cluster_centers[0](2) = sqlite3_column_double(res, 8);
-        km.cluster_centers[0](3) = sqlite3_column_double(res, 9);
-        km.cluster_centers[0](4) = sqlite3_column_double(res, 10);
-        km.cluster_centers[0](5) = sqlite3_column_double(res, 11);
+        const uint8_t *packed = (const uint8_t *) sqlite3_column_blob(res, 0);
+        size_t packed_size = sqlite3_column_bytes(res, 0);
 
-        km.cluster_centers[1].set_size(Cfg.lag_n + 1);
-        km.cluster_centers[1](0) = sqlite3_column_double(res, 12);
-        km.cluster_centers[1](1) = sqlite3_column_double(res, 13);
-        km.cluster_centers[1](2) = sqlite3_column_double(res, 14);
-        km.cluster_centers[1](3) = sqlite3_column_double(res, 15);
-        km.cluster_centers[1](4) = sqlite3_column_double(res, 16);
-        km.cluster_centers[1](5) = sqlite3_column_double(res, 17);
+        ml_kmeans_inlined_t inlined_km;
+        if (!packed || !ml_kmeans_unpack(&inlined_km, packed, packed_size))
+            continue;
 
-        dim->km_contexts.emplace_back(km);
+        dim->km_contexts.emplace_back(inlined_km);
     }
 
     if (!dim->km_contexts.empty()) {
+        ml_kmeans_scorer_build(&dim->scorer, dim->km_contexts, Cfg.lag_n + 1);
         dim->ts = TRAINING_STATUS_TRAINED;
     }
 
@@ -477,6 +525,118 @@ static void ml_dimension_serialize_kmeans(const ml_dimension_t *dim, BUFFER *wb)
     buffer_json_finalize(wb);
 }
 
+// the packed model, followed by the NUL terminated machine guid, chart id and
+// dimension id, base64 encoded
+static void ml_dimension_serialize_kmeans_packed(const ml_dimension_t *dim, BUFFER *wb)
+{
+    RRDDIM *rd = dim->rd;
+
+    const char *strings[] = {
+        rd->rrdset->rrdhost->machine_guid,
+        rrdset_id(rd->rrdset),
+        rrddim_id(rd),
+    };
+
+    size_t lengths[3];
+    size_t packed_size = ml_kmeans_packed_size(&dim->km_contexts.back());
+    size_t size = packed_size;
+    for (size_t i = 0; i != 3; i++) {
+        lengths[i] = strlen(strings[i]) + 1;
+        size += lengths[i];
+    }
+
+    uint8_t *record = (uint8_t *) mallocz(size);
+    ml_kmeans_pack(&dim->km_contexts.back(), record);
+
+    uint8_t *s = &record[packed_size];
+    for (size_t i = 0; i != 3; i++) {
+        memcpy(s, strings[i], lengths[i]);
+        s += lengths[i];
+    }
+
+    buffer_need_bytes(wb, (size + 2) / 3 * 4 + 1);
+    wb->len += netdata_base64_encode((unsigned char *) &wb->buffer[wb->len], record, size);
+    buffer_need_bytes(wb, 1);
+    wb->buffer[wb->len] = '\0';
+
+    freez(record);
+}
+
+static bool ml_dimension_add_existing_model(const DimensionLookupInfo &DLI, const ml_kmeans_inlined_t &inlined_km)
+{
+    AcquiredDimension AcqDim(DLI);
+    if (!AcqDim.acquired())
+        return false;
+
+    ml_dimension_t *Dim = reinterpret_cast<ml_dimension_t *>(AcqDim.dimension());
+    if (!Dim) {
+        pulse_ml_models_ignored();
+        return true;
+    }
+
+    ml_queue_item_t item;
+    item.type = ML_QUEUE_ITEM_TYPE_ADD_EXISTING_MODEL;
+    item.add_existing_model = {
+        DLI, inlined_km
+    };
+    ml_queue_push(AcqDim.queue(), item);
+
+    return true;
+}
+
+bool
+ml_dimension_deserialize_kmeans_packed(const char *encoded)
+{
+    if (!encoded) {
+        netdata_log_error("Failed to deserialize packed kmeans: payload is null");
+        return false;
+    }
+
+    size_t encoded_len = strlen(encoded);
+    while (encoded_len && isspace((uint8_t) encoded[encoded_len - 1]))
+        encoded_len--;
+
+    if (!encoded_len || encoded_len > 8192) {
+        netdata_log_error("Failed to deserialize packed kmeans: invalid payload size %zu", encoded_len);
+        return false;
+    }
+
+    uint8_t record[8192 / 4 * 3 + 3];
+    int size = netdata_base64_decode(record, (const unsigned char *) encoded, (int) encoded_len);
+    if (size <= 0) {
+        netdata_log_error("Failed to deserialize packed kmeans: invalid base64 payload");
+        return false;
+    }
+
+    ml_kmeans_inlined_t inlined_km;
+    size_t packed_size = ml_kmeans_unpack(&inlined_km, record, size);
+    if (!packed_size)
+        return false;
+
+    // the machine guid, chart id and dimension id follow
+    std::array<const char *, 3> values;
+    const uint8_t *s = &record[packed_size];
+    const uint8_t *end = &record[size];
+    for (size_t i = 0; i != values.size(); i++) {
+        const uint8_t *nul = s < end ? (const uint8_t *) memchr(s, '\0', end - s) : NULL;
+        if (!nul) {
+            netdata_log_error("Failed to deserialize packed kmeans: missing dimension identifiers");
+            return false;
+        }
+
+        values[i] = (const char *) s;
+        s = nul + 1;
+    }
+
+    if (strlen(values[0]) != GUID_LEN) {
+        netdata_log_error("Failed to deserialize packed kmeans: invalid machine guid");
+        return false;
+    }
+
+    DimensionLookupInfo DLI(values[0], values[1], values[2]);
+    return ml_dimension_add_existing_model(DLI, inlined_km);
+}
+
 bool
 ml_dimension_deserialize_kmeans(const char *json_str)
 {
@@ -561,28 +721,10 @@ ml_dimension_deserialize_kmeans(const char *json_str)
         }
     }
 
-    AcquiredDimension AcqDim(DLI);
-    if (!AcqDim.acquired()) {
-        json_object_put(root);
-        return false;
-    }
-
-    ml_dimension_t *Dim = reinterpret_cast<ml_dimension_t *>(AcqDim.dimension());
-    if (!Dim) {
-        pulse_ml_models_ignored();
-        json_object_put(root);
-        return true;
-    }
-
-    ml_queue_item_t item;
-    item.type = ML_QUEUE_ITEM_TYPE_ADD_EXISTING_MODEL;
-    item.add_existing_model = {
-        DLI, inlined_km
-    };
-    ml_queue_push(AcqDim.queue(), item);
+    bool ok = ml_dimension_add_existing_model(DLI, inlined_km);
 
     json_object_put(root);
-    return true;
+    return ok;
 }
 
 static void ml_dimension_stream_kmeans(ml_worker_t *worker, const ml_dimension_t *dim)
@@ -596,16 +738,22 @@ static void ml_dimension_stream_kmeans(ml_worker_t *worker, const ml_dimension_t
         !rrddim_check_upstream_exposed(dim->rd))
         return;
 
+    bool packed = stream_sender_has_capabilities(dim->rd->rrdset->rrdhost, STREAM_CAP_ML_MODELS_PACKED);
+
     // Reuse worker's buffers instead of allocating new ones
     BUFFER *payload = worker->stream_payload_buffer;
     buffer_flush(payload);
-    ml_dimension_serialize_kmeans(dim, payload);
+    if (packed)
+        ml_dimension_serialize_kmeans_packed(dim, payload);
+    else
+        ml_dimension_serialize_kmeans(dim, payload);
 
     BUFFER *wb = worker->stream_wb_buffer;
     buffer_flush(wb);
 
     buffer_sprintf(
-        wb, PLUGINSD_KEYWORD_JSON " " PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL "\n%s\n" PLUGINSD_KEYWORD_JSON_END "\n",
+        wb, PLUGINSD_KEYWORD_JSON " %s\n%s\n" PLUGINSD_KEYWORD_JSON_END "\n",
+        packed ? PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL_PACKED : PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL,
         buffer_tostring(payload));
 
     sender_commit_clean_buffer(s, wb, STREAM_TRAFFIC_TYPE_METADATA);
@@ -640,6 +788,8 @@ static void ml_dimension_update_models(ml_worker_t *worker, ml_dimension_t *dim)
         }
     }
 
+    ml_kmeans_scorer_build(&dim->scorer, dim->km_contexts, Cfg.lag_n + 1);
+
     dim->mt = METRIC_TYPE_CONSTANT;
     dim->ts = TRAINING_STATUS_TRAINED;
 
@@ -661,8 +811,32 @@ static void ml_dimension_update_models(ml_worker_t *worker, ml_dimension_t *dim)
     spinlock_unlock(&dim->slock);
 }
 
+static void
+ml_dimension_preprocess(ml_worker_t *worker, const ml_training_response_t &training_response, ml_features_t *features)
+{
+    memcpy(worker->scratch_training_cns, worker->training_cns,
+           training_response.total_values * sizeof(calculated_number_t));
+
+    size_t smoothing_window = features->smooth_n;
+
+    // Calculate dynamic sampling ratio based on expected output size
+    // After diff and smooth, we'll have approximately this many vectors
+    size_t expected_vectors = training_response.total_values;
+    if (Cfg.diff_n > 0) expected_vectors--;
+    if (smoothing_window > 1) expected_vectors = expected_vectors - smoothing_window + 1;
+    expected_vectors = expected_vectors - Cfg.lag_n;
+
+    double sampling_ratio = 1.0;
+    if (expected_vectors > Cfg.max_training_vectors) {
+        sampling_ratio = (double)Cfg.max_training_vectors / expected_vectors;
+    }
+
+    // Apply sampling during lag feature extraction
+    ml_features_preprocess(features, sampling_ratio);
+}
+
 static enum ml_worker_result
-ml_dimension_train_model(ml_worker_t *worker, ml_dimension_t *dim)
+ml_dimension_train_model(ml_worker_t *worker, ml_dimension_t *dim, ml_queue_stats_t *stats)
 {
     worker_is_busy(WORKER_TRAIN_QUERY);
 
@@ -681,9 +855,54 @@ ml_dimension_train_model(ml_worker_t *worker, ml_dimension_t *dim)
 
     // Mark training as in progress
     dim->training_in_progress = true;
+
+    // The last model is the starting point of warm start training,
+    // when the values collected since it was trained are still in the window
+    bool warm_start = false;
+    ml_kmeans_inlined_t last_km;
+    if (Cfg.warm_start_training && !dim->km_contexts.empty()) {
+        last_km = dim->km_contexts.back();
+        warm_start = last_km.before > now_realtime_sec() - Cfg.training_window;
+    }
+
     spinlock_unlock(&dim->slock);
 
-    auto P = ml_dimension_calculated_numbers(worker, dim);
+    size_t smoothing_window = (dim->rd->rrdset->update_every > nd_profile.update_every) ? 1 : Cfg.max_samples_to_smooth;
+
+    if (warm_start) {
+        auto P = ml_dimension_calculated_numbers(worker, dim, last_km.before);
+        ml_training_response_t training_response = P.second;
+
+        if (P.first == ML_WORKER_RESULT_OK) {
+            worker_is_busy(WORKER_TRAIN_KMEANS);
+
+            ml_features_t features = {
+                Cfg.diff_n, smoothing_window, Cfg.lag_n,
+                worker->scratch_training_cns, training_response.total_values,
+                worker->training_cns, training_response.total_values,
+                worker->training_samples
+            };
+            ml_dimension_preprocess(worker, training_response, &features);
+
+            enum ml_kmeans_warm_start_result warm_start_result =
+                ml_kmeans_train_warm(&dim->kmeans, &last_km, &features, Cfg.training_drift_threshold,
+                                     training_response.query_after_t, training_response.query_before_t);
+
+            if (warm_start_result == ML_KMEANS_WARM_START_OK) {
+                stats->item_kmeans_warm_start = 1;
+                ml_dimension_update_models(worker, dim);
+                return ML_WORKER_RESULT_OK;
+            }
+
+            if (warm_start_result == ML_KMEANS_WARM_START_DRIFT)
+                stats->item_kmeans_drift_detected = 1;
+        }
+
+        // fall back to training from scratch on the whole window
+        worker_is_busy(WORKER_TRAIN_QUERY);
+    }
+
+    auto P = ml_dimension_calculated_numbers(worker, dim, 0);
     ml_worker_result worker_result = P.first;
     ml_training_response_t training_response = P.second;
 
@@ -703,35 +922,17 @@ ml_dimension_train_model(ml_worker_t *worker, ml_dimension_t *dim)
     // compute kmeans
     worker_is_busy(WORKER_TRAIN_KMEANS);
     {
-        memcpy(worker->scratch_training_cns, worker->training_cns,
-               training_response.total_values * sizeof(calculated_number_t));
-
-        size_t smoothing_window = (dim->rd->rrdset->update_every > nd_profile.update_every) ? 1 : Cfg.max_samples_to_smooth;
-
         ml_features_t features = {
             Cfg.diff_n, smoothing_window, Cfg.lag_n,
             worker->scratch_training_cns, training_response.total_values,
             worker->training_cns, training_response.total_values,
             worker->training_samples
         };
-        
-        // Calculate dynamic sampling ratio based on expected output size
-        // After diff and smooth, we'll have approximately this many vectors
-        size_t expected_vectors = training_response.total_values;
-        if (Cfg.diff_n > 0) expected_vectors--;
-        if (smoothing_window > 1) expected_vectors = expected_vectors - smoothing_window + 1;
-        expected_vectors = expected_vectors - Cfg.lag_n;
-        
-        double sampling_ratio = 1.0;
-        if (expected_vectors > Cfg.max_training_vectors) {
-            sampling_ratio = (double)Cfg.max_training_vectors / expected_vectors;
-        }
-
-        // Apply sampling during lag feature extraction
-        ml_features_preprocess(&features, sampling_ratio);
+        ml_dimension_preprocess(worker, training_response, &features);
 
         ml_kmeans_init(&dim->kmeans);
         ml_kmeans_train(&dim->kmeans, &features,  Cfg.max_kmeans_iters, training_response.query_after_t, training_response.query_before_t);
+        stats->item_kmeans_full = 1;
     }
 
     // update models
@@ -741,7 +942,7 @@ ml_dimension_train_model(ml_worker_t *worker, ml_dimension_t *dim)
 }
 
 bool
-ml_dimension_predict(ml_dimension_t *dim, calculated_number_t value, bool exists)
+ml_dimension_predict(ml_chart_t *chart, ml_dimension_t *dim, calculated_number_t value, bool exists)
 {
     // Nothing to do if ML is disabled for this dimension
     if (dim->mls != MACHINE_LEARNING_STATUS_ENABLED)
@@ -749,41 +950,23 @@ ml_dimension_predict(ml_dimension_t *dim, calculated_number_t value, bool exists
 
     // Don't treat values that don't exist as anomalous
     if (!exists) {
-        dim->cns.clear();
+        ml_features_window_reset(&dim->window);
         return false;
     }
 
-    // Save the value and return if we don't have enough values for a sample
+    // Check if the value is different from the last one. The vector this
+    // window replaced compared it with the value n values back (the slot it
+    // rotated to the end); comparing with the previous value marks a metric
+    // variable as soon as two consecutive values differ.
+    bool same_value = !dim->window.count || ml_features_window_last(&dim->window, Cfg.diff_n) == value;
+
+    // Push the value and return if we don't have enough values for a sample
+    // (the first sample is used only after the window is full, once more)
     unsigned n = Cfg.diff_n + Cfg.max_samples_to_smooth + Cfg.lag_n;
-    if (dim->cns.size() < n) {
-        dim->cns.push_back(value);
+    calculated_number_t sample[ML_KMEANS_SCORER_MAX_FEATURES];
+    if (!ml_features_window_push(&dim->window, Cfg.diff_n, Cfg.max_samples_to_smooth, Cfg.lag_n, value, sample) ||
+        dim->window.count <= n)
         return false;
-    }
-
-    // Push the value and check if it's different from the last one
-    bool same_value = true;
-    std::rotate(std::begin(dim->cns), std::begin(dim->cns) + 1, std::end(dim->cns));
-    if (dim->cns[n - 1] != value)
-        same_value = false;
-    dim->cns[n - 1] = value;
-
-    // Create the sample
-    assert((n * (Cfg.lag_n + 1) <= 128) &&
-           "Static buffers too small to perform prediction. "
-           "This should not be possible with the default clamping of feature extraction options");
-    calculated_number_t src_cns[128];
-    calculated_number_t dst_cns[128];
-
-    memset(src_cns, 0, n * (Cfg.lag_n + 1) * sizeof(calculated_number_t));
-    memcpy(src_cns, dim->cns.data(), n * sizeof(calculated_number_t));
-    memcpy(dst_cns, dim->cns.data(), n * sizeof(calculated_number_t));
-
-    ml_features_t features = {
-        Cfg.diff_n, Cfg.max_samples_to_smooth, Cfg.lag_n,
-        dst_cns, n, src_cns, n,
-        dim->feature
-    };
-    ml_features_preprocess(&features, 1.0);
 
     /*
      * Lock to predict
@@ -807,19 +990,22 @@ ml_dimension_predict(ml_dimension_t *dim, calculated_number_t value, bool exists
      * Use the KMeans models to check if the value is anomalous
     */
 
+    calculated_number_t anomaly_scores[ML_KMEANS_SCORER_MAX_MODELS];
+    size_t num_models = ml_kmeans_scorer_score(&dim->scorer, sample, anomaly_scores);
+
     size_t sum = 0;
     size_t models_consulted = 0;
 
-    for (const auto &km_ctx : dim->km_contexts) {
+    for (size_t i = 0; i != num_models; i++) {
         models_consulted++;
 
-        calculated_number_t anomaly_score = ml_kmeans_anomaly_score(&km_ctx, features.preprocessed_features[0]);
+        calculated_number_t anomaly_score = anomaly_scores[i];
         if (std::isnan(anomaly_score))
             continue;
 
         if (anomaly_score < (100 * Cfg.dimension_anomaly_score_threshold)) {
             spinlock_unlock(&dim->slock);
-            pulse_ml_models_consulted(models_consulted);
+            chart->models_consulted += models_consulted;
             return false;
         }
 
@@ -835,7 +1021,7 @@ ml_dimension_predict(ml_dimension_t *dim, calculated_number_t value, bool exists
 
     spinlock_unlock(&dim->slock);
 
-    pulse_ml_models_consulted(models_consulted);
+    chart->models_consulted += models_consulted;
     return sum;
 }
 
@@ -1095,7 +1281,7 @@ static void ml_flush_pending_models(ml_worker_t *worker) {
     worker->pending_model_info.clear();
 }
 
-static enum ml_worker_result ml_worker_create_new_model(ml_worker_t *worker, ml_request_create_new_model_t req) {
+static enum ml_worker_result ml_worker_create_new_model(ml_worker_t *worker, ml_request_create_new_model_t req, ml_queue_stats_t *stats) {
     AcquiredDimension AcqDim(req.DLI);
 
     if (!AcqDim.acquired()) {
@@ -1103,7 +1289,7 @@ static enum ml_worker_result ml_worker_create_new_model(ml_worker_t *worker, ml_
     }
 
     ml_dimension_t *Dim = reinterpret_cast<ml_dimension_t *>(AcqDim.dimension());
-    return ml_dimension_train_model(worker, Dim);
+    return ml_dimension_train_model(worker, Dim, stats);
 }
 
 static enum ml_worker_result ml_worker_add_existing_model(ml_worker_t *worker, ml_request_add_existing_model_t req) {
@@ -1181,7 +1367,7 @@ void ml_train_main(void *arg) {
 
         switch (item.type) {
             case ML_QUEUE_ITEM_TYPE_CREATE_NEW_MODEL: {
-                worker_res = ml_worker_create_new_model(worker, item.create_new_model);
+                worker_res = ml_worker_create_new_model(worker, item.create_new_model, &loop_stats);
                 if (worker_res != ML_WORKER_RESULT_NULL_ACQUIRED_DIMENSION) {
                     ml_queue_push(worker->queue, item);
                 }
@@ -1252,6 +1438,10 @@ void ml_train_main(void *arg) {
             worker->queue_stats.item_result_null_acquired_dimension += loop_stats.item_result_null_acquired_dimension;
             worker->queue_stats.item_result_chart_under_replication += loop_stats.item_result_chart_under_replication;
 
+            worker->queue_stats.item_kmeans_full += loop_stats.item_kmeans_full;
+            worker->queue_stats.item_kmeans_warm_start += loop_stats.item_kmeans_warm_start;
+            worker->queue_stats.item_kmeans_drift_detected += loop_stats.item_kmeans_drift_detected;
+
             netdata_mutex_unlock(&worker->nd_mutex);
         }
 
@@ -10,6 +10,9 @@ struct ml_dimension_t;
 struct ml_chart_t {
     RRDSET *rs;
     ml_machine_learning_stats_t mls;
+
+    // models consulted during this update, committed in ml_chart_update_end()
+    size_t models_consulted;
 };
 
 void ml_chart_update_dimension(ml_chart_t *chart, ml_dimension_t *dim, bool is_anomalous);
@@ -138,6 +138,9 @@ void ml_config_load(ml_config_t *cfg) {
 
     unsigned max_kmeans_iters = inicfg_get_number(&netdata_config, config_section_ml, "maximum number of k-means iterations", 1000);
 
+    bool warm_start_training = inicfg_get_boolean(&netdata_config, config_section_ml, "warm start training", true);
+    double training_drift_threshold = inicfg_get_double(&netdata_config, config_section_ml, "training drift threshold", 0.1);
+
     double dimension_anomaly_rate_threshold = inicfg_get_double(&netdata_config, config_section_ml, "dimension anomaly score threshold", 0.99);
 
     double host_anomaly_rate_threshold = inicfg_get_double(&netdata_config, config_section_ml, "host anomaly rate threshold", 1.0);
@@ -176,6 +179,8 @@ void ml_config_load(ml_config_t *cfg) {
 
     max_kmeans_iters = clamp(max_kmeans_iters, 500u, 1000u);
 
+    training_drift_threshold = clamp(training_drift_threshold, 0.0, 1.0);
+
     dimension_anomaly_rate_threshold = clamp(dimension_anomaly_rate_threshold, 0.01, 5.00);
 
     host_anomaly_rate_threshold = clamp(host_anomaly_rate_threshold, 0.1, 10.0);
@@ -218,6 +223,9 @@ void ml_config_load(ml_config_t *cfg) {
 
     cfg->max_kmeans_iters = max_kmeans_iters;
 
+    cfg->warm_start_training = warm_start_training;
+    cfg->training_drift_threshold = training_drift_threshold;
+
     cfg->host_anomaly_rate_threshold = host_anomaly_rate_threshold;
     cfg->anomaly_detection_grouping_method =
         time_grouping_parse(anomaly_detection_grouping_method.c_str(), RRDR_GROUPING_AVERAGE);
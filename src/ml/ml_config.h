@@ -23,6 +23,9 @@ typedef struct {
     unsigned lag_n;
     unsigned max_kmeans_iters;
 
+    bool warm_start_training;
+    double training_drift_threshold;
+
     double dimension_anomaly_score_threshold;
 
     double host_anomaly_rate_threshold;
@@ -19,17 +19,18 @@ struct ml_dimension_t {
     uint32_t suppression_anomaly_counter;
     bool training_in_progress;
 
-    std::vector<calculated_number_t> cns;
+    ml_features_window_t window;
 
     std::vector<ml_kmeans_inlined_t> km_contexts;
+    ml_kmeans_scorer_t scorer;      // km_contexts, rebuilt whenever they change
     ml_kmeans_t kmeans;
-    std::vector<DSample> feature;
 };
 
 bool
-ml_dimension_predict(ml_dimension_t *dim, calculated_number_t value, bool exists);
+ml_dimension_predict(ml_chart_t *chart, ml_dimension_t *dim, calculated_number_t value, bool exists);
 
 bool ml_dimension_deserialize_kmeans(const char *json_str);
+bool ml_dimension_deserialize_kmeans_packed(const char *encoded);
 
 class DimensionLookupInfo {
 public:
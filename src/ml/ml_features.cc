@@ -37,8 +37,10 @@ static void ml_features_smooth(ml_features_t *features)
         sum -= prev_cn;
     }
 
-    for (idx = 0; idx != features->smooth_n; idx++)
-        features->src[(features->src_n - 1) - idx] = 0.0;
+    // clear the entries after the smoothed values (with diff_n == 0 the
+    // last smooth_n entries include the last smoothed value)
+    for (idx = features->src_n - features->diff_n - features->smooth_n + 1; idx < features->src_n; idx++)
+        features->src[idx] = 0.0;
 }
 
 static void ml_features_lag(ml_features_t *features, double sampling_ratio)
@@ -73,3 +75,173 @@ void ml_features_preprocess(ml_features_t *features, double sampling_ratio)
     ml_features_smooth(features);
     ml_features_lag(features, sampling_ratio);
 }
+
+void ml_features_window_reset(ml_features_window_t *window)
+{
+    memset(window, 0, sizeof(*window));
+}
+
+calculated_number_t ml_features_window_last(const ml_features_window_t *window, size_t diff_n)
+{
+    size_t values_n = diff_n ? diff_n : 1;
+    return window->values[(window->values_idx + values_n - 1) % values_n];
+}
+
+bool ml_features_window_push(ml_features_window_t *window, size_t diff_n, size_t smooth_n, size_t lag_n,
+                             calculated_number_t value, calculated_number_t *sample)
+{
+    size_t values_n = diff_n ? diff_n : 1;
+    size_t diffs_n = smooth_n ? smooth_n : 1;
+    size_t smoothed_n = lag_n + 1;
+
+    if (window->count < std::numeric_limits<uint32_t>::max())
+        window->count++;
+
+    // the slot to be overwritten has the value pushed diff_n values back
+    calculated_number_t oldest_value = window->values[window->values_idx];
+    window->values[window->values_idx] = value;
+    window->values_idx = (window->values_idx + 1) % values_n;
+
+    if (window->count <= diff_n)
+        return false;
+
+    // running sum of the last diffs_n differences; the slot to be
+    // overwritten is zero until the ring fills up for the first time
+    calculated_number_t diff = diff_n ? value - oldest_value : value;
+    window->diffs_sum += diff - window->diffs[window->diffs_idx];
+    window->diffs[window->diffs_idx] = diff;
+    window->diffs_idx = (window->diffs_idx + 1) % diffs_n;
+
+    // recompute the sum every time the ring wraps, so that its rounding
+    // does not accumulate for as long as the dimension is collected
+    if (window->diffs_idx == 0) {
+        window->diffs_sum = 0.0;
+        for (size_t i = 0; i != diffs_n; i++)
+            window->diffs_sum += window->diffs[i];
+    }
+
+    if (window->count < diff_n + diffs_n)
+        return false;
+
+    window->smoothed[window->smoothed_idx] = window->diffs_sum / diffs_n;
+    window->smoothed_idx = (window->smoothed_idx + 1) % smoothed_n;
+
+    if (window->count < diff_n + diffs_n + lag_n)
+        return false;
+
+    for (size_t i = 0; i != smoothed_n; i++)
+        sample[i] = window->smoothed[(window->smoothed_idx + i) % smoothed_n];
+
+    return true;
+}
+
+/*
+ * Unit tests
+*/
+
+#include <random>
+
+// the window gives the features of ml_features_preprocess() over the last
+// diff_n + smooth_n + lag_n values, for every combination the config allows
+size_t ml_features_unittest(void)
+{
+    size_t errors = 0;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<calculated_number_t> uniform(-100.0, 100.0);
+
+    // ml_features_lag() indexes random_nums even when it keeps every sample
+    std::vector<uint32_t> saved_random_nums = Cfg.random_nums;
+    if (Cfg.random_nums.empty())
+        Cfg.random_nums.push_back(0);
+
+    for (size_t diff_n = 0; diff_n <= ML_FEATURES_MAX_DIFF_N; diff_n++) {
+        for (size_t smooth_n = 1; smooth_n <= ML_FEATURES_MAX_SMOOTH_N; smooth_n++) {
+            for (size_t lag_n = 0; lag_n <= ML_FEATURES_MAX_LAG_N; lag_n++) {
+                size_t n = diff_n + smooth_n + lag_n;
+
+                ml_features_window_t window;
+                ml_features_window_reset(&window);
+
+                std::vector<calculated_number_t> values;
+                size_t samples = 0;
+
+                for (size_t i = 0; i != 200; i++) {
+                    // integers, runs of the same value and fractions
+                    calculated_number_t value = (i % 3) ? std::round(uniform(rng)) : uniform(rng);
+                    if (i % 11 == 0 && !values.empty())
+                        value = values.back();
+
+                    // a gap resets the window, as in ml_dimension_predict()
+                    if (i == 120) {
+                        ml_features_window_reset(&window);
+                        values.clear();
+                    }
+
+                    if (window.count && ml_features_window_last(&window, diff_n) != values.back()) {
+                        fprintf(stderr, "ML FEATURES: diff %zu smooth %zu lag %zu: wrong last value at %zu\n",
+                                diff_n, smooth_n, lag_n, i);
+                        errors++;
+                    }
+
+                    values.push_back(value);
+
+                    calculated_number_t sample[ML_FEATURES_MAX_LAG_N + 1];
+                    bool have_sample = ml_features_window_push(&window, diff_n, smooth_n, lag_n, value, sample);
+
+                    if (have_sample != (values.size() >= n)) {
+                        fprintf(stderr, "ML FEATURES: diff %zu smooth %zu lag %zu: sample %s after %zu values\n",
+                                diff_n, smooth_n, lag_n, have_sample ? "returned" : "not returned", values.size());
+                        errors++;
+                        continue;
+                    }
+
+                    if (!have_sample)
+                        continue;
+
+                    // the batch path, as prediction used it before the window
+                    calculated_number_t src[128];
+                    calculated_number_t dst[128];
+                    memset(src, 0, n * (lag_n + 1) * sizeof(calculated_number_t));
+                    memcpy(src, values.data() + values.size() - n, n * sizeof(calculated_number_t));
+                    memcpy(dst, values.data() + values.size() - n, n * sizeof(calculated_number_t));
+
+                    std::vector<DSample> preprocessed;
+                    ml_features_t features = {
+                        diff_n, smooth_n, lag_n,
+                        dst, n, src, n,
+                        preprocessed
+                    };
+                    ml_features_preprocess(&features, 1.0);
+
+                    if (preprocessed.size() != 1) {
+                        fprintf(stderr, "ML FEATURES: diff %zu smooth %zu lag %zu: batch returned %zu samples\n",
+                                diff_n, smooth_n, lag_n, preprocessed.size());
+                        errors++;
+                        continue;
+                    }
+
+                    for (size_t f = 0; f != lag_n + 1; f++) {
+                        calculated_number_t expected = preprocessed[0](f);
+                        if (std::abs(sample[f] - expected) > 1e-9 * std::max(1.0, std::abs(expected))) {
+                            fprintf(stderr, "ML FEATURES: diff %zu smooth %zu lag %zu: feature %zu of value %zu is %f, batch gives %f\n",
+                                    diff_n, smooth_n, lag_n, f, i, sample[f], expected);
+                            errors++;
+                        }
+                    }
+
+                    samples++;
+                }
+
+                // 200 values with a reset at 120 give 200 - 2 * (n - 1) samples
+                if (samples != 200 - 2 * (n - 1)) {
+                    fprintf(stderr, "ML FEATURES: diff %zu smooth %zu lag %zu: %zu samples compared\n",
+                            diff_n, smooth_n, lag_n, samples);
+                    errors++;
+                }
+            }
+        }
+    }
+
+    Cfg.random_nums = saved_random_nums;
+    return errors;
+}
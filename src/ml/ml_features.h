@@ -23,4 +23,53 @@ typedef struct {
 
 void ml_features_preprocess(ml_features_t *features, double sampling_ratio);
 
+/*
+ * Incremental feature extraction, used for prediction.
+ *
+ * Instead of keeping the last diff_n + smooth_n + lag_n values and
+ * preprocessing all of them on every new value, keep the last values,
+ * differences and smoothed values in ring buffers, so that each new value
+ * computes one difference and one smoothed value.
+ *
+ * The features are the same as the ones of ml_features_preprocess() over
+ * the last diff_n + smooth_n + lag_n values, up to the rounding of the
+ * running sums when smoothing. The window keeps its own running sum of the
+ * differences and recomputes it every time the diffs ring wraps.
+*/
+
+#define ML_FEATURES_MAX_DIFF_N 1
+#define ML_FEATURES_MAX_SMOOTH_N 5
+#define ML_FEATURES_MAX_LAG_N 5
+
+typedef struct {
+    calculated_number_t values[ML_FEATURES_MAX_DIFF_N ? ML_FEATURES_MAX_DIFF_N : 1];
+    calculated_number_t diffs[ML_FEATURES_MAX_SMOOTH_N];
+    calculated_number_t smoothed[ML_FEATURES_MAX_LAG_N + 1];
+
+    // the slots the next entries will be written to
+    uint8_t values_idx;
+    uint8_t diffs_idx;
+    uint8_t smoothed_idx;
+
+    // the sum of the entries of diffs
+    calculated_number_t diffs_sum;
+
+    // the values pushed since the last reset
+    uint32_t count;
+} ml_features_window_t;
+
+void ml_features_window_reset(ml_features_window_t *window);
+
+// returns the value pushed last, valid only when count > 0
+calculated_number_t ml_features_window_last(const ml_features_window_t *window, size_t diff_n);
+
+// push a new value; when the window has enough values for a sample
+// (count >= diff_n + smooth_n + lag_n), write its lag_n + 1 features to
+// sample, oldest first, and return true
+bool ml_features_window_push(ml_features_window_t *window, size_t diff_n, size_t smooth_n, size_t lag_n,
+                             calculated_number_t value, calculated_number_t *sample);
+
+// returns the number of errors
+size_t ml_features_unittest(void);
+
 #endif /* ML_FEATURES_H */
@@ -63,6 +63,73 @@ ml_kmeans_train(ml_kmeans_t *kmeans, const ml_features_t *features, unsigned max
     }
 }
 
+enum ml_kmeans_warm_start_result
+ml_kmeans_train_warm(ml_kmeans_t *kmeans, const ml_kmeans_inlined_t *last_km, const ml_features_t *features,
+                     double drift_threshold, time_t after, time_t before)
+{
+    const std::vector<DSample> &samples = features->preprocessed_features;
+
+    if (samples.size() < 2 || last_km->max_dist <= last_km->min_dist)
+        return ML_KMEANS_WARM_START_NOT_APPLICABLE;
+
+    // drift: new features the last model scores as fully anomalous
+    size_t outside = 0;
+    for (const auto &sample : samples) {
+        calculated_number_t anomaly_score = ml_kmeans_anomaly_score(last_km, sample);
+        if (std::isnan(anomaly_score) || anomaly_score >= 100.0)
+            outside++;
+    }
+
+    if (outside > drift_threshold * samples.size())
+        return ML_KMEANS_WARM_START_DRIFT;
+
+    kmeans->after = (uint32_t) after;
+    kmeans->before = (uint32_t) before;
+
+    kmeans->cluster_centers.assign(last_km->cluster_centers.begin(), last_km->cluster_centers.end());
+
+    // assign each feature to its nearest centre of the last model
+    std::vector<uint8_t> nearest(samples.size());
+    for (size_t i = 0; i != samples.size(); i++) {
+        nearest[i] = dlib::length(kmeans->cluster_centers[1] - samples[i]) <
+                     dlib::length(kmeans->cluster_centers[0] - samples[i]);
+    }
+
+    // mini-batch k-means step, with per centre learning rates; the last
+    // model weighs as much as the new features, so that the centres follow
+    // the data the way retraining on a sliding window would
+    std::array<calculated_number_t, 2> counts;
+    counts.fill(samples.size() / 2.0);
+
+    for (size_t i = 0; i != samples.size(); i++) {
+        DSample &CC = kmeans->cluster_centers[nearest[i]];
+        calculated_number_t eta = 1.0 / ++counts[nearest[i]];
+
+        for (long j = 0; j != CC.size(); j++)
+            CC(j) = (1.0 - eta) * CC(j) + eta * samples[i](j);
+    }
+
+    kmeans->min_dist = std::numeric_limits<calculated_number_t>::max();
+    kmeans->max_dist = std::numeric_limits<calculated_number_t>::min();
+
+    for (const auto &sample : samples) {
+        calculated_number_t mean_dist = 0.0;
+
+        for (const auto &cluster_center : kmeans->cluster_centers)
+            mean_dist += dlib::length(cluster_center - sample);
+
+        mean_dist /= kmeans->cluster_centers.size();
+
+        if (mean_dist < kmeans->min_dist)
+            kmeans->min_dist = mean_dist;
+
+        if (mean_dist > kmeans->max_dist)
+            kmeans->max_dist = mean_dist;
+    }
+
+    return ML_KMEANS_WARM_START_OK;
+}
+
 calculated_number_t
 ml_kmeans_anomaly_score(const ml_kmeans_inlined_t *inlined_km, const DSample &DS)
 {
@@ -79,6 +146,154 @@ ml_kmeans_anomaly_score(const ml_kmeans_inlined_t *inlined_km, const DSample &DS
     return (anomaly_score > 100.0) ? 100.0 : anomaly_score;
 }
 
+/*
+ * Scoring all the models of a dimension at once
+*/
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define ML_KMEANS_SCORER_AVX2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ML_KMEANS_SCORER_NEON 1
+#endif
+
+void
+ml_kmeans_scorer_build(ml_kmeans_scorer_t *scorer, const std::vector<ml_kmeans_inlined_t> &km_contexts, size_t num_features)
+{
+    if (num_features > ML_KMEANS_SCORER_MAX_FEATURES)
+        num_features = ML_KMEANS_SCORER_MAX_FEATURES;
+
+    size_t num_models = km_contexts.size();
+    if (num_models > ML_KMEANS_SCORER_MAX_MODELS)
+        num_models = ML_KMEANS_SCORER_MAX_MODELS;
+
+    size_t stride = (num_models * 2 + 3) & ~(size_t)3;
+
+    scorer->num_models = num_models;
+    scorer->num_features = num_features;
+    scorer->stride = stride;
+
+    // padding centres are zeros, their distances are never used
+    scorer->centers.assign(num_features * stride, 0.0);
+    scorer->min_dist.resize(num_models);
+    scorer->max_dist.resize(num_models);
+
+    for (size_t m = 0; m < num_models; m++) {
+        const ml_kmeans_inlined_t &km = km_contexts[m];
+
+        for (size_t c = 0; c < 2; c++) {
+            for (size_t f = 0; f < num_features; f++)
+                scorer->centers[f * stride + m * 2 + c] = km.cluster_centers[c](f);
+        }
+
+        scorer->min_dist[m] = km.min_dist;
+        scorer->max_dist[m] = km.max_dist;
+    }
+}
+
+static void
+ml_kmeans_scorer_distances_scalar(const ml_kmeans_scorer_t *scorer, const calculated_number_t *sample, calculated_number_t *dist)
+{
+    const size_t stride = scorer->stride;
+
+    for (size_t c = 0; c < stride; c++)
+        dist[c] = 0.0;
+
+    for (size_t f = 0; f < scorer->num_features; f++) {
+        const calculated_number_t *centers = &scorer->centers[f * stride];
+        const calculated_number_t s = sample[f];
+
+        for (size_t c = 0; c < stride; c++) {
+            calculated_number_t d = centers[c] - s;
+            dist[c] += d * d;
+        }
+    }
+
+    for (size_t c = 0; c < stride; c++)
+        dist[c] = std::sqrt(dist[c]);
+}
+
+#if defined(ML_KMEANS_SCORER_AVX2)
+__attribute__((target("avx2")))
+static void
+ml_kmeans_scorer_distances_avx2(const ml_kmeans_scorer_t *scorer, const calculated_number_t *sample, calculated_number_t *dist)
+{
+    const size_t stride = scorer->stride;
+
+    for (size_t c = 0; c < stride; c += 4) {
+        __m256d acc = _mm256_setzero_pd();
+
+        for (size_t f = 0; f < scorer->num_features; f++) {
+            __m256d d = _mm256_sub_pd(_mm256_loadu_pd(&scorer->centers[f * stride + c]), _mm256_set1_pd(sample[f]));
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+        }
+
+        _mm256_storeu_pd(&dist[c], _mm256_sqrt_pd(acc));
+    }
+}
+#endif
+
+#if defined(ML_KMEANS_SCORER_NEON)
+static void
+ml_kmeans_scorer_distances_neon(const ml_kmeans_scorer_t *scorer, const calculated_number_t *sample, calculated_number_t *dist)
+{
+    const size_t stride = scorer->stride;
+
+    for (size_t c = 0; c < stride; c += 2) {
+        float64x2_t acc = vdupq_n_f64(0.0);
+
+        for (size_t f = 0; f < scorer->num_features; f++) {
+            float64x2_t d = vsubq_f64(vld1q_f64(&scorer->centers[f * stride + c]), vdupq_n_f64(sample[f]));
+            acc = vfmaq_f64(acc, d, d);
+        }
+
+        vst1q_f64(&dist[c], vsqrtq_f64(acc));
+    }
+}
+#endif
+
+size_t
+ml_kmeans_scorer_score(const ml_kmeans_scorer_t *scorer, const calculated_number_t *sample, calculated_number_t *scores)
+{
+    if (!scorer->num_models)
+        return 0;
+
+    calculated_number_t dist[ML_KMEANS_SCORER_MAX_MODELS * 2 + 4];
+
+#if defined(ML_KMEANS_SCORER_AVX2)
+    static int avx2 = -1;
+    if (unlikely(avx2 == -1))
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    if (avx2)
+        ml_kmeans_scorer_distances_avx2(scorer, sample, dist);
+    else
+        ml_kmeans_scorer_distances_scalar(scorer, sample, dist);
+#elif defined(ML_KMEANS_SCORER_NEON)
+    ml_kmeans_scorer_distances_neon(scorer, sample, dist);
+#else
+    ml_kmeans_scorer_distances_scalar(scorer, sample, dist);
+#endif
+
+    // same as ml_kmeans_anomaly_score()
+    for (size_t m = 0; m < scorer->num_models; m++) {
+        calculated_number_t min_dist = scorer->min_dist[m];
+        calculated_number_t max_dist = scorer->max_dist[m];
+
+        if (max_dist == min_dist) {
+            scores[m] = 0.0;
+            continue;
+        }
+
+        calculated_number_t mean_dist = (dist[m * 2] + dist[m * 2 + 1]) / 2;
+        calculated_number_t anomaly_score = 100.0 * std::abs((mean_dist - min_dist) / (max_dist - min_dist));
+        scores[m] = (anomaly_score > 100.0) ? 100.0 : anomaly_score;
+    }
+
+    return scorer->num_models;
+}
+
 static void ml_buffer_json_member_add_double(BUFFER *wb, const char *key, calculated_number_t cn) {
     if (!isnan(cn) && !isinf(cn)) {
         buffer_json_member_add_double(wb, key, cn);
@@ -173,6 +388,119 @@ ml_kmeans_serialize(const ml_kmeans_inlined_t *inlined_km, BUFFER *wb)
     buffer_json_array_close(wb);
 }
 
+static inline uint8_t *ml_kmeans_pack_u32(uint8_t *dst, uint32_t v)
+{
+    for (size_t i = 0; i != 4; i++)
+        *dst++ = (uint8_t) (v >> (i * 8));
+    return dst;
+}
+
+static inline uint8_t *ml_kmeans_pack_double(uint8_t *dst, calculated_number_t cn)
+{
+    uint64_t v;
+    memcpy(&v, &cn, sizeof(v));
+
+    for (size_t i = 0; i != 8; i++)
+        *dst++ = (uint8_t) (v >> (i * 8));
+    return dst;
+}
+
+static inline const uint8_t *ml_kmeans_unpack_u32(const uint8_t *src, uint32_t *v)
+{
+    *v = 0;
+    for (size_t i = 0; i != 4; i++)
+        *v |= (uint32_t) *src++ << (i * 8);
+    return src;
+}
+
+static inline const uint8_t *ml_kmeans_unpack_double(const uint8_t *src, calculated_number_t *cn)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i != 8; i++)
+        v |= (uint64_t) *src++ << (i * 8);
+
+    memcpy(cn, &v, sizeof(*cn));
+    return src;
+}
+
+static size_t ml_kmeans_packed_features(const ml_kmeans_inlined_t *inlined_km)
+{
+    size_t features = ML_KMEANS_PACKED_MAX_FEATURES;
+    for (const auto &cc: inlined_km->cluster_centers)
+        features = std::min<size_t>(features, cc.size());
+    return features;
+}
+
+size_t ml_kmeans_packed_size(const ml_kmeans_inlined_t *inlined_km)
+{
+    return ML_KMEANS_PACKED_SIZE(ml_kmeans_packed_features(inlined_km));
+}
+
+size_t ml_kmeans_pack(const ml_kmeans_inlined_t *inlined_km, uint8_t *dst)
+{
+    size_t features = ml_kmeans_packed_features(inlined_km);
+    uint8_t *start = dst;
+
+    *dst++ = ML_KMEANS_PACKED_VERSION;
+    *dst++ = (uint8_t) features;
+    *dst++ = 0;
+    *dst++ = 0;
+
+    dst = ml_kmeans_pack_u32(dst, inlined_km->after);
+    dst = ml_kmeans_pack_u32(dst, inlined_km->before);
+    dst = ml_kmeans_pack_double(dst, inlined_km->min_dist);
+    dst = ml_kmeans_pack_double(dst, inlined_km->max_dist);
+
+    for (const auto &cc: inlined_km->cluster_centers) {
+        for (size_t i = 0; i != features; i++)
+            dst = ml_kmeans_pack_double(dst, cc(i));
+    }
+
+    return dst - start;
+}
+
+size_t ml_kmeans_unpack(ml_kmeans_inlined_t *inlined_km, const uint8_t *src, size_t size)
+{
+    if (size < ML_KMEANS_PACKED_SIZE(1)) {
+        netdata_log_error("Failed to unpack kmeans: expected at least %d bytes, got %zu", ML_KMEANS_PACKED_SIZE(1), size);
+        return 0;
+    }
+
+    if (src[0] != ML_KMEANS_PACKED_VERSION) {
+        netdata_log_error("Failed to unpack kmeans: expected version %d, got %u", ML_KMEANS_PACKED_VERSION, src[0]);
+        return 0;
+    }
+
+    size_t features = src[1];
+    if (!features || features > ML_KMEANS_PACKED_MAX_FEATURES) {
+        netdata_log_error("Failed to unpack kmeans: expected cluster centers of up to %d features, got %zu", ML_KMEANS_PACKED_MAX_FEATURES, features);
+        return 0;
+    }
+
+    size_t packed_size = ML_KMEANS_PACKED_SIZE(features);
+    if (size < packed_size) {
+        netdata_log_error("Failed to unpack kmeans: expected %zu bytes, got %zu", packed_size, size);
+        return 0;
+    }
+
+    src += 4;
+    src = ml_kmeans_unpack_u32(src, &inlined_km->after);
+    src = ml_kmeans_unpack_u32(src, &inlined_km->before);
+    src = ml_kmeans_unpack_double(src, &inlined_km->min_dist);
+    src = ml_kmeans_unpack_double(src, &inlined_km->max_dist);
+
+    // the features the model was not trained with are zero, as in the samples
+    for (auto &cc: inlined_km->cluster_centers) {
+        cc.set_size(ML_KMEANS_PACKED_MAX_FEATURES);
+        for (size_t i = 0; i != features; i++)
+            src = ml_kmeans_unpack_double(src, &cc(i));
+        for (size_t i = features; i != ML_KMEANS_PACKED_MAX_FEATURES; i++)
+            cc(i) = 0.0;
+    }
+
+    return packed_size;
+}
+
 bool ml_kmeans_deserialize(ml_kmeans_inlined_t *inlined_km, struct json_object *root)
 {
     struct json_object *value;
@@ -260,3 +588,423 @@ bool ml_kmeans_deserialize(ml_kmeans_inlined_t *inlined_km, struct json_object *
 
     return true;
 }
+
+/*
+ * Unit tests
+*/
+
+#include <random>
+
+static bool ml_kmeans_unittest_same_score(calculated_number_t a, calculated_number_t b)
+{
+    if (std::isnan(a) || std::isnan(b))
+        return std::isnan(a) && std::isnan(b);
+
+    return std::abs(a - b) <= 1e-9 * std::max(1.0, std::abs(b));
+}
+
+// the scorer gives the scores of ml_kmeans_anomaly_score(), with every kernel
+static size_t ml_kmeans_scorer_unittest(void)
+{
+    size_t errors = 0;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<calculated_number_t> uniform(-100.0, 100.0);
+
+    const size_t models_to_test[] = { 1, 2, 3, 5, 24, ML_KMEANS_SCORER_MAX_MODELS };
+
+    for (size_t num_features = 1; num_features <= ML_KMEANS_SCORER_MAX_FEATURES; num_features++) {
+        for (size_t num_models : models_to_test) {
+            std::vector<ml_kmeans_inlined_t> km_contexts(num_models);
+
+            for (size_t m = 0; m != num_models; m++) {
+                ml_kmeans_inlined_t &km = km_contexts[m];
+
+                // the features a model does not use are zero, as in the sample
+                for (size_t c = 0; c != 2; c++) {
+                    for (size_t f = 0; f != ML_KMEANS_SCORER_MAX_FEATURES; f++)
+                        km.cluster_centers[c](f) = (f < num_features) ? uniform(rng) : 0.0;
+                }
+
+                km.min_dist = std::abs(uniform(rng));
+                km.max_dist = km.min_dist + std::abs(uniform(rng)) * 2;
+
+                // a model that cannot score anything
+                if (m % 7 == 3)
+                    km.max_dist = km.min_dist;
+            }
+
+            ml_kmeans_scorer_t scorer;
+            ml_kmeans_scorer_build(&scorer, km_contexts, num_features);
+
+            if (scorer.num_models != num_models || scorer.num_features != num_features || scorer.stride % 4) {
+                fprintf(stderr, "ML SCORER: %zu models of %zu features are built as %zu models of %zu features, stride %zu\n",
+                        num_models, num_features, scorer.num_models, scorer.num_features, scorer.stride);
+                errors++;
+                continue;
+            }
+
+            for (size_t s = 0; s != 20; s++) {
+                DSample ds;
+                calculated_number_t sample[ML_KMEANS_SCORER_MAX_FEATURES];
+                for (size_t f = 0; f != ML_KMEANS_SCORER_MAX_FEATURES; f++)
+                    sample[f] = ds(f) = (f < num_features) ? uniform(rng) : 0.0;
+
+                calculated_number_t scores[ML_KMEANS_SCORER_MAX_MODELS];
+                size_t n = ml_kmeans_scorer_score(&scorer, sample, scores);
+                if (n != num_models) {
+                    fprintf(stderr, "ML SCORER: %zu scores for %zu models\n", n, num_models);
+                    errors++;
+                    break;
+                }
+
+                // every kernel computes the same distances
+                calculated_number_t scalar[ML_KMEANS_SCORER_MAX_MODELS * 2 + 4];
+                ml_kmeans_scorer_distances_scalar(&scorer, sample, scalar);
+
+#if defined(ML_KMEANS_SCORER_AVX2)
+                if (__builtin_cpu_supports("avx2")) {
+                    calculated_number_t avx2[ML_KMEANS_SCORER_MAX_MODELS * 2 + 4];
+                    ml_kmeans_scorer_distances_avx2(&scorer, sample, avx2);
+                    for (size_t c = 0; c != num_models * 2; c++) {
+                        if (!ml_kmeans_unittest_same_score(avx2[c], scalar[c])) {
+                            fprintf(stderr, "ML SCORER: avx2 distance %zu is %f, scalar is %f\n", c, avx2[c], scalar[c]);
+                            errors++;
+                            break;
+                        }
+                    }
+                }
+#elif defined(ML_KMEANS_SCORER_NEON)
+                calculated_number_t neon[ML_KMEANS_SCORER_MAX_MODELS * 2 + 4];
+                ml_kmeans_scorer_distances_neon(&scorer, sample, neon);
+                for (size_t c = 0; c != num_models * 2; c++) {
+                    if (!ml_kmeans_unittest_same_score(neon[c], scalar[c])) {
+                        fprintf(stderr, "ML SCORER: neon distance %zu is %f, scalar is %f\n", c, neon[c], scalar[c]);
+                        errors++;
+                        break;
+                    }
+                }
+#endif
+
+                for (size_t m = 0; m != num_models; m++) {
+                    calculated_number_t expected = ml_kmeans_anomaly_score(&km_contexts[m], ds);
+                    if (!ml_kmeans_unittest_same_score(scores[m], expected)) {
+                        fprintf(stderr, "ML SCORER: model %zu of %zu, with %zu features, scores %f instead of %f\n",
+                                m, num_models, num_features, scores[m], expected);
+                        errors++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // models beyond the maximum are not scored, the rest keep their order
+    {
+        std::vector<ml_kmeans_inlined_t> km_contexts(ML_KMEANS_SCORER_MAX_MODELS + 3);
+        for (size_t m = 0; m != km_contexts.size(); m++) {
+            for (size_t f = 0; f != ML_KMEANS_SCORER_MAX_FEATURES; f++)
+                km_contexts[m].cluster_centers[0](f) = km_contexts[m].cluster_centers[1](f) = (calculated_number_t)m;
+
+            km_contexts[m].min_dist = 0;
+            km_contexts[m].max_dist = 1000;
+        }
+
+        ml_kmeans_scorer_t scorer;
+        ml_kmeans_scorer_build(&scorer, km_contexts, ML_KMEANS_SCORER_MAX_FEATURES);
+
+        calculated_number_t sample[ML_KMEANS_SCORER_MAX_FEATURES] = { 0 };
+        calculated_number_t scores[ML_KMEANS_SCORER_MAX_MODELS];
+        size_t n = ml_kmeans_scorer_score(&scorer, sample, scores);
+
+        if (n != ML_KMEANS_SCORER_MAX_MODELS) {
+            fprintf(stderr, "ML SCORER: %zu of %zu models are scored\n", n, km_contexts.size());
+            errors++;
+        }
+        else {
+            for (size_t m = 1; m != n; m++) {
+                if (!(scores[m] > scores[m - 1])) {
+                    fprintf(stderr, "ML SCORER: model %zu is not scored in order\n", m);
+                    errors++;
+                    break;
+                }
+            }
+        }
+    }
+
+    // no models, no scores
+    {
+        std::vector<ml_kmeans_inlined_t> km_contexts;
+        ml_kmeans_scorer_t scorer;
+        ml_kmeans_scorer_build(&scorer, km_contexts, ML_KMEANS_SCORER_MAX_FEATURES);
+
+        calculated_number_t sample[ML_KMEANS_SCORER_MAX_FEATURES] = { 0 };
+        calculated_number_t scores[1];
+        if (ml_kmeans_scorer_score(&scorer, sample, scores) != 0) {
+            fprintf(stderr, "ML SCORER: a scorer without models gives scores\n");
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+// ml_kmeans_unpack() gives back what ml_kmeans_pack() was given, and
+// reads models with fewer features per cluster centre
+static size_t ml_kmeans_pack_unittest(void)
+{
+    size_t errors = 0;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<calculated_number_t> uniform(-1e6, 1e6);
+
+    for (size_t s = 0; s != 50; s++) {
+        ml_kmeans_inlined_t km;
+        km.after = (s == 0) ? 0 : (s == 1) ? std::numeric_limits<uint32_t>::max() : (uint32_t) rng();
+        km.before = km.after + 3600;
+        km.min_dist = (s == 0) ? -0.0 : uniform(rng);
+        km.max_dist = (s == 1) ? std::numeric_limits<calculated_number_t>::max() : uniform(rng);
+        for (auto &cc: km.cluster_centers) {
+            cc.set_size(ML_KMEANS_PACKED_MAX_FEATURES);
+            for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++)
+                cc(f) = (s == 2) ? std::numeric_limits<calculated_number_t>::denorm_min() : uniform(rng);
+        }
+
+        uint8_t packed[ML_KMEANS_PACKED_MAX_SIZE + 1];
+        size_t packed_size = ml_kmeans_pack(&km, packed);
+        if (packed_size != ml_kmeans_packed_size(&km) || packed_size != ML_KMEANS_PACKED_SIZE(km.cluster_centers[0].size())) {
+            fprintf(stderr, "ML PACK: model %zu packed in %zu bytes, expected %zu\n",
+                    s, packed_size, ml_kmeans_packed_size(&km));
+            errors++;
+            continue;
+        }
+
+        ml_kmeans_inlined_t unpacked;
+        if (ml_kmeans_unpack(&unpacked, packed, packed_size) != packed_size) {
+            fprintf(stderr, "ML PACK: model %zu cannot be unpacked\n", s);
+            errors++;
+            continue;
+        }
+
+        bool same = unpacked.after == km.after && unpacked.before == km.before &&
+                    !memcmp(&unpacked.min_dist, &km.min_dist, sizeof(km.min_dist)) &&
+                    !memcmp(&unpacked.max_dist, &km.max_dist, sizeof(km.max_dist));
+        for (size_t c = 0; c != 2; c++) {
+            for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++)
+                same = same && unpacked.cluster_centers[c](f) == km.cluster_centers[c](f);
+        }
+
+        if (!same) {
+            fprintf(stderr, "ML PACK: model %zu is not the same after a round trip\n", s);
+            errors++;
+        }
+
+        // the integers are little endian
+        uint32_t after = (uint32_t) packed[4] | (uint32_t) packed[5] << 8 | (uint32_t) packed[6] << 16 | (uint32_t) packed[7] << 24;
+        if (packed[0] != ML_KMEANS_PACKED_VERSION || packed[1] != ML_KMEANS_PACKED_MAX_FEATURES || after != km.after) {
+            fprintf(stderr, "ML PACK: model %zu has an unexpected header\n", s);
+            errors++;
+        }
+
+        // truncated, unknown version and invalid numbers of features
+        if (ml_kmeans_unpack(&unpacked, packed, packed_size - 1)) {
+            fprintf(stderr, "ML PACK: model %zu is unpacked from %zu bytes\n", s, packed_size - 1);
+            errors++;
+        }
+
+        const uint8_t invalid_headers[][2] = {
+            { ML_KMEANS_PACKED_VERSION + 1, ML_KMEANS_PACKED_MAX_FEATURES },
+            { ML_KMEANS_PACKED_VERSION, 0 },
+            { ML_KMEANS_PACKED_VERSION, ML_KMEANS_PACKED_MAX_FEATURES + 1 },
+        };
+        for (const auto &header: invalid_headers) {
+            uint8_t invalid[ML_KMEANS_PACKED_MAX_SIZE + 16];
+            memcpy(invalid, packed, packed_size);
+            memset(&invalid[packed_size], 0, sizeof(invalid) - packed_size);
+            invalid[0] = header[0];
+            invalid[1] = header[1];
+            if (ml_kmeans_unpack(&unpacked, invalid, sizeof(invalid))) {
+                fprintf(stderr, "ML PACK: model %zu is unpacked with version %u and %u features\n",
+                        s, header[0], header[1]);
+                errors++;
+            }
+        }
+
+        // a model with fewer features: only they are read, the rest are zero
+        for (size_t features = 1; features <= ML_KMEANS_PACKED_MAX_FEATURES; features++) {
+            uint8_t shorter[ML_KMEANS_PACKED_MAX_SIZE];
+            memcpy(shorter, packed, ML_KMEANS_PACKED_SIZE(0));
+            shorter[1] = (uint8_t) features;
+            for (size_t c = 0; c != 2; c++)
+                memcpy(&shorter[ML_KMEANS_PACKED_SIZE(0) + c * features * 8],
+                       &packed[ML_KMEANS_PACKED_SIZE(0) + c * ML_KMEANS_PACKED_MAX_FEATURES * 8], features * 8);
+
+            size_t shorter_size = ML_KMEANS_PACKED_SIZE(features);
+            if (ml_kmeans_unpack(&unpacked, shorter, shorter_size - 1) ||
+                ml_kmeans_unpack(&unpacked, shorter, shorter_size) != shorter_size) {
+                fprintf(stderr, "ML PACK: model %zu with %zu features is not unpacked from %zu bytes\n",
+                        s, features, shorter_size);
+                errors++;
+                continue;
+            }
+
+            same = unpacked.after == km.after && unpacked.before == km.before;
+            for (size_t c = 0; c != 2; c++) {
+                for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++)
+                    same = same && unpacked.cluster_centers[c](f) == ((f < features) ? km.cluster_centers[c](f) : 0.0);
+            }
+
+            if (!same) {
+                fprintf(stderr, "ML PACK: model %zu with %zu features is not unpacked as packed\n", s, features);
+                errors++;
+            }
+        }
+    }
+
+    return errors;
+}
+
+// ml_kmeans_train_warm() updates the last model, weighing it as much as
+// the new features, and tells drift apart from the cases it cannot handle
+static size_t ml_kmeans_train_warm_unittest(void)
+{
+    size_t errors = 0;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<calculated_number_t> noise(-0.1, 0.1);
+
+    const size_t num_samples = 200;
+    const calculated_number_t shift = 2.0;
+
+    // the last model: centres at 0 and 10, new features within its range
+    // score about 22
+    ml_kmeans_inlined_t last_km;
+    for (size_t c = 0; c != 2; c++) {
+        last_km.cluster_centers[c].set_size(ML_KMEANS_PACKED_MAX_FEATURES);
+        for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++)
+            last_km.cluster_centers[c](f) = c ? 10.0 : 0.0;
+    }
+    last_km.min_dist = 10.0;
+    last_km.max_dist = 20.0;
+    last_km.after = 1000;
+    last_km.before = 2000;
+
+    // half of the new features moved from the first centre by shift, the
+    // other half around the second centre; far_every of them far away
+    auto make_samples = [&](std::vector<DSample> &samples, size_t n, size_t far_every) {
+        samples.resize(n);
+        for (size_t i = 0; i != n; i++) {
+            samples[i].set_size(ML_KMEANS_PACKED_MAX_FEATURES);
+            for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++) {
+                calculated_number_t centre = (i % 2) ? 10.0 : shift;
+                if (far_every && i % far_every == 0)
+                    centre = 1000.0;
+                samples[i](f) = centre + noise(rng);
+            }
+        }
+    };
+
+    struct {
+        const char *name;
+        size_t num_samples;
+        size_t far_every;
+        double drift_threshold;
+        bool degenerate;
+        enum ml_kmeans_warm_start_result expected;
+    } tests[] = {
+        { "similar features",               num_samples, 0,  0.1, false, ML_KMEANS_WARM_START_OK },
+        { "few far features",               num_samples, 20, 0.1, false, ML_KMEANS_WARM_START_OK },
+        { "many far features",              num_samples, 4,  0.1, false, ML_KMEANS_WARM_START_DRIFT },
+        { "any far feature, threshold 0",   num_samples, 20, 0.0, false, ML_KMEANS_WARM_START_DRIFT },
+        { "many far features, threshold 1", num_samples, 4,  1.0, false, ML_KMEANS_WARM_START_OK },
+        { "no features",                    0,           0,  0.1, false, ML_KMEANS_WARM_START_NOT_APPLICABLE },
+        { "one feature",                    1,           0,  0.1, false, ML_KMEANS_WARM_START_NOT_APPLICABLE },
+        { "degenerate last model",          num_samples, 4,  0.1, true,  ML_KMEANS_WARM_START_NOT_APPLICABLE },
+    };
+
+    for (const auto &t: tests) {
+        std::vector<DSample> samples;
+        make_samples(samples, t.num_samples, t.far_every);
+
+        ml_features_t features = {
+            0, 1, ML_KMEANS_PACKED_MAX_FEATURES - 1,
+            NULL, 0, NULL, 0,
+            samples
+        };
+
+        ml_kmeans_inlined_t km = last_km;
+        if (t.degenerate)
+            km.max_dist = km.min_dist;
+
+        ml_kmeans_t kmeans;
+        kmeans.after = 1;
+
+        enum ml_kmeans_warm_start_result rc = ml_kmeans_train_warm(&kmeans, &km, &features, t.drift_threshold, 3000, 4000);
+        if (rc != t.expected) {
+            fprintf(stderr, "ML WARM START: %s: returned %d, expected %d\n", t.name, rc, t.expected);
+            errors++;
+            continue;
+        }
+
+        if (rc != ML_KMEANS_WARM_START_OK) {
+            if (kmeans.after != 1 || !kmeans.cluster_centers.empty()) {
+                fprintf(stderr, "ML WARM START: %s: the model was changed\n", t.name);
+                errors++;
+            }
+            continue;
+        }
+
+        if (kmeans.after != 3000 || kmeans.before != 4000 || kmeans.cluster_centers.size() != 2) {
+            fprintf(stderr, "ML WARM START: %s: the model is not set\n", t.name);
+            errors++;
+            continue;
+        }
+
+        // without far features, each centre moves half way to the mean of
+        // its new features
+        if (!t.far_every) {
+            for (size_t f = 0; f != ML_KMEANS_PACKED_MAX_FEATURES; f++) {
+                if (std::abs(kmeans.cluster_centers[0](f) - shift / 2) > 0.1 ||
+                    std::abs(kmeans.cluster_centers[1](f) - 10.0) > 0.1) {
+                    fprintf(stderr, "ML WARM START: %s: feature %zu of the centres is %f and %f, expected %f and %f\n",
+                            t.name, f, kmeans.cluster_centers[0](f), kmeans.cluster_centers[1](f), shift / 2, 10.0);
+                    errors++;
+                }
+            }
+        }
+
+        // the distances come from the new features, so they all score in range
+        ml_kmeans_inlined_t updated(kmeans);
+        if (!(updated.min_dist < updated.max_dist)) {
+            fprintf(stderr, "ML WARM START: %s: distances %f to %f\n", t.name, updated.min_dist, updated.max_dist);
+            errors++;
+            continue;
+        }
+
+        size_t top = 0;
+        for (const auto &sample: samples) {
+            calculated_number_t score = ml_kmeans_anomaly_score(&updated, sample);
+            if (score < 0.0 || score > 100.0 + 1e-9) {
+                fprintf(stderr, "ML WARM START: %s: a new feature scores %f\n", t.name, score);
+                errors++;
+                break;
+            }
+            top += score > 100.0 - 1e-9;
+        }
+
+        if (!top) {
+            fprintf(stderr, "ML WARM START: %s: no new feature is at the max distance\n", t.name);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+size_t ml_kmeans_unittest(void)
+{
+    size_t errors = 0;
+
+    errors += ml_kmeans_scorer_unittest();
+    errors += ml_kmeans_pack_unittest();
+    errors += ml_kmeans_train_warm_unittest();
+
+    return errors;
+}
@@ -90,14 +90,98 @@ inline ml_kmeans_t &ml_kmeans_t::operator=(const ml_kmeans_inlined_t &inlined_km
     return *this;
 }
 
+/*
+ * The cluster centres of all the models of a dimension, laid out as a
+ * structure of arrays: for each feature, the values of all the centres
+ * are contiguous, so that the distances of a sample to every centre of
+ * every model are computed in a single vectorized pass.
+*/
+
+#define ML_KMEANS_SCORER_MAX_FEATURES 6
+#define ML_KMEANS_SCORER_MAX_MODELS (7 * 24)
+
+struct ml_kmeans_scorer_t {
+    size_t num_models;
+    size_t num_features;
+    size_t stride;                                  // centres per feature, padded to a multiple of 4
+
+    std::vector<calculated_number_t> centers;       // [feature][model * 2 + centre]
+    std::vector<calculated_number_t> min_dist;      // [model]
+    std::vector<calculated_number_t> max_dist;      // [model]
+
+    ml_kmeans_scorer_t() : num_models(0), num_features(0), stride(0)
+    {
+    }
+};
+
+void ml_kmeans_scorer_build(ml_kmeans_scorer_t *scorer, const std::vector<ml_kmeans_inlined_t> &km_contexts, size_t num_features);
+
+// scores the sample against all the models, in the order of km_contexts,
+// and returns the number of scores written
+size_t ml_kmeans_scorer_score(const ml_kmeans_scorer_t *scorer, const calculated_number_t *sample, calculated_number_t *scores);
+
 void ml_kmeans_init(ml_kmeans_t *kmeans);
 
 void ml_kmeans_train(ml_kmeans_t *kmeans, const ml_features_t *features, unsigned max_iters, time_t after, time_t before);
 
+enum ml_kmeans_warm_start_result {
+    // The last model was updated with the new features
+    ML_KMEANS_WARM_START_OK,
+
+    // Fewer than 2 new features, or the last model cannot score them
+    // (its min and max distances are the same)
+    ML_KMEANS_WARM_START_NOT_APPLICABLE,
+
+    // More than drift_threshold of the new features fall outside the range
+    // of the last model
+    ML_KMEANS_WARM_START_DRIFT,
+};
+
+// Update the last model of a dimension with a mini-batch k-means pass over
+// the features collected since it was trained. Unless it returns
+// ML_KMEANS_WARM_START_OK, kmeans is not touched and the dimension needs a
+// full training.
+enum ml_kmeans_warm_start_result ml_kmeans_train_warm(ml_kmeans_t *kmeans, const ml_kmeans_inlined_t *last_km, const ml_features_t *features,
+                                                      double drift_threshold, time_t after, time_t before);
+
 calculated_number_t ml_kmeans_anomaly_score(const ml_kmeans_inlined_t *kmeans, const DSample &DS);
 
 void ml_kmeans_serialize(const ml_kmeans_inlined_t *inlined_km, BUFFER *wb);
 
+/*
+ * Packed binary model, stored in the database and streamed to parents.
+ * All fields are little endian, doubles are IEEE754:
+ *
+ *   u8   version (ML_KMEANS_PACKED_VERSION)
+ *   u8   features per cluster centre (n, 1 to ML_KMEANS_PACKED_MAX_FEATURES)
+ *   u16  reserved, zero
+ *   u32  after
+ *   u32  before
+ *   f64  min_dist
+ *   f64  max_dist
+ *   f64  cluster centres [2][n]
+ *
+ * n is the size of the cluster centres of the model, so the size of a
+ * packed model depends on it (ML_KMEANS_PACKED_SIZE(n)).
+*/
+
+#define ML_KMEANS_PACKED_VERSION 1
+#define ML_KMEANS_PACKED_MAX_FEATURES 6
+#define ML_KMEANS_PACKED_SIZE(features) (4 + 4 + 4 + 8 + 8 + 2 * (features) * 8)
+#define ML_KMEANS_PACKED_MAX_SIZE ML_KMEANS_PACKED_SIZE(ML_KMEANS_PACKED_MAX_FEATURES)
+
+// the number of bytes ml_kmeans_pack() writes for this model
+size_t ml_kmeans_packed_size(const ml_kmeans_inlined_t *inlined_km);
+
+// returns the number of bytes written, at most ML_KMEANS_PACKED_MAX_SIZE
+size_t ml_kmeans_pack(const ml_kmeans_inlined_t *inlined_km, uint8_t *dst);
+
+// returns the number of bytes read, or 0 when src is not a packed model
+size_t ml_kmeans_unpack(ml_kmeans_inlined_t *inlined_km, const uint8_t *src, size_t size);
+
 bool ml_kmeans_deserialize(ml_kmeans_inlined_t *inlined_km, struct json_object *root);
 
+// returns the number of errors
+size_t ml_kmeans_unittest(void);
+
 #endif /* ML_KMEANS_H */
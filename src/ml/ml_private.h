@@ -14,5 +14,8 @@ void ml_detect_main(void *arg);
 extern sqlite3 *ml_db;
 extern const char *db_models_create_table;
 
+// convert the models of older versions to the packed format
+void ml_models_migrate_legacy_table(void);
+
 
 #endif /* NETDATA_ML_PRIVATE_H */
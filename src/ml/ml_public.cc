@@ -111,7 +111,7 @@ void ml_host_stop(RRDHOST *rh) {
 
             dim->suppression_anomaly_counter = 0;
             dim->suppression_window_counter = 0;
-            dim->cns.clear();
+            ml_features_window_reset(&dim->window);
 
             ml_kmeans_init(&dim->kmeans);
 
@@ -225,6 +225,7 @@ void ml_chart_new(RRDSET *rs)
 
     chart->rs = rs;
     chart->mls = ml_machine_learning_stats_t();
+    chart->models_consulted = 0;
 
     rs->ml_chart = (rrd_ml_chart_t *) chart;
 }
@@ -248,6 +249,7 @@ ALWAYS_INLINE_ONLY bool ml_chart_update_begin(RRDSET *rs)
         return false;
 
     chart->mls = {};
+    chart->models_consulted = 0;
     return true;
 }
 
@@ -256,6 +258,11 @@ void ml_chart_update_end(RRDSET *rs)
     ml_chart_t *chart = (ml_chart_t *) rs->ml_chart;
     if (!chart)
         return;
+
+    if (chart->models_consulted) {
+        pulse_ml_models_consulted(chart->models_consulted);
+        chart->models_consulted = 0;
+    }
 }
 
 void ml_dimension_new(RRDDIM *rd)
@@ -274,6 +281,7 @@ void ml_dimension_new(RRDDIM *rd)
     dim->suppression_window_counter = 0;
     dim->training_in_progress = false;
 
+    ml_features_window_reset(&dim->window);
     ml_kmeans_init(&dim->kmeans);
 
     if (simple_pattern_matches(Cfg.sp_charts_to_skip, rrdset_name(rd->rrdset)))
@@ -369,7 +377,7 @@ bool ml_dimension_is_anomalous(RRDDIM *rd, time_t curr_time, double value, bool
 
     ml_chart_t *chart = (ml_chart_t *) rd->rrdset->ml_chart;
 
-    bool is_anomalous = ml_dimension_predict(dim, value, exists);
+    bool is_anomalous = ml_dimension_predict(chart, dim, value, exists);
     ml_chart_update_dimension(chart, dim, is_anomalous);
 
     return is_anomalous;
@@ -441,6 +449,8 @@ void ml_init()
                 sqlite3_free(err);
                 ml_db = NULL;
             }
+            else
+                ml_models_migrate_legacy_table();
         }
     }
 }
@@ -532,6 +542,18 @@ bool ml_model_received_from_child(RRDHOST *host, const char *json)
     return ok;
 }
 
+bool ml_model_packed_received_from_child(RRDHOST *host, const char *encoded)
+{
+    UNUSED(host);
+
+    bool ok = ml_dimension_deserialize_kmeans_packed(encoded);
+    if (!ok) {
+        global_statistics_ml_models_deserialization_failures();
+    }
+
+    return ok;
+}
+
 void ml_host_disconnected(RRDHOST *rh) {
     ml_host_t *host = (ml_host_t *) rh->ml_host;
     if (!host)
@@ -539,3 +561,14 @@ void ml_host_disconnected(RRDHOST *rh) {
 
     __atomic_store_n(&host->reset_pointers, true, __ATOMIC_RELAXED);
 }
+
+int ml_unittest(void)
+{
+    size_t errors = 0;
+
+    errors += ml_features_unittest();
+    errors += ml_kmeans_unittest();
+
+    fprintf(stderr, "ML: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
@@ -57,9 +57,12 @@ bool ml_host_running(RRDHOST *rh);
 uint64_t sqlite_get_ml_space(void);
 
 bool ml_model_received_from_child(RRDHOST *host, const char *json);
+bool ml_model_packed_received_from_child(RRDHOST *host, const char *encoded);
 
 void ml_host_disconnected(RRDHOST *host);
 
+int ml_unittest(void);
+
 #ifdef __cplusplus
 };
 #endif
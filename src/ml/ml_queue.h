@@ -45,6 +45,11 @@ typedef struct {
     size_t item_result_not_enough_collected_values;
     size_t item_result_null_acquired_dimension;
     size_t item_result_chart_under_replication;
+
+    // how the k-means models were trained
+    size_t item_kmeans_full;
+    size_t item_kmeans_warm_start;
+    size_t item_kmeans_drift_detected;
 } ml_queue_stats_t;
 
 struct ml_queue_t {
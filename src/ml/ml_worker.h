@@ -49,6 +49,11 @@ typedef struct {
     RRDDIM *training_results_null_acquired_dimension_rd;
     RRDDIM *training_results_chart_under_replication_rd;
 
+    RRDSET *training_kmeans_rs;
+    RRDDIM *training_kmeans_full_rd;
+    RRDDIM *training_kmeans_warm_start_rd;
+    RRDDIM *training_kmeans_drift_detected_rd;
+
     size_t num_db_transactions;
     size_t num_models_to_prune;
 } ml_worker_t;
@@ -141,6 +141,7 @@ static inline void pluginsd_rrddim_put_to_slot(PARSER *parser, RRDSET *st, RRDDI
             st->pluginsd.prd_array[i].rda = NULL;
             st->pluginsd.prd_array[i].rd = NULL;
             st->pluginsd.prd_array[i].id = NULL;
+            st->pluginsd.prd_array[i].delta.connection = 0;
         }
 
         rrd_slot_memory_added((wanted_size - st->pluginsd.size) * sizeof(struct pluginsd_rrddim));
@@ -154,6 +155,7 @@ static inline void pluginsd_rrddim_put_to_slot(PARSER *parser, RRDSET *st, RRDDI
             prd->rda = rrddim_find_and_acquire(st, string2str(rd->id), true);
             prd->rd = rrddim_acquired_to_rrddim(prd->rda);
             prd->id = string2str(prd->rd->id);
+            prd->delta.connection = 0;
         }
 
         if(obsolete)
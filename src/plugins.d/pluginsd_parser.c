@@ -33,30 +33,7 @@ static inline PARSER_RC pluginsd_set(char **words, size_t num_words, PARSER *par
     return PARSER_RC_OK;
 }
 
-static inline PARSER_RC pluginsd_begin(char **words, size_t num_words, PARSER *parser) {
-    int idx = 1;
-    ssize_t slot = pluginsd_parse_rrd_slot(words, num_words);
-    if(slot >= 0) idx++;
-
-    char *id = get_word(words, num_words, idx++);
-    char *microseconds_txt = get_word(words, num_words, idx++);
-
-    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_BEGIN);
-    if(!host) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
-    RRDSET *st = pluginsd_rrdset_cache_get_from_slot(parser, host, id, slot, PLUGINSD_KEYWORD_BEGIN);
-    if(!st) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
-    if(!pluginsd_set_scope_chart(parser, st, PLUGINSD_KEYWORD_BEGIN))
-        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
-    usec_t microseconds = 0;
-    if (microseconds_txt && *microseconds_txt) {
-        long long t = str2ll(microseconds_txt, NULL);
-        if(t >= 0)
-            microseconds = t;
-    }
-
+static ALWAYS_INLINE void pluginsd_begin_collection(PARSER *parser, RRDHOST *host __maybe_unused, RRDSET *st, usec_t microseconds) {
 #ifdef NETDATA_LOG_REPLICATION_REQUESTS
     if(st->replay.log_next_data_collection) {
         st->replay.log_next_data_collection = false;
@@ -81,6 +58,46 @@ static inline PARSER_RC pluginsd_begin(char **words, size_t num_words, PARSER *p
         else
             rrdset_next(st);
     }
+}
+
+static ALWAYS_INLINE void pluginsd_end_collection(PARSER *parser, RRDSET *st, struct timeval tv, bool pending_rrdset_next, const char *keyword) {
+    if (unlikely(rrdset_flag_check(st, RRDSET_FLAG_DEBUG)))
+        netdata_log_debug(D_PLUGINSD, "requested an END on chart '%s'", rrdset_id(st));
+
+    pluginsd_clear_scope_chart(parser, keyword);
+    parser->user.data_collections_count++;
+
+    if(!tv.tv_sec)
+        now_realtime_timeval(&tv);
+
+    rrdset_timed_done(st, tv, pending_rrdset_next);
+}
+
+static inline PARSER_RC pluginsd_begin(char **words, size_t num_words, PARSER *parser) {
+    int idx = 1;
+    ssize_t slot = pluginsd_parse_rrd_slot(words, num_words);
+    if(slot >= 0) idx++;
+
+    char *id = get_word(words, num_words, idx++);
+    char *microseconds_txt = get_word(words, num_words, idx++);
+
+    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_BEGIN);
+    if(!host) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    RRDSET *st = pluginsd_rrdset_cache_get_from_slot(parser, host, id, slot, PLUGINSD_KEYWORD_BEGIN);
+    if(!st) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    if(!pluginsd_set_scope_chart(parser, st, PLUGINSD_KEYWORD_BEGIN))
+        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    usec_t microseconds = 0;
+    if (microseconds_txt && *microseconds_txt) {
+        long long t = str2ll(microseconds_txt, NULL);
+        if(t >= 0)
+            microseconds = t;
+    }
+
+    pluginsd_begin_collection(parser, host, st, microseconds);
     return PARSER_RC_OK;
 }
 
@@ -95,21 +112,153 @@ static inline PARSER_RC pluginsd_end(char **words, size_t num_words, PARSER *par
     RRDSET *st = pluginsd_require_scope_chart(parser, PLUGINSD_KEYWORD_END, PLUGINSD_KEYWORD_BEGIN);
     if(!st) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
 
-    if (unlikely(rrdset_flag_check(st, RRDSET_FLAG_DEBUG)))
-        netdata_log_debug(D_PLUGINSD, "requested an END on chart '%s'", rrdset_id(st));
-
-    pluginsd_clear_scope_chart(parser, PLUGINSD_KEYWORD_END);
-    parser->user.data_collections_count++;
-
     struct timeval tv = {
         .tv_sec  = (tv_sec  && *tv_sec)  ? str2ll(tv_sec,  NULL) : 0,
         .tv_usec = (tv_usec && *tv_usec) ? str2ll(tv_usec, NULL) : 0
     };
-    
-    if(!tv.tv_sec)
-        now_realtime_timeval(&tv);
 
-    rrdset_timed_done(st, tv, pending_rrdset_next && *pending_rrdset_next ? true : false);
+    pluginsd_end_collection(parser, st, tv, pending_rrdset_next && *pending_rrdset_next ? true : false, PLUGINSD_KEYWORD_END);
+
+    return PARSER_RC_OK;
+}
+
+// the next word of a line that is parsed in place
+static ALWAYS_INLINE char *pluginsd_next_word_in_place(char **line) {
+    char *s = *line;
+    while(*s == ' ' || *s == '\t') s++;
+
+    if(!*s) {
+        *line = s;
+        return NULL;
+    }
+
+    char *e = s;
+    while(*e && *e != ' ' && *e != '\t') e++;
+    if(*e) *e++ = '\0';
+
+    *line = e;
+    return s;
+}
+
+// varints of 5 bits per base64 digit, with 0x20 marking continuation
+// 64 bits need 13 digits - the 13th can only carry the 4 most significant bits
+static ALWAYS_INLINE bool pluginsd_varint_base64_decode(const unsigned char **v, uint64_t *value) {
+    const unsigned char *s = *v;
+    uint64_t u = 0;
+    unsigned shift = 0;
+    unsigned char c;
+
+    do {
+        c = base64_value_from_ascii[*s];
+        if(unlikely(c == 255 || shift > 60 || (shift == 60 && (c & 0x30))))
+            return false;
+
+        u |= (uint64_t)(c & 0x1f) << shift;
+        shift += 5;
+        s++;
+    } while(c & 0x20);
+
+    *v = s;
+    *value = u;
+    return true;
+}
+
+static ALWAYS_INLINE int64_t pluginsd_zigzag_decode(uint64_t u) {
+    return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+// the encoding plugins do - netdata does not send SETB, it is used by the unittest
+static size_t pluginsd_varint_base64_encode(char *dst, int64_t value) {
+    uint64_t u = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    size_t len = 0;
+
+    do {
+        unsigned char c = u & 0x1f;
+        u >>= 5;
+        if(u) c |= 0x20;
+        dst[len++] = base64_digits[c];
+    } while(u);
+
+    dst[len] = '\0';
+    return len;
+}
+
+PARSER_RC pluginsd_set_block(char *line, PARSER *parser) {
+    char *word = pluginsd_next_word_in_place(&line);
+
+    ssize_t slot = -1;
+    if(word && strncmp(word, PLUGINSD_KEYWORD_SLOT ":", sizeof(PLUGINSD_KEYWORD_SLOT)) == 0) {
+        slot = (ssize_t) str2ull_encoded(&word[sizeof(PLUGINSD_KEYWORD_SLOT)]);
+        word = pluginsd_next_word_in_place(&line);
+    }
+
+    char *id = word;
+    char *microseconds_txt = pluginsd_next_word_in_place(&line);
+    char *count_txt = pluginsd_next_word_in_place(&line);
+    char *values = pluginsd_next_word_in_place(&line);
+
+    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_SET_BLOCK);
+    if(!host) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    if(!id || !microseconds_txt || !count_txt)
+        return PLUGINSD_DISABLE_PLUGIN(parser, PLUGINSD_KEYWORD_SET_BLOCK, "missing parameters");
+
+    RRDSET *st = pluginsd_rrdset_cache_get_from_slot(parser, host, id, slot, PLUGINSD_KEYWORD_SET_BLOCK);
+    if(!st) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    if(!pluginsd_set_scope_chart(parser, st, PLUGINSD_KEYWORD_SET_BLOCK))
+        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    // the values are addressed by dimension slot, so SETB is accepted
+    // only for charts with their dimensions defined with SLOT:
+    size_t count = (size_t)str2ull_encoded(count_txt);
+    if(unlikely(count && (!st->pluginsd.dims_with_slots || count > st->pluginsd.size))) {
+        netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s with %zu values, "
+                          "but the chart has %u dimensions %s slots.",
+                          rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_BLOCK, count,
+                          st->pluginsd.size, st->pluginsd.dims_with_slots ? "with" : "without");
+        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+    }
+
+    long long microseconds = str2ll(microseconds_txt, NULL);
+    pluginsd_begin_collection(parser, host, st, microseconds > 0 ? (usec_t)microseconds : 0);
+
+    // the values are applied to the dimensions in the slots of the chart, in order
+    const unsigned char *v = (const unsigned char *)(values ? values : "");
+    for(size_t i = 0; i < count ;i++) {
+        if(*v == PLUGINSD_SET_BLOCK_EMPTY_VALUE) {
+            // this dimension has not been collected this time
+            v++;
+            continue;
+        }
+
+        uint64_t u;
+        if(unlikely(!pluginsd_varint_base64_decode(&v, &u))) {
+            netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s with a malformed value at position %zu.",
+                              rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_BLOCK, i);
+            return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+        }
+
+        RRDDIM *rd = st->pluginsd.prd_array[i].rd;
+        if(unlikely(!rd)) {
+            netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s with a value for slot %zu, but there is no dimension on it.",
+                              rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_BLOCK, i + 1);
+            return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+        }
+
+        rrddim_set_by_pointer(st, rd, (collected_number)pluginsd_zigzag_decode(u));
+    }
+
+    if(unlikely(*v)) {
+        netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s with more than the %zu values expected.",
+                          rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_BLOCK, count);
+        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+    }
+
+    st->pluginsd.set = true;
+
+    struct timeval tv = { 0 };
+    pluginsd_end_collection(parser, st, tv, false, PLUGINSD_KEYWORD_SET_BLOCK);
 
     return PARSER_RC_OK;
 }
@@ -847,8 +996,10 @@ static ALWAYS_INLINE PARSER_RC pluginsd_begin_v2(char **words, size_t num_words,
 
         buffer_need_bytes(wb, 1024);
 
-        if(unlikely(parser->user.v2.stream_buffer.begin_v2_added))
+        if(unlikely(parser->user.v2.stream_buffer.begin_v2_added)) {
+            stream_send_rrdset_deltas_close(&parser->user.v2.stream_buffer);
             buffer_fast_strcat(wb, PLUGINSD_KEYWORD_END_V2 "\n", sizeof(PLUGINSD_KEYWORD_END_V2) - 1 + 1);
+        }
 
         buffer_fast_strcat(wb, PLUGINSD_KEYWORD_BEGIN_V2, sizeof(PLUGINSD_KEYWORD_BEGIN_V2) - 1);
 
@@ -908,32 +1059,11 @@ static ALWAYS_INLINE PARSER_RC pluginsd_begin_v2(char **words, size_t num_words,
     return PARSER_RC_OK;
 }
 
-static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, PARSER *parser) {
+// ML, propagation and storage of a SET2 or a SET2B record
+// collected_str and value_str are the original text of SET2, or NULL
+static ALWAYS_INLINE void pluginsd_set_v2_store(PARSER *parser, RRDSET *st, RRDDIM *rd, collected_number collected_value, NETDATA_DOUBLE value, SN_FLAGS flags, const char *collected_str, const char *value_str) {
     timing_init();
 
-    int idx = 1;
-    ssize_t slot = pluginsd_parse_rrd_slot(words, num_words);
-    if(slot >= 0) idx++;
-
-    char *dimension = get_word(words, num_words, idx++);
-    char *collected_str = get_word(words, num_words, idx++);
-    char *value_str = get_word(words, num_words, idx++);
-    char *flags_str = get_word(words, num_words, idx++);
-
-    if(unlikely(!dimension || !collected_str || !value_str || !flags_str))
-        return PLUGINSD_DISABLE_PLUGIN(parser, PLUGINSD_KEYWORD_SET_V2, "missing parameters");
-
-    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_SET_V2);
-    if(unlikely(!host)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
-    RRDSET *st = pluginsd_require_scope_chart(parser, PLUGINSD_KEYWORD_SET_V2, PLUGINSD_KEYWORD_BEGIN_V2);
-    if(unlikely(!st)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
-    timing_step(TIMING_STEP_SET2_PREPARE);
-
-    RRDDIM *rd = pluginsd_acquire_dimension(host, st, dimension, slot, PLUGINSD_KEYWORD_SET_V2);
-    if(unlikely(!rd)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
-
     st->pluginsd.set = true;
 
     if(unlikely(rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE))) {
@@ -944,23 +1074,6 @@ static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, P
         spinlock_unlock(&rd->destroy_lock);
     }
 
-    timing_step(TIMING_STEP_SET2_LOOKUP_DIMENSION);
-
-    // ------------------------------------------------------------------------
-    // parse the parameters
-
-    collected_number collected_value = (collected_number) str2ll_encoded(collected_str);
-
-    NETDATA_DOUBLE value;
-    if(*value_str == '#')
-        value = (NETDATA_DOUBLE)collected_value;
-    else
-        value = str2ndd_encoded(value_str, NULL);
-
-    SN_FLAGS flags = pluginsd_parse_storage_number_flags(flags_str);
-
-    timing_step(TIMING_STEP_SET2_PARSE);
-
     // ------------------------------------------------------------------------
     // check value and ML
 
@@ -998,15 +1111,23 @@ static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, P
     // ------------------------------------------------------------------------
     // propagate it forward in v2
 
-    if(parser->user.v2.stream_buffer.v2 && parser->user.v2.stream_buffer.begin_v2_added && parser->user.v2.stream_buffer.wb) {
+    if(parser->user.v2.stream_buffer.v2 && parser->user.v2.stream_buffer.begin_v2_added && parser->user.v2.stream_buffer.wb &&
+        !(stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_DELTAS) &&
+          stream_send_rrddim_delta_v2(&parser->user.v2.stream_buffer, rd, collected_value, value, flags))) {
+        bool with_deltas = stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_DELTAS) ? true : false;
+
         // check if receiver and sender have the same number parsing capabilities
-        bool can_copy = stream_has_capability(&parser->user, STREAM_CAP_IEEE754) == stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_IEEE754);
+        // (with deltas, the upstream baseline has to be the value we have, so we print it)
+        bool can_copy = collected_str && value_str && !with_deltas &&
+                        stream_has_capability(&parser->user, STREAM_CAP_IEEE754) == stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_IEEE754);
 
         // check the sender capabilities
         bool with_slots = stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_SLOTS) ? true : false;
         NUMBER_ENCODING integer_encoding = stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_IEEE754) ? NUMBER_ENCODING_BASE64 : NUMBER_ENCODING_HEX;
         NUMBER_ENCODING doubles_encoding = stream_has_capability(&parser->user.v2.stream_buffer, STREAM_CAP_IEEE754) ? NUMBER_ENCODING_BASE64 : NUMBER_ENCODING_DECIMAL;
 
+        stream_send_rrdset_deltas_close(&parser->user.v2.stream_buffer);
+
         BUFFER *wb = parser->user.v2.stream_buffer.wb;
         buffer_need_bytes(wb, 1024);
         buffer_fast_strcat(wb, PLUGINSD_KEYWORD_SET_V2, sizeof(PLUGINSD_KEYWORD_SET_V2) - 1);
@@ -1031,6 +1152,9 @@ static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, P
         buffer_fast_strcat(wb, " ", 1);
         buffer_print_sn_flags(wb, flags, true);
         buffer_fast_strcat(wb, "\n", 1);
+
+        if(with_deltas)
+            stream_send_rrddim_delta_baseline(rd, collected_value, value);
     }
 
     timing_step(TIMING_STEP_SET2_PROPAGATE);
@@ -1048,6 +1172,160 @@ static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, P
     rrddim_set_updated(rd);
 
     timing_step(TIMING_STEP_SET2_STORE);
+}
+
+// the baseline of the SET2B records of a dimension, set by SET2 and by every SET2B
+static ALWAYS_INLINE void pluginsd_set_v2_delta_baseline(struct pluginsd_rrddim *prd, uint32_t connection, collected_number collected_value, NETDATA_DOUBLE value) {
+    prd->delta.connection = connection;
+    prd->delta.collected = collected_value;
+    prd->delta.value = stream_delta_value_bits(collected_value, value);
+}
+
+typedef enum {
+    PLUGINSD_DELTA_OK,
+    PLUGINSD_DELTA_MALFORMED,
+    PLUGINSD_DELTA_NO_BASELINE,
+} PLUGINSD_DELTA_RC;
+
+// decode the next SET2B record at *v, against the baseline of its dimension, and move the baseline to it
+static ALWAYS_INLINE PLUGINSD_DELTA_RC pluginsd_set_v2_block_decode(
+    const unsigned char **v, RRDSET *st, uint32_t connection,
+    struct pluginsd_rrddim **prd_ptr, uint64_t *slot, collected_number *collected_value, NETDATA_DOUBLE *value, SN_FLAGS *flags) {
+
+    uint64_t code, collected_zigzag, value_xor = 0;
+
+    *slot = 0;
+    if(unlikely(!pluginsd_varint_base64_decode(v, slot) ||
+                !pluginsd_varint_base64_decode(v, &code) ||
+                !pluginsd_varint_base64_decode(v, &collected_zigzag) ||
+                (!(code & STREAM_DELTA_FLAG_VALUE_IS_COLLECTED) && !pluginsd_varint_base64_decode(v, &value_xor))))
+        return PLUGINSD_DELTA_MALFORMED;
+
+    struct pluginsd_rrddim *prd = (*slot >= 1 && *slot <= st->pluginsd.size) ? &st->pluginsd.prd_array[*slot - 1] : NULL;
+    if(unlikely(!prd || !prd->rd || prd->delta.connection != connection))
+        return PLUGINSD_DELTA_NO_BASELINE;
+
+    *collected_value = (collected_number)((uint64_t)prd->delta.collected + (uint64_t)pluginsd_zigzag_decode(collected_zigzag));
+
+    if(code & STREAM_DELTA_FLAG_VALUE_IS_COLLECTED)
+        *value = (NETDATA_DOUBLE)*collected_value;
+    else {
+        uint64_t bits = prd->delta.value ^ value_xor;
+        memcpy(value, &bits, sizeof(*value));
+    }
+
+    if(code & STREAM_DELTA_FLAG_EMPTY_SLOT)
+        *flags = SN_EMPTY_SLOT;
+    else {
+        *flags = SN_FLAG_NONE;
+        if(code & STREAM_DELTA_FLAG_NOT_ANOMALOUS)
+            *flags |= SN_FLAG_NOT_ANOMALOUS;
+        if(code & STREAM_DELTA_FLAG_RESET)
+            *flags |= SN_FLAG_RESET;
+    }
+
+    pluginsd_set_v2_delta_baseline(prd, connection, *collected_value, *value);
+    *prd_ptr = prd;
+
+    return PLUGINSD_DELTA_OK;
+}
+
+static ALWAYS_INLINE PARSER_RC pluginsd_set_v2(char **words, size_t num_words, PARSER *parser) {
+    timing_init();
+
+    int idx = 1;
+    ssize_t slot = pluginsd_parse_rrd_slot(words, num_words);
+    if(slot >= 0) idx++;
+
+    char *dimension = get_word(words, num_words, idx++);
+    char *collected_str = get_word(words, num_words, idx++);
+    char *value_str = get_word(words, num_words, idx++);
+    char *flags_str = get_word(words, num_words, idx++);
+
+    if(unlikely(!dimension || !collected_str || !value_str || !flags_str))
+        return PLUGINSD_DISABLE_PLUGIN(parser, PLUGINSD_KEYWORD_SET_V2, "missing parameters");
+
+    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_SET_V2);
+    if(unlikely(!host)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    RRDSET *st = pluginsd_require_scope_chart(parser, PLUGINSD_KEYWORD_SET_V2, PLUGINSD_KEYWORD_BEGIN_V2);
+    if(unlikely(!st)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    timing_step(TIMING_STEP_SET2_PREPARE);
+
+    RRDDIM *rd = pluginsd_acquire_dimension(host, st, dimension, slot, PLUGINSD_KEYWORD_SET_V2);
+    if(unlikely(!rd)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    timing_step(TIMING_STEP_SET2_LOOKUP_DIMENSION);
+
+    // ------------------------------------------------------------------------
+    // parse the parameters
+
+    collected_number collected_value = (collected_number) str2ll_encoded(collected_str);
+
+    NETDATA_DOUBLE value;
+    if(*value_str == '#')
+        value = (NETDATA_DOUBLE)collected_value;
+    else
+        value = str2ndd_encoded(value_str, NULL);
+
+    SN_FLAGS flags = pluginsd_parse_storage_number_flags(flags_str);
+
+    if(stream_has_capability(&parser->user, STREAM_CAP_DELTAS) && st->pluginsd.dims_with_slots && slot >= 1) {
+        // this is the baseline for the SET2B records of this dimension
+        pluginsd_set_v2_delta_baseline(&st->pluginsd.prd_array[slot - 1], host->stream.rcv.status.connections, collected_value, value);
+    }
+
+    timing_step(TIMING_STEP_SET2_PARSE);
+
+    pluginsd_set_v2_store(parser, st, rd, collected_value, value, flags, collected_str, value_str);
+
+    return PARSER_RC_OK;
+}
+
+PARSER_RC pluginsd_set_v2_block(char *line, PARSER *parser) {
+    RRDHOST *host = pluginsd_require_scope_host(parser, PLUGINSD_KEYWORD_SET_V2_BLOCK);
+    if(unlikely(!host)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    RRDSET *st = pluginsd_require_scope_chart(parser, PLUGINSD_KEYWORD_SET_V2_BLOCK, PLUGINSD_KEYWORD_BEGIN_V2);
+    if(unlikely(!st)) return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+    if(unlikely(!st->pluginsd.dims_with_slots)) {
+        netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s, but the chart does not have dimensions with slots.",
+                          rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_V2_BLOCK);
+        return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+    }
+
+    uint32_t connection = host->stream.rcv.status.connections;
+
+    const unsigned char *v = (const unsigned char *)line;
+    while(*v == ' ' || *v == '\t') v++;
+
+    while(*v && *v != ' ' && *v != '\t' && *v != '\r' && *v != '\n') {
+        struct pluginsd_rrddim *prd;
+        uint64_t slot;
+        collected_number collected_value;
+        NETDATA_DOUBLE value;
+        SN_FLAGS flags;
+
+        switch(pluginsd_set_v2_block_decode(&v, st, connection, &prd, &slot, &collected_value, &value, &flags)) {
+            case PLUGINSD_DELTA_OK:
+                break;
+
+            case PLUGINSD_DELTA_MALFORMED:
+                netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a malformed %s.",
+                                  rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_V2_BLOCK);
+                return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+
+            case PLUGINSD_DELTA_NO_BASELINE:
+                // without the baseline we cannot decode it - the child will send SET2 after reconnecting
+                netdata_log_error("PLUGINSD: 'host:%s/chart:%s' got a %s for slot %"PRIu64", without a baseline for it.",
+                                  rrdhost_hostname(host), rrdset_id(st), PLUGINSD_KEYWORD_SET_V2_BLOCK, slot);
+                return PLUGINSD_DISABLE_PLUGIN(parser, NULL, NULL);
+        }
+
+        pluginsd_set_v2_store(parser, st, prd->rd, collected_value, value, flags, NULL, NULL);
+    }
 
     return PARSER_RC_OK;
 }
@@ -1161,6 +1439,11 @@ static void pluginsd_json_ml_model(PARSER *parser, void *action_data __maybe_unu
     buffer_free(parser->defer.response);
 }
 
+static void pluginsd_json_ml_model_packed(PARSER *parser, void *action_data __maybe_unused) {
+    ml_model_packed_received_from_child(parser->user.host, buffer_tostring(parser->defer.response));
+    buffer_free(parser->defer.response);
+}
+
 static void pluginsd_json_dev_null(PARSER *parser, void *action_data __maybe_unused) {
     buffer_free(parser->defer.response);
 }
@@ -1181,6 +1464,8 @@ static PARSER_RC pluginsd_json(char **words __maybe_unused, size_t num_words __m
         parser->defer.action = pluginsd_json_stream_paths;
     else if(strcmp(keyword, PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL) == 0)
         parser->defer.action = pluginsd_json_ml_model;
+    else if(strcmp(keyword, PLUGINSD_KEYWORD_JSON_CMD_ML_MODEL_PACKED) == 0)
+        parser->defer.action = pluginsd_json_ml_model_packed;
     else
         netdata_log_error("PLUGINSD: invalid JSON payload keyword '%s'", keyword);
 
@@ -1196,6 +1481,15 @@ void pluginsd_cleanup_v2(PARSER *parser) {
     pluginsd_clear_scope_chart(parser, "THREAD CLEANUP");
 }
 
+void pluginsd_release_scope_chart(PARSER *parser) {
+    // the chart in scope may be collected by another thread after this
+    RRDSET *st = parser->user.st;
+    if(st && st->pluginsd.collector_tid == gettid_cached())
+        st->pluginsd.collector_tid = 0;
+
+    pluginsd_clear_scope_chart(parser, "SCOPE RELEASE");
+}
+
 void pluginsd_process_cleanup(PARSER *parser) {
     if(!parser) return;
 
@@ -1442,9 +1736,359 @@ void parser_init_repertoire(PARSER *parser, PARSER_REPERTOIRE repertoire) {
         if(gperf_keywords[i].keyword && *gperf_keywords[i].keyword && (parser->repertoire & gperf_keywords[i].repertoire))
             worker_register_job_name(gperf_keywords[i].worker_job_id, gperf_keywords[i].keyword);
     }
+
+    if(parser->repertoire & PARSER_INIT_PLUGINSD)
+        worker_register_job_name(WORKER_PARSER_JOB_SET_BLOCK, PLUGINSD_KEYWORD_SET_BLOCK);
+
+    if(parser->repertoire & PARSER_INIT_STREAMING)
+        worker_register_job_name(WORKER_PARSER_JOB_SET_V2_BLOCK, PLUGINSD_KEYWORD_SET_V2_BLOCK);
+}
+
+static size_t pluginsd_parser_unittest_set_block_values(void) {
+    size_t errors = 0;
+
+    // round trips, including the boundaries of every group of 5 bits
+    int64_t values[] = {
+        0, 1, -1, 15, 16, -16, -17, 511, 512, -512, -513,
+        INT32_MAX, INT32_MIN, (int64_t)INT32_MAX + 1, (int64_t)INT32_MIN - 1,
+        (int64_t)1 << 59, -((int64_t)1 << 59), ((int64_t)1 << 62) - 1, -((int64_t)1 << 62),
+        INT64_MAX - 1, INT64_MAX, INT64_MIN + 1, INT64_MIN,
+    };
+
+    for(size_t i = 0; i < _countof(values) ;i++) {
+        char buf[20];
+        size_t len = pluginsd_varint_base64_encode(buf, values[i]);
+
+        const unsigned char *v = (const unsigned char *)buf;
+        uint64_t u;
+        if(!pluginsd_varint_base64_decode(&v, &u) || v != (const unsigned char *)&buf[len] || pluginsd_zigzag_decode(u) != values[i]) {
+            fprintf(stderr, "SETB: value %"PRId64" encoded as '%s' does not decode back\n", values[i], buf);
+            errors++;
+        }
+
+        if(len > 13) {
+            fprintf(stderr, "SETB: value %"PRId64" encoded as '%s' needs %zu digits\n", values[i], buf, len);
+            errors++;
+        }
+    }
+
+    // the example of the documentation: 0, -1, 1, 16, empty
+    {
+        const unsigned char *v = (const unsigned char *)"ABCgB.";
+        int64_t expected[] = { 0, -1, 1, 16 };
+        for(size_t i = 0; i < _countof(expected) ;i++) {
+            uint64_t u;
+            if(!pluginsd_varint_base64_decode(&v, &u) || pluginsd_zigzag_decode(u) != expected[i]) {
+                fprintf(stderr, "SETB: the example of the documentation does not decode at position %zu\n", i);
+                errors++;
+                break;
+            }
+        }
+        if(*v != PLUGINSD_SET_BLOCK_EMPTY_VALUE) {
+            fprintf(stderr, "SETB: the example of the documentation does not end with an empty value\n");
+            errors++;
+        }
+    }
+
+    // malformed values are rejected
+    const char *malformed[] = {
+        "",                 // no value
+        "!",                // not a base64 digit
+        "g",                // a continuation without a following digit
+        "gg.",              // a continuation followed by an empty value
+        "gggggggggggggB",   // 14 digits
+        "ggggggggggggQ",    // the 13th digit carries bit 64
+        "gggggggggggggA",   // the 13th digit has a continuation
+    };
+
+    for(size_t i = 0; i < _countof(malformed) ;i++) {
+        const unsigned char *v = (const unsigned char *)malformed[i];
+        uint64_t u;
+        if(pluginsd_varint_base64_decode(&v, &u)) {
+            fprintf(stderr, "SETB: malformed value '%s' is accepted as %"PRIu64"\n", malformed[i], u);
+            errors++;
+        }
+    }
+
+    // the largest 13 digit value is accepted
+    {
+        const unsigned char *v = (const unsigned char *)"////////////P";
+        uint64_t u;
+        if(!pluginsd_varint_base64_decode(&v, &u) || u != UINT64_MAX) {
+            fprintf(stderr, "SETB: the maximum value is not decoded\n");
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+// encode SET2B lines with the sender, and decode them with the receiver
+static size_t pluginsd_parser_unittest_set_v2_block_decode_line(BUFFER *wb, RRDSET *st, uint32_t connection, collected_number *collected, NETDATA_DOUBLE *values, SN_FLAGS *flags, size_t dims) {
+    size_t errors = 0, decoded = 0;
+
+    // skip the BEGIN2 line
+    const char *s = strchr(buffer_tostring(wb), '\n');
+    s = s ? s + 1 : "";
+
+    while(*s) {
+        if(strncmp(s, PLUGINSD_KEYWORD_SET_V2_BLOCK " ", sizeof(PLUGINSD_KEYWORD_SET_V2_BLOCK)) != 0) {
+            fprintf(stderr, "SET2B: the line does not start with the keyword: '%s'\n", s);
+            return errors + 1;
+        }
+
+        const unsigned char *v = (const unsigned char *)&s[sizeof(PLUGINSD_KEYWORD_SET_V2_BLOCK)];
+        while(*v && *v != '\n') {
+            struct pluginsd_rrddim *prd;
+            uint64_t slot;
+            collected_number c;
+            NETDATA_DOUBLE n;
+            SN_FLAGS f;
+
+            if(pluginsd_set_v2_block_decode(&v, st, connection, &prd, &slot, &c, &n, &f) != PLUGINSD_DELTA_OK || slot < 1 || slot > dims) {
+                fprintf(stderr, "SET2B: cannot decode record %zu\n", decoded);
+                return errors + 1;
+            }
+
+            size_t d = slot - 1;
+            if(c != collected[d] || memcmp(&n, &values[d], sizeof(n)) != 0 || f != flags[d]) {
+                fprintf(stderr, "SET2B: slot %"PRIu64" decoded as %lld/" NETDATA_DOUBLE_FORMAT "/0x%x, expected %lld/" NETDATA_DOUBLE_FORMAT "/0x%x\n",
+                        slot, (long long)c, n, (unsigned)f, (long long)collected[d], values[d], (unsigned)flags[d]);
+                errors++;
+            }
+            decoded++;
+        }
+
+        if(*v != '\n') {
+            fprintf(stderr, "SET2B: the line is not terminated\n");
+            return errors + 1;
+        }
+        s = (const char *)v + 1;
+    }
+
+    if(decoded != dims) {
+        fprintf(stderr, "SET2B: decoded %zu records, expected %zu\n", decoded, dims);
+        errors++;
+    }
+
+    return errors;
+}
+
+static size_t pluginsd_parser_unittest_set_v2_block(void) {
+    size_t errors = 0;
+
+    // enough dimensions with large deltas to need more than one line
+    const size_t dims = 1000;
+
+    RRDHOST *host = callocz(1, sizeof(RRDHOST));
+    RRDSET *snd = callocz(1, sizeof(RRDSET));
+    RRDSET *rcv = callocz(1, sizeof(RRDSET));
+    RRDDIM *rd = callocz(dims, sizeof(RRDDIM));
+    collected_number *collected = callocz(dims, sizeof(collected_number));
+    NETDATA_DOUBLE *values = callocz(dims, sizeof(NETDATA_DOUBLE));
+    SN_FLAGS *flags = callocz(dims, sizeof(SN_FLAGS));
+
+    snd->rrdhost = host;
+    host->stream.snd.status.connections = 1;
+
+    rcv->pluginsd.dims_with_slots = true;
+    rcv->pluginsd.size = dims;
+    rcv->pluginsd.prd_array = callocz(dims, sizeof(struct pluginsd_rrddim));
+    uint32_t connection = 7;
+
+    RRDSET_STREAM_BUFFER rsb = { .wb = buffer_create(0, NULL) };
+
+    // the baseline is what SET2 carries
+    for(size_t d = 0; d < dims ;d++) {
+        rd[d].rrdset = snd;
+        rd[d].stream.snd.dim_slot = d + 1;
+        rcv->pluginsd.prd_array[d].rd = &rd[d];
+
+        collected[d] = (collected_number)d * 1000;
+        values[d] = (NETDATA_DOUBLE)collected[d];
+        stream_send_rrddim_delta_baseline(&rd[d], collected[d], values[d]);
+        pluginsd_set_v2_delta_baseline(&rcv->pluginsd.prd_array[d], connection, collected[d], values[d]);
+    }
+
+    for(size_t iteration = 0; iteration < 20 ;iteration++) {
+        buffer_flush(rsb.wb);
+        buffer_strcat(rsb.wb, PLUGINSD_KEYWORD_BEGIN_V2 " 'chart' 1 1000 1000\n");
+
+        for(size_t d = 0; d < dims ;d++) {
+            switch((d + iteration) % 6) {
+                case 0: // counters
+                    collected[d] += (collected_number)(d * 13 + iteration);
+                    values[d] = (NETDATA_DOUBLE)collected[d];
+                    flags[d] = SN_DEFAULT_FLAGS;
+                    break;
+
+                case 1: // gauges going down
+                    collected[d] -= (collected_number)(d * 7 + 1);
+                    values[d] = (NETDATA_DOUBLE)collected[d];
+                    flags[d] = SN_FLAG_NONE;
+                    break;
+
+                case 2: // stored values that are not the collected ones
+                    collected[d] += 3;
+                    values[d] = (NETDATA_DOUBLE)collected[d] / 3.0;
+                    flags[d] = SN_DEFAULT_FLAGS;
+                    break;
+
+                case 3: // overflows, jumping between the extremes
+                    collected[d] = (iteration % 2) ? INT64_MAX : INT64_MIN;
+                    values[d] = -0.5;
+                    flags[d] = SN_FLAG_RESET | SN_FLAG_NOT_ANOMALOUS;
+                    break;
+
+                case 4: // gaps
+                    values[d] = (NETDATA_DOUBLE)collected[d];
+                    flags[d] = SN_EMPTY_SLOT;
+                    break;
+
+                default: // unchanged
+                    flags[d] = SN_FLAG_RESET;
+                    break;
+            }
+
+            if(!stream_send_rrddim_delta_v2(&rsb, &rd[d], collected[d], values[d], flags[d])) {
+                fprintf(stderr, "SET2B: the sender needs a SET2 for slot %zu without a reason\n", d + 1);
+                errors++;
+            }
+        }
+        stream_send_rrdset_deltas_close(&rsb);
+
+        if(iteration == 0) {
+            size_t lines = 0;
+            for(const char *s = buffer_tostring(rsb.wb); *s ;s++)
+                if(*s == '\n') lines++;
+
+            if(lines < 3) {
+                fprintf(stderr, "SET2B: %zu bytes are sent in %zu lines\n", buffer_strlen(rsb.wb), lines);
+                errors++;
+            }
+        }
+
+        errors += pluginsd_parser_unittest_set_v2_block_decode_line(rsb.wb, rcv, connection, collected, values, flags, dims);
+    }
+
+    // a new connection of the receiver drops all baselines
+    {
+        const unsigned char *v;
+        buffer_flush(rsb.wb);
+        buffer_strcat(rsb.wb, PLUGINSD_KEYWORD_BEGIN_V2 " 'chart' 1 1020 1020\n");
+        collected[0]++;
+        values[0] = (NETDATA_DOUBLE)collected[0];
+        stream_send_rrddim_delta_v2(&rsb, &rd[0], collected[0], values[0], SN_DEFAULT_FLAGS);
+        stream_send_rrdset_deltas_close(&rsb);
+
+        v = (const unsigned char *)strchr(buffer_tostring(rsb.wb), '\n') + 1 + sizeof(PLUGINSD_KEYWORD_SET_V2_BLOCK);
+        struct pluginsd_rrddim *prd;
+        uint64_t slot;
+        collected_number c;
+        NETDATA_DOUBLE n;
+        SN_FLAGS f;
+        if(pluginsd_set_v2_block_decode(&v, rcv, connection + 1, &prd, &slot, &c, &n, &f) != PLUGINSD_DELTA_NO_BASELINE) {
+            fprintf(stderr, "SET2B: a record is decoded on the baseline of a previous connection\n");
+            errors++;
+        }
+
+        // and records for unknown slots are not accepted
+        const char *unknown_slots[] = {
+            "ABA",      // slot 0
+            "pfBA",     // slot 1001
+        };
+        for(size_t i = 0; i < _countof(unknown_slots) ;i++) {
+            v = (const unsigned char *)unknown_slots[i];
+            if(pluginsd_set_v2_block_decode(&v, rcv, connection, &prd, &slot, &c, &n, &f) != PLUGINSD_DELTA_NO_BASELINE) {
+                fprintf(stderr, "SET2B: a record of slot %"PRIu64" is decoded\n", slot);
+                errors++;
+            }
+        }
+
+        v = (const unsigned char *)"B";
+        if(pluginsd_set_v2_block_decode(&v, rcv, connection, &prd, &slot, &c, &n, &f) != PLUGINSD_DELTA_MALFORMED) {
+            fprintf(stderr, "SET2B: a truncated record is decoded\n");
+            errors++;
+        }
+    }
+
+    // after a gap in the connection, or a new chart definition, the sender falls back to SET2
+    {
+        host->stream.snd.status.connections++;
+        if(stream_send_rrddim_delta_v2(&rsb, &rd[1], collected[1], values[1], SN_DEFAULT_FLAGS)) {
+            fprintf(stderr, "SET2B: the sender uses the baseline of a previous connection\n");
+            errors++;
+        }
+
+        stream_send_rrddim_delta_baseline(&rd[1], collected[1], values[1]);
+        if(!stream_send_rrddim_delta_v2(&rsb, &rd[1], collected[1], values[1], SN_DEFAULT_FLAGS)) {
+            fprintf(stderr, "SET2B: the sender does not use the new baseline\n");
+            errors++;
+        }
+
+        snd->stream.snd.sent_version++;
+        if(stream_send_rrddim_delta_v2(&rsb, &rd[1], collected[1], values[1], SN_DEFAULT_FLAGS)) {
+            fprintf(stderr, "SET2B: the sender uses the baseline of a previous chart definition\n");
+            errors++;
+        }
+
+        rd[2].stream.snd.dim_slot = 0;
+        stream_send_rrddim_delta_baseline(&rd[2], collected[2], values[2]);
+        if(stream_send_rrddim_delta_v2(&rsb, &rd[2], collected[2], values[2], SN_DEFAULT_FLAGS)) {
+            fprintf(stderr, "SET2B: the sender uses a dimension without a slot\n");
+            errors++;
+        }
+    }
+
+    // DELTAS are negotiated only together with the capabilities they depend on
+    {
+        STREAM_CAPABILITIES all = STREAM_CAP_VCAPS | STREAM_CAP_INTERPOLATED | STREAM_CAP_SLOTS | STREAM_CAP_IEEE754 | STREAM_CAP_DELTAS;
+        STREAM_CAPABILITIES required[] = { STREAM_CAP_INTERPOLATED, STREAM_CAP_SLOTS, STREAM_CAP_IEEE754 };
+
+        if(!(convert_stream_version_to_capabilities((int32_t)all, NULL, false) & STREAM_CAP_DELTAS)) {
+            fprintf(stderr, "SET2B: DELTAS are not negotiated with all their requirements\n");
+            errors++;
+        }
+
+        for(size_t i = 0; i < _countof(required) ;i++) {
+            if(convert_stream_version_to_capabilities((int32_t)(all & ~required[i]), NULL, false) & STREAM_CAP_DELTAS) {
+                fprintf(stderr, "SET2B: DELTAS are negotiated without capability 0x%llx\n", (unsigned long long)required[i]);
+                errors++;
+            }
+        }
+
+        if(convert_stream_version_to_capabilities((int32_t)(all & ~STREAM_CAP_DELTAS), NULL, false) & STREAM_CAP_DELTAS) {
+            fprintf(stderr, "SET2B: DELTAS are negotiated with a peer that does not support them\n");
+            errors++;
+        }
+    }
+
+    buffer_free(rsb.wb);
+    freez(rcv->pluginsd.prd_array);
+    freez(flags);
+    freez(values);
+    freez(collected);
+    freez(rd);
+    freez(rcv);
+    freez(snd);
+    freez(host);
+
+    return errors;
 }
 
 int pluginsd_parser_unittest(void) {
+    size_t errors = pluginsd_parser_unittest_set_block_values();
+    if(errors) {
+        netdata_log_error("PLUGINSD: SETB values unittest failed with %zu errors", errors);
+        return 1;
+    }
+
+    errors = pluginsd_parser_unittest_set_v2_block();
+    if(errors) {
+        netdata_log_error("PLUGINSD: SET2B unittest failed with %zu errors", errors);
+        return 1;
+    }
+
     PARSER *p = parser_init(NULL, -1, -1, PARSER_INPUT_SPLIT, NULL);
     pluginsd_keywords_init(p, PARSER_INIT_PLUGINSD | PARSER_INIT_STREAMING);
 
@@ -11,6 +11,10 @@
 
 #define WORKER_PARSER_FIRST_JOB 35
 
+// SETB and SET2B are not in the keywords hashtable, they get the jobs after the last keyword
+#define WORKER_PARSER_JOB_SET_BLOCK (WORKER_PARSER_FIRST_JOB + 41)
+#define WORKER_PARSER_JOB_SET_V2_BLOCK (WORKER_PARSER_FIRST_JOB + 42)
+
 // this has to be in-sync with the same at stream-thread.c
 #define WORKER_RECEIVER_JOB_REPLICATION_COMPLETION 24
 
@@ -146,8 +150,11 @@ PARSER *parser_init(struct parser_user_object *user, int fd_input, int fd_output
 void parser_init_repertoire(PARSER *parser, PARSER_REPERTOIRE repertoire);
 void parser_destroy(PARSER *working_parser);
 void pluginsd_cleanup_v2(PARSER *parser);
+void pluginsd_release_scope_chart(PARSER *parser);
 void pluginsd_keywords_init(PARSER *parser, PARSER_REPERTOIRE repertoire);
 PARSER_RC parser_execute(PARSER *parser, const PARSER_KEYWORD *keyword, char **words, size_t num_words);
+PARSER_RC pluginsd_set_block(char *line, PARSER *parser);
+PARSER_RC pluginsd_set_v2_block(char *line, PARSER *parser);
 
 static inline int find_first_keyword(const char *src, char *dst, int dst_size, bool *isspace_map) {
     const char *s = src, *keyword_start;
@@ -215,6 +222,35 @@ static inline int parser_action(PARSER *parser, char *input) {
         return 0;
     }
 
+    if(input[0] == 'S' && input[1] == 'E' && input[2] == 'T' && input[3] == 'B' &&
+        (input[4] == ' ' || input[4] == '\t') && (parser->repertoire & PARSER_INIT_PLUGINSD)) {
+        // the most frequent command of high cardinality plugins,
+        // it is parsed in place, without splitting the line into words
+        worker_is_busy(WORKER_PARSER_JOB_SET_BLOCK);
+        PARSER_RC rc = pluginsd_set_block(&input[5], parser);
+        worker_is_idle();
+
+        if(rc == PARSER_RC_ERROR)
+            netdata_log_error("PLUGINSD: parser_action('" PLUGINSD_KEYWORD_SET_BLOCK "') failed on line %zu",
+                              parser->line.count);
+
+        return (rc == PARSER_RC_ERROR || rc == PARSER_RC_STOP);
+    }
+
+    if(input[0] == 'S' && input[1] == 'E' && input[2] == 'T' && input[3] == '2' && input[4] == 'B' &&
+        (input[5] == ' ' || input[5] == '\t') && (parser->repertoire & PARSER_INIT_STREAMING)) {
+        // the delta-encoded values of all the dimensions of a BEGIN2, parsed in place
+        worker_is_busy(WORKER_PARSER_JOB_SET_V2_BLOCK);
+        PARSER_RC rc = pluginsd_set_v2_block(&input[6], parser);
+        worker_is_idle();
+
+        if(rc == PARSER_RC_ERROR)
+            netdata_log_error("PLUGINSD: parser_action('" PLUGINSD_KEYWORD_SET_V2_BLOCK "') failed on line %zu",
+                              parser->line.count);
+
+        return (rc == PARSER_RC_ERROR || rc == PARSER_RC_STOP);
+    }
+
     parser->line.num_words = quoted_strings_splitter_pluginsd(input, parser->line.words, PLUGINSD_MAX_WORDS);
     const char *command = get_word(parser->line.words, parser->line.num_words, 0);
 
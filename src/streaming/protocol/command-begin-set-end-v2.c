@@ -4,6 +4,80 @@
 #include "../stream-sender-internals.h"
 #include "plugins.d/pluginsd_internals.h"
 
+static ALWAYS_INLINE void buffer_print_varint_base64(BUFFER *wb, uint64_t u) {
+    buffer_need_bytes(wb, 14);
+
+    char *d = &wb->buffer[wb->len];
+    while(u > 0x1f) {
+        *d++ = base64_digits[(u & 0x1f) | 0x20];
+        u >>= 5;
+    }
+    *d++ = base64_digits[u];
+    *d = '\0';
+
+    wb->len = d - wb->buffer;
+}
+
+void stream_send_rrddim_delta_baseline(RRDDIM *rd, collected_number collected, NETDATA_DOUBLE n) {
+    RRDSET *st = rd->rrdset;
+    rd->stream.snd.delta.connection = __atomic_load_n(&st->rrdhost->stream.snd.status.connections, __ATOMIC_RELAXED);
+    rd->stream.snd.delta.version = rrdset_metadata_upstream_version(st);
+    rd->stream.snd.delta.collected = collected;
+    rd->stream.snd.delta.value = stream_delta_value_bits(collected, n);
+}
+
+// append a SET2B record of the dimension, when the parent has its baseline
+// returns false when a SET2 has to be sent instead
+bool stream_send_rrddim_delta_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, collected_number collected, NETDATA_DOUBLE n, SN_FLAGS flags) {
+    RRDSET *st = rd->rrdset;
+
+    // the parent forgets the baselines when it reconnects, or when it receives the chart definition again
+    if(rd->stream.snd.delta.connection != __atomic_load_n(&st->rrdhost->stream.snd.status.connections, __ATOMIC_RELAXED) ||
+        rd->stream.snd.delta.version != rrdset_metadata_upstream_version(st) ||
+        !rd->stream.snd.dim_slot)
+        return false;
+
+    BUFFER *wb = rsb->wb;
+
+    if(rsb->deltas_line_started_at && wb->len - rsb->deltas_line_started_at > STREAM_DELTAS_MAX_LINE_SIZE)
+        stream_send_rrdset_deltas_close(rsb);
+
+    if(!rsb->deltas_line_started_at) {
+        rsb->deltas_line_started_at = wb->len;
+        buffer_fast_strcat(wb, PLUGINSD_KEYWORD_SET_V2_BLOCK " ", sizeof(PLUGINSD_KEYWORD_SET_V2_BLOCK) - 1 + 1);
+    }
+
+    bool is_collected = (NETDATA_DOUBLE)collected == n;
+
+    uint64_t code = 0;
+    if(is_collected)
+        code |= STREAM_DELTA_FLAG_VALUE_IS_COLLECTED;
+
+    if(flags == SN_EMPTY_SLOT)
+        code |= STREAM_DELTA_FLAG_EMPTY_SLOT;
+    else {
+        if(flags & SN_FLAG_NOT_ANOMALOUS)
+            code |= STREAM_DELTA_FLAG_NOT_ANOMALOUS;
+        if(flags & SN_FLAG_RESET)
+            code |= STREAM_DELTA_FLAG_RESET;
+    }
+
+    int64_t delta = (int64_t)((uint64_t)collected - (uint64_t)rd->stream.snd.delta.collected);
+
+    buffer_print_varint_base64(wb, rd->stream.snd.dim_slot);
+    buffer_print_varint_base64(wb, code);
+    buffer_print_varint_base64(wb, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)); // zigzag
+
+    uint64_t bits = stream_delta_value_bits(collected, n);
+    if(!is_collected)
+        buffer_print_varint_base64(wb, bits ^ rd->stream.snd.delta.value);
+
+    rd->stream.snd.delta.collected = collected;
+    rd->stream.snd.delta.value = bits;
+
+    return true;
+}
+
 void stream_send_rrddim_metrics_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, usec_t point_end_time_ut, NETDATA_DOUBLE n, SN_FLAGS flags) {
     if(!rsb->wb || !rsb->v2 || !netdata_double_isnumber(n) || !does_storage_number_exist(flags))
         return;
@@ -15,8 +89,10 @@ void stream_send_rrddim_metrics_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, usec_t
     time_t point_end_time_s = (time_t)(point_end_time_ut / USEC_PER_SEC);
     if(unlikely(rsb->last_point_end_time_s != point_end_time_s)) {
 
-        if(unlikely(rsb->begin_v2_added))
+        if(unlikely(rsb->begin_v2_added)) {
+            stream_send_rrdset_deltas_close(rsb);
             buffer_fast_strcat(wb, PLUGINSD_KEYWORD_END_V2 "\n", sizeof(PLUGINSD_KEYWORD_END_V2) - 1 + 1);
+        }
 
         buffer_fast_strcat(wb, PLUGINSD_KEYWORD_BEGIN_V2, sizeof(PLUGINSD_KEYWORD_BEGIN_V2) - 1);
 
@@ -42,6 +118,12 @@ void stream_send_rrddim_metrics_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, usec_t
         rsb->begin_v2_added = true;
     }
 
+    bool with_deltas = stream_has_capability(rsb, STREAM_CAP_DELTAS) ? true : false;
+    if(with_deltas && stream_send_rrddim_delta_v2(rsb, rd, rd->collector.last_collected_value, n, flags))
+        return;
+
+    stream_send_rrdset_deltas_close(rsb);
+
     buffer_fast_strcat(wb, PLUGINSD_KEYWORD_SET_V2, sizeof(PLUGINSD_KEYWORD_SET_V2) - 1);
 
     if(with_slots) {
@@ -63,6 +145,9 @@ void stream_send_rrddim_metrics_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, usec_t
     buffer_fast_strcat(wb, " ", 1);
     buffer_print_sn_flags(wb, flags, true);
     buffer_fast_strcat(wb, "\n", 1);
+
+    if(with_deltas)
+        stream_send_rrddim_delta_baseline(rd, rd->collector.last_collected_value, n);
 }
 
 ALWAYS_INLINE void stream_send_rrdset_metrics_finished(RRDSET_STREAM_BUFFER *rsb, RRDSET *st) {
@@ -70,6 +155,8 @@ ALWAYS_INLINE void stream_send_rrdset_metrics_finished(RRDSET_STREAM_BUFFER *rsb
         return;
 
     if(rsb->v2 && rsb->begin_v2_added) {
+        stream_send_rrdset_deltas_close(rsb);
+
         if(unlikely(rsb->rrdset_flags & RRDSET_FLAG_UPSTREAM_SEND_VARIABLES))
             rrdvar_print_to_streaming_custom_chart_variables(st, rsb->wb);
 
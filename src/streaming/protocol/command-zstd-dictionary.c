@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "commands.h"
+#include "../stream-receiver-internals.h"
+#include "../stream-compression/zstd-dictionary.h"
+#include "plugins.d/pluginsd_internals.h"
+
+// send the zstd dictionary we trained for the child, when it does not have it
+void stream_receiver_send_zstd_dictionary_to_child(RRDHOST *host) {
+    if(rrdhost_is_local(host))
+        return;
+
+    uint32_t id = stream_zstd_dictionary_trained_id(host->machine_guid);
+    if(!id)
+        return;
+
+    rrdhost_receiver_lock(host);
+    struct receiver_state *rpt = host->receiver;
+    if(rpt && rpt->zstd_dictionary.supported &&
+        rpt->zstd_dictionary.requested_id != id && rpt->zstd_dictionary.sent_id != id) {
+
+        CLEAN_BUFFER *payload = buffer_create(0, NULL);
+        if(stream_zstd_dictionary_trained_to_json(host->machine_guid, payload, &id)) {
+            CLEAN_BUFFER *wb = buffer_create(buffer_strlen(payload) + 100, NULL);
+            buffer_sprintf(wb, PLUGINSD_KEYWORD_JSON " " PLUGINSD_KEYWORD_JSON_CMD_ZSTD_DICTIONARY "\n%s\n" PLUGINSD_KEYWORD_JSON_END "\n", buffer_tostring(payload));
+
+            if(send_to_plugin(buffer_tostring(wb), __atomic_load_n(&rpt->thread.parser, __ATOMIC_RELAXED), STREAM_TRAFFIC_TYPE_METADATA) > 0)
+                rpt->zstd_dictionary.sent_id = id;
+        }
+    }
+    rrdhost_receiver_unlock(host);
+}
+
+void stream_receiver_send_zstd_dictionary_to_child_by_guid(const char *machine_guid) {
+    if(!rrdhost_root_index)
+        return;
+
+    rrd_rdlock();
+    RRDHOST *host = rrdhost_find_by_guid(machine_guid);
+    if(host)
+        stream_receiver_send_zstd_dictionary_to_child(host);
+    rrd_rdunlock();
+}
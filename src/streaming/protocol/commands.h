@@ -13,13 +13,41 @@ typedef struct rrdset_stream_buffer {
     time_t wall_clock_time;
     RRDSET_FLAGS rrdset_flags;
     time_t last_point_end_time_s;
+    size_t deltas_line_started_at;  // the position of the SET2B line in wb, 0 when there is none open
     BUFFER *wb;
 } RRDSET_STREAM_BUFFER;
 
+// SET2B carries one record per dimension:
+// slot, flags, zigzag(collected - previous collected), and, unless the value
+// is the collected one, bits(value) XOR bits(previous value).
+// All are varints of 5 bits per base64 digit, with 0x20 marking continuation.
+// The previous values are the baseline set by the last SET2 or SET2B of the
+// dimension, on the same connection.
+#define STREAM_DELTA_FLAG_VALUE_IS_COLLECTED    (1 << 0)
+#define STREAM_DELTA_FLAG_NOT_ANOMALOUS         (1 << 1)
+#define STREAM_DELTA_FLAG_RESET                 (1 << 2)
+#define STREAM_DELTA_FLAG_EMPTY_SLOT            (1 << 3)
+
+// the baseline of the value, as the receiver restores it
+// (SET2 and SET2B send '#' or a flag when the value is the collected one)
+static inline uint64_t stream_delta_value_bits(collected_number collected, NETDATA_DOUBLE n) {
+    if((NETDATA_DOUBLE)collected == n)
+        n = (NETDATA_DOUBLE)collected;
+
+    uint64_t bits;
+    memcpy(&bits, &n, sizeof(bits));
+    return bits;
+}
+
+// SET2B lines are split when they grow above this size
+#define STREAM_DELTAS_MAX_LINE_SIZE 4096
+
 RRDSET_STREAM_BUFFER stream_send_metrics_init(RRDSET *st, time_t wall_clock_time);
 
 void stream_sender_get_node_and_claim_id_from_parent(struct sender_state *s, const char *claim_id_str, const char *node_id_str, const char *url);
 void stream_receiver_send_node_and_claim_id_to_child(RRDHOST *host);
+void stream_receiver_send_zstd_dictionary_to_child(RRDHOST *host);
+void stream_receiver_send_zstd_dictionary_to_child_by_guid(const char *machine_guid);
 void stream_sender_clear_parent_claim_id(RRDHOST *host);
 
 void stream_sender_send_claimed_id(RRDHOST *host);
@@ -38,4 +66,14 @@ void stream_send_rrdset_metrics_v1(RRDSET_STREAM_BUFFER *rsb, RRDSET *st);
 void stream_send_rrddim_metrics_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, usec_t point_end_time_ut, NETDATA_DOUBLE n, SN_FLAGS flags);
 void stream_send_rrdset_metrics_finished(RRDSET_STREAM_BUFFER *rsb, RRDSET *st);
 
+bool stream_send_rrddim_delta_v2(RRDSET_STREAM_BUFFER *rsb, RRDDIM *rd, collected_number collected, NETDATA_DOUBLE n, SN_FLAGS flags);
+void stream_send_rrddim_delta_baseline(RRDDIM *rd, collected_number collected, NETDATA_DOUBLE n);
+
+static inline void stream_send_rrdset_deltas_close(RRDSET_STREAM_BUFFER *rsb) {
+    if(rsb->deltas_line_started_at) {
+        buffer_fast_strcat(rsb->wb, "\n", 1);
+        rsb->deltas_line_started_at = 0;
+    }
+}
+
 #endif //NETDATA_STREAMING_PROTCOL_COMMANDS_H
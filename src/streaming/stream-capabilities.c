@@ -36,6 +36,9 @@ static struct {
     {STREAM_CAP_PROGRESS,     "PROGRESS" },
     {STREAM_CAP_NODE_ID,      "NODEID" },
     {STREAM_CAP_PATHS,        "PATHS" },
+    {STREAM_CAP_DELTAS,       "DELTAS" },
+    {STREAM_CAP_ZSTD_DICT,    "ZSTDDICT" },
+    {STREAM_CAP_ML_MODELS_PACKED, "MLMODELSPACKED" },
 
     // terminator
     {0 , NULL },
@@ -106,7 +109,7 @@ STREAM_CAPABILITIES stream_our_capabilities(RRDHOST *host, bool sender) {
         rrdhost_receiver_lock(host);
 
         if (!ml_host_running(host) && !stream_has_capability(host->receiver, STREAM_CAP_ML_MODELS))
-            disabled_capabilities |= STREAM_CAP_ML_MODELS;
+            disabled_capabilities |= STREAM_CAP_ML_MODELS | STREAM_CAP_ML_MODELS_PACKED;
 
         rrdhost_receiver_unlock(host);
 
@@ -114,6 +117,9 @@ STREAM_CAPABILITIES stream_our_capabilities(RRDHOST *host, bool sender) {
             disabled_capabilities |= host->sender->disabled_capabilities;
     }
 
+    if(!stream_send.compression.zstd_dictionary.enabled)
+        disabled_capabilities |= STREAM_CAP_ZSTD_DICT;
+
 //    if(sender) {
 //        if(nd_profile.stream_sender_compression == ND_COMPRESSION_FASTEST)
 //            // lz4 or nothing
@@ -139,6 +145,9 @@ STREAM_CAPABILITIES stream_our_capabilities(RRDHOST *host, bool sender) {
             STREAM_CAP_PATHS |
             STREAM_CAP_IEEE754 |
             STREAM_CAP_ML_MODELS |
+            STREAM_CAP_ML_MODELS_PACKED |
+            STREAM_CAP_DELTAS |
+            STREAM_CAP_ZSTD_DICT_AVAILABLE |
             0) & ~disabled_capabilities;
 }
 
@@ -167,6 +176,18 @@ STREAM_CAPABILITIES convert_stream_version_to_capabilities(int32_t version, RRDH
         // DATA WITH ML requires INTERPOLATED
         common_caps &= ~(STREAM_CAP_ML_MODELS);
 
+    if(!(common_caps & STREAM_CAP_ML_MODELS) || !(common_caps & STREAM_CAP_IEEE754))
+        // packed models carry IEEE754 doubles
+        common_caps &= ~(STREAM_CAP_ML_MODELS_PACKED);
+
+    if(!(common_caps & STREAM_CAP_INTERPOLATED) || !(common_caps & STREAM_CAP_SLOTS) || !(common_caps & STREAM_CAP_IEEE754))
+        // DELTAS are addressed by slot and XOR the bits of IEEE754 doubles
+        common_caps &= ~(STREAM_CAP_DELTAS);
+
+    if(!(common_caps & STREAM_CAP_ZSTD))
+        // dictionaries are used only with ZSTD
+        common_caps &= ~(STREAM_CAP_ZSTD_DICT);
+
     return common_caps;
 }
 
@@ -15,6 +15,8 @@
 #include "zstd.h"
 #endif
 
+#include "zstd-dictionary.h"
+
 #ifdef ENABLE_BROTLI
 #include "brotli.h"
 #endif
@@ -66,6 +68,9 @@ void stream_select_receiver_compression_algorithm(struct receiver_state *rpt) {
     if (!rpt->config.compression.enabled)
         rpt->capabilities &= ~STREAM_CAP_COMPRESSIONS_AVAILABLE;
 
+    // the child can receive our dictionaries, even if it will not use one now
+    rpt->zstd_dictionary.supported = stream_has_capability(rpt, STREAM_CAP_ZSTD_DICT);
+
     // select the right compression before sending our capabilities to the child
     if(stream_has_more_than_one_capability_of(rpt->capabilities, STREAM_CAP_COMPRESSIONS_AVAILABLE)) {
         STREAM_CAPABILITIES compressions = rpt->capabilities & STREAM_CAP_COMPRESSIONS_AVAILABLE;
@@ -84,6 +89,12 @@ void stream_select_receiver_compression_algorithm(struct receiver_state *rpt) {
             }
         }
     }
+
+    // keep ZSTD_DICT only when the child will compress with zstd,
+    // and we still have the dictionary we trained for it
+    if(!stream_has_capability(rpt, STREAM_CAP_ZSTD) ||
+        !stream_zstd_dictionary_trained_exists(rpt->machine_guid, rpt->zstd_dictionary.requested_id))
+        rpt->capabilities &= ~STREAM_CAP_ZSTD_DICT;
 }
 
 bool stream_compression_initialize(struct sender_state *s) {
@@ -105,6 +116,10 @@ bool stream_compression_initialize(struct sender_state *s) {
 
     if(s->thread.compressor.algorithm != COMPRESSION_ALGORITHM_NONE) {
         s->thread.compressor.level = stream_send.compression.levels[s->thread.compressor.algorithm];
+        s->thread.compressor.dictionary_id =
+            (s->thread.compressor.algorithm == COMPRESSION_ALGORITHM_ZSTD && stream_has_capability(s, STREAM_CAP_ZSTD_DICT)) ?
+            s->zstd_dictionary_id : 0;
+        s->thread.compressor.dictionary_key = s->host->machine_guid;
         stream_compressor_init(&s->thread.compressor);
         return true;
     }
@@ -130,6 +145,13 @@ bool stream_decompression_initialize(struct receiver_state *rpt) {
         rpt->thread.compressed.decompressor.algorithm = COMPRESSION_ALGORITHM_NONE;
 
     if(rpt->thread.compressed.decompressor.algorithm != COMPRESSION_ALGORITHM_NONE) {
+        rpt->thread.compressed.decompressor.dictionary_id =
+            (rpt->thread.compressed.decompressor.algorithm == COMPRESSION_ALGORITHM_ZSTD && stream_has_capability(rpt, STREAM_CAP_ZSTD_DICT)) ?
+            rpt->zstd_dictionary.requested_id : 0;
+
+        // we train dictionaries only for children that can receive them
+        rpt->thread.compressed.decompressor.dictionary_key = rpt->zstd_dictionary.supported ? rpt->machine_guid : NULL;
+
         stream_decompressor_init(&rpt->thread.compressed.decompressor);
         return true;
     }
@@ -176,6 +198,58 @@ void stream_compression_deactivate(struct sender_state *s) {
     }
 }
 
+// ----------------------------------------------------------------------------
+// global statistics
+
+static struct {
+    STREAM_COMPRESSION_STATISTICS compress;
+    STREAM_COMPRESSION_STATISTICS decompress;
+} compression_statistics[COMPRESSION_ALGORITHM_MAX] = { 0 };
+
+static inline void compression_statistics_add(STREAM_COMPRESSION_STATISTICS *stats, size_t uncompressed, size_t compressed, usec_t ut) {
+    __atomic_add_fetch(&stats->operations, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->bytes_uncompressed, uncompressed, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->bytes_compressed, compressed, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->usec, ut, __ATOMIC_RELAXED);
+}
+
+static inline void compression_statistics_get(STREAM_COMPRESSION_STATISTICS *dst, STREAM_COMPRESSION_STATISTICS *src) {
+    dst->operations = __atomic_load_n(&src->operations, __ATOMIC_RELAXED);
+    dst->bytes_uncompressed = __atomic_load_n(&src->bytes_uncompressed, __ATOMIC_RELAXED);
+    dst->bytes_compressed = __atomic_load_n(&src->bytes_compressed, __ATOMIC_RELAXED);
+    dst->usec = __atomic_load_n(&src->usec, __ATOMIC_RELAXED);
+}
+
+void stream_compression_statistics(compression_algorithm_t algorithm, STREAM_COMPRESSION_STATISTICS *compress, STREAM_COMPRESSION_STATISTICS *decompress) {
+    if(algorithm >= COMPRESSION_ALGORITHM_MAX)
+        algorithm = COMPRESSION_ALGORITHM_NONE;
+
+    if(compress)
+        compression_statistics_get(compress, &compression_statistics[algorithm].compress);
+
+    if(decompress)
+        compression_statistics_get(decompress, &compression_statistics[algorithm].decompress);
+}
+
+const char *stream_compression_algorithm_name(compression_algorithm_t algorithm) {
+    switch(algorithm) {
+        case COMPRESSION_ALGORITHM_ZSTD:
+            return "zstd";
+
+        case COMPRESSION_ALGORITHM_LZ4:
+            return "lz4";
+
+        case COMPRESSION_ALGORITHM_GZIP:
+            return "gzip";
+
+        case COMPRESSION_ALGORITHM_BROTLI:
+            return "brotli";
+
+        default:
+            return "none";
+    }
+}
+
 // ----------------------------------------------------------------------------
 // compressor public API
 
@@ -243,6 +317,7 @@ void stream_compressor_destroy(struct compressor_state *state) {
 
 size_t stream_compress(struct compressor_state *state, const char *data, size_t size, const char **out) {
     size_t ret = 0;
+    usec_t started_ut = now_monotonic_usec();
 
     switch(state->algorithm) {
 #ifdef ENABLE_ZSTD
@@ -275,6 +350,10 @@ size_t stream_compress(struct compressor_state *state, const char *data, size_t
         return 0;
     }
 
+    if(likely(ret && state->algorithm < COMPRESSION_ALGORITHM_MAX))
+        compression_statistics_add(&compression_statistics[state->algorithm].compress,
+                                   size, ret, now_monotonic_usec() - started_ut);
+
     return ret;
 }
 
@@ -350,6 +429,7 @@ size_t stream_decompress(struct decompressor_state *state, const char *compresse
         fatal("STREAM_DECOMPRESS: asked to decompress new data, while there are unread data in the decompression buffer!");
 
     size_t ret = 0;
+    usec_t started_ut = now_monotonic_usec();
 
     switch(state->algorithm) {
 #ifdef ENABLE_ZSTD
@@ -384,6 +464,16 @@ size_t stream_decompress(struct decompressor_state *state, const char *compresse
         return 0;
     }
 
+    if(likely(ret && state->algorithm < COMPRESSION_ALGORITHM_MAX)) {
+        compression_statistics_add(&compression_statistics[state->algorithm].decompress,
+                                   ret, compressed_size, now_monotonic_usec() - started_ut);
+
+        // parents train the zstd dictionary of each child from what this child sends
+        if(state->dictionary_key)
+            stream_zstd_dictionary_sample(state->dictionary_key, &state->dictionary_chunks,
+                                          state->output.data + state->output.read_pos, ret);
+    }
+
     return ret;
 }
 
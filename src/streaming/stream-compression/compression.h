@@ -84,6 +84,8 @@ struct compressor_state {
     SIMPLE_RING_BUFFER output;
 
     int level;
+    uint32_t dictionary_id;     // the zstd dictionary to compress with, or zero
+    const char *dictionary_key; // the machine guid of the host we stream, the dictionary belongs to it
     void *stream;
 
     struct {
@@ -110,6 +112,9 @@ struct decompressor_state {
 
     SIMPLE_RING_BUFFER output;
 
+    uint32_t dictionary_id;     // the zstd dictionary to decompress with, or zero
+    const char *dictionary_key; // the machine guid of the child, when we train dictionaries for it
+    uint32_t dictionary_chunks; // the chunks decompressed, to sample 1 out of N of them for the dictionary
     void *stream;
 };
 
@@ -171,6 +176,19 @@ static inline size_t stream_decompressor_get(struct decompressor_state *state, c
     return bytes_to_return;
 }
 
+// ----------------------------------------------------------------------------
+// global statistics, per algorithm
+
+typedef struct stream_compression_statistics {
+    uint64_t operations;
+    uint64_t bytes_uncompressed;
+    uint64_t bytes_compressed;
+    uint64_t usec;
+} STREAM_COMPRESSION_STATISTICS;
+
+const char *stream_compression_algorithm_name(compression_algorithm_t algorithm);
+void stream_compression_statistics(compression_algorithm_t algorithm, STREAM_COMPRESSION_STATISTICS *compress, STREAM_COMPRESSION_STATISTICS *decompress);
+
 // ----------------------------------------------------------------------------
 
 struct sender_state;
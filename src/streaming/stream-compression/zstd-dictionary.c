@@ -0,0 +1,937 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "zstd-dictionary.h"
+#include "../stream-conf.h"
+#include "../stream-receiver-internals.h"
+#include "../protocol/commands.h"
+
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+
+#define ZSTD_DICTIONARY_SAMPLE_EVERY 4                          // sample 1 out of this many chunks of each child
+#define ZSTD_DICTIONARY_SAMPLE_MAX_SIZE (4 * 1024)              // the max bytes to keep from each chunk
+#define ZSTD_DICTIONARY_SAMPLES_MAX_SIZE (256 * 1024)           // train when a child has this many bytes
+#define ZSTD_DICTIONARY_SAMPLES_MAX 1024                        // or this many samples
+#define ZSTD_DICTIONARY_SAMPLES_MIN_SIZE (32 * 1024)            // or this many bytes, when it has been sampled
+#define ZSTD_DICTIONARY_SAMPLING_MAX_S 600                      // for this many seconds
+#define ZSTD_DICTIONARY_SAMPLING_ABANDONED_S 60                 // drop the samples of a child that stopped sending
+#define ZSTD_DICTIONARY_SAMPLING_MEMORY_MAX (64 * 1024 * 1024)  // the max memory for the samples of all children
+
+#define ZSTD_DICTIONARY_FILENAME_PREFIX "stream-zstd-dictionary-"
+#define ZSTD_DICTIONARY_TRAINED_SUFFIX "trained.zdict"
+#define ZSTD_DICTIONARY_RECEIVED_SUFFIX "received.zdict"
+
+#define ZSTD_DICTIONARY_JSON_ID "id"
+#define ZSTD_DICTIONARY_JSON_DICTIONARY "dictionary"
+
+struct zstd_dictionary {
+    uint32_t id;
+    size_t size;
+    void *data;
+};
+
+// the dictionaries of a node (the machine guid of a child on the parent,
+// or the machine guid of a host we stream on the child)
+struct zstd_dictionaries {
+    time_t next_s;                      // parent side: do not sample this node before this time
+    struct zstd_dictionary current;
+    struct zstd_dictionary previous;    // parent side: kept for the child, in case it connects with it
+
+    struct {                            // parent side: the samples for the next dictionary of the child
+        char *buf;
+        size_t buf_size;
+        size_t used;
+        size_t *sizes;
+        size_t sizes_size;
+        size_t count;
+        time_t first_s;                 // when the first sample was kept
+        time_t last_s;                  // when the last sample was kept
+        bool ready;                     // waiting for the training thread
+    } samples;
+};
+
+static struct {
+    SPINLOCK spinlock;
+    bool initialized;
+    bool shutdown;
+
+    DICTIONARY *trained;                // parent side, per child
+    DICTIONARY *received;               // child side, per host we stream
+
+    struct {
+        bool enabled;                   // atomic - true when we collect samples
+        size_t memory;                  // the memory of the samples of all children
+        size_t ready;                   // the children waiting for the training thread
+        time_t cleanup_s;               // the last time the samples of abandoned children were freed
+        bool training;                  // the training thread is running
+        ND_THREAD *thread;              // the last training thread
+    } sampling;
+} zd = {
+    .spinlock = SPINLOCK_INITIALIZER,
+};
+
+// ----------------------------------------------------------------------------
+// dictionaries in memory and on disk
+
+static void zstd_dictionary_free(struct zstd_dictionary *d) {
+    freez(d->data);
+    d->data = NULL;
+    d->size = 0;
+    d->id = 0;
+}
+
+static bool zstd_dictionary_set(struct zstd_dictionary *d, const void *data, size_t size) {
+    if(!data || !size || size > STREAM_ZSTD_DICTIONARY_MAX_SIZE)
+        return false;
+
+    uint32_t id = ZDICT_getDictID(data, size);
+    if(!id)
+        return false;
+
+    zstd_dictionary_free(d);
+    d->data = mallocz(size);
+    memcpy(d->data, data, size);
+    d->size = size;
+    d->id = id;
+    return true;
+}
+
+// machine guids are used in filenames, so accept only what a uuid has
+static bool zstd_dictionary_filename(char *dst, size_t dst_size, const char *key, const char *suffix) {
+    if(!key || !*key || strlen(key) >= UUID_STR_LEN)
+        return false;
+
+    for(const char *s = key; *s ;s++)
+        if(!isxdigit((uint8_t)*s) && *s != '-')
+            return false;
+
+    snprintfz(dst, dst_size, "%s/" ZSTD_DICTIONARY_FILENAME_PREFIX "%s-%s", netdata_configured_cache_dir, key, suffix);
+    return true;
+}
+
+static bool zstd_dictionary_load_file(struct zstd_dictionary *d, const char *key, const char *suffix, time_t *mtime_s) {
+    char path[FILENAME_MAX + 1];
+    if(!zstd_dictionary_filename(path, sizeof(path), key, suffix))
+        return false;
+
+    FILE *fp = fopen(path, "rb");
+    if(!fp)
+        return false;
+
+    char *buf = mallocz(STREAM_ZSTD_DICTIONARY_MAX_SIZE + 1);
+    size_t size = fread(buf, 1, STREAM_ZSTD_DICTIONARY_MAX_SIZE + 1, fp);
+
+    struct stat st;
+    if(mtime_s && fstat(fileno(fp), &st) == 0)
+        *mtime_s = st.st_mtime;
+
+    fclose(fp);
+
+    bool ok = zstd_dictionary_set(d, buf, size);
+    freez(buf);
+
+    if(!ok) {
+        nd_log(NDLS_DAEMON, NDLP_WARNING,
+               "STREAM ZSTD DICTIONARY: file '%s' is not a valid zstd dictionary - ignoring it.", path);
+        return false;
+    }
+
+    nd_log(NDLS_DAEMON, NDLP_INFO,
+           "STREAM ZSTD DICTIONARY: loaded dictionary %u (%zu bytes) from '%s'", d->id, d->size, path);
+
+    return true;
+}
+
+static void zstd_dictionary_save_file(const void *data, size_t size, const char *key, const char *suffix) {
+    char path[FILENAME_MAX + 1], tmp[FILENAME_MAX + 1];
+    if(!zstd_dictionary_filename(path, sizeof(path), key, suffix))
+        return;
+
+    snprintfz(tmp, sizeof(tmp), "%s.new", path);
+
+    FILE *fp = fopen(tmp, "wb");
+    if(!fp) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: cannot create file '%s'", tmp);
+        return;
+    }
+
+    bool ok = fwrite(data, 1, size, fp) == size;
+    ok = (fclose(fp) == 0) && ok;
+
+    if(!ok || rename(tmp, path) != 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: cannot save file '%s'", path);
+        unlink(tmp);
+    }
+}
+
+static inline void zstd_dictionary_init(void) {
+    if(unlikely(!__atomic_load_n(&zd.initialized, __ATOMIC_ACQUIRE))) {
+        spinlock_lock(&zd.spinlock);
+        if(!zd.initialized) {
+            zd.trained = dictionary_create_advanced(
+                DICT_OPTION_SINGLE_THREADED | DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_FIXED_SIZE,
+                NULL, sizeof(struct zstd_dictionaries));
+
+            zd.received = dictionary_create_advanced(
+                DICT_OPTION_SINGLE_THREADED | DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_FIXED_SIZE,
+                NULL, sizeof(struct zstd_dictionaries));
+
+            if(stream_send.compression.zstd_dictionary.enabled && !zd.shutdown)
+                __atomic_store_n(&zd.sampling.enabled, true, __ATOMIC_RELAXED);
+
+            __atomic_store_n(&zd.initialized, true, __ATOMIC_RELEASE);
+        }
+        spinlock_unlock(&zd.spinlock);
+    }
+}
+
+// returns the dictionaries of the node, loading them from disk the first time
+// call it without the spinlock - it returns with the spinlock held
+static struct zstd_dictionaries *zstd_dictionaries_lock(DICTIONARY *index, const char *key, const char *suffix) {
+    spinlock_lock(&zd.spinlock);
+    struct zstd_dictionaries *zds = dictionary_get(index, key);
+    if(likely(zds))
+        return zds;
+    spinlock_unlock(&zd.spinlock);
+
+    // file I/O happens without the spinlock
+    struct zstd_dictionaries t = { 0 };
+    time_t mtime_s = 0;
+    if(zstd_dictionary_load_file(&t.current, key, suffix, &mtime_s))
+        t.next_s = mtime_s + stream_send.compression.zstd_dictionary.retrain_every_s;
+
+    spinlock_lock(&zd.spinlock);
+    zds = dictionary_get(index, key);
+    if(!zds)
+        zds = dictionary_set(index, key, &t, sizeof(t));
+    else
+        zstd_dictionary_free(&t.current);
+
+    return zds;
+}
+
+// ----------------------------------------------------------------------------
+// parent side - sampling and training
+//
+// The dictionary of a child is trained only from what this child sends,
+// and it is sent only to this child. All the children are sampled at the
+// same time, each one into its own buffer, at 1 out of ZSTD_DICTIONARY_SAMPLE_EVERY
+// of its own chunks, within ZSTD_DICTIONARY_SAMPLING_MEMORY_MAX for all of them.
+// One thread trains the dictionaries of the children that have enough samples,
+// one after the other.
+
+static inline size_t zstd_dictionary_samples_memory(struct zstd_dictionaries *zds) {
+    return zds->samples.buf_size + zds->samples.sizes_size * sizeof(size_t);
+}
+
+// must be called with the spinlock held
+static void zstd_dictionary_samples_free_unsafe(struct zstd_dictionaries *zds) {
+    zd.sampling.memory -= zstd_dictionary_samples_memory(zds);
+    if(zds->samples.ready)
+        zd.sampling.ready--;
+
+    freez(zds->samples.buf);
+    freez(zds->samples.sizes);
+    memset(&zds->samples, 0, sizeof(zds->samples));
+}
+
+// must be called with the spinlock held
+// frees the samples of the children that stopped sending, at most once per second
+static void zstd_dictionary_samples_cleanup_unsafe(time_t now_s) {
+    if(zd.sampling.cleanup_s == now_s)
+        return;
+
+    zd.sampling.cleanup_s = now_s;
+
+    struct zstd_dictionaries *zds;
+    dfe_start_read(zd.trained, zds) {
+        if(zds->samples.buf && !zds->samples.ready && now_s - zds->samples.last_s >= ZSTD_DICTIONARY_SAMPLING_ABANDONED_S)
+            zstd_dictionary_samples_free_unsafe(zds);
+    }
+    dfe_done(zds);
+}
+
+// must be called with the spinlock held
+// makes room for one more sample of this size, within the memory for the samples of all children
+static bool zstd_dictionary_samples_grow_unsafe(struct zstd_dictionaries *zds, size_t size, time_t now_s) {
+    size_t buf_size = zds->samples.buf_size;
+    while(buf_size < zds->samples.used + size)
+        buf_size = MIN(buf_size ? buf_size * 2 : ZSTD_DICTIONARY_SAMPLE_MAX_SIZE * 4,
+                       ZSTD_DICTIONARY_SAMPLES_MAX_SIZE + ZSTD_DICTIONARY_SAMPLE_MAX_SIZE);
+
+    size_t sizes_size = zds->samples.sizes_size;
+    if(sizes_size <= zds->samples.count)
+        sizes_size = MIN(sizes_size ? sizes_size * 2 : 64, ZSTD_DICTIONARY_SAMPLES_MAX);
+
+    size_t old_memory = zstd_dictionary_samples_memory(zds);
+    size_t new_memory = buf_size + sizes_size * sizeof(size_t);
+    if(new_memory == old_memory)
+        return true;
+
+    if(zd.sampling.memory - old_memory + new_memory > ZSTD_DICTIONARY_SAMPLING_MEMORY_MAX) {
+        zstd_dictionary_samples_cleanup_unsafe(now_s);
+
+        if(zd.sampling.memory - old_memory + new_memory > ZSTD_DICTIONARY_SAMPLING_MEMORY_MAX)
+            return false;
+    }
+
+    if(buf_size != zds->samples.buf_size) {
+        zds->samples.buf = reallocz(zds->samples.buf, buf_size);
+        zds->samples.buf_size = buf_size;
+    }
+
+    if(sizes_size != zds->samples.sizes_size) {
+        zds->samples.sizes = reallocz(zds->samples.sizes, sizes_size * sizeof(size_t));
+        zds->samples.sizes_size = sizes_size;
+    }
+
+    zd.sampling.memory = zd.sampling.memory - old_memory + new_memory;
+    return true;
+}
+
+static void zstd_dictionary_train(const char *key, char *samples, size_t *sizes, size_t count, size_t used, char *dict) {
+    usec_t started_ut = now_monotonic_usec();
+    size_t size = ZDICT_trainFromBuffer(dict, STREAM_ZSTD_DICTIONARY_MAX_SIZE, samples, sizes, (unsigned)count);
+    usec_t ended_ut = now_monotonic_usec();
+
+    bool trained = false;
+    uint32_t id = 0;
+
+    time_t retry_after_s = stream_send.compression.zstd_dictionary.retrain_every_s;
+
+    if(ZDICT_isError(size)) {
+        nd_log(NDLS_DAEMON, NDLP_WARNING,
+               "STREAM ZSTD DICTIONARY: training for node '%s' with %zu samples (%zu bytes) failed: %s",
+               key, count, used, ZDICT_getErrorName(size));
+
+        retry_after_s = MIN(retry_after_s, 3600);
+    }
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+    if(!ZDICT_isError(size)) {
+        struct zstd_dictionary d = { 0 };
+        if(zstd_dictionary_set(&d, dict, size) && d.id != zds->current.id) {
+            zstd_dictionary_free(&zds->previous);
+            zds->previous = zds->current;
+            zds->current = d;
+            id = d.id;
+            trained = true;
+        }
+        else
+            zstd_dictionary_free(&d);
+    }
+
+    zds->next_s = now_realtime_sec() + retry_after_s;
+    spinlock_unlock(&zd.spinlock);
+
+    if(trained) {
+        nd_log(NDLS_DAEMON, NDLP_INFO,
+               "STREAM ZSTD DICTIONARY: trained dictionary %u (%zu bytes) for node '%s' from %zu samples (%zu bytes) in %"PRIu64" ms",
+               id, size, key, count, used, (ended_ut - started_ut) / USEC_PER_MS);
+
+        zstd_dictionary_save_file(dict, size, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+        stream_receiver_send_zstd_dictionary_to_child_by_guid(key);
+    }
+}
+
+static void zstd_dictionary_training_thread(void *ptr __maybe_unused) {
+    char *dict = mallocz(STREAM_ZSTD_DICTIONARY_MAX_SIZE);
+
+    while(true) {
+        char key[UUID_STR_LEN] = "";
+        char *samples = NULL;
+        size_t *sizes = NULL;
+        size_t count = 0, used = 0;
+
+        // take the samples of the next child that is ready
+        spinlock_lock(&zd.spinlock);
+        if(!zd.shutdown && zd.sampling.ready) {
+            struct zstd_dictionaries *zds;
+            dfe_start_read(zd.trained, zds) {
+                if(zds->samples.ready) {
+                    strncpyz(key, zds_dfe.name, sizeof(key) - 1);
+                    samples = zds->samples.buf;
+                    sizes = zds->samples.sizes;
+                    count = zds->samples.count;
+                    used = zds->samples.used;
+
+                    // the buffers are ours now
+                    zds->samples.buf = NULL;
+                    zds->samples.sizes = NULL;
+                    zstd_dictionary_samples_free_unsafe(zds);
+                    break;
+                }
+            }
+            dfe_done(zds);
+        }
+
+        if(!samples) {
+            zd.sampling.training = false;
+            spinlock_unlock(&zd.spinlock);
+            break;
+        }
+        spinlock_unlock(&zd.spinlock);
+
+        zstd_dictionary_train(key, samples, sizes, count, used, dict);
+
+        freez(sizes);
+        freez(samples);
+    }
+
+    freez(dict);
+}
+
+static void zstd_dictionary_training_start(void) {
+    // a previous training thread has exited (one runs at a time),
+    // so it is joined by nd_thread_join_threads() at shutdown - we only keep the last one
+    ND_THREAD *thread = nd_thread_create("STRM_ZDICT", NETDATA_THREAD_OPTION_DONT_LOG, zstd_dictionary_training_thread, NULL);
+
+    spinlock_lock(&zd.spinlock);
+    if(thread)
+        zd.sampling.thread = thread;
+    else
+        // the next sample will try again
+        zd.sampling.training = false;
+    spinlock_unlock(&zd.spinlock);
+}
+
+void stream_zstd_dictionary_sample(const char *key, uint32_t *counter, const char *data, size_t size) {
+    if(!__atomic_load_n(&zd.sampling.enabled, __ATOMIC_RELAXED)) {
+        if(likely(__atomic_load_n(&zd.initialized, __ATOMIC_RELAXED)))
+            return;
+
+        zstd_dictionary_init();
+        return;
+    }
+
+    // the counter belongs to the connection of the child, so that every child is sampled at the same rate
+    if(++(*counter) % ZSTD_DICTIONARY_SAMPLE_EVERY)
+        return;
+
+    if(!key || !*key || !data || !size)
+        return;
+
+    if(size > ZSTD_DICTIONARY_SAMPLE_MAX_SIZE)
+        size = ZSTD_DICTIONARY_SAMPLE_MAX_SIZE;
+
+    time_t now_s = now_realtime_sec();
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+
+    if(!zd.shutdown && now_s >= zds->next_s && !zds->samples.ready) {
+        if(zds->samples.count && now_s - zds->samples.last_s >= ZSTD_DICTIONARY_SAMPLING_ABANDONED_S)
+            // the child stopped sending for a while, start over
+            zstd_dictionary_samples_free_unsafe(zds);
+
+        if(zstd_dictionary_samples_grow_unsafe(zds, size, now_s)) {
+            if(!zds->samples.count)
+                zds->samples.first_s = now_s;
+
+            memcpy(&zds->samples.buf[zds->samples.used], data, size);
+            zds->samples.used += size;
+            zds->samples.sizes[zds->samples.count++] = size;
+            zds->samples.last_s = now_s;
+
+            if(zds->samples.used >= ZSTD_DICTIONARY_SAMPLES_MAX_SIZE ||
+                zds->samples.count >= ZSTD_DICTIONARY_SAMPLES_MAX ||
+                (zds->samples.used >= ZSTD_DICTIONARY_SAMPLES_MIN_SIZE && now_s - zds->samples.first_s >= ZSTD_DICTIONARY_SAMPLING_MAX_S)) {
+                zds->samples.ready = true;
+                zd.sampling.ready++;
+            }
+        }
+    }
+
+    bool start = zd.sampling.ready && !zd.sampling.training && !zd.shutdown;
+    if(start)
+        zd.sampling.training = true;
+
+    spinlock_unlock(&zd.spinlock);
+
+    if(start)
+        zstd_dictionary_training_start();
+}
+
+bool stream_zstd_dictionary_trained_exists(const char *key, uint32_t id) {
+    if(!id || !key || !*key)
+        return false;
+
+    zstd_dictionary_init();
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+    bool rc = zds->current.id == id || zds->previous.id == id;
+    spinlock_unlock(&zd.spinlock);
+
+    return rc;
+}
+
+uint32_t stream_zstd_dictionary_trained_id(const char *key) {
+    if(!key || !*key)
+        return 0;
+
+    zstd_dictionary_init();
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+    uint32_t id = zds->current.id;
+    spinlock_unlock(&zd.spinlock);
+
+    return id;
+}
+
+bool stream_zstd_dictionary_trained_to_json(const char *key, BUFFER *wb, uint32_t *id) {
+    if(!key || !*key)
+        return false;
+
+    zstd_dictionary_init();
+
+    char *encoded = mallocz((STREAM_ZSTD_DICTIONARY_MAX_SIZE + 2) / 3 * 4 + 1);
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+    struct zstd_dictionary *d = &zds->current;
+    uint32_t dict_id = d->id;
+    if(dict_id)
+        netdata_base64_encode((unsigned char *)encoded, d->data, d->size);
+    spinlock_unlock(&zd.spinlock);
+
+    if(!dict_id) {
+        freez(encoded);
+        return false;
+    }
+
+    buffer_json_initialize(wb, "\"", "\"", 0, true, BUFFER_JSON_OPTIONS_MINIFY);
+    buffer_json_member_add_uint64(wb, ZSTD_DICTIONARY_JSON_ID, dict_id);
+    buffer_json_member_add_string(wb, ZSTD_DICTIONARY_JSON_DICTIONARY, encoded);
+    buffer_json_finalize(wb);
+    freez(encoded);
+
+    if(id)
+        *id = dict_id;
+
+    return true;
+}
+
+bool stream_zstd_dictionary_load_decompressor(void *dctx, const char *key, uint32_t id) {
+    if(!id || !key || !*key)
+        return false;
+
+    zstd_dictionary_init();
+
+    size_t ret = 1;
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.trained, key, ZSTD_DICTIONARY_TRAINED_SUFFIX);
+    struct zstd_dictionary *d =
+        zds->current.id == id ? &zds->current :
+        zds->previous.id == id ? &zds->previous : NULL;
+
+    // the dictionary is copied into the context
+    if(d)
+        ret = ZSTD_DCtx_loadDictionary(dctx, d->data, d->size);
+    spinlock_unlock(&zd.spinlock);
+
+    if(ZSTD_isError(ret)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "STREAM ZSTD DICTIONARY: ZSTD_DCtx_loadDictionary() for dictionary %u returned error: %s",
+               id, ZSTD_getErrorName(ret));
+        return false;
+    }
+
+    return d != NULL;
+}
+
+// ----------------------------------------------------------------------------
+// child side
+
+uint32_t stream_zstd_dictionary_received_id(const char *key) {
+    if(!key || !*key)
+        return 0;
+
+    zstd_dictionary_init();
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.received, key, ZSTD_DICTIONARY_RECEIVED_SUFFIX);
+    uint32_t id = zds->current.id;
+    spinlock_unlock(&zd.spinlock);
+
+    return id;
+}
+
+bool stream_zstd_dictionary_received_from_json(const char *key, const char *json) {
+    if(!key || !*key || !json || !*json)
+        return false;
+
+    zstd_dictionary_init();
+
+    CLEAN_JSON_OBJECT *jobj = json_tokener_parse(json);
+    if(!jobj) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: cannot parse json: %s", json);
+        return false;
+    }
+
+    json_object *jid, *jdict;
+    if(!json_object_object_get_ex(jobj, ZSTD_DICTIONARY_JSON_ID, &jid) ||
+        !json_object_object_get_ex(jobj, ZSTD_DICTIONARY_JSON_DICTIONARY, &jdict) ||
+        !json_object_is_type(jdict, json_type_string)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: received json without a dictionary");
+        return false;
+    }
+
+    uint32_t id = (uint32_t)json_object_get_int64(jid);
+    const char *encoded = json_object_get_string(jdict);
+    int encoded_len = json_object_get_string_len(jdict);
+
+    if(encoded_len <= 0 || (size_t)encoded_len > (STREAM_ZSTD_DICTIONARY_MAX_SIZE + 2) / 3 * 4) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: received dictionary %u has invalid size", id);
+        return false;
+    }
+
+    unsigned char *decoded = mallocz((STREAM_ZSTD_DICTIONARY_MAX_SIZE + 2) / 3 * 3 + 3);
+    int size = netdata_base64_decode(decoded, (const unsigned char *)encoded, encoded_len);
+
+    struct zstd_dictionary d = { 0 };
+    if(size <= 0 || !zstd_dictionary_set(&d, decoded, size) || d.id != id) {
+        zstd_dictionary_free(&d);
+        freez(decoded);
+        nd_log(NDLS_DAEMON, NDLP_ERR, "STREAM ZSTD DICTIONARY: received dictionary %u is invalid", id);
+        return false;
+    }
+
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.received, key, ZSTD_DICTIONARY_RECEIVED_SUFFIX);
+    bool changed = zds->current.id != d.id;
+    if(changed) {
+        zstd_dictionary_free(&zds->current);
+        zds->current = d;
+    }
+    else
+        zstd_dictionary_free(&d);
+    spinlock_unlock(&zd.spinlock);
+
+    if(changed) {
+        nd_log(NDLS_DAEMON, NDLP_INFO,
+               "STREAM ZSTD DICTIONARY: received dictionary %u (%d bytes) for node '%s', it will be used on the next connection",
+               id, size, key);
+
+        zstd_dictionary_save_file(decoded, size, key, ZSTD_DICTIONARY_RECEIVED_SUFFIX);
+    }
+
+    freez(decoded);
+    return true;
+}
+
+bool stream_zstd_dictionary_load_compressor(void *cctx, const char *key, uint32_t id) {
+    if(!id || !key || !*key)
+        return false;
+
+    zstd_dictionary_init();
+
+    size_t ret = 1;
+    struct zstd_dictionaries *zds = zstd_dictionaries_lock(zd.received, key, ZSTD_DICTIONARY_RECEIVED_SUFFIX);
+    struct zstd_dictionary *d = zds->current.id == id ? &zds->current : NULL;
+
+    // the dictionary is copied into the context
+    if(d)
+        ret = ZSTD_CCtx_loadDictionary(cctx, d->data, d->size);
+    spinlock_unlock(&zd.spinlock);
+
+    if(ZSTD_isError(ret)) {
+        nd_log(NDLS_DAEMON, NDLP_ERR,
+               "STREAM ZSTD DICTIONARY: ZSTD_CCtx_loadDictionary() for dictionary %u returned error: %s",
+               id, ZSTD_getErrorName(ret));
+        return false;
+    }
+
+    return d != NULL;
+}
+
+#endif // ENABLE_ZSTD
+
+// ----------------------------------------------------------------------------
+
+void stream_zstd_dictionary_shutdown(void) {
+#ifdef ENABLE_ZSTD
+    spinlock_lock(&zd.spinlock);
+    zd.shutdown = true;
+    __atomic_store_n(&zd.sampling.enabled, false, __ATOMIC_RELAXED);
+    ND_THREAD *thread = zd.sampling.thread;
+    zd.sampling.thread = NULL;
+    spinlock_unlock(&zd.spinlock);
+
+    // a training may be running, wait for it
+    nd_thread_join(thread);
+
+    // the samples that have not been used
+    spinlock_lock(&zd.spinlock);
+    if(zd.trained) {
+        struct zstd_dictionaries *zds;
+        dfe_start_read(zd.trained, zds) {
+            zstd_dictionary_samples_free_unsafe(zds);
+        }
+        dfe_done(zds);
+    }
+    spinlock_unlock(&zd.spinlock);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#ifdef ENABLE_ZSTD
+
+#define ZSTD_DICTIONARY_UNITTEST_CHILDREN 8
+#define ZSTD_DICTIONARY_UNITTEST_CHILD_KEY "%08zx-1111-1111-1111-111111111111"
+#define ZSTD_DICTIONARY_UNITTEST_CHILD_SECRET "only_child_%zu_has_this_chart"
+#define ZSTD_DICTIONARY_UNITTEST_UNTRAINED "99999999-9999-9999-9999-999999999999"
+
+static void zstd_dictionary_unittest_message(BUFFER *wb, const char *chart_prefix, size_t counter) {
+    buffer_flush(wb);
+    for(size_t c = 0; c < 20 ;c++) {
+        buffer_sprintf(wb, "BEGIN2 '%s.chart%zu' 1 %zu 1\n", chart_prefix, (counter + c) % 50, 1700000000 + counter);
+        for(size_t d = 0; d < 5 ;d++)
+            buffer_sprintf(wb, "SET2 'dim%zu' %zu %zu.%zu ''\n", d, counter * 7 + d * 13, counter % 1000, d);
+        buffer_strcat(wb, "END2\n");
+    }
+}
+
+// compress messages with the dictionary of the child, and decompress them with the dictionary of the parent
+static size_t zstd_dictionary_unittest_round_trip(const char *key, uint32_t id, uint32_t expected_id) {
+    size_t errors = 0;
+
+    struct compressor_state cctx = {
+        .algorithm = COMPRESSION_ALGORITHM_ZSTD,
+        .level = 3,
+        .dictionary_id = id,
+        .dictionary_key = key,
+    };
+    struct decompressor_state dctx = {
+        .algorithm = COMPRESSION_ALGORITHM_ZSTD,
+        .dictionary_id = id,
+        .dictionary_key = key,
+    };
+
+    stream_compressor_init(&cctx);
+    stream_decompressor_init(&dctx);
+
+    if(cctx.dictionary_id != expected_id || dctx.dictionary_id != expected_id) {
+        fprintf(stderr, "ZSTD DICTIONARY: node '%s' asked for dictionary %u, compressor got %u, decompressor got %u, expected %u\n",
+                key, id, cctx.dictionary_id, dctx.dictionary_id, expected_id);
+        errors++;
+    }
+
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+    for(size_t i = 0; i < 50 && !errors ;i++) {
+        zstd_dictionary_unittest_message(wb, "round.trip", i);
+
+        const char *out;
+        size_t size = stream_compress(&cctx, buffer_tostring(wb), buffer_strlen(wb), &out);
+        size_t dsize = size ? stream_decompress(&dctx, out, size) : 0;
+        if(dsize != buffer_strlen(wb) || memcmp(&dctx.output.data[dctx.output.read_pos], buffer_tostring(wb), dsize) != 0) {
+            fprintf(stderr, "ZSTD DICTIONARY: message %zu of node '%s' does not decompress back\n", i, key);
+            errors++;
+        }
+        dctx.output.read_pos += stream_decompressed_bytes_in_buffer(&dctx);
+    }
+
+    stream_compressor_destroy(&cctx);
+    stream_decompressor_destroy(&dctx);
+
+    return errors;
+}
+
+int stream_zstd_dictionary_unittest(void) {
+    size_t errors = 0;
+
+    char base[] = "/tmp/netdata-zstd-dictionary-XXXXXX";
+    if(!mkdtemp(base))
+        fatal("ZSTD DICTIONARY UNITTEST: cannot create a temporary directory");
+
+    const char *saved_cache_dir = netdata_configured_cache_dir;
+    netdata_configured_cache_dir = base;
+    stream_send.compression.zstd_dictionary.enabled = true;
+
+    // all children send at the same time, each with its own charts and its own connection counter
+    char keys[ZSTD_DICTIONARY_UNITTEST_CHILDREN][UUID_STR_LEN];
+    char secrets[ZSTD_DICTIONARY_UNITTEST_CHILDREN][50];
+    uint32_t counters[ZSTD_DICTIONARY_UNITTEST_CHILDREN] = { 0 };
+    for(size_t c = 0; c < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;c++) {
+        snprintfz(keys[c], sizeof(keys[c]), ZSTD_DICTIONARY_UNITTEST_CHILD_KEY, c + 1);
+        snprintfz(secrets[c], sizeof(secrets[c]), ZSTD_DICTIONARY_UNITTEST_CHILD_SECRET, c);
+    }
+    const char *child_a = keys[0];
+
+    // every child has enough samples after this many chunks, whatever their size
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+    size_t sampled = 0;
+    for(size_t i = 0; i < ZSTD_DICTIONARY_SAMPLE_EVERY * ZSTD_DICTIONARY_SAMPLES_MAX && sampled < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;i++) {
+        sampled = 0;
+        for(size_t c = 0; c < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;c++) {
+            zstd_dictionary_unittest_message(wb, secrets[c], i);
+            stream_zstd_dictionary_sample(keys[c], &counters[c], buffer_tostring(wb), buffer_strlen(wb));
+
+            // the child is either waiting for the training thread, or trained
+            spinlock_lock(&zd.spinlock);
+            struct zstd_dictionaries *zds = zd.trained ? dictionary_get(zd.trained, keys[c]) : NULL;
+            if(zds && (zds->samples.ready || zds->next_s > now_realtime_sec()))
+                sampled++;
+            spinlock_unlock(&zd.spinlock);
+        }
+    }
+
+    // and all of them get a dictionary in bounded time
+    usec_t timeout_ut = now_monotonic_usec() + 60 * USEC_PER_SEC;
+    size_t trained = 0;
+    while(now_monotonic_usec() < timeout_ut) {
+        trained = 0;
+        for(size_t c = 0; c < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;c++)
+            trained += stream_zstd_dictionary_trained_id(keys[c]) ? 1 : 0;
+
+        if(trained == ZSTD_DICTIONARY_UNITTEST_CHILDREN)
+            break;
+
+        sleep_usec(10 * USEC_PER_MS);
+    }
+
+    if(trained != ZSTD_DICTIONARY_UNITTEST_CHILDREN) {
+        fprintf(stderr, "ZSTD DICTIONARY: %zu of %d children got a dictionary (%zu were sampled)\n",
+                trained, ZSTD_DICTIONARY_UNITTEST_CHILDREN, sampled);
+        errors++;
+        goto cleanup;
+    }
+
+    uint32_t id_a = stream_zstd_dictionary_trained_id(child_a);
+
+    // the dictionary of each child has nothing of the others
+    spinlock_lock(&zd.spinlock);
+    for(size_t c = 0; c < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;c++) {
+        struct zstd_dictionaries *zds = dictionary_get(zd.trained, keys[c]);
+        for(size_t o = 0; o < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;o++) {
+            if(o == c) continue;
+
+            if(!zds || memmem(zds->current.data, zds->current.size, secrets[o], strlen(secrets[o])) != NULL) {
+                fprintf(stderr, "ZSTD DICTIONARY: the dictionary of child %zu has data of child %zu\n", c, o);
+                errors++;
+            }
+        }
+    }
+    spinlock_unlock(&zd.spinlock);
+
+    if(stream_zstd_dictionary_trained_id(ZSTD_DICTIONARY_UNITTEST_UNTRAINED) != 0) {
+        fprintf(stderr, "ZSTD DICTIONARY: a child that never sent anything has a dictionary\n");
+        errors++;
+    }
+
+    // negotiation: the parent accepts a dictionary only from the child it was trained for
+    if(!stream_zstd_dictionary_trained_exists(child_a, id_a)) {
+        fprintf(stderr, "ZSTD DICTIONARY: child A cannot use its dictionary\n");
+        errors++;
+    }
+
+    if(stream_zstd_dictionary_trained_exists(ZSTD_DICTIONARY_UNITTEST_UNTRAINED, id_a) ||
+        stream_zstd_dictionary_trained_exists(child_a, id_a + 1) ||
+        stream_zstd_dictionary_trained_exists(child_a, 0)) {
+        fprintf(stderr, "ZSTD DICTIONARY: a dictionary is accepted for the wrong child, or with the wrong id\n");
+        errors++;
+    }
+
+    // the dictionary is shipped to the child as json
+    {
+        CLEAN_BUFFER *json = buffer_create(0, NULL);
+        uint32_t id = 0;
+        if(!stream_zstd_dictionary_trained_to_json(child_a, json, &id) || id != id_a ||
+            !stream_zstd_dictionary_received_from_json(child_a, buffer_tostring(json)) ||
+            stream_zstd_dictionary_received_id(child_a) != id_a) {
+            fprintf(stderr, "ZSTD DICTIONARY: the dictionary of child A is not received by child A\n");
+            errors++;
+        }
+
+        buffer_flush(json);
+        if(stream_zstd_dictionary_trained_to_json(ZSTD_DICTIONARY_UNITTEST_UNTRAINED, json, &id)) {
+            fprintf(stderr, "ZSTD DICTIONARY: there is a dictionary to send to an untrained child\n");
+            errors++;
+        }
+
+        if(stream_zstd_dictionary_received_id(ZSTD_DICTIONARY_UNITTEST_UNTRAINED) != 0) {
+            fprintf(stderr, "ZSTD DICTIONARY: an untrained child has a received dictionary\n");
+            errors++;
+        }
+
+        // a dictionary that does not match its id is rejected
+        buffer_flush(json);
+        stream_zstd_dictionary_trained_to_json(child_a, json, &id);
+        char needle[50], replacement[50];
+        snprintfz(needle, sizeof(needle), "\"id\":%u", id_a);
+        snprintfz(replacement, sizeof(replacement), "\"id\":%u", id_a + 1);
+        char *s = strstr(json->buffer, needle);
+        CLEAN_BUFFER *bad = buffer_create(0, NULL);
+        if(s) {
+            buffer_fast_strcat(bad, json->buffer, s - json->buffer);
+            buffer_strcat(bad, replacement);
+            buffer_strcat(bad, s + strlen(needle));
+        }
+        if(!s || stream_zstd_dictionary_received_from_json(ZSTD_DICTIONARY_UNITTEST_UNTRAINED, buffer_tostring(bad))) {
+            fprintf(stderr, "ZSTD DICTIONARY: a dictionary with a wrong id is accepted\n");
+            errors++;
+        }
+    }
+
+    // both sides use the dictionary, and fall back to no dictionary when one of them does not have it
+    errors += zstd_dictionary_unittest_round_trip(child_a, id_a, id_a);
+    errors += zstd_dictionary_unittest_round_trip(ZSTD_DICTIONARY_UNITTEST_UNTRAINED, id_a, 0);
+    errors += zstd_dictionary_unittest_round_trip(child_a, id_a + 1, 0);
+
+    // the capability needs zstd
+    {
+        STREAM_CAPABILITIES caps = STREAM_CAP_VCAPS | STREAM_CAP_ZSTD | STREAM_CAP_ZSTD_DICT;
+        if(!(convert_stream_version_to_capabilities((int32_t)caps, NULL, false) & STREAM_CAP_ZSTD_DICT) ||
+            (convert_stream_version_to_capabilities((int32_t)(caps & ~STREAM_CAP_ZSTD), NULL, false) & STREAM_CAP_ZSTD_DICT)) {
+            fprintf(stderr, "ZSTD DICTIONARY: the capability is not negotiated together with zstd\n");
+            errors++;
+        }
+    }
+
+    // the dictionaries are saved per node
+    {
+        char path[FILENAME_MAX + 1];
+        struct stat st;
+        if(!zstd_dictionary_filename(path, sizeof(path), child_a, ZSTD_DICTIONARY_TRAINED_SUFFIX) || stat(path, &st) != 0 ||
+            !zstd_dictionary_filename(path, sizeof(path), child_a, ZSTD_DICTIONARY_RECEIVED_SUFFIX) || stat(path, &st) != 0 ||
+            !zstd_dictionary_filename(path, sizeof(path), ZSTD_DICTIONARY_UNITTEST_UNTRAINED, ZSTD_DICTIONARY_TRAINED_SUFFIX) || stat(path, &st) == 0) {
+            fprintf(stderr, "ZSTD DICTIONARY: the dictionary files are not the expected ones\n");
+            errors++;
+        }
+
+        if(zstd_dictionary_filename(path, sizeof(path), "../../etc/passwd", ZSTD_DICTIONARY_TRAINED_SUFFIX)) {
+            fprintf(stderr, "ZSTD DICTIONARY: a node that is not a uuid gets a file\n");
+            errors++;
+        }
+    }
+
+cleanup:
+    // the last training thread is joined
+    stream_zstd_dictionary_shutdown();
+
+    {
+        char path[FILENAME_MAX + 1];
+        const char *suffixes[] = { ZSTD_DICTIONARY_TRAINED_SUFFIX, ZSTD_DICTIONARY_RECEIVED_SUFFIX };
+        for(size_t s = 0; s < _countof(suffixes) ;s++) {
+            for(size_t k = 0; k < ZSTD_DICTIONARY_UNITTEST_CHILDREN ;k++) {
+                if(zstd_dictionary_filename(path, sizeof(path), keys[k], suffixes[s]))
+                    unlink(path);
+            }
+
+            if(zstd_dictionary_filename(path, sizeof(path), ZSTD_DICTIONARY_UNITTEST_UNTRAINED, suffixes[s]))
+                unlink(path);
+        }
+        rmdir(base);
+    }
+
+    netdata_configured_cache_dir = saved_cache_dir;
+
+    fprintf(stderr, "STREAM ZSTD DICTIONARY: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
+
+#else // ENABLE_ZSTD
+
+int stream_zstd_dictionary_unittest(void) {
+    fprintf(stderr, "STREAM ZSTD DICTIONARY: zstd is not available, skipped\n");
+    return 0;
+}
+
+#endif // ENABLE_ZSTD
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_STREAMING_COMPRESSION_ZSTD_DICTIONARY_H
+#define NETDATA_STREAMING_COMPRESSION_ZSTD_DICTIONARY_H
+
+#include "compression.h"
+
+// ZSTD dictionaries for streaming
+//
+// Parents sample the decompressed traffic they receive from a child and
+// periodically train a ZSTD dictionary out of it, for this child only.
+// All children are sampled at the same time, each one at the same rate of
+// its own chunks, within a memory limit. Dictionaries are identified by their
+// ZSTD dictionary id. The parent keeps the current and the previous
+// dictionary of each child, and ships the current one in-band to the child
+// it was trained for - a dictionary carries fragments of the data it was
+// trained on, so it is never shared with other children.
+//
+// Children keep the last dictionary they received for each host they stream
+// and ask for it when they connect (zstd_dict=ID). When the parent still has
+// it, the parent keeps the ZSTD_DICT capability in its response, and both
+// sides load it into their compression contexts for the lifetime of the
+// connection.
+//
+// All functions are keyed by the machine guid of the node that is streamed.
+
+#define STREAM_ZSTD_DICTIONARY_MAX_SIZE (16 * 1024)
+
+#ifdef ENABLE_ZSTD
+
+// parent side
+void stream_zstd_dictionary_sample(const char *key, uint32_t *counter, const char *data, size_t size);
+bool stream_zstd_dictionary_trained_exists(const char *key, uint32_t id);
+uint32_t stream_zstd_dictionary_trained_id(const char *key);
+bool stream_zstd_dictionary_trained_to_json(const char *key, BUFFER *wb, uint32_t *id);
+bool stream_zstd_dictionary_load_decompressor(void *dctx, const char *key, uint32_t id);
+
+// child side
+uint32_t stream_zstd_dictionary_received_id(const char *key);
+bool stream_zstd_dictionary_received_from_json(const char *key, const char *json);
+bool stream_zstd_dictionary_load_compressor(void *cctx, const char *key, uint32_t id);
+
+#else // ENABLE_ZSTD
+
+#define stream_zstd_dictionary_sample(key, counter, data, size) debug_dummy()
+#define stream_zstd_dictionary_trained_exists(key, id) (false)
+#define stream_zstd_dictionary_trained_id(key) (0)
+#define stream_zstd_dictionary_trained_to_json(key, wb, id) (false)
+#define stream_zstd_dictionary_received_id(key) (0)
+#define stream_zstd_dictionary_received_from_json(key, json) (false)
+
+#endif // ENABLE_ZSTD
+
+#endif //NETDATA_STREAMING_COMPRESSION_ZSTD_DICTIONARY_H
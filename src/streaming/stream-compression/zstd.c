@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "zstd.h"
+#include "zstd-dictionary.h"
 
 #ifdef ENABLE_ZSTD
 #include <zstd.h>
@@ -20,6 +21,10 @@ void stream_compressor_init_zstd(struct compressor_state *state) {
         if(ZSTD_isError(ret))
             netdata_log_error("STREAM_COMPRESS: ZSTD_initCStream() returned error: %s", ZSTD_getErrorName(ret));
 
+        // the dictionary is loaded after ZSTD_initCStream(), which resets it
+        if(state->dictionary_id && !stream_zstd_dictionary_load_compressor(state->stream, state->dictionary_key, state->dictionary_id))
+            state->dictionary_id = 0;
+
         // ZSTD_CCtx_setParameter(state->stream, ZSTD_c_compressionLevel, 1);
         // ZSTD_CCtx_setParameter(state->stream, ZSTD_c_strategy, ZSTD_fast);
     }
@@ -101,6 +106,9 @@ void stream_decompressor_init_zstd(struct decompressor_state *state) {
         if(ZSTD_isError(ret))
             netdata_log_error("STREAM_DECOMPRESS: ZSTD_initDStream() returned error: %s", ZSTD_getErrorName(ret));
 
+        if(state->dictionary_id && !stream_zstd_dictionary_load_decompressor(state->stream, state->dictionary_key, state->dictionary_id))
+            state->dictionary_id = 0;
+
         simple_ring_buffer_make_room(&state->output, MAX(COMPRESSION_MAX_CHUNK, ZSTD_DStreamOutSize()));
     }
 }
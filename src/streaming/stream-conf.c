@@ -43,6 +43,9 @@ struct _stream_send stream_send = {
     .replication = {
         .prefetch = 0,
         .threads = 0,
+        .locality_window_s = 600,
+        .max_bytes_per_s = 0,
+        .max_queries_per_s = 0,
     },
 
     .parents = {
@@ -63,7 +66,11 @@ struct _stream_send stream_send = {
             [COMPRESSION_ALGORITHM_LZ4]     = 1,    // 1 (smaller) -  9 (faster)
             [COMPRESSION_ALGORITHM_BROTLI]  = 3,    // 0 (faster)  - 11 (smaller)
             [COMPRESSION_ALGORITHM_GZIP]    = 3,    // 1 (faster)  -  9 (smaller)
-        }
+        },
+        .zstd_dictionary = {
+            .enabled = true,
+            .retrain_every_s = 86400,
+        },
     },
 };
 
@@ -177,6 +184,20 @@ void stream_conf_load() {
         &netdata_config, CONFIG_SECTION_DB, "replication prefetch",
         replication_prefetch_default(), 1, MAX_REPLICATION_PREFETCH);
 
+    stream_send.replication.locality_window_s = inicfg_get_duration_seconds(
+        &netdata_config, CONFIG_SECTION_DB, "replication locality window",
+        stream_send.replication.locality_window_s);
+    if(stream_send.replication.locality_window_s < 1)
+        stream_send.replication.locality_window_s = 1;
+
+    stream_send.replication.max_bytes_per_s = inicfg_get_size_bytes(
+        &netdata_config, CONFIG_SECTION_DB, "replication max bandwidth per second",
+        stream_send.replication.max_bytes_per_s);
+
+    stream_send.replication.max_queries_per_s = inicfg_get_number_range(
+        &netdata_config, CONFIG_SECTION_DB, "replication max queries per second",
+        (long long)stream_send.replication.max_queries_per_s, 0, LLONG_MAX);
+
     stream_send.buffer_max_size = (size_t)inicfg_get_size_bytes(
         &stream_config, CONFIG_SECTION_STREAM, "buffer size",
         stream_send.buffer_max_size);
@@ -199,6 +220,16 @@ void stream_conf_load() {
         &stream_config, CONFIG_SECTION_STREAM, "zstd compression level",
         stream_send.compression.levels[COMPRESSION_ALGORITHM_ZSTD]);
 
+    stream_send.compression.zstd_dictionary.enabled =
+        inicfg_get_boolean(&stream_config, CONFIG_SECTION_STREAM, "zstd dictionaries",
+                           stream_send.compression.zstd_dictionary.enabled);
+
+    stream_send.compression.zstd_dictionary.retrain_every_s = inicfg_get_duration_seconds(
+        &stream_config, CONFIG_SECTION_STREAM, "zstd dictionaries retrain every",
+        stream_send.compression.zstd_dictionary.retrain_every_s);
+    if(stream_send.compression.zstd_dictionary.retrain_every_s < 3600)
+        stream_send.compression.zstd_dictionary.retrain_every_s = 3600;
+
     stream_send.compression.levels[COMPRESSION_ALGORITHM_LZ4] = (int)inicfg_get_number(
         &stream_config, CONFIG_SECTION_STREAM, "lz4 compression acceleration",
         stream_send.compression.levels[COMPRESSION_ALGORITHM_LZ4]);
@@ -28,6 +28,9 @@ struct _stream_send {
     struct {
         size_t prefetch;
         size_t threads;
+        time_t locality_window_s;       // requests starting within the same window are executed together
+        uint64_t max_bytes_per_s;       // the bandwidth budget of replication responses, 0 = unlimited
+        uint64_t max_queries_per_s;     // the dimension queries budget of replication responses, 0 = unlimited
     } replication;
 
     struct {
@@ -43,6 +46,11 @@ struct _stream_send {
     struct {
         bool enabled;
         int levels[COMPRESSION_ALGORITHM_MAX];
+
+        struct {
+            bool enabled;               // train (as a parent) and use (as a child) zstd dictionaries
+            time_t retrain_every_s;
+        } zstd_dictionary;
     } compression;
 };
 extern struct _stream_send stream_send;
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "stream-sender-internals.h"
+#include "stream-compression/zstd-dictionary.h"
 
 static struct {
     const char *response;
@@ -303,6 +304,12 @@ bool stream_connect(struct sender_state *s, uint16_t default_port, time_t timeou
     buffer_sprintf(wb, "&utc_offset=%d", host->utc_offset);
     buffer_sprintf(wb, "&hops=%d", s->hops);
     buffer_sprintf(wb, "&ver=%u", s->capabilities);
+
+    // ask the parent to use the zstd dictionary it has sent us for this host
+    s->zstd_dictionary_id = (s->capabilities & STREAM_CAP_ZSTD_DICT) ? stream_zstd_dictionary_received_id(host->machine_guid) : 0;
+    if(s->zstd_dictionary_id)
+        buffer_sprintf(wb, "&zstd_dict=%u", s->zstd_dictionary_id);
+
     rrdhost_system_info_to_url_encode_stream(wb, host->system_info);
     buffer_key_value_urlencode(wb, "&NETDATA_PROTOCOL_VERSION", STREAMING_PROTOCOL_VERSION);
     buffer_strcat(wb, HTTP_1_1 HTTP_ENDL);
@@ -41,6 +41,69 @@ ALWAYS_INLINE void stream_control_replication_query_finished(void) {
     __atomic_sub_fetch(&sc.replication_runners, 1, __ATOMIC_RELAXED);
 }
 
+// the budget of replication responses, in one second windows
+static struct {
+    SPINLOCK spinlock;
+    time_t window_s;
+    uint64_t bytes;
+    uint64_t queries;
+} replication_budget = {
+    .spinlock = SPINLOCK_INITIALIZER,
+};
+
+static void replication_budget_used_at(time_t now_s, size_t bytes, size_t queries) {
+    if(!stream_send.replication.max_bytes_per_s && !stream_send.replication.max_queries_per_s)
+        return;
+
+    spinlock_lock(&replication_budget.spinlock);
+
+    if(replication_budget.window_s != now_s) {
+        // carry over what exceeded the budget of the previous window,
+        // so that large responses are accounted in full
+        uint64_t max_bytes = stream_send.replication.max_bytes_per_s;
+        uint64_t max_queries = stream_send.replication.max_queries_per_s;
+        bool consecutive = (replication_budget.window_s + 1 == now_s);
+
+        replication_budget.bytes = (consecutive && max_bytes && replication_budget.bytes > max_bytes) ? replication_budget.bytes - max_bytes : 0;
+        replication_budget.queries = (consecutive && max_queries && replication_budget.queries > max_queries) ? replication_budget.queries - max_queries : 0;
+        replication_budget.window_s = now_s;
+    }
+
+    replication_budget.bytes += bytes;
+    replication_budget.queries += queries;
+
+    spinlock_unlock(&replication_budget.spinlock);
+}
+
+static bool replication_budget_available_at(time_t now_s) {
+    uint64_t max_bytes = stream_send.replication.max_bytes_per_s;
+    uint64_t max_queries = stream_send.replication.max_queries_per_s;
+    if(!max_bytes && !max_queries)
+        return true;
+
+    bool ret;
+
+    spinlock_lock(&replication_budget.spinlock);
+    if(replication_budget.window_s != now_s)
+        ret = !(replication_budget.window_s + 1 == now_s &&
+                ((max_bytes && replication_budget.bytes >= 2 * max_bytes) ||
+                 (max_queries && replication_budget.queries >= 2 * max_queries)));
+    else
+        ret = (!max_bytes || replication_budget.bytes < max_bytes) &&
+              (!max_queries || replication_budget.queries < max_queries);
+    spinlock_unlock(&replication_budget.spinlock);
+
+    return ret;
+}
+
+void stream_control_replication_budget_used(size_t bytes, size_t queries) {
+    replication_budget_used_at(now_monotonic_sec(), bytes, queries);
+}
+
+static bool stream_control_replication_within_budget(void) {
+    return replication_budget_available_at(now_monotonic_sec());
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 // user data queries
 
@@ -93,7 +156,8 @@ ALWAYS_INLINE bool stream_control_children_should_be_accepted(void) {
 ALWAYS_INLINE bool stream_control_replication_should_be_running(void) {
     return backfill_runners() == 0 &&
            user_data_query_runners() == 0 &&
-           user_weights_query_runners() == 0;
+           user_weights_query_runners() == 0 &&
+           stream_control_replication_within_budget();
 }
 
 ALWAYS_INLINE bool stream_control_health_should_be_running(void) {
@@ -101,3 +165,79 @@ ALWAYS_INLINE bool stream_control_health_should_be_running(void) {
            // replication_runners() == 0 &&
            (user_data_query_runners() + user_weights_query_runners()) <= 1;
 }
+
+// --------------------------------------------------------------------------------------------------------------------
+// unittest
+
+static size_t replication_budget_unittest_check(const char *step, time_t now_s, bool expected) {
+    bool available = replication_budget_available_at(now_s);
+    if(available == expected)
+        return 0;
+
+    fprintf(stderr, " >>> REPLICATION BUDGET: %s: at %ld the budget is %s, expected %s\n",
+            step, (long)now_s, available ? "available" : "exhausted", expected ? "available" : "exhausted");
+    return 1;
+}
+
+size_t stream_control_replication_budget_unittest(void) {
+    uint64_t saved_max_bytes = stream_send.replication.max_bytes_per_s;
+    uint64_t saved_max_queries = stream_send.replication.max_queries_per_s;
+    size_t errors = 0;
+
+    // unlimited, nothing is accounted
+    stream_send.replication.max_bytes_per_s = 0;
+    stream_send.replication.max_queries_per_s = 0;
+    replication_budget.window_s = 0;
+    replication_budget.bytes = replication_budget.queries = 0;
+    replication_budget_used_at(100, 1000000, 1000000);
+    errors += replication_budget_unittest_check("unlimited", 100, true);
+    errors += (replication_budget.bytes || replication_budget.queries) ? 1 : 0;
+
+    // bandwidth budget
+    stream_send.replication.max_bytes_per_s = 1000;
+    errors += replication_budget_unittest_check("bytes, nothing used", 100, true);
+    replication_budget_used_at(100, 600, 5);
+    errors += replication_budget_unittest_check("bytes, below the budget", 100, true);
+    replication_budget_used_at(100, 500, 5);
+    errors += replication_budget_unittest_check("bytes, above the budget", 100, false);
+
+    // 100 bytes are carried to the next second
+    errors += replication_budget_unittest_check("bytes, next second", 101, true);
+    replication_budget_used_at(101, 950, 0);
+    errors += replication_budget_unittest_check("bytes, carried over", 101, false);
+    errors += replication_budget_unittest_check("bytes, carried over, next second", 102, true);
+
+    // a response of 3 seconds worth of bytes throttles for the next 2 seconds
+    replication_budget_used_at(102, 2950, 0);
+    errors += replication_budget_unittest_check("bytes, large response", 102, false);
+    errors += replication_budget_unittest_check("bytes, large response, +1s", 103, false);
+    replication_budget_used_at(103, 0, 0);
+    errors += replication_budget_unittest_check("bytes, large response, +1s accounted", 103, false);
+    errors += replication_budget_unittest_check("bytes, large response, +2s", 104, false);
+    replication_budget_used_at(104, 0, 0);
+    errors += replication_budget_unittest_check("bytes, large response, +2s accounted", 104, false);
+    errors += replication_budget_unittest_check("bytes, large response, +3s", 105, true);
+
+    // nothing is carried over a gap
+    replication_budget_used_at(105, 5000, 0);
+    errors += replication_budget_unittest_check("bytes, before a gap", 105, false);
+    errors += replication_budget_unittest_check("bytes, after a gap", 107, true);
+    replication_budget_used_at(107, 0, 0);
+    errors += (replication_budget.bytes != 0) ? 1 : 0;
+
+    // queries budget
+    stream_send.replication.max_bytes_per_s = 0;
+    stream_send.replication.max_queries_per_s = 10;
+    replication_budget_used_at(200, 1000000, 9);
+    errors += replication_budget_unittest_check("queries, below the budget", 200, true);
+    replication_budget_used_at(200, 0, 1);
+    errors += replication_budget_unittest_check("queries, at the budget", 200, false);
+    errors += replication_budget_unittest_check("queries, next second", 201, true);
+
+    stream_send.replication.max_bytes_per_s = saved_max_bytes;
+    stream_send.replication.max_queries_per_s = saved_max_queries;
+    replication_budget.window_s = 0;
+    replication_budget.bytes = replication_budget.queries = 0;
+
+    return errors;
+}
@@ -15,6 +15,11 @@ void stream_control_backfill_query_finished(void);
 void stream_control_replication_query_started(void);
 void stream_control_replication_query_finished(void);
 
+// account the bytes and the dimension queries of a replication response
+// against the replication budget (stream_control_replication_should_be_running() checks it)
+void stream_control_replication_budget_used(size_t bytes, size_t queries);
+size_t stream_control_replication_budget_unittest(void);
+
 void stream_control_user_weights_query_started(void);
 void stream_control_user_weights_query_finished(void);
 
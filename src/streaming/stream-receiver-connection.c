@@ -3,6 +3,7 @@
 #include "stream.h"
 #include "stream-thread.h"
 #include "stream-receiver-internals.h"
+#include "stream-receiver-parallel.h"
 #include "stream-replication-sender.h"
 
 #if defined(__APPLE__) && !defined(TCP_KEEPIDLE)
@@ -96,6 +97,8 @@ void stream_receiver_free(struct receiver_state *rpt) {
     string_freez(rpt->config.send.parents);
     string_freez(rpt->config.send.charts_matching);
 
+    stream_receiver_parallel_cleanup(rpt);
+
     buffer_free(rpt->thread.line_buffer);
     rpt->thread.line_buffer = NULL;
 
@@ -417,6 +420,9 @@ int stream_receiver_accept_connection(struct web_client *w, char *decoded_query_
         else if(!strcmp(name, "mc_version"))
             rrdhost_system_info_mc_version_set(rpt->system_info, str2i(value));
 
+        else if(!strcmp(name, "zstd_dict"))
+            rpt->zstd_dictionary.requested_id = (uint32_t)strtoul(value, NULL, 0);
+
         else if(!strcmp(name, "ver") && (rpt->capabilities & STREAM_CAP_INVALID))
             rpt->capabilities = convert_stream_version_to_capabilities(strtoul(value, NULL, 0), NULL, false);
 
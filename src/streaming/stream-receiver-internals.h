@@ -20,6 +20,7 @@ void stream_receiver_log_payload(struct receiver_state *rpt, const char *payload
 #include "plugins.d/plugins_d.h"
 
 struct parser;
+struct stream_receiver_parallel;
 
 struct receiver_state {
     RRDHOST *host;
@@ -65,6 +66,9 @@ struct receiver_state {
         // a single line of input (composed via uncompressed buffer input)
         BUFFER *line_buffer;
 
+        // the lanes for parsing charts in parallel, NULL when parsing serially
+        struct stream_receiver_parallel *parallel;
+
         struct {
             SPINLOCK spinlock;
             struct stream_opcode msg;
@@ -90,6 +94,12 @@ struct receiver_state {
         STREAM_HANDSHAKE reason;
     } exit;
 
+    struct {
+        bool supported;         // the child accepts zstd dictionaries from us
+        uint32_t requested_id;  // the dictionary the child has (zstd_dict=ID on connect)
+        uint32_t sent_id;       // the dictionary we sent to the child during this connection
+    } zstd_dictionary;
+
     struct stream_receiver_config config;
 
 #ifdef NETDATA_LOG_STREAM_RECEIVER
@@ -0,0 +1,749 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "stream-receiver-parallel.h"
+#include "stream-receiver-internals.h"
+#include "plugins.d/pluginsd_parser.h"
+
+struct stream_receiver_parallel_lane {
+    PARSER *parser;
+    BUFFER *wb;                     // the NUL separated lines queued to this lane
+    size_t process_len;             // the bytes of wb to be processed by the current flush
+    bool failed;
+};
+
+struct stream_receiver_parallel {
+    size_t lanes;
+    size_t queued;                                  // the bytes queued in all lanes
+
+    struct stream_receiver_parallel_lane *open;     // the lane of the BEGIN2 being received, NULL when outside a chart
+    size_t open_offset;                             // where the BEGIN2 being received starts in the open lane
+
+    struct stream_receiver_parallel_lane *lane;
+};
+
+struct stream_receiver_parallel_job {
+    struct stream_receiver_parallel_lane **lanes;
+
+    size_t slots;
+    size_t claimed;                 // protected by the spinlock
+    size_t completed;               // atomic
+
+    struct completion completion;
+
+    struct stream_receiver_parallel_job *prev, *next;
+};
+
+static struct {
+    struct completion completion;
+
+    SPINLOCK spinlock;
+    bool running;
+    size_t workers;
+    size_t queue_size;
+    struct stream_receiver_parallel_job *queue;
+} stream_receiver_parallel_globals = {
+    .spinlock = SPINLOCK_INITIALIZER,
+    .queue = NULL,
+};
+
+size_t stream_receiver_parallel_lanes(void) {
+    if(!__atomic_load_n(&stream_receiver_parallel_globals.running, __ATOMIC_ACQUIRE))
+        return 0;
+
+    // the receiver thread processes lanes too
+    return stream_receiver_parallel_globals.workers + 1;
+}
+
+// ----------------------------------------------------------------------------
+// the worker pool
+
+static void stream_receiver_parallel_lane_process(struct stream_receiver_parallel_lane *lane) {
+    char *s = lane->wb->buffer;
+    char *e = &lane->wb->buffer[lane->process_len];
+
+    while(s < e && !lane->failed) {
+        // the parser modifies the line, so get its length first
+        size_t len = strlen(s);
+
+        if(unlikely(parser_action(lane->parser, s)))
+            lane->failed = true;
+
+        s += len + 1;
+    }
+
+    // the next flush may process this lane on another thread
+    pluginsd_release_scope_chart(lane->parser);
+}
+
+static struct stream_receiver_parallel_job *stream_receiver_parallel_claim_slot(struct stream_receiver_parallel_job *only, size_t *slot) {
+    struct stream_receiver_parallel_job *job;
+
+    spinlock_lock(&stream_receiver_parallel_globals.spinlock);
+
+    job = only ? only : stream_receiver_parallel_globals.queue;
+    if(job && job->claimed < job->slots) {
+        *slot = job->claimed++;
+
+        if(job->claimed == job->slots) {
+            // all slots have been claimed, nobody else needs to find it
+            DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(stream_receiver_parallel_globals.queue, job, prev, next);
+            stream_receiver_parallel_globals.queue_size--;
+        }
+    }
+    else
+        job = NULL;
+
+    spinlock_unlock(&stream_receiver_parallel_globals.spinlock);
+
+    return job;
+}
+
+static void stream_receiver_parallel_execute_slot(struct stream_receiver_parallel_job *job, size_t slot) {
+    stream_receiver_parallel_lane_process(job->lanes[slot]);
+
+    // the job is on the stack of the receiver thread,
+    // so we should not touch it after marking it complete
+    if(__atomic_add_fetch(&job->completed, 1, __ATOMIC_ACQ_REL) == job->slots)
+        completion_mark_complete(&job->completion);
+}
+
+static void stream_receiver_parallel_execute(struct stream_receiver_parallel_lane **lanes, size_t slots) {
+    struct stream_receiver_parallel_job job = {
+        .lanes = lanes,
+        .slots = slots,
+        .claimed = 0,
+        .completed = 0,
+    };
+    completion_init(&job.completion);
+
+    spinlock_lock(&stream_receiver_parallel_globals.spinlock);
+    DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(stream_receiver_parallel_globals.queue, &job, prev, next);
+    stream_receiver_parallel_globals.queue_size++;
+    spinlock_unlock(&stream_receiver_parallel_globals.spinlock);
+
+    completion_mark_complete_a_job(&stream_receiver_parallel_globals.completion);
+
+    // the receiver thread processes lanes of its own job too,
+    // so that it progresses even when all the workers are busy
+    size_t slot;
+    while(stream_receiver_parallel_claim_slot(&job, &slot))
+        stream_receiver_parallel_execute_slot(&job, slot);
+
+    completion_wait_for(&job.completion);
+    completion_destroy(&job.completion);
+}
+
+static void stream_receiver_parallel_worker_thread(void *ptr) {
+    bool main_thread = (ptr == (void *)0x01);
+
+    worker_register("STREAMPAR");
+
+    worker_register_job_name(0, "get");
+    worker_register_job_name(1, "parse");
+    worker_register_job_custom_metric(2, "parallel parsing queue size", "batches", WORKER_METRIC_ABSOLUTE);
+
+    size_t job_id = 0;
+    while(!nd_thread_signaled_to_cancel() && service_running(SERVICE_STREAMING)) {
+        worker_is_busy(0);
+
+        size_t slot;
+        struct stream_receiver_parallel_job *job = stream_receiver_parallel_claim_slot(NULL, &slot);
+        if(job) {
+            worker_is_busy(1);
+            stream_receiver_parallel_execute_slot(job, slot);
+            continue;
+        }
+
+        if(main_thread)
+            worker_set_metric(2, (NETDATA_DOUBLE)__atomic_load_n(&stream_receiver_parallel_globals.queue_size, __ATOMIC_RELAXED));
+
+        worker_is_idle();
+        job_id = completion_wait_for_a_job_with_timeout(&stream_receiver_parallel_globals.completion, job_id, 1000);
+    }
+
+    worker_unregister();
+}
+
+void stream_receiver_parallel_thread(void *ptr) {
+    struct netdata_static_thread *static_thread = ptr;
+    if(!static_thread) return;
+
+    nd_thread_tag_set("STREAMPAR[0]");
+
+    completion_init(&stream_receiver_parallel_globals.completion);
+
+    size_t threads = netdata_conf_cpus() / 2;
+    if(threads < 2) threads = 2;
+    if(threads > 32) threads = 32;
+    ND_THREAD *th[threads - 1];
+
+    for(size_t t = 0; t < threads - 1 ;t++) {
+        char tag[15];
+        snprintfz(tag, sizeof(tag), "STREAMPAR[%zu]", t + 1);
+        th[t] = nd_thread_create(tag, NETDATA_THREAD_OPTION_DEFAULT, stream_receiver_parallel_worker_thread, NULL);
+    }
+
+    stream_receiver_parallel_globals.workers = threads;
+    __atomic_store_n(&stream_receiver_parallel_globals.running, true, __ATOMIC_RELEASE);
+
+    stream_receiver_parallel_worker_thread((void *)0x01);
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
+
+    // from now on, receivers process their lanes by themselves
+    __atomic_store_n(&stream_receiver_parallel_globals.running, false, __ATOMIC_RELEASE);
+
+    for(size_t t = 0; t < threads - 1 ;t++) {
+        nd_thread_signal_cancel(th[t]);
+        nd_thread_join(th[t]);
+    }
+
+    // jobs still in the queue are completed by their receivers,
+    // since they keep claiming slots until all are claimed
+
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
+}
+
+// ----------------------------------------------------------------------------
+// the receiver side
+
+void stream_receiver_parallel_init(struct receiver_state *rpt, PARSER *parser) {
+    stream_receiver_parallel_cleanup(rpt);
+
+    size_t lanes = stream_receiver_parallel_lanes();
+    if(lanes < 2)
+        return;
+
+    struct stream_receiver_parallel *srp = callocz(1, sizeof(*srp));
+    srp->lanes = lanes;
+    srp->lane = callocz(lanes, sizeof(*srp->lane));
+
+    for(size_t i = 0; i < lanes ;i++) {
+        PARSER_USER_OBJECT user = {
+            .enabled = parser->user.enabled,
+            .host = parser->user.host,
+            .opaque = parser->user.opaque,
+            .cd = parser->user.cd,
+            .trust_durations = parser->user.trust_durations,
+            .capabilities = parser->user.capabilities,
+#ifdef NETDATA_LOG_STREAM_RECEIVER
+            .rpt = parser->user.rpt,
+#endif
+        };
+
+        // the lanes process only data collections,
+        // they never send anything to the child
+        srp->lane[i].parser = parser_init(&user, -1, -1, PARSER_INPUT_SPLIT, NULL);
+        pluginsd_keywords_init(srp->lane[i].parser, PARSER_INIT_STREAMING);
+
+        srp->lane[i].wb = buffer_create(STREAM_RECEIVER_PARALLEL_MIN_BYTES, NULL);
+    }
+
+    rpt->thread.parallel = srp;
+}
+
+void stream_receiver_parallel_cleanup(struct receiver_state *rpt) {
+    struct stream_receiver_parallel *srp = rpt->thread.parallel;
+    if(!srp) return;
+
+    for(size_t i = 0; i < srp->lanes ;i++) {
+        pluginsd_process_cleanup(srp->lane[i].parser);
+        buffer_free(srp->lane[i].wb);
+    }
+
+    freez(srp->lane);
+    freez(srp);
+    rpt->thread.parallel = NULL;
+}
+
+static ALWAYS_INLINE bool stream_receiver_parallel_is_keyword(const char *s, const char *keyword, size_t len) {
+    return strncmp(s, keyword, len) == 0 &&
+           (s[len] == ' ' || s[len] == '\t' || s[len] == '\r' || s[len] == '\n' || s[len] == '\0');
+}
+
+// find the lane of a BEGIN2 - NULL when the receiver parser has to process it
+static struct stream_receiver_parallel_lane *stream_receiver_parallel_lane_of_chart(struct receiver_state *rpt, struct stream_receiver_parallel *srp, const char *s) {
+    s += sizeof(PLUGINSD_KEYWORD_BEGIN_V2) - 1;
+    while(*s == ' ' || *s == '\t') s++;
+
+    if(strncmp(s, PLUGINSD_KEYWORD_SLOT ":", sizeof(PLUGINSD_KEYWORD_SLOT)) == 0) {
+        uint64_t slot = str2ull_encoded(&s[sizeof(PLUGINSD_KEYWORD_SLOT)]);
+        if(slot) {
+            // the parser grows the chart slots of the host when a slot does not fit,
+            // which is not safe while the lanes use them
+            if(slot > rpt->host->stream.rcv.pluginsd_chart_slots.size)
+                return NULL;
+
+            return &srp->lane[slot % srp->lanes];
+        }
+
+        while(*s && *s != ' ' && *s != '\t') s++;
+        while(*s == ' ' || *s == '\t') s++;
+    }
+
+    // no slots, use the chart id
+    char quote = (*s == '\'' || *s == '"') ? *s++ : '\0';
+    const char *id = s;
+    while(*s && (quote ? *s != quote : (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n'))) s++;
+
+    if(s == id)
+        return NULL;
+
+    return &srp->lane[fnv1a_hash_bin64(id, s - id) % srp->lanes];
+}
+
+static ALWAYS_INLINE void stream_receiver_parallel_queue(struct stream_receiver_parallel *srp, struct stream_receiver_parallel_lane *lane, const char *line, size_t len) {
+    // keep the terminating NUL of the line
+    buffer_memcat(lane->wb, line, len + 1);
+    srp->queued += len + 1;
+}
+
+int stream_receiver_parallel_action(struct receiver_state *rpt, PARSER *parser, char *line, size_t len) {
+    struct stream_receiver_parallel *srp = rpt->thread.parallel;
+
+    // the payload of a deferred keyword belongs to the receiver parser
+    if(unlikely(parser->flags & PARSER_DEFER_UNTIL_KEYWORD))
+        return parser_action(parser, line);
+
+    bool begin2 = stream_receiver_parallel_is_keyword(line, PLUGINSD_KEYWORD_BEGIN_V2, sizeof(PLUGINSD_KEYWORD_BEGIN_V2) - 1);
+
+    if(srp->open) {
+        if(likely(!begin2)) {
+            // everything up to END2 belongs to the chart being received
+            stream_receiver_parallel_queue(srp, srp->open, line, len);
+
+            if(stream_receiver_parallel_is_keyword(line, PLUGINSD_KEYWORD_END_V2, sizeof(PLUGINSD_KEYWORD_END_V2) - 1)) {
+                srp->open = NULL;
+                srp->open_offset = 0;
+
+                if(unlikely(srp->queued > STREAM_RECEIVER_PARALLEL_MAX_BYTES))
+                    return stream_receiver_parallel_flush(rpt, parser);
+            }
+
+            return 0;
+        }
+
+        // a BEGIN2 without an END2, the previous chart ends here
+        srp->open = NULL;
+        srp->open_offset = 0;
+    }
+
+    if(begin2) {
+        struct stream_receiver_parallel_lane *lane = stream_receiver_parallel_lane_of_chart(rpt, srp, line);
+        if(likely(lane)) {
+            srp->open = lane;
+            srp->open_offset = buffer_strlen(lane->wb);
+            stream_receiver_parallel_queue(srp, lane, line, len);
+            return 0;
+        }
+    }
+
+    // everything else is processed in order, after all the charts before it
+    if(unlikely(stream_receiver_parallel_flush(rpt, parser)))
+        return 1;
+
+    return parser_action(parser, line);
+}
+
+int stream_receiver_parallel_flush(struct receiver_state *rpt, PARSER *parser) {
+    struct stream_receiver_parallel *srp = rpt->thread.parallel;
+    if(!srp || !srp->queued)
+        return 0;
+
+    struct stream_receiver_parallel_lane *lanes[srp->lanes];
+    size_t slots = 0, bytes = 0;
+
+    for(size_t i = 0; i < srp->lanes ;i++) {
+        struct stream_receiver_parallel_lane *lane = &srp->lane[i];
+
+        // the chart being received stays in its lane, for the next flush
+        lane->process_len = (lane == srp->open) ? srp->open_offset : buffer_strlen(lane->wb);
+
+        if(lane->process_len) {
+            lanes[slots++] = lane;
+            bytes += lane->process_len;
+        }
+    }
+
+    if(!slots)
+        return 0;
+
+    // the lanes may collect the chart the receiver parser has in scope
+    pluginsd_release_scope_chart(parser);
+
+    if(slots == 1 || bytes < STREAM_RECEIVER_PARALLEL_MIN_BYTES || !stream_receiver_parallel_lanes()) {
+        for(size_t s = 0; s < slots ;s++)
+            stream_receiver_parallel_lane_process(lanes[s]);
+    }
+    else
+        stream_receiver_parallel_execute(lanes, slots);
+
+    int failed = 0;
+    for(size_t s = 0; s < slots ;s++) {
+        struct stream_receiver_parallel_lane *lane = lanes[s];
+
+        if(lane->failed)
+            failed = 1;
+
+        parser->user.data_collections_count += lane->parser->user.data_collections_count;
+        lane->parser->user.data_collections_count = 0;
+
+        size_t remaining = buffer_strlen(lane->wb) - lane->process_len;
+        if(remaining)
+            memmove(lane->wb->buffer, &lane->wb->buffer[lane->process_len], remaining);
+
+        lane->wb->len = remaining;
+        lane->wb->buffer[remaining] = '\0';
+        lane->process_len = 0;
+    }
+
+    srp->open_offset = 0;
+    srp->queued -= bytes;
+
+    return failed;
+}
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS 48
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_DIMS 32
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS 40
+
+// the chart that gets a new dimension half way, and the one sent with a slot
+// that does not fit the chart slots of the host (so it is parsed serially)
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_REDEFINED_CHART 1
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_UNSLOTTED_CHART 2
+#define STREAM_RECEIVER_PARALLEL_UNITTEST_BIG_SLOT 1000000
+
+static struct {
+    struct netdata_static_thread static_thread;
+    ND_THREAD *thread;
+} stream_receiver_parallel_unittest_pool = { 0 };
+
+static bool stream_receiver_parallel_unittest_pool_start(void) {
+    stream_receiver_parallel_unittest_pool.static_thread = (struct netdata_static_thread){
+        .name = "STREAMPAR",
+        .enabled = 1,
+    };
+
+    stream_receiver_parallel_unittest_pool.thread = nd_thread_create(
+        "STREAMPAR[0]", NETDATA_THREAD_OPTION_DEFAULT, stream_receiver_parallel_thread, &stream_receiver_parallel_unittest_pool.static_thread);
+
+    for(size_t i = 0; i < 1000 && !stream_receiver_parallel_lanes() ; i++)
+        sleep_usec(10 * USEC_PER_MS);
+
+    return stream_receiver_parallel_lanes() > 1;
+}
+
+static void stream_receiver_parallel_unittest_pool_stop(void) {
+    if(!stream_receiver_parallel_unittest_pool.thread)
+        return;
+
+    nd_thread_signal_cancel(stream_receiver_parallel_unittest_pool.thread);
+    nd_thread_join(stream_receiver_parallel_unittest_pool.thread);
+    stream_receiver_parallel_unittest_pool.thread = NULL;
+}
+
+static struct receiver_state *stream_receiver_parallel_unittest_receiver(const char *hostname) {
+    nd_uuid_t uuid;
+    char guid[UUID_STR_LEN];
+    uuid_generate(uuid);
+    uuid_unparse_lower(uuid, guid);
+
+    RRDHOST *host = rrdhost_find_or_create(
+        hostname, hostname, guid, os_type,
+        netdata_configured_timezone, netdata_configured_abbrev_timezone, netdata_configured_utc_offset,
+        program_name, NETDATA_VERSION,
+        1, default_rrd_history_entries, RRD_DB_MODE_RAM,
+        false, false, NULL, NULL, NULL,
+        false, 0, 0, NULL, false);
+
+    if(!host)
+        return NULL;
+
+    struct receiver_state *rpt = callocz(1, sizeof(*rpt));
+    rpt->host = host;
+    rpt->thread.cd.filename = string_strdupz("unittest");
+    rpt->thread.cd.update_every = 1;
+
+    PARSER_USER_OBJECT user = {
+        .enabled = true,
+        .host = rpt->host,
+        .opaque = rpt,
+        .cd = &rpt->thread.cd,
+        .trust_durations = 1,
+        .capabilities = STREAM_CAP_V2 | STREAM_CAP_SLOTS,
+    };
+
+    rpt->thread.parser = parser_init(&user, -1, -1, PARSER_INPUT_SPLIT, NULL);
+    pluginsd_keywords_init(rpt->thread.parser, PARSER_INIT_STREAMING);
+
+    return rpt;
+}
+
+static void stream_receiver_parallel_unittest_receiver_free(struct receiver_state *rpt) {
+    if(!rpt) return;
+
+    stream_receiver_parallel_cleanup(rpt);
+    pluginsd_process_cleanup(rpt->thread.parser);
+    string_freez(rpt->thread.cd.filename);
+    freez(rpt);
+}
+
+static void stream_receiver_parallel_unittest_chart_definition(BUFFER *wb, size_t c, size_t dims) {
+    if(c == STREAM_RECEIVER_PARALLEL_UNITTEST_UNSLOTTED_CHART || c % 2)
+        buffer_sprintf(wb, "CHART 'sptest.c%zu' '' 'title' 'units' 'family' 'sptest.ctx' 'line' %zu 1 '' 'unittest' 'parallel'\n", c, 1000 + c);
+    else
+        buffer_sprintf(wb, "CHART SLOT:%zu 'sptest.c%zu' '' 'title' 'units' 'family' 'sptest.ctx' 'line' %zu 1 '' 'unittest' 'parallel'\n", c + 1, c, 1000 + c);
+
+    for(size_t d = 0; d < dims ;d++) {
+        if(c == STREAM_RECEIVER_PARALLEL_UNITTEST_UNSLOTTED_CHART || c % 2)
+            buffer_sprintf(wb, "DIMENSION 'd%zu' '' 'absolute' 1 1 ''\n", d);
+        else
+            buffer_sprintf(wb, "DIMENSION SLOT:%zu 'd%zu' '' 'absolute' 1 1 ''\n", d + 1, d);
+    }
+}
+
+static void stream_receiver_parallel_unittest_chart_collection(BUFFER *wb, size_t c, size_t dims, time_t now_s, collected_number *values) {
+    if(c == STREAM_RECEIVER_PARALLEL_UNITTEST_UNSLOTTED_CHART)
+        buffer_sprintf(wb, "BEGIN2 SLOT:%d 'sptest.c%zu' 1 %lld %lld\n", STREAM_RECEIVER_PARALLEL_UNITTEST_BIG_SLOT, c, (long long)now_s, (long long)now_s);
+    else if(c % 2)
+        buffer_sprintf(wb, "BEGIN2 'sptest.c%zu' 1 %lld %lld\n", c, (long long)now_s, (long long)now_s);
+    else
+        buffer_sprintf(wb, "BEGIN2 SLOT:%zu 'sptest.c%zu' 1 %lld %lld\n", c + 1, c, (long long)now_s, (long long)now_s);
+
+    for(size_t d = 0; d < dims ;d++) {
+        if(c == STREAM_RECEIVER_PARALLEL_UNITTEST_UNSLOTTED_CHART || c % 2)
+            buffer_sprintf(wb, "SET2 'd%zu' %lld # ''\n", d, (long long)values[d]);
+        else
+            buffer_sprintf(wb, "SET2 SLOT:%zu 'd%zu' %lld # ''\n", d + 1, d, (long long)values[d]);
+    }
+
+    buffer_strcat(wb, "END2\n");
+}
+
+static size_t stream_receiver_parallel_unittest_compare(RRDHOST *serial, RRDHOST *parallel, size_t c, size_t dims,
+                                                        collected_number *last, time_t after_s, time_t before_s) {
+    size_t errors = 0;
+    char id[RRD_ID_LENGTH_MAX + 1];
+    snprintfz(id, sizeof(id), "sptest.c%zu", c);
+
+    RRDSET *st_s = rrdset_find(serial, id, false);
+    RRDSET *st_p = rrdset_find(parallel, id, false);
+    if(!st_s || !st_p) {
+        fprintf(stderr, " >>> STREAMPAR: chart '%s' is missing\n", id);
+        return 1;
+    }
+
+    if(st_s->counter_done != st_p->counter_done || !st_s->counter_done) {
+        fprintf(stderr, " >>> STREAMPAR: chart '%s' was collected %u times serially and %u times in parallel\n",
+                id, (unsigned)st_s->counter_done, (unsigned)st_p->counter_done);
+        errors++;
+    }
+
+    for(size_t d = 0; d < dims ;d++) {
+        char dim_id[50];
+        snprintfz(dim_id, sizeof(dim_id), "d%zu", d);
+
+        RRDDIM *rd_s = rrddim_find(st_s, dim_id, false);
+        RRDDIM *rd_p = rrddim_find(st_p, dim_id, false);
+        if(!rd_s || !rd_p) {
+            fprintf(stderr, " >>> STREAMPAR: dimension '%s' of chart '%s' is missing\n", dim_id, id);
+            errors++;
+            continue;
+        }
+
+        // the last values collected are the ones of the last iteration
+        if(rd_s->collector.last_collected_value != last[d] || rd_p->collector.last_collected_value != last[d] ||
+           rd_s->collector.last_stored_value != rd_p->collector.last_stored_value) {
+            fprintf(stderr, " >>> STREAMPAR: dimension '%s' of chart '%s' has last collected value %lld serially and %lld in parallel, expected %lld\n",
+                    dim_id, id, (long long)rd_s->collector.last_collected_value, (long long)rd_p->collector.last_collected_value, (long long)last[d]);
+            errors++;
+        }
+
+        // the stored points are the same
+        struct storage_engine_query_handle h_s = { 0 }, h_p = { 0 };
+        storage_engine_query_init(rd_s->tiers[0].seb, rd_s->tiers[0].smh, &h_s, after_s, before_s, STORAGE_PRIORITY_NORMAL);
+        storage_engine_query_init(rd_p->tiers[0].seb, rd_p->tiers[0].smh, &h_p, after_s, before_s, STORAGE_PRIORITY_NORMAL);
+
+        size_t points = 0;
+        while(!storage_engine_query_is_finished(&h_s) && !storage_engine_query_is_finished(&h_p)) {
+            STORAGE_POINT sp_s = storage_engine_query_next_metric(&h_s);
+            STORAGE_POINT sp_p = storage_engine_query_next_metric(&h_p);
+
+            if(sp_s.start_time_s != sp_p.start_time_s || sp_s.end_time_s != sp_p.end_time_s ||
+               sp_s.count != sp_p.count || sp_s.flags != sp_p.flags ||
+               (sp_s.count && sp_s.sum != sp_p.sum)) {
+                fprintf(stderr, " >>> STREAMPAR: dimension '%s' of chart '%s' stored %f at %lld serially and %f at %lld in parallel\n",
+                        dim_id, id, sp_s.sum, (long long)sp_s.end_time_s, sp_p.sum, (long long)sp_p.end_time_s);
+                errors++;
+                break;
+            }
+
+            if(sp_s.count)
+                points++;
+        }
+
+        if(storage_engine_query_is_finished(&h_s) != storage_engine_query_is_finished(&h_p) || !points) {
+            fprintf(stderr, " >>> STREAMPAR: dimension '%s' of chart '%s' does not have the same points serially and in parallel (%zu points)\n",
+                    dim_id, id, points);
+            errors++;
+        }
+
+        storage_engine_query_finalize(&h_s);
+        storage_engine_query_finalize(&h_p);
+    }
+
+    return errors;
+}
+
+// feed the same interleaved data collections to a receiver that parses them serially
+// and to one that parses them in parallel, and compare the charts of their hosts
+int stream_receiver_parallel_unittest(void) {
+    size_t errors = 0, pool_flushes = 0;
+
+    fprintf(stderr, "\nSTREAMPAR: starting the pool...\n");
+    if(!stream_receiver_parallel_unittest_pool_start()) {
+        fprintf(stderr, " >>> STREAMPAR: the pool did not start\n");
+        stream_receiver_parallel_unittest_pool_stop();
+        return 1;
+    }
+
+    struct receiver_state *serial = stream_receiver_parallel_unittest_receiver("stream-parallel-unittest-serial");
+    struct receiver_state *parallel = stream_receiver_parallel_unittest_receiver("stream-parallel-unittest-parallel");
+    if(!serial || !parallel) {
+        fprintf(stderr, " >>> STREAMPAR: cannot create the test hosts\n");
+        stream_receiver_parallel_unittest_receiver_free(serial);
+        stream_receiver_parallel_unittest_receiver_free(parallel);
+        stream_receiver_parallel_unittest_pool_stop();
+        return 1;
+    }
+
+    stream_receiver_parallel_init(parallel, parallel->thread.parser);
+    if(!parallel->thread.parallel) {
+        fprintf(stderr, " >>> STREAMPAR: the receiver did not get lanes\n");
+        errors++;
+        goto cleanup;
+    }
+
+    // the input: all chart definitions, then the data collections of all charts,
+    // in a different order on every iteration, with a chart redefined half way
+    BUFFER *wb = buffer_create(1024 * 1024, NULL);
+    uint64_t rng = 0x5eed;
+    time_t after_s = now_realtime_sec() - STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS - 10;
+
+    size_t dims[STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS];
+    collected_number last[STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS][STREAM_RECEIVER_PARALLEL_UNITTEST_DIMS + 1];
+    for(size_t c = 0; c < STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS ;c++) {
+        dims[c] = STREAM_RECEIVER_PARALLEL_UNITTEST_DIMS;
+        stream_receiver_parallel_unittest_chart_definition(wb, c, dims[c]);
+    }
+
+    for(size_t i = 0; i < STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS ;i++) {
+        if(i == STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS / 2) {
+            size_t c = STREAM_RECEIVER_PARALLEL_UNITTEST_REDEFINED_CHART;
+            dims[c] = STREAM_RECEIVER_PARALLEL_UNITTEST_DIMS + 1;
+            stream_receiver_parallel_unittest_chart_definition(wb, c, dims[c]);
+        }
+
+        size_t order[STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS];
+        for(size_t c = 0; c < STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS ;c++)
+            order[c] = c;
+
+        for(size_t c = STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS - 1; c > 0 ;c--) {
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t r = (rng >> 33) % (c + 1);
+            size_t t = order[c]; order[c] = order[r]; order[r] = t;
+        }
+
+        for(size_t k = 0; k < STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS ;k++) {
+            size_t c = order[k];
+            for(size_t d = 0; d < dims[c] ;d++) {
+                rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+                last[c][d] = (collected_number)((rng >> 16) % 1000000) - 500000;
+            }
+
+            stream_receiver_parallel_unittest_chart_collection(wb, c, dims[c], after_s + 1 + (time_t)i, last[c]);
+        }
+    }
+
+    fprintf(stderr, "STREAMPAR: parsing %zu bytes serially and with %zu lanes...\n",
+            buffer_strlen(wb), parallel->thread.parallel->lanes);
+
+    // feed the lines, flushing the lanes at reads of random sizes
+    size_t lines = 0, next_flush = 0;
+    char serial_line[PLUGINSD_LINE_MAX + 1];
+    char parallel_line[PLUGINSD_LINE_MAX + 1];
+
+    char *s = wb->buffer;
+    while(*s && !errors) {
+        char *nl = strchr(s, '\n');
+        size_t len = nl ? (size_t)(nl - s) + 1 : strlen(s);
+
+        memcpy(serial_line, s, len);
+        serial_line[len] = '\0';
+        memcpy(parallel_line, s, len);
+        parallel_line[len] = '\0';
+        s += len;
+
+        if(parser_action(serial->thread.parser, serial_line)) {
+            fprintf(stderr, " >>> STREAMPAR: the serial parser failed on line %zu\n", lines);
+            errors++;
+        }
+
+        if(stream_receiver_parallel_action(parallel, parallel->thread.parser, parallel_line, len)) {
+            fprintf(stderr, " >>> STREAMPAR: the parallel parser failed on line %zu\n", lines);
+            errors++;
+        }
+
+        if(++lines >= next_flush) {
+            if(parallel->thread.parallel->queued >= STREAM_RECEIVER_PARALLEL_MIN_BYTES)
+                pool_flushes++;
+
+            if(stream_receiver_parallel_flush(parallel, parallel->thread.parser)) {
+                fprintf(stderr, " >>> STREAMPAR: flushing the lanes failed after line %zu\n", lines);
+                errors++;
+            }
+
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            next_flush = lines + 1 + (rng >> 33) % 8000;
+        }
+    }
+
+    if(stream_receiver_parallel_flush(parallel, parallel->thread.parser)) {
+        fprintf(stderr, " >>> STREAMPAR: flushing the lanes failed at the end\n");
+        errors++;
+    }
+
+    pluginsd_release_scope_chart(serial->thread.parser);
+    pluginsd_release_scope_chart(parallel->thread.parser);
+
+    if(!pool_flushes) {
+        fprintf(stderr, " >>> STREAMPAR: no flush was big enough for the pool\n");
+        errors++;
+    }
+
+    size_t collections = STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS * STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS;
+    if(serial->thread.parser->user.data_collections_count != collections ||
+       parallel->thread.parser->user.data_collections_count != collections) {
+        fprintf(stderr, " >>> STREAMPAR: %zu data collections parsed serially and %zu in parallel, expected %zu\n",
+                serial->thread.parser->user.data_collections_count,
+                parallel->thread.parser->user.data_collections_count, collections);
+        errors++;
+    }
+
+    for(size_t c = 0; c < STREAM_RECEIVER_PARALLEL_UNITTEST_CHARTS && !errors ;c++)
+        errors += stream_receiver_parallel_unittest_compare(serial->host, parallel->host, c, dims[c], last[c],
+                                                            after_s, after_s + STREAM_RECEIVER_PARALLEL_UNITTEST_ITERATIONS);
+
+    buffer_free(wb);
+
+cleanup:
+    stream_receiver_parallel_unittest_receiver_free(serial);
+    stream_receiver_parallel_unittest_receiver_free(parallel);
+    stream_receiver_parallel_unittest_pool_stop();
+
+    fprintf(stderr, "STREAMPAR: %s (%zu errors, %zu flushes on the pool)\n",
+            errors ? "FAILED" : "OK", errors, pool_flushes);
+    return errors ? 1 : 0;
+}
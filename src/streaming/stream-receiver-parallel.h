@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_STREAM_RECEIVER_PARALLEL_H
+#define NETDATA_STREAM_RECEIVER_PARALLEL_H
+
+#include "libnetdata/libnetdata.h"
+
+// Parallel parsing of a single receiver connection
+//
+// The receiver splits its decompressed input at BEGIN2/END2 chart boundaries
+// and queues the data collections of the charts to lanes. A chart is always
+// queued to the same lane and each lane has its own parser, so the data
+// collections of each chart are processed in the order they were received.
+//
+// All other keywords (definitions, replication, functions, etc) are processed
+// by the receiver's own parser, after all the lanes have been processed, so
+// they remain serialized with the data collections around them.
+
+// when less than this is queued, the receiver thread processes all lanes by itself
+#define STREAM_RECEIVER_PARALLEL_MIN_BYTES (64 * 1024)
+
+// when more than this is queued, the lanes are processed before reading more
+#define STREAM_RECEIVER_PARALLEL_MAX_BYTES (4 * 1024 * 1024)
+
+struct receiver_state;
+struct parser;
+
+// the number of lanes a receiver can use (including the receiver thread)
+// zero when the pool is not running
+size_t stream_receiver_parallel_lanes(void);
+
+void stream_receiver_parallel_init(struct receiver_state *rpt, struct parser *parser);
+void stream_receiver_parallel_cleanup(struct receiver_state *rpt);
+
+// like parser_action(), returns non-zero when the receiver should be disconnected
+int stream_receiver_parallel_action(struct receiver_state *rpt, struct parser *parser, char *line, size_t len);
+
+// process all complete chart batches queued, returns non-zero on parser failures
+int stream_receiver_parallel_flush(struct receiver_state *rpt, struct parser *parser);
+
+void stream_receiver_parallel_thread(void *ptr);
+
+int stream_receiver_parallel_unittest(void);
+
+#endif //NETDATA_STREAM_RECEIVER_PARALLEL_H
@@ -3,6 +3,7 @@
 #include "stream.h"
 #include "stream-thread.h"
 #include "stream-receiver-internals.h"
+#include "stream-receiver-parallel.h"
 
 #ifdef NETDATA_LOG_STREAM_RECEIVER
 void stream_receiver_log_payload(struct receiver_state *rpt, const char *payload, STREAM_TRAFFIC_TYPE type __maybe_unused, bool inbound) {
@@ -471,6 +472,8 @@ void stream_receiver_move_to_running_unsafe(struct stream_thread *sth, struct re
         pluginsd_keywords_init(parser, PARSER_INIT_STREAMING);
 
         __atomic_store_n(&rpt->thread.parser, parser, __ATOMIC_RELAXED);
+
+        stream_receiver_parallel_init(rpt, parser);
     }
 
     if(stream_receive.replication.enabled)
@@ -480,6 +483,7 @@ void stream_receiver_move_to_running_unsafe(struct stream_thread *sth, struct re
 
     // keep this last - it needs everything ready since to sends data to the child
     stream_receiver_send_node_and_claim_id_to_child(rpt->host);
+    stream_receiver_send_zstd_dictionary_to_child(rpt->host);
 }
 
 void stream_receiver_move_entire_queue_to_running_unsafe(struct stream_thread *sth) {
@@ -588,6 +592,13 @@ static bool stream_receiver_dequeue_senders(struct stream_thread *sth, struct re
     return true;
 }
 
+static ALWAYS_INLINE int stream_receiver_parser_action(struct receiver_state *rpt, PARSER *parser) {
+    if(rpt->thread.parallel)
+        return stream_receiver_parallel_action(rpt, parser, rpt->thread.line_buffer->buffer, rpt->thread.line_buffer->len);
+
+    return parser_action(parser, rpt->thread.line_buffer->buffer);
+}
+
 static ssize_t
 stream_receive_and_process(struct stream_thread *sth, struct receiver_state *rpt, PARSER *parser, usec_t now_ut __maybe_unused, bool *removed) {
     internal_fatal(sth->tid != gettid_cached(), "Function %s() should only be used by the dispatcher thread", __FUNCTION__);
@@ -614,7 +625,7 @@ stream_receive_and_process(struct stream_thread *sth, struct receiver_state *rpt
                         // loop through all the complete lines found in the uncompressed buffer
 
                         while (buffered_reader_next_line(&rpt->thread.uncompressed, rpt->thread.line_buffer)) {
-                            if (unlikely(parser_action(parser, rpt->thread.line_buffer->buffer))) {
+                            if (unlikely(stream_receiver_parser_action(rpt, parser))) {
                                 stream_receiver_remove(sth, rpt, STREAM_HANDSHAKE_RCV_DISCONNECT_PARSER_FAILED);
                                 *removed = true;
                                 return -1;
@@ -643,6 +654,12 @@ stream_receive_and_process(struct stream_thread *sth, struct receiver_state *rpt
             }
         }
 
+        if(unlikely(stream_receiver_parallel_flush(rpt, parser))) {
+            stream_receiver_remove(sth, rpt, STREAM_HANDSHAKE_RCV_DISCONNECT_PARSER_FAILED);
+            *removed = true;
+            return -1;
+        }
+
         if(receiver_should_stop(rpt)) {
             stream_receiver_remove(sth, rpt, STREAM_HANDSHAKE_DISCONNECT_SIGNALED_TO_STOP);
             *removed = true;
@@ -655,7 +672,7 @@ stream_receive_and_process(struct stream_thread *sth, struct receiver_state *rpt
             return rc;
 
         while(buffered_reader_next_line(&rpt->thread.uncompressed, rpt->thread.line_buffer)) {
-            if(unlikely(parser_action(parser, rpt->thread.line_buffer->buffer))) {
+            if(unlikely(stream_receiver_parser_action(rpt, parser))) {
                 stream_receiver_remove(sth, rpt, STREAM_HANDSHAKE_RCV_DISCONNECT_PARSER_FAILED);
                 *removed = true;
                 return -1;
@@ -664,6 +681,12 @@ stream_receive_and_process(struct stream_thread *sth, struct receiver_state *rpt
             rpt->thread.line_buffer->len = 0;
             rpt->thread.line_buffer->buffer[0] = '\0';
         }
+
+        if(unlikely(stream_receiver_parallel_flush(rpt, parser))) {
+            stream_receiver_remove(sth, rpt, STREAM_HANDSHAKE_RCV_DISCONNECT_PARSER_FAILED);
+            *removed = true;
+            return -1;
+        }
     }
 
     return rc;
@@ -1240,6 +1263,7 @@ void rrdhost_clear_receiver(struct receiver_state *rpt, STREAM_HANDSHAKE reason)
     }
 
     // this must be cleared with the receiver lock
+    stream_receiver_parallel_cleanup(rpt);
     pluginsd_process_cleanup(rpt->thread.parser);
     __atomic_store_n(&rpt->thread.parser, NULL, __ATOMIC_RELAXED);
 
@@ -315,11 +315,23 @@ static void replication_query_align_to_optimal_before(struct replication_query *
             expanded_before = new_before;
     }
 
+    // prefer to end where the last response of the same node ended,
+    // so that the next requests of its charts start together and
+    // read the same extents
+    struct sender_state *sender = q->st->rrdhost->sender;
+    time_t coalesced_before = sender ? __atomic_load_n(&sender->replication.atomic.coalesced_before_s, __ATOMIC_RELAXED) : 0;
+    if(coalesced_before > q->query.before &&
+        (coalesced_before - q->query.before) / q->st->update_every < 1024)
+        expanded_before = coalesced_before;
+
     if(expanded_before > q->query.before                                 && // it is later than the original
         (expanded_before - q->query.before) / q->st->update_every < 1024 && // it is reasonable (up to a page)
         expanded_before < q->st->last_updated.tv_sec                     && // it is not the chart's last updated time
         expanded_before < q->wall_clock_time)                               // it is not later than the wall clock time
         q->query.before = expanded_before;
+
+    if(sender && q->query.before > coalesced_before)
+        __atomic_store_n(&sender->replication.atomic.coalesced_before_s, q->query.before, __ATOMIC_RELAXED);
 }
 
 static bool replication_query_execute(BUFFER *wb, struct replication_query *q, size_t max_msg_size) {
@@ -649,8 +661,11 @@ bool replication_response_execute_finalize_and_send(struct replication_query *q,
     q->query.locked_data_collection = false;
 
     bool finished_with_gap = false;
-    if(q->query.execute)
+    size_t queries = 0;
+    if(q->query.execute) {
         finished_with_gap = replication_query_execute(wb, q, max_msg_size);
+        queries = q->dimensions;
+    }
 
     time_t after = q->query.after;
     time_t before = q->query.before;
@@ -683,6 +698,8 @@ bool replication_response_execute_finalize_and_send(struct replication_query *q,
     buffer_print_uint64_encoded(wb, integer_encoding, wall_clock_time);
     buffer_fast_strcat(wb, "\n", 1);
 
+    stream_control_replication_budget_used(buffer_strlen(wb), queries);
+
     if(workers) worker_is_busy(WORKER_JOB_BUFFER_COMMIT);
     sender_commit(host->sender, wb, STREAM_TRAFFIC_TYPE_REPLICATION);
     if(workers) worker_is_busy(WORKER_JOB_CLEANUP);
@@ -743,7 +760,8 @@ struct replication_request {
     time_t before;                      // the end time of the query (maybe zero)
 
     usec_t sender_circular_buffer_last_flush_ut;        // the timestamp of the sender, at the time we indexed this request
-    Word_t unique_id;                   // auto-increment, later requests have bigger
+    Word_t sort_after;                  // the key of the outer JudyL - 'after', aligned to the locality window
+    Word_t unique_id;                   // the key of the inner JudyL - the locality id of the sender, then auto-increment
 
     bool start_streaming;               // true, when the parent wants to send the rest of the data (before is overwritten) and enable normal streaming
     bool indexed_in_judy;               // true when the request is indexed in judy
@@ -792,6 +810,7 @@ static struct replication_thread {
 
     struct {
         Word_t unique_id;               // the last unique id we gave to a request (auto-increment, starting from 1)
+        uint32_t locality_id;           // the last locality id we gave to a sender (auto-increment, starting from 1)
         size_t received;                // the number of replication requests received
         size_t executed;                // the number of replication requests executed
         size_t replied;
@@ -900,6 +919,28 @@ void replication_set_next_point_in_time(time_t after, size_t unique_id) {
 // ----------------------------------------------------------------------------
 // replication sort entry management
 
+// The queue is sorted for I/O locality: all the requests starting within the
+// same locality window are executed together, grouped by sender (node), in the
+// order they were received. The dbengine extents of a time-frame hold the pages
+// of the metrics collected together, so the queries executed together (and
+// prefetched together by the pipeline) read the same extents.
+
+static inline Word_t replication_sort_after(time_t after) {
+    time_t window = stream_send.replication.locality_window_s;
+    if(window <= 1)
+        return (Word_t)after;
+
+    return (Word_t)(after - (after % window));
+}
+
+static inline Word_t replication_sort_unique_id(struct sender_state *sender, Word_t seq) {
+    if(sizeof(Word_t) < sizeof(uint64_t))
+        // no room for the locality id in the key (logged by replication_initialize())
+        return seq;
+
+    return (Word_t)(((uint64_t)sender->replication.locality_id << 32) | ((uint64_t)seq & 0xFFFFFFFFULL));
+}
+
 static inline struct replication_sort_entry *replication_sort_entry_create(struct replication_request *rq) {
     struct replication_sort_entry *rse = aral_mallocz(replication_globals.aral_rse);
     __atomic_add_fetch(&replication_globals.atomic.memory, sizeof(struct replication_sort_entry), __ATOMIC_RELAXED);
@@ -908,9 +949,11 @@ static inline struct replication_sort_entry *replication_sort_entry_create(struc
 
     // copy the request
     rse->rq = rq;
-    rse->unique_id = __atomic_add_fetch(&replication_globals.atomic.unique_id, 1, __ATOMIC_SEQ_CST);
+    rse->unique_id = replication_sort_unique_id(
+        rq->sender, __atomic_add_fetch(&replication_globals.atomic.unique_id, 1, __ATOMIC_SEQ_CST));
 
-    // save the unique id into the request, to be able to delete it later
+    // save the keys into the request, to be able to delete it later
+    rq->sort_after = replication_sort_after(rq->after);
     rq->unique_id = rse->unique_id;
     rq->indexed_in_judy = false;
     rq->not_indexed_buffer_full = false;
@@ -959,8 +1002,8 @@ static void replication_sort_entry_add(struct replication_request *rq) {
 
     JudyAllocThreadPulseReset();
 
-    // find the outer judy entry, using after as key
-    inner_judy_ptr = JudyLIns(&replication_globals.unsafe.queue.JudyL_array, (Word_t) rq->after, PJE0);
+    // find the outer judy entry, using the aligned after as key
+    inner_judy_ptr = JudyLIns(&replication_globals.unsafe.queue.JudyL_array, rq->sort_after, PJE0);
     if(unlikely(!inner_judy_ptr || inner_judy_ptr == PJERR))
         fatal("REPLICATION: corrupted outer judyL");
 
@@ -1002,7 +1045,7 @@ static bool replication_sort_entry_unlink_and_free_unsafe(struct replication_sor
 
     // if no items left, delete it from the outer judy
     if(**inner_judy_ppptr == NULL) {
-        JudyLDel(&replication_globals.unsafe.queue.JudyL_array, rse->rq->after, PJE0);
+        JudyLDel(&replication_globals.unsafe.queue.JudyL_array, rse->rq->sort_after, PJE0);
         inner_judy_deleted = true;
     }
 
@@ -1021,7 +1064,7 @@ static void replication_sort_entry_del(struct replication_request *rq, bool buff
     replication_recursive_lock();
     if(rq->indexed_in_judy) {
 
-        inner_judy_pptr = JudyLGet(replication_globals.unsafe.queue.JudyL_array, rq->after, PJE0);
+        inner_judy_pptr = JudyLGet(replication_globals.unsafe.queue.JudyL_array, rq->sort_after, PJE0);
         if (inner_judy_pptr) {
             Pvoid_t *our_item_pptr = JudyLGet(*inner_judy_pptr, rq->unique_id, PJE0);
             if (our_item_pptr) {
@@ -1314,6 +1357,8 @@ void replication_sender_delete_pending_requests(struct sender_state *sender) {
 }
 
 void replication_sender_init(struct sender_state *sender) {
+    sender->replication.locality_id = __atomic_add_fetch(&replication_globals.atomic.locality_id, 1, __ATOMIC_RELAXED);
+
     sender->replication.requests = dictionary_create_advanced(DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_FIXED_SIZE,
                                                               &dictionary_stats_category_replication, sizeof(struct replication_request));
 
@@ -1739,7 +1784,10 @@ static void replication_main_cleanup(void *pptr) {
 }
 
 struct aral_statistics aral_replication_stats = { 0 };
-void replication_initialize(void) {
+static void replication_aral_initialize(void) {
+    if(replication_globals.aral_rse)
+        return;
+
     replication_globals.aral_rse = aral_create(
         "replication",
         sizeof(struct replication_sort_entry),
@@ -1751,6 +1799,15 @@ void replication_initialize(void) {
     pulse_aral_register_statistics(&aral_replication_stats, "replication");
 }
 
+void replication_initialize(void) {
+    replication_aral_initialize();
+
+    if(sizeof(Word_t) < sizeof(uint64_t))
+        nd_log(NDLS_DAEMON, NDLP_INFO,
+               "REPLICATION: this is a 32-bit build - replication requests within the same locality window "
+               "are executed in the order they are received, without grouping them by node.");
+}
+
 void *replication_thread_main(void *ptr) {
     CLEANUP_FUNCTION_REGISTER(replication_main_cleanup) cleanup_ptr = ptr;
 
@@ -1924,3 +1981,171 @@ int replication_prefetch_default(void) {
     prefetch = FIT_IN_RANGE(prefetch, 1, MAX_REPLICATION_PREFETCH);
     return prefetch;
 }
+
+// ----------------------------------------------------------------------------
+// unittest
+
+#define REPLICATION_UNITTEST_SENDERS 4
+#define REPLICATION_UNITTEST_REQUESTS 400
+#define REPLICATION_UNITTEST_WINDOW 600
+
+static size_t replication_locality_unittest(void) {
+    size_t errors = 0;
+
+    // on 32-bit builds there is no room for the locality id in the key,
+    // so the requests of a window are executed in the order received
+    bool grouped_by_sender = (sizeof(Word_t) >= sizeof(uint64_t));
+
+    replication_aral_initialize();
+
+    replication_recursive_lock();
+    bool queue_is_empty = (replication_globals.unsafe.queue.JudyL_array == NULL);
+    replication_globals.unsafe.queue.after = 0;
+    replication_globals.unsafe.queue.unique_id = 0;
+    replication_recursive_unlock();
+
+    if(!queue_is_empty) {
+        fprintf(stderr, " >>> REPLICATION LOCALITY: the replication queue is not empty\n");
+        return 1;
+    }
+
+    time_t saved_window = stream_send.replication.locality_window_s;
+    stream_send.replication.locality_window_s = REPLICATION_UNITTEST_WINDOW;
+
+    struct sender_state *senders = callocz(REPLICATION_UNITTEST_SENDERS, sizeof(*senders));
+    for(size_t s = 0; s < REPLICATION_UNITTEST_SENDERS; s++)
+        senders[s].replication.locality_id = __atomic_add_fetch(&replication_globals.atomic.locality_id, 1, __ATOMIC_RELAXED);
+
+    struct replication_request *rqs = callocz(REPLICATION_UNITTEST_REQUESTS, sizeof(*rqs));
+    size_t *arrival = callocz(REPLICATION_UNITTEST_REQUESTS, sizeof(*arrival));
+    size_t *order = callocz(REPLICATION_UNITTEST_REQUESTS, sizeof(*order));
+
+    // requests of all senders, spread over 3 windows, not aligned to them
+    uint64_t rnd = 0x5DEECE66DULL;
+    time_t base_s = 1700000123;
+    for(size_t i = 0; i < REPLICATION_UNITTEST_REQUESTS; i++) {
+        char id[50];
+        snprintfz(id, sizeof(id), "chart.%zu", i);
+
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        rqs[i].sender = &senders[(rnd >> 40) % REPLICATION_UNITTEST_SENDERS];
+        rqs[i].chart_id = string_strdupz(id);
+        rqs[i].after = base_s + (time_t)((rnd >> 20) % (3 * REPLICATION_UNITTEST_WINDOW));
+        rqs[i].before = rqs[i].after + 60;
+        order[i] = i;
+    }
+
+    for(size_t i = REPLICATION_UNITTEST_REQUESTS - 1; i > 0; i--) {
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t j = (rnd >> 33) % (i + 1);
+        SWAP(order[i], order[j]);
+    }
+
+    for(size_t i = 0; i < REPLICATION_UNITTEST_REQUESTS; i++) {
+        arrival[order[i]] = i;
+        replication_sort_entry_add(&rqs[order[i]]);
+    }
+
+    size_t executed = 0;
+    bool seen[REPLICATION_UNITTEST_SENDERS] = { 0 };
+    Word_t last_sort_after = 0;
+    struct sender_state *last_sender = NULL;
+    size_t last_arrival = 0;
+    bool first = true;
+
+    while(true) {
+        struct replication_request rq = replication_request_get_first_available();
+        if(!rq.found)
+            break;
+
+        size_t i = str2u(string2str(rq.chart_id) + strlen("chart."));
+        string_freez(rq.chart_id);
+        executed++;
+
+        if(i >= REPLICATION_UNITTEST_REQUESTS || rq.sender != rqs[i].sender || rq.after != rqs[i].after) {
+            fprintf(stderr, " >>> REPLICATION LOCALITY: got a request that was not added\n");
+            errors++;
+            continue;
+        }
+
+        size_t s = rq.sender - senders;
+
+        if(rq.sort_after != (Word_t)(rq.after - (rq.after % REPLICATION_UNITTEST_WINDOW))) {
+            fprintf(stderr, " >>> REPLICATION LOCALITY: request %zu with after %ld is in window %lu\n",
+                    i, (long)rq.after, (unsigned long)rq.sort_after);
+            errors++;
+        }
+
+        if(rq.sort_after < last_sort_after) {
+            fprintf(stderr, " >>> REPLICATION LOCALITY: request %zu of window %lu executed after window %lu\n",
+                    i, (unsigned long)rq.sort_after, (unsigned long)last_sort_after);
+            errors++;
+        }
+
+        if(first || rq.sort_after != last_sort_after) {
+            // a new window
+            memset(seen, 0, sizeof(seen));
+            last_sender = NULL;
+        }
+
+        if(grouped_by_sender && rq.sender != last_sender) {
+            if(seen[s] || (last_sender && rq.sender->replication.locality_id < last_sender->replication.locality_id)) {
+                fprintf(stderr, " >>> REPLICATION LOCALITY: the requests of sender %zu in window %lu are not executed together\n",
+                        s, (unsigned long)rq.sort_after);
+                errors++;
+            }
+            seen[s] = true;
+        }
+        else if(last_sender && arrival[i] < last_arrival) {
+            fprintf(stderr, " >>> REPLICATION LOCALITY: request %zu in window %lu is not executed in the order received\n",
+                    i, (unsigned long)rq.sort_after);
+            errors++;
+        }
+
+        last_sort_after = rq.sort_after;
+        last_sender = rq.sender;
+        last_arrival = arrival[i];
+        first = false;
+    }
+
+    if(executed != REPLICATION_UNITTEST_REQUESTS) {
+        fprintf(stderr, " >>> REPLICATION LOCALITY: executed %zu requests, expected %d\n",
+                executed, REPLICATION_UNITTEST_REQUESTS);
+        errors++;
+    }
+
+    for(size_t s = 0; s < REPLICATION_UNITTEST_SENDERS; s++) {
+        if(senders[s].replication.atomic.pending_requests) {
+            fprintf(stderr, " >>> REPLICATION LOCALITY: sender %zu has %zu pending requests\n",
+                    s, senders[s].replication.atomic.pending_requests);
+            errors++;
+        }
+    }
+
+    for(size_t i = 0; i < REPLICATION_UNITTEST_REQUESTS; i++)
+        string_freez(rqs[i].chart_id);
+
+    freez(order);
+    freez(arrival);
+    freez(rqs);
+    freez(senders);
+
+    replication_recursive_lock();
+    replication_globals.unsafe.queue.after = 0;
+    replication_globals.unsafe.queue.unique_id = 0;
+    replication_globals.unsafe.first_time_t = 0;
+    replication_recursive_unlock();
+
+    stream_send.replication.locality_window_s = saved_window;
+    return errors;
+}
+
+int replication_unittest(void) {
+    size_t errors = 0;
+
+    errors += replication_locality_unittest();
+    errors += stream_control_replication_budget_unittest();
+
+    fprintf(stderr, "REPLICATION: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
@@ -37,6 +37,8 @@ size_t replication_sender_allocated_buffers(void);
 int replication_prefetch_default(void);
 int replication_threads_default(void);
 
+int replication_unittest(void);
+
 #ifdef __cplusplus
 }
 #endif
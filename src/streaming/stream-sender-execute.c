@@ -3,6 +3,7 @@
 #include "stream-thread.h"
 #include "stream-replication-receiver.h"
 #include "stream-replication-sender.h"
+#include "stream-compression/zstd-dictionary.h"
 
 struct inflight_stream_function {
     struct sender_state *sender;
@@ -108,6 +109,8 @@ static void execute_deferred_json(struct sender_state *s, void *data) {
 
     if(strcmp(keyword, PLUGINSD_KEYWORD_JSON_CMD_STREAM_PATH) == 0)
         stream_path_set_from_json(s->host, buffer_tostring(s->thread.defer.payload), true);
+    else if(strcmp(keyword, PLUGINSD_KEYWORD_JSON_CMD_ZSTD_DICTIONARY) == 0)
+        stream_zstd_dictionary_received_from_json(s->host->machine_guid, buffer_tostring(s->thread.defer.payload));
     else
         nd_log(NDLS_DAEMON, NDLP_ERR,
                "STREAM SND '%s' [to %s]: unknown JSON keyword '%s' with payload: %s",
@@ -34,6 +34,7 @@ struct sender_state {
     SPINLOCK spinlock;
     STREAM_CAPABILITIES capabilities;
     STREAM_CAPABILITIES disabled_capabilities;
+    uint32_t zstd_dictionary_id;                // the zstd dictionary we asked the parent to use
     int16_t hops;
     bool parent_using_h2o;
     WAITQ waitq;
@@ -90,11 +91,14 @@ struct sender_state {
         DICTIONARY *requests;                   // de-duplication of replication requests, per chart
         time_t oldest_request_after_t;          // the timestamp of the oldest replication request
         time_t latest_completed_before_t;       // the timestamp of the latest replication request
+        uint32_t locality_id;                   // groups the requests of this sender in the replication queue
+
 
         struct {
             size_t pending_requests;            // the currently outstanding replication requests
             size_t charts_replicating;          // the number of unique charts having pending replication requests (on every request one is added and is removed when we finish it - it does not track completion of the replication for this chart)
             bool reached_max;                   // true when the sender buffer should not get more replication responses
+            time_t coalesced_before_s;          // the latest 'before' a replication response of this sender ended at
         } atomic;
     } replication;
 
@@ -45,5 +45,6 @@ char *stream_receiver_program_version_strdupz(struct rrdhost *host);
 #include "stream-control.h"
 
 void stream_threads_cancel(void);
+void stream_zstd_dictionary_shutdown(void);
 
 #endif //NETDATA_STREAM_H
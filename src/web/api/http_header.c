@@ -138,12 +138,26 @@ static void http_header_accept_encoding(struct web_client *w, const char *v, siz
         if(strcasestr(v, "gzip"))
             web_client_enable_deflate(w, true);
 
+        // we don't compress with brotli on the fly,
+        // but we can send static files that are shipped compressed with it
+        for(const char *s = strcasestr(v, "br"); s ; s = strcasestr(s + 2, "br")) {
+            if((s == v || s[-1] == ' ' || s[-1] == ',') && (!s[2] || s[2] == ' ' || s[2] == ',' || s[2] == ';')) {
+                web_client_flag_set(w, WEB_CLIENT_ENCODING_BROTLI);
+                break;
+            }
+        }
+
         // does not seem to work
         // else if(strcasestr(v, "deflate"))
         //  web_client_enable_deflate(w, 0);
     }
 }
 
+static void http_header_if_none_match(struct web_client *w, const char *v, size_t len __maybe_unused) {
+    freez(w->if_none_match);
+    w->if_none_match = strdupz(v);
+}
+
 static void http_header_x_forwarded_host(struct web_client *w, const char *v, size_t len) {
     char buffer[NI_MAXHOST];
     strncpyz(buffer, v, (len < sizeof(buffer) - 1 ? len : sizeof(buffer) - 1));
@@ -345,6 +359,7 @@ struct {
     { .hash = 0, .key = "X-Auth-Token",          .cb = http_header_x_auth_token },
     { .hash = 0, .key = "Host",                  .cb = http_header_host },
     { .hash = 0, .key = "Accept-Encoding",       .cb = http_header_accept_encoding },
+    { .hash = 0, .key = "If-None-Match",         .cb = http_header_if_none_match },
     { .hash = 0, .key = "X-Forwarded-Host",      .cb = http_header_x_forwarded_host },
     { .hash = 0, .key = "X-Forwarded-For",       .cb = http_header_x_forwarded_for },
     { .hash = 0, .key = "X-Transaction-Id",      .cb = http_header_x_transaction_id },
@@ -0,0 +1,414 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "query-cache.h"
+#include "web/api/queries/rrdr.h"
+#include "daemon/pulse/pulse-queries.h"
+
+bool query_cache_enabled = true;
+size_t query_cache_max_size = 16 * 1024 * 1024;
+time_t query_cache_max_age_s = 10;
+
+// a cached response is valid only while all these are the same
+struct query_cache_validity {
+    time_t after;
+    time_t before;
+    size_t points;
+    size_t group;
+    size_t tier;
+    RRDR_OPTIONS options;
+    time_t db_first_time_s;
+    time_t db_last_time_s;
+    uint32_t metrics;
+    uint32_t instances;
+    struct query_versions versions;
+};
+
+struct query_cache_entry {
+    struct query_cache_validity validity;
+    time_t created_s;
+    time_t latest_timestamp;
+    int ret;
+    HTTP_CONTENT_TYPE content_type;
+    size_t len;
+    char *body;
+};
+
+static struct {
+    SPINLOCK spinlock;
+    bool initialized;
+    DICTIONARY *entries;
+    size_t memory;                  // atomic
+    time_t last_cleanup_s;          // atomic
+} query_cache = {
+    .spinlock = SPINLOCK_INITIALIZER,
+};
+
+static void query_cache_delete_cb(const DICTIONARY_ITEM *item __maybe_unused, void *value, void *data __maybe_unused) {
+    struct query_cache_entry *qce = value;
+    __atomic_sub_fetch(&query_cache.memory, qce->len + sizeof(*qce), __ATOMIC_RELAXED);
+    freez(qce->body);
+}
+
+static DICTIONARY *query_cache_entries(void) {
+    if(likely(__atomic_load_n(&query_cache.initialized, __ATOMIC_ACQUIRE)))
+        return query_cache.entries;
+
+    spinlock_lock(&query_cache.spinlock);
+    if(!query_cache.initialized) {
+        query_cache.entries = dictionary_create_advanced(
+            DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_FIXED_SIZE,
+            &dictionary_stats_category_other, sizeof(struct query_cache_entry));
+
+        dictionary_register_delete_callback(query_cache.entries, query_cache_delete_cb, NULL);
+        __atomic_store_n(&query_cache.initialized, true, __ATOMIC_RELEASE);
+    }
+    spinlock_unlock(&query_cache.spinlock);
+
+    return query_cache.entries;
+}
+
+static inline void query_cache_key_string(BUFFER *key, const char *s) {
+    size_t len = s ? strlen(s) : 0;
+    buffer_sprintf(key, "%zu:", len);
+    if(len)
+        buffer_fast_strcat(key, s, len);
+    buffer_putc(key, '|');
+}
+
+// the key is the normalized request - two requests with the same key
+// resolve to the same query target, given the same time and data
+static void query_cache_key(QUERY_TARGET *qt, BUFFER *key) {
+    QUERY_TARGET_REQUEST *qtr = &qt->request;
+
+    buffer_sprintf(key, "v%zu|%"PRId64"|%"PRId64"|%zu|%u|%"PRIx64"|%zu|%"PRId64"|%u|%zu|",
+                   qtr->version,
+                   (int64_t)qtr->after, (int64_t)qtr->before, qtr->points,
+                   qtr->format, (uint64_t)qtr->options, qtr->tier,
+                   (int64_t)qtr->resampling_time, (unsigned)qtr->time_group_method,
+                   qtr->cardinality_limit);
+
+    query_cache_key_string(key, qtr->time_group_options);
+    query_cache_key_string(key, qtr->scope_nodes);
+    query_cache_key_string(key, qtr->scope_contexts);
+    query_cache_key_string(key, qtr->scope_instances);
+    query_cache_key_string(key, qtr->scope_labels);
+    query_cache_key_string(key, qtr->scope_dimensions);
+    query_cache_key_string(key, qtr->nodes);
+    query_cache_key_string(key, qtr->contexts);
+    query_cache_key_string(key, qtr->instances);
+    query_cache_key_string(key, qtr->dimensions);
+    query_cache_key_string(key, qtr->chart_label_key);
+    query_cache_key_string(key, qtr->labels);
+    query_cache_key_string(key, qtr->alerts);
+
+    for(size_t g = 0; g < MAX_QUERY_GROUP_BY_PASSES ;g++) {
+        buffer_sprintf(key, "%u|%u|", (unsigned)qtr->group_by[g].group_by, (unsigned)qtr->group_by[g].aggregation);
+        query_cache_key_string(key, qtr->group_by[g].group_by_label);
+    }
+}
+
+static void query_cache_validity(QUERY_TARGET *qt, struct query_cache_validity *v) {
+    memset(v, 0, sizeof(*v));
+    v->after = qt->window.after;
+    v->before = qt->window.before;
+    v->points = qt->window.points;
+    v->group = qt->window.group;
+    v->tier = qt->window.tier;
+    v->options = qt->window.options;
+    v->db_first_time_s = qt->db.first_time_s;
+    v->db_last_time_s = qt->db.last_time_s;
+    v->metrics = qt->query.used;
+    v->instances = qt->instances.used;
+    v->versions = qt->versions;
+}
+
+static bool query_cache_is_cacheable(QUERY_TARGET *qt) {
+    if(!query_cache_enabled || !query_cache_max_size)
+        return false;
+
+    // the host and chart pointers are not part of the key
+    if(qt->request.host || qt->request.st || qt->request.rca || qt->request.ria || qt->request.rma)
+        return false;
+
+    if(qt->window.options & RRDR_OPTION_DEBUG)
+        return false;
+
+    return true;
+}
+
+bool query_cache_get(QUERY_TARGET *qt, BUFFER *wb, time_t *latest_timestamp, int *ret) {
+    if(!query_cache_is_cacheable(qt))
+        return false;
+
+    DICTIONARY *entries = query_cache_entries();
+
+    CLEAN_BUFFER *key = buffer_create(1024, NULL);
+    query_cache_key(qt, key);
+
+    const DICTIONARY_ITEM *item = dictionary_get_and_acquire_item(entries, buffer_tostring(key));
+    if(!item) {
+        pulse_queries_api_data_cache_miss();
+        return false;
+    }
+
+    struct query_cache_entry *qce = dictionary_acquired_item_value(item);
+
+    struct query_cache_validity v;
+    query_cache_validity(qt, &v);
+
+    bool hit = memcmp(&v, &qce->validity, sizeof(v)) == 0 &&
+               now_realtime_sec() - qce->created_s < query_cache_max_age_s;
+
+    if(hit) {
+        buffer_memcat(wb, qce->body, qce->len);
+        wb->content_type = qce->content_type;
+        if(latest_timestamp && qce->latest_timestamp)
+            *latest_timestamp = qce->latest_timestamp;
+        *ret = qce->ret;
+        pulse_queries_api_data_cache_hit();
+    }
+    else
+        pulse_queries_api_data_cache_miss();
+
+    dictionary_acquired_item_release(entries, item);
+
+    if(!hit)
+        dictionary_del(entries, buffer_tostring(key));
+
+    return hit;
+}
+
+static void query_cache_cleanup(DICTIONARY *entries, time_t now_s) {
+    struct query_cache_entry *qce;
+    dfe_start_write(entries, qce) {
+        if(now_s - qce->created_s >= query_cache_max_age_s)
+            dictionary_del(entries, qce_dfe.name);
+    }
+    dfe_done(qce);
+
+    __atomic_store_n(&query_cache.last_cleanup_s, now_s, __ATOMIC_RELAXED);
+}
+
+void query_cache_set(QUERY_TARGET *qt, BUFFER *wb, size_t offset, time_t latest_timestamp, int ret) {
+    if(ret != HTTP_RESP_OK || offset > wb->len || !query_cache_is_cacheable(qt))
+        return;
+
+    // a single response may not take more than 1/8 of the cache
+    size_t len = wb->len - offset;
+    if(len + sizeof(struct query_cache_entry) > query_cache_max_size / 8)
+        return;
+
+    DICTIONARY *entries = query_cache_entries();
+    time_t now_s = now_realtime_sec();
+
+    if(__atomic_load_n(&query_cache.memory, __ATOMIC_RELAXED) + len > query_cache_max_size ||
+        now_s - __atomic_load_n(&query_cache.last_cleanup_s, __ATOMIC_RELAXED) >= query_cache_max_age_s)
+        query_cache_cleanup(entries, now_s);
+
+    if(__atomic_load_n(&query_cache.memory, __ATOMIC_RELAXED) + len > query_cache_max_size)
+        return;
+
+    CLEAN_BUFFER *key = buffer_create(1024, NULL);
+    query_cache_key(qt, key);
+
+    struct query_cache_entry tmp = {
+        .created_s = now_s,
+        .latest_timestamp = latest_timestamp,
+        .ret = ret,
+        .content_type = wb->content_type,
+        .len = len,
+        .body = mallocz(len),
+    };
+    memcpy(tmp.body, &wb->buffer[offset], len);
+    query_cache_validity(qt, &tmp.validity);
+
+    __atomic_add_fetch(&query_cache.memory, len + sizeof(tmp), __ATOMIC_RELAXED);
+
+    // the value is copied, unless an entry already exists
+    // (another thread may have cached the same query concurrently)
+    const DICTIONARY_ITEM *item = dictionary_set_and_acquire_item(entries, buffer_tostring(key), &tmp, sizeof(tmp));
+    struct query_cache_entry *qce = dictionary_acquired_item_value(item);
+    if(qce->body != tmp.body) {
+        __atomic_sub_fetch(&query_cache.memory, len + sizeof(tmp), __ATOMIC_RELAXED);
+        freez(tmp.body);
+    }
+    dictionary_acquired_item_release(entries, item);
+}
+
+size_t query_cache_memory(void) {
+    return __atomic_load_n(&query_cache.memory, __ATOMIC_RELAXED);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// unittest - netdata -W querycachetest
+
+static QUERY_TARGET *query_cache_unittest_qt(const char *contexts, time_t db_last_time_s) {
+    QUERY_TARGET *qt = callocz(1, sizeof(QUERY_TARGET));
+    qt->request.version = 2;
+    qt->request.after = -600;
+    qt->request.points = 60;
+    qt->request.scope_contexts = contexts;
+    qt->request.contexts = contexts;
+    qt->window.after = db_last_time_s - 600;
+    qt->window.before = db_last_time_s;
+    qt->window.points = 60;
+    qt->window.group = 10;
+    qt->db.first_time_s = db_last_time_s - 3600;
+    qt->db.last_time_s = db_last_time_s;
+    qt->query.used = 5;
+    qt->instances.used = 2;
+    return qt;
+}
+
+static bool query_cache_unittest_get(QUERY_TARGET *qt, const char *expected, int expected_ret, time_t expected_latest) {
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+    buffer_strcat(wb, "prefix");
+
+    int ret = 0;
+    time_t latest = 0;
+    if(!query_cache_get(qt, wb, &latest, &ret))
+        return false;
+
+    if(strcmp(buffer_tostring(wb), expected) != 0 || ret != expected_ret || latest != expected_latest || wb->content_type != CT_APPLICATION_JSON) {
+        fprintf(stderr, "QUERY CACHE: unexpected hit '%s', ret %d, latest %ld\n", buffer_tostring(wb), ret, (long)latest);
+        return false;
+    }
+
+    return true;
+}
+
+static void query_cache_unittest_set(QUERY_TARGET *qt, const char *body, int ret, time_t latest) {
+    CLEAN_BUFFER *wb = buffer_create(0, NULL);
+    buffer_strcat(wb, "header-not-cached");
+    size_t offset = buffer_strlen(wb);
+    buffer_strcat(wb, body);
+    wb->content_type = CT_APPLICATION_JSON;
+    query_cache_set(qt, wb, offset, latest, ret);
+}
+
+int query_cache_unittest(void) {
+    size_t errors = 0;
+
+    bool saved_enabled = query_cache_enabled;
+    size_t saved_max_size = query_cache_max_size;
+    time_t saved_max_age_s = query_cache_max_age_s;
+    query_cache_enabled = true;
+    query_cache_max_size = 1024 * 1024;
+    query_cache_max_age_s = 60;
+
+    time_t now_s = now_realtime_sec();
+    QUERY_TARGET *qt = query_cache_unittest_qt("system.cpu", now_s);
+
+    // 1. nothing is cached yet
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: hit on an empty cache\n");
+        errors++;
+    }
+
+    // 2. the response is cached without what preceded it in the buffer, and appended on hits
+    query_cache_unittest_set(qt, "{\"result\":1}", HTTP_RESP_OK, now_s - 1);
+    if(!query_cache_unittest_get(qt, "prefix{\"result\":1}", HTTP_RESP_OK, now_s - 1)) {
+        fprintf(stderr, "QUERY CACHE: the cached response is not found\n");
+        errors++;
+    }
+
+    // 3. the same request from another query target shares the response
+    QUERY_TARGET *qt2 = query_cache_unittest_qt("system.cpu", now_s);
+    if(!query_cache_unittest_get(qt2, "prefix{\"result\":1}", HTTP_RESP_OK, now_s - 1)) {
+        fprintf(stderr, "QUERY CACHE: an identical request does not share the cached response\n");
+        errors++;
+    }
+
+    // 4. a different request does not
+    QUERY_TARGET *qt3 = query_cache_unittest_qt("system.load", now_s);
+    if(query_cache_unittest_get(qt3, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a different request gets a cached response\n");
+        errors++;
+    }
+
+    // 5. new data (the retention and the window moved) invalidates and removes the entry
+    qt2->db.last_time_s++;
+    qt2->window.before++;
+    qt2->window.after++;
+    if(query_cache_unittest_get(qt2, "", 0, 0) || query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a stale response is returned\n");
+        errors++;
+    }
+
+    // 6. new versions of the contexts invalidate it too
+    query_cache_unittest_set(qt, "{\"result\":2}", HTTP_RESP_OK, now_s);
+    qt->versions.contexts_hard_hash++;
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a response of older versions is returned\n");
+        errors++;
+    }
+
+    // 7. errors, debug queries, queries on specific hosts or charts, and large responses are not cached
+    query_cache_unittest_set(qt, "{\"error\":1}", HTTP_RESP_BAD_REQUEST, now_s);
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: an error response is cached\n");
+        errors++;
+    }
+
+    qt->window.options |= RRDR_OPTION_DEBUG;
+    query_cache_unittest_set(qt, "{\"result\":3}", HTTP_RESP_OK, now_s);
+    qt->window.options &= ~RRDR_OPTION_DEBUG;
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a debug response is cached\n");
+        errors++;
+    }
+
+    RRDHOST *host = callocz(1, sizeof(RRDHOST));
+    qt->request.host = host;
+    query_cache_unittest_set(qt, "{\"result\":4}", HTTP_RESP_OK, now_s);
+    qt->request.host = NULL;
+    freez(host);
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a response of a host specific query is cached\n");
+        errors++;
+    }
+
+    {
+        size_t len = query_cache_max_size / 8;
+        char *large = mallocz(len + 1);
+        memset(large, 'x', len);
+        large[len] = '\0';
+        size_t memory = query_cache_memory();
+        query_cache_unittest_set(qt, large, HTTP_RESP_OK, now_s);
+        freez(large);
+
+        if(query_cache_memory() != memory || query_cache_unittest_get(qt, "", 0, 0)) {
+            fprintf(stderr, "QUERY CACHE: a response larger than 1/8 of the cache is cached\n");
+            errors++;
+        }
+    }
+
+    // 8. entries expire
+    query_cache_unittest_set(qt, "{\"result\":5}", HTTP_RESP_OK, now_s);
+    query_cache_max_age_s = 0;
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: an expired response is returned\n");
+        errors++;
+    }
+    query_cache_max_age_s = 60;
+
+    // 9. nothing is cached when disabled
+    query_cache_enabled = false;
+    query_cache_unittest_set(qt, "{\"result\":6}", HTTP_RESP_OK, now_s);
+    query_cache_enabled = true;
+    if(query_cache_unittest_get(qt, "", 0, 0)) {
+        fprintf(stderr, "QUERY CACHE: a response is cached while the cache is disabled\n");
+        errors++;
+    }
+
+    freez(qt);
+    freez(qt2);
+    freez(qt3);
+
+    query_cache_enabled = saved_enabled;
+    query_cache_max_size = saved_max_size;
+    query_cache_max_age_s = saved_max_age_s;
+
+    fprintf(stderr, "QUERY CACHE: unittest %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_QUERY_CACHE_H
+#define NETDATA_QUERY_CACHE_H
+
+#include "database/rrd.h"
+
+// a shared cache of finalized data query responses, keyed by the
+// normalized query target request, and validated against the resolved
+// time-frame and the retention and versions of the metrics matched
+
+extern bool query_cache_enabled;
+extern size_t query_cache_max_size;
+extern time_t query_cache_max_age_s;
+
+// when the query target has a valid cached response, append it to wb
+// and return true
+bool query_cache_get(QUERY_TARGET *qt, BUFFER *wb, time_t *latest_timestamp, int *ret);
+
+// cache the response generated for the query target,
+// i.e. everything appended to wb after the offset given
+void query_cache_set(QUERY_TARGET *qt, BUFFER *wb, size_t offset, time_t latest_timestamp, int ret);
+
+size_t query_cache_memory(void);
+
+int query_cache_unittest(void);
+
+#endif //NETDATA_QUERY_CACHE_H
@@ -191,7 +191,7 @@ void rrdr_json_group_by_labels(BUFFER *wb, const char *key, RRDR *r, RRDR_OPTION
     buffer_json_object_close(wb); // key
 }
 
-static void rrd2rrdr_set_timestamps(RRDR *r) {
+void rrd2rrdr_set_timestamps(RRDR *r) {
     QUERY_TARGET *qt = r->internal.qt;
 
     internal_fatal(qt->window.points != r->n, "QUERY: mismatch to the number of points in qt and r");
@@ -97,6 +97,7 @@ void rrdr_set_grouping_function(RRDR *r, RRDR_TIME_GROUPING group_method);
 
 // group by
 RRDR *rrd2rrdr_group_by_initialize(ONEWAYALLOC *owa, QUERY_TARGET *qt);
+void rrd2rrdr_set_timestamps(RRDR *r);
 void rrdr2rrdr_group_by_calculate_percentage_of_group(RRDR *r);
 void rrdr2rrdr_group_by_partial_trimming(RRDR *r);
 void rrd2rrdr_group_by_add_metric(RRDR *r_dst, size_t d_dst, RRDR *r_tmp, size_t d_tmp,
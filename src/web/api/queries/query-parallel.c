@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "query-parallel.h"
+
+struct query_parallel_job {
+    query_parallel_cb_t cb;
+    void *data;
+
+    size_t slots;
+    size_t claimed;                 // protected by the spinlock
+    size_t completed;               // atomic
+
+    struct completion completion;
+
+    struct query_parallel_job *prev, *next;
+};
+
+static struct {
+    struct completion completion;
+
+    SPINLOCK spinlock;
+    bool initialized;
+    bool running;
+    size_t workers;
+    size_t queue_size;
+    struct query_parallel_job *queue;
+} query_parallel_globals = {
+    .spinlock = SPINLOCK_INITIALIZER,
+    .queue = NULL,
+};
+
+size_t query_parallel_workers(void) {
+    if(!__atomic_load_n(&query_parallel_globals.running, __ATOMIC_ACQUIRE))
+        return 0;
+
+    // the caller participates in the execution too
+    return query_parallel_globals.workers + 1;
+}
+
+// claim the next slot of the first job in the queue
+// returns the job, or NULL when the queue is empty
+static struct query_parallel_job *query_parallel_claim_slot(struct query_parallel_job *only, size_t *slot) {
+    struct query_parallel_job *job;
+
+    spinlock_lock(&query_parallel_globals.spinlock);
+
+    job = only ? only : query_parallel_globals.queue;
+    if(job && job->claimed < job->slots) {
+        *slot = job->claimed++;
+
+        if(job->claimed == job->slots) {
+            // all slots have been claimed, nobody else needs to find it
+            DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(query_parallel_globals.queue, job, prev, next);
+            query_parallel_globals.queue_size--;
+        }
+    }
+    else
+        job = NULL;
+
+    spinlock_unlock(&query_parallel_globals.spinlock);
+
+    return job;
+}
+
+static void query_parallel_execute_slot(struct query_parallel_job *job, size_t slot) {
+    job->cb(job->data, slot);
+
+    // the job may be freed by its owner as soon as it is completed,
+    // so we should not touch it after marking it complete
+    if(__atomic_add_fetch(&job->completed, 1, __ATOMIC_ACQ_REL) == job->slots)
+        completion_mark_complete(&job->completion);
+}
+
+void query_parallel_execute(query_parallel_cb_t cb, void *data, size_t slots) {
+    if(!slots)
+        return;
+
+    if(slots == 1 || !query_parallel_workers()) {
+        for(size_t s = 0; s < slots ; s++)
+            cb(data, s);
+        return;
+    }
+
+    struct query_parallel_job job = {
+        .cb = cb,
+        .data = data,
+        .slots = slots,
+        .claimed = 0,
+        .completed = 0,
+    };
+    completion_init(&job.completion);
+
+    spinlock_lock(&query_parallel_globals.spinlock);
+    DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(query_parallel_globals.queue, &job, prev, next);
+    query_parallel_globals.queue_size++;
+    spinlock_unlock(&query_parallel_globals.spinlock);
+
+    completion_mark_complete_a_job(&query_parallel_globals.completion);
+
+    // the caller works on its own job too, so that the query
+    // progresses even when all the workers are busy
+    size_t slot;
+    while(query_parallel_claim_slot(&job, &slot))
+        query_parallel_execute_slot(&job, slot);
+
+    completion_wait_for(&job.completion);
+    completion_destroy(&job.completion);
+}
+
+static void query_parallel_worker_thread(void *ptr) {
+    bool main_thread = (ptr == (void *)0x01);
+
+    worker_register("QUERYPAR");
+
+    worker_register_job_name(0, "get");
+    worker_register_job_name(1, "query");
+    worker_register_job_custom_metric(2, "parallel queries queue size", "queries", WORKER_METRIC_ABSOLUTE);
+
+    size_t job_id = 0;
+    while(!nd_thread_signaled_to_cancel() && service_running(SERVICE_WEB_SERVER)) {
+        worker_is_busy(0);
+
+        size_t slot;
+        struct query_parallel_job *job = query_parallel_claim_slot(NULL, &slot);
+        if(job) {
+            worker_is_busy(1);
+            query_parallel_execute_slot(job, slot);
+            continue;
+        }
+
+        if(main_thread)
+            worker_set_metric(2, (NETDATA_DOUBLE)__atomic_load_n(&query_parallel_globals.queue_size, __ATOMIC_RELAXED));
+
+        worker_is_idle();
+        job_id = completion_wait_for_a_job_with_timeout(&query_parallel_globals.completion, job_id, 1000);
+    }
+
+    worker_unregister();
+}
+
+void query_parallel_thread(void *ptr) {
+    struct netdata_static_thread *static_thread = ptr;
+    if(!static_thread) return;
+
+    nd_thread_tag_set("QUERYPAR[0]");
+
+    // callers may still signal the completion after the pool stops,
+    // so it is initialized once and never destroyed
+    if(!query_parallel_globals.initialized) {
+        completion_init(&query_parallel_globals.completion);
+        query_parallel_globals.initialized = true;
+    }
+
+    size_t threads = netdata_conf_cpus() / 2;
+    if(threads < 2) threads = 2;
+    if(threads > 32) threads = 32;
+    ND_THREAD *th[threads - 1];
+
+    for(size_t t = 0; t < threads - 1 ;t++) {
+        char tag[15];
+        snprintfz(tag, sizeof(tag), "QUERYPAR[%zu]", t + 1);
+        th[t] = nd_thread_create(tag, NETDATA_THREAD_OPTION_DEFAULT, query_parallel_worker_thread, NULL);
+    }
+
+    query_parallel_globals.workers = threads;
+    __atomic_store_n(&query_parallel_globals.running, true, __ATOMIC_RELEASE);
+
+    query_parallel_worker_thread((void *)0x01);
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
+
+    // from now on, callers execute their queries by themselves
+    __atomic_store_n(&query_parallel_globals.running, false, __ATOMIC_RELEASE);
+
+    for(size_t t = 0; t < threads - 1 ;t++) {
+        nd_thread_signal_cancel(th[t]);
+        nd_thread_join(th[t]);
+    }
+
+    // jobs still in the queue are completed by their callers,
+    // since they keep claiming slots until all are claimed
+
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
+}
+
+// ----------------------------------------------------------------------------
+// unittest
+
+static struct {
+    ND_THREAD *thread;
+    struct netdata_static_thread static_thread;
+} query_parallel_unittest_pool = { 0 };
+
+bool query_parallel_unittest_pool_start(void) {
+    query_parallel_unittest_pool.static_thread = (struct netdata_static_thread){
+        .name = "QUERYPAR",
+        .enabled = 1,
+    };
+
+    query_parallel_unittest_pool.thread = nd_thread_create(
+        "QUERYPAR[0]", NETDATA_THREAD_OPTION_DEFAULT, query_parallel_thread, &query_parallel_unittest_pool.static_thread);
+
+    for(size_t i = 0; i < 1000 && !query_parallel_workers() ; i++)
+        sleep_usec(10 * USEC_PER_MS);
+
+    return query_parallel_workers() > 1;
+}
+
+void query_parallel_unittest_pool_stop(void) {
+    if(!query_parallel_unittest_pool.thread)
+        return;
+
+    nd_thread_signal_cancel(query_parallel_unittest_pool.thread);
+    nd_thread_join(query_parallel_unittest_pool.thread);
+    query_parallel_unittest_pool.thread = NULL;
+}
+
+#define QUERY_PARALLEL_UNITTEST_SLOTS 1000
+#define QUERY_PARALLEL_UNITTEST_CALLERS 4
+#define QUERY_PARALLEL_UNITTEST_ITERATIONS 50
+
+struct query_parallel_unittest_caller {
+    ND_THREAD *thread;
+    size_t id;
+    size_t errors;
+    size_t executions[QUERY_PARALLEL_UNITTEST_SLOTS];
+};
+
+static void query_parallel_unittest_cb(void *data, size_t slot) {
+    struct query_parallel_unittest_caller *c = data;
+    __atomic_add_fetch(&c->executions[slot], 1, __ATOMIC_RELAXED);
+}
+
+// every slot should be executed exactly once, and nothing else
+static size_t query_parallel_unittest_run(struct query_parallel_unittest_caller *c, size_t slots) {
+    memset(c->executions, 0, sizeof(c->executions));
+
+    query_parallel_execute(query_parallel_unittest_cb, c, slots);
+
+    size_t errors = 0;
+    for(size_t s = 0; s < QUERY_PARALLEL_UNITTEST_SLOTS ; s++) {
+        size_t expected = (s < slots) ? 1 : 0;
+        size_t executions = __atomic_load_n(&c->executions[s], __ATOMIC_RELAXED);
+        if(executions != expected) {
+            if(errors < 10)
+                fprintf(stderr, " >>> QUERYPAR: caller %zu, %zu slots: slot %zu executed %zu times, expected %zu\n",
+                        c->id, slots, s, executions, expected);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+static void query_parallel_unittest_caller_thread(void *ptr) {
+    struct query_parallel_unittest_caller *c = ptr;
+
+    for(size_t i = 0; i < QUERY_PARALLEL_UNITTEST_ITERATIONS ; i++) {
+        size_t slots = 1 + (c->id * 131 + i * 97) % QUERY_PARALLEL_UNITTEST_SLOTS;
+        c->errors += query_parallel_unittest_run(c, slots);
+    }
+}
+
+int query_parallel_unittest(void) {
+    size_t errors = 0;
+    struct query_parallel_unittest_caller *callers = callocz(QUERY_PARALLEL_UNITTEST_CALLERS, sizeof(*callers));
+    for(size_t i = 0; i < QUERY_PARALLEL_UNITTEST_CALLERS ; i++)
+        callers[i].id = i;
+
+    fprintf(stderr, "\nQUERYPAR: executing slots without the pool...\n");
+    if(query_parallel_workers()) {
+        fprintf(stderr, " >>> QUERYPAR: the pool is running before it is started\n");
+        errors++;
+    }
+    errors += query_parallel_unittest_run(&callers[0], 0);
+    errors += query_parallel_unittest_run(&callers[0], 1);
+    errors += query_parallel_unittest_run(&callers[0], QUERY_PARALLEL_UNITTEST_SLOTS);
+
+    fprintf(stderr, "QUERYPAR: executing slots on the pool...\n");
+    if(!query_parallel_unittest_pool_start()) {
+        fprintf(stderr, " >>> QUERYPAR: the pool did not start\n");
+        errors++;
+    }
+    else {
+        errors += query_parallel_unittest_run(&callers[0], 1);
+        errors += query_parallel_unittest_run(&callers[0], QUERY_PARALLEL_UNITTEST_SLOTS);
+
+        fprintf(stderr, "QUERYPAR: executing slots on the pool, from %d concurrent callers...\n",
+                QUERY_PARALLEL_UNITTEST_CALLERS);
+
+        for(size_t i = 0; i < QUERY_PARALLEL_UNITTEST_CALLERS ; i++) {
+            char tag[ND_THREAD_TAG_MAX + 1];
+            snprintfz(tag, sizeof(tag), "QPTEST[%zu]", i);
+            callers[i].thread = nd_thread_create(tag, NETDATA_THREAD_OPTION_DONT_LOG, query_parallel_unittest_caller_thread, &callers[i]);
+        }
+
+        for(size_t i = 0; i < QUERY_PARALLEL_UNITTEST_CALLERS ; i++) {
+            nd_thread_join(callers[i].thread);
+            errors += callers[i].errors;
+        }
+
+        query_parallel_unittest_pool_stop();
+
+        if(query_parallel_workers()) {
+            fprintf(stderr, " >>> QUERYPAR: the pool is running after it is stopped\n");
+            errors++;
+        }
+
+        // callers execute their slots by themselves again
+        errors += query_parallel_unittest_run(&callers[0], QUERY_PARALLEL_UNITTEST_SLOTS);
+    }
+
+    freez(callers);
+
+    fprintf(stderr, "QUERYPAR: %zu errors\n", errors);
+    return errors ? 1 : 0;
+}
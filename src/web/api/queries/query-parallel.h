@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_QUERY_PARALLEL_H
+#define NETDATA_QUERY_PARALLEL_H
+
+#include "database/rrd.h"
+
+// queries with fewer metrics than this are executed serially
+#define QUERY_PARALLEL_MIN_METRICS 64
+
+// how many metrics each worker gets per batch of a parallel query
+#define QUERY_PARALLEL_SLOTS_PER_WORKER 4
+
+typedef void (*query_parallel_cb_t)(void *data, size_t slot);
+
+// the number of threads that can execute slots of a parallel query
+// (including the caller) - zero when the pool is not running
+size_t query_parallel_workers(void);
+
+// execute cb(data, slot) for slot 0 to slots - 1, on the pool and the calling thread
+// returns when all slots have been executed
+void query_parallel_execute(query_parallel_cb_t cb, void *data, size_t slots);
+
+void query_parallel_thread(void *ptr);
+
+// for unittests, to run the pool without the static thread
+bool query_parallel_unittest_pool_start(void);
+void query_parallel_unittest_pool_stop(void);
+int query_parallel_unittest(void);
+
+#endif //NETDATA_QUERY_PARALLEL_H
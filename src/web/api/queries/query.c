@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "query-internal.h"
+#include "query-parallel.h"
 
 // ----------------------------------------------------------------------------
 // helpers to find our way in RRDR
@@ -446,8 +447,6 @@ NOT_INLINE_HOT static void rrd2rrdr_query_execute(RRDR *r, size_t dim_id_in_rrdr
 
     r->stats.result_points_generated += points_added;
     r->stats.db_points_read += ops->db_total_points_read;
-    for(size_t tr = 0; tr < nd_profile.storage_tiers; tr++)
-        qt->db.tiers[tr].points += ops->db_points_read_per_tier[tr];
 }
 
 // ----------------------------------------------------------------------------
@@ -823,6 +822,378 @@ bool query_target_calculate_window(QUERY_TARGET *qt) {
     return true;
 }
 
+// ----------------------------------------------------------------------------
+// per metric accounting, common to serial and parallel execution
+
+struct rrd2rrdr_metrics_progress {
+    QUERY_NODE *last_qn;
+    usec_t last_ut;
+    usec_t last_qn_ut;
+
+    time_t max_after, min_before;
+    size_t max_rows;
+
+    long dimensions_used, dimensions_nonzero;
+    size_t last_db_points_read;
+    size_t last_result_points_generated;
+};
+
+static void rrd2rrdr_metric_node_switch(struct rrd2rrdr_metrics_progress *p, QUERY_NODE *qn) {
+    usec_t now_ut = p->last_ut;
+    if(qn != p->last_qn) {
+        if(p->last_qn)
+            p->last_qn->duration_ut = now_ut - p->last_qn_ut;
+
+        p->last_qn = qn;
+        p->last_qn_ut = now_ut;
+    }
+}
+
+// called for every metric, in order, after its query has been executed into r_tmp
+// it releases ops and returns true when the query has to be cancelled
+static bool rrd2rrdr_metric_completed(RRDR *r_tmp, RRDR *r, struct rrd2rrdr_metrics_progress *p, size_t d, QUERY_ENGINE_OPS *ops, usec_t now_ut) {
+    QUERY_TARGET *qt = r_tmp->internal.qt;
+    QUERY_METRIC *qm = query_metric(qt, d);
+    QUERY_DIMENSION *qd = query_dimension(qt, qm->link.query_dimension_id);
+    QUERY_INSTANCE *qi = query_instance(qt, qm->link.query_instance_id);
+    QUERY_CONTEXT *qc = query_context(qt, qm->link.query_context_id);
+    QUERY_NODE *qn = query_node(qt, qm->link.query_node_id);
+
+    size_t dim_in_rrdr_tmp = (r_tmp != r) ? 0 : d;
+
+    if(!ops) {
+        qi->metrics.failed++;
+        qc->metrics.failed++;
+        qn->metrics.failed++;
+
+        qd->status |= QUERY_STATUS_FAILED;
+        qm->status |= RRDR_DIMENSION_FAILED;
+
+        return false;
+    }
+
+    r_tmp->od[dim_in_rrdr_tmp] |= RRDR_DIMENSION_QUERIED;
+
+    for(size_t tr = 0; tr < nd_profile.storage_tiers; tr++)
+        qt->db.tiers[tr].points += ops->db_points_read_per_tier[tr];
+
+    if(r_tmp != r) {
+        // copy back whatever got updated from the temporary r
+
+        // the query updates RRDR_DIMENSION_NONZERO
+        qm->status = r_tmp->od[dim_in_rrdr_tmp];
+
+        // the query updates these
+        r->view.min = r_tmp->view.min;
+        r->view.max = r_tmp->view.max;
+        r->view.after = r_tmp->view.after;
+        r->view.before = r_tmp->view.before;
+        r->rows = r_tmp->rows;
+
+        rrd2rrdr_group_by_add_metric(r, qm->grouped_as.first_slot, r_tmp, dim_in_rrdr_tmp,
+                                     qt->request.group_by[0].aggregation, &qm->query_points, 0);
+    }
+
+    rrd2rrdr_query_ops_release(ops); // reuse this ops allocation
+
+    qi->metrics.queried++;
+    qc->metrics.queried++;
+    qn->metrics.queried++;
+
+    qd->status |= QUERY_STATUS_QUERIED;
+    qm->status |= RRDR_DIMENSION_QUERIED;
+
+    if(qt->request.version >= 2) {
+        // we need to make the query points positive now
+        // since we will aggregate it across multiple dimensions
+        storage_point_make_positive(qm->query_points);
+        storage_point_merge_to(qi->query_points, qm->query_points);
+        storage_point_merge_to(qc->query_points, qm->query_points);
+        storage_point_merge_to(qn->query_points, qm->query_points);
+        storage_point_merge_to(qt->query_points, qm->query_points);
+    }
+
+    pulse_queries_rrdr_query_completed(
+        1,
+        r_tmp->stats.db_points_read - p->last_db_points_read,
+        r_tmp->stats.result_points_generated - p->last_result_points_generated,
+        qt->request.query_source);
+
+    p->last_db_points_read = r_tmp->stats.db_points_read;
+    p->last_result_points_generated = r_tmp->stats.result_points_generated;
+
+    if(qm->status & RRDR_DIMENSION_NONZERO)
+        p->dimensions_nonzero++;
+
+    // verify all dimensions are aligned
+    if(unlikely(!p->dimensions_used)) {
+        p->min_before = r->view.before;
+        p->max_after = r->view.after;
+        p->max_rows = r->rows;
+    }
+    else {
+        if(r->view.after != p->max_after) {
+            internal_error(true, "QUERY: 'after' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
+                           rrdinstance_acquired_id(qi->ria), (size_t)p->max_after, rrdmetric_acquired_id(qd->rma), (size_t)r->view.after);
+
+            r->view.after = (r->view.after > p->max_after) ? r->view.after : p->max_after;
+        }
+
+        if(r->view.before != p->min_before) {
+            internal_error(true, "QUERY: 'before' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
+                           rrdinstance_acquired_id(qi->ria), (size_t)p->min_before, rrdmetric_acquired_id(qd->rma), (size_t)r->view.before);
+
+            r->view.before = (r->view.before < p->min_before) ? r->view.before : p->min_before;
+        }
+
+        if(r->rows != p->max_rows) {
+            internal_error(true, "QUERY: 'rows' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
+                           rrdinstance_acquired_id(qi->ria), (size_t)p->max_rows, rrdmetric_acquired_id(qd->rma), (size_t)r->rows);
+
+            r->rows = (r->rows > p->max_rows) ? r->rows : p->max_rows;
+        }
+    }
+
+    p->dimensions_used++;
+
+    bool cancel = false;
+    if (qt->request.interrupt_callback && qt->request.interrupt_callback(qt->request.interrupt_callback_data)) {
+        cancel = true;
+        nd_log(NDLS_ACCESS, NDLP_NOTICE, "QUERY INTERRUPTED");
+    }
+
+    if (qt->request.timeout_ms && ((NETDATA_DOUBLE)(now_ut - qt->timings.received_ut) / 1000.0) > (NETDATA_DOUBLE)qt->request.timeout_ms) {
+        cancel = true;
+        nd_log(NDLS_ACCESS, NDLP_WARNING, "QUERY CANCELED RUNTIME EXCEEDED %0.2f ms (LIMIT %lld ms)",
+                   (NETDATA_DOUBLE)(now_ut - qt->timings.received_ut) / 1000.0, (long long)qt->request.timeout_ms);
+    }
+
+    if(cancel)
+        r->view.flags |= RRDR_RESULT_FLAG_CANCEL;
+    else
+        query_progress_done_step(qt->request.transaction, 1);
+
+    return cancel;
+}
+
+// ----------------------------------------------------------------------------
+// serial execution, one metric at a time, preparing a few queries ahead
+
+static void rrd2rrdr_query_metrics_serial(RRDR *r_tmp, RRDR *r, struct rrd2rrdr_metrics_progress *p, QUERY_ENGINE_OPS **ops) {
+    QUERY_TARGET *qt = r_tmp->internal.qt;
+
+    size_t capacity = MAX(netdata_conf_cpus() / 2, 4);
+    size_t max_queries_to_prepare = (qt->query.used > (capacity - 1)) ? (capacity - 1) : qt->query.used;
+    size_t queries_prepared = 0;
+    while(queries_prepared < max_queries_to_prepare) {
+        // preload another query
+        ops[queries_prepared] = rrd2rrdr_query_ops_prep(r_tmp, queries_prepared);
+        queries_prepared++;
+    }
+
+    for(size_t d = 0; d < qt->query.used ; d++) {
+        QUERY_METRIC *qm = query_metric(qt, d);
+        rrd2rrdr_metric_node_switch(p, query_node(qt, qm->link.query_node_id));
+
+        if(queries_prepared < qt->query.used) {
+            // preload another query
+            ops[queries_prepared] = rrd2rrdr_query_ops_prep(r_tmp, queries_prepared);
+            queries_prepared++;
+        }
+
+        size_t dim_in_rrdr_tmp = (r_tmp != r) ? 0 : d;
+
+        // set the query target dimension options to rrdr
+        r_tmp->od[dim_in_rrdr_tmp] = qm->status;
+
+        // reset the grouping for the new dimension
+        r_tmp->time_grouping.reset(r_tmp);
+
+        usec_t now_ut = p->last_ut;
+        if(ops[d]) {
+            rrd2rrdr_query_execute(r_tmp, dim_in_rrdr_tmp, ops[d]);
+
+            now_ut = now_monotonic_usec();
+            qm->duration_ut = now_ut - p->last_ut;
+            p->last_ut = now_ut;
+        }
+
+        bool cancel = rrd2rrdr_metric_completed(r_tmp, r, p, d, ops[d], now_ut);
+        ops[d] = NULL;
+
+        if(cancel) {
+            for(size_t i = d + 1; i < queries_prepared ; i++) {
+                if(ops[i]) {
+                    query_planer_finalize_remaining_plans(ops[i]);
+                    rrd2rrdr_query_ops_release(ops[i]);
+                    ops[i] = NULL;
+                }
+            }
+
+            break;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// parallel execution
+//
+// The metrics are executed in batches. Each metric of a batch is executed by
+// the query parallel workers into its own scratch RRDR (with its own ONEWAYALLOC,
+// since the time grouping functions may allocate memory while adding points).
+// Then this thread imports the scratch RRDRs into r_tmp, in metric order, and
+// accounts them exactly like the serial path does, so that group-by and the
+// node/context/instance totals are aggregated in the same order and the result
+// is identical to the serial one.
+
+struct rrd2rrdr_parallel_slot {
+    ONEWAYALLOC *owa;
+    RRDR *r;
+    QUERY_ENGINE_OPS *ops;
+    usec_t duration_ut;
+    bool executed;
+};
+
+struct rrd2rrdr_parallel {
+    QUERY_TARGET *qt;
+    struct rrd2rrdr_parallel_slot *slots;
+    bool timed_out;
+};
+
+static void rrd2rrdr_parallel_slot_execute(void *data, size_t slot) {
+    struct rrd2rrdr_parallel *pq = data;
+    struct rrd2rrdr_parallel_slot *s = &pq->slots[slot];
+    QUERY_TARGET *qt = pq->qt;
+
+    s->executed = false;
+    if(!s->ops || __atomic_load_n(&pq->timed_out, __ATOMIC_RELAXED))
+        return;
+
+    usec_t started_ut = now_monotonic_usec();
+    if (qt->request.timeout_ms && ((NETDATA_DOUBLE)(started_ut - qt->timings.received_ut) / 1000.0) > (NETDATA_DOUBLE)qt->request.timeout_ms) {
+        __atomic_store_n(&pq->timed_out, true, __ATOMIC_RELAXED);
+        return;
+    }
+
+    RRDR *r = s->r;
+    r->od[0] = s->ops->qm->status;
+    r->view.min = r->view.max = 0.0;
+    r->internal.queries_count = 0;
+    r->stats.db_points_read = 0;
+    r->stats.result_points_generated = 0;
+    r->time_grouping.reset(r);
+
+    rrd2rrdr_query_execute(r, 0, s->ops);
+
+    s->duration_ut = now_monotonic_usec() - started_ut;
+    s->executed = true;
+}
+
+static void rrd2rrdr_parallel_slot_import(RRDR *r_tmp, size_t dim_in_rrdr_tmp, struct rrd2rrdr_parallel_slot *s) {
+    RRDR *rs = s->r;
+
+    for(size_t i = 0; i < rs->n ; i++) {
+        size_t idx = i * r_tmp->d + dim_in_rrdr_tmp;
+        r_tmp->v[idx] = rs->v[i];
+        r_tmp->o[idx] = rs->o[i];
+        r_tmp->ar[idx] = rs->ar[i];
+    }
+
+    r_tmp->od[dim_in_rrdr_tmp] = rs->od[0];
+
+    // every executed metric adds at least one point, when points are wanted,
+    // and these are always numbers, so min/max can be merged in any order
+    if(rs->n) {
+        if(!r_tmp->internal.queries_count) {
+            r_tmp->view.min = rs->view.min;
+            r_tmp->view.max = rs->view.max;
+        }
+        else {
+            if(rs->view.min < r_tmp->view.min) r_tmp->view.min = rs->view.min;
+            if(rs->view.max > r_tmp->view.max) r_tmp->view.max = rs->view.max;
+        }
+    }
+
+    r_tmp->internal.queries_count++;
+    r_tmp->stats.db_points_read += rs->stats.db_points_read;
+    r_tmp->stats.result_points_generated += rs->stats.result_points_generated;
+}
+
+static void rrd2rrdr_query_metrics_parallel(RRDR *r_tmp, RRDR *r, struct rrd2rrdr_metrics_progress *p, QUERY_ENGINE_OPS **ops, size_t workers) {
+    QUERY_TARGET *qt = r_tmp->internal.qt;
+
+    size_t batch_max = MIN(workers * QUERY_PARALLEL_SLOTS_PER_WORKER, qt->query.used);
+    struct rrd2rrdr_parallel_slot slots[batch_max];
+    struct rrd2rrdr_parallel pq = {
+        .qt = qt,
+        .slots = slots,
+        .timed_out = false,
+    };
+
+    for(size_t s = 0; s < batch_max ; s++) {
+        slots[s] = (struct rrd2rrdr_parallel_slot){ 0 };
+        slots[s].owa = onewayalloc_create(0);
+        slots[s].r = rrdr_create(slots[s].owa, qt, 1, qt->window.points);
+        rrd2rrdr_set_timestamps(slots[s].r);
+        rrdr_set_grouping_function(slots[s].r, qt->window.time_group_method);
+        slots[s].r->time_grouping.create(slots[s].r, qt->window.time_group_options);
+    }
+
+    bool cancel = false;
+    for(size_t base = 0; base < qt->query.used && !cancel ; base += batch_max) {
+        size_t batch = MIN(batch_max, qt->query.used - base);
+
+        // the query ops are allocated and recycled by this thread
+        for(size_t s = 0; s < batch ; s++)
+            slots[s].ops = ops[base + s] = rrd2rrdr_query_ops_prep(r_tmp, base + s);
+
+        query_parallel_execute(rrd2rrdr_parallel_slot_execute, &pq, batch);
+
+        for(size_t s = 0; s < batch ; s++) {
+            size_t d = base + s;
+
+            if(cancel || (ops[d] && !slots[s].executed)) {
+                if(!cancel) {
+                    r->view.flags |= RRDR_RESULT_FLAG_CANCEL;
+                    nd_log(NDLS_ACCESS, NDLP_WARNING, "QUERY CANCELED RUNTIME EXCEEDED (LIMIT %lld ms)",
+                           (long long)qt->request.timeout_ms);
+                    cancel = true;
+                }
+
+                if(ops[d]) {
+                    query_planer_finalize_remaining_plans(ops[d]);
+                    rrd2rrdr_query_ops_release(ops[d]);
+                    ops[d] = NULL;
+                }
+                continue;
+            }
+
+            QUERY_METRIC *qm = query_metric(qt, d);
+            rrd2rrdr_metric_node_switch(p, query_node(qt, qm->link.query_node_id));
+
+            size_t dim_in_rrdr_tmp = (r_tmp != r) ? 0 : d;
+            r_tmp->od[dim_in_rrdr_tmp] = qm->status;
+
+            usec_t now_ut = p->last_ut;
+            if(ops[d]) {
+                rrd2rrdr_parallel_slot_import(r_tmp, dim_in_rrdr_tmp, &slots[s]);
+
+                now_ut = now_monotonic_usec();
+                qm->duration_ut = slots[s].duration_ut;
+                p->last_ut = now_ut;
+            }
+
+            cancel = rrd2rrdr_metric_completed(r_tmp, r, p, d, ops[d], now_ut);
+            ops[d] = NULL;
+        }
+    }
+
+    for(size_t s = 0; s < batch_max ; s++) {
+        slots[s].r->time_grouping.free(slots[s].r);
+        onewayalloc_destroy(slots[s].owa);
+    }
+}
+
 // ----------------------------------------------------------------------------
 // query entry point
 
@@ -895,12 +1266,11 @@ RRDR *rrd2rrdr(ONEWAYALLOC *owa, QUERY_TARGET *qt) {
     // -------------------------------------------------------------------------
     // do the work for each dimension
 
-    time_t max_after = 0, min_before = 0;
-    size_t max_rows = 0;
-
-    long dimensions_used = 0, dimensions_nonzero = 0;
-    size_t last_db_points_read = 0;
-    size_t last_result_points_generated = 0;
+    struct rrd2rrdr_metrics_progress p = {
+        .last_qn = NULL,
+        .last_ut = now_monotonic_usec(),
+    };
+    p.last_qn_ut = p.last_ut;
 
     // internal_fatal(released_ops, "QUERY: released_ops should be NULL when the query starts");
 
@@ -910,176 +1280,11 @@ RRDR *rrd2rrdr(ONEWAYALLOC *owa, QUERY_TARGET *qt) {
     if(qt->query.used)
         ops = onewayalloc_callocz(owa, qt->query.used, sizeof(QUERY_ENGINE_OPS *));
 
-    size_t capacity = MAX(netdata_conf_cpus() / 2, 4);
-    size_t max_queries_to_prepare = (qt->query.used > (capacity - 1)) ? (capacity - 1) : qt->query.used;
-    size_t queries_prepared = 0;
-    while(queries_prepared < max_queries_to_prepare) {
-        // preload another query
-        ops[queries_prepared] = rrd2rrdr_query_ops_prep(r_tmp, queries_prepared);
-        queries_prepared++;
-    }
-
-    QUERY_NODE *last_qn = NULL;
-    usec_t last_ut = now_monotonic_usec();
-    usec_t last_qn_ut = last_ut;
-
-    for(size_t d = 0; d < qt->query.used ; d++) {
-        QUERY_METRIC *qm = query_metric(qt, d);
-        QUERY_DIMENSION *qd = query_dimension(qt, qm->link.query_dimension_id);
-        QUERY_INSTANCE *qi = query_instance(qt, qm->link.query_instance_id);
-        QUERY_CONTEXT *qc = query_context(qt, qm->link.query_context_id);
-        QUERY_NODE *qn = query_node(qt, qm->link.query_node_id);
-
-        usec_t now_ut = last_ut;
-        if(qn != last_qn) {
-            if(last_qn)
-                last_qn->duration_ut = now_ut - last_qn_ut;
-
-            last_qn = qn;
-            last_qn_ut = now_ut;
-        }
-
-        if(queries_prepared < qt->query.used) {
-            // preload another query
-            ops[queries_prepared] = rrd2rrdr_query_ops_prep(r_tmp, queries_prepared);
-            queries_prepared++;
-        }
-
-        size_t dim_in_rrdr_tmp = (r_tmp != r) ? 0 : d;
-
-        // set the query target dimension options to rrdr
-        r_tmp->od[dim_in_rrdr_tmp] = qm->status;
-
-        // reset the grouping for the new dimension
-        r_tmp->time_grouping.reset(r_tmp);
-
-        if(ops[d]) {
-            rrd2rrdr_query_execute(r_tmp, dim_in_rrdr_tmp, ops[d]);
-            r_tmp->od[dim_in_rrdr_tmp] |= RRDR_DIMENSION_QUERIED;
-
-            now_ut = now_monotonic_usec();
-            qm->duration_ut = now_ut - last_ut;
-            last_ut = now_ut;
-
-            if(r_tmp != r) {
-                // copy back whatever got updated from the temporary r
-
-                // the query updates RRDR_DIMENSION_NONZERO
-                qm->status = r_tmp->od[dim_in_rrdr_tmp];
-
-                // the query updates these
-                r->view.min = r_tmp->view.min;
-                r->view.max = r_tmp->view.max;
-                r->view.after = r_tmp->view.after;
-                r->view.before = r_tmp->view.before;
-                r->rows = r_tmp->rows;
-
-                rrd2rrdr_group_by_add_metric(r, qm->grouped_as.first_slot, r_tmp, dim_in_rrdr_tmp,
-                                             qt->request.group_by[0].aggregation, &qm->query_points, 0);
-            }
-
-            rrd2rrdr_query_ops_release(ops[d]); // reuse this ops allocation
-            ops[d] = NULL;
-
-            qi->metrics.queried++;
-            qc->metrics.queried++;
-            qn->metrics.queried++;
-
-            qd->status |= QUERY_STATUS_QUERIED;
-            qm->status |= RRDR_DIMENSION_QUERIED;
-
-            if(qt->request.version >= 2) {
-                // we need to make the query points positive now
-                // since we will aggregate it across multiple dimensions
-                storage_point_make_positive(qm->query_points);
-                storage_point_merge_to(qi->query_points, qm->query_points);
-                storage_point_merge_to(qc->query_points, qm->query_points);
-                storage_point_merge_to(qn->query_points, qm->query_points);
-                storage_point_merge_to(qt->query_points, qm->query_points);
-            }
-        }
-        else {
-            qi->metrics.failed++;
-            qc->metrics.failed++;
-            qn->metrics.failed++;
-
-            qd->status |= QUERY_STATUS_FAILED;
-            qm->status |= RRDR_DIMENSION_FAILED;
-
-            continue;
-        }
-
-        pulse_queries_rrdr_query_completed(
-            1,
-            r_tmp->stats.db_points_read - last_db_points_read,
-            r_tmp->stats.result_points_generated - last_result_points_generated,
-            qt->request.query_source);
-
-        last_db_points_read = r_tmp->stats.db_points_read;
-        last_result_points_generated = r_tmp->stats.result_points_generated;
-
-        if(qm->status & RRDR_DIMENSION_NONZERO)
-            dimensions_nonzero++;
-
-        // verify all dimensions are aligned
-        if(unlikely(!dimensions_used)) {
-            min_before = r->view.before;
-            max_after = r->view.after;
-            max_rows = r->rows;
-        }
-        else {
-            if(r->view.after != max_after) {
-                internal_error(true, "QUERY: 'after' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
-                               rrdinstance_acquired_id(qi->ria), (size_t)max_after, rrdmetric_acquired_id(qd->rma), (size_t)r->view.after);
-
-                r->view.after = (r->view.after > max_after) ? r->view.after : max_after;
-            }
-
-            if(r->view.before != min_before) {
-                internal_error(true, "QUERY: 'before' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
-                               rrdinstance_acquired_id(qi->ria), (size_t)min_before, rrdmetric_acquired_id(qd->rma), (size_t)r->view.before);
-
-                r->view.before = (r->view.before < min_before) ? r->view.before : min_before;
-            }
-
-            if(r->rows != max_rows) {
-                internal_error(true, "QUERY: 'rows' mismatch between dimensions for chart '%s': max is %zu, dimension '%s' has %zu",
-                               rrdinstance_acquired_id(qi->ria), (size_t)max_rows, rrdmetric_acquired_id(qd->rma), (size_t)r->rows);
-
-                r->rows = (r->rows > max_rows) ? r->rows : max_rows;
-            }
-        }
-
-        dimensions_used++;
-
-        bool cancel = false;
-        if (qt->request.interrupt_callback && qt->request.interrupt_callback(qt->request.interrupt_callback_data)) {
-            cancel = true;
-            nd_log(NDLS_ACCESS, NDLP_NOTICE, "QUERY INTERRUPTED");
-        }
-
-        if (qt->request.timeout_ms && ((NETDATA_DOUBLE)(now_ut - qt->timings.received_ut) / 1000.0) > (NETDATA_DOUBLE)qt->request.timeout_ms) {
-            cancel = true;
-            nd_log(NDLS_ACCESS, NDLP_WARNING, "QUERY CANCELED RUNTIME EXCEEDED %0.2f ms (LIMIT %lld ms)",
-                       (NETDATA_DOUBLE)(now_ut - qt->timings.received_ut) / 1000.0, (long long)qt->request.timeout_ms);
-        }
-
-        if(cancel) {
-            r->view.flags |= RRDR_RESULT_FLAG_CANCEL;
-
-            for(size_t i = d + 1; i < queries_prepared ; i++) {
-                if(ops[i]) {
-                    query_planer_finalize_remaining_plans(ops[i]);
-                    rrd2rrdr_query_ops_release(ops[i]);
-                    ops[i] = NULL;
-                }
-            }
-
-            break;
-        }
-        else
-            query_progress_done_step(qt->request.transaction, 1);
-    }
+    size_t workers = query_parallel_workers();
+    if(workers > 1 && qt->query.used >= QUERY_PARALLEL_MIN_METRICS)
+        rrd2rrdr_query_metrics_parallel(r_tmp, r, &p, ops, workers);
+    else
+        rrd2rrdr_query_metrics_serial(r_tmp, r, &p, ops);
 
     // free all resources used by the grouping method
     r_tmp->time_grouping.free(r_tmp);
@@ -1091,7 +1296,7 @@ RRDR *rrd2rrdr(ONEWAYALLOC *owa, QUERY_TARGET *qt) {
     r = rrd2rrdr_cardinality_limit(r);
 
 #ifdef NETDATA_INTERNAL_CHECKS
-    if (dimensions_used && !(r->view.flags & RRDR_RESULT_FLAG_CANCEL)) {
+    if (p.dimensions_used && !(r->view.flags & RRDR_RESULT_FLAG_CANCEL)) {
         if(r->internal.log)
             rrd2rrdr_log_request_response_metadata(r, qt->window.options, qt->window.time_group_method, qt->window.aligned, qt->window.group, qt->request.resampling_time, qt->window.resampling_group,
                                                    qt->window.after, qt->request.after, qt->window.before, qt->request.before,
@@ -1146,7 +1351,7 @@ RRDR *rrd2rrdr(ONEWAYALLOC *owa, QUERY_TARGET *qt) {
 
     onewayalloc_freez(owa, ops);
 
-    if(likely(dimensions_used && (qt->window.options & RRDR_OPTION_NONZERO) && !dimensions_nonzero))
+    if(likely(p.dimensions_used && (qt->window.options & RRDR_OPTION_NONZERO) && !p.dimensions_nonzero))
         // when all the dimensions are zero, we should return all of them
         qt->window.options &= ~RRDR_OPTION_NONZERO;
 
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "api_v2_calls.h"
+#include "web/api/queries/query-cache.h"
 
 #define GROUP_BY_KEY_MAX_LENGTH 30
 static struct {
@@ -290,8 +291,12 @@ static int api_v23_data_internal(RRDHOST *host __maybe_unused, struct web_client
         buffer_strcat(w->response.data, "(");
     }
 
-    owa = onewayalloc_create(0);
-    ret = data_query_execute(owa, w->response.data, qt, &last_timestamp_in_data);
+    size_t offset = buffer_strlen(w->response.data);
+    if(!query_cache_get(qt, w->response.data, &last_timestamp_in_data, &ret)) {
+        owa = onewayalloc_create(0);
+        ret = data_query_execute(owa, w->response.data, qt, &last_timestamp_in_data);
+        query_cache_set(qt, w->response.data, offset, last_timestamp_in_data, ret);
+    }
 
     if(format == DATASOURCE_DATATABLE_JSONP) {
         if(google_timestamp < last_timestamp_in_data)
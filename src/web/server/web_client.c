@@ -4,6 +4,11 @@
 #include "web/websocket/websocket.h"
 #include "web/mcp/adapters/mcp-http.h"
 #include "web/mcp/adapters/mcp-sse.h"
+#include "web_static_files.h"
+
+#if defined(OS_LINUX)
+#include <sys/sendfile.h>
+#endif
 
 // this is an async I/O implementation of the web server request parser
 // it is used by all netdata web servers
@@ -164,6 +169,18 @@ static void web_client_reset_allocations(struct web_client *w, bool free_all) {
 
     freez(w->auth_bearer_token);
     w->auth_bearer_token = NULL;
+
+    freez(w->if_none_match);
+    w->if_none_match = NULL;
+
+    // close a static file we were sending
+    if(w->response.file.fd != -1) {
+        close(w->response.file.fd);
+        w->response.file.fd = -1;
+    }
+    w->response.file.offset = 0;
+    w->response.file.size = 0;
+    w->response.static_not_modified = false;
     
     // Free WebSocket resources
     freez(w->websocket.key);
@@ -192,7 +209,7 @@ static void web_client_reset_allocations(struct web_client *w, bool free_all) {
     memset(&w->user_auth, 0, sizeof(w->user_auth));
 
     web_client_reset_permissions(w);
-    web_client_flag_clear(w, WEB_CLIENT_ENCODING_GZIP|WEB_CLIENT_ENCODING_DEFLATE);
+    web_client_flag_clear(w, WEB_CLIENT_ENCODING_GZIP|WEB_CLIENT_ENCODING_DEFLATE|WEB_CLIENT_ENCODING_BROTLI);
     web_client_flag_clear(w, WEB_CLIENT_FLAG_ACCEPT_JSON |
                              WEB_CLIENT_FLAG_ACCEPT_SSE |
                              WEB_CLIENT_FLAG_ACCEPT_TEXT);
@@ -203,7 +220,7 @@ void web_client_log_completed_request(struct web_client *w, bool update_web_stat
     struct timeval tv;
     now_monotonic_high_precision_timeval(&tv);
 
-    size_t size = w->response.data->len;
+    size_t size = w->response.data->len + w->response.file.size;
     size_t sent = w->response.zoutput ? (size_t)w->response.zstream.total_out : size;
 
     usec_t prep_ut = w->timings.tv_ready.tv_sec ? dt_usec(&w->timings.tv_ready, &w->timings.tv_in) : 0;
@@ -434,6 +451,32 @@ static bool find_filename_to_serve(const char *filename, char *dst, size_t dst_l
     return true;
 }
 
+static inline bool web_client_can_sendfile(struct web_client *w) {
+#if defined(OS_LINUX)
+    return (web_client_check_conn_tcp(w) || web_client_check_conn_unix(w)) && !SSL_connection(&w->ssl);
+#else
+    (void)w;
+    return false;
+#endif
+}
+
+// static files are either precompressed, or sent as they are on disk
+static inline void web_client_static_file_no_deflate(struct web_client *w) {
+    w->response.zoutput = false;
+    web_client_flag_clear(w, WEB_CLIENT_CHUNKED_TRANSFER);
+}
+
+static inline void web_client_static_file_cacheable(struct web_client *w, struct stat *statbuf) {
+#ifdef __APPLE__
+    w->response.data->date = statbuf->st_mtimespec.tv_sec;
+#else
+    w->response.data->date = statbuf->st_mtim.tv_sec;
+#endif
+    w->response.data->expires = now_realtime_sec() + 86400;
+
+    buffer_cacheable(w->response.data);
+}
+
 static int web_server_static_file(struct web_client *w, char *filename) {
     netdata_log_debug(D_WEB_CLIENT, "%llu: Looking for file '%s/%s'", w->id, netdata_configured_web_dir, filename);
 
@@ -479,18 +522,44 @@ static int web_server_static_file(struct web_client *w, char *filename) {
         return append_slash_to_url_and_redirect(w);
 
     buffer_flush(w->response.data);
-    buffer_need_bytes(w->response.data, (size_t)statbuf.st_size);
-    w->response.data->len = (size_t)statbuf.st_size;
+    w->response.data->content_type = contenttype_for_filename(web_filename);
 
-    // open the file
-    int fd = open(web_filename, O_RDONLY | O_CLOEXEC);
+    char etag[WEB_STATIC_FILE_ETAG_MAX];
+    web_static_file_etag(etag, sizeof(etag), &statbuf);
 
-    // read the file
-    if(fd != -1 && read(fd, w->response.data->buffer, statbuf.st_size) != statbuf.st_size) {
-        // cannot read the whole file
-        nd_log(NDLS_DAEMON, NDLP_ERR, "Web server failed to read file '%s'", web_filename);
-        close(fd);
-        fd = -1;
+    if(web_static_file_etag_matches(w->if_none_match, etag)) {
+        // the client has it already - it does not need any of the file contents
+        netdata_log_debug(D_WEB_CLIENT_ACCESS, "%llu: File '%s' is not modified.", w->id, web_filename);
+        buffer_sprintf(w->response.header, "ETag: %s\r\n", etag);
+        web_client_static_file_no_deflate(w);
+        w->response.static_not_modified = true;
+        w->mode = HTTP_REQUEST_MODE_GET;
+        web_client_static_file_cacheable(w, &statbuf);
+        return HTTP_RESP_NOT_MODIFIED;
+    }
+
+    // open the file, or one of its precompressed variants
+    WEB_STATIC_FILE_ENCODING encoding = WEB_STATIC_FILE_IDENTITY;
+    size_t size = 0;
+    int fd = web_static_file_open(web_filename, &statbuf, w->response.data->content_type,
+                                  web_client_flag_check(w, WEB_CLIENT_ENCODING_GZIP),
+                                  web_client_flag_check(w, WEB_CLIENT_ENCODING_BROTLI),
+                                  &encoding, &size);
+
+    bool use_sendfile = fd != -1 && size && web_client_can_sendfile(w);
+
+    if(fd != -1 && !use_sendfile) {
+        buffer_need_bytes(w->response.data, size);
+
+        // read the file
+        if(read(fd, w->response.data->buffer, size) != (ssize_t)size) {
+            // cannot read the whole file
+            nd_log(NDLS_DAEMON, NDLP_ERR, "Web server failed to read file '%s'", web_filename);
+            close(fd);
+            fd = -1;
+        }
+        else
+            w->response.data->len = size;
     }
 
     // check for failures
@@ -513,24 +582,38 @@ static int web_server_static_file(struct web_client *w, char *filename) {
             return HTTP_RESP_NOT_FOUND;
         }
     }
+
+    if(use_sendfile) {
+        w->response.file.fd = fd;
+        w->response.file.offset = 0;
+        w->response.file.size = size;
+    }
     else
         close(fd);
 
-    w->response.data->content_type = contenttype_for_filename(web_filename);
-    netdata_log_debug(D_WEB_CLIENT_ACCESS, "%llu: Sending file '%s' (%"PRId64" bytes, fd %d).", w->id, web_filename, (int64_t)statbuf.st_size, w->fd);
+    buffer_sprintf(w->response.header, "ETag: %s\r\n", etag);
+
+    const char *content_encoding = web_static_file_encoding_2str(encoding);
+    if(content_encoding) {
+        // it is already compressed
+        buffer_sprintf(w->response.header, "Content-Encoding: %s\r\n", content_encoding);
+        web_client_static_file_no_deflate(w);
+    }
+    else if(use_sendfile)
+        // sent as-is from the page cache
+        web_client_static_file_no_deflate(w);
+
+    if(web_enable_gzip)
+        buffer_strcat(w->response.header, "Vary: Accept-Encoding\r\n");
+
+    netdata_log_debug(D_WEB_CLIENT_ACCESS, "%llu: Sending file '%s' (%zu bytes, encoding %s, fd %d).",
+                      w->id, web_filename, size, content_encoding ? content_encoding : "identity", w->fd);
 
     w->mode = HTTP_REQUEST_MODE_GET;
     web_client_enable_wait_send(w);
     web_client_disable_wait_receive(w);
 
-#ifdef __APPLE__
-    w->response.data->date = statbuf.st_mtimespec.tv_sec;
-#else
-    w->response.data->date = statbuf.st_mtim.tv_sec;
-#endif
-    w->response.data->expires = now_realtime_sec() + 86400;
-
-    buffer_cacheable(w->response.data);
+    web_client_static_file_cacheable(w, &statbuf);
 
     return HTTP_RESP_OK;
 }
@@ -809,8 +892,13 @@ static inline ssize_t web_client_send_data(struct web_client *w,const void *buf,
     } while(true);
 }
 
+// a 304 we answered for a static file - other 304s (e.g. of functions) may have a body
+static inline bool web_client_is_static_not_modified(struct web_client *w) {
+    return w->response.code == HTTP_RESP_NOT_MODIFIED && w->response.static_not_modified && !w->response.data->len;
+}
+
 void web_client_build_http_header(struct web_client *w) {
-    if(unlikely(w->response.code != HTTP_RESP_OK))
+    if(unlikely(w->response.code != HTTP_RESP_OK && !web_client_is_static_not_modified(w)))
         buffer_no_cacheable(w->response.data);
 
     if(unlikely(!w->response.data->date))
@@ -902,6 +990,14 @@ void web_client_build_http_header(struct web_client *w) {
 
     if(likely(w->flags & WEB_CLIENT_CHUNKED_TRANSFER))
         buffer_strcat(w->response.header_output, "Transfer-Encoding: chunked\r\n");
+    else if(web_client_is_static_not_modified(w)) {
+        // there is no body, keep-alive can remain enabled
+        ;
+    }
+    else if(w->response.file.fd != -1) {
+        // a static file to be sent with sendfile()
+        buffer_sprintf(w->response.header_output, "Content-Length: %zu\r\n", w->response.file.size);
+    }
     else {
         if(likely(w->response.data->len)) {
             // we know the content length, put it
@@ -1504,7 +1600,9 @@ void web_client_process_request_from_web_server(struct web_client *w) {
     web_client_send_http_header(w);
 
     // enable sending immediately if we have data
-    if(w->response.data->len) web_client_enable_wait_send(w);
+    // (a static file 304 has no data, but the request is completed by web_client_send())
+    if(w->response.data->len || w->response.file.fd != -1 || web_client_is_static_not_modified(w))
+        web_client_enable_wait_send(w);
     else web_client_disable_wait_send(w);
 
     switch(w->mode) {
@@ -1717,29 +1815,67 @@ ssize_t web_client_send_deflate(struct web_client *w)
     return(len);
 }
 
+static ssize_t web_client_send_completed(struct web_client *w) {
+    netdata_log_debug(D_WEB_CLIENT, "%llu: Out of output data.", w->id);
+
+    // there can be two cases for this
+    // A. we have done everything
+    // B. we temporarily have nothing to send, waiting for the buffer to be filled by ifd
+
+    if(unlikely(!web_client_has_keepalive(w))) {
+        netdata_log_debug(D_WEB_CLIENT, "%llu: Closing (keep-alive is not enabled). %zu bytes sent.", w->id, w->response.sent);
+        WEB_CLIENT_IS_DEAD(w);
+        return 0;
+    }
+
+    web_client_request_done(w);
+    netdata_log_debug(D_WEB_CLIENT, "%llu: Done sending all data on socket. Waiting for next request on the same socket.", w->id);
+    return 0;
+}
+
+static ssize_t web_client_send_file(struct web_client *w) {
+    size_t left = w->response.file.size - (size_t)w->response.file.offset;
+    if(!left)
+        return web_client_send_completed(w);
+
+    errno_clear();
+
+#if defined(OS_LINUX)
+    // the kernel copies the file from the page cache to the socket
+    ssize_t bytes = sendfile(w->fd, w->response.file.fd, &w->response.file.offset, left);
+#else
+    ssize_t bytes = -1;
+    errno = ENOSYS;
+#endif
+
+    if(likely(bytes > 0)) {
+        w->statistics.sent_bytes += bytes;
+        w->response.sent += bytes;
+        netdata_log_debug(D_WEB_CLIENT, "%llu: Sent %zd bytes of file.", w->id, bytes);
+    }
+    else if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        netdata_log_debug(D_WEB_CLIENT, "%llu: Did not send any bytes to the client.", w->id);
+        bytes = 0;
+    }
+    else {
+        // zero means the file has been truncated while we were sending it
+        netdata_log_debug(D_WEB_CLIENT, "%llu: Failed to send file to client.", w->id);
+        WEB_CLIENT_IS_DEAD(w);
+        bytes = -1;
+    }
+
+    return bytes;
+}
+
 ssize_t web_client_send(struct web_client *w) {
+    if(w->response.file.fd != -1) return web_client_send_file(w);
     if(likely(w->response.zoutput)) return web_client_send_deflate(w);
 
     ssize_t bytes;
 
     if(unlikely(w->response.data->len - w->response.sent == 0)) {
         // there is nothing to send
-
-        netdata_log_debug(D_WEB_CLIENT, "%llu: Out of output data.", w->id);
-
-        // there can be two cases for this
-        // A. we have done everything
-        // B. we temporarily have nothing to send, waiting for the buffer to be filled by ifd
-
-        if(unlikely(!web_client_has_keepalive(w))) {
-            netdata_log_debug(D_WEB_CLIENT, "%llu: Closing (keep-alive is not enabled). %zu bytes sent.", w->id, w->response.sent);
-            WEB_CLIENT_IS_DEAD(w);
-            return 0;
-        }
-
-        web_client_request_done(w);
-        netdata_log_debug(D_WEB_CLIENT, "%llu: Done sending all data on socket. Waiting for next request on the same socket.", w->id);
-        return 0;
+        return web_client_send_completed(w);
     }
 
     bytes = web_client_send_data(w,&w->response.data->buffer[w->response.sent], w->response.data->len - w->response.sent, MSG_DONTWAIT);
@@ -1874,6 +2010,7 @@ void web_client_reuse_from_cache(struct web_client *w) {
     memset(w, 0, sizeof(struct web_client));
 
     w->fd = -1;
+    w->response.file.fd = -1;
     w->statistics.memory_accounting = statistics_memory_accounting;
     w->use_count = use_count;
 
@@ -1893,6 +2030,7 @@ struct web_client *web_client_create(size_t *statistics_memory_accounting) {
     struct web_client *w = (struct web_client *)callocz(1, sizeof(struct web_client));
 
     w->ssl = NETDATA_SSL_UNSET_CONNECTION;
+    w->response.file.fd = -1;
 
     w->use_count = 1;
     w->statistics.memory_accounting = statistics_memory_accounting;
@@ -1976,3 +2114,223 @@ inline bool web_client_timeout_checkpoint_and_check(struct web_client *w, usec_t
 
     return false;
 }
+
+// --------------------------------------------------------------------------------------------------------------------
+// static files unittest - netdata -W webstaticfilestest
+
+static struct web_client *web_client_static_files_unittest_request(const char *filename, const char *if_none_match, bool gzip, int *code) {
+    static size_t memory_accounting = 0;
+    struct web_client *w = web_client_create(&memory_accounting);
+    w->acl = HTTP_ACL_DASHBOARD;
+    w->mode = HTTP_REQUEST_MODE_GET;
+
+    if(if_none_match)
+        w->if_none_match = strdupz(if_none_match);
+
+    if(gzip)
+        web_client_flag_set(w, WEB_CLIENT_ENCODING_GZIP);
+
+    char name[FILENAME_MAX + 1];
+    strncpyz(name, filename, sizeof(name) - 1);
+    *code = w->response.code = (short)web_server_static_file(w, name);
+    web_client_build_http_header(w);
+    return w;
+}
+
+static bool web_client_static_files_unittest_header(struct web_client *w, const char *header) {
+    return strstr(buffer_tostring(w->response.header_output), header) != NULL;
+}
+
+static bool web_client_static_files_unittest_gunzip(const char *src, size_t src_len, const char *expected, size_t expected_len) {
+    z_stream zs = { 0 };
+    if(inflateInit2(&zs, 15 + 16) != Z_OK)
+        return false;
+
+    char *dst = mallocz(expected_len + 1);
+    zs.next_in = (Bytef *)src;
+    zs.avail_in = (uInt)src_len;
+    zs.next_out = (Bytef *)dst;
+    zs.avail_out = (uInt)expected_len + 1;
+
+    bool ok = inflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out == expected_len && memcmp(dst, expected, expected_len) == 0;
+
+    inflateEnd(&zs);
+    freez(dst);
+    return ok;
+}
+
+static void web_client_static_files_unittest_write(const char *path, const char *data, size_t len) {
+    FILE *fp = fopen(path, "w");
+    if(!fp || fwrite(data, 1, len, fp) != len)
+        fatal("WEB STATIC FILES UNITTEST: cannot write file '%s'", path);
+    fclose(fp);
+}
+
+int web_client_static_files_unittest(void) {
+    size_t errors = 0;
+
+    char base[] = "/tmp/netdata-web-static-files-XXXXXX";
+    if(!mkdtemp(base))
+        fatal("WEB STATIC FILES UNITTEST: cannot create a temporary directory");
+
+    char web_dir[FILENAME_MAX + 1], cache_dir[FILENAME_MAX + 1], path[FILENAME_MAX + 1];
+    snprintfz(web_dir, sizeof(web_dir), "%s/www", base);
+    snprintfz(cache_dir, sizeof(cache_dir), "%s/cache", base);
+    if(mkdir(web_dir, 0755) != 0 || mkdir(cache_dir, 0755) != 0)
+        fatal("WEB STATIC FILES UNITTEST: cannot create directories under '%s'", base);
+
+    const char *saved_web_dir = netdata_configured_web_dir;
+    const char *saved_cache_dir = netdata_configured_cache_dir;
+    netdata_configured_web_dir = web_dir;
+    netdata_configured_cache_dir = cache_dir;
+
+    // the cache directory of a previous run: a stale variant of ours, and a file that is not ours
+    snprintfz(path, sizeof(path), "%s/web", cache_dir);
+    if(mkdir(path, 0755) != 0)
+        fatal("WEB STATIC FILES UNITTEST: cannot create directory '%s'", path);
+
+    char stale[FILENAME_MAX + 1], foreign[FILENAME_MAX + 1];
+    snprintfz(stale, sizeof(stale), "%s/web/0123456789abcdef-1-2-3.gz", cache_dir);
+    snprintfz(foreign, sizeof(foreign), "%s/web/not-ours.gz", cache_dir);
+    web_client_static_files_unittest_write(stale, "stale", 5);
+    web_client_static_files_unittest_write(foreign, "foreign", 7);
+
+    // a compressible file
+    BUFFER *wb = buffer_create(0, NULL);
+    buffer_strcat(wb, "<html><body>\n");
+    for(size_t i = 0; i < 1000; i++)
+        buffer_sprintf(wb, "<p>line %zu of a static file that compresses well</p>\n", i % 10);
+    buffer_strcat(wb, "</body></html>\n");
+    snprintfz(path, sizeof(path), "%s/test.html", web_dir);
+    web_client_static_files_unittest_write(path, buffer_tostring(wb), buffer_strlen(wb));
+
+    int code;
+    struct web_client *w;
+
+    // 1. a plain request gets the file, with an ETag and a Content-Length
+    w = web_client_static_files_unittest_request("test.html", NULL, false, &code);
+    char etag[WEB_STATIC_FILE_ETAG_MAX] = "";
+    const char *e = strstr(buffer_tostring(w->response.header), "ETag: ");
+    if(e) {
+        e += 6;
+        size_t len = strcspn(e, "\r\n");
+        if(len < sizeof(etag)) {
+            memcpy(etag, e, len);
+            etag[len] = '\0';
+        }
+    }
+    if(code != HTTP_RESP_OK || !*etag || w->response.data->len != buffer_strlen(wb) ||
+        memcmp(w->response.data->buffer, buffer_tostring(wb), buffer_strlen(wb)) != 0 ||
+        !web_client_static_files_unittest_header(w, "Content-Length: ")) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: plain request failed (code %d, etag '%s')\n", code, etag);
+        errors++;
+    }
+    web_client_free(w);
+
+    // 2. a revalidation with the ETag gets a 304, without a body, cacheable
+    w = web_client_static_files_unittest_request("test.html", etag, true, &code);
+    if(code != HTTP_RESP_NOT_MODIFIED || w->response.data->len ||
+        web_client_static_files_unittest_header(w, "Content-Length: ") ||
+        !web_client_static_files_unittest_header(w, "Cache-Control: public") ||
+        !web_client_static_files_unittest_header(w, "Connection: keep-alive") ||
+        !web_client_static_files_unittest_header(w, etag)) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: revalidation failed (code %d):\n%s\n", code, buffer_tostring(w->response.header_output));
+        errors++;
+    }
+    web_client_free(w);
+
+    // 3. a different ETag gets the file
+    w = web_client_static_files_unittest_request("test.html", "W/\"1-2-3\", \"4-5-6\"", false, &code);
+    if(code != HTTP_RESP_OK || w->response.data->len != buffer_strlen(wb)) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: request with a stale ETag failed (code %d)\n", code);
+        errors++;
+    }
+    web_client_free(w);
+
+    // 4. the first gzip request gets the file as-is, while the gzip variant is created in the background
+    w = web_client_static_files_unittest_request("test.html", NULL, true, &code);
+    if(code != HTTP_RESP_OK || w->response.data->len != buffer_strlen(wb)) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: first gzip request failed (code %d)\n", code);
+        errors++;
+    }
+    web_client_free(w);
+
+    // 5. when the gzip variant is ready, it is sent precompressed
+    bool compressed = false;
+    for(size_t i = 0; i < 500 && !compressed ; i++) {
+        w = web_client_static_files_unittest_request("test.html", NULL, true, &code);
+        if(web_client_static_files_unittest_header(w, "Content-Encoding: gzip")) {
+            compressed = true;
+            if(code != HTTP_RESP_OK || w->response.zoutput || !w->response.data->len ||
+                w->response.data->len >= buffer_strlen(wb) ||
+                !web_client_static_files_unittest_gunzip(w->response.data->buffer, w->response.data->len, buffer_tostring(wb), buffer_strlen(wb))) {
+                fprintf(stderr, "WEB STATIC FILES UNITTEST: the gzip variant is wrong (code %d, %zu bytes)\n", code, (size_t)w->response.data->len);
+                errors++;
+            }
+        }
+        web_client_free(w);
+
+        if(!compressed)
+            sleep_usec(10 * USEC_PER_MS);
+    }
+    if(!compressed) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: the gzip variant has not been created\n");
+        errors++;
+    }
+
+    // 6. only our own stale variants are removed from the cache directory
+    if(access(stale, F_OK) == 0 || access(foreign, F_OK) != 0) {
+        fprintf(stderr, "WEB STATIC FILES UNITTEST: the cache directory cleanup is wrong (stale %s, foreign %s)\n",
+                access(stale, F_OK) == 0 ? "exists" : "removed", access(foreign, F_OK) == 0 ? "exists" : "removed");
+        errors++;
+    }
+
+    // 7. a 304 that is not a static file (e.g. of a function) keeps its body and is not cacheable
+    {
+        static size_t memory_accounting = 0;
+        w = web_client_create(&memory_accounting);
+        w->mode = HTTP_REQUEST_MODE_GET;
+        w->response.code = HTTP_RESP_NOT_MODIFIED;
+        w->response.data->content_type = CT_APPLICATION_JSON;
+        buffer_strcat(w->response.data, "{\"status\":304}");
+        web_client_build_http_header(w);
+
+        char content_length[50];
+        snprintfz(content_length, sizeof(content_length), "Content-Length: %zu\r\n", (size_t)w->response.data->len);
+        if(!web_client_static_files_unittest_header(w, content_length) ||
+            web_client_static_files_unittest_header(w, "Cache-Control: public")) {
+            fprintf(stderr, "WEB STATIC FILES UNITTEST: a 304 with a body is wrong:\n%s\n", buffer_tostring(w->response.header_output));
+            errors++;
+        }
+        web_client_free(w);
+    }
+
+    buffer_free(wb);
+    netdata_configured_web_dir = saved_web_dir;
+    netdata_configured_cache_dir = saved_cache_dir;
+
+    // cleanup
+    snprintfz(path, sizeof(path), "%s/web", cache_dir);
+    DIR *dir = opendir(path);
+    if(dir) {
+        struct dirent *de;
+        while((de = readdir(dir))) {
+            if(de->d_name[0] == '.')
+                continue;
+
+            char file[FILENAME_MAX + 1];
+            snprintfz(file, sizeof(file), "%s/%s", path, de->d_name);
+            unlink(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+    rmdir(cache_dir);
+    snprintfz(path, sizeof(path), "%s/test.html", web_dir);
+    unlink(path);
+    rmdir(web_dir);
+    rmdir(base);
+
+    fprintf(stderr, "WEB STATIC FILES UNITTEST: %s (%zu errors)\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
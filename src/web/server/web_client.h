@@ -70,6 +70,7 @@ typedef enum __attribute__((packed)) {
     WEB_CLIENT_FLAG_ACCEPT_SSE              = (1 << 26),
     WEB_CLIENT_FLAG_ACCEPT_TEXT             = (1 << 27),
     WEB_CLIENT_FLAG_MCP_PREVIEW_KEY         = (1 << 28), // Authorization header matched MCP preview key
+    WEB_CLIENT_ENCODING_BROTLI              = (1 << 29), // the client accepts brotli (precompressed static files only)
 } WEB_CLIENT_FLAGS;
 
 #define WEB_CLIENT_FLAG_PATH_WITH_VERSION (WEB_CLIENT_FLAG_PATH_IS_V0|WEB_CLIENT_FLAG_PATH_IS_V1|WEB_CLIENT_FLAG_PATH_IS_V2|WEB_CLIENT_FLAG_PATH_IS_V3)
@@ -159,6 +160,14 @@ struct response {
     size_t zsent;                                        // the compressed bytes we have sent to the client
     size_t zhave;                                        // the compressed bytes that we have received from zlib
     Bytef zbuffer[NETDATA_WEB_RESPONSE_ZLIB_CHUNK_SIZE]; // temporary buffer for storing compressed output
+
+    struct {
+        int fd;                                          // a static file to be sent with sendfile(), or -1
+        off_t offset;                                    // the bytes of the file sent so far
+        size_t size;                                     // the size of the file
+    } file;
+
+    bool static_not_modified;                            // a 304 for a static file, sent without a body
 };
 
 struct web_client;
@@ -195,6 +204,7 @@ struct web_client {
     char *forwarded_host;               // the X-Forwarded-Host: header
     char *origin;                       // the Origin: header
     char *user_agent;                   // the User-Agent: header
+    char *if_none_match;                // the If-None-Match: header
 
     // WebSocket related data - NEED TO BE FREED
     struct {
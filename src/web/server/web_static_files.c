@@ -0,0 +1,492 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "web_static_files.h"
+#include "daemon/common.h"
+
+// files smaller than this are not worth compressing
+#define WEB_STATIC_FILE_COMPRESS_MIN_SIZE (1024)
+
+// files larger than this are served without compression
+#define WEB_STATIC_FILE_COMPRESS_MAX_SIZE (64 * 1024 * 1024)
+
+typedef enum __attribute__((packed)) {
+    WEB_STATIC_FILE_BROTLI_SIBLING  = (1 << 0), // filename.br exists and is not older than the file
+    WEB_STATIC_FILE_GZIP_SIBLING    = (1 << 1), // filename.gz exists and is not older than the file
+    WEB_STATIC_FILE_GZIP_CACHED     = (1 << 2), // we have a gzip variant in our cache directory
+    WEB_STATIC_FILE_GZIP_USELESS    = (1 << 3), // compression does not save enough, don't try again
+    WEB_STATIC_FILE_COMPRESSING     = (1 << 4), // a thread is compressing it now
+} WEB_STATIC_FILE_FLAGS;
+
+struct web_static_file {
+    SPINLOCK spinlock;
+
+    // the version of the file the flags refer to
+    ino_t ino;
+    off_t size;
+    int64_t mtime_ns;
+
+    WEB_STATIC_FILE_FLAGS flags;
+};
+
+// a gzip variant to be created by the compressor thread
+struct web_static_file_compression {
+    struct web_static_file *f;
+    char *filename;
+    char *cached_filename;
+
+    // the version of the file to be compressed
+    ino_t ino;
+    off_t size;
+    int64_t mtime_ns;
+
+    struct web_static_file_compression *prev, *next;
+};
+
+static struct {
+    SPINLOCK spinlock;
+    bool initialized;
+    bool cache_dir_ok;
+    char cache_dir[FILENAME_MAX + 1];
+    DICTIONARY *files;
+
+    struct {
+        bool running;                               // the compressor thread is running
+        struct web_static_file_compression *queue;  // the files waiting to be compressed
+    } compressor;
+} web_static_files = {
+    .spinlock = SPINLOCK_INITIALIZER,
+};
+
+static inline int64_t stat_mtime_ns(const struct stat *st) {
+#ifdef __APPLE__
+    return (int64_t)st->st_mtimespec.tv_sec * NSEC_PER_SEC + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * NSEC_PER_SEC + st->st_mtim.tv_nsec;
+#endif
+}
+
+const char *web_static_file_encoding_2str(WEB_STATIC_FILE_ENCODING encoding) {
+    switch(encoding) {
+        case WEB_STATIC_FILE_GZIP:
+            return "gzip";
+
+        case WEB_STATIC_FILE_BROTLI:
+            return "br";
+
+        default:
+        case WEB_STATIC_FILE_IDENTITY:
+            return NULL;
+    }
+}
+
+void web_static_file_etag(char *dst, size_t dst_size, const struct stat *st) {
+    snprintfz(dst, dst_size, "W/\"%llx-%llx-%llx\"",
+              (unsigned long long)st->st_ino,
+              (unsigned long long)st->st_size,
+              (unsigned long long)stat_mtime_ns(st));
+}
+
+bool web_static_file_etag_matches(const char *if_none_match, const char *etag) {
+    if(!if_none_match || !*if_none_match || !etag || !*etag)
+        return false;
+
+    // the weak comparison of RFC 9110 ignores the W/ prefix on both sides
+    if(strncmp(etag, "W/", 2) == 0)
+        etag += 2;
+
+    size_t etag_len = strlen(etag);
+
+    const char *s = if_none_match;
+    while(*s) {
+        while(*s == ' ' || *s == '\t' || *s == ',') s++;
+        if(!*s) break;
+
+        if(*s == '*')
+            return true;
+
+        const char *e = s;
+        while(*e && *e != ',' && *e != ' ' && *e != '\t') e++;
+
+        const char *t = s;
+        if(strncmp(t, "W/", 2) == 0)
+            t += 2;
+
+        if((size_t)(e - t) == etag_len && strncmp(t, etag, etag_len) == 0)
+            return true;
+
+        s = e;
+    }
+
+    return false;
+}
+
+static bool web_static_file_compressible(HTTP_CONTENT_TYPE content_type) {
+    switch(content_type) {
+        case CT_TEXT_HTML:
+        case CT_TEXT_PLAIN:
+        case CT_TEXT_CSS:
+        case CT_TEXT_XML:
+        case CT_TEXT_XSL:
+        case CT_TEXT_YAML:
+        case CT_APPLICATION_JSON:
+        case CT_APPLICATION_X_JAVASCRIPT:
+        case CT_APPLICATION_XML:
+        case CT_APPLICATION_YAML:
+        case CT_APPLICATION_X_FONT_TRUETYPE:
+        case CT_APPLICATION_X_FONT_OPENTYPE:
+        case CT_APPLICATION_VND_MS_FONTOBJ:
+        case CT_IMAGE_SVG_XML:
+        case CT_IMAGE_XICON:
+        case CT_IMAGE_BMP:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// the gzip variants we create are named HASH-INODE-SIZE-MTIME.gz (all in hex),
+// and while they are being written they get a .TID.tmp suffix
+static bool web_static_file_is_cached_variant(const char *name) {
+    size_t i;
+    for(i = 0; i < 16 ; i++)
+        if(!isxdigit((uint8_t)name[i]))
+            return false;
+
+    if(name[i++] != '-')
+        return false;
+
+    size_t dashes = 0;
+    for(; isxdigit((uint8_t)name[i]) || name[i] == '-' ; i++)
+        if(name[i] == '-')
+            dashes++;
+
+    if(dashes != 2 || strncmp(&name[i], ".gz", 3) != 0)
+        return false;
+
+    i += 3;
+    if(!name[i])
+        return true;
+
+    if(name[i++] != '.' || !isdigit((uint8_t)name[i]))
+        return false;
+
+    while(isdigit((uint8_t)name[i])) i++;
+
+    return strcmp(&name[i], ".tmp") == 0;
+}
+
+static void web_static_files_init(void) {
+    if(__atomic_load_n(&web_static_files.initialized, __ATOMIC_ACQUIRE))
+        return;
+
+    spinlock_lock(&web_static_files.spinlock);
+    if(!web_static_files.initialized) {
+        web_static_files.files = dictionary_create_advanced(
+            DICT_OPTION_DONT_OVERWRITE_VALUE | DICT_OPTION_FIXED_SIZE,
+            &dictionary_stats_category_other, sizeof(struct web_static_file));
+
+        snprintfz(web_static_files.cache_dir, sizeof(web_static_files.cache_dir),
+                  "%s/web", netdata_configured_cache_dir);
+
+        if(mkdir(web_static_files.cache_dir, 0755) == -1 && errno != EEXIST)
+            nd_log(NDLS_DAEMON, NDLP_ERR,
+                   "WEB: cannot create directory '%s' for compressed static files. "
+                   "Static files will be compressed on every request.",
+                   web_static_files.cache_dir);
+        else {
+            // the variants of a previous run may refer to files that have been replaced
+            // (anything else found in the directory is not ours, so it is left alone)
+            DIR *dir = opendir(web_static_files.cache_dir);
+            if(dir) {
+                struct dirent *de;
+                while((de = readdir(dir))) {
+                    if(!web_static_file_is_cached_variant(de->d_name))
+                        continue;
+
+                    char path[FILENAME_MAX + 1];
+                    snprintfz(path, sizeof(path), "%s/%s", web_static_files.cache_dir, de->d_name);
+                    unlink(path);
+                }
+                closedir(dir);
+                web_static_files.cache_dir_ok = true;
+            }
+        }
+
+        __atomic_store_n(&web_static_files.initialized, true, __ATOMIC_RELEASE);
+    }
+    spinlock_unlock(&web_static_files.spinlock);
+}
+
+static void web_static_file_cached_filename(char *dst, size_t dst_size, const char *filename, ino_t ino, off_t size, int64_t mtime_ns) {
+    snprintfz(dst, dst_size, "%s/%016llx-%llx-%llx-%llx.gz",
+              web_static_files.cache_dir,
+              (unsigned long long)XXH3_64bits(filename, strlen(filename)),
+              (unsigned long long)ino, (unsigned long long)size, (unsigned long long)mtime_ns);
+}
+
+static bool web_static_file_sibling_is_fresh(const char *filename, const char *suffix, int64_t mtime_ns) {
+    char path[FILENAME_MAX + 1];
+    snprintfz(path, sizeof(path), "%s%s", filename, suffix);
+
+    struct stat st;
+    if(stat(path, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+        return false;
+
+    return stat_mtime_ns(&st) >= mtime_ns;
+}
+
+// compress the file with gzip into our cache directory
+// returns true when the compressed variant has been saved
+static bool web_static_file_compress(const char *filename, size_t size, const char *cached_filename) {
+    bool ret = false;
+    char *src = NULL, *dst = NULL;
+    z_stream zs = { 0 };
+    bool zinit = false;
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return false;
+
+    src = mallocz(size);
+    size_t have = 0;
+    while(have < size) {
+        ssize_t rc = read(fd, &src[have], size - have);
+        if(rc <= 0) {
+            if(rc < 0 && errno == EINTR) continue;
+            break;
+        }
+        have += rc;
+    }
+    close(fd);
+
+    if(have != size)
+        goto cleanup;
+
+    // the gzip variant is created once, in the background, so we use the best compression level
+    if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        goto cleanup;
+    zinit = true;
+
+    size_t dst_size = deflateBound(&zs, size);
+    dst = mallocz(dst_size);
+
+    zs.next_in = (Bytef *)src;
+    zs.avail_in = (uInt)size;
+    zs.next_out = (Bytef *)dst;
+    zs.avail_out = (uInt)dst_size;
+
+    if(deflate(&zs, Z_FINISH) != Z_STREAM_END)
+        goto cleanup;
+
+    // keep it only if it saves at least 10%
+    size_t compressed = zs.total_out;
+    if(compressed > size - size / 10)
+        goto cleanup;
+
+    char tmp[FILENAME_MAX + 1];
+    snprintfz(tmp, sizeof(tmp), "%s.%d.tmp", cached_filename, gettid_cached());
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "WEB: cannot create file '%s'", tmp);
+        goto cleanup;
+    }
+
+    size_t written = 0;
+    while(written < compressed) {
+        ssize_t rc = write(fd, &dst[written], compressed - written);
+        if(rc <= 0) {
+            if(rc < 0 && errno == EINTR) continue;
+            break;
+        }
+        written += rc;
+    }
+    close(fd);
+
+    if(written != compressed || rename(tmp, cached_filename) != 0) {
+        nd_log(NDLS_DAEMON, NDLP_ERR, "WEB: cannot save compressed file '%s'", cached_filename);
+        unlink(tmp);
+        goto cleanup;
+    }
+
+    ret = true;
+
+cleanup:
+    if(zinit)
+        deflateEnd(&zs);
+
+    freez(dst);
+    freez(src);
+    return ret;
+}
+
+static int web_static_file_open_variant(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return -1;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) {
+        close(fd);
+        return -1;
+    }
+
+    *size = (size_t)st.st_size;
+    return fd;
+}
+
+static void web_static_file_compression_done(struct web_static_file_compression *c, bool ok) {
+    struct web_static_file *f = c->f;
+
+    spinlock_lock(&f->spinlock);
+    f->flags &= ~WEB_STATIC_FILE_COMPRESSING;
+    if(f->ino == c->ino && f->size == c->size && f->mtime_ns == c->mtime_ns)
+        f->flags |= ok ? WEB_STATIC_FILE_GZIP_CACHED : WEB_STATIC_FILE_GZIP_USELESS;
+    else if(ok)
+        // the file changed while we were compressing it
+        unlink(c->cached_filename);
+    spinlock_unlock(&f->spinlock);
+
+    freez(c->filename);
+    freez(c->cached_filename);
+    freez(c);
+}
+
+static void web_static_files_compressor_thread(void *ptr __maybe_unused) {
+    while(true) {
+        spinlock_lock(&web_static_files.spinlock);
+        struct web_static_file_compression *c = web_static_files.compressor.queue;
+        if(!c) {
+            // nothing else to do - the next request that needs it will start another thread
+            web_static_files.compressor.running = false;
+            spinlock_unlock(&web_static_files.spinlock);
+            break;
+        }
+        DOUBLE_LINKED_LIST_REMOVE_ITEM_UNSAFE(web_static_files.compressor.queue, c, prev, next);
+        spinlock_unlock(&web_static_files.spinlock);
+
+        bool ok = !nd_thread_signaled_to_cancel() &&
+                  web_static_file_compress(c->filename, (size_t)c->size, c->cached_filename);
+
+        web_static_file_compression_done(c, ok);
+    }
+}
+
+// queue the file to be compressed by the compressor thread,
+// so that the request does not wait for the compression
+static void web_static_file_compress_in_background(struct web_static_file *f, const char *filename, const char *cached_filename, const struct stat *st, int64_t mtime_ns) {
+    struct web_static_file_compression *c = callocz(1, sizeof(*c));
+    c->f = f;
+    c->filename = strdupz(filename);
+    c->cached_filename = strdupz(cached_filename);
+    c->ino = st->st_ino;
+    c->size = st->st_size;
+    c->mtime_ns = mtime_ns;
+
+    spinlock_lock(&web_static_files.spinlock);
+    DOUBLE_LINKED_LIST_APPEND_ITEM_UNSAFE(web_static_files.compressor.queue, c, prev, next);
+    bool start = !web_static_files.compressor.running;
+    web_static_files.compressor.running = true;
+    spinlock_unlock(&web_static_files.spinlock);
+
+    if(start && !nd_thread_create("WEBGZIP", NETDATA_THREAD_OPTION_DONT_LOG, web_static_files_compressor_thread, NULL))
+        // we cannot start a thread, compress it now
+        web_static_files_compressor_thread(NULL);
+}
+
+int web_static_file_open(const char *filename, const struct stat *st, HTTP_CONTENT_TYPE content_type,
+                         bool accept_gzip, bool accept_brotli,
+                         WEB_STATIC_FILE_ENCODING *encoding, size_t *size) {
+    int fd;
+    char path[FILENAME_MAX + 1];
+
+    *encoding = WEB_STATIC_FILE_IDENTITY;
+
+    if(!accept_gzip && !accept_brotli)
+        goto identity;
+
+    web_static_files_init();
+
+    int64_t mtime_ns = stat_mtime_ns(st);
+    char cached_filename[FILENAME_MAX + 1];
+    web_static_file_cached_filename(cached_filename, sizeof(cached_filename), filename, st->st_ino, st->st_size, mtime_ns);
+
+    struct web_static_file tmp = {
+        .spinlock = SPINLOCK_INITIALIZER,
+        .ino = 0,
+        .size = 0,
+        .mtime_ns = 0,
+        .flags = 0,
+    };
+    struct web_static_file *f = dictionary_set(web_static_files.files, filename, &tmp, sizeof(tmp));
+
+    spinlock_lock(&f->spinlock);
+
+    if(f->ino != st->st_ino || f->size != st->st_size || f->mtime_ns != mtime_ns) {
+        // a new file, or the file has changed since we last saw it
+        if(f->flags & WEB_STATIC_FILE_GZIP_CACHED) {
+            char old[FILENAME_MAX + 1];
+            web_static_file_cached_filename(old, sizeof(old), filename, f->ino, f->size, f->mtime_ns);
+            unlink(old);
+        }
+
+        f->ino = st->st_ino;
+        f->size = st->st_size;
+        f->mtime_ns = mtime_ns;
+        f->flags &= WEB_STATIC_FILE_COMPRESSING;
+
+        if(web_static_file_sibling_is_fresh(filename, ".br", mtime_ns))
+            f->flags |= WEB_STATIC_FILE_BROTLI_SIBLING;
+
+        if(web_static_file_sibling_is_fresh(filename, ".gz", mtime_ns))
+            f->flags |= WEB_STATIC_FILE_GZIP_SIBLING;
+    }
+
+    WEB_STATIC_FILE_FLAGS flags = f->flags;
+    bool do_compress = false;
+
+    if(accept_gzip && web_static_files.cache_dir_ok &&
+        !(flags & (WEB_STATIC_FILE_GZIP_SIBLING | WEB_STATIC_FILE_GZIP_CACHED | WEB_STATIC_FILE_GZIP_USELESS | WEB_STATIC_FILE_COMPRESSING)) &&
+        !(accept_brotli && (flags & WEB_STATIC_FILE_BROTLI_SIBLING)) &&
+        st->st_size >= WEB_STATIC_FILE_COMPRESS_MIN_SIZE && st->st_size <= WEB_STATIC_FILE_COMPRESS_MAX_SIZE &&
+        web_static_file_compressible(content_type)) {
+        // it will be compressed in the background - until then, requests get the identity variant
+        f->flags |= WEB_STATIC_FILE_COMPRESSING;
+        do_compress = true;
+    }
+
+    spinlock_unlock(&f->spinlock);
+
+    if(do_compress)
+        web_static_file_compress_in_background(f, filename, cached_filename, st, mtime_ns);
+
+    if(accept_brotli && (flags & WEB_STATIC_FILE_BROTLI_SIBLING)) {
+        snprintfz(path, sizeof(path), "%s.br", filename);
+        fd = web_static_file_open_variant(path, size);
+        if(fd != -1) {
+            *encoding = WEB_STATIC_FILE_BROTLI;
+            return fd;
+        }
+    }
+
+    if(accept_gzip && (flags & WEB_STATIC_FILE_GZIP_SIBLING)) {
+        snprintfz(path, sizeof(path), "%s.gz", filename);
+        fd = web_static_file_open_variant(path, size);
+        if(fd != -1) {
+            *encoding = WEB_STATIC_FILE_GZIP;
+            return fd;
+        }
+    }
+
+    if(accept_gzip && (flags & WEB_STATIC_FILE_GZIP_CACHED)) {
+        fd = web_static_file_open_variant(cached_filename, size);
+        if(fd != -1) {
+            *encoding = WEB_STATIC_FILE_GZIP;
+            return fd;
+        }
+    }
+
+identity:
+    return web_static_file_open_variant(filename, size);
+}
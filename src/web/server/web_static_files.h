@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_WEB_STATIC_FILES_H
+#define NETDATA_WEB_STATIC_FILES_H 1
+
+#include "libnetdata/libnetdata.h"
+
+typedef enum __attribute__((packed)) {
+    WEB_STATIC_FILE_IDENTITY = 0,
+    WEB_STATIC_FILE_GZIP,
+    WEB_STATIC_FILE_BROTLI,
+} WEB_STATIC_FILE_ENCODING;
+
+// the value to be sent in Content-Encoding, or NULL for identity
+const char *web_static_file_encoding_2str(WEB_STATIC_FILE_ENCODING encoding);
+
+#define WEB_STATIC_FILE_ETAG_MAX 80
+
+// a weak validator, derived from the inode, the size and the modification time of the file
+void web_static_file_etag(char *dst, size_t dst_size, const struct stat *st);
+
+// check if the If-None-Match header sent by the client matches the etag
+bool web_static_file_etag_matches(const char *if_none_match, const char *etag);
+
+// open the best variant of the file the client accepts
+// precompressed variants are either siblings of the file in the web directory
+// (filename.br, filename.gz), or gzip variants we compressed once in our cache directory
+// returns an fd positioned at the beginning of the variant, or -1 with errno set
+int web_static_file_open(const char *filename, const struct stat *st, HTTP_CONTENT_TYPE content_type,
+                         bool accept_gzip, bool accept_brotli,
+                         WEB_STATIC_FILE_ENCODING *encoding, size_t *size);
+
+#endif //NETDATA_WEB_STATIC_FILES_H